@@ -0,0 +1,83 @@
+-- predictability
+SET synchronous_commit = on;
+SET logical_decoding_work_mem = '64kB';
+
+SELECT 'init' FROM pg_create_logical_replication_slot('regression_slot', 'test_decoding');
+
+CREATE TABLE stream_test(data text);
+
+-- consume DDL
+SELECT data FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1');
+
+-- large committed transaction, streamed in several blocks before the commit
+BEGIN;
+INSERT INTO stream_test SELECT 'stream-big:'||g.i FROM generate_series(1, 5000) g(i);
+COMMIT;
+SELECT count(*) FILTER (WHERE data ~ '^opening') > 1 AS multiple_blocks,
+       count(*) FILTER (WHERE data ~ '^opening') = count(*) FILTER (WHERE data ~ '^closing') AS balanced,
+       count(*) FILTER (WHERE data ~ 'INSERT') AS inserts,
+       count(*) FILTER (WHERE data ~ '^committing') AS commits,
+       count(*) FILTER (WHERE data ~ '^(BEGIN|COMMIT)$') AS plain
+FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1');
+
+-- without stream-changes the same transaction is spilled and decoded at commit
+BEGIN;
+INSERT INTO stream_test SELECT 'spill-big:'||g.i FROM generate_series(1, 5000) g(i);
+COMMIT;
+SELECT count(*) FILTER (WHERE data ~ '^opening') AS blocks,
+       count(*) FILTER (WHERE data ~ 'INSERT') AS inserts,
+       count(*) FILTER (WHERE data ~ '^(BEGIN|COMMIT)$') AS plain
+FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1');
+
+-- subtransaction rolled back after part of it has been streamed
+BEGIN;
+INSERT INTO stream_test SELECT 'stream-top:'||g.i FROM generate_series(1, 2000) g(i);
+SAVEPOINT s1;
+INSERT INTO stream_test SELECT 'stream-sub-aborted:'||g.i FROM generate_series(1, 3000) g(i);
+ROLLBACK TO SAVEPOINT s1;
+INSERT INTO stream_test SELECT 'stream-top-after:'||g.i FROM generate_series(1, 10) g(i);
+COMMIT;
+SELECT count(*) FILTER (WHERE data ~ '^aborting') >= 1 AS sub_aborted,
+       count(*) FILTER (WHERE data ~ 'INSERT') >= 2010 AS inserts,
+       count(*) FILTER (WHERE data ~ 'stream-top-after') AS after_rollback,
+       count(*) FILTER (WHERE data ~ '^committing') AS commits
+FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1');
+SELECT count(*) FROM stream_test WHERE data ~ 'stream-sub-aborted';
+
+-- aborted toplevel transaction
+BEGIN;
+INSERT INTO stream_test SELECT 'stream-aborted:'||g.i FROM generate_series(1, 5000) g(i);
+ROLLBACK;
+-- aborts don't flush WAL, so commit something to make the abort visible
+INSERT INTO stream_test VALUES ('flush');
+SELECT count(*) FILTER (WHERE data ~ '^opening') > 1 AS multiple_blocks,
+       count(*) FILTER (WHERE data ~ '^aborting') AS aborts,
+       count(*) FILTER (WHERE data ~ '^committing') AS commits,
+       count(*) FILTER (WHERE data ~ '^(BEGIN|COMMIT)$') AS plain
+FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1');
+
+-- transaction streamed until it performs DDL, the rest is spilled and
+-- streamed at commit
+BEGIN;
+INSERT INTO stream_test SELECT 'stream-ddl-before:'||g.i FROM generate_series(1, 2000) g(i);
+ALTER TABLE stream_test ADD COLUMN extra int;
+INSERT INTO stream_test SELECT 'stream-ddl-after:'||g.i, g.i FROM generate_series(1, 2000) g(i);
+COMMIT;
+SELECT count(*) FILTER (WHERE data ~ 'INSERT') AS inserts,
+       count(*) FILTER (WHERE data ~ 'extra\[integer\]:2000') AS new_column,
+       count(*) FILTER (WHERE data ~ '^committing') AS commits
+FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1');
+
+-- streamed transaction with toasted values and a message
+BEGIN;
+SELECT 'msg' FROM pg_logical_emit_message(true, 'test', 'streamed message');
+INSERT INTO stream_test (data) SELECT string_agg(md5((g.i * 100 + h.i)::text), '') FROM generate_series(1, 40) g(i), generate_series(1, 300) h(i) GROUP BY g.i;
+COMMIT;
+SELECT count(*) FILTER (WHERE data ~ '^streaming message') AS messages,
+       count(*) FILTER (WHERE data ~ 'INSERT') AS inserts,
+       sum(length(data)) FILTER (WHERE data ~ 'INSERT') > 40 * 9600 AS detoasted,
+       count(*) FILTER (WHERE data ~ 'unchanged-toast-datum') AS unchanged
+FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1');
+
+DROP TABLE stream_test;
+SELECT pg_drop_replication_slot('regression_slot');
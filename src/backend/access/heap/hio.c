@@ -178,8 +178,9 @@ static void
 RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 {
 	Page		page;
-	BlockNumber blockNum = InvalidBlockNumber,
-				firstBlock = InvalidBlockNumber;
+	BlockNumber blockNum,
+				firstBlock,
+				lastBlock;
 	int			extraBlocks = 0;
 	int			lockWaiters = 0;
 	Size		freespace = 0;
@@ -198,24 +199,32 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 */
 	extraBlocks = Min(512, lockWaiters * 20);
 
-	while (extraBlocks-- >= 0)
-	{
-		/* Ouch - an unnecessary lseek() each time through the loop! */
-		buffer = ReadBufferBI(relation, P_NEW, bistate);
+	/*
+	 * Extend the file by all the blocks in one smgr call, rather than
+	 * writing out one page at a time through P_NEW.  That keeps the time we
+	 * hold the extension lock, which the waiters are queued on, short.
+	 */
+	RelationOpenSmgr(relation);
+	firstBlock = smgrnblocks(relation->rd_smgr, MAIN_FORKNUM);
+	lastBlock = firstBlock + extraBlocks;
+	smgrzeroextend(relation->rd_smgr, MAIN_FORKNUM, firstBlock,
+				   extraBlocks + 1, false);
 
-		/* Extend by one page. */
-		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	for (blockNum = firstBlock; blockNum <= lastBlock; blockNum++)
+	{
+		/*
+		 * The new pages read as zeroes, so there's no need to read them in;
+		 * initialize them in the buffer pool instead.
+		 */
+		buffer = ReadBufferExtended(relation, MAIN_FORKNUM, blockNum,
+									RBM_ZERO_AND_LOCK,
+									bistate ? bistate->strategy : NULL);
 		page = BufferGetPage(buffer);
 		PageInit(page, BufferGetPageSize(buffer), 0);
 		MarkBufferDirty(buffer);
-		blockNum = BufferGetBlockNumber(buffer);
 		freespace = PageGetHeapFreeSpace(page);
 		UnlockReleaseBuffer(buffer);
 
-		/* Remember first block number thus added. */
-		if (firstBlock == InvalidBlockNumber)
-			firstBlock = blockNum;
-
 		/*
 		 * Immediately update the bottom level of the FSM.  This has a good
 		 * chance of making this page visible to other concurrently inserting
@@ -234,7 +243,7 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 * last block we added as if it were the freespace value for every block
 	 * we added.  That's actually true, because they're all equally empty.
 	 */
-	UpdateFreeSpaceMap(relation, firstBlock, blockNum, freespace);
+	UpdateFreeSpaceMap(relation, firstBlock, lastBlock, freespace);
 }
 
 /*
@@ -20,6 +20,7 @@
  *		index_insert	- insert an index tuple into a relation
  *		index_markpos	- mark a scan position
  *		index_restrpos	- restore a scan position
+ *		index_skip		- skip past entries sharing a key prefix
  *		index_parallelscan_estimate - estimate shared memory for parallel scan
  *		index_parallelscan_initialize - initialize parallel scan
  *		index_parallelrescan  - (re)start a parallel scan of an index
@@ -406,6 +407,42 @@ index_restrpos(IndexScanDesc scan)
 	scan->indexRelation->rd_amroutine->amrestrpos(scan);
 }
 
+/* ----------------
+ *		index_skip - skip past entries sharing a key prefix
+ *
+ * Positions the scan so that the next index_getnext_tid() call returns the
+ * first matching entry whose leading "prefix" index columns differ from
+ * those of the entry most recently returned.  Returns false if there are
+ * no more matching entries; the scan is then finished, and must not be
+ * continued.
+ *
+ * The AM is free to skip less than that (a call that moves nowhere at all
+ * is legal), so the caller must still be prepared to see further entries
+ * with the same prefix.
+ * ----------------
+ */
+bool
+index_skip(IndexScanDesc scan, ScanDirection direction, int prefix)
+{
+	bool		found;
+
+	SCAN_CHECKS;
+	CHECK_SCAN_PROCEDURE(amskip);
+
+	Assert(prefix > 0 &&
+		   prefix <= RelationGetNumberOfAttributes(scan->indexRelation));
+
+	scan->xs_continue_hot = false;
+
+	found = scan->indexRelation->rd_amroutine->amskip(scan, direction,
+													  prefix);
+
+	/* Reset kill flag immediately for safety */
+	scan->kill_prior_tuple = false;
+
+	return found;
+}
+
 /*
  * index_parallelscan_estimate - estimate shared memory for parallel scan
  *
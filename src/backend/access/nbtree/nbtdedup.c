@@ -0,0 +1,310 @@
+/*-------------------------------------------------------------------------
+ *
+ * nbtdedup.c
+ *	  Deduplicate items in Postgres btrees.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/nbtree/nbtdedup.c
+ *
+ *	NOTES
+ *	   A run of leaf tuples whose keys are bitwise identical can be replaced
+ *	   by one posting list tuple, which stores the key once followed by the
+ *	   heap TIDs of all the original tuples.  See the "Deduplication" section
+ *	   of the README for the on-disk format and the rules for when this is
+ *	   done.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/nbtree.h"
+#include "access/nbtxlog.h"
+#include "access/xloginsert.h"
+#include "miscadmin.h"
+#include "utils/rel.h"
+
+static OffsetNumber _bt_dedup_flush(Page newpage, OffsetNumber newoff,
+				IndexTuple base, Size basesz, int nitems,
+				ItemPointer htids, int nhtids);
+
+
+/*
+ *	_bt_dedup_one_page() -- Try to merge duplicates on a leaf page.
+ *
+ * The caller must hold an exclusive lock on the buffer.  Returns true if
+ * the page was changed; the caller's notion of item offsets on the page is
+ * then no longer valid.
+ *
+ * The whole page is rewritten, but the WAL record carries no data: the
+ * result depends only on the page's contents, so redo simply runs the same
+ * deduplication pass again.  LP_DEAD hints are ignored for the same
+ * reason, since they are not WAL-logged and may differ on a standby.
+ */
+bool
+_bt_dedup_one_page(Relation rel, Buffer buf)
+{
+	Page		page = BufferGetPage(buf);
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	Page		newpage;
+
+	Assert(P_ISLEAF(opaque));
+
+	newpage = _bt_dedup_page(page);
+	if (newpage == NULL)
+		return false;
+
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	PageRestoreTempPage(newpage, page);
+
+	/*
+	 * Any LP_DEAD hints were lost along with the original line pointers, so
+	 * the page can't be known to contain garbage anymore.
+	 */
+	opaque->btpo_flags &= ~BTP_HAS_GARBAGE;
+
+	MarkBufferDirty(buf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		XLogRecPtr	recptr;
+
+		XLogBeginInsert();
+		XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
+
+		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_DEDUP);
+
+		PageSetLSN(page, recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	return true;
+}
+
+/*
+ *	_bt_dedup_page() -- Build a deduplicated copy of a leaf page.
+ *
+ * Returns a temporary page (see PageGetTempPageCopySpecial) holding the
+ * page's items with each run of equal keys merged into posting list tuples
+ * as far as BTMaxPostingSize allows, or NULL if there was nothing to merge.
+ * The input page is not modified.
+ *
+ * The heap TIDs in a posting list are kept in the order their tuples had on
+ * the page, so that scans return equal keys in the same order as they would
+ * have without deduplication.
+ */
+Page
+_bt_dedup_page(Page page)
+{
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	OffsetNumber offnum,
+				minoff,
+				maxoff,
+				newoff;
+	Page		newpage;
+	ItemPointer htids;
+	int			nhtids = 0;
+	int			nitems = 0;
+	IndexTuple	base = NULL;
+	Size		basesz = 0;
+	bool		merged = false;
+
+	minoff = P_FIRSTDATAKEY(opaque);
+	maxoff = PageGetMaxOffsetNumber(page);
+
+	/* Need at least two items for there to be anything to merge */
+	if (maxoff < minoff + 1)
+		return NULL;
+
+	newpage = PageGetTempPageCopySpecial(page);
+	newoff = P_HIKEY;
+
+	/* Copy the high key, if any, unchanged */
+	if (!P_RIGHTMOST(opaque))
+	{
+		ItemId		itemid = PageGetItemId(page, P_HIKEY);
+
+		if (PageAddItem(newpage, PageGetItem(page, itemid),
+						ItemIdGetLength(itemid), newoff,
+						false, false) == InvalidOffsetNumber)
+			elog(ERROR, "failed to add high key during deduplication");
+		newoff = OffsetNumberNext(newoff);
+	}
+
+	htids = (ItemPointer) palloc(MaxTIDsPerBTreePage * sizeof(ItemPointerData));
+
+	for (offnum = minoff; offnum <= maxoff; offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+		int			ntids;
+
+		ntids = BTreeTupleIsPosting(itup) ? BTreeTupleGetNPosting(itup) : 1;
+
+		if (base != NULL &&
+			_bt_dedup_equal(base, itup) &&
+			_bt_dedup_fits(base, nhtids + ntids))
+		{
+			/* Add this item's heap TIDs to the pending posting list */
+			nitems++;
+		}
+		else
+		{
+			/* Write out the pending item(s), and start again from this one */
+			if (base != NULL)
+			{
+				newoff = _bt_dedup_flush(newpage, newoff, base, basesz,
+										 nitems, htids, nhtids);
+				if (nitems > 1)
+					merged = true;
+			}
+			base = itup;
+			basesz = ItemIdGetLength(itemid);
+			nitems = 1;
+			nhtids = 0;
+		}
+
+		if (BTreeTupleIsPosting(itup))
+			memcpy(htids + nhtids, BTreeTupleGetPosting(itup),
+				   ntids * sizeof(ItemPointerData));
+		else
+			htids[nhtids] = itup->t_tid;
+		nhtids += ntids;
+	}
+
+	(void) _bt_dedup_flush(newpage, newoff, base, basesz,
+						   nitems, htids, nhtids);
+	if (nitems > 1)
+		merged = true;
+
+	pfree(htids);
+
+	if (!merged)
+	{
+		pfree(newpage);
+		return NULL;
+	}
+
+	return newpage;
+}
+
+/*
+ * Add the pending item(s) to newpage at newoff.  A single item is copied
+ * as it was; more than one is replaced by a posting list tuple.  Returns
+ * the offset at which the next item should go.
+ */
+static OffsetNumber
+_bt_dedup_flush(Page newpage, OffsetNumber newoff,
+				IndexTuple base, Size basesz, int nitems,
+				ItemPointer htids, int nhtids)
+{
+	if (nitems == 1)
+	{
+		if (PageAddItem(newpage, (Item) base, basesz, newoff,
+						false, false) == InvalidOffsetNumber)
+			elog(ERROR, "failed to add item during deduplication");
+	}
+	else
+	{
+		IndexTuple	posting;
+
+		posting = _bt_form_posting(base, htids, nhtids);
+		if (PageAddItem(newpage, (Item) posting, IndexTupleSize(posting),
+						newoff, false, false) == InvalidOffsetNumber)
+			elog(ERROR, "failed to add posting list tuple during deduplication");
+		pfree(posting);
+	}
+
+	return OffsetNumberNext(newoff);
+}
+
+/*
+ *	_bt_dedup_equal() -- Can these two leaf tuples share a posting list?
+ *
+ * Only keys that are bitwise identical are merged.  Keys that an opclass
+ * merely considers equal may still differ in ways that are visible to
+ * index-only scans (consider numeric 1.0 and 1.00), so we can't rely on the
+ * opclass comparison here.  This also means that deduplication needs no
+ * access to the index's relcache entry, which lets redo repeat it.
+ */
+bool
+_bt_dedup_equal(IndexTuple itup1, IndexTuple itup2)
+{
+	Size		keysz = BTreeTupleGetKeySize(itup1);
+
+	if (keysz != BTreeTupleGetKeySize(itup2))
+		return false;
+	if ((itup1->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)) !=
+		(itup2->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)))
+		return false;
+
+	return memcmp((char *) itup1 + sizeof(IndexTupleData),
+				  (char *) itup2 + sizeof(IndexTupleData),
+				  keysz - sizeof(IndexTupleData)) == 0;
+}
+
+/*
+ *	_bt_dedup_fits() -- Is a posting list of nhtids TIDs with base's key
+ *		within BTMaxPostingSize?
+ */
+bool
+_bt_dedup_fits(IndexTuple base, int nhtids)
+{
+	Size		sz;
+
+	if (nhtids > BT_OFFSET_MASK)
+		return false;
+
+	sz = BTreeTupleGetKeySize(base) + nhtids * sizeof(ItemPointerData);
+
+	return MAXALIGN(sz) <= BTMaxPostingSize;
+}
+
+/*
+ *	_bt_form_posting() -- Form a leaf tuple with base's key and the given
+ *		heap TIDs.
+ *
+ * base may be a plain tuple or a posting list tuple; only its key is used.
+ * With a single TID the result is a plain tuple,
+ * which is how the high key and downlink for a posting list tuple are made.
+ * The result is palloc'd.
+ */
+IndexTuple
+_bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
+{
+	Size		keysz = BTreeTupleGetKeySize(base);
+	Size		newsize;
+	IndexTuple	itup;
+
+	Assert(nhtids > 0);
+	Assert(keysz == MAXALIGN(keysz));
+
+	if (nhtids > 1)
+		newsize = MAXALIGN(keysz + nhtids * sizeof(ItemPointerData));
+	else
+		newsize = keysz;
+
+	itup = (IndexTuple) palloc0(newsize);
+	memcpy(itup, base, keysz);
+	itup->t_info &= ~(INDEX_SIZE_MASK | INDEX_ALT_TID_MASK);
+	itup->t_info |= newsize;
+
+	if (nhtids > 1)
+	{
+		Assert(nhtids <= BT_OFFSET_MASK);
+		BTreeTupleSetPosting(itup, nhtids, keysz);
+		memcpy(BTreeTupleGetPosting(itup), htids,
+			   nhtids * sizeof(ItemPointerData));
+	}
+	else
+		itup->t_tid = *htids;
+
+	return itup;
+}
@@ -23,8 +23,11 @@
 #include "miscadmin.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
+#include "storage/smgr.h"
 #include "utils/tqual.h"
 
+/* Minimum tree height for application of fastpath optimization */
+#define BTREE_FASTPATH_MIN_LEVEL	2
 
 typedef struct
 {
@@ -109,34 +112,120 @@ _bt_doinsert(Relation rel, IndexTuple itup,
 			 IndexUniqueCheck checkUnique, Relation heapRel)
 {
 	bool		is_unique = false;
-	int			natts = rel->rd_rel->relnatts;
+	int			indnkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
 	ScanKey		itup_scankey;
 	BTStack		stack;
 	Buffer		buf;
 	OffsetNumber offset;
+	bool		fastpath;
 
 	/* we need an insertion scan key to do our search, so build one */
 	itup_scankey = _bt_mkscankey(rel, itup);
 
+	/*
+	 * It's very common to have an index on an auto-incremented or
+	 * monotonically increasing value.  In such cases, every insertion happens
+	 * towards the end of the index.  We try to optimize that case by caching
+	 * the rightmost leaf of the index.  If our cached block is still the
+	 * rightmost leaf, has enough free space to accommodate the new entry, and
+	 * the insertion key is strictly greater than the first key on the page,
+	 * then the new key must belong on that page, and we can skip descending
+	 * the tree.  We call this the fastpath.
+	 *
+	 * The lock on the cached page is only acquired conditionally.  If someone
+	 * else holds it, they are most likely inserting into the same page, so
+	 * it's better to take the regular path than to queue up behind them.
+	 */
 top:
-	/* find the first page containing this key */
-	stack = _bt_search(rel, natts, itup_scankey, false, &buf, BT_WRITE, NULL);
-
+	fastpath = false;
 	offset = InvalidOffsetNumber;
+	if (RelationGetTargetBlock(rel) != InvalidBlockNumber)
+	{
+		Size		itemsz;
+		Page		page;
+		BTPageOpaque lpageop;
+
+		/*
+		 * Once we have the exclusive lock, the page can't stop being the
+		 * rightmost leaf, or fill up, while we are checking it.
+		 */
+		buf = ReadBuffer(rel, RelationGetTargetBlock(rel));
 
-	/* trade in our read lock for a write lock */
-	LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-	LockBuffer(buf, BT_WRITE);
+		if (ConditionalLockBuffer(buf))
+		{
+			_bt_checkpage(rel, buf);
 
-	/*
-	 * If the page was split between the time that we surrendered our read
-	 * lock and acquired our write lock, then this page may no longer be the
-	 * right place for the key we want to insert.  In this case, we need to
-	 * move right in the tree.  See Lehman and Yao for an excruciatingly
-	 * precise description.
-	 */
-	buf = _bt_moveright(rel, buf, natts, itup_scankey, false,
-						true, stack, BT_WRITE, NULL);
+			page = BufferGetPage(buf);
+
+			lpageop = (BTPageOpaque) PageGetSpecialPointer(page);
+			itemsz = IndexTupleDSize(*itup);
+			itemsz = MAXALIGN(itemsz);	/* be safe, PageAddItem will do this
+										 * but we need to be consistent */
+
+			if (P_ISLEAF(lpageop) && P_RIGHTMOST(lpageop) &&
+				!P_IGNORE(lpageop) &&
+				PageGetFreeSpace(page) > itemsz &&
+				PageGetMaxOffsetNumber(page) >= P_FIRSTDATAKEY(lpageop) &&
+				_bt_compare(rel, indnkeyatts, itup_scankey, page,
+							P_FIRSTDATAKEY(lpageop)) > 0)
+			{
+				/*
+				 * The rightmost page can't have an incomplete split, but be
+				 * paranoid about it anyway.
+				 */
+				Assert(!P_INCOMPLETE_SPLIT(lpageop));
+				fastpath = true;
+			}
+			else
+			{
+				_bt_relbuf(rel, buf);
+
+				/*
+				 * The cached block is of no use for this key.  Forget about
+				 * it; it will be set again if an insertion lands on the
+				 * rightmost leaf via the regular path.
+				 */
+				RelationSetTargetBlock(rel, InvalidBlockNumber);
+			}
+		}
+		else
+		{
+			ReleaseBuffer(buf);
+
+			/*
+			 * If someone's holding a lock, the page is likely to change
+			 * anyway, so don't try again until we know the new rightmost
+			 * leaf.
+			 */
+			RelationSetTargetBlock(rel, InvalidBlockNumber);
+		}
+	}
+
+	if (!fastpath)
+	{
+		/* find the first page containing this key */
+		stack = _bt_search(rel, indnkeyatts, itup_scankey, false, &buf, BT_WRITE,
+						   NULL);
+
+		/* trade in our read lock for a write lock */
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		LockBuffer(buf, BT_WRITE);
+
+		/*
+		 * If the page was split between the time that we surrendered our read
+		 * lock and acquired our write lock, then this page may no longer be
+		 * the right place for the key we want to insert.  In this case, we
+		 * need to move right in the tree.  See Lehman and Yao for an
+		 * excruciatingly precise description.
+		 */
+		buf = _bt_moveright(rel, buf, indnkeyatts, itup_scankey, false,
+							true, stack, BT_WRITE, NULL);
+	}
+	else
+	{
+		/* the fastpath page has room, so we'll never need the stack */
+		stack = NULL;
+	}
 
 	/*
 	 * If we're not allowing duplicates, make sure the key isn't already in
@@ -164,7 +253,7 @@ top:
 		TransactionId xwait;
 		uint32		speculativeToken;
 
-		offset = _bt_binsrch(rel, buf, natts, itup_scankey, false);
+		offset = _bt_binsrch(rel, buf, indnkeyatts, itup_scankey, false);
 		xwait = _bt_check_unique(rel, itup, heapRel, buf, offset, itup_scankey,
 								 checkUnique, &is_unique, &speculativeToken);
 
@@ -200,7 +289,7 @@ top:
 		 */
 		CheckForSerializableConflictIn(rel, NULL, buf);
 		/* do the insertion */
-		_bt_findinsertloc(rel, &buf, &offset, natts, itup_scankey, itup,
+		_bt_findinsertloc(rel, &buf, &offset, indnkeyatts, itup_scankey, itup,
 						  stack, heapRel);
 		_bt_insertonpg(rel, buf, InvalidBuffer, stack, itup, offset, false);
 	}
@@ -243,7 +332,7 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 				 uint32 *speculativeToken)
 {
 	TupleDesc	itupdesc = RelationGetDescr(rel);
-	int			natts = rel->rd_rel->relnatts;
+	int			indnkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
 	SnapshotData SnapshotDirty;
 	OffsetNumber maxoff;
 	Page		page;
@@ -302,7 +391,7 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 				 * in real comparison, but only for ordering/finding items on
 				 * pages. - vadim 03/24/97
 				 */
-				if (!_bt_isequal(itupdesc, page, offset, natts, itup_scankey))
+				if (!_bt_isequal(itupdesc, page, offset, indnkeyatts, itup_scankey))
 					break;		/* we're past all the equal tuples */
 
 				/* okay, we gotta fetch the heap tuple ... */
@@ -467,7 +556,7 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 			if (P_RIGHTMOST(opaque))
 				break;
 			if (!_bt_isequal(itupdesc, page, P_HIKEY,
-							 natts, itup_scankey))
+							 indnkeyatts, itup_scankey))
 				break;
 			/* Advance to next non-dead page --- there must be one */
 			for (;;)
@@ -626,6 +715,19 @@ _bt_findinsertloc(Relation rel,
 				break;			/* OK, now we have enough space */
 		}
 
+		/*
+		 * next, see if merging duplicates into posting lists frees enough
+		 * space.  This moves items around too, so the hint is invalid.
+		 */
+		if (P_ISLEAF(lpageop) && BTDeduplicationAllowed(rel) &&
+			_bt_dedup_one_page(rel, buf))
+		{
+			vacuumed = true;
+
+			if (PageGetFreeSpace(page) >= itemsz)
+				break;			/* OK, now we have enough space */
+		}
+
 		/*
 		 * nope, so check conditions (b) and (c) enumerated above
 		 */
@@ -810,6 +912,7 @@ _bt_insertonpg(Relation rel,
 		BTMetaPageData *metad = NULL;
 		OffsetNumber itup_off;
 		BlockNumber itup_blkno;
+		BlockNumber cachedBlock = InvalidBlockNumber;
 
 		itup_off = newitemoff;
 		itup_blkno = BufferGetBlockNumber(buf);
@@ -846,6 +949,14 @@ _bt_insertonpg(Relation rel,
 
 		MarkBufferDirty(buf);
 
+		/*
+		 * Remember the block if we just inserted into the rightmost leaf
+		 * page, for the fastpath in _bt_doinsert.  If the root is also the
+		 * leaf, there is no descent to save.
+		 */
+		if (P_RIGHTMOST(lpageop) && P_ISLEAF(lpageop) && !P_ISROOT(lpageop))
+			cachedBlock = BufferGetBlockNumber(buf);
+
 		if (BufferIsValid(metabuf))
 		{
 			metad->btm_fastroot = itup_blkno;
@@ -938,6 +1049,16 @@ _bt_insertonpg(Relation rel,
 		if (BufferIsValid(cbuf))
 			_bt_relbuf(rel, cbuf);
 		_bt_relbuf(rel, buf);
+
+		/*
+		 * Cache the rightmost leaf only once the tree is tall enough for
+		 * skipping the descent to be worthwhile.  _bt_getrootheight normally
+		 * just consults the cached metapage, but it might read the metapage,
+		 * so we must do this after releasing our buffer locks.
+		 */
+		if (BlockNumberIsValid(cachedBlock) &&
+			_bt_getrootheight(rel) >= BTREE_FASTPATH_MIN_LEVEL)
+			RelationSetTargetBlock(rel, cachedBlock);
 	}
 }
 
@@ -976,6 +1097,7 @@ _bt_split(Relation rel, Buffer buf, Buffer cbuf, OffsetNumber firstright,
 	Size		itemsz;
 	ItemId		itemid;
 	IndexTuple	item;
+	IndexTuple	lefthikey = NULL;
 	OffsetNumber leftoff,
 				rightoff;
 	OffsetNumber maxoff;
@@ -1079,6 +1201,18 @@ _bt_split(Relation rel, Buffer buf, Buffer cbuf, OffsetNumber firstright,
 		itemid = PageGetItemId(origpage, firstright);
 		itemsz = ItemIdGetLength(itemid);
 		item = (IndexTuple) PageGetItem(origpage, itemid);
+
+		/*
+		 * A high key needs only the key, so if that item is a posting list
+		 * tuple, use a plain tuple with its first heap TID instead.
+		 * btree_xlog_split() does the same when replaying the split.
+		 */
+		if (BTreeTupleIsPosting(item))
+		{
+			lefthikey = _bt_form_posting(item, BTreeTupleGetHeapTID(item), 1);
+			itemsz = IndexTupleSize(lefthikey);
+			item = lefthikey;
+		}
 	}
 	if (PageAddItem(leftpage, (Item) item, itemsz, leftoff,
 					false, false) == InvalidOffsetNumber)
@@ -1089,6 +1223,8 @@ _bt_split(Relation rel, Buffer buf, Buffer cbuf, OffsetNumber firstright,
 			 origpagenumber, RelationGetRelationName(rel));
 	}
 	leftoff = OffsetNumberNext(leftoff);
+	if (lefthikey)
+		pfree(lefthikey);
 
 	/*
 	 * Now transfer all the data items to the appropriate page.
@@ -1427,8 +1563,7 @@ _bt_findsplitloc(Relation rel,
 	state.is_rightmost = P_RIGHTMOST(opaque);
 	state.have_split = false;
 	if (state.is_leaf)
-		state.fillfactor = RelationGetFillFactor(rel,
-												 BTREE_DEFAULT_FILLFACTOR);
+		state.fillfactor = BTGetFillFactor(rel);
 	else
 		state.fillfactor = BTREE_NONLEAF_FILLFACTOR;
 	state.newitemonleft = false;	/* these just to keep compiler quiet */
@@ -427,9 +427,10 @@ _bt_gettrueroot(Relation rel)
  *		This represents the number of tree levels we'd have to descend through
  *		to start any btree index search.
  *
- *		This is used by the planner for cost-estimation purposes.  Since it's
- *		only an estimate, slightly-stale data is fine, hence we don't worry
- *		about updating previously cached data.
+ *		This is used by the planner for cost-estimation purposes, and to
+ *		decide whether the insertion fastpath is worthwhile.  Since it's only
+ *		an estimate, slightly-stale data is fine, hence we don't worry about
+ *		updating previously cached data.
  */
 int
 _bt_getrootheight(Relation rel)
@@ -775,6 +776,9 @@ _bt_page_recyclable(Page page)
  * This routine assumes that the caller has pinned and locked the buffer.
  * Also, the given itemnos *must* appear in increasing order in the array.
  *
+ * updatable[] lists posting list tuples that VACUUM is keeping but with
+ * fewer heap TIDs; updated[] holds their replacements, in the same order.
+ *
  * We record VACUUMs and b-tree deletes differently in WAL. InHotStandby
  * we need to be able to pin all of the blocks in the btree in physical
  * order when replaying the effects of a VACUUM, just as we do for the
@@ -788,15 +792,50 @@ _bt_page_recyclable(Page page)
 void
 _bt_delitems_vacuum(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems,
-					BlockNumber lastBlockVacuumed)
+					OffsetNumber *updatable, IndexTuple *updated,
+					int nupdatable, BlockNumber lastBlockVacuumed)
 {
 	Page		page = BufferGetPage(buf);
 	BTPageOpaque opaque;
+	char	   *updatedbuf = NULL;
+	Size		updatedbuflen = 0;
+	int			i;
+
+	/*
+	 * Gather the replacement tuples into a single chunk for the WAL record,
+	 * while we are still allowed to allocate memory.
+	 */
+	if (nupdatable > 0 && RelationNeedsWAL(rel))
+	{
+		Size		offset = 0;
+
+		for (i = 0; i < nupdatable; i++)
+			updatedbuflen += MAXALIGN(IndexTupleSize(updated[i]));
+
+		updatedbuf = palloc(updatedbuflen);
+		for (i = 0; i < nupdatable; i++)
+		{
+			Size		itemsz = MAXALIGN(IndexTupleSize(updated[i]));
+
+			memcpy(updatedbuf + offset, updated[i], itemsz);
+			offset += itemsz;
+		}
+	}
 
 	/* No ereport(ERROR) until changes are logged */
 	START_CRIT_SECTION();
 
-	/* Fix the page */
+	/*
+	 * Fix the page.  Replace the updated tuples first, since the offsets
+	 * we were given are only valid before any deletions.
+	 */
+	for (i = 0; i < nupdatable; i++)
+	{
+		if (!PageIndexTupleOverwrite(page, updatable[i], (Item) updated[i],
+									 IndexTupleSize(updated[i])))
+			elog(PANIC, "failed to update partially dead item in block %u of index \"%s\"",
+				 BufferGetBlockNumber(buf), RelationGetRelationName(rel));
+	}
 	if (nitems > 0)
 		PageIndexMultiDelete(page, itemnos, nitems);
 
@@ -825,6 +864,8 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 		xl_btree_vacuum xlrec_vacuum;
 
 		xlrec_vacuum.lastBlockVacuumed = lastBlockVacuumed;
+		xlrec_vacuum.ndeleted = nitems;
+		xlrec_vacuum.nupdated = nupdatable;
 
 		XLogBeginInsert();
 		XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
@@ -837,6 +878,12 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 		 */
 		if (nitems > 0)
 			XLogRegisterBufData(0, (char *) itemnos, nitems * sizeof(OffsetNumber));
+		if (nupdatable > 0)
+		{
+			XLogRegisterBufData(0, (char *) updatable,
+								nupdatable * sizeof(OffsetNumber));
+			XLogRegisterBufData(0, updatedbuf, updatedbuflen);
+		}
 
 		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_VACUUM);
 
@@ -844,6 +891,9 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 	}
 
 	END_CRIT_SECTION();
+
+	if (updatedbuf)
+		pfree(updatedbuf);
 }
 
 /*
@@ -1255,7 +1305,9 @@ _bt_pagedel(Relation rel, Buffer buf)
 				/* we need an insertion scan key for the search, so build one */
 				itup_scankey = _bt_mkscankey(rel, targetkey);
 				/* find the leftmost leaf page containing this key */
-				stack = _bt_search(rel, rel->rd_rel->relnatts, itup_scankey,
+				stack = _bt_search(rel,
+								   IndexRelationGetNumberOfKeyAttributes(rel),
+								   itup_scankey,
 								   false, &lbuf, BT_READ, NULL);
 				/* don't need a pin on the page */
 				_bt_relbuf(rel, lbuf);
@@ -140,6 +140,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = true;
 	amroutine->ampredlocks = true;
 	amroutine->amcanparallel = true;
+	amroutine->amcaninclude = true;
 	amroutine->amkeytype = InvalidOid;
 
 	amroutine->ambuild = btbuild;
@@ -159,6 +160,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->amendscan = btendscan;
 	amroutine->ammarkpos = btmarkpos;
 	amroutine->amrestrpos = btrestrpos;
+	amroutine->amskip = btskip;
 	amroutine->amestimateparallelscan = btestimateparallelscan;
 	amroutine->aminitparallelscan = btinitparallelscan;
 	amroutine->amparallelrescan = btparallelrescan;
@@ -388,8 +390,8 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 				 */
 				if (so->killedItems == NULL)
 					so->killedItems = (int *)
-						palloc(MaxIndexTuplesPerPage * sizeof(int));
-				if (so->numKilled < MaxIndexTuplesPerPage)
+						palloc(MaxTIDsPerBTreePage * sizeof(int));
+				if (so->numKilled < MaxTIDsPerBTreePage)
 					so->killedItems[so->numKilled++] = so->currPos.itemIndex;
 			}
 
@@ -498,6 +500,10 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so->killedItems = NULL;		/* until needed */
 	so->numKilled = 0;
 
+	so->skipScan = false;
+	so->skipTarget = BTSKIP_NONE;
+	so->skipTuple = NULL;		/* until needed */
+
 	/*
 	 * We don't know yet whether the scan will be index-only, so we do not
 	 * allocate the tuple workspace arrays until btrescan.  However, we set up
@@ -602,6 +608,8 @@ btendscan(IndexScanDesc scan)
 		MemoryContextDelete(so->arrayContext);
 	if (so->killedItems != NULL)
 		pfree(so->killedItems);
+	if (so->skipTuple != NULL)
+		pfree(so->skipTuple);
 	if (so->currTuples != NULL)
 		pfree(so->currTuples);
 	/* so->markTuples should not be pfree'd, see btrescan */
@@ -677,6 +685,9 @@ btrestrpos(IndexScanDesc scan)
 			BTScanPosUnpinIfPinned(so->currPos);
 		}
 
+		/* Any skip target was computed for the page we're leaving */
+		so->skipTarget = BTSKIP_NONE;
+
 		if (BTScanPosIsValid(so->markPos))
 		{
 			/* bump pin on mark buffer for assignment to current buffer */
@@ -694,6 +705,41 @@ btrestrpos(IndexScanDesc scan)
 	}
 }
 
+/*
+ *	btskip() -- skip past items sharing a key prefix with the current one
+ *
+ * The next btgettuple() call will return the first item whose first "prefix"
+ * key columns differ from those of the item most recently returned.  Returns
+ * false if there is no such item, in which case the scan is over.
+ */
+bool
+btskip(IndexScanDesc scan, ScanDirection dir, int prefix)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+
+	/* btree indexes are never lossy */
+	scan->xs_recheck = false;
+
+	if (!BTScanPosIsValid(so->currPos))
+		return false;
+
+	/*
+	 * Check to see if we should kill the previously-fetched tuple, as in
+	 * btgettuple(); we may be about to leave its page.
+	 */
+	if (scan->kill_prior_tuple)
+	{
+		if (so->killedItems == NULL)
+			so->killedItems = (int *)
+				palloc(MaxTIDsPerBTreePage * sizeof(int));
+		if (so->numKilled < MaxTIDsPerBTreePage)
+			so->killedItems[so->numKilled++] = so->currPos.itemIndex;
+		scan->kill_prior_tuple = false;
+	}
+
+	return _bt_skip(scan, dir, prefix);
+}
+
 /*
  * btestimateparallelscan -- estimate storage for BTParallelScanDescData
  */
@@ -1102,7 +1148,8 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 								 RBM_NORMAL, info->strategy);
 		LockBufferForCleanup(buf);
 		_bt_checkpage(rel, buf);
-		_bt_delitems_vacuum(rel, buf, NULL, 0, vstate.lastBlockVacuumed);
+		_bt_delitems_vacuum(rel, buf, NULL, 0, NULL, NULL, 0,
+							vstate.lastBlockVacuumed);
 		_bt_relbuf(rel, buf);
 	}
 
@@ -1200,6 +1247,11 @@ restart:
 	{
 		OffsetNumber deletable[MaxOffsetNumber];
 		int			ndeletable;
+		OffsetNumber updatable[MaxIndexTuplesPerPage];
+		IndexTuple	updated[MaxIndexTuplesPerPage];
+		int			nupdatable;
+		ItemPointer livetids = NULL;
+		int			nremoved;
 		OffsetNumber offnum,
 					minoff,
 					maxoff;
@@ -1239,6 +1291,8 @@ restart:
 		 * callback function.
 		 */
 		ndeletable = 0;
+		nupdatable = 0;
+		nremoved = 0;
 		minoff = P_FIRSTDATAKEY(opaque);
 		maxoff = PageGetMaxOffsetNumber(page);
 		if (callback)
@@ -1252,7 +1306,6 @@ restart:
 
 				itup = (IndexTuple) PageGetItem(page,
 												PageGetItemId(page, offnum));
-				htup = &(itup->t_tid);
 
 				/*
 				 * During Hot Standby we currently assume that
@@ -1275,8 +1328,47 @@ restart:
 				 * applies to *any* type of index that marks index tuples as
 				 * killed.
 				 */
-				if (callback(htup, callback_state))
-					deletable[ndeletable++] = offnum;
+				if (!BTreeTupleIsPosting(itup))
+				{
+					htup = &(itup->t_tid);
+					if (callback(htup, callback_state))
+					{
+						deletable[ndeletable++] = offnum;
+						nremoved++;
+					}
+				}
+				else
+				{
+					/*
+					 * A posting list tuple is deleted only if all of its heap
+					 * TIDs are dead; otherwise it is replaced by one holding
+					 * just the live TIDs.
+					 */
+					int			nposting = BTreeTupleGetNPosting(itup);
+					int			nlive = 0;
+					int			i;
+
+					if (livetids == NULL)
+						livetids = (ItemPointer)
+							palloc(BT_OFFSET_MASK * sizeof(ItemPointerData));
+
+					for (i = 0; i < nposting; i++)
+					{
+						htup = BTreeTupleGetPostingN(itup, i);
+						if (!callback(htup, callback_state))
+							livetids[nlive++] = *htup;
+					}
+
+					if (nlive == 0)
+						deletable[ndeletable++] = offnum;
+					else if (nlive < nposting)
+					{
+						updatable[nupdatable] = offnum;
+						updated[nupdatable++] = _bt_form_posting(itup, livetids,
+																 nlive);
+					}
+					nremoved += nposting - nlive;
+				}
 			}
 		}
 
@@ -1284,8 +1376,10 @@ restart:
 		 * Apply any needed deletes.  We issue just one _bt_delitems_vacuum()
 		 * call per page, so as to minimize WAL traffic.
 		 */
-		if (ndeletable > 0)
+		if (ndeletable > 0 || nupdatable > 0)
 		{
+			int			i;
+
 			/*
 			 * Notice that the issued XLOG_BTREE_VACUUM WAL record includes
 			 * all information to the replay code to allow it to get a cleanup
@@ -1301,8 +1395,12 @@ restart:
 			 * that.
 			 */
 			_bt_delitems_vacuum(rel, buf, deletable, ndeletable,
+								updatable, updated, nupdatable,
 								vstate->lastBlockVacuumed);
 
+			for (i = 0; i < nupdatable; i++)
+				pfree(updated[i]);
+
 			/*
 			 * Remember highest leaf page number we've issued a
 			 * XLOG_BTREE_VACUUM WAL record for.
@@ -1310,7 +1408,7 @@ restart:
 			if (blkno > vstate->lastBlockVacuumed)
 				vstate->lastBlockVacuumed = blkno;
 
-			stats->tuples_removed += ndeletable;
+			stats->tuples_removed += nremoved;
 			/* must recompute maxoff */
 			maxoff = PageGetMaxOffsetNumber(page);
 		}
@@ -1342,7 +1440,25 @@ restart:
 		if (minoff > maxoff)
 			delete_now = (blkno == orig_blkno);
 		else
-			stats->num_index_tuples += maxoff - minoff + 1;
+		{
+			/* count heap TIDs, not index tuples */
+			for (offnum = minoff;
+				 offnum <= maxoff;
+				 offnum = OffsetNumberNext(offnum))
+			{
+				IndexTuple	itup;
+
+				itup = (IndexTuple) PageGetItem(page,
+												PageGetItemId(page, offnum));
+				if (BTreeTupleIsPosting(itup))
+					stats->num_index_tuples += BTreeTupleGetNPosting(itup);
+				else
+					stats->num_index_tuples += 1;
+			}
+		}
+
+		if (livetids)
+			pfree(livetids);
 	}
 
 	if (delete_now)
@@ -17,6 +17,7 @@
 
 #include "access/nbtree.h"
 #include "access/relscan.h"
+#include "access/xact.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/predicate.h"
@@ -29,6 +30,12 @@ static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
 			 OffsetNumber offnum);
 static void _bt_saveitem(BTScanOpaque so, int itemIndex,
 			 OffsetNumber offnum, IndexTuple itup);
+static int _bt_setuppostingitems(BTScanOpaque so, int itemIndex,
+					  OffsetNumber offnum, ItemPointer heapTid,
+					  IndexTuple itup);
+static inline void _bt_savepostingitem(BTScanOpaque so, int itemIndex,
+					OffsetNumber offnum, ItemPointer heapTid,
+					int tupleOffset);
 static bool _bt_steppage(IndexScanDesc scan, ScanDirection dir);
 static bool _bt_readnextpage(IndexScanDesc scan, BlockNumber blkno, ScanDirection dir);
 static bool _bt_parallel_readpage(IndexScanDesc scan, BlockNumber blkno,
@@ -37,6 +44,12 @@ static Buffer _bt_walk_left(Relation rel, Buffer buf, Snapshot snapshot);
 static bool _bt_endpoint(IndexScanDesc scan, ScanDirection dir);
 static void _bt_drop_lock_and_maybe_pin(IndexScanDesc scan, BTScanPos sp);
 static inline void _bt_initialize_more_data(BTScanOpaque so, ScanDirection dir);
+static void _bt_make_insertion_key(Relation rel, ScanKey cur, ScanKey ikey);
+static void _bt_skip_setup(IndexScanDesc scan, ScanDirection dir);
+static int	_bt_skip_check(IndexScanDesc scan, Page page, OffsetNumber offnum);
+static Buffer _bt_skip_descend(IndexScanDesc scan, OffsetNumber *offnum);
+static bool _bt_skip_sameprefix(IndexScanDesc scan, ScanKey skey, int prefix,
+					IndexTuple itup);
 
 
 /*
@@ -570,6 +583,9 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 	if (!so->qual_ok)
 		return false;
 
+	/* Work out whether the scan can skip over uninteresting leaf pages */
+	_bt_skip_setup(scan, dir);
+
 	/*
 	 * For parallel scans, get the starting page from shared state. If the
 	 * scan has not started, proceed to find out first leaf page in the usual
@@ -878,55 +894,9 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 		{
 			/*
 			 * Ordinary comparison key.  Transform the search-style scan key
-			 * to an insertion scan key by replacing the sk_func with the
-			 * appropriate btree comparison function.
-			 *
-			 * If scankey operator is not a cross-type comparison, we can use
-			 * the cached comparison function; otherwise gotta look it up in
-			 * the catalogs.  (That can't lead to infinite recursion, since no
-			 * indexscan initiated by syscache lookup will use cross-data-type
-			 * operators.)
-			 *
-			 * We support the convention that sk_subtype == InvalidOid means
-			 * the opclass input type; this is a hack to simplify life for
-			 * ScanKeyInit().
+			 * to an insertion scan key.
 			 */
-			if (cur->sk_subtype == rel->rd_opcintype[i] ||
-				cur->sk_subtype == InvalidOid)
-			{
-				FmgrInfo   *procinfo;
-
-				procinfo = index_getprocinfo(rel, cur->sk_attno, BTORDER_PROC);
-				ScanKeyEntryInitializeWithInfo(scankeys + i,
-											   cur->sk_flags,
-											   cur->sk_attno,
-											   InvalidStrategy,
-											   cur->sk_subtype,
-											   cur->sk_collation,
-											   procinfo,
-											   cur->sk_argument);
-			}
-			else
-			{
-				RegProcedure cmp_proc;
-
-				cmp_proc = get_opfamily_proc(rel->rd_opfamily[i],
-											 rel->rd_opcintype[i],
-											 cur->sk_subtype,
-											 BTORDER_PROC);
-				if (!RegProcedureIsValid(cmp_proc))
-					elog(ERROR, "missing support function %d(%u,%u) for attribute %d of index \"%s\"",
-						 BTORDER_PROC, rel->rd_opcintype[i], cur->sk_subtype,
-						 cur->sk_attno, RelationGetRelationName(rel));
-				ScanKeyEntryInitialize(scankeys + i,
-									   cur->sk_flags,
-									   cur->sk_attno,
-									   InvalidStrategy,
-									   cur->sk_subtype,
-									   cur->sk_collation,
-									   cmp_proc,
-									   cur->sk_argument);
-			}
+			_bt_make_insertion_key(rel, cur, scankeys + i);
 		}
 	}
 
@@ -1111,6 +1081,65 @@ readcomplete:
 	return true;
 }
 
+/*
+ * _bt_make_insertion_key() -- build an insertion scankey from a search key
+ *
+ * cur must be an ordinary (not row-comparison) search-style scan key; ikey is
+ * filled in with the same comparison data, but with sk_func replaced by the
+ * appropriate btree comparison function.
+ */
+static void
+_bt_make_insertion_key(Relation rel, ScanKey cur, ScanKey ikey)
+{
+	int			i = cur->sk_attno - 1;
+
+	/*
+	 * If scankey operator is not a cross-type comparison, we can use the
+	 * cached comparison function; otherwise gotta look it up in the catalogs.
+	 * (That can't lead to infinite recursion, since no indexscan initiated by
+	 * syscache lookup will use cross-data-type operators.)
+	 *
+	 * We support the convention that sk_subtype == InvalidOid means the
+	 * opclass input type; this is a hack to simplify life for ScanKeyInit().
+	 */
+	if (cur->sk_subtype == rel->rd_opcintype[i] ||
+		cur->sk_subtype == InvalidOid)
+	{
+		FmgrInfo   *procinfo;
+
+		procinfo = index_getprocinfo(rel, cur->sk_attno, BTORDER_PROC);
+		ScanKeyEntryInitializeWithInfo(ikey,
+									   cur->sk_flags,
+									   cur->sk_attno,
+									   InvalidStrategy,
+									   cur->sk_subtype,
+									   cur->sk_collation,
+									   procinfo,
+									   cur->sk_argument);
+	}
+	else
+	{
+		RegProcedure cmp_proc;
+
+		cmp_proc = get_opfamily_proc(rel->rd_opfamily[i],
+									 rel->rd_opcintype[i],
+									 cur->sk_subtype,
+									 BTORDER_PROC);
+		if (!RegProcedureIsValid(cmp_proc))
+			elog(ERROR, "missing support function %d(%u,%u) for attribute %d of index \"%s\"",
+				 BTORDER_PROC, rel->rd_opcintype[i], cur->sk_subtype,
+				 cur->sk_attno, RelationGetRelationName(rel));
+		ScanKeyEntryInitialize(ikey,
+							   cur->sk_flags,
+							   cur->sk_attno,
+							   InvalidStrategy,
+							   cur->sk_subtype,
+							   cur->sk_collation,
+							   cmp_proc,
+							   cur->sk_argument);
+	}
+}
+
 /*
  *	_bt_next() -- Get the next item in a scan.
  *
@@ -1236,6 +1265,9 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	/* initialize tuple workspace to empty */
 	so->currPos.nextTupleOffset = 0;
 
+	/* no skip target until we've looked at the page */
+	so->skipTarget = BTSKIP_NONE;
+
 	/*
 	 * Now that the current page has been made consistent, the macro should be
 	 * good.
@@ -1255,8 +1287,31 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			if (itup != NULL)
 			{
 				/* tuple passes all scan key conditions, so remember it */
-				_bt_saveitem(so, itemIndex, offnum, itup);
-				itemIndex++;
+				if (!BTreeTupleIsPosting(itup))
+				{
+					_bt_saveitem(so, itemIndex, offnum, itup);
+					itemIndex++;
+				}
+				else
+				{
+					int			nposting = BTreeTupleGetNPosting(itup);
+					int			tupleOffset;
+					int			i;
+
+					/* one item per heap TID, all sharing the key */
+					tupleOffset =
+						_bt_setuppostingitems(so, itemIndex, offnum,
+											  BTreeTupleGetPostingN(itup, 0),
+											  itup);
+					itemIndex++;
+					for (i = 1; i < nposting; i++)
+					{
+						_bt_savepostingitem(so, itemIndex, offnum,
+											BTreeTupleGetPostingN(itup, i),
+											tupleOffset);
+						itemIndex++;
+					}
+				}
 			}
 			if (!continuescan)
 			{
@@ -1268,15 +1323,23 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			offnum = OffsetNumberNext(offnum);
 		}
 
-		Assert(itemIndex <= MaxIndexTuplesPerPage);
+		Assert(itemIndex <= MaxTIDsPerBTreePage);
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
+
+		/*
+		 * In a skip scan, see whether the next interesting tuples are known
+		 * to lie beyond our right sibling.
+		 */
+		if (so->skipScan && so->currPos.moreRight &&
+			!P_RIGHTMOST(opaque) && minoff <= maxoff)
+			so->skipTarget = _bt_skip_check(scan, page, maxoff);
 	}
 	else
 	{
 		/* load items[] in descending order */
-		itemIndex = MaxIndexTuplesPerPage;
+		itemIndex = MaxTIDsPerBTreePage;
 
 		offnum = Min(offnum, maxoff);
 
@@ -1286,8 +1349,34 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			if (itup != NULL)
 			{
 				/* tuple passes all scan key conditions, so remember it */
-				itemIndex--;
-				_bt_saveitem(so, itemIndex, offnum, itup);
+				if (!BTreeTupleIsPosting(itup))
+				{
+					itemIndex--;
+					_bt_saveitem(so, itemIndex, offnum, itup);
+				}
+				else
+				{
+					int			nposting = BTreeTupleGetNPosting(itup);
+					int			tupleOffset;
+					int			i;
+
+					/*
+					 * Return the heap TIDs in reverse order, as if they were
+					 * separate tuples.
+					 */
+					itemIndex--;
+					tupleOffset =
+						_bt_setuppostingitems(so, itemIndex, offnum,
+											  BTreeTupleGetPostingN(itup, nposting - 1),
+											  itup);
+					for (i = nposting - 2; i >= 0; i--)
+					{
+						itemIndex--;
+						_bt_savepostingitem(so, itemIndex, offnum,
+											BTreeTupleGetPostingN(itup, i),
+											tupleOffset);
+					}
+				}
 			}
 			if (!continuescan)
 			{
@@ -1301,8 +1390,8 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 
 		Assert(itemIndex >= 0);
 		so->currPos.firstItem = itemIndex;
-		so->currPos.lastItem = MaxIndexTuplesPerPage - 1;
-		so->currPos.itemIndex = MaxIndexTuplesPerPage - 1;
+		so->currPos.lastItem = MaxTIDsPerBTreePage - 1;
+		so->currPos.itemIndex = MaxTIDsPerBTreePage - 1;
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
@@ -1327,6 +1416,58 @@ _bt_saveitem(BTScanOpaque so, int itemIndex,
 	}
 }
 
+/*
+ * Set up so->currPos.items[itemIndex] for the given heap TID of a posting
+ * list tuple, and save a key-only copy of the tuple in currTuples for an
+ * index-only scan.  Returns the copy's offset in currTuples, which the
+ * tuple's remaining heap TIDs share (see _bt_savepostingitem).
+ */
+static int
+_bt_setuppostingitems(BTScanOpaque so, int itemIndex, OffsetNumber offnum,
+					  ItemPointer heapTid, IndexTuple itup)
+{
+	BTScanPosItem *currItem = &so->currPos.items[itemIndex];
+
+	Assert(BTreeTupleIsPosting(itup));
+
+	currItem->heapTid = *heapTid;
+	currItem->indexOffset = offnum;
+	if (so->currTuples)
+	{
+		Size		itupsz = BTreeTupleGetPostingOffset(itup);
+		IndexTuple	base;
+
+		currItem->tupleOffset = so->currPos.nextTupleOffset;
+		base = (IndexTuple) (so->currTuples + so->currPos.nextTupleOffset);
+		memcpy(base, itup, itupsz);
+		/* make the copy look like a plain tuple */
+		base->t_info &= ~(INDEX_SIZE_MASK | INDEX_ALT_TID_MASK);
+		base->t_info |= itupsz;
+		base->t_tid = *heapTid;
+		so->currPos.nextTupleOffset += MAXALIGN(itupsz);
+
+		return currItem->tupleOffset;
+	}
+
+	return 0;
+}
+
+/*
+ * Save another heap TID of the posting list tuple passed to the last
+ * _bt_setuppostingitems call into so->currPos.items[itemIndex].
+ */
+static inline void
+_bt_savepostingitem(BTScanOpaque so, int itemIndex, OffsetNumber offnum,
+					ItemPointer heapTid, int tupleOffset)
+{
+	BTScanPosItem *currItem = &so->currPos.items[itemIndex];
+
+	currItem->heapTid = *heapTid;
+	currItem->indexOffset = offnum;
+	if (so->currTuples)
+		currItem->tupleOffset = tupleOffset;
+}
+
 /*
  *	_bt_steppage() -- Step to next page containing valid data for scan
  *
@@ -1472,20 +1613,41 @@ _bt_readnextpage(IndexScanDesc scan, BlockNumber blkno, ScanDirection dir)
 			}
 			/* check for interrupts while we're not holding any buffer lock */
 			CHECK_FOR_INTERRUPTS();
-			/* step right one page */
-			so->currPos.buf = _bt_getbuf(rel, blkno, BT_READ);
-			page = BufferGetPage(so->currPos.buf);
-			TestForOldSnapshot(scan->xs_snapshot, rel, page);
-			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
-			/* check for deleted page */
-			if (!P_IGNORE(opaque))
+			if (so->skipTarget != BTSKIP_NONE)
 			{
-				PredicateLockPage(rel, blkno, scan->xs_snapshot);
-				/* see if there are any matches on this page */
-				/* note that this will clear moreRight if we can stop */
-				if (_bt_readpage(scan, dir, P_FIRSTDATAKEY(opaque)))
+				OffsetNumber offnum;
+
+				/* descend straight to the skip scan's next target */
+				so->currPos.buf = _bt_skip_descend(scan, &offnum);
+				if (!BufferIsValid(so->currPos.buf))
+				{
+					BTScanPosInvalidate(so->currPos);
+					return false;
+				}
+				page = BufferGetPage(so->currPos.buf);
+				opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+				PredicateLockPage(rel, BufferGetBlockNumber(so->currPos.buf),
+								  scan->xs_snapshot);
+				if (_bt_readpage(scan, dir, offnum))
 					break;
 			}
+			else
+			{
+				/* step right one page */
+				so->currPos.buf = _bt_getbuf(rel, blkno, BT_READ);
+				page = BufferGetPage(so->currPos.buf);
+				TestForOldSnapshot(scan->xs_snapshot, rel, page);
+				opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+				/* check for deleted page */
+				if (!P_IGNORE(opaque))
+				{
+					PredicateLockPage(rel, blkno, scan->xs_snapshot);
+					/* see if there are any matches on this page */
+					/* note that this will clear moreRight if we can stop */
+					if (_bt_readpage(scan, dir, P_FIRSTDATAKEY(opaque)))
+						break;
+				}
+			}
 
 			/* nope, keep going */
 			if (scan->parallel_scan != NULL)
@@ -1949,3 +2111,381 @@ _bt_initialize_more_data(BTScanOpaque so, ScanDirection dir)
 	so->numKilled = 0;			/* just paranoia */
 	so->markItemIndex = -1;		/* ditto */
 }
+
+/*
+ * _bt_skip_setup() -- decide whether a scan can skip leaf pages
+ *
+ * Called by _bt_first() once the scan keys have been preprocessed.  Without
+ * an "=" key on the first index column, keys on the second column can't be
+ * used to position the scan or to end it, so normally we'd have to read
+ * every leaf page in the range allowed by the first column's keys.  But the
+ * tuples sharing any one first-column value are stored together, sorted by
+ * the second column, so bounds on the second column tell us where the
+ * interesting part of each such group begins and ends.  Here we set up the
+ * insertion scankeys _bt_skip_check() needs to exploit that.
+ */
+static void
+_bt_skip_setup(IndexScanDesc scan, ScanDirection dir)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	ScanKey		lower = NULL;
+	ScanKey		upper = NULL;
+	int			i;
+
+	so->skipScan = false;
+	so->skipTarget = BTSKIP_NONE;
+
+	/*
+	 * We decide where to go next by looking at the high key of the page we're
+	 * leaving, so only forward scans can skip.  Parallel scans have to visit
+	 * pages in the order the shared state hands them out.  Serializable
+	 * transactions need predicate locks on all the leaf pages covering the
+	 * range they read, so they can't skip any either.
+	 */
+	if (!ScanDirectionIsForward(dir) ||
+		scan->parallel_scan != NULL ||
+		IsolationIsSerializable() ||
+		IndexRelationGetNumberOfKeyAttributes(rel) < 2)
+		return;
+
+	for (i = 0; i < so->numberOfKeys; i++)
+	{
+		ScanKey		cur = &so->keyData[i];
+
+		if (cur->sk_attno == 1)
+		{
+			/* an "=" (or IS NULL) key already confines the scan */
+			if (cur->sk_strategy == BTEqualStrategyNumber)
+				return;
+			continue;
+		}
+		if (cur->sk_attno > 2)
+			break;
+
+		/* we only use ordinary comparison keys on the second column */
+		if (cur->sk_flags & (SK_ISNULL | SK_ROW_HEADER))
+			continue;
+
+		switch (cur->sk_strategy)
+		{
+			case BTLessStrategyNumber:
+			case BTLessEqualStrategyNumber:
+				if (upper == NULL)
+					upper = cur;
+				break;
+			case BTEqualStrategyNumber:
+				/* override any non-equality choice */
+				lower = upper = cur;
+				break;
+			case BTGreaterEqualStrategyNumber:
+			case BTGreaterStrategyNumber:
+				if (lower == NULL)
+					lower = cur;
+				break;
+		}
+	}
+
+	if (lower == NULL && upper == NULL)
+		return;
+
+	/* the first column's key gets its argument from the tuple we skip from */
+	ScanKeyEntryInitializeWithInfo(&so->skipKeys[0],
+								   rel->rd_indoption[0] << SK_BT_INDOPTION_SHIFT,
+								   1,
+								   InvalidStrategy,
+								   InvalidOid,
+								   rel->rd_indcollation[0],
+								   index_getprocinfo(rel, 1, BTORDER_PROC),
+								   (Datum) 0);
+
+	so->skipHaveLower = (lower != NULL);
+	if (lower != NULL)
+	{
+		_bt_make_insertion_key(rel, lower, &so->skipKeys[1]);
+		so->skipLowerStrict = (lower->sk_strategy == BTGreaterStrategyNumber);
+	}
+	so->skipHaveUpper = (upper != NULL);
+	if (upper != NULL)
+	{
+		_bt_make_insertion_key(rel, upper, &so->skipKeys[2]);
+		so->skipUpperStrict = (upper->sk_strategy == BTLessStrategyNumber);
+	}
+
+	if (so->skipTuple == NULL)
+		so->skipTuple = (IndexTuple) palloc(BLCKSZ);
+
+	so->skipScan = true;
+}
+
+/*
+ * _bt_skip_check() -- choose where a skip scan goes after this page
+ *
+ * offnum is the last data item on the page, which the caller has just read
+ * and still holds locked.  If that tuple lies before the lower bound on the
+ * second column, we want the first tuple at that bound with the same
+ * first-column value; if it lies beyond the upper bound, we want the first
+ * tuple with a greater first-column value.  Either way, if the page's high
+ * key shows that the target can't be on the right sibling, we return the
+ * BTSKIP_xxx code telling _bt_readnextpage() to descend to it, and save a
+ * copy of the tuple for _bt_skip_descend().
+ */
+static int
+_bt_skip_check(IndexScanDesc scan, Page page, OffsetNumber offnum)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	IndexTuple	itup;
+	ScanKeyData keys[2];
+	int			target = BTSKIP_NONE;
+	int			keysz = 0;
+	int32		cmpval = 1;
+	int32		result;
+	bool		isnull;
+
+	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+
+	keys[0] = so->skipKeys[0];
+	keys[0].sk_argument = index_getattr(itup, 1, RelationGetDescr(rel),
+										&isnull);
+	if (isnull)
+		keys[0].sk_flags |= SK_ISNULL;
+
+	if (so->skipHaveLower)
+	{
+		keys[1] = so->skipKeys[1];
+		result = _bt_compare(rel, 2, keys, page, offnum);
+		if (result > 0 || (result == 0 && so->skipLowerStrict))
+		{
+			target = BTSKIP_LOWER;
+			keysz = 2;
+			cmpval = so->skipLowerStrict ? 0 : 1;
+		}
+	}
+	if (target == BTSKIP_NONE && so->skipHaveUpper)
+	{
+		keys[1] = so->skipKeys[2];
+		result = _bt_compare(rel, 2, keys, page, offnum);
+		if (result < 0 || (result == 0 && so->skipUpperStrict))
+		{
+			target = BTSKIP_NEXTPREFIX;
+			keysz = 1;
+			cmpval = 0;
+		}
+	}
+	if (target == BTSKIP_NONE)
+		return BTSKIP_NONE;
+
+	/*
+	 * Just step right if the target might be on the right sibling.  This is
+	 * the same test _bt_moveright() uses to decide whether to move right.
+	 */
+	if (_bt_compare(rel, keysz, keys, page, P_HIKEY) < cmpval)
+		return BTSKIP_NONE;
+
+	memcpy(so->skipTuple, itup, IndexTupleSize(itup));
+
+	return target;
+}
+
+/*
+ * _bt_skip_descend() -- descend to the target chosen by _bt_skip_check()
+ *
+ * Returns the read-locked leaf page on which the target lies, setting
+ * *offnum to the first item at or beyond it; or InvalidBuffer if the index
+ * has somehow become empty.
+ */
+static Buffer
+_bt_skip_descend(IndexScanDesc scan, OffsetNumber *offnum)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	ScanKeyData keys[2];
+	int			keysz;
+	bool		nextkey;
+	bool		isnull;
+	BTStack		stack;
+	Buffer		buf;
+
+	keys[0] = so->skipKeys[0];
+	keys[0].sk_argument = index_getattr(so->skipTuple, 1,
+										RelationGetDescr(rel), &isnull);
+	if (isnull)
+		keys[0].sk_flags |= SK_ISNULL;
+
+	if (so->skipTarget == BTSKIP_LOWER)
+	{
+		keys[1] = so->skipKeys[1];
+		keysz = 2;
+		nextkey = so->skipLowerStrict;
+	}
+	else
+	{
+		Assert(so->skipTarget == BTSKIP_NEXTPREFIX);
+		keysz = 1;
+		nextkey = true;
+	}
+	so->skipTarget = BTSKIP_NONE;
+
+	stack = _bt_search(rel, keysz, keys, nextkey, &buf, BT_READ,
+					   scan->xs_snapshot);
+	_bt_freestack(stack);
+
+	if (BufferIsValid(buf))
+		*offnum = _bt_binsrch(rel, buf, keysz, keys, nextkey);
+
+	return buf;
+}
+
+/*
+ *	_bt_skip() -- Skip past the items sharing a key prefix with the current one
+ *
+ *		On entry, so->currPos is valid and its itemIndex identifies the item
+ *		most recently returned.  We position the scan so that the next
+ *		_bt_next() call returns the first matching item whose leading
+ *		"prefix" key columns differ from those of that item.  If the rest of
+ *		the current page doesn't have one, we descend the tree afresh rather
+ *		than read through all the intervening leaf pages.
+ *
+ *		We need the current item's key values, which we only keep for
+ *		index-only scans; other scans are left where they are, as are scans
+ *		with array keys or a mark, and parallel scans, which have their own
+ *		notions of where to go next.
+ *
+ *		Returns false, with no pins held, if there are no more matching items.
+ */
+bool
+_bt_skip(IndexScanDesc scan, ScanDirection dir, int prefix)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	IndexTuple	itup;
+	ScanKey		skey;
+	BTStack		stack;
+	Buffer		buf;
+	OffsetNumber offnum;
+	bool		nextkey;
+	int			i;
+
+	Assert(BTScanPosIsValid(so->currPos));
+
+	if (so->currTuples == NULL || so->numArrayKeys != 0 ||
+		scan->parallel_scan != NULL || so->markItemIndex >= 0)
+		return true;
+
+	itup = (IndexTuple)
+		(so->currTuples + so->currPos.items[so->currPos.itemIndex].tupleOffset);
+	skey = _bt_mkscankey(rel, itup);
+
+	/* First try the items we've already loaded from the current page */
+	if (ScanDirectionIsForward(dir))
+	{
+		for (i = so->currPos.itemIndex + 1; i <= so->currPos.lastItem; i++)
+		{
+			itup = (IndexTuple)
+				(so->currTuples + so->currPos.items[i].tupleOffset);
+			if (!_bt_skip_sameprefix(scan, skey, prefix, itup))
+			{
+				so->currPos.itemIndex = i - 1;
+				_bt_freeskey(skey);
+				return true;
+			}
+		}
+	}
+	else
+	{
+		for (i = so->currPos.itemIndex - 1; i >= so->currPos.firstItem; i--)
+		{
+			itup = (IndexTuple)
+				(so->currTuples + so->currPos.items[i].tupleOffset);
+			if (!_bt_skip_sameprefix(scan, skey, prefix, itup))
+			{
+				so->currPos.itemIndex = i + 1;
+				_bt_freeskey(skey);
+				return true;
+			}
+		}
+	}
+
+	/* Before leaving current page, deal with any killed items */
+	if (so->numKilled > 0)
+		_bt_killitems(scan);
+	BTScanPosUnpinIfPinned(so->currPos);
+	BTScanPosInvalidate(so->currPos);
+
+	/*
+	 * Descend to the first item beyond the prefix, or in a backward scan to
+	 * the last item before it.  skey still points into currTuples, which is
+	 * not overwritten until _bt_readpage() below.
+	 */
+	nextkey = ScanDirectionIsForward(dir);
+	stack = _bt_search(rel, prefix, skey, nextkey, &buf, BT_READ,
+					   scan->xs_snapshot);
+	_bt_freestack(stack);
+
+	if (!BufferIsValid(buf))
+	{
+		_bt_freeskey(skey);
+		return false;
+	}
+
+	PredicateLockPage(rel, BufferGetBlockNumber(buf), scan->xs_snapshot);
+	_bt_initialize_more_data(so, dir);
+	offnum = _bt_binsrch(rel, buf, prefix, skey, nextkey);
+	_bt_freeskey(skey);
+	if (!nextkey)
+		offnum = OffsetNumberPrev(offnum);
+
+	so->currPos.buf = buf;
+	if (!_bt_readpage(scan, dir, offnum))
+	{
+		LockBuffer(so->currPos.buf, BUFFER_LOCK_UNLOCK);
+		if (!_bt_steppage(scan, dir))
+			return false;
+	}
+	else
+		_bt_drop_lock_and_maybe_pin(scan, &so->currPos);
+
+	/* Back up one, so that the next _bt_next() returns the first item */
+	if (ScanDirectionIsForward(dir))
+		so->currPos.itemIndex--;
+	else
+		so->currPos.itemIndex++;
+
+	return true;
+}
+
+/*
+ * _bt_skip_sameprefix() -- does itup match skey on the first prefix columns?
+ */
+static bool
+_bt_skip_sameprefix(IndexScanDesc scan, ScanKey skey, int prefix,
+					IndexTuple itup)
+{
+	TupleDesc	itupdesc = RelationGetDescr(scan->indexRelation);
+	int			i;
+
+	for (i = 0; i < prefix; i++)
+	{
+		ScanKey		key = &skey[i];
+		Datum		datum;
+		bool		isNull;
+
+		datum = index_getattr(itup, key->sk_attno, itupdesc, &isNull);
+
+		if (key->sk_flags & SK_ISNULL)
+		{
+			if (!isNull)
+				return false;
+		}
+		else if (isNull)
+			return false;
+		else if (DatumGetInt32(FunctionCall2Coll(&key->sk_func,
+												 key->sk_collation,
+												 key->sk_argument,
+												 datum)) != 0)
+			return false;
+	}
+
+	return true;
+}
@@ -135,6 +135,8 @@ static void _bt_sortaddtup(Page page, Size itemsize,
 			   IndexTuple itup, OffsetNumber itup_off);
 static void _bt_buildadd(BTWriteState *wstate, BTPageState *state,
 			 IndexTuple itup);
+static void _bt_buildadd_posting(BTWriteState *wstate, BTPageState *state,
+					 IndexTuple base, ItemPointer htids, int nhtids);
 static void _bt_uppershutdown(BTWriteState *wstate, BTPageState *state);
 static void _bt_load(BTWriteState *wstate,
 		 BTSpool *btspool, BTSpool *btspool2);
@@ -344,8 +346,7 @@ _bt_pagestate(BTWriteState *wstate, uint32 level)
 	if (level > 0)
 		state->btps_full = (BLCKSZ * (100 - BTREE_NONLEAF_FILLFACTOR) / 100);
 	else
-		state->btps_full = RelationGetTargetPageFreeSpace(wstate->index,
-														  BTREE_DEFAULT_FILLFACTOR);
+		state->btps_full = BTGetTargetPageFreeSpace(wstate->index);
 	/* no parent level, yet */
 	state->btps_next = NULL;
 
@@ -510,6 +511,7 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 		ItemId		ii;
 		ItemId		hii;
 		IndexTuple	oitup;
+		IndexTuple	keytup = NULL;
 
 		/* Create new page of same level */
 		npage = _bt_blnewpage(state->btps_level);
@@ -537,6 +539,20 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 		ItemIdSetUnused(ii);	/* redundant */
 		((PageHeader) opage)->pd_lower -= sizeof(ItemIdData);
 
+		/*
+		 * The high key and the new page's downlink need only the key, so a
+		 * posting list tuple is replaced by a plain tuple there.
+		 */
+		if (BTreeTupleIsPosting(oitup))
+		{
+			keytup = _bt_form_posting(oitup, BTreeTupleGetHeapTID(oitup), 1);
+			if (!PageIndexTupleOverwrite(opage, P_HIKEY, (Item) keytup,
+										 IndexTupleSize(keytup)))
+				elog(ERROR, "failed to rewrite high key in index \"%s\"",
+					 RelationGetRelationName(wstate->index));
+			oitup = keytup;
+		}
+
 		/*
 		 * Link the old page into its parent, using its minimum key. If we
 		 * don't have a parent, we have to create one; this adds a new btree
@@ -556,6 +572,8 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 		 * level.
 		 */
 		state->btps_minkey = CopyIndexTuple(oitup);
+		if (keytup)
+			pfree(keytup);
 
 		/*
 		 * Set the sibling links for both pages.
@@ -590,7 +608,12 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	if (last_off == P_HIKEY)
 	{
 		Assert(state->btps_minkey == NULL);
-		state->btps_minkey = CopyIndexTuple(itup);
+		if (BTreeTupleIsPosting(itup))
+			state->btps_minkey = _bt_form_posting(itup,
+												  BTreeTupleGetHeapTID(itup),
+												  1);
+		else
+			state->btps_minkey = CopyIndexTuple(itup);
 	}
 
 	/*
@@ -604,6 +627,27 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	state->btps_lastoff = last_off;
 }
 
+/*
+ * add a tuple with base's key and the given heap TIDs to the leaf level,
+ * as a posting list tuple if there is more than one TID.
+ */
+static void
+_bt_buildadd_posting(BTWriteState *wstate, BTPageState *state,
+					 IndexTuple base, ItemPointer htids, int nhtids)
+{
+	IndexTuple	itup;
+
+	if (nhtids == 1)
+	{
+		_bt_buildadd(wstate, state, base);
+		return;
+	}
+
+	itup = _bt_form_posting(base, htids, nhtids);
+	_bt_buildadd(wstate, state, itup);
+	pfree(itup);
+}
+
 /*
  * Finish writing out the completed btree.
  */
@@ -683,7 +727,7 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 	bool		load1;
 	TupleDesc	tupdes = RelationGetDescr(wstate->index);
 	int			i,
-				keysz = RelationGetNumberOfAttributes(wstate->index);
+				keysz = IndexRelationGetNumberOfKeyAttributes(wstate->index);
 	ScanKey		indexScanKey = NULL;
 	SortSupport sortKeys;
 
@@ -781,6 +825,50 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 		}
 		pfree(sortKeys);
 	}
+	else if (BTDeduplicationAllowed(wstate->index))
+	{
+		/*
+		 * merge is unnecessary, but merge runs of equal keys into posting
+		 * lists
+		 */
+		IndexTuple	base = NULL;
+		ItemPointer htids;
+		int			nhtids = 0;
+
+		htids = (ItemPointer) palloc(BT_OFFSET_MASK * sizeof(ItemPointerData));
+
+		while ((itup = tuplesort_getindextuple(btspool->sortstate,
+											   true)) != NULL)
+		{
+			/* When we see first tuple, create first index page */
+			if (state == NULL)
+				state = _bt_pagestate(wstate, 0);
+
+			if (base != NULL &&
+				_bt_dedup_equal(base, itup) &&
+				_bt_dedup_fits(base, nhtids + 1))
+			{
+				htids[nhtids++] = itup->t_tid;
+				continue;
+			}
+
+			if (base != NULL)
+			{
+				_bt_buildadd_posting(wstate, state, base, htids, nhtids);
+				pfree(base);
+			}
+			base = CopyIndexTuple(itup);
+			htids[0] = itup->t_tid;
+			nhtids = 1;
+		}
+
+		if (base != NULL)
+		{
+			_bt_buildadd_posting(wstate, state, base, htids, nhtids);
+			pfree(base);
+		}
+		pfree(htids);
+	}
 	else
 	{
 		/* merge is unnecessary */
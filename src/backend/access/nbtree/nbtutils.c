@@ -49,6 +49,7 @@ static void _bt_mark_scankey_required(ScanKey skey);
 static bool _bt_check_rowcompare(ScanKey skey,
 					 IndexTuple tuple, TupleDesc tupdesc,
 					 ScanDirection dir, bool *continuescan);
+static int	_bt_int_cmp(const void *a, const void *b);
 
 
 /*
@@ -63,17 +64,17 @@ _bt_mkscankey(Relation rel, IndexTuple itup)
 {
 	ScanKey		skey;
 	TupleDesc	itupdesc;
-	int			natts;
+	int			indnkeyatts;
 	int16	   *indoption;
 	int			i;
 
 	itupdesc = RelationGetDescr(rel);
-	natts = RelationGetNumberOfAttributes(rel);
+	indnkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
 	indoption = rel->rd_indoption;
 
-	skey = (ScanKey) palloc(natts * sizeof(ScanKeyData));
+	skey = (ScanKey) palloc(indnkeyatts * sizeof(ScanKeyData));
 
-	for (i = 0; i < natts; i++)
+	for (i = 0; i < indnkeyatts; i++)
 	{
 		FmgrInfo   *procinfo;
 		Datum		arg;
@@ -115,16 +116,16 @@ ScanKey
 _bt_mkscankey_nodata(Relation rel)
 {
 	ScanKey		skey;
-	int			natts;
+	int			indnkeyatts;
 	int16	   *indoption;
 	int			i;
 
-	natts = RelationGetNumberOfAttributes(rel);
+	indnkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
 	indoption = rel->rd_indoption;
 
-	skey = (ScanKey) palloc(natts * sizeof(ScanKeyData));
+	skey = (ScanKey) palloc(indnkeyatts * sizeof(ScanKeyData));
 
-	for (i = 0; i < natts; i++)
+	for (i = 0; i < indnkeyatts; i++)
 	{
 		FmgrInfo   *procinfo;
 		int			flags;
@@ -1697,6 +1698,22 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, TupleDesc tupdesc,
 	return result;
 }
 
+/*
+ * qsort comparator for killedItems[] entries
+ */
+static int
+_bt_int_cmp(const void *a, const void *b)
+{
+	int			ia = *(const int *) a;
+	int			ib = *(const int *) b;
+
+	if (ia < ib)
+		return -1;
+	if (ia > ib)
+		return 1;
+	return 0;
+}
+
 /*
  * _bt_killitems - set LP_DEAD state for items an indexscan caller has
  * told us were killed
@@ -1711,9 +1728,11 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, TupleDesc tupdesc,
  *
  * We match items by heap TID before assuming they are the right ones to
  * delete.  We cope with cases where items have moved right due to insertions.
- * If an item has moved off the current page due to a split, we'll fail to
- * find it and do nothing (this is not an error case --- we assume the item
- * will eventually get marked in a future indexscan).
+ * If an item has moved off the current page due to a split, or has moved
+ * left because the page was deduplicated, we'll fail to find it and do
+ * nothing (this is not an error case --- we assume the item will eventually
+ * get marked in a future indexscan).  A posting list tuple is only marked
+ * if all of its heap TIDs were killed.
  *
  * Note that if we hold a pin on the target page continuously from initially
  * reading the items until applying this function, VACUUM cannot have deleted
@@ -1786,6 +1805,24 @@ _bt_killitems(IndexScanDesc scan)
 	minoff = P_FIRSTDATAKEY(opaque);
 	maxoff = PageGetMaxOffsetNumber(page);
 
+	/*
+	 * Put the killed items into items[] order, and get rid of any that were
+	 * entered more than once.  The heap TIDs of a posting list tuple then
+	 * appear in the same order as in the tuple itself.
+	 */
+	if (numKilled > 1)
+	{
+		int			nunique = 1;
+
+		qsort(so->killedItems, numKilled, sizeof(int), _bt_int_cmp);
+		for (i = 1; i < numKilled; i++)
+		{
+			if (so->killedItems[i] != so->killedItems[nunique - 1])
+				so->killedItems[nunique++] = so->killedItems[i];
+		}
+		numKilled = nunique;
+	}
+
 	for (i = 0; i < numKilled; i++)
 	{
 		int			itemIndex = so->killedItems[i];
@@ -1801,12 +1838,55 @@ _bt_killitems(IndexScanDesc scan)
 			ItemId		iid = PageGetItemId(page, offnum);
 			IndexTuple	ituple = (IndexTuple) PageGetItem(page, iid);
 
-			if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
+			if (!BTreeTupleIsPosting(ituple))
 			{
-				/* found the item */
-				ItemIdMarkDead(iid);
-				killedsomething = true;
-				break;			/* out of inner search loop */
+				if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
+				{
+					/* found the item */
+					ItemIdMarkDead(iid);
+					killedsomething = true;
+					break;		/* out of inner search loop */
+				}
+			}
+			else
+			{
+				/*
+				 * A posting list tuple can only be marked dead if every one
+				 * of its heap TIDs was killed.  Those must be the next
+				 * entries in killedItems[], in order.
+				 */
+				int			nposting = BTreeTupleGetNPosting(ituple);
+				int			pi = i;
+				int			j;
+
+				for (j = 0; j < nposting && pi < numKilled; j++)
+				{
+					BTScanPosItem *pitem =
+					&so->currPos.items[so->killedItems[pi]];
+
+					if (!ItemPointerEquals(BTreeTupleGetPostingN(ituple, j),
+										   &pitem->heapTid))
+						break;
+					pi++;
+				}
+				if (j == nposting)
+				{
+					ItemIdMarkDead(iid);
+					killedsomething = true;
+					/* skip over the entries we just used up */
+					i = pi - 1;
+					break;		/* out of inner search loop */
+				}
+
+				/* stop if the item is in this tuple but others are live */
+				for (j = 0; j < nposting; j++)
+				{
+					if (ItemPointerEquals(BTreeTupleGetPostingN(ituple, j),
+										  &kitem->heapTid))
+						break;
+				}
+				if (j < nposting)
+					break;		/* out of inner search loop */
 			}
 			offnum = OffsetNumberNext(offnum);
 		}
@@ -2041,7 +2121,30 @@ BTreeShmemInit(void)
 bytea *
 btoptions(Datum reloptions, bool validate)
 {
-	return default_reloptions(reloptions, validate, RELOPT_KIND_BTREE);
+	relopt_value *options;
+	BTOptions  *rdopts;
+	int			numoptions;
+	static const relopt_parse_elt tab[] = {
+		{"fillfactor", RELOPT_TYPE_INT, offsetof(BTOptions, fillfactor)},
+		{"deduplicate_items", RELOPT_TYPE_BOOL,
+		offsetof(BTOptions, deduplicate_items)}
+	};
+
+	options = parseRelOptions(reloptions, validate, RELOPT_KIND_BTREE,
+							  &numoptions);
+
+	/* if none set, we're done */
+	if (numoptions == 0)
+		return NULL;
+
+	rdopts = allocateReloptStruct(sizeof(BTOptions), options, numoptions);
+
+	fillRelOptions((void *) rdopts, sizeof(BTOptions), options, numoptions,
+				   validate, tab, lengthof(tab));
+
+	pfree(options);
+
+	return (bytea *) rdopts;
 }
 
 /*
@@ -206,6 +206,7 @@ btree_xlog_split(bool onleft, XLogReaderState *record)
 	Size		datalen;
 	Item		left_hikey = NULL;
 	Size		left_hikeysz = 0;
+	IndexTuple	left_keytup = NULL;
 	BlockNumber leftsib;
 	BlockNumber rightsib;
 	BlockNumber rnext;
@@ -246,9 +247,21 @@ btree_xlog_split(bool onleft, XLogReaderState *record)
 	if (isleaf)
 	{
 		ItemId		hiItemId = PageGetItemId(rpage, P_FIRSTDATAKEY(ropaque));
+		IndexTuple	firstright = (IndexTuple) PageGetItem(rpage, hiItemId);
 
-		left_hikey = PageGetItem(rpage, hiItemId);
-		left_hikeysz = ItemIdGetLength(hiItemId);
+		/* _bt_split() uses only the key of a posting list tuple */
+		if (BTreeTupleIsPosting(firstright))
+		{
+			left_keytup = _bt_form_posting(firstright,
+										   BTreeTupleGetHeapTID(firstright), 1);
+			left_hikey = (Item) left_keytup;
+			left_hikeysz = IndexTupleSize(left_keytup);
+		}
+		else
+		{
+			left_hikey = (Item) firstright;
+			left_hikeysz = ItemIdGetLength(hiItemId);
+		}
 	}
 
 	PageSetLSN(rpage, lsn);
@@ -356,6 +369,9 @@ btree_xlog_split(bool onleft, XLogReaderState *record)
 		UnlockReleaseBuffer(lbuf);
 	UnlockReleaseBuffer(rbuf);
 
+	if (left_keytup)
+		pfree(left_keytup);
+
 	/*
 	 * Fix left-link of the page to the right of the new right sibling.
 	 *
@@ -383,6 +399,37 @@ btree_xlog_split(bool onleft, XLogReaderState *record)
 	}
 }
 
+static void
+btree_xlog_dedup(XLogReaderState *record)
+{
+	XLogRecPtr	lsn = record->EndRecPtr;
+	Buffer		buffer;
+
+	if (XLogReadBufferForRedo(record, 0, &buffer) == BLK_NEEDS_REDO)
+	{
+		Page		page = (Page) BufferGetPage(buffer);
+		BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+		Page		newpage;
+
+		/*
+		 * Deduplication is a deterministic function of the page contents, so
+		 * doing it again yields exactly what the primary produced.
+		 */
+		newpage = _bt_dedup_page(page);
+		if (newpage == NULL)
+			elog(PANIC, "btree_xlog_dedup: nothing to deduplicate");
+		PageRestoreTempPage(newpage, page);
+
+		/* as in _bt_dedup_one_page() */
+		opaque->btpo_flags &= ~BTP_HAS_GARBAGE;
+
+		PageSetLSN(page, lsn);
+		MarkBufferDirty(buffer);
+	}
+	if (BufferIsValid(buffer))
+		UnlockReleaseBuffer(buffer);
+}
+
 static void
 btree_xlog_vacuum(XLogReaderState *record)
 {
@@ -482,14 +529,29 @@ btree_xlog_vacuum(XLogReaderState *record)
 
 		if (len > 0)
 		{
+			xl_btree_vacuum *xlrec = (xl_btree_vacuum *) XLogRecGetData(record);
 			OffsetNumber *unused;
-			OffsetNumber *unend;
+			OffsetNumber *updatable;
+			char	   *updated;
+			int			i;
 
 			unused = (OffsetNumber *) ptr;
-			unend = (OffsetNumber *) ((char *) ptr + len);
+			updatable = unused + xlrec->ndeleted;
+			updated = (char *) (updatable + xlrec->nupdated);
+
+			/* replace partially dead posting list tuples first */
+			for (i = 0; i < xlrec->nupdated; i++)
+			{
+				Size		itemsz = MAXALIGN(IndexTupleSize(updated));
 
-			if ((unend - unused) > 0)
-				PageIndexMultiDelete(page, unused, unend - unused);
+				if (!PageIndexTupleOverwrite(page, updatable[i],
+											 (Item) updated, itemsz))
+					elog(PANIC, "failed to update partially dead item");
+				updated += itemsz;
+			}
+
+			if (xlrec->ndeleted > 0)
+				PageIndexMultiDelete(page, unused, xlrec->ndeleted);
 		}
 
 		/*
@@ -536,6 +598,8 @@ btree_xlog_delete_get_latestRemovedXid(XLogReaderState *record)
 	OffsetNumber hoffnum;
 	TransactionId latestRemovedXid = InvalidTransactionId;
 	int			i;
+	int			j;
+	int			nhtids;
 
 	/*
 	 * If there's nothing running on the standby we don't need to derive a
@@ -589,62 +653,76 @@ btree_xlog_delete_get_latestRemovedXid(XLogReaderState *record)
 		itup = (IndexTuple) PageGetItem(ipage, iitemid);
 
 		/*
-		 * Locate the heap page that the index tuple points at
+		 * A posting list tuple points at several heap tuples; consider
+		 * them all.
 		 */
-		hblkno = ItemPointerGetBlockNumber(&(itup->t_tid));
-		hbuffer = XLogReadBufferExtended(xlrec->hnode, MAIN_FORKNUM, hblkno, RBM_NORMAL);
-		if (!BufferIsValid(hbuffer))
+		nhtids = BTreeTupleIsPosting(itup) ? BTreeTupleGetNPosting(itup) : 1;
+		for (j = 0; j < nhtids; j++)
 		{
-			UnlockReleaseBuffer(ibuffer);
-			return InvalidTransactionId;
-		}
-		LockBuffer(hbuffer, BT_READ);
-		hpage = (Page) BufferGetPage(hbuffer);
+			ItemPointer htid = BTreeTupleIsPosting(itup) ?
+			BTreeTupleGetPostingN(itup, j) : &itup->t_tid;
 
-		/*
-		 * Look up the heap tuple header that the index tuple points at by
-		 * using the heap node supplied with the xlrec. We can't use
-		 * heap_fetch, since it uses ReadBuffer rather than XLogReadBuffer.
-		 * Note that we are not looking at tuple data here, just headers.
-		 */
-		hoffnum = ItemPointerGetOffsetNumber(&(itup->t_tid));
-		hitemid = PageGetItemId(hpage, hoffnum);
+			/*
+			 * Locate the heap page that the index tuple points at
+			 */
+			hblkno = ItemPointerGetBlockNumber(htid);
+			hbuffer = XLogReadBufferExtended(xlrec->hnode, MAIN_FORKNUM,
+											 hblkno, RBM_NORMAL);
+			if (!BufferIsValid(hbuffer))
+			{
+				UnlockReleaseBuffer(ibuffer);
+				return InvalidTransactionId;
+			}
+			LockBuffer(hbuffer, BT_READ);
+			hpage = (Page) BufferGetPage(hbuffer);
 
-		/*
-		 * Follow any redirections until we find something useful.
-		 */
-		while (ItemIdIsRedirected(hitemid))
-		{
-			hoffnum = ItemIdGetRedirect(hitemid);
+			/*
+			 * Look up the heap tuple header that the index tuple points at
+			 * by using the heap node supplied with the xlrec. We can't use
+			 * heap_fetch, since it uses ReadBuffer rather than
+			 * XLogReadBuffer. Note that we are not looking at tuple data
+			 * here, just headers.
+			 */
+			hoffnum = ItemPointerGetOffsetNumber(htid);
 			hitemid = PageGetItemId(hpage, hoffnum);
-			CHECK_FOR_INTERRUPTS();
-		}
 
-		/*
-		 * If the heap item has storage, then read the header and use that to
-		 * set latestRemovedXid.
-		 *
-		 * Some LP_DEAD items may not be accessible, so we ignore them.
-		 */
-		if (ItemIdHasStorage(hitemid))
-		{
-			htuphdr = (HeapTupleHeader) PageGetItem(hpage, hitemid);
+			/*
+			 * Follow any redirections until we find something useful.
+			 */
+			while (ItemIdIsRedirected(hitemid))
+			{
+				hoffnum = ItemIdGetRedirect(hitemid);
+				hitemid = PageGetItemId(hpage, hoffnum);
+				CHECK_FOR_INTERRUPTS();
+			}
 
-			HeapTupleHeaderAdvanceLatestRemovedXid(htuphdr, &latestRemovedXid);
-		}
-		else if (ItemIdIsDead(hitemid))
-		{
 			/*
-			 * Conjecture: if hitemid is dead then it had xids before the xids
-			 * marked on LP_NORMAL items. So we just ignore this item and move
-			 * onto the next, for the purposes of calculating
-			 * latestRemovedxids.
+			 * If the heap item has storage, then read the header and use
+			 * that to set latestRemovedXid.
+			 *
+			 * Some LP_DEAD items may not be accessible, so we ignore them.
 			 */
-		}
-		else
-			Assert(!ItemIdIsUsed(hitemid));
+			if (ItemIdHasStorage(hitemid))
+			{
+				htuphdr = (HeapTupleHeader) PageGetItem(hpage, hitemid);
 
-		UnlockReleaseBuffer(hbuffer);
+				HeapTupleHeaderAdvanceLatestRemovedXid(htuphdr,
+													   &latestRemovedXid);
+			}
+			else if (ItemIdIsDead(hitemid))
+			{
+				/*
+				 * Conjecture: if hitemid is dead then it had xids before the
+				 * xids marked on LP_NORMAL items. So we just ignore this item
+				 * and move onto the next, for the purposes of calculating
+				 * latestRemovedxids.
+				 */
+			}
+			else
+				Assert(!ItemIdIsUsed(hitemid));
+
+			UnlockReleaseBuffer(hbuffer);
+		}
 	}
 
 	UnlockReleaseBuffer(ibuffer);
@@ -1001,6 +1079,9 @@ btree_redo(XLogReaderState *record)
 		case XLOG_BTREE_SPLIT_R:
 			btree_xlog_split(false, record);
 			break;
+		case XLOG_BTREE_DEDUP:
+			btree_xlog_dedup(record);
+			break;
 		case XLOG_BTREE_VACUUM:
 			btree_xlog_vacuum(record);
 			break;
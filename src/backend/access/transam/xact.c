@@ -188,6 +188,7 @@ typedef struct TransactionStateData
 	bool		prevXactReadOnly;	/* entry-time xact r/o state */
 	bool		startedInRecovery;	/* did we start in recovery? */
 	bool		didLogXid;		/* has xid been included in WAL record? */
+	bool		assigned;		/* top-level xid logged for this subxact? */
 	int			parallelModeLevel;	/* Enter/ExitParallelMode counter */
 	struct TransactionStateData *parent;	/* back link to parent */
 } TransactionStateData;
@@ -219,6 +220,7 @@ static TransactionStateData TopTransactionStateData = {
 	false,						/* entry-time xact r/o state */
 	false,						/* startedInRecovery */
 	false,						/* didLogXid */
+	false,						/* assigned */
 	0,							/* parallelMode */
 	NULL						/* link to parent state block */
 };
@@ -4521,6 +4523,43 @@ TransactionBlockStatusCode(void)
 	return 0;					/* keep compiler quiet */
 }
 
+/*
+ * IsSubTransactionAssignmentPending
+ *
+ * Returns true if the current subtransaction has an XID but has not yet
+ * written a WAL record carrying the XID of its top-level transaction.
+ * Logical decoding needs that association before the subtransaction
+ * commits in order to stream in-progress transactions, so it is only
+ * tracked with wal_level = logical.
+ */
+bool
+IsSubTransactionAssignmentPending(void)
+{
+	if (!XLogLogicalInfoActive())
+		return false;
+
+	if (!IsTransactionState() || !IsSubTransaction())
+		return false;
+
+	if (!TransactionIdIsValid(GetCurrentTransactionIdIfAny()))
+		return false;
+
+	return !CurrentTransactionState->assigned;
+}
+
+/*
+ * MarkSubTransactionAssigned
+ *
+ * Remember that the association with the top-level XID has been logged.
+ */
+void
+MarkSubTransactionAssigned(void)
+{
+	Assert(IsSubTransactionAssignmentPending());
+
+	CurrentTransactionState->assigned = true;
+}
+
 /*
  * IsSubTransaction
  */
@@ -34,6 +34,8 @@
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 #include "access/xloginsert.h"
+#include "access/xlogparallel.h"
+#include "access/xlogprefetch.h"
 #include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/catversion.h"
@@ -53,7 +55,9 @@
 #include "replication/snapbuild.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "replication/walsummarizer.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/large_object.h"
@@ -6932,6 +6936,12 @@ StartupXLOG(void)
 		/* Check that the GUCs used to generate the WAL allow recovery */
 		CheckRequiredParameterValues();
 
+		/*
+		 * Repair any pages that were torn by the crash, before WAL replay
+		 * looks at them.
+		 */
+		DoubleWriteRecover();
+
 		/*
 		 * We're in recovery, so unlogged relations may be trashed and must be
 		 * reset.  This should be done BEFORE allowing Hot Standby
@@ -7086,6 +7096,7 @@ StartupXLOG(void)
 		{
 			ErrorContextCallback errcallback;
 			TimestampTz xtime;
+			XLogRecPtr	pendingEndRecPtr = InvalidXLogRecPtr;
 
 			InRedo = true;
 
@@ -7093,6 +7104,8 @@ StartupXLOG(void)
 					(errmsg("redo starts at %X/%X",
 							(uint32) (ReadRecPtr >> 32), (uint32) ReadRecPtr)));
 
+			ParallelRedoStart(!bgwriterLaunched);
+
 			/*
 			 * main redo apply loop
 			 */
@@ -7122,6 +7135,9 @@ StartupXLOG(void)
 				/* Handle interrupt signals of startup process */
 				HandleStartupProcInterrupts();
 
+				/* Prefetch blocks that upcoming records will need */
+				XLogPrefetchReadAhead(ReadRecPtr, curFileTLI);
+
 				/*
 				 * Pause WAL replay, if requested by a hot-standby session via
 				 * SetRecoveryPause().
@@ -7246,14 +7262,18 @@ StartupXLOG(void)
 					TransactionIdIsValid(record->xl_xid))
 					RecordKnownAssignedTransactionIds(record->xl_xid);
 
-				/* Now apply the WAL record itself */
-				RmgrTable[record->xl_rmid].rm_redo(xlogreader);
+				/*
+				 * Now apply the WAL record itself, or hand it to a parallel
+				 * redo worker.
+				 */
+				if (!ParallelRedoDispatch(xlogreader))
+					RmgrTable[record->xl_rmid].rm_redo(xlogreader);
 
 				/*
 				 * After redo, check whether the backup pages associated with
 				 * the WAL record are consistent with the existing pages. This
 				 * check is done only if consistency check is enabled for this
-				 * record.
+				 * record.  (Such records are never dispatched.)
 				 */
 				if ((record->xl_info & XLR_CHECK_CONSISTENCY) != 0)
 					checkXLogConsistency(xlogreader);
@@ -7263,12 +7283,21 @@ StartupXLOG(void)
 
 				/*
 				 * Update lastReplayedEndRecPtr after this record has been
-				 * successfully replayed.
+				 * successfully replayed.  If parallel redo workers may still
+				 * be replaying this or earlier records, we don't know when
+				 * that's done, so leave it to the next record that makes us
+				 * wait for them.
 				 */
-				SpinLockAcquire(&XLogCtl->info_lck);
-				XLogCtl->lastReplayedEndRecPtr = EndRecPtr;
-				XLogCtl->lastReplayedTLI = ThisTimeLineID;
-				SpinLockRelease(&XLogCtl->info_lck);
+				if (!ParallelRedoBusy())
+				{
+					SpinLockAcquire(&XLogCtl->info_lck);
+					XLogCtl->lastReplayedEndRecPtr = EndRecPtr;
+					XLogCtl->lastReplayedTLI = ThisTimeLineID;
+					SpinLockRelease(&XLogCtl->info_lck);
+					pendingEndRecPtr = InvalidXLogRecPtr;
+				}
+				else
+					pendingEndRecPtr = EndRecPtr;
 
 				/*
 				 * If rm_redo called XLogRequestWalReceiverReply, then we wake
@@ -7320,6 +7349,20 @@ StartupXLOG(void)
 			 * end of main redo apply loop
 			 */
 
+			XLogPrefetchEnd();
+			ParallelRedoEnd();
+
+			/* Records left to the parallel redo workers are replayed now */
+			if (!XLogRecPtrIsInvalid(pendingEndRecPtr))
+			{
+				SpinLockAcquire(&XLogCtl->info_lck);
+				XLogCtl->lastReplayedEndRecPtr = pendingEndRecPtr;
+				XLogCtl->lastReplayedTLI = ThisTimeLineID;
+				SpinLockRelease(&XLogCtl->info_lck);
+
+				CheckRecoveryConsistency();
+			}
+
 			if (reachedStopPoint)
 			{
 				if (!reachedConsistency)
@@ -9088,6 +9131,11 @@ CreateEndOfRecoveryRecord(void)
 static void
 CheckPointGuts(XLogRecPtr checkPointRedo, int flags)
 {
+	uint64		dblwr_gen;
+
+	/* Double-write the buffers we flush to a new file */
+	dblwr_gen = DoubleWriteStartCheckpoint();
+
 	CheckPointCLOG();
 	CheckPointCommitTs();
 	CheckPointSUBTRANS();
@@ -9098,6 +9146,7 @@ CheckPointGuts(XLogRecPtr checkPointRedo, int flags)
 	CheckPointSnapBuild();
 	CheckPointLogicalRewriteHeap();
 	CheckPointBuffers(flags);	/* performs all required fsyncs */
+	DoubleWriteEndCheckpoint(dblwr_gen);
 	CheckPointReplicationOrigin();
 	/* We deliberately delay 2PC checkpointing as long as possible */
 	CheckPointTwoPhase(checkPointRedo);
@@ -9403,20 +9452,22 @@ CreateRestartPoint(int flags)
 
 /*
  * Retreat *logSegNo to the last segment that we need to retain because of
- * either wal_keep_segments or replication slots.
+ * wal_keep_segments, replication slots or the WAL summarizer.
  *
  * This is calculated by subtracting wal_keep_segments from the given xlog
  * location, recptr and by making sure that that result is below the
- * requirement of replication slots.
+ * requirement of replication slots and of the WAL summarizer.
  */
 static void
 KeepLogSeg(XLogRecPtr recptr, XLogSegNo *logSegNo)
 {
 	XLogSegNo	segno;
 	XLogRecPtr	keep;
+	XLogRecPtr	unsummarized;
 
 	XLByteToSeg(recptr, segno, wal_segment_size);
 	keep = XLogGetReplicationSlotMinimumLSN();
+	unsummarized = GetOldestUnsummarizedLSN();
 
 	/* compute limit for wal_keep_segments first */
 	if (wal_keep_segments > 0)
@@ -9441,6 +9492,19 @@ KeepLogSeg(XLogRecPtr recptr, XLogSegNo *logSegNo)
 			segno = slotSegNo;
 	}
 
+	/* and whether the WAL summarizer still needs to read it */
+	if (unsummarized != InvalidXLogRecPtr)
+	{
+		XLogSegNo	summarySegNo;
+
+		XLByteToSeg(unsummarized, summarySegNo, wal_segment_size);
+
+		if (summarySegNo <= 0)
+			segno = 1;
+		else if (summarySegNo < segno)
+			segno = summarySegNo;
+	}
+
 	/* don't delete WAL segments newer than the calculated segment */
 	if (segno < *logSegNo)
 		*logSegNo = segno;
@@ -9582,6 +9646,9 @@ XLogReportParameters(void)
  * Update full_page_writes in shared memory, and write an
  * XLOG_FPW_CHANGE record if necessary.
  *
+ * With double_write on, full-page writes are not needed, and the shared
+ * flag stays off whatever full_page_writes says.
+ *
  * Note: this function assumes there is no other process running
  * concurrently that could update it.
  */
@@ -9589,6 +9656,7 @@ void
 UpdateFullPageWrites(void)
 {
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	bool		fpw = (fullPageWrites && !double_write);
 
 	/*
 	 * Do nothing if full_page_writes has not been changed.
@@ -9597,7 +9665,7 @@ UpdateFullPageWrites(void)
 	 * because we assume that there is no concurrently running process which
 	 * can update it.
 	 */
-	if (fullPageWrites == Insert->fullPageWrites)
+	if (fpw == Insert->fullPageWrites)
 		return;
 
 	START_CRIT_SECTION();
@@ -9609,7 +9677,7 @@ UpdateFullPageWrites(void)
 	 * setting it to false, first write the WAL record and then set the global
 	 * flag.
 	 */
-	if (fullPageWrites)
+	if (fpw)
 	{
 		WALInsertLockAcquireExclusive();
 		Insert->fullPageWrites = true;
@@ -9623,12 +9691,12 @@ UpdateFullPageWrites(void)
 	if (XLogStandbyInfoActive() && !RecoveryInProgress())
 	{
 		XLogBeginInsert();
-		XLogRegisterData((char *) (&fullPageWrites), sizeof(bool));
+		XLogRegisterData((char *) (&fpw), sizeof(bool));
 
 		XLogInsert(RM_XLOG_ID, XLOG_FPW_CHANGE);
 	}
 
-	if (!fullPageWrites)
+	if (!fpw)
 	{
 		WALInsertLockAcquireExclusive();
 		Insert->fullPageWrites = false;
@@ -10083,10 +10151,19 @@ static int
 get_sync_bit(int method)
 {
 	int			o_direct_flag = 0;
+	int			io_direct_flag = 0;
+
+	/*
+	 * With io_direct = wal, always bypass the kernel cache, whatever the sync
+	 * method.  Our WAL buffers are aligned and we always write whole pages,
+	 * except in walreceiver, which is left alone for the reasons below.
+	 */
+	if ((io_direct_flags & IO_DIRECT_WAL) && !AmWalReceiverProcess())
+		io_direct_flag = o_direct_flag = PG_O_DIRECT;
 
 	/* If fsync is disabled, never open in sync mode */
 	if (!enableFsync)
-		return 0;
+		return io_direct_flag;
 
 	/*
 	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
@@ -10116,7 +10193,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return io_direct_flag;
 #ifdef OPEN_SYNC_FLAG
 		case SYNC_METHOD_OPEN:
 			return OPEN_SYNC_FLAG | o_direct_flag;
@@ -11166,6 +11243,27 @@ do_pg_abort_backup(void)
 		XLogCtl->Insert.forcePageWrites = false;
 	}
 	WALInsertLockRelease();
+
+	/* Clean up session-level lock */
+	sessionBackupState = SESSION_BACKUP_NONE;
+}
+
+/*
+ * Is a non-exclusive backup running in any session?
+ *
+ * The counter is only changed while holding all the insertion locks, so
+ * holding any one of them is enough to read it.
+ */
+bool
+NonExclusiveBackupInProgress(void)
+{
+	bool		result;
+
+	WALInsertLockAcquire();
+	result = XLogCtl->Insert.nonExclusiveBackups > 0;
+	WALInsertLockRelease();
+
+	return result;
 }
 
 /*
@@ -11257,6 +11355,7 @@ read_backup_label(XLogRecPtr *checkPointLoc, bool *backupEndRequired,
 	char		ch;
 	char		backuptype[20];
 	char		backupfrom[20];
+	char		line[MAXPGPATH];
 	uint32		hi,
 				lo;
 
@@ -11312,6 +11411,19 @@ read_backup_label(XLogRecPtr *checkPointLoc, bool *backupEndRequired,
 			*backupFromStandby = true;
 	}
 
+	/*
+	 * An incremental backup only contains the blocks modified since a prior
+	 * backup, and must be combined with it before it can be restored.
+	 */
+	while (fgets(line, sizeof(line), lfp) != NULL)
+	{
+		if (strncmp(line, "INCREMENTAL FROM LSN:", 21) == 0)
+			ereport(FATAL,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("cannot recover from an incremental backup"),
+					 errhint("Use pg_combinebackup to reconstruct a full backup from it and the backups it is based on.")));
+	}
+
 	if (ferror(lfp) || FreeFile(lfp))
 		ereport(FATAL,
 				(errcode_for_file_access(),
@@ -89,10 +89,14 @@ static char *hdr_scratch = NULL;
 
 #define SizeOfXlogOrigin	(sizeof(RepOriginId) + sizeof(char))
 
+/* For storing XID of the top-level transaction */
+#define SizeOfXLogTransactionId	(sizeof(TransactionId) + sizeof(char))
+
 #define HEADER_SCRATCH_SIZE \
 	(SizeOfXLogRecord + \
 	 MaxSizeOfXLogRecordBlockHeader * (XLR_MAX_BLOCK_ID + 1) + \
-	 SizeOfXLogRecordDataHeaderLong + SizeOfXlogOrigin)
+	 SizeOfXLogRecordDataHeaderLong + SizeOfXlogOrigin + \
+	 SizeOfXLogTransactionId)
 
 /*
  * An array of XLogRecData structs, to hold registered data.
@@ -108,7 +112,7 @@ static MemoryContext xloginsert_cxt;
 
 static XLogRecData *XLogRecordAssemble(RmgrId rmid, uint8 info,
 				   XLogRecPtr RedoRecPtr, bool doPageWrites,
-				   XLogRecPtr *fpw_lsn);
+				   XLogRecPtr *fpw_lsn, bool *topxid_included);
 static bool XLogCompressBackupBlock(char *page, uint16 hole_offset,
 						uint16 hole_length, char *dest, uint16 *dlen);
 
@@ -415,6 +419,7 @@ XLogRecPtr
 XLogInsert(RmgrId rmid, uint8 info)
 {
 	XLogRecPtr	EndPos;
+	bool		topxid_included = false;
 
 	/* XLogBeginInsert() must have been called. */
 	if (!begininsert_called)
@@ -449,6 +454,8 @@ XLogInsert(RmgrId rmid, uint8 info)
 		XLogRecPtr	fpw_lsn;
 		XLogRecData *rdt;
 
+		topxid_included = false;
+
 		/*
 		 * Get values needed to decide whether to do full-page writes. Since
 		 * we don't yet have an insertion lock, these could change under us,
@@ -457,11 +464,18 @@ XLogInsert(RmgrId rmid, uint8 info)
 		GetFullPageWriteInfo(&RedoRecPtr, &doPageWrites);
 
 		rdt = XLogRecordAssemble(rmid, info, RedoRecPtr, doPageWrites,
-								 &fpw_lsn);
+								 &fpw_lsn, &topxid_included);
 
 		EndPos = XLogInsertRecord(rdt, fpw_lsn, curinsert_flags);
 	} while (EndPos == InvalidXLogRecPtr);
 
+	/*
+	 * The top-level XID only needs to be logged once per subtransaction, so
+	 * remember that the decoder has now seen the association.
+	 */
+	if (topxid_included)
+		MarkSubTransactionAssigned();
+
 	XLogResetInsertion();
 
 	return EndPos;
@@ -482,7 +496,7 @@ XLogInsert(RmgrId rmid, uint8 info)
 static XLogRecData *
 XLogRecordAssemble(RmgrId rmid, uint8 info,
 				   XLogRecPtr RedoRecPtr, bool doPageWrites,
-				   XLogRecPtr *fpw_lsn)
+				   XLogRecPtr *fpw_lsn, bool *topxid_included)
 {
 	XLogRecData *rdt;
 	uint32		total_len = 0;
@@ -743,6 +757,22 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 		scratch += sizeof(replorigin_session_origin);
 	}
 
+	/*
+	 * followed by the top-level XID, if this is the first record of a
+	 * subtransaction (needed by logical decoding to stream changes of
+	 * in-progress transactions)
+	 */
+	*topxid_included = false;
+	if (IsSubTransactionAssignmentPending())
+	{
+		TransactionId xid = GetTopTransactionIdIfAny();
+
+		*(scratch++) = (char) XLR_BLOCK_ID_TOPLEVEL_XID;
+		memcpy(scratch, &xid, sizeof(TransactionId));
+		scratch += sizeof(TransactionId);
+		*topxid_included = true;
+	}
+
 	/* followed by main data, if any */
 	if (mainrdata_len > 0)
 	{
@@ -0,0 +1,808 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogparallel.c
+ *		Parallel replay of WAL records in redo worker processes.
+ *
+ * Normally the startup process replays every WAL record itself, so a
+ * standby or a crashed server can apply WAL no faster than one CPU allows.
+ * With max_parallel_redo_workers > 0, the startup process launches that
+ * many background workers when redo begins, and hands records that modify
+ * a single data block to them, through a shm_mq per worker.  The worker is
+ * chosen by hashing the relation and block number, so all changes to one
+ * block are replayed by the same worker, in WAL order, while changes to
+ * different blocks are replayed concurrently.
+ *
+ * Only simple record types are dispatched: full-page images, and heap and
+ * B-tree leaf changes confined to one block, whose replay doesn't depend on
+ * anything but that block.  Everything else acts as a barrier: records that
+ * touch several blocks, DDL, checkpoints and so on are replayed by the
+ * startup process itself, once all the workers have caught up with the
+ * records already handed to them.  In hot standby, heap and B-tree records
+ * and commit and abort records are barriers too, so queries see changes in
+ * WAL order: an index-only scan must not find a new index entry before the
+ * heap record that clears the page's all-visible bit has been replayed, and
+ * no transaction may appear committed before all its changes are in place.
+ * Only full-page images are dispatched then.  Otherwise nobody can look,
+ * and the startup process replays commits and aborts without waiting.  lastReplayedEndRecPtr is
+ * only advanced when the workers are known to have caught up, so the replay
+ * position reported to the primary, and the point at which a standby
+ * becomes consistent, are never ahead of what has actually been replayed.
+ *
+ * While workers are active, several processes may extend the same relation
+ * concurrently, so XLogReadBufferExtended() takes the relation extension
+ * lock, and relation sizes cached in each process are not trusted.  When
+ * the startup process drops or truncates relations, it bumps a counter in
+ * shared memory to tell the workers to close their smgr references.
+ * During crash recovery, the startup process absorbs the fsync requests
+ * for segments the workers write to, as the checkpointer would.
+ *
+ * Each worker keeps its own table of references to missing pages.  The
+ * startup process collects those entries, through a reply queue per worker,
+ * whenever it waits for the workers to catch up: before it replays a drop or
+ * truncation that might resolve them, and before it checks for unresolved
+ * ones on reaching consistency or at the end of recovery.  After
+ * consistency is reached, such references cause a PANIC in the worker, as
+ * they would in the startup process.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "access/heapam_xlog.h"
+#include "access/nbtxlog.h"
+#include "access/rmgr.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogparallel.h"
+#include "access/xlogutils.h"
+#include "catalog/pg_control.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/bgwriter.h"
+#include "postmaster/startup.h"
+#include "storage/dsm.h"
+#include "storage/dsm_impl.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/smgr.h"
+#include "tcop/tcopprot.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+#include "utils/timeout.h"
+
+
+/* GUC variable */
+int			max_parallel_redo_workers = 0;
+
+bool		ParallelRedoActive = false;
+
+/* Magic number and keys for the parallel redo DSM segment */
+#define PARALLEL_REDO_MAGIC			0x50524544
+#define PARALLEL_REDO_KEY_SHARED	0
+#define PARALLEL_REDO_KEY_QUEUE		1	/* plus worker number */
+#define PARALLEL_REDO_KEY_REPLY_QUEUE	UINT64CONST(0x100000000)	/* plus worker
+																 * number */
+
+/* Size of each worker's queue, and of its reply queue */
+#define PARALLEL_REDO_QUEUE_SIZE	(1024 * 1024)
+#define PARALLEL_REDO_REPLY_QUEUE_SIZE	(16 * 1024)
+
+/* Per-worker shared state */
+typedef struct ParallelRedoWorkerShared
+{
+	pg_atomic_uint64 applied;	/* end of last replayed record */
+	bool		invalid_pages;	/* has invalid-page entries to hand over? */
+} ParallelRedoWorkerShared;
+
+/* Shared state, in the DSM segment */
+typedef struct ParallelRedoShared
+{
+	pg_atomic_uint32 smgr_generation;	/* bumped when relations go away */
+	ParallelRedoWorkerShared workers[FLEXIBLE_ARRAY_MEMBER];
+} ParallelRedoShared;
+
+/* Sent ahead of each record */
+typedef struct ParallelRedoHeader
+{
+	XLogRecPtr	ReadRecPtr;
+	XLogRecPtr	EndRecPtr;
+	bool		consistent;		/* has the startup process reached
+								 * consistency? */
+	bool		send_invalid_pages; /* no record; reply with invalid-page
+									 * entries instead */
+} ParallelRedoHeader;
+
+/* Startup process's state */
+typedef struct ParallelRedoState
+{
+	dsm_segment *seg;
+	ParallelRedoShared *shared;
+	int			nworkers;
+	BackgroundWorkerHandle **handles;
+	shm_mq_handle **queues;
+	shm_mq_handle **reply_queues;
+	XLogRecPtr *dispatched;		/* per worker: end of last record sent */
+	bool		busy;			/* anything dispatched since last wait? */
+	bool		absorb_fsyncs;	/* absorbing the workers' fsync requests? */
+} ParallelRedoState;
+
+static ParallelRedoState *redo_state = NULL;
+
+/* How a record can be replayed, relative to the records the workers have */
+typedef enum
+{
+	REDO_IN_WORKER,				/* by a worker, concurrently with others */
+	REDO_CONCURRENT,			/* by us, without waiting for the workers */
+	REDO_BARRIER				/* by us, once the workers have caught up */
+} ParallelRedoMode;
+
+static ParallelRedoMode ParallelRedoGetMode(XLogReaderState *record);
+static void ParallelRedoWaitForWorkers(void);
+static void ParallelRedoCollectInvalidPages(int worker);
+static void ParallelRedoWorkerLost(void);
+static void parallel_redo_error_callback(void *arg);
+
+
+/*
+ * ParallelRedoStart
+ *		Launch the redo workers, if configured.
+ *
+ * Called by the startup process when redo begins.  If the workers can't be
+ * set up, all records are replayed by the startup process as usual.
+ *
+ * absorb_fsyncs says that the checkpointer isn't running, and the startup
+ * process will perform the end-of-recovery checkpoint itself.  We then
+ * collect the fsync requests for the segments the workers write to, since
+ * they'd otherwise have to fsync them on the spot.
+ */
+void
+ParallelRedoStart(bool absorb_fsyncs)
+{
+	shm_toc_estimator e;
+	Size		sharedsize;
+	Size		segsize;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	ParallelRedoShared *shared;
+	BackgroundWorker worker;
+	int			nworkers = max_parallel_redo_workers;
+	int			nlaunched;
+	int			i;
+
+	Assert(redo_state == NULL);
+
+	/* Workers need the postmaster, and dynamic shared memory */
+	if (nworkers <= 0 || !IsUnderPostmaster ||
+		dynamic_shared_memory_type == DSM_IMPL_NONE)
+		return;
+
+	sharedsize = add_size(offsetof(ParallelRedoShared, workers),
+						  mul_size(nworkers, sizeof(ParallelRedoWorkerShared)));
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sharedsize);
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_toc_estimate_chunk(&e, PARALLEL_REDO_QUEUE_SIZE);
+		shm_toc_estimate_chunk(&e, PARALLEL_REDO_REPLY_QUEUE_SIZE);
+	}
+	shm_toc_estimate_keys(&e, 1 + 2 * nworkers);
+	segsize = shm_toc_estimate(&e);
+
+	seg = dsm_create(segsize, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (seg == NULL)
+		return;
+	toc = shm_toc_create(PARALLEL_REDO_MAGIC, dsm_segment_address(seg),
+						 segsize);
+
+	shared = shm_toc_allocate(toc, sharedsize);
+	pg_atomic_init_u32(&shared->smgr_generation, 0);
+	for (i = 0; i < nworkers; i++)
+	{
+		pg_atomic_init_u64(&shared->workers[i].applied, InvalidXLogRecPtr);
+		shared->workers[i].invalid_pages = false;
+	}
+	shm_toc_insert(toc, PARALLEL_REDO_KEY_SHARED, shared);
+
+	redo_state = MemoryContextAllocZero(TopMemoryContext,
+										sizeof(ParallelRedoState));
+	redo_state->seg = seg;
+	redo_state->shared = shared;
+	redo_state->handles = MemoryContextAllocZero(TopMemoryContext,
+												 nworkers * sizeof(BackgroundWorkerHandle *));
+	redo_state->queues = MemoryContextAllocZero(TopMemoryContext,
+												nworkers * sizeof(shm_mq_handle *));
+	redo_state->reply_queues = MemoryContextAllocZero(TopMemoryContext,
+													  nworkers * sizeof(shm_mq_handle *));
+	redo_state->dispatched = MemoryContextAllocZero(TopMemoryContext,
+													nworkers * sizeof(XLogRecPtr));
+
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(shm_toc_allocate(toc, PARALLEL_REDO_QUEUE_SIZE),
+						   PARALLEL_REDO_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+		shm_toc_insert(toc, PARALLEL_REDO_KEY_QUEUE + i, mq);
+
+		mq = shm_mq_create(shm_toc_allocate(toc, PARALLEL_REDO_REPLY_QUEUE_SIZE),
+						   PARALLEL_REDO_REPLY_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+		shm_toc_insert(toc, PARALLEL_REDO_KEY_REPLY_QUEUE + i, mq);
+	}
+
+	/*
+	 * Register the workers.  They count as parallel workers, so that the
+	 * postmaster launches them even during crash recovery.  If we run out of
+	 * worker slots, make do with the ones we got.
+	 */
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_CLASS_PARALLEL;
+	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	sprintf(worker.bgw_library_name, "postgres");
+	sprintf(worker.bgw_function_name, "ParallelRedoWorkerMain");
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(seg));
+	worker.bgw_notify_pid = MyProcPid;
+
+	for (nlaunched = 0; nlaunched < nworkers; nlaunched++)
+	{
+		shm_mq	   *mq;
+
+		snprintf(worker.bgw_name, BGW_MAXLEN, "parallel redo worker %d",
+				 nlaunched);
+		memcpy(worker.bgw_extra, &nlaunched, sizeof(int));
+		if (!RegisterDynamicBackgroundWorker(&worker,
+											 &redo_state->handles[nlaunched]))
+			break;
+
+		mq = shm_toc_lookup(toc, PARALLEL_REDO_KEY_QUEUE + nlaunched, false);
+		redo_state->queues[nlaunched] =
+			shm_mq_attach(mq, seg, redo_state->handles[nlaunched]);
+		mq = shm_toc_lookup(toc, PARALLEL_REDO_KEY_REPLY_QUEUE + nlaunched,
+							false);
+		redo_state->reply_queues[nlaunched] =
+			shm_mq_attach(mq, seg, redo_state->handles[nlaunched]);
+	}
+	redo_state->nworkers = nlaunched;
+
+	if (nlaunched == 0)
+	{
+		ereport(LOG,
+				(errmsg("could not register parallel redo workers"),
+				 errhint("You might need to increase max_worker_processes or max_parallel_workers.")));
+		ParallelRedoEnd();
+		return;
+	}
+
+	ParallelRedoActive = true;
+
+	if (absorb_fsyncs)
+	{
+		SetStartupAbsorbsFsyncRequests(true);
+		redo_state->absorb_fsyncs = true;
+	}
+
+	ereport(LOG,
+			(errmsg("using %d parallel redo workers", nlaunched)));
+}
+
+/*
+ * ParallelRedoDispatch
+ *		Hand a record over to a redo worker, if possible.
+ *
+ * Returns true if the record was dispatched.  Otherwise, the caller must
+ * replay the record itself.  Unless it's safe to do that concurrently with
+ * the workers, we first wait for them to replay all the records dispatched
+ * so far.
+ */
+bool
+ParallelRedoDispatch(XLogReaderState *record)
+{
+	ParallelRedoHeader hdr;
+	shm_mq_iovec iov[2];
+	struct
+	{
+		RelFileNode rnode;
+		BlockNumber blkno;
+	}			key;
+	int			worker;
+
+	if (redo_state == NULL)
+		return false;
+
+	switch (ParallelRedoGetMode(record))
+	{
+		case REDO_IN_WORKER:
+			break;
+		case REDO_CONCURRENT:
+			return false;
+		case REDO_BARRIER:
+			ParallelRedoWaitForWorkers();
+			return false;
+	}
+
+	/* Keep all changes to a block in one worker, so they stay in order */
+	XLogRecGetBlockTag(record, 0, &key.rnode, NULL, &key.blkno);
+	worker = DatumGetUInt32(hash_any((unsigned char *) &key, sizeof(key))) %
+		redo_state->nworkers;
+
+	hdr.ReadRecPtr = record->ReadRecPtr;
+	hdr.EndRecPtr = record->EndRecPtr;
+	hdr.consistent = reachedConsistency;
+	hdr.send_invalid_pages = false;
+
+	iov[0].data = (char *) &hdr;
+	iov[0].len = sizeof(hdr);
+	iov[1].data = (char *) record->decoded_record;
+	iov[1].len = record->decoded_record->xl_tot_len;
+
+	if (shm_mq_sendv(redo_state->queues[worker], iov, 2, false) !=
+		SHM_MQ_SUCCESS)
+		ParallelRedoWorkerLost();
+
+	redo_state->dispatched[worker] = record->EndRecPtr;
+	redo_state->busy = true;
+
+	return true;
+}
+
+/*
+ * ParallelRedoBusy
+ *		Might the workers still be replaying records dispatched to them?
+ */
+bool
+ParallelRedoBusy(void)
+{
+	return redo_state != NULL && redo_state->busy;
+}
+
+/*
+ * ParallelRedoEnd
+ *		Wait for the redo workers to finish, and shut them down.
+ *
+ * Called by the startup process at the end of redo.
+ */
+void
+ParallelRedoEnd(void)
+{
+	int			i;
+
+	if (redo_state == NULL)
+		return;
+
+	ParallelRedoWaitForWorkers();
+
+	if (redo_state->absorb_fsyncs)
+		SetStartupAbsorbsFsyncRequests(false);
+
+	/* The workers exit when they see their queue detached */
+	for (i = 0; i < redo_state->nworkers; i++)
+	{
+		shm_mq_detach(redo_state->queues[i]);
+		shm_mq_detach(redo_state->reply_queues[i]);
+	}
+	dsm_detach(redo_state->seg);
+
+	pfree(redo_state->handles);
+	pfree(redo_state->queues);
+	pfree(redo_state->reply_queues);
+	pfree(redo_state->dispatched);
+	pfree(redo_state);
+	redo_state = NULL;
+
+	/*
+	 * The workers have extended relations behind our back, so sizes we have
+	 * cached might be stale.
+	 */
+	if (ParallelRedoActive)
+	{
+		smgrcloseall();
+		ParallelRedoActive = false;
+	}
+}
+
+/*
+ * ParallelRedoInvalidateSmgr
+ *		Tell the redo workers to close their smgr references.
+ *
+ * Called by the startup process when it drops or truncates relations during
+ * redo.  The workers are idle at that point, since only barrier records do
+ * that.
+ */
+void
+ParallelRedoInvalidateSmgr(void)
+{
+	if (redo_state != NULL)
+		pg_atomic_fetch_add_u32(&redo_state->shared->smgr_generation, 1);
+}
+
+/*
+ * Decide how a record is to be replayed.
+ *
+ * Outside hot standby, nobody looks at the data until redo is done, so
+ * commit and abort records needn't wait for the changes the workers are
+ * replaying, and cleanup records needn't resolve conflicts with queries.
+ * That makes more of them safe to replay out of order.
+ *
+ * In hot standby, heap and B-tree records are replayed in WAL order.  Since
+ * they are dispatched by block, a leaf insert could otherwise be replayed
+ * before the heap record that clears the visibility map bit of the page it
+ * points to, and an index-only scan would trust the stale bit.
+ */
+static ParallelRedoMode
+ParallelRedoGetMode(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+
+	if (XLogRecGetRmid(record) == RM_XACT_ID && !InHotStandby)
+	{
+		uint8		xact_info = info & XLOG_XACT_OPMASK;
+
+		/* Dropping relations needs the workers to have finished with them */
+		if (xact_info == XLOG_XACT_COMMIT)
+		{
+			xl_xact_parsed_commit parsed;
+
+			ParseCommitRecord(info, (xl_xact_commit *) XLogRecGetData(record),
+							  &parsed);
+			if (parsed.nrels == 0)
+				return REDO_CONCURRENT;
+		}
+		else if (xact_info == XLOG_XACT_ABORT)
+		{
+			xl_xact_parsed_abort parsed;
+
+			ParseAbortRecord(info, (xl_xact_abort *) XLogRecGetData(record),
+							 &parsed);
+			if (parsed.nrels == 0)
+				return REDO_CONCURRENT;
+		}
+		return REDO_BARRIER;
+	}
+
+	/* Exactly one block, and no consistency check to run afterwards */
+	if (record->max_block_id != 0 ||
+		(XLogRecGetInfo(record) & XLR_CHECK_CONSISTENCY) != 0)
+		return REDO_BARRIER;
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_XLOG_ID:
+			if (info == XLOG_FPI || info == XLOG_FPI_FOR_HINT)
+				return REDO_IN_WORKER;
+			break;
+
+		case RM_HEAP_ID:
+			if (InHotStandby)
+				break;
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP_INSERT:
+				case XLOG_HEAP_DELETE:
+				case XLOG_HEAP_UPDATE:	/* same-page update, as one block */
+				case XLOG_HEAP_HOT_UPDATE:
+				case XLOG_HEAP_CONFIRM:
+				case XLOG_HEAP_LOCK:
+				case XLOG_HEAP_INPLACE:
+					return REDO_IN_WORKER;
+			}
+			break;
+
+		case RM_HEAP2_ID:
+			if (InHotStandby)
+				break;
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP2_MULTI_INSERT:
+				case XLOG_HEAP2_LOCK_UPDATED:
+				case XLOG_HEAP2_CLEAN:
+				case XLOG_HEAP2_FREEZE_PAGE:
+					return REDO_IN_WORKER;
+			}
+			break;
+
+		case RM_BTREE_ID:
+			if (InHotStandby)
+				break;
+			switch (info)
+			{
+				case XLOG_BTREE_INSERT_LEAF:
+				case XLOG_BTREE_DEDUP:
+				case XLOG_BTREE_DELETE:
+					return REDO_IN_WORKER;
+			}
+			break;
+	}
+
+	return REDO_BARRIER;
+}
+
+/*
+ * Wait until the workers have replayed all the records dispatched to them,
+ * and take over the references to invalid pages they found.
+ */
+static void
+ParallelRedoWaitForWorkers(void)
+{
+	int			i;
+
+	if (!redo_state->busy)
+		return;
+
+	for (i = 0; i < redo_state->nworkers; i++)
+	{
+		while (pg_atomic_read_u64(&redo_state->shared->workers[i].applied) <
+			   redo_state->dispatched[i])
+		{
+			pid_t		pid;
+
+			if (GetBackgroundWorkerPid(redo_state->handles[i], &pid) ==
+				BGWH_STOPPED)
+				ParallelRedoWorkerLost();
+
+			/*
+			 * The worker sets our latch whenever it runs out of work.  Our
+			 * signal handlers don't set it, so wake up now and then to check
+			 * for shutdown requests.
+			 */
+			WaitLatch(MyLatch,
+					  WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+					  1000L, WAIT_EVENT_PARALLEL_REDO);
+			ResetLatch(MyLatch);
+
+			HandleStartupProcInterrupts();
+		}
+	}
+
+	/*
+	 * Before we replay a record that might resolve the workers' invalid-page
+	 * entries, or check for leftover ones, they must be in our table.
+	 */
+	pg_read_barrier();
+	for (i = 0; i < redo_state->nworkers; i++)
+	{
+		if (redo_state->shared->workers[i].invalid_pages)
+			ParallelRedoCollectInvalidPages(i);
+	}
+
+	/*
+	 * Take over the workers' fsync requests, before we replay anything that
+	 * might make us forget the requests for a relation.
+	 */
+	if (redo_state->absorb_fsyncs)
+		AbsorbFsyncRequests();
+
+	redo_state->busy = false;
+}
+
+/*
+ * Ask an idle worker for its invalid-page entries, and add them to ours.
+ */
+static void
+ParallelRedoCollectInvalidPages(int worker)
+{
+	ParallelRedoHeader hdr;
+	Size		nbytes;
+	void	   *data;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.send_invalid_pages = true;
+
+	if (shm_mq_send(redo_state->queues[worker], sizeof(hdr), &hdr, false) !=
+		SHM_MQ_SUCCESS ||
+		shm_mq_receive(redo_state->reply_queues[worker], &nbytes, &data,
+					   false) != SHM_MQ_SUCCESS)
+		ParallelRedoWorkerLost();
+
+	RestoreInvalidPages((char *) data);
+}
+
+/*
+ * A redo worker exited, or failed to start.  It has logged the reason, if
+ * any; we can't continue without it.
+ */
+static void
+ParallelRedoWorkerLost(void)
+{
+	/* It might have been told to exit because we're shutting down */
+	HandleStartupProcInterrupts();
+
+	ereport(ERROR,
+			(errcode(ERRCODE_INTERNAL_ERROR),
+			 errmsg("lost connection to parallel redo worker")));
+}
+
+/*
+ * Main entry point for a redo worker.
+ */
+void
+ParallelRedoWorkerMain(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	ParallelRedoShared *shared;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	shm_mq_handle *replyh;
+	PGPROC	   *startup;
+	XLogReaderState *reader;
+	MemoryContext redo_context;
+	ErrorContextCallback errcallback;
+	uint32		smgr_generation;
+	int			worker;
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	memcpy(&worker, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "parallel redo worker");
+
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_REDO_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+
+	shared = shm_toc_lookup(toc, PARALLEL_REDO_KEY_SHARED, false);
+	mq = shm_toc_lookup(toc, PARALLEL_REDO_KEY_QUEUE + worker, false);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+	startup = shm_mq_get_sender(mq);
+	mq = shm_toc_lookup(toc, PARALLEL_REDO_KEY_REPLY_QUEUE + worker, false);
+	shm_mq_set_sender(mq, MyProc);
+	replyh = shm_mq_attach(mq, seg, NULL);
+
+	/*
+	 * Replay like the startup process does.  We might have to wait for a
+	 * relation extension lock held by another worker.
+	 */
+	InRecovery = true;
+	ParallelRedoActive = true;
+	RegisterTimeout(DEADLOCK_TIMEOUT, CheckDeadLockAlert);
+
+	reader = XLogReaderAllocate(wal_segment_size, NULL, NULL);
+	if (reader == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	redo_context = AllocSetContextCreate(TopMemoryContext,
+										 "parallel redo",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	smgr_generation = pg_atomic_read_u32(&shared->smgr_generation);
+
+	for (;;)
+	{
+		ParallelRedoHeader hdr;
+		XLogRecord *record;
+		Size		nbytes;
+		void	   *data;
+		char	   *errormsg;
+		uint32		generation;
+		MemoryContext oldcontext;
+		shm_mq_result res;
+
+		CHECK_FOR_INTERRUPTS();
+
+		res = shm_mq_receive(mqh, &nbytes, &data, true);
+		if (res == SHM_MQ_WOULD_BLOCK)
+		{
+			/* We've caught up; the startup process might be waiting for it */
+			SetLatch(&startup->procLatch);
+			res = shm_mq_receive(mqh, &nbytes, &data, false);
+		}
+		if (res != SHM_MQ_SUCCESS)
+			break;				/* the startup process is done with us */
+
+		memcpy(&hdr, data, sizeof(hdr));
+
+		/* Hand over our invalid-page entries, if asked to */
+		if (hdr.send_invalid_pages)
+		{
+			Size		size = EstimateInvalidPagesSpace();
+			char	   *buf = palloc(size);
+
+			SerializeInvalidPages(size, buf);
+			shared->workers[worker].invalid_pages = false;
+			if (shm_mq_send(replyh, size, buf, false) != SHM_MQ_SUCCESS)
+				break;			/* the startup process is done with us */
+			pfree(buf);
+			continue;
+		}
+
+		record = (XLogRecord *) ((char *) data + sizeof(hdr));
+
+		/* Forget relations that have been dropped or truncated */
+		generation = pg_atomic_read_u32(&shared->smgr_generation);
+		if (generation != smgr_generation)
+		{
+			smgrcloseall();
+			smgr_generation = generation;
+		}
+
+		if (hdr.consistent)
+			reachedConsistency = true;
+
+		reader->ReadRecPtr = hdr.ReadRecPtr;
+		reader->EndRecPtr = hdr.EndRecPtr;
+		if (!DecodeXLogRecord(reader, record, &errormsg))
+			elog(ERROR, "could not decode WAL record at %X/%X: %s",
+				 (uint32) (hdr.ReadRecPtr >> 32), (uint32) hdr.ReadRecPtr,
+				 errormsg);
+
+		errcallback.callback = parallel_redo_error_callback;
+		errcallback.arg = (void *) reader;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		oldcontext = MemoryContextSwitchTo(redo_context);
+		RmgrTable[record->xl_rmid].rm_redo(reader);
+		MemoryContextSwitchTo(oldcontext);
+		MemoryContextReset(redo_context);
+
+		error_context_stack = errcallback.previous;
+
+		/* Make the flag visible before the startup process sees us done */
+		if (!reachedConsistency && XLogHaveInvalidPages())
+			shared->workers[worker].invalid_pages = true;
+		pg_write_barrier();
+		pg_atomic_write_u64(&shared->workers[worker].applied, hdr.EndRecPtr);
+	}
+
+	XLogReaderFree(reader);
+	dsm_detach(seg);
+}
+
+/*
+ * Error context callback for errors occurring during redo in a worker.
+ */
+static void
+parallel_redo_error_callback(void *arg)
+{
+	XLogReaderState *record = (XLogReaderState *) arg;
+	RmgrId		rmid = XLogRecGetRmid(record);
+	const char *id;
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	appendStringInfoString(&buf, RmgrTable[rmid].rm_name);
+	appendStringInfoChar(&buf, '/');
+	id = RmgrTable[rmid].rm_identify(XLogRecGetInfo(record));
+	if (id == NULL)
+		appendStringInfo(&buf, "UNKNOWN (%X): ",
+						 XLogRecGetInfo(record) & ~XLR_INFO_MASK);
+	else
+		appendStringInfo(&buf, "%s: ", id);
+	RmgrTable[rmid].rm_desc(&buf, record);
+
+	/* translator: %s is a WAL record description */
+	errcontext("WAL redo at %X/%X for %s",
+			   (uint32) (record->ReadRecPtr >> 32),
+			   (uint32) record->ReadRecPtr,
+			   buf.data);
+
+	pfree(buf.data);
+}
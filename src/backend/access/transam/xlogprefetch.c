@@ -0,0 +1,433 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Prefetching of data blocks referenced by WAL during recovery.
+ *
+ * Redo reads the data blocks touched by each record synchronously, so
+ * recovery is often bound by random read latency.  To hide it, we decode
+ * the WAL ahead of the record being replayed, with a second XLogReader,
+ * and ask the kernel to start reading the blocks that upcoming records will
+ * need, if they aren't in shared buffers already.  By the time replay gets
+ * to those records, the reads should have completed.
+ *
+ * The lookahead reader only reads WAL segment files that are already in
+ * pg_wal, on the timeline replay is currently reading from; that covers
+ * crash recovery and streaming replication.  It never waits: if it can't
+ * read or decode a record, because the WAL hasn't been received yet or the
+ * segment was restored from the archive, it gives up until replay has
+ * caught up with that point, and then tries again.  Anything it reads is
+ * only used as a hint, so WAL that later turns out to be invalid does no
+ * harm.
+ *
+ * Blocks are not prefetched if the record carries a full-page image of
+ * them or will initialize them, since redo then doesn't read them, nor if
+ * the relation or block doesn't exist yet.  Statistics are kept in shared
+ * memory, and shown in the pg_stat_recovery_prefetch view.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogprefetch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "access/htup_details.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogreader.h"
+#include "access/xlogrecord.h"
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+
+
+/* GUC variables */
+bool		recovery_prefetch = true;
+int			recovery_prefetch_distance = 256 * 1024;
+
+/* Statistics, in shared memory; only the startup process writes them */
+typedef struct XLogPrefetchStats
+{
+	pg_atomic_uint64 prefetch;	/* blocks prefetched */
+	pg_atomic_uint64 skip_hit;	/* blocks already in shared buffers */
+	pg_atomic_uint64 skip_new;	/* relation or block didn't exist yet */
+	pg_atomic_uint64 skip_fpw;	/* record has a full-page image */
+	pg_atomic_uint64 skip_init;	/* record initializes the block */
+	pg_atomic_uint64 skip_rep;	/* same block as the previous reference */
+	pg_atomic_uint32 wal_distance;	/* bytes of WAL decoded ahead of replay */
+} XLogPrefetchStats;
+
+static XLogPrefetchStats *PrefetchStats = NULL;
+
+/* Lookahead state, in the startup process */
+typedef struct XLogPrefetcher
+{
+	XLogReaderState *reader;
+	TimeLineID	tli;			/* timeline of the WAL we're reading */
+	int			file;			/* open WAL segment, or -1 */
+	XLogSegNo	segno;			/* segment number of "file" */
+	XLogRecPtr	next_lsn;		/* start of the next record to decode */
+	XLogRecPtr	stall_lsn;		/* don't retry until replay gets here */
+
+	/* the last block reference we looked at */
+	RelFileNode last_rnode;
+	ForkNumber	last_forknum;
+	BlockNumber last_blkno;
+
+	/* local copies of the statistics counters */
+	uint64		prefetch;
+	uint64		skip_hit;
+	uint64		skip_new;
+	uint64		skip_fpw;
+	uint64		skip_init;
+	uint64		skip_rep;
+} XLogPrefetcher;
+
+static XLogPrefetcher *prefetcher = NULL;
+
+static int XLogPrefetcherPageRead(XLogReaderState *reader,
+					   XLogRecPtr targetPagePtr, int reqLen,
+					   XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI);
+static void XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherReportStats(XLogPrefetcher *prefetcher,
+						  uint32 wal_distance);
+
+
+/*
+ * Report shared-memory space needed by XLogPrefetchShmemInit
+ */
+Size
+XLogPrefetchShmemSize(void)
+{
+	return sizeof(XLogPrefetchStats);
+}
+
+/*
+ * Initialize the statistics in shared memory
+ */
+void
+XLogPrefetchShmemInit(void)
+{
+	bool		found;
+
+	PrefetchStats = (XLogPrefetchStats *)
+		ShmemInitStruct("XLogPrefetchStats", XLogPrefetchShmemSize(), &found);
+
+	if (!found)
+	{
+		pg_atomic_init_u64(&PrefetchStats->prefetch, 0);
+		pg_atomic_init_u64(&PrefetchStats->skip_hit, 0);
+		pg_atomic_init_u64(&PrefetchStats->skip_new, 0);
+		pg_atomic_init_u64(&PrefetchStats->skip_fpw, 0);
+		pg_atomic_init_u64(&PrefetchStats->skip_init, 0);
+		pg_atomic_init_u64(&PrefetchStats->skip_rep, 0);
+		pg_atomic_init_u32(&PrefetchStats->wal_distance, 0);
+	}
+}
+
+/*
+ * XLogPrefetchReadAhead
+ *		Prefetch the blocks referenced by the WAL that follows the record
+ *		about to be replayed.
+ *
+ * Called by the startup process before replaying each record, with the
+ * start of the record and the timeline of the WAL segment it came from.
+ * Decodes WAL up to recovery_prefetch_distance bytes ahead.
+ */
+void
+XLogPrefetchReadAhead(XLogRecPtr replaying_lsn, TimeLineID tli)
+{
+#ifdef USE_PREFETCH
+	if (!recovery_prefetch || recovery_prefetch_distance <= 0)
+	{
+		XLogPrefetchEnd();
+		return;
+	}
+
+	if (prefetcher == NULL)
+	{
+		prefetcher = MemoryContextAllocZero(TopMemoryContext,
+											sizeof(XLogPrefetcher));
+		prefetcher->reader = XLogReaderAllocate(wal_segment_size,
+												XLogPrefetcherPageRead,
+												prefetcher);
+		if (prefetcher->reader == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory"),
+					 errdetail("Failed while allocating a WAL reading processor.")));
+		prefetcher->file = -1;
+		prefetcher->tli = tli;
+
+		/* Continue the counts from before, if we were switched off */
+		prefetcher->prefetch = pg_atomic_read_u64(&PrefetchStats->prefetch);
+		prefetcher->skip_hit = pg_atomic_read_u64(&PrefetchStats->skip_hit);
+		prefetcher->skip_new = pg_atomic_read_u64(&PrefetchStats->skip_new);
+		prefetcher->skip_fpw = pg_atomic_read_u64(&PrefetchStats->skip_fpw);
+		prefetcher->skip_init = pg_atomic_read_u64(&PrefetchStats->skip_init);
+		prefetcher->skip_rep = pg_atomic_read_u64(&PrefetchStats->skip_rep);
+	}
+
+	/* Start over from the replay position after a timeline switch */
+	if (tli != prefetcher->tli)
+	{
+		if (prefetcher->file >= 0)
+			close(prefetcher->file);
+		prefetcher->file = -1;
+		prefetcher->tli = tli;
+		prefetcher->next_lsn = InvalidXLogRecPtr;
+		XLogReaderInvalReadState(prefetcher->reader);
+	}
+
+	/* Did replay overtake us? */
+	if (prefetcher->next_lsn < replaying_lsn)
+		prefetcher->next_lsn = replaying_lsn;
+
+	/* After a failure to read, wait for replay to catch up */
+	if (replaying_lsn < prefetcher->stall_lsn)
+	{
+		XLogPrefetcherReportStats(prefetcher,
+								  prefetcher->next_lsn - replaying_lsn);
+		return;
+	}
+	prefetcher->stall_lsn = InvalidXLogRecPtr;
+
+	while (prefetcher->next_lsn - replaying_lsn <
+		   (uint64) recovery_prefetch_distance)
+	{
+		XLogRecord *record;
+		XLogRecPtr	lsn = prefetcher->next_lsn;
+		char	   *errormsg;
+
+		/*
+		 * next_lsn might point to a page boundary, which only the reader
+		 * knows how to skip, so continue from the previous record if we can.
+		 * Otherwise it's the record about to be replayed.
+		 */
+		if (lsn == prefetcher->reader->EndRecPtr)
+			lsn = InvalidXLogRecPtr;
+
+		record = XLogReadRecord(prefetcher->reader, lsn, &errormsg);
+		if (record == NULL)
+		{
+			prefetcher->stall_lsn = prefetcher->next_lsn;
+			break;
+		}
+		prefetcher->next_lsn = prefetcher->reader->EndRecPtr;
+
+		XLogPrefetcherScanBlocks(prefetcher);
+	}
+
+	XLogPrefetcherReportStats(prefetcher, prefetcher->next_lsn - replaying_lsn);
+#endif							/* USE_PREFETCH */
+}
+
+/*
+ * XLogPrefetchEnd
+ *		Stop prefetching, at the end of recovery or when it's disabled.
+ */
+void
+XLogPrefetchEnd(void)
+{
+	if (prefetcher == NULL)
+		return;
+
+	if (prefetcher->file >= 0)
+		close(prefetcher->file);
+	XLogReaderFree(prefetcher->reader);
+	pfree(prefetcher);
+	prefetcher = NULL;
+
+	pg_atomic_write_u32(&PrefetchStats->wal_distance, 0);
+}
+
+/*
+ * Read a page of WAL for the lookahead reader, from the segment files in
+ * pg_wal.  Returns -1 if it's not available.
+ */
+static int
+XLogPrefetcherPageRead(XLogReaderState *reader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) reader->private_data;
+	XLogSegNo	segno;
+	uint32		offset;
+	int			nread;
+
+	XLByteToSeg(targetPagePtr, segno, wal_segment_size);
+	offset = XLogSegmentOffset(targetPagePtr, wal_segment_size);
+
+	if (prefetcher->file >= 0 && prefetcher->segno != segno)
+	{
+		close(prefetcher->file);
+		prefetcher->file = -1;
+	}
+	if (prefetcher->file < 0)
+	{
+		char		path[MAXPGPATH];
+
+		XLogFilePath(path, prefetcher->tli, segno, wal_segment_size);
+		prefetcher->file = BasicOpenFile(path, O_RDONLY | PG_BINARY);
+		if (prefetcher->file < 0)
+			return -1;
+		prefetcher->segno = segno;
+	}
+
+	if (lseek(prefetcher->file, (off_t) offset, SEEK_SET) < 0)
+		return -1;
+	pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
+	nread = read(prefetcher->file, readBuf, XLOG_BLCKSZ);
+	pgstat_report_wait_end();
+	if (nread != XLOG_BLCKSZ)
+		return -1;
+
+	/*
+	 * The page may not have been completely written yet; the reader will
+	 * notice that when it checks the page header and record CRCs.
+	 */
+	*pageTLI = prefetcher->tli;
+	return XLOG_BLCKSZ;
+}
+
+/*
+ * Prefetch the blocks referenced by the record the lookahead reader has
+ * just decoded, where useful.
+ */
+static void
+XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	int			block_id;
+
+	for (block_id = 0; block_id <= reader->max_block_id; block_id++)
+	{
+		DecodedBkpBlock *block = &reader->blocks[block_id];
+		SMgrRelation reln;
+		BlockNumber nblocks;
+
+		if (!block->in_use)
+			continue;
+
+		/* Redo won't read blocks it restores from an image, or initializes */
+		if (block->apply_image)
+		{
+			prefetcher->skip_fpw++;
+			continue;
+		}
+		if (block->flags & BKPBLOCK_WILL_INIT)
+		{
+			prefetcher->skip_init++;
+			continue;
+		}
+
+		/* Records often touch the same block repeatedly */
+		if (RelFileNodeEquals(block->rnode, prefetcher->last_rnode) &&
+			block->forknum == prefetcher->last_forknum &&
+			block->blkno == prefetcher->last_blkno)
+		{
+			prefetcher->skip_rep++;
+			continue;
+		}
+		prefetcher->last_rnode = block->rnode;
+		prefetcher->last_forknum = block->forknum;
+		prefetcher->last_blkno = block->blkno;
+
+		/*
+		 * The relation may not have been created or extended yet.  Look at
+		 * the cached size first, since smgrexists() has to reopen the file.
+		 */
+		reln = smgropen(block->rnode, InvalidBackendId);
+		nblocks = smgrnblocks_cached(reln, block->forknum);
+		if (nblocks == InvalidBlockNumber)
+		{
+			if (!smgrexists(reln, block->forknum))
+			{
+				prefetcher->skip_new++;
+				continue;
+			}
+			nblocks = smgrnblocks(reln, block->forknum);
+		}
+		if (block->blkno >= nblocks)
+		{
+			prefetcher->skip_new++;
+			continue;
+		}
+
+		if (PrefetchSharedBuffer(reln, block->forknum, block->blkno))
+			prefetcher->prefetch++;
+		else
+			prefetcher->skip_hit++;
+	}
+}
+
+/*
+ * Publish our counters in shared memory.
+ */
+static void
+XLogPrefetcherReportStats(XLogPrefetcher *prefetcher, uint32 wal_distance)
+{
+	pg_atomic_write_u64(&PrefetchStats->prefetch, prefetcher->prefetch);
+	pg_atomic_write_u64(&PrefetchStats->skip_hit, prefetcher->skip_hit);
+	pg_atomic_write_u64(&PrefetchStats->skip_new, prefetcher->skip_new);
+	pg_atomic_write_u64(&PrefetchStats->skip_fpw, prefetcher->skip_fpw);
+	pg_atomic_write_u64(&PrefetchStats->skip_init, prefetcher->skip_init);
+	pg_atomic_write_u64(&PrefetchStats->skip_rep, prefetcher->skip_rep);
+	pg_atomic_write_u32(&PrefetchStats->wal_distance, wal_distance);
+}
+
+/*
+ * SQL-callable function returning the recovery prefetching statistics.
+ */
+Datum
+pg_stat_get_recovery_prefetch(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_RECOVERY_PREFETCH_COLS 7
+	TupleDesc	tupdesc;
+	Datum		values[PG_STAT_GET_RECOVERY_PREFETCH_COLS];
+	bool		nulls[PG_STAT_GET_RECOVERY_PREFETCH_COLS];
+
+	MemSet(nulls, 0, sizeof(nulls));
+
+	tupdesc = CreateTemplateTupleDesc(PG_STAT_GET_RECOVERY_PREFETCH_COLS, false);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "prefetch",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "skip_hit",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 3, "skip_new",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "skip_fpw",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "skip_init",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "skip_rep",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 7, "wal_distance",
+					   INT4OID, -1, 0);
+	BlessTupleDesc(tupdesc);
+
+	values[0] = Int64GetDatum(pg_atomic_read_u64(&PrefetchStats->prefetch));
+	values[1] = Int64GetDatum(pg_atomic_read_u64(&PrefetchStats->skip_hit));
+	values[2] = Int64GetDatum(pg_atomic_read_u64(&PrefetchStats->skip_new));
+	values[3] = Int64GetDatum(pg_atomic_read_u64(&PrefetchStats->skip_fpw));
+	values[4] = Int64GetDatum(pg_atomic_read_u64(&PrefetchStats->skip_init));
+	values[5] = Int64GetDatum(pg_atomic_read_u64(&PrefetchStats->skip_rep));
+	values[6] = Int32GetDatum(pg_atomic_read_u32(&PrefetchStats->wal_distance));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -22,10 +22,12 @@
 #include "access/timeline.h"
 #include "access/xlog.h"
 #include "access/xlog_internal.h"
+#include "access/xlogparallel.h"
 #include "access/xlogutils.h"
 #include "catalog/catalog.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "storage/lmgr.h"
 #include "storage/smgr.h"
 #include "utils/guc.h"
 #include "utils/hsearch.h"
@@ -57,6 +59,9 @@ typedef struct xl_invalid_page
 
 static HTAB *invalid_page_tab = NULL;
 
+static void remember_invalid_page(RelFileNode node, ForkNumber forkno,
+					  BlockNumber blkno, bool present);
+
 
 /* Report a reference to an invalid page */
 static void
@@ -79,10 +84,6 @@ static void
 log_invalid_page(RelFileNode node, ForkNumber forkno, BlockNumber blkno,
 				 bool present)
 {
-	xl_invalid_page_key key;
-	xl_invalid_page *hentry;
-	bool		found;
-
 	/*
 	 * Once recovery has reached a consistent state, the invalid-page table
 	 * should be empty and remain so. If a reference to an invalid page is
@@ -105,6 +106,18 @@ log_invalid_page(RelFileNode node, ForkNumber forkno, BlockNumber blkno,
 	if (log_min_messages <= DEBUG1 || client_min_messages <= DEBUG1)
 		report_invalid_page(DEBUG1, node, forkno, blkno, present);
 
+	remember_invalid_page(node, forkno, blkno, present);
+}
+
+/* Add an entry to the invalid-page table */
+static void
+remember_invalid_page(RelFileNode node, ForkNumber forkno, BlockNumber blkno,
+					  bool present)
+{
+	xl_invalid_page_key key;
+	xl_invalid_page *hentry;
+	bool		found;
+
 	if (invalid_page_tab == NULL)
 	{
 		/* create hash table when first needed */
@@ -247,6 +260,63 @@ XLogCheckInvalidPages(void)
 	invalid_page_tab = NULL;
 }
 
+/*
+ * Parallel redo workers keep their own invalid-page tables, which they hand
+ * over to the startup process before it replays anything that could resolve
+ * the entries, or checks for leftovers.  EstimateInvalidPagesSpace() and
+ * SerializeInvalidPages() are used in the worker; the latter forgets the
+ * entries, since the startup process takes them over with
+ * RestoreInvalidPages().
+ */
+Size
+EstimateInvalidPagesSpace(void)
+{
+	long		nentries = 0;
+
+	if (invalid_page_tab != NULL)
+		nentries = hash_get_num_entries(invalid_page_tab);
+
+	return add_size(sizeof(int), mul_size(nentries, sizeof(xl_invalid_page)));
+}
+
+void
+SerializeInvalidPages(Size maxsize, char *start_address)
+{
+	HASH_SEQ_STATUS status;
+	xl_invalid_page *hentry;
+	xl_invalid_page *entries;
+	int			nentries = 0;
+
+	Assert(maxsize >= EstimateInvalidPagesSpace());
+
+	entries = (xl_invalid_page *) (start_address + sizeof(int));
+	if (invalid_page_tab != NULL)
+	{
+		hash_seq_init(&status, invalid_page_tab);
+		while ((hentry = (xl_invalid_page *) hash_seq_search(&status)) != NULL)
+			entries[nentries++] = *hentry;
+
+		hash_destroy(invalid_page_tab);
+		invalid_page_tab = NULL;
+	}
+	memcpy(start_address, &nentries, sizeof(int));
+}
+
+void
+RestoreInvalidPages(char *start_address)
+{
+	xl_invalid_page *entries;
+	int			nentries;
+	int			i;
+
+	memcpy(&nentries, start_address, sizeof(int));
+	entries = (xl_invalid_page *) (start_address + sizeof(int));
+
+	for (i = 0; i < nentries; i++)
+		remember_invalid_page(entries[i].key.node, entries[i].key.forkno,
+							  entries[i].key.blkno, entries[i].present);
+}
+
 
 /*
  * XLogReadBufferForRedo
@@ -441,6 +511,7 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 	BlockNumber lastblock;
 	Buffer		buffer;
 	SMgrRelation smgr;
+	Relation	fakerel = NULL;
 
 	Assert(blkno != P_NEW);
 
@@ -475,30 +546,53 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 		}
 		if (mode == RBM_NORMAL_NO_LOG)
 			return InvalidBuffer;
-		/* OK to extend the file */
-		/* we do this in recovery only - no rel-extension lock needed */
+		/*
+		 * OK to extend the file.  We do this in recovery only, so no
+		 * rel-extension lock is needed, unless parallel redo workers might be
+		 * extending the relation at the same time.
+		 */
 		Assert(InRecovery);
-		buffer = InvalidBuffer;
-		do
+		if (ParallelRedoActive)
 		{
-			if (buffer != InvalidBuffer)
+			fakerel = CreateFakeRelcacheEntry(rnode);
+			LockRelationForExtension(fakerel, ExclusiveLock);
+			lastblock = smgrnblocks(smgr, forknum);
+		}
+		if (blkno < lastblock)
+		{
+			/* somebody else extended it while we waited for the lock */
+			buffer = ReadBufferWithoutRelcache(rnode, forknum, blkno,
+											   mode, NULL);
+		}
+		else
+		{
+			buffer = InvalidBuffer;
+			do
+			{
+				if (buffer != InvalidBuffer)
+				{
+					if (mode == RBM_ZERO_AND_LOCK || mode == RBM_ZERO_AND_CLEANUP_LOCK)
+						LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+					ReleaseBuffer(buffer);
+				}
+				buffer = ReadBufferWithoutRelcache(rnode, forknum,
+												   P_NEW, mode, NULL);
+			}
+			while (BufferGetBlockNumber(buffer) < blkno);
+			/* Handle the corner case that P_NEW returns non-consecutive pages */
+			if (BufferGetBlockNumber(buffer) != blkno)
 			{
 				if (mode == RBM_ZERO_AND_LOCK || mode == RBM_ZERO_AND_CLEANUP_LOCK)
 					LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
 				ReleaseBuffer(buffer);
+				buffer = ReadBufferWithoutRelcache(rnode, forknum, blkno,
+												   mode, NULL);
 			}
-			buffer = ReadBufferWithoutRelcache(rnode, forknum,
-											   P_NEW, mode, NULL);
 		}
-		while (BufferGetBlockNumber(buffer) < blkno);
-		/* Handle the corner case that P_NEW returns non-consecutive pages */
-		if (BufferGetBlockNumber(buffer) != blkno)
+		if (fakerel != NULL)
 		{
-			if (mode == RBM_ZERO_AND_LOCK || mode == RBM_ZERO_AND_CLEANUP_LOCK)
-				LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
-			ReleaseBuffer(buffer);
-			buffer = ReadBufferWithoutRelcache(rnode, forknum, blkno,
-											   mode, NULL);
+			UnlockRelationForExtension(fakerel, ExclusiveLock);
+			FreeFakeRelcacheEntry(fakerel);
 		}
 	}
 
@@ -607,6 +701,7 @@ void
 XLogDropRelation(RelFileNode rnode, ForkNumber forknum)
 {
 	forget_invalid_pages(rnode, forknum, 0);
+	ParallelRedoInvalidateSmgr();
 }
 
 /*
@@ -626,6 +721,7 @@ XLogDropDatabase(Oid dbid)
 	smgrcloseall();
 
 	forget_invalid_pages_db(dbid);
+	ParallelRedoInvalidateSmgr();
 }
 
 /*
@@ -638,6 +734,7 @@ XLogTruncateRelation(RelFileNode rnode, ForkNumber forkNum,
 					 BlockNumber nblocks)
 {
 	forget_invalid_pages(rnode, forkNum, nblocks);
+	ParallelRedoInvalidateSmgr();
 }
 
 /*
@@ -21,6 +21,7 @@
 #include "access/hash.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/sysattr.h"
 #include "access/xact.h"
 
 #include "catalog/catalog.h"
@@ -34,6 +35,15 @@
 #include "catalog/pg_publication.h"
 #include "catalog/pg_publication_rel.h"
 
+#include "nodes/nodeFuncs.h"
+
+#include "optimizer/clauses.h"
+#include "optimizer/var.h"
+
+#include "parser/parse_clause.h"
+#include "parser/parse_collate.h"
+#include "parser/parse_relation.h"
+
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/catcache.h"
@@ -129,20 +139,136 @@ pg_relation_is_publishable(PG_FUNCTION_ARGS)
 }
 
 
+/* check_functions_in_node callback */
+static bool
+publication_where_func_check(Oid func_id, void *context)
+{
+	return func_id >= FirstNormalObjectId;
+}
+
+/* Does the expression use any user-defined function? */
+static bool
+contain_user_functions_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (check_functions_in_node(node, publication_where_func_check, context))
+		return true;
+
+	return expression_tree_walker(node, contain_user_functions_walker,
+								  context);
+}
+
+/*
+ * Transform the row filter of a table.
+ *
+ * The filter is evaluated while decoding, when the catalogs are only
+ * available as they were at the time of the change, and nothing else is, so
+ * it may only use the table's columns and immutable built-in functions.
+ */
+static Node *
+transform_publication_where(Relation targetrel, Node *whereClause)
+{
+	ParseState *pstate;
+	RangeTblEntry *rte;
+	Node	   *qual;
+	Bitmapset  *attrs = NULL;
+	int			attnum;
+
+	pstate = make_parsestate(NULL);
+	rte = addRangeTableEntryForRelation(pstate, targetrel, NULL, false, false);
+	addRTEtoQuery(pstate, rte, false, true, true);
+
+	qual = transformWhereClause(pstate, copyObject(whereClause),
+								EXPR_KIND_PUBLICATION_WHERE,
+								"PUBLICATION WHERE");
+	assign_expr_collations(pstate, qual);
+
+	if (contain_mutable_functions(qual))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+				 errmsg("functions in publication WHERE expression must be marked IMMUTABLE")));
+
+	if (contain_user_functions_walker(qual, NULL))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("user-defined functions and operators are not allowed in publication WHERE expressions")));
+
+	/* System columns and whole-row references sort first. */
+	pull_varattnos(qual, 1, &attrs);
+	attnum = bms_next_member(attrs, -1);
+	if (attnum >= 0 && attnum + FirstLowInvalidHeapAttributeNumber <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+				 errmsg("system columns and whole-row references are not allowed in publication WHERE expressions")));
+
+	free_parsestate(pstate);
+
+	return qual;
+}
+
+/*
+ * Translate the column list of a table into attribute numbers, in order.
+ */
+static int2vector *
+publication_translate_columns(Relation targetrel, List *columns)
+{
+	Bitmapset  *attrs = NULL;
+	int16	   *attnums;
+	int			n = 0;
+	int			attnum;
+	ListCell   *lc;
+
+	foreach(lc, columns)
+	{
+		char	   *colname = strVal(lfirst(lc));
+
+		attnum = get_attnum(RelationGetRelid(targetrel), colname);
+		if (attnum == InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("column \"%s\" of relation \"%s\" does not exist",
+							colname, RelationGetRelationName(targetrel))));
+		if (attnum < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot use system column \"%s\" in publication column list",
+							colname)));
+		if (bms_is_member(attnum, attrs))
+			ereport(ERROR,
+					(errcode(ERRCODE_DUPLICATE_OBJECT),
+					 errmsg("duplicate column \"%s\" in publication column list",
+							colname)));
+
+		attrs = bms_add_member(attrs, attnum);
+	}
+
+	attnums = palloc(list_length(columns) * sizeof(int16));
+	attnum = -1;
+	while ((attnum = bms_next_member(attrs, attnum)) >= 0)
+		attnums[n++] = attnum;
+
+	return buildint2vector(attnums, n);
+}
+
 /*
  * Insert new publication / relation mapping.
  */
 ObjectAddress
-publication_add_relation(Oid pubid, Relation targetrel,
+publication_add_relation(Oid pubid, PublicationRelInfo *pri,
 						 bool if_not_exists)
 {
 	Relation	rel;
 	HeapTuple	tup;
 	Datum		values[Natts_pg_publication_rel];
 	bool		nulls[Natts_pg_publication_rel];
+	Relation	targetrel = pri->relation;
 	Oid			relid = RelationGetRelid(targetrel);
 	Oid			prrelid;
 	Publication *pub = GetPublication(pubid);
+	Node	   *qual = NULL;
+	int2vector *attrs = NULL;
 	ObjectAddress myself,
 				referenced;
 
@@ -178,6 +304,23 @@ publication_add_relation(Oid pubid, Relation targetrel,
 	values[Anum_pg_publication_rel_prrelid - 1] =
 		ObjectIdGetDatum(relid);
 
+	if (pri->whereClause)
+	{
+		qual = transform_publication_where(targetrel, pri->whereClause);
+		values[Anum_pg_publication_rel_prqual - 1] =
+			CStringGetTextDatum(nodeToString(qual));
+	}
+	else
+		nulls[Anum_pg_publication_rel_prqual - 1] = true;
+
+	if (pri->columns)
+	{
+		attrs = publication_translate_columns(targetrel, pri->columns);
+		values[Anum_pg_publication_rel_prattrs - 1] = PointerGetDatum(attrs);
+	}
+	else
+		nulls[Anum_pg_publication_rel_prattrs - 1] = true;
+
 	tup = heap_form_tuple(RelationGetDescr(rel), values, nulls);
 
 	/* Insert tuple into catalog. */
@@ -194,6 +337,27 @@ publication_add_relation(Oid pubid, Relation targetrel,
 	ObjectAddressSet(referenced, RelationRelationId, relid);
 	recordDependencyOn(&myself, &referenced, DEPENDENCY_AUTO);
 
+	/*
+	 * Columns used by the row filter or in the column list can only be
+	 * dropped together with the table's membership in the publication.
+	 */
+	if (qual)
+		recordDependencyOnSingleRelExpr(&myself, qual, relid,
+										DEPENDENCY_NORMAL, DEPENDENCY_NORMAL,
+										false);
+
+	if (attrs)
+	{
+		int			i;
+
+		for (i = 0; i < attrs->dim1; i++)
+		{
+			ObjectAddressSubSet(referenced, RelationRelationId, relid,
+								attrs->values[i]);
+			recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+		}
+	}
+
 	/* Close the table. */
 	heap_close(rel, RowExclusiveLock);
 
@@ -867,6 +867,17 @@ CREATE VIEW pg_stat_archiver AS
         s.stats_reset
     FROM pg_stat_get_archiver() s;
 
+CREATE VIEW pg_stat_recovery_prefetch AS
+    SELECT
+        s.prefetch,
+        s.skip_hit,
+        s.skip_new,
+        s.skip_fpw,
+        s.skip_init,
+        s.skip_rep,
+        s.wal_distance
+    FROM pg_stat_get_recovery_prefetch() s;
+
 CREATE VIEW pg_stat_bgwriter AS
     SELECT
         pg_stat_get_bgwriter_timed_checkpoints() AS checkpoints_timed,
@@ -931,7 +942,8 @@ REVOKE ALL ON pg_replication_origin_status FROM public;
 
 -- All columns of pg_subscription except subconninfo are readable.
 REVOKE ALL ON pg_subscription FROM public;
-GRANT SELECT (subdbid, subname, subowner, subenabled, subslotname, subpublications)
+GRANT SELECT (subdbid, subname, subowner, subenabled, substream,
+              subbinary, subslotname, subpublications)
     ON pg_subscription TO public;
 
 
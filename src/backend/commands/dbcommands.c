@@ -942,6 +942,9 @@ dropdb(const char *dbname, bool missing_ok)
 	 */
 	ForgetDatabaseFsyncRequests(db_id);
 
+	/* Likewise, forget the cached sizes of its relations */
+	smgrsize_drop_db(db_id);
+
 	/*
 	 * Force a checkpoint to make sure the checkpointer has received the
 	 * message sent by ForgetDatabaseFsyncRequests. On Windows, this also
@@ -1206,6 +1209,9 @@ movedb(const char *dbname, const char *tblspcname)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/* The cached sizes of the relations in the old location go too */
+	smgrsize_drop_db(db_id);
+
 	/*
 	 * Check for existence of files in the target directory, i.e., objects of
 	 * this database that are already in the target tablespace.  We can't
@@ -2105,6 +2111,9 @@ dbase_redo(XLogReaderState *record)
 								dst_path)));
 		}
 
+		/* Any cached relation sizes for the old directory are now wrong */
+		smgrsize_drop_db(xlrec->db_id);
+
 		/*
 		 * Force dirty buffers out to disk, to ensure source database is
 		 * up-to-date for the copy.
@@ -2150,6 +2159,9 @@ dbase_redo(XLogReaderState *record)
 		/* Also, clean out any fsync requests that might be pending in md.c */
 		ForgetDatabaseFsyncRequests(xlrec->db_id);
 
+		/* And any relation sizes cached by smgr */
+		smgrsize_drop_db(xlrec->db_id);
+
 		/* Clean out the xlog relcache too */
 		XLogDropDatabase(xlrec->db_id);
 
@@ -336,40 +336,23 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 		List	   *delrels = NIL;
 		ListCell   *oldlc;
 
-		/* Calculate which relations to drop. */
+		/*
+		 * Drop all the current relations, including the ones that stay, as
+		 * their row filters and column lists may change.
+		 */
 		foreach(oldlc, oldrelids)
 		{
 			Oid			oldrelid = lfirst_oid(oldlc);
-			ListCell   *newlc;
-			bool		found = false;
-
-			foreach(newlc, rels)
-			{
-				Relation	newrel = (Relation) lfirst(newlc);
-
-				if (RelationGetRelid(newrel) == oldrelid)
-				{
-					found = true;
-					break;
-				}
-			}
-
-			if (!found)
-			{
-				Relation	oldrel = heap_open(oldrelid,
-											   ShareUpdateExclusiveLock);
+			PublicationRelInfo *oldrel;
 
-				delrels = lappend(delrels, oldrel);
-			}
+			oldrel = palloc0(sizeof(PublicationRelInfo));
+			oldrel->relation = heap_open(oldrelid, ShareUpdateExclusiveLock);
+			delrels = lappend(delrels, oldrel);
 		}
 
-		/* And drop them. */
 		PublicationDropTables(pubid, delrels, true);
 
-		/*
-		 * Don't bother calculating the difference for adding, we'll catch and
-		 * skip existing ones when doing catalog update.
-		 */
+		/* And add the new ones back. */
 		PublicationAddTables(pubid, rels, true, stmt);
 
 		CloseTableList(delrels);
@@ -470,8 +453,10 @@ RemovePublicationRelById(Oid proid)
 }
 
 /*
- * Open relations based on provided by RangeVar list.
- * The returned tables are locked in ShareUpdateExclusiveLock mode.
+ * Open relations based on provided list of PublicationTable or RangeVar.
+ * The returned list contains PublicationRelInfo entries, whose tables are
+ * locked in ShareUpdateExclusiveLock mode.  Inheritance children share the
+ * row filter and column list of their parent.
  */
 static List *
 OpenTableList(List *tables)
@@ -485,10 +470,25 @@ OpenTableList(List *tables)
 	 */
 	foreach(lc, tables)
 	{
-		RangeVar   *rv = lfirst(lc);
+		RangeVar   *rv;
+		List	   *columns = NIL;
+		Node	   *whereClause = NULL;
 		Relation	rel;
-		bool		recurse = rv->inh;
+		bool		recurse;
 		Oid			myrelid;
+		PublicationRelInfo *pri;
+
+		if (IsA(lfirst(lc), PublicationTable))
+		{
+			PublicationTable *pt = (PublicationTable *) lfirst(lc);
+
+			rv = pt->relation;
+			columns = pt->columns;
+			whereClause = pt->whereClause;
+		}
+		else
+			rv = castNode(RangeVar, lfirst(lc));
+		recurse = rv->inh;
 
 		CHECK_FOR_INTERRUPTS();
 
@@ -507,7 +507,11 @@ OpenTableList(List *tables)
 			heap_close(rel, ShareUpdateExclusiveLock);
 			continue;
 		}
-		rels = lappend(rels, rel);
+		pri = palloc(sizeof(PublicationRelInfo));
+		pri->relation = rel;
+		pri->columns = columns;
+		pri->whereClause = whereClause;
+		rels = lappend(rels, pri);
 		relids = lappend_oid(relids, myrelid);
 
 		if (recurse)
@@ -537,7 +541,11 @@ OpenTableList(List *tables)
 
 				/* find_all_inheritors already got lock */
 				rel = heap_open(childrelid, NoLock);
-				rels = lappend(rels, rel);
+				pri = palloc(sizeof(PublicationRelInfo));
+				pri->relation = rel;
+				pri->columns = columns;
+				pri->whereClause = whereClause;
+				rels = lappend(rels, pri);
 				relids = lappend_oid(relids, childrelid);
 			}
 		}
@@ -558,9 +566,9 @@ CloseTableList(List *rels)
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
 
-		heap_close(rel, NoLock);
+		heap_close(pri->relation, NoLock);
 	}
 }
 
@@ -577,7 +585,8 @@ PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
+		Relation	rel = pri->relation;
 		ObjectAddress obj;
 
 		/* Must be owner of the table or superuser. */
@@ -585,7 +594,7 @@ PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 			aclcheck_error(ACLCHECK_NOT_OWNER, ACL_KIND_CLASS,
 						   RelationGetRelationName(rel));
 
-		obj = publication_add_relation(pubid, rel, if_not_exists);
+		obj = publication_add_relation(pubid, pri, if_not_exists);
 		if (stmt)
 		{
 			EventTriggerCollectSimpleCommand(obj, InvalidObjectAddress,
@@ -609,7 +618,8 @@ PublicationDropTables(Oid pubid, List *rels, bool missing_ok)
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
+		Relation	rel = pri->relation;
 		Oid			relid = RelationGetRelid(rel);
 
 		prid = GetSysCacheOid2(PUBLICATIONRELMAP, ObjectIdGetDatum(relid),
@@ -0,0 +1,406 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeIncrementalSort.c
+ *	  Routines to handle incremental sorting of relations.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * DESCRIPTION
+ *	  The Incremental Sort node is used when the input is already sorted
+ *	  on a leading prefix of the requested sort keys.  For example, if the
+ *	  input is sorted by (a) and we need (a, b), tuples with equal values
+ *	  of "a" are adjacent, so each such group can be sorted by itself.
+ *
+ *	  Sorting many tiny groups one at a time would spend most of its effort
+ *	  in tuplesort setup, so tuples are collected into batches of at least
+ *	  INCREMENTALSORT_MIN_GROUP_SIZE tuples.  A batch is only ended where
+ *	  the presorted columns change value; it is then sorted on the full sort
+ *	  key, which yields the correct order for all the groups it contains.
+ *
+ *	  Because a batch can be returned as soon as it is sorted, the first
+ *	  tuples come out long before the input has been fully read, and a
+ *	  bounded sort (under LIMIT) reads only as much input as it needs.
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeIncrementalSort.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "executor/execdebug.h"
+#include "executor/executor.h"
+#include "executor/nodeIncrementalSort.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/tuplesort.h"
+
+
+/*
+ * Check whether the presorted columns of "slot" match those of the current
+ * batch's pivot tuple.
+ */
+static bool
+isCurrentGroup(IncrementalSortState *node, TupleTableSlot *slot)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+
+	return execTuplesMatch(node->group_pivot_slot, slot,
+						   node->nPresortedCols,
+						   plannode->sort.sortColIdx,
+						   node->eqfunctions,
+						   node->ss.ps.ps_ExprContext->ecxt_per_tuple_memory);
+}
+
+/*
+ * Record the space used by the batch that was just sorted, for EXPLAIN.
+ */
+static void
+instrumentSortedBatch(IncrementalSortState *node)
+{
+	TuplesortInstrumentation stats;
+
+	tuplesort_get_stats((Tuplesortstate *) node->tuplesortstate, &stats);
+
+	/* Disk usage trumps memory usage, as in tuplesort itself */
+	if ((stats.spaceType == SORT_SPACE_TYPE_DISK &&
+		 node->maxSpaceType != SORT_SPACE_TYPE_DISK) ||
+		(stats.spaceType == node->maxSpaceType &&
+		 stats.spaceUsed > node->maxSpaceUsed))
+	{
+		node->maxSpaceUsed = stats.spaceUsed;
+		node->maxSpaceType = stats.spaceType;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		Collects the next batch of tuples from the outer subtree, sorts it
+ *		with tuplesort, and returns the sorted tuples one at a time.  When
+ *		the batch is exhausted the next one is collected.
+ *
+ *		Conditions:
+ *		  -- the outer subtree returns tuples sorted on the first
+ *			 nPresortedCols sort columns.
+ *
+ *		Initial States:
+ *		  -- the outer child is prepared to return the first tuple.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecIncrementalSort(PlanState *pstate)
+{
+	IncrementalSortState *node = castNode(IncrementalSortState, pstate);
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	EState	   *estate;
+	ScanDirection dir;
+	Tuplesortstate *tuplesortstate;
+	PlanState  *outerNode;
+	TupleTableSlot *slot;
+	int64		nTuples;
+
+	CHECK_FOR_INTERRUPTS();
+
+	estate = node->ss.ps.state;
+	dir = estate->es_direction;
+	tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
+
+	/*
+	 * If a sorted batch is in progress, return its next tuple.  Once it runs
+	 * dry, either we are done or we go on to collect the next batch.
+	 */
+	if (node->sort_Done)
+	{
+		slot = node->ss.ps.ps_ResultTupleSlot;
+		if (tuplesort_gettupleslot(tuplesortstate,
+								   ScanDirectionIsForward(dir),
+								   false, slot, NULL))
+		{
+			node->bound_Done++;
+			return slot;
+		}
+
+		if (node->input_Done ||
+			(node->bounded && node->bound_Done >= node->bound))
+			return slot;
+
+		node->sort_Done = false;
+	}
+
+	SO1_printf("ExecIncrementalSort: %s\n",
+			   "collecting next batch");
+
+	/*
+	 * Want to scan subplan in the forward direction while creating the
+	 * sorted data.
+	 */
+	estate->es_direction = ForwardScanDirection;
+	outerNode = outerPlanState(node);
+
+	/*
+	 * Each batch gets a fresh tuplesort.  Only the part of the bound not yet
+	 * satisfied by earlier batches applies to this one.
+	 */
+	if (tuplesortstate != NULL)
+		tuplesort_end(tuplesortstate);
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->sort.numCols,
+										  plannode->sort.sortColIdx,
+										  plannode->sort.sortOperators,
+										  plannode->sort.collations,
+										  plannode->sort.nullsFirst,
+										  work_mem,
+										  false);
+	node->tuplesortstate = (void *) tuplesortstate;
+	if (node->bounded)
+		tuplesort_set_bound(tuplesortstate, node->bound - node->bound_Done);
+
+	/* Start with the tuple that ended the previous batch, if any */
+	nTuples = 0;
+	if (!TupIsNull(node->transfer_slot))
+	{
+		tuplesort_puttupleslot(tuplesortstate, node->transfer_slot);
+		ExecCopySlot(node->group_pivot_slot, node->transfer_slot);
+		ExecClearTuple(node->transfer_slot);
+		nTuples++;
+	}
+
+	for (;;)
+	{
+		slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+		{
+			node->input_Done = true;
+			break;
+		}
+
+		/*
+		 * Below the minimum batch size we take everything.  Past it, the
+		 * batch ends at the first tuple whose presorted columns differ from
+		 * the pivot, which is the tuple that brought us to the minimum.
+		 */
+		if (nTuples < INCREMENTALSORT_MIN_GROUP_SIZE)
+		{
+			tuplesort_puttupleslot(tuplesortstate, slot);
+			nTuples++;
+			if (nTuples == INCREMENTALSORT_MIN_GROUP_SIZE)
+				ExecCopySlot(node->group_pivot_slot, slot);
+		}
+		else if (isCurrentGroup(node, slot))
+		{
+			tuplesort_puttupleslot(tuplesortstate, slot);
+			nTuples++;
+		}
+		else
+		{
+			ExecCopySlot(node->transfer_slot, slot);
+			break;
+		}
+	}
+
+	tuplesort_performsort(tuplesortstate);
+	instrumentSortedBatch(node);
+	node->groupsCount++;
+
+	/*
+	 * restore to user specified direction
+	 */
+	estate->es_direction = dir;
+
+	node->sort_Done = true;
+
+	SO1_printf("ExecIncrementalSort: %s\n", "batch sorted");
+
+	slot = node->ss.ps.ps_ResultTupleSlot;
+	if (tuplesort_gettupleslot(tuplesortstate,
+							   ScanDirectionIsForward(dir),
+							   false, slot, NULL))
+		node->bound_Done++;
+	return slot;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitIncrementalSort
+ *
+ *		Creates the run-time state information for the incremental sort
+ *		node produced by the planner and initializes its outer subtree.
+ * ----------------------------------------------------------------
+ */
+IncrementalSortState *
+ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
+{
+	IncrementalSortState *incrsortstate;
+	Oid		   *eqOperators;
+	int			i;
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "initializing sort node");
+
+	/*
+	 * Incremental sort cannot support backward scan or mark/restore, since
+	 * only the current batch is ever materialized.
+	 */
+	Assert((eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0);
+
+	/*
+	 * create state structure
+	 */
+	incrsortstate = makeNode(IncrementalSortState);
+	incrsortstate->ss.ps.plan = (Plan *) node;
+	incrsortstate->ss.ps.state = estate;
+	incrsortstate->ss.ps.ExecProcNode = ExecIncrementalSort;
+
+	incrsortstate->bounded = false;
+	incrsortstate->sort_Done = false;
+	incrsortstate->input_Done = false;
+	incrsortstate->bound_Done = 0;
+	incrsortstate->nPresortedCols = node->nPresortedCols;
+	incrsortstate->tuplesortstate = NULL;
+	incrsortstate->groupsCount = 0;
+	incrsortstate->maxSpaceUsed = 0;
+	incrsortstate->maxSpaceType = SORT_SPACE_TYPE_MEMORY;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * We need an ExprContext only for its per-tuple memory, which
+	 * execTuplesMatch uses when comparing the presorted columns.
+	 */
+	ExecAssignExprContext(estate, &incrsortstate->ss.ps);
+
+	/*
+	 * tuple table initialization
+	 *
+	 * incremental sort nodes only return scan tuples from their sorted
+	 * relation.
+	 */
+	ExecInitResultTupleSlot(estate, &incrsortstate->ss.ps);
+	ExecInitScanTupleSlot(estate, &incrsortstate->ss);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * We shield the child node from the need to support REWIND, BACKWARD, or
+	 * MARK/RESTORE.
+	 */
+	eflags &= ~(EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK);
+
+	outerPlanState(incrsortstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * initialize tuple type.  no need to initialize projection info because
+	 * this node doesn't do projections.
+	 */
+	ExecAssignResultTypeFromTL(&incrsortstate->ss.ps);
+	ExecAssignScanTypeFromOuterPlan(&incrsortstate->ss);
+	incrsortstate->ss.ps.ps_ProjInfo = NULL;
+
+	/* Slots for the batch pivot and for carrying a tuple to the next batch */
+	incrsortstate->group_pivot_slot =
+		ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(incrsortstate->group_pivot_slot,
+						  ExecGetResultType(outerPlanState(incrsortstate)));
+	incrsortstate->transfer_slot =
+		ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(incrsortstate->transfer_slot,
+						  ExecGetResultType(outerPlanState(incrsortstate)));
+
+	/*
+	 * Precompute fmgr lookup data for comparing the presorted columns.  The
+	 * planner only builds pathkeys from btree-compatible sort operators, so
+	 * an equality operator always exists.
+	 */
+	eqOperators = (Oid *) palloc(node->nPresortedCols * sizeof(Oid));
+	for (i = 0; i < node->nPresortedCols; i++)
+	{
+		eqOperators[i] =
+			get_equality_op_for_ordering_op(node->sort.sortOperators[i],
+											NULL);
+		if (!OidIsValid(eqOperators[i]))
+			elog(ERROR, "missing equality operator for ordering operator %u",
+				 node->sort.sortOperators[i]);
+	}
+	incrsortstate->eqfunctions =
+		execTuplesMatchPrepare(node->nPresortedCols, eqOperators);
+	pfree(eqOperators);
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "sort node initialized");
+
+	return incrsortstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndIncrementalSort(node)
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndIncrementalSort(IncrementalSortState *node)
+{
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "shutting down sort node");
+
+	/*
+	 * Free the exprcontext
+	 */
+	ExecFreeExprContext(&node->ss.ps);
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	/* must drop pointer to sort result tuple */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot_slot);
+	ExecClearTuple(node->transfer_slot);
+
+	/*
+	 * Release tuplesort resources
+	 */
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "sort node shutdown");
+}
+
+void
+ExecReScanIncrementalSort(IncrementalSortState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/*
+	 * Only the current batch is ever held, so there is nothing to rewind;
+	 * forget all progress and re-read the subplan from the start.
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot_slot);
+	ExecClearTuple(node->transfer_slot);
+
+	if (node->tuplesortstate != NULL)
+	{
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+		node->tuplesortstate = NULL;
+	}
+	node->sort_Done = false;
+	node->input_Done = false;
+	node->bound_Done = 0;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
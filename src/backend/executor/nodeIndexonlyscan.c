@@ -112,6 +112,17 @@ IndexOnlyNext(IndexOnlyScanState *node)
 						 node->ioss_NumOrderByKeys);
 	}
 
+	/*
+	 * If we only want the first tuple for each distinct key prefix, skip
+	 * past the rest of the entries sharing the one we returned last.
+	 */
+	if (node->ioss_SkipPrefixSize > 0 && node->ioss_TupleReturned)
+	{
+		node->ioss_TupleReturned = false;
+		if (!index_skip(scandesc, direction, node->ioss_SkipPrefixSize))
+			return ExecClearTuple(slot);
+	}
+
 	/*
 	 * OK, now that we have what we need, fetch the next tuple.
 	 */
@@ -248,6 +259,7 @@ IndexOnlyNext(IndexOnlyScanState *node)
 							  ItemPointerGetBlockNumber(tid),
 							  estate->es_snapshot);
 
+		node->ioss_TupleReturned = true;
 		return slot;
 	}
 
@@ -354,6 +366,7 @@ ExecReScanIndexOnlyScan(IndexOnlyScanState *node)
 								 node->ioss_NumRuntimeKeys);
 	}
 	node->ioss_RuntimeKeysReady = true;
+	node->ioss_TupleReturned = false;
 
 	/* reset index scan */
 	if (node->ioss_ScanDesc)
@@ -466,6 +479,8 @@ ExecInitIndexOnlyScan(IndexOnlyScan *node, EState *estate, int eflags)
 	indexstate->ss.ps.state = estate;
 	indexstate->ss.ps.ExecProcNode = ExecIndexOnlyScan;
 	indexstate->ioss_HeapFetches = 0;
+	indexstate->ioss_SkipPrefixSize = node->indexskipprefix;
+	indexstate->ioss_TupleReturned = false;
 
 	/*
 	 * Miscellaneous initialization
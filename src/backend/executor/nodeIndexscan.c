@@ -1153,8 +1153,12 @@ ExecIndexBuildScanKeys(PlanState *planstate, Relation index,
 	int			n_runtime_keys;
 	int			max_runtime_keys;
 	int			n_array_keys;
+	int			indnkeyatts;
 	int			j;
 
+	/* Only key columns can be searched on */
+	indnkeyatts = IndexRelationGetNumberOfKeyAttributes(index);
+
 	/* Allocate array for ScanKey structs: one per qual */
 	n_scan_keys = list_length(quals);
 	scan_keys = (ScanKey) palloc(n_scan_keys * sizeof(ScanKeyData));
@@ -1217,7 +1221,7 @@ ExecIndexBuildScanKeys(PlanState *planstate, Relation index,
 				elog(ERROR, "indexqual doesn't have key on left side");
 
 			varattno = ((Var *) leftop)->varattno;
-			if (varattno < 1 || varattno > index->rd_index->indnatts)
+			if (varattno < 1 || varattno > indnkeyatts)
 				elog(ERROR, "bogus index qualification");
 
 			/*
@@ -1340,7 +1344,7 @@ ExecIndexBuildScanKeys(PlanState *planstate, Relation index,
 				opnos_cell = lnext(opnos_cell);
 
 				if (index->rd_rel->relam != BTREE_AM_OID ||
-					varattno < 1 || varattno > index->rd_index->indnatts)
+					varattno < 1 || varattno > indnkeyatts)
 					elog(ERROR, "bogus RowCompare index qualification");
 				opfamily = index->rd_opfamily[varattno - 1];
 
@@ -1464,7 +1468,7 @@ ExecIndexBuildScanKeys(PlanState *planstate, Relation index,
 				elog(ERROR, "indexqual doesn't have key on left side");
 
 			varattno = ((Var *) leftop)->varattno;
-			if (varattno < 1 || varattno > index->rd_index->indnatts)
+			if (varattno < 1 || varattno > indnkeyatts)
 				elog(ERROR, "bogus index qualification");
 
 			/*
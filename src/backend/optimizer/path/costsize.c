@@ -81,6 +81,7 @@
 #include "access/tsmapi.h"
 #include "executor/executor.h"
 #include "executor/nodeHash.h"
+#include "executor/nodeIncrementalSort.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
@@ -118,9 +119,11 @@ int			max_parallel_workers_per_gather = 2;
 bool		enable_seqscan = true;
 bool		enable_indexscan = true;
 bool		enable_indexonlyscan = true;
+bool		enable_indexskipscan = true;
 bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
+bool		enable_incrementalsort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
@@ -732,6 +735,55 @@ cost_index(IndexPath *path, PlannerInfo *root, double loop_count,
 	path->path.total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_index_skip
+ *	  Adjusts the cost of an index-only scan path for skipping.
+ *
+ * 'path' is a copy of a path already costed by cost_index(), with
+ *		indexskipprefix set; 'numgroups' is the estimated number of distinct
+ *		values of the skipped-on columns among the rows it would return
+ *
+ * We assume the scan fetches just one row per group, at the average
+ * per-row cost of the full scan.  If the groups are larger than an index
+ * page, getting from one to the next also takes a fresh descent of the
+ * index, which we charge like btcostestimate() does plus a random fetch of
+ * the leaf page.
+ */
+void
+cost_index_skip(IndexPath *path, PlannerInfo *root, double numgroups)
+{
+	IndexOptInfo *index = path->indexinfo;
+	double		rows = path->path.rows;
+	Cost		run_cost;
+	double		spc_random_page_cost;
+
+	Assert(path->path.pathtype == T_IndexOnlyScan);
+	Assert(path->indexskipprefix > 0);
+
+	numgroups = clamp_row_est(Min(numgroups, rows));
+
+	run_cost = (path->path.total_cost - path->path.startup_cost) *
+		numgroups / rows;
+
+	if (index->pages > 1 && rows / numgroups > index->tuples / index->pages)
+	{
+		Cost		descent_cost;
+
+		get_tablespace_page_costs(index->reltablespace,
+								  &spc_random_page_cost,
+								  NULL);
+		descent_cost = spc_random_page_cost +
+			(index->tree_height + 1) * 50.0 * cpu_operator_cost;
+		if (index->tuples > 1)
+			descent_cost += ceil(log(index->tuples) / log(2.0)) *
+				cpu_operator_cost;
+		run_cost += numgroups * descent_cost;
+	}
+
+	path->path.rows = numgroups;
+	path->path.total_cost = path->path.startup_cost + run_cost;
+}
+
 /*
  * extract_nonindex_conditions
  *
@@ -1740,6 +1792,111 @@ cost_sort(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_incremental_sort
+ *	  Determines and returns the cost of sorting a relation incrementally,
+ *	  when the input path is already sorted by some of the pathkeys.
+ *
+ * The input is split into groups of equal values of the first
+ * 'presorted_keys' pathkeys, and each group is sorted separately, so the
+ * cost is that of many small sorts rather than one big one.  The executor
+ * never sorts fewer than INCREMENTALSORT_MIN_GROUP_SIZE tuples at a time,
+ * so smaller estimated groups are treated as merged up to that size.
+ *
+ * Only the first group has to be read and sorted before the first tuple can
+ * be returned, which is what makes this attractive under a LIMIT.
+ *
+ * 'presorted_keys' is the number of leading pathkeys the input is sorted by;
+ * the other arguments are as for cost_sort, except that both the startup
+ * and total cost of the input are needed.
+ */
+void
+cost_incremental_sort(Path *path, PlannerInfo *root,
+					  List *pathkeys, int presorted_keys,
+					  Cost input_startup_cost, Cost input_total_cost,
+					  double input_tuples, int width, Cost comparison_cost,
+					  int sort_mem)
+{
+	Cost		startup_cost = 0,
+				run_cost = 0,
+				input_run_cost = input_total_cost - input_startup_cost;
+	double		group_tuples,
+				input_groups;
+	Cost		group_startup_cost,
+				group_run_cost,
+				group_input_run_cost;
+	List	   *presortedExprs = NIL;
+	ListCell   *l;
+	int			i = 0;
+	Path		sort_path;		/* dummy for result of cost_sort */
+
+	Assert(presorted_keys > 0 && presorted_keys < list_length(pathkeys));
+
+	/*
+	 * We want to be sure the cost of a sort is never estimated as zero, even
+	 * if passed-in tuple count is zero.  Besides, mustn't do log(0)...
+	 */
+	if (input_tuples < 2.0)
+		input_tuples = 2.0;
+
+	/* Estimate the number of groups of equal presorted keys */
+	foreach(l, pathkeys)
+	{
+		PathKey    *key = (PathKey *) lfirst(l);
+		EquivalenceMember *member = (EquivalenceMember *)
+		linitial(key->pk_eclass->ec_members);
+
+		presortedExprs = lappend(presortedExprs, member->em_expr);
+
+		if (++i >= presorted_keys)
+			break;
+	}
+
+	input_groups = estimate_num_groups(root, presortedExprs, input_tuples,
+									   NULL);
+	group_tuples = input_tuples / input_groups;
+
+	/* Small groups are batched together by the executor */
+	if (group_tuples < INCREMENTALSORT_MIN_GROUP_SIZE)
+	{
+		group_tuples = Min(input_tuples, INCREMENTALSORT_MIN_GROUP_SIZE);
+		input_groups = ceil(input_tuples / group_tuples);
+	}
+
+	/* Estimate the cost of sorting one group */
+	cost_sort(&sort_path, root, NIL, 0.0, group_tuples, width,
+			  comparison_cost, sort_mem, -1.0);
+	group_startup_cost = sort_path.startup_cost;
+	group_run_cost = sort_path.total_cost - sort_path.startup_cost;
+
+	/* This is governed by enable_incrementalsort, not enable_sort */
+	if (!enable_sort)
+		group_startup_cost -= disable_cost;
+	group_input_run_cost = input_run_cost / input_groups;
+
+	/*
+	 * We must read and sort the whole first group before returning anything.
+	 */
+	startup_cost = input_startup_cost + group_startup_cost +
+		group_input_run_cost;
+
+	/* The remaining groups are read and sorted as the output is consumed */
+	run_cost = group_run_cost +
+		(group_startup_cost + group_run_cost + group_input_run_cost) *
+		(input_groups - 1);
+
+	/*
+	 * Charge for checking the presorted keys of each input tuple against the
+	 * current group, and a small amount per group for resetting the sort.
+	 */
+	run_cost += cpu_operator_cost * presorted_keys * input_tuples;
+	run_cost += 2.0 * cpu_tuple_cost * input_groups;
+
+	path->rows = input_tuples;
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * cost_merge_append
  *	  Determines and returns the cost of a MergeAppend node.
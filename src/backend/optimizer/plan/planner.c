@@ -164,6 +164,8 @@ static void create_one_window_path(PlannerInfo *root,
 					   List *activeWindows);
 static RelOptInfo *create_distinct_paths(PlannerInfo *root,
 					  RelOptInfo *input_rel);
+static Path *create_distinct_skip_path(PlannerInfo *root, Path *path,
+						  double numDistinctRows);
 static RelOptInfo *create_ordered_paths(PlannerInfo *root,
 					 RelOptInfo *input_rel,
 					 PathTarget *target,
@@ -4810,11 +4812,26 @@ create_distinct_paths(PlannerInfo *root,
 
 			if (pathkeys_contained_in(needed_pathkeys, path->pathkeys))
 			{
+				Path	   *skip_path;
+
 				add_path(distinct_rel, (Path *)
 						 create_upper_unique_path(root, distinct_rel,
 												  path,
 												  list_length(root->distinct_pathkeys),
 												  numDistinctRows));
+
+				/*
+				 * If the path is an index-only scan that can skip straight
+				 * from one distinct value to the next, try that too.
+				 */
+				skip_path = create_distinct_skip_path(root, path,
+													  numDistinctRows);
+				if (skip_path != NULL)
+					add_path(distinct_rel, (Path *)
+							 create_upper_unique_path(root, distinct_rel,
+													  skip_path,
+													  list_length(root->distinct_pathkeys),
+													  numDistinctRows));
 			}
 		}
 
@@ -4918,14 +4935,105 @@ create_distinct_paths(PlannerInfo *root,
 	return distinct_rel;
 }
 
+/*
+ * create_distinct_skip_path
+ *
+ * Build a variant of a suitably presorted input path for DISTINCT that
+ * returns only the first row for each distinct value, by skipping over the
+ * rest in the index.  This is possible when the input is an index-only scan
+ * whose leading index columns cover all the DISTINCT keys, and whose index
+ * AM supports amskip.  Returns NULL if the path can't be used this way.
+ *
+ * The DISTINCT keys need not be exactly the first index columns: columns
+ * the path's pathkeys skip over because they're known constant can come in
+ * between, since skipping on them as well changes nothing.
+ */
+static Path *
+create_distinct_skip_path(PlannerInfo *root, Path *path,
+						  double numDistinctRows)
+{
+	IndexPath  *ipath;
+	IndexOptInfo *index;
+	int			skipprefix = 0;
+	ListCell   *lc;
+
+	if (!enable_indexskipscan ||
+		!IsA(path, IndexPath) ||
+		path->pathtype != T_IndexOnlyScan ||
+		path->parallel_aware ||
+		path->param_info != NULL ||
+		root->distinct_pathkeys == NIL)
+		return NULL;
+
+	ipath = (IndexPath *) path;
+	index = ipath->indexinfo;
+	if (!index->amhasskip)
+		return NULL;
+
+	/*
+	 * A restriction clause that the index doesn't enforce would be checked
+	 * only after we'd already skipped past the rest of the row's group, so
+	 * we can't allow any.  Nor do we try to skip when there's a
+	 * ScalarArrayOpExpr qual; the AM won't do it anyway.
+	 */
+	foreach(lc, index->rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		if (!rinfo->pseudoconstant &&
+			!list_member_ptr(ipath->indexclauses, rinfo))
+			return NULL;
+	}
+	foreach(lc, ipath->indexquals)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		if (IsA(rinfo->clause, ScalarArrayOpExpr))
+			return NULL;
+	}
+
+	/* Find the index column matching each DISTINCT key */
+	foreach(lc, root->distinct_pathkeys)
+	{
+		PathKey    *pathkey = lfirst_node(PathKey, lc);
+		bool		found = false;
+		int			indexcol;
+
+		for (indexcol = 0; indexcol < index->nkeycolumns && !found; indexcol++)
+		{
+			ListCell   *lc2;
+
+			foreach(lc2, pathkey->pk_eclass->ec_members)
+			{
+				EquivalenceMember *em = (EquivalenceMember *) lfirst(lc2);
+
+				if (bms_equal(em->em_relids, index->rel->relids) &&
+					match_index_to_operand((Node *) em->em_expr, indexcol,
+										   index))
+				{
+					found = true;
+					skipprefix = Max(skipprefix, indexcol + 1);
+					break;
+				}
+			}
+		}
+		if (!found)
+			return NULL;
+	}
+
+	return (Path *) create_index_skip_path(root, ipath, skipprefix,
+										   numDistinctRows);
+}
+
 /*
  * create_ordered_paths
  *
  * Build a new upperrel containing Paths for ORDER BY evaluation.
  *
  * All paths in the result must satisfy the ORDER BY ordering.
- * The only new path we need consider is an explicit sort on the
- * cheapest-total existing path.
+ * The new paths we need consider are an explicit sort on the
+ * cheapest-total existing path, and incremental sorts on existing paths
+ * that are already sorted by a prefix of the ORDER BY.
  *
  * input_rel: contains the source-data Paths
  * target: the output tlist the result Paths must emit
@@ -4964,13 +5072,17 @@ create_ordered_paths(PlannerInfo *root,
 
 	foreach(lc, input_rel->pathlist)
 	{
-		Path	   *path = (Path *) lfirst(lc);
+		Path	   *input_path = (Path *) lfirst(lc);
+		Path	   *path;
 		bool		is_sorted;
+		int			presorted_keys;
 
-		is_sorted = pathkeys_contained_in(root->sort_pathkeys,
-										  path->pathkeys);
-		if (path == cheapest_input_path || is_sorted)
+		is_sorted = pathkeys_count_contained_in(root->sort_pathkeys,
+												input_path->pathkeys,
+												&presorted_keys);
+		if (input_path == cheapest_input_path || is_sorted)
 		{
+			path = input_path;
 			if (!is_sorted)
 			{
 				/* An explicit sort here can take advantage of LIMIT */
@@ -4988,6 +5100,28 @@ create_ordered_paths(PlannerInfo *root,
 
 			add_path(ordered_rel, path);
 		}
+
+		/*
+		 * A path that is already sorted on a leading part of the pathkeys
+		 * can be finished with an incremental sort.  That is worth trying
+		 * for every such path, not just the cheapest one, since a cheap
+		 * startup can make it win when only part of the output is fetched.
+		 */
+		if (enable_incrementalsort && !is_sorted && presorted_keys > 0)
+		{
+			path = (Path *) create_incremental_sort_path(root,
+														 ordered_rel,
+														 input_path,
+														 root->sort_pathkeys,
+														 presorted_keys);
+
+			/* Add projection step if needed */
+			if (path->pathtarget != target)
+				path = apply_projection_to_path(root, ordered_rel,
+												path, target);
+
+			add_path(ordered_rel, path);
+		}
 	}
 
 	/*
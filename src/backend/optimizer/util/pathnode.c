@@ -1045,12 +1045,43 @@ create_index_path(PlannerInfo *root,
 	pathnode->indexorderbys = indexorderbys;
 	pathnode->indexorderbycols = indexorderbycols;
 	pathnode->indexscandir = indexscandir;
+	pathnode->indexskipprefix = 0;
 
 	cost_index(pathnode, root, loop_count, partial_path);
 
 	return pathnode;
 }
 
+/*
+ * create_index_skip_path
+ *	  Creates a variant of an index-only scan path that returns only the
+ *	  first row for each distinct value of the leading index columns.
+ *
+ * 'basepath' is the index-only scan path to start from.
+ * 'skipprefix' is the number of leading index columns to skip on.
+ * 'numgroups' is the estimated number of distinct values of those columns.
+ *
+ * Returns the new path node.
+ */
+IndexPath *
+create_index_skip_path(PlannerInfo *root,
+					   IndexPath *basepath,
+					   int skipprefix,
+					   double numgroups)
+{
+	IndexPath  *pathnode = makeNode(IndexPath);
+
+	Assert(basepath->path.pathtype == T_IndexOnlyScan);
+	Assert(basepath->indexinfo->amhasskip);
+
+	memcpy(pathnode, basepath, sizeof(IndexPath));
+	pathnode->indexskipprefix = skipprefix;
+
+	cost_index_skip(pathnode, root, numgroups);
+
+	return pathnode;
+}
+
 /*
  * create_bitmap_heap_path
  *	  Creates a path node for a bitmap scan.
@@ -2542,6 +2573,53 @@ create_sort_path(PlannerInfo *root,
 	return pathnode;
 }
 
+/*
+ * create_incremental_sort_path
+ *	  Creates a pathnode that represents performing an incremental sort.
+ *
+ * 'rel' is the parent relation associated with the result
+ * 'subpath' is the path representing the source of data
+ * 'pathkeys' represents the desired sort order
+ * 'presorted_keys' is the number of leading pathkeys subpath is sorted by
+ */
+IncrementalSortPath *
+create_incremental_sort_path(PlannerInfo *root,
+							 RelOptInfo *rel,
+							 Path *subpath,
+							 List *pathkeys,
+							 int presorted_keys)
+{
+	IncrementalSortPath *sort = makeNode(IncrementalSortPath);
+	SortPath   *pathnode = &sort->spath;
+
+	pathnode->path.pathtype = T_IncrementalSort;
+	pathnode->path.parent = rel;
+	/* Sort doesn't project, so use source path's pathtarget */
+	pathnode->path.pathtarget = subpath->pathtarget;
+	/* For now, assume we are above any joins, so no parameterization */
+	pathnode->path.param_info = NULL;
+	pathnode->path.parallel_aware = false;
+	pathnode->path.parallel_safe = rel->consider_parallel &&
+		subpath->parallel_safe;
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+	pathnode->path.pathkeys = pathkeys;
+
+	pathnode->subpath = subpath;
+
+	cost_incremental_sort(&pathnode->path,
+						  root, pathkeys, presorted_keys,
+						  subpath->startup_cost,
+						  subpath->total_cost,
+						  subpath->rows,
+						  subpath->pathtarget->width,
+						  0.0,	/* XXX comparison_cost shouldn't be 0? */
+						  work_mem);
+
+	sort->nPresortedCols = presorted_keys;
+
+	return sort;
+}
+
 /*
  * create_group_path
  *	  Creates a pathnode that represents performing grouping of presorted input
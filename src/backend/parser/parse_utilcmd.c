@@ -1429,6 +1429,7 @@ generateClonedIndexStmt(CreateStmtContext *cxt, Relation source_idx,
 
 	/* Build the list of IndexElem */
 	index->indexParams = NIL;
+	index->indexIncludingParams = NIL;
 
 	indexpr_item = list_head(indexprs);
 	for (keyno = 0; keyno < idxrec->indnatts; keyno++)
@@ -1437,7 +1438,7 @@ generateClonedIndexStmt(CreateStmtContext *cxt, Relation source_idx,
 		AttrNumber	attnum = idxrec->indkey.values[keyno];
 		Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(source_idx),
 											   keyno);
-		int16		opt = source_idx->rd_indoption[keyno];
+		int16		opt;
 
 		iparam = makeNode(IndexElem);
 
@@ -1486,6 +1487,14 @@ generateClonedIndexStmt(CreateStmtContext *cxt, Relation source_idx,
 		/* Copy the original index column name */
 		iparam->indexcolname = pstrdup(NameStr(attr->attname));
 
+		/* INCLUDE columns have no collation, opclass or ordering options */
+		if (keyno >= idxrec->indnkeyatts)
+		{
+			index->indexIncludingParams =
+				lappend(index->indexIncludingParams, iparam);
+			continue;
+		}
+
 		/* Add the collation name, if non-default */
 		iparam->collation = get_collation(indcollation->values[keyno], keycoltype);
 
@@ -1496,6 +1505,7 @@ generateClonedIndexStmt(CreateStmtContext *cxt, Relation source_idx,
 		iparam->nulls_ordering = SORTBY_NULLS_DEFAULT;
 
 		/* Adjust options if necessary */
+		opt = source_idx->rd_indoption[keyno];
 		if (source_idx->rd_amroutine->amcanorder)
 		{
 			/*
@@ -1903,6 +1913,17 @@ transformIndexConstraint(Constraint *constraint, CreateStmtContext *cxt)
 					 errmsg("index \"%s\" is not a btree", index_name),
 					 parser_errposition(cxt->pstate, constraint->location)));
 
+		/*
+		 * Constraints can't be declared with INCLUDE columns, so an index
+		 * that has them wouldn't match the plain ADD CONSTRAINT result either.
+		 */
+		if (index_form->indnatts != index_form->indnkeyatts)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("index \"%s\" has included columns", index_name),
+					 errdetail("Cannot create a primary key or unique constraint using such an index."),
+					 parser_errposition(cxt->pstate, constraint->location)));
+
 		/* Must get indclass the hard way */
 		indclassDatum = SysCacheGetAttr(INDEXRELID, index_rel->rd_indextuple,
 										Anum_pg_index_indclass, &isnull);
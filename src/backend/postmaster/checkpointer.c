@@ -100,7 +100,9 @@
  * because the checkpointer failed to absorb their request.
  *
  * The requests array holds fsync requests sent by backends and not yet
- * absorbed by the checkpointer.
+ * absorbed by the checkpointer.  Requests from requests[dedup_horizon] on
+ * are also entered in FsyncRequestHash, so that a request that is already
+ * queued needn't be added again.
  *
  * Unlike the checkpoint fields, num_backend_writes, num_backend_fsync, and
  * the requests fields are protected by CheckpointerCommLock.
@@ -114,9 +116,27 @@ typedef struct
 	/* might add a real request-type field later; not needed yet */
 } CheckpointerRequest;
 
+/*
+ * md.c uses segment numbers beyond those of any real segment to send special
+ * requests, like forgetting the pending fsyncs of a dropped relation.  Those
+ * must not be deduplicated, nor can later requests be deduplicated against
+ * earlier ones across them, since that would change their meaning.
+ */
+#define FSYNC_REQUEST_IS_SPECIAL(segno) \
+	((segno) > MaxBlockNumber / ((BlockNumber) RELSEG_SIZE))
+
+/* entry in FsyncRequestHash */
+typedef struct
+{
+	CheckpointerRequest request;	/* hash key; must be first */
+	int			slot;			/* requests[] slot it was last queued in */
+} FsyncRequestEntry;
+
 typedef struct
 {
 	pid_t		checkpointer_pid;	/* PID (0 if not started) */
+	bool		startup_absorbs;	/* startup process absorbs requests
+									 * instead, during crash recovery */
 
 	slock_t		ckpt_lck;		/* protects all the ckpt_* fields */
 
@@ -131,11 +151,17 @@ typedef struct
 
 	int			num_requests;	/* current # of requests */
 	int			max_requests;	/* allocated array size */
+	int			dedup_horizon;	/* first slot usable for deduplication */
+	bool		dedup_swept;	/* FsyncRequestHash swept since last absorb
+								 * or compaction? */
 	CheckpointerRequest requests[FLEXIBLE_ARRAY_MEMBER];
 } CheckpointerShmemStruct;
 
 static CheckpointerShmemStruct *CheckpointerShmem;
 
+/* lookup table for queued requests, also protected by CheckpointerCommLock */
+static HTAB *FsyncRequestHash;
+
 /* interval for calling AbsorbFsyncRequests in CheckpointWriteDelay */
 #define WRITES_PER_ABSORB		1000
 
@@ -172,6 +198,8 @@ static void CheckArchiveTimeout(void);
 static bool IsCheckpointOnSchedule(double progress);
 static bool ImmediateCheckpointRequested(void);
 static bool CompactCheckpointerRequestQueue(void);
+static bool FsyncRequestIsQueued(CheckpointerRequest *request);
+static void RememberQueuedFsyncRequest(CheckpointerRequest *request, int slot);
 static void UpdateSharedMemoryConfig(void);
 
 /* Signal handlers */
@@ -708,6 +736,12 @@ CheckpointWriteDelay(int flags, double progress)
 		 */
 		pgstat_send_bgwriter();
 
+		/*
+		 * Don't leave buffers waiting for the completion of asynchronous or
+		 * batched writes while we sleep.
+		 */
+		FlushPendingBufferWrites();
+
 		/*
 		 * This sleep used to be connected to bgwriter_delay, typically 200ms.
 		 * That resulted in more frequent wakeups if not much work to do.
@@ -900,11 +934,11 @@ ReqShutdownHandler(SIGNAL_ARGS)
  */
 
 /*
- * CheckpointerShmemSize
- *		Compute space needed for checkpointer-related shared memory
+ * CheckpointerShmemStructSize
+ *		Compute space needed for CheckpointerShmemStruct
  */
-Size
-CheckpointerShmemSize(void)
+static Size
+CheckpointerShmemStructSize(void)
 {
 	Size		size;
 
@@ -918,6 +952,28 @@ CheckpointerShmemSize(void)
 	return size;
 }
 
+/*
+ * CheckpointerShmemSize
+ *		Compute space needed for checkpointer-related shared memory
+ */
+Size
+CheckpointerShmemSize(void)
+{
+	Size		size;
+
+	size = CheckpointerShmemStructSize();
+
+	/*
+	 * The lookup table has room for one entry per queue slot, so that
+	 * deduplication keeps working when the queue is nearly full, which is
+	 * when it matters most.
+	 */
+	size = add_size(size, hash_estimate_size(NBuffers,
+											 sizeof(FsyncRequestEntry)));
+
+	return size;
+}
+
 /*
  * CheckpointerShmemInit
  *		Allocate and initialize checkpointer-related shared memory
@@ -925,8 +981,9 @@ CheckpointerShmemSize(void)
 void
 CheckpointerShmemInit(void)
 {
-	Size		size = CheckpointerShmemSize();
+	Size		size = CheckpointerShmemStructSize();
 	bool		found;
+	HASHCTL		info;
 
 	CheckpointerShmem = (CheckpointerShmemStruct *)
 		ShmemInitStruct("Checkpointer Data",
@@ -944,6 +1001,15 @@ CheckpointerShmemInit(void)
 		SpinLockInit(&CheckpointerShmem->ckpt_lck);
 		CheckpointerShmem->max_requests = NBuffers;
 	}
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(CheckpointerRequest);
+	info.entrysize = sizeof(FsyncRequestEntry);
+
+	FsyncRequestHash = ShmemInitHash("Checkpointer Fsync Requests",
+									 NBuffers, NBuffers,
+									 &info,
+									 HASH_ELEM | HASH_BLOBS);
 }
 
 /*
@@ -1109,20 +1175,23 @@ RequestCheckpoint(int flags)
  * use high values for special flags; that's all internal to md.c, which
  * see for details.)
  *
- * To avoid holding the lock for longer than necessary, we normally write
- * to the requests[] queue without checking for duplicates.  The checkpointer
- * will have to eliminate dups internally anyway.  However, if we discover
- * that the queue is full, we make a pass over the entire queue to compact
- * it.  This is somewhat expensive, but the alternative is for the backend
- * to perform its own fsync, which is far more expensive in practice.  It
- * is theoretically possible a backend fsync might still be necessary, if
- * the queue is full and contains no duplicate entries.  In that case, we
- * let the backend know by returning false.
+ * Since the same segment tends to be written many times between absorb
+ * cycles, we look each request up in FsyncRequestHash and don't queue it
+ * again if it's already there.  That keeps the queue from filling up with
+ * duplicates.  If the queue is full anyway, we make a pass over the entire
+ * queue to compact it, which can still remove duplicates that were queued
+ * on both sides of a special request.  This is somewhat expensive, but the
+ * alternative is for the backend to perform its own fsync, which is far more
+ * expensive in practice.  It is theoretically possible a backend fsync might
+ * still be necessary, if the queue is full and contains no duplicate
+ * entries.  In that case, we let the backend know by returning false.
  */
 bool
 ForwardFsyncRequest(RelFileNode rnode, ForkNumber forknum, BlockNumber segno)
 {
+	CheckpointerRequest newrequest;
 	CheckpointerRequest *request;
+	bool		absorbed;
 	bool		too_full;
 
 	if (!IsUnderPostmaster)
@@ -1137,12 +1206,28 @@ ForwardFsyncRequest(RelFileNode rnode, ForkNumber forknum, BlockNumber segno)
 	if (!AmBackgroundWriterProcess())
 		CheckpointerShmem->num_backend_writes++;
 
+	/* Zero any pad bytes, since we use the struct as a hash key */
+	MemSet(&newrequest, 0, sizeof(newrequest));
+	newrequest.rnode = rnode;
+	newrequest.forknum = forknum;
+	newrequest.segno = segno;
+
+	absorbed = (CheckpointerShmem->checkpointer_pid != 0 ||
+				CheckpointerShmem->startup_absorbs);
+
+	/* Nothing to do if the same request is already queued */
+	if (absorbed && FsyncRequestIsQueued(&newrequest))
+	{
+		LWLockRelease(CheckpointerCommLock);
+		return true;
+	}
+
 	/*
-	 * If the checkpointer isn't running or the request queue is full, the
-	 * backend will have to perform its own fsync request.  But before forcing
-	 * that to happen, we can try to compact the request queue.
+	 * If nobody absorbs requests or the request queue is full, the backend
+	 * will have to perform its own fsync request.  But before forcing that
+	 * to happen, we can try to compact the request queue.
 	 */
-	if (CheckpointerShmem->checkpointer_pid == 0 ||
+	if (!absorbed ||
 		(CheckpointerShmem->num_requests >= CheckpointerShmem->max_requests &&
 		 !CompactCheckpointerRequestQueue()))
 	{
@@ -1157,10 +1242,13 @@ ForwardFsyncRequest(RelFileNode rnode, ForkNumber forknum, BlockNumber segno)
 	}
 
 	/* OK, insert request */
-	request = &CheckpointerShmem->requests[CheckpointerShmem->num_requests++];
-	request->rnode = rnode;
-	request->forknum = forknum;
-	request->segno = segno;
+	request = &CheckpointerShmem->requests[CheckpointerShmem->num_requests];
+	*request = newrequest;
+	if (FSYNC_REQUEST_IS_SPECIAL(segno))
+		CheckpointerShmem->dedup_horizon = CheckpointerShmem->num_requests + 1;
+	else
+		RememberQueuedFsyncRequest(request, CheckpointerShmem->num_requests);
+	CheckpointerShmem->num_requests++;
 
 	/* If queue is more than half full, nudge the checkpointer to empty it */
 	too_full = (CheckpointerShmem->num_requests >=
@@ -1285,11 +1373,112 @@ CompactCheckpointerRequestQueue(void)
 					CheckpointerShmem->num_requests, preserve_count)));
 	CheckpointerShmem->num_requests = preserve_count;
 
+	/* The slots recorded in FsyncRequestHash are no longer right */
+	CheckpointerShmem->dedup_horizon = preserve_count;
+	CheckpointerShmem->dedup_swept = false;
+
 	/* Cleanup. */
 	pfree(skip_slot);
 	return true;
 }
 
+/*
+ * FsyncRequestEntryIsLive
+ *		Does this FsyncRequestHash entry describe a queued request that new
+ *		ones can be deduplicated against?
+ *
+ * We don't bother to remove entries when requests leave the queue; instead,
+ * an entry counts only if the slot it points to is in use, past the
+ * deduplication horizon, and still holds the same request.
+ */
+static bool
+FsyncRequestEntryIsLive(FsyncRequestEntry *entry)
+{
+	return (entry->slot >= CheckpointerShmem->dedup_horizon &&
+			entry->slot < CheckpointerShmem->num_requests &&
+			memcmp(&CheckpointerShmem->requests[entry->slot], &entry->request,
+				   sizeof(CheckpointerRequest)) == 0);
+}
+
+/*
+ * FsyncRequestIsQueued
+ *		Check whether an identical request is in the queue, in a position
+ *		where the new one would be redundant.
+ */
+static bool
+FsyncRequestIsQueued(CheckpointerRequest *request)
+{
+	FsyncRequestEntry *entry;
+
+	/* must hold CheckpointerCommLock in exclusive mode */
+	Assert(LWLockHeldByMe(CheckpointerCommLock));
+
+	if (FSYNC_REQUEST_IS_SPECIAL(request->segno))
+		return false;
+
+	entry = (FsyncRequestEntry *) hash_search(FsyncRequestHash, request,
+											  HASH_FIND, NULL);
+
+	return (entry != NULL && FsyncRequestEntryIsLive(entry));
+}
+
+/*
+ * RememberQueuedFsyncRequest
+ *		Record in FsyncRequestHash that a request has been queued in slot.
+ *
+ * The table has as many entries as the queue has slots, but stale entries
+ * accumulate, so when it's full we throw out those that are no longer live.
+ * Entries only go stale when the queue is absorbed or compacted, or a special
+ * request moves the deduplication horizon, so we sweep at most once between
+ * absorb or compaction cycles; otherwise a table that stays full would cost
+ * a scan of the whole table for every request queued.  If it's still full,
+ * the request simply isn't recorded; that can only cost us a duplicate queue
+ * entry later.
+ */
+static void
+RememberQueuedFsyncRequest(CheckpointerRequest *request, int slot)
+{
+	FsyncRequestEntry *entry;
+
+	/* must hold CheckpointerCommLock in exclusive mode */
+	Assert(LWLockHeldByMe(CheckpointerCommLock));
+
+	entry = (FsyncRequestEntry *) hash_search(FsyncRequestHash, request,
+											  HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		if (hash_get_num_entries(FsyncRequestHash) >= CheckpointerShmem->max_requests)
+		{
+			HASH_SEQ_STATUS status;
+			FsyncRequestEntry *oldentry;
+
+			if (CheckpointerShmem->dedup_swept)
+				return;
+			CheckpointerShmem->dedup_swept = true;
+
+			hash_seq_init(&status, FsyncRequestHash);
+			while ((oldentry = (FsyncRequestEntry *) hash_seq_search(&status)) != NULL)
+			{
+				/* dynahash allows deleting the element just returned */
+				if (!FsyncRequestEntryIsLive(oldentry))
+					hash_search(FsyncRequestHash, &oldentry->request,
+								HASH_REMOVE, NULL);
+			}
+
+			/* don't let the table grow beyond its preallocated size */
+			if (hash_get_num_entries(FsyncRequestHash) >= CheckpointerShmem->max_requests)
+				return;
+		}
+
+		entry = (FsyncRequestEntry *) hash_search(FsyncRequestHash, request,
+												  HASH_ENTER_NULL, NULL);
+		if (entry == NULL)
+			return;
+	}
+
+	entry->slot = slot;
+}
+
 /*
  * AbsorbFsyncRequests
  *		Retrieve queued fsync requests and pass them to local smgr.
@@ -1297,7 +1486,9 @@ CompactCheckpointerRequestQueue(void)
  * This is exported because it must be called during CreateCheckPoint;
  * we have to be sure we have accepted all pending requests just before
  * we start fsync'ing.  Since CreateCheckPoint sometimes runs in
- * non-checkpointer processes, do nothing if not checkpointer.
+ * non-checkpointer processes, do nothing if not checkpointer, unless this
+ * is the startup process and it's been told to absorb requests (see
+ * SetStartupAbsorbsFsyncRequests).
  */
 void
 AbsorbFsyncRequests(void)
@@ -1306,17 +1497,21 @@ AbsorbFsyncRequests(void)
 	CheckpointerRequest *request;
 	int			n;
 
-	if (!AmCheckpointerProcess())
+	if (!AmCheckpointerProcess() &&
+		!(AmStartupProcess() && CheckpointerShmem->startup_absorbs))
 		return;
 
 	LWLockAcquire(CheckpointerCommLock, LW_EXCLUSIVE);
 
 	/* Transfer stats counts into pending pgstats message */
-	BgWriterStats.m_buf_written_backend += CheckpointerShmem->num_backend_writes;
-	BgWriterStats.m_buf_fsync_backend += CheckpointerShmem->num_backend_fsync;
+	if (AmCheckpointerProcess())
+	{
+		BgWriterStats.m_buf_written_backend += CheckpointerShmem->num_backend_writes;
+		BgWriterStats.m_buf_fsync_backend += CheckpointerShmem->num_backend_fsync;
 
-	CheckpointerShmem->num_backend_writes = 0;
-	CheckpointerShmem->num_backend_fsync = 0;
+		CheckpointerShmem->num_backend_writes = 0;
+		CheckpointerShmem->num_backend_fsync = 0;
+	}
 
 	/*
 	 * We try to avoid holding the lock for a long time by copying the request
@@ -1338,6 +1533,8 @@ AbsorbFsyncRequests(void)
 	START_CRIT_SECTION();
 
 	CheckpointerShmem->num_requests = 0;
+	CheckpointerShmem->dedup_horizon = 0;
+	CheckpointerShmem->dedup_swept = false;
 
 	LWLockRelease(CheckpointerCommLock);
 
@@ -1368,6 +1565,27 @@ UpdateSharedMemoryConfig(void)
 	elog(DEBUG2, "checkpointer updated shared memory configuration values");
 }
 
+/*
+ * SetStartupAbsorbsFsyncRequests
+ *		Let the startup process absorb fsync requests, or stop doing so.
+ *
+ * During crash recovery, there is no checkpointer, and the startup process
+ * performs the end-of-recovery checkpoint itself, with its own table of
+ * pending fsyncs.  Parallel redo workers that write out buffers can then
+ * queue their requests for the startup process to absorb, rather than
+ * fsync each segment they write to on the spot.  The startup process must
+ * absorb the queue before it stops doing so, and before it drops anything.
+ */
+void
+SetStartupAbsorbsFsyncRequests(bool absorb)
+{
+	Assert(AmStartupProcess());
+
+	LWLockAcquire(CheckpointerCommLock, LW_EXCLUSIVE);
+	CheckpointerShmem->startup_absorbs = absorb;
+	LWLockRelease(CheckpointerCommLock);
+}
+
 /*
  * FirstCallSinceLastCheckpoint allows a process to take an action once
  * per checkpoint cycle by asynchronously checking for checkpoint completion.
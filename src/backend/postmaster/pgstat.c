@@ -3509,6 +3509,9 @@ pgstat_get_wait_activity(WaitEventActivity w)
 		case WAIT_EVENT_WAL_SENDER_MAIN:
 			event_name = "WalSenderMain";
 			break;
+		case WAIT_EVENT_WAL_SUMMARIZER_MAIN:
+			event_name = "WalSummarizerMain";
+			break;
 		case WAIT_EVENT_WAL_WRITER_MAIN:
 			event_name = "WalWriterMain";
 			break;
@@ -3586,9 +3589,18 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_EXECUTE_GATHER:
 			event_name = "ExecuteGather";
 			break;
+		case WAIT_EVENT_LOGICAL_APPLY_COMMIT_ORDER:
+			event_name = "LogicalApplyCommitOrder";
+			break;
+		case WAIT_EVENT_LOGICAL_APPLY_DEPENDENCY:
+			event_name = "LogicalApplyDependency";
+			break;
 		case WAIT_EVENT_LOGICAL_SYNC_DATA:
 			event_name = "LogicalSyncData";
 			break;
+		case WAIT_EVENT_LOGICAL_SYNC_PARALLEL_COPY:
+			event_name = "LogicalSyncParallelCopy";
+			break;
 		case WAIT_EVENT_LOGICAL_SYNC_STATE_CHANGE:
 			event_name = "LogicalSyncStateChange";
 			break;
@@ -3610,6 +3622,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_PARALLEL_BITMAP_SCAN:
 			event_name = "ParallelBitmapScan";
 			break;
+		case WAIT_EVENT_PARALLEL_REDO:
+			event_name = "ParallelRedo";
+			break;
 		case WAIT_EVENT_PROCARRAY_GROUP_UPDATE:
 			event_name = "ProcArrayGroupUpdate";
 			break;
@@ -3628,6 +3643,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_SYNC_REP:
 			event_name = "SyncRep";
 			break;
+		case WAIT_EVENT_WAL_SUMMARY_READY:
+			event_name = "WalSummaryReady";
+			break;
 			/* no default case, so that compiler will warn */
 	}
 
@@ -3726,6 +3744,15 @@ pgstat_get_wait_io(WaitEventIO w)
 		case WAIT_EVENT_DATA_FILE_WRITE:
 			event_name = "DataFileWrite";
 			break;
+		case WAIT_EVENT_DOUBLE_WRITE_READ:
+			event_name = "DoubleWriteRead";
+			break;
+		case WAIT_EVENT_DOUBLE_WRITE_SYNC:
+			event_name = "DoubleWriteSync";
+			break;
+		case WAIT_EVENT_DOUBLE_WRITE_WRITE:
+			event_name = "DoubleWriteWrite";
+			break;
 		case WAIT_EVENT_DSM_FILL_ZERO_WRITE:
 			event_name = "DSMFillZeroWrite";
 			break;
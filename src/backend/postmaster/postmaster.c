@@ -115,6 +115,7 @@
 #include "postmaster/syslogger.h"
 #include "replication/logicallauncher.h"
 #include "replication/walsender.h"
+#include "replication/walsummarizer.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/pg_shmem.h"
@@ -897,6 +898,9 @@ PostmasterMain(int argc, char *argv[])
 	if (max_wal_senders > 0 && wal_level == WAL_LEVEL_MINIMAL)
 		ereport(ERROR,
 				(errmsg("WAL streaming (max_wal_senders > 0) requires wal_level \"replica\" or \"logical\"")));
+	if (summarize_wal && wal_level == WAL_LEVEL_MINIMAL)
+		ereport(ERROR,
+				(errmsg("WAL summarization cannot be enabled when wal_level is \"minimal\"")));
 
 	/*
 	 * Other one-time internal sanity checks can go here, if they are fast.
@@ -972,6 +976,9 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	ApplyLauncherRegister();
 
+	/* Likewise for the WAL summarizer */
+	WalSummarizerRegister();
+
 	/*
 	 * process any libraries that should be preloaded at postmaster start
 	 */
@@ -5820,9 +5827,10 @@ maybe_start_bgworkers(void)
 
 	/*
 	 * During crash recovery, we have no need to be called until the state
-	 * transition out of recovery.
+	 * transition out of recovery, except to launch the startup process's
+	 * parallel redo workers.
 	 */
-	if (FatalError)
+	if (FatalError && pmState != PM_STARTUP)
 	{
 		StartWorkerNeeded = false;
 		HaveCrashedWorker = false;
@@ -5843,6 +5851,11 @@ maybe_start_bgworkers(void)
 		if (rw->rw_pid != 0)
 			continue;
 
+		/* during crash recovery, only parallel redo workers can start */
+		if (FatalError &&
+			(rw->rw_worker.bgw_flags & BGWORKER_CLASS_PARALLEL) == 0)
+			continue;
+
 		/* if marked for death, clean up and remove from list */
 		if (rw->rw_terminate)
 		{
@@ -18,6 +18,7 @@
 
 #include "access/xlog_internal.h"	/* for pg_start/stop_backup */
 #include "catalog/catalog.h"
+#include "catalog/pg_tablespace.h"
 #include "catalog/pg_type.h"
 #include "lib/stringinfo.h"
 #include "libpq/libpq.h"
@@ -30,11 +31,14 @@
 #include "replication/basebackup.h"
 #include "replication/walsender.h"
 #include "replication/walsender_private.h"
+#include "replication/walsummarizer.h"
+#include "replication/walsummary.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "utils/builtins.h"
 #include "utils/elog.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/timestamp.h"
 
@@ -48,6 +52,9 @@ typedef struct
 	bool		includewal;
 	uint32		maxrate;
 	bool		sendtblspcmapfile;
+	WireCompressMethod compression;
+	int			compression_level;
+	XLogRecPtr	incremental_lsn;	/* start of the prior backup, if any */
 } basebackup_options;
 
 
@@ -55,6 +62,13 @@ static int64 sendDir(char *path, int basepathlen, bool sizeonly,
 		List *tablespaces, bool sendtblspclinks);
 static bool sendFile(char *readfilename, char *tarfilename,
 		 struct stat *statbuf, bool missing_ok);
+static bool sendIncrementalFile(char *readfilename, char *tarfilename,
+					struct stat *statbuf, BlockNumber *blocks, int nblocks);
+static bool GetIncrementalBlocks(const char *tarfilename, struct stat *statbuf,
+					 BlockNumber **blocks, int *nblocks);
+static void PrepareIncrementalBackup(XLogRecPtr prior_lsn, XLogRecPtr startptr,
+						 StringInfo labelfile);
+static int	compareWalSummaries(const void *a, const void *b);
 static void sendFileWithContent(const char *filename, const char *content);
 static int64 _tarWriteHeader(const char *filename, const char *linktarget,
 				struct stat *statbuf, bool sizeonly);
@@ -64,10 +78,25 @@ static void send_int8_string(StringInfoData *buf, int64 intval);
 static void SendBackupHeader(List *tablespaces);
 static void base_backup_cleanup(int code, Datum arg);
 static void perform_base_backup(basebackup_options *opt, DIR *tblspcdir);
-static void parse_basebackup_options(List *options, basebackup_options *opt);
+static void perform_start_backup(basebackup_options *opt, DIR *tblspcdir);
+static void perform_send_files(basebackup_options *opt, List *files);
+static void perform_stop_backup(basebackup_options *opt);
+static void session_backup_cleanup(int code, Datum arg);
+static void parse_basebackup_options(BaseBackupKind kind, List *options,
+						 basebackup_options *opt);
+static bool basebackup_option_allowed(BaseBackupKind kind, const char *name);
+static void SetStatRelPath(void);
+static void SetupThrottling(uint32 maxrate);
+static void StartTarStream(basebackup_options *opt);
+static void SendWalFiles(XLogRecPtr startptr, XLogRecPtr endptr);
+static void AddBackupFileListEntry(const char *name, const char *linktarget,
+					   struct stat *statbuf);
+static void SendBackupFileList(List *files);
 static void SendXlogRecPtrResult(XLogRecPtr ptr, TimeLineID tli);
 static int	compareWalFileNames(const void *a, const void *b);
 static void throttle(size_t increment);
+static int	sendCopyData(const char *data, int len);
+static void sendCopyDone(void);
 
 /* Was the backup currently in-progress initiated in recovery mode? */
 static bool backup_started_in_recovery = false;
@@ -97,6 +126,39 @@ static TimeOffset elapsed_min_unit;
 /* The last check of the transfer rate. */
 static TimestampTz throttled_last;
 
+/* Compressor for the current tar stream, if compression was requested */
+static WireCompressor *backup_compressor = NULL;
+
+/*
+ * In an incremental backup, the blocks modified since the prior backup, and
+ * the OID of the tablespace being sent (InvalidOid for the data directory).
+ */
+static BlockRefTable *incremental_blocks = NULL;
+static Oid	incremental_spcoid = InvalidOid;
+
+/*
+ * State of a backup started with START_BACKUP in this session, kept until
+ * STOP_BACKUP.  It lives in TopMemoryContext.
+ */
+static StringInfo session_labelfile = NULL;
+static XLogRecPtr session_startptr = InvalidXLogRecPtr;
+
+/*
+ * While START_BACKUP lists the files to back up, the entries found so far,
+ * and the prefix to put in front of their names.
+ */
+typedef struct
+{
+	char	   *path;			/* relative to the data directory */
+	char		type;			/* 'f', 'd' or 'l' */
+	int64		size;			/* size of a file */
+	char	   *linktarget;		/* target of a symbolic link */
+} backupfileinfo;
+
+static bool listing_files = false;
+static List *backup_file_list = NIL;
+static const char *listing_prefix = "";
+
 /*
  * The contents of these directories are removed or recreated during server
  * start so they are not included in backups.  The directories themselves are
@@ -136,6 +198,12 @@ static const char *excludeDirContents[] =
 	/* Contents zeroed on startup, see StartupSUBTRANS(). */
 	"pg_subtrans",
 
+	/*
+	 * The backup is made consistent by full-page images in WAL, see
+	 * doublewrite.c.
+	 */
+	"pg_dblwr",
+
 	/* end of list */
 	NULL
 };
@@ -192,13 +260,29 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 	TimeLineID	endtli;
 	StringInfo	labelfile;
 	StringInfo	tblspc_map_file = NULL;
-	int			datadirpathlen;
 	List	   *tablespaces = NIL;
 
-	datadirpathlen = strlen(DataDir);
-
 	backup_started_in_recovery = RecoveryInProgress();
 
+	/* A compressor left over from a failed backup is already freed */
+	backup_compressor = NULL;
+
+	/* Likewise the block reference table */
+	incremental_blocks = NULL;
+	incremental_spcoid = InvalidOid;
+
+	if (opt->incremental_lsn != InvalidXLogRecPtr)
+	{
+		if (backup_started_in_recovery)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("incremental backups cannot be taken during recovery")));
+		if (!summarize_wal)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("incremental backups require summarize_wal to be enabled")));
+	}
+
 	labelfile = makeStringInfo();
 	tblspc_map_file = makeStringInfo();
 
@@ -219,19 +303,29 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 		ListCell   *lc;
 		tablespaceinfo *ti;
 
+		if (opt->incremental_lsn != InvalidXLogRecPtr)
+		{
+			PrepareIncrementalBackup(opt->incremental_lsn, startptr, labelfile);
+
+			/*
+			 * The sizes of the tablespaces were estimated assuming all files
+			 * are sent in full.
+			 */
+			if (opt->progress)
+			{
+				foreach(lc, tablespaces)
+				{
+					ti = (tablespaceinfo *) lfirst(lc);
+					incremental_spcoid = atooid(ti->oid);
+					ti->size = sendTablespace(ti->path, true);
+				}
+				incremental_spcoid = InvalidOid;
+			}
+		}
+
 		SendXlogRecPtrResult(startptr, starttli);
 
-		/*
-		 * Calculate the relative path of temporary statistics directory in
-		 * order to skip the files which are located in that directory later.
-		 */
-		if (is_absolute_path(pgstat_stat_directory) &&
-			strncmp(pgstat_stat_directory, DataDir, datadirpathlen) == 0)
-			statrelpath = psprintf("./%s", pgstat_stat_directory + datadirpathlen + 1);
-		else if (strncmp(pgstat_stat_directory, "./", 2) != 0)
-			statrelpath = psprintf("./%s", pgstat_stat_directory);
-		else
-			statrelpath = pgstat_stat_directory;
+		SetStatRelPath();
 
 		/* Add a node for the base directory at the end */
 		ti = palloc0(sizeof(tablespaceinfo));
@@ -242,40 +336,14 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 		SendBackupHeader(tablespaces);
 
 		/* Setup and activate network throttling, if client requested it */
-		if (opt->maxrate > 0)
-		{
-			throttling_sample =
-				(int64) opt->maxrate * (int64) 1024 / THROTTLING_FREQUENCY;
-
-			/*
-			 * The minimum amount of time for throttling_sample bytes to be
-			 * transferred.
-			 */
-			elapsed_min_unit = USECS_PER_SEC / THROTTLING_FREQUENCY;
-
-			/* Enable throttling. */
-			throttling_counter = 0;
-
-			/* The 'real data' starts now (header was ignored). */
-			throttled_last = GetCurrentTimestamp();
-		}
-		else
-		{
-			/* Disable throttling. */
-			throttling_counter = -1;
-		}
+		SetupThrottling(opt->maxrate);
 
 		/* Send off our tablespaces one by one */
 		foreach(lc, tablespaces)
 		{
 			tablespaceinfo *ti = (tablespaceinfo *) lfirst(lc);
-			StringInfoData buf;
 
-			/* Send CopyOutResponse message */
-			pq_beginmessage(&buf, 'H');
-			pq_sendbyte(&buf, 0);	/* overall format */
-			pq_sendint(&buf, 0, 2); /* natts */
-			pq_endmessage(&buf);
+			StartTarStream(opt);
 
 			if (ti->path == NULL)
 			{
@@ -305,7 +373,11 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 				sendFile(XLOG_CONTROL_FILE, XLOG_CONTROL_FILE, &statbuf, false);
 			}
 			else
+			{
+				incremental_spcoid = atooid(ti->oid);
 				sendTablespace(ti->path, false);
+				incremental_spcoid = InvalidOid;
+			}
 
 			/*
 			 * If we're including WAL, and this is the main data directory we
@@ -318,7 +390,7 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 				Assert(lnext(lc) == NULL);
 			}
 			else
-				pq_putemptymessage('c');	/* CopyDone */
+				sendCopyDone();
 		}
 	}
 	PG_END_ENSURE_ERROR_CLEANUP(base_backup_cleanup, (Datum) 0);
@@ -331,237 +403,673 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 		 * We've left the last tar file "open", so we can now append the
 		 * required WAL files to it.
 		 */
-		char		pathbuf[MAXPGPATH];
-		XLogSegNo	segno;
-		XLogSegNo	startsegno;
-		XLogSegNo	endsegno;
-		struct stat statbuf;
-		List	   *historyFileList = NIL;
-		List	   *walFileList = NIL;
-		char	  **walFiles;
-		int			nWalFiles;
-		char		firstoff[MAXFNAMELEN];
-		char		lastoff[MAXFNAMELEN];
-		DIR		   *dir;
-		struct dirent *de;
-		int			i;
-		ListCell   *lc;
-		TimeLineID	tli;
+		SendWalFiles(startptr, endptr);
 
-		/*
-		 * I'd rather not worry about timelines here, so scan pg_wal and
-		 * include all WAL files in the range between 'startptr' and 'endptr',
-		 * regardless of the timeline the file is stamped with. If there are
-		 * some spurious WAL files belonging to timelines that don't belong in
-		 * this server's history, they will be included too. Normally there
-		 * shouldn't be such files, but if there are, there's little harm in
-		 * including them.
-		 */
-		XLByteToSeg(startptr, startsegno, wal_segment_size);
-		XLogFileName(firstoff, ThisTimeLineID, startsegno, wal_segment_size);
-		XLByteToPrevSeg(endptr, endsegno, wal_segment_size);
-		XLogFileName(lastoff, ThisTimeLineID, endsegno, wal_segment_size);
+		/* Send CopyDone message for the last tar file */
+		sendCopyDone();
+	}
+	SendXlogRecPtrResult(endptr, endtli);
+}
 
-		dir = AllocateDir("pg_wal");
-		if (!dir)
-			ereport(ERROR,
-					(errmsg("could not open directory \"%s\": %m", "pg_wal")));
-		while ((de = ReadDir(dir, "pg_wal")) != NULL)
+/*
+ * Append the WAL files between startptr and endptr, and the timeline history
+ * files, to the tar stream being sent.
+ */
+static void
+SendWalFiles(XLogRecPtr startptr, XLogRecPtr endptr)
+{
+	char		pathbuf[MAXPGPATH];
+	XLogSegNo	segno;
+	XLogSegNo	startsegno;
+	XLogSegNo	endsegno;
+	struct stat statbuf;
+	List	   *historyFileList = NIL;
+	List	   *walFileList = NIL;
+	char	  **walFiles;
+	int			nWalFiles;
+	char		firstoff[MAXFNAMELEN];
+	char		lastoff[MAXFNAMELEN];
+	DIR		   *dir;
+	struct dirent *de;
+	int			i;
+	ListCell   *lc;
+	TimeLineID	tli;
+
+	/*
+	 * I'd rather not worry about timelines here, so scan pg_wal and
+	 * include all WAL files in the range between 'startptr' and 'endptr',
+	 * regardless of the timeline the file is stamped with. If there are
+	 * some spurious WAL files belonging to timelines that don't belong in
+	 * this server's history, they will be included too. Normally there
+	 * shouldn't be such files, but if there are, there's little harm in
+	 * including them.
+	 */
+	XLByteToSeg(startptr, startsegno, wal_segment_size);
+	XLogFileName(firstoff, ThisTimeLineID, startsegno, wal_segment_size);
+	XLByteToPrevSeg(endptr, endsegno, wal_segment_size);
+	XLogFileName(lastoff, ThisTimeLineID, endsegno, wal_segment_size);
+
+	dir = AllocateDir("pg_wal");
+	if (!dir)
+		ereport(ERROR,
+				(errmsg("could not open directory \"%s\": %m", "pg_wal")));
+	while ((de = ReadDir(dir, "pg_wal")) != NULL)
+	{
+		/* Does it look like a WAL segment, and is it in the range? */
+		if (IsXLogFileName(de->d_name) &&
+			strcmp(de->d_name + 8, firstoff + 8) >= 0 &&
+			strcmp(de->d_name + 8, lastoff + 8) <= 0)
 		{
-			/* Does it look like a WAL segment, and is it in the range? */
-			if (IsXLogFileName(de->d_name) &&
-				strcmp(de->d_name + 8, firstoff + 8) >= 0 &&
-				strcmp(de->d_name + 8, lastoff + 8) <= 0)
-			{
-				walFileList = lappend(walFileList, pstrdup(de->d_name));
-			}
-			/* Does it look like a timeline history file? */
-			else if (IsTLHistoryFileName(de->d_name))
-			{
-				historyFileList = lappend(historyFileList, pstrdup(de->d_name));
-			}
+			walFileList = lappend(walFileList, pstrdup(de->d_name));
 		}
-		FreeDir(dir);
+		/* Does it look like a timeline history file? */
+		else if (IsTLHistoryFileName(de->d_name))
+		{
+			historyFileList = lappend(historyFileList, pstrdup(de->d_name));
+		}
+	}
+	FreeDir(dir);
 
-		/*
-		 * Before we go any further, check that none of the WAL segments we
-		 * need were removed.
-		 */
-		CheckXLogRemoved(startsegno, ThisTimeLineID);
+	/*
+	 * Before we go any further, check that none of the WAL segments we
+	 * need were removed.
+	 */
+	CheckXLogRemoved(startsegno, ThisTimeLineID);
 
-		/*
-		 * Put the WAL filenames into an array, and sort. We send the files in
-		 * order from oldest to newest, to reduce the chance that a file is
-		 * recycled before we get a chance to send it over.
-		 */
-		nWalFiles = list_length(walFileList);
-		walFiles = palloc(nWalFiles * sizeof(char *));
-		i = 0;
-		foreach(lc, walFileList)
+	/*
+	 * Put the WAL filenames into an array, and sort. We send the files in
+	 * order from oldest to newest, to reduce the chance that a file is
+	 * recycled before we get a chance to send it over.
+	 */
+	nWalFiles = list_length(walFileList);
+	walFiles = palloc(nWalFiles * sizeof(char *));
+	i = 0;
+	foreach(lc, walFileList)
+	{
+		walFiles[i++] = lfirst(lc);
+	}
+	qsort(walFiles, nWalFiles, sizeof(char *), compareWalFileNames);
+
+	/*
+	 * There must be at least one xlog file in the pg_wal directory, since
+	 * we are doing backup-including-xlog.
+	 */
+	if (nWalFiles < 1)
+		ereport(ERROR,
+				(errmsg("could not find any WAL files")));
+
+	/*
+	 * Sanity check: the first and last segment should cover startptr and
+	 * endptr, with no gaps in between.
+	 */
+	XLogFromFileName(walFiles[0], &tli, &segno, wal_segment_size);
+	if (segno != startsegno)
+	{
+		char		startfname[MAXFNAMELEN];
+
+		XLogFileName(startfname, ThisTimeLineID, startsegno,
+					 wal_segment_size);
+		ereport(ERROR,
+				(errmsg("could not find WAL file \"%s\"", startfname)));
+	}
+	for (i = 0; i < nWalFiles; i++)
+	{
+		XLogSegNo	currsegno = segno;
+		XLogSegNo	nextsegno = segno + 1;
+
+		XLogFromFileName(walFiles[i], &tli, &segno, wal_segment_size);
+		if (!(nextsegno == segno || currsegno == segno))
 		{
-			walFiles[i++] = lfirst(lc);
-		}
-		qsort(walFiles, nWalFiles, sizeof(char *), compareWalFileNames);
+			char		nextfname[MAXFNAMELEN];
 
-		/*
-		 * There must be at least one xlog file in the pg_wal directory, since
-		 * we are doing backup-including-xlog.
-		 */
-		if (nWalFiles < 1)
+			XLogFileName(nextfname, ThisTimeLineID, nextsegno,
+						 wal_segment_size);
 			ereport(ERROR,
-					(errmsg("could not find any WAL files")));
+					(errmsg("could not find WAL file \"%s\"", nextfname)));
+		}
+	}
+	if (segno != endsegno)
+	{
+		char		endfname[MAXFNAMELEN];
 
-		/*
-		 * Sanity check: the first and last segment should cover startptr and
-		 * endptr, with no gaps in between.
-		 */
-		XLogFromFileName(walFiles[0], &tli, &segno, wal_segment_size);
-		if (segno != startsegno)
+		XLogFileName(endfname, ThisTimeLineID, endsegno, wal_segment_size);
+		ereport(ERROR,
+				(errmsg("could not find WAL file \"%s\"", endfname)));
+	}
+
+	/* Ok, we have everything we need. Send the WAL files. */
+	for (i = 0; i < nWalFiles; i++)
+	{
+		FILE	   *fp;
+		char		buf[TAR_SEND_SIZE];
+		size_t		cnt;
+		pgoff_t		len = 0;
+
+		snprintf(pathbuf, MAXPGPATH, XLOGDIR "/%s", walFiles[i]);
+		XLogFromFileName(walFiles[i], &tli, &segno, wal_segment_size);
+
+		fp = AllocateFile(pathbuf, "rb");
+		if (fp == NULL)
 		{
-			char		startfname[MAXFNAMELEN];
+			/*
+			 * Most likely reason for this is that the file was already
+			 * removed by a checkpoint, so check for that to get a better
+			 * error message.
+			 */
+			CheckXLogRemoved(segno, tli);
 
-			XLogFileName(startfname, ThisTimeLineID, startsegno,
-						 wal_segment_size);
 			ereport(ERROR,
-					(errmsg("could not find WAL file \"%s\"", startfname)));
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", pathbuf)));
 		}
-		for (i = 0; i < nWalFiles; i++)
+
+		if (fstat(fileno(fp), &statbuf) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not stat file \"%s\": %m",
+							pathbuf)));
+		if (statbuf.st_size != wal_segment_size)
 		{
-			XLogSegNo	currsegno = segno;
-			XLogSegNo	nextsegno = segno + 1;
+			CheckXLogRemoved(segno, tli);
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("unexpected WAL file size \"%s\"", walFiles[i])));
+		}
 
-			XLogFromFileName(walFiles[i], &tli, &segno, wal_segment_size);
-			if (!(nextsegno == segno || currsegno == segno))
-			{
-				char		nextfname[MAXFNAMELEN];
+		/* send the WAL file itself */
+		_tarWriteHeader(pathbuf, NULL, &statbuf, false);
 
-				XLogFileName(nextfname, ThisTimeLineID, nextsegno,
-							 wal_segment_size);
+		while ((cnt = fread(buf, 1,
+							Min(sizeof(buf), wal_segment_size - len),
+							fp)) > 0)
+		{
+			CheckXLogRemoved(segno, tli);
+			/* Send the chunk as a CopyData message */
+			if (sendCopyData(buf, cnt))
 				ereport(ERROR,
-						(errmsg("could not find WAL file \"%s\"", nextfname)));
-			}
+						(errmsg("base backup could not send data, aborting backup")));
+
+			len += cnt;
+			throttle(cnt);
+
+			if (len == wal_segment_size)
+				break;
 		}
-		if (segno != endsegno)
-		{
-			char		endfname[MAXFNAMELEN];
 
-			XLogFileName(endfname, ThisTimeLineID, endsegno, wal_segment_size);
+		if (len != wal_segment_size)
+		{
+			CheckXLogRemoved(segno, tli);
 			ereport(ERROR,
-					(errmsg("could not find WAL file \"%s\"", endfname)));
+					(errcode_for_file_access(),
+					 errmsg("unexpected WAL file size \"%s\"", walFiles[i])));
 		}
 
-		/* Ok, we have everything we need. Send the WAL files. */
-		for (i = 0; i < nWalFiles; i++)
+		/* wal_segment_size is a multiple of 512, so no need for padding */
+
+		FreeFile(fp);
+
+		/*
+		 * Mark file as archived, otherwise files can get archived again
+		 * after promotion of a new node. This is in line with
+		 * walreceiver.c always doing an XLogArchiveForceDone() after a
+		 * complete segment.
+		 */
+		StatusFilePath(pathbuf, walFiles[i], ".done");
+		sendFileWithContent(pathbuf, "");
+	}
+
+	/*
+	 * Send timeline history files too. Only the latest timeline history
+	 * file is required for recovery, and even that only if there happens
+	 * to be a timeline switch in the first WAL segment that contains the
+	 * checkpoint record, or if we're taking a base backup from a standby
+	 * server and the target timeline changes while the backup is taken.
+	 * But they are small and highly useful for debugging purposes, so
+	 * better include them all, always.
+	 */
+	foreach(lc, historyFileList)
+	{
+		char	   *fname = lfirst(lc);
+
+		snprintf(pathbuf, MAXPGPATH, XLOGDIR "/%s", fname);
+
+		if (lstat(pathbuf, &statbuf) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not stat file \"%s\": %m", pathbuf)));
+
+		sendFile(pathbuf, pathbuf, &statbuf, false);
+
+		/* unconditionally mark file as archived */
+		StatusFilePath(pathbuf, fname, ".done");
+		sendFileWithContent(pathbuf, "");
+	}
+}
+
+/*
+ * Calculate the relative path of temporary statistics directory in order to
+ * skip the files which are located in that directory later.
+ */
+static void
+SetStatRelPath(void)
+{
+	int			datadirpathlen = strlen(DataDir);
+
+	if (is_absolute_path(pgstat_stat_directory) &&
+		strncmp(pgstat_stat_directory, DataDir, datadirpathlen) == 0)
+		statrelpath = psprintf("./%s", pgstat_stat_directory + datadirpathlen + 1);
+	else if (strncmp(pgstat_stat_directory, "./", 2) != 0)
+		statrelpath = psprintf("./%s", pgstat_stat_directory);
+	else
+		statrelpath = pgstat_stat_directory;
+}
+
+/*
+ * Setup and activate network throttling to maxrate kilobytes per second, or
+ * disable it if maxrate is 0.
+ */
+static void
+SetupThrottling(uint32 maxrate)
+{
+	if (maxrate > 0)
+	{
+		throttling_sample =
+			(int64) maxrate * (int64) 1024 / THROTTLING_FREQUENCY;
+
+		/*
+		 * The minimum amount of time for throttling_sample bytes to be
+		 * transferred.
+		 */
+		elapsed_min_unit = USECS_PER_SEC / THROTTLING_FREQUENCY;
+
+		/* Enable throttling. */
+		throttling_counter = 0;
+
+		/* The 'real data' starts now (header was ignored). */
+		throttled_last = GetCurrentTimestamp();
+	}
+	else
+	{
+		/* Disable throttling. */
+		throttling_counter = -1;
+	}
+}
+
+/*
+ * Begin sending a tar stream: send the CopyOutResponse message, and set up
+ * compression if requested.  Each tar stream is compressed independently.
+ */
+static void
+StartTarStream(basebackup_options *opt)
+{
+	StringInfoData buf;
+
+	pq_beginmessage(&buf, 'H');
+	pq_sendbyte(&buf, 0);		/* overall format */
+	pq_sendint(&buf, 0, 2);		/* natts */
+	pq_endmessage(&buf);
+
+	if (opt->compression != WIRE_COMPRESS_NONE)
+		backup_compressor = CreateWireCompressor(opt->compression,
+												 opt->compression_level);
+}
+
+/*
+ * Start a backup whose files are fetched with SEND_FILES, possibly over
+ * several connections at once, and which is finished by STOP_BACKUP in this
+ * session.
+ *
+ * Sends the start position and the tablespace header like BASE_BACKUP does,
+ * followed by a list of the directories, symbolic links and files to back
+ * up.  Files in tablespaces are listed with paths through the symbolic links
+ * in pg_tblspc.  backup_label and pg_control are sent by STOP_BACKUP, so
+ * they are not listed.
+ */
+static void
+perform_start_backup(basebackup_options *opt, DIR *tblspcdir)
+{
+	XLogRecPtr	startptr;
+	TimeLineID	starttli;
+	StringInfo	labelfile;
+	StringInfo	tblspc_map_file;
+	List	   *tablespaces = NIL;
+	MemoryContext oldcontext;
+
+	if (session_labelfile != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("a backup is already in progress in this session"),
+				 errhint("Run STOP_BACKUP first.")));
+
+	backup_started_in_recovery = RecoveryInProgress();
+	backup_compressor = NULL;
+	incremental_blocks = NULL;
+	incremental_spcoid = InvalidOid;
+
+	/* The backup label is needed again by STOP_BACKUP */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	labelfile = makeStringInfo();
+	MemoryContextSwitchTo(oldcontext);
+	tblspc_map_file = makeStringInfo();
+
+	startptr = do_pg_start_backup(opt->label, opt->fastcheckpoint, &starttli,
+								  labelfile, tblspcdir, &tablespaces,
+								  tblspc_map_file, opt->progress, false);
+
+	session_labelfile = labelfile;
+	session_startptr = startptr;
+
+	/*
+	 * If anything fails before the client has the list of files, abort the
+	 * backup right away.  After that, it is aborted if the session ends
+	 * without STOP_BACKUP.
+	 */
+	PG_ENSURE_ERROR_CLEANUP(session_backup_cleanup, (Datum) 0);
+	{
+		ListCell   *lc;
+		tablespaceinfo *ti;
+
+		SendXlogRecPtrResult(startptr, starttli);
+
+		SetStatRelPath();
+
+		/* Add a node for the base directory at the end */
+		ti = palloc0(sizeof(tablespaceinfo));
+		ti->size = opt->progress ? sendDir(".", 1, true, tablespaces, true) : -1;
+		tablespaces = lappend(tablespaces, ti);
+
+		SendBackupHeader(tablespaces);
+
+		/*
+		 * Walk the data directory and tablespaces like sendDir() does when
+		 * estimating their size, collecting the entries.  The data directory
+		 * goes first, so that the links in pg_tblspc come before the
+		 * contents of the tablespaces.
+		 */
+		backup_file_list = NIL;
+		listing_prefix = "";
+		listing_files = true;
+		sendDir(".", 1, true, tablespaces, true);
+		foreach(lc, tablespaces)
 		{
-			FILE	   *fp;
-			char		buf[TAR_SEND_SIZE];
-			size_t		cnt;
-			pgoff_t		len = 0;
+			ti = (tablespaceinfo *) lfirst(lc);
+			if (ti->path == NULL)
+				continue;
+			listing_prefix = psprintf("pg_tblspc/%s/", ti->oid);
+			sendTablespace(ti->path, true);
+		}
+		listing_files = false;
+		listing_prefix = "";
 
-			snprintf(pathbuf, MAXPGPATH, XLOGDIR "/%s", walFiles[i]);
-			XLogFromFileName(walFiles[i], &tli, &segno, wal_segment_size);
+		SendBackupFileList(backup_file_list);
+		backup_file_list = NIL;
+	}
+	PG_END_ENSURE_ERROR_CLEANUP(session_backup_cleanup, (Datum) 0);
 
-			fp = AllocateFile(pathbuf, "rb");
-			if (fp == NULL)
-			{
-				/*
-				 * Most likely reason for this is that the file was already
-				 * removed by a checkpoint, so check for that to get a better
-				 * error message.
-				 */
-				CheckXLogRemoved(segno, tli);
+	before_shmem_exit(session_backup_cleanup, (Datum) 0);
+}
 
-				ereport(ERROR,
-						(errcode_for_file_access(),
-						 errmsg("could not open file \"%s\": %m", pathbuf)));
-			}
+/*
+ * Abort the backup started with START_BACKUP in this session, if any.
+ *
+ * Called when START_BACKUP or STOP_BACKUP fails after starting the backup,
+ * and when the session ends before STOP_BACKUP.  do_pg_stop_backup() can
+ * fail after it has already taken the backup out of progress, in which case
+ * there is nothing left to abort, only our state to forget.
+ */
+static void
+session_backup_cleanup(int code, Datum arg)
+{
+	listing_files = false;
 
-			if (fstat(fileno(fp), &statbuf) != 0)
-				ereport(ERROR,
-						(errcode_for_file_access(),
-						 errmsg("could not stat file \"%s\": %m",
-								pathbuf)));
-			if (statbuf.st_size != wal_segment_size)
-			{
-				CheckXLogRemoved(segno, tli);
+	if (session_labelfile == NULL)
+		return;
+
+	if (get_backup_status() == SESSION_BACKUP_NON_EXCLUSIVE)
+		do_pg_abort_backup();
+
+	pfree(session_labelfile->data);
+	pfree(session_labelfile);
+	session_labelfile = NULL;
+	session_startptr = InvalidXLogRecPtr;
+}
+
+/*
+ * Send the given files, relative to the data directory, in a single tar
+ * stream.  They belong to a backup started with START_BACKUP, usually in
+ * another session, which must still be running when we are done.
+ */
+static void
+perform_send_files(basebackup_options *opt, List *files)
+{
+	ListCell   *lc;
+
+	if (!NonExclusiveBackupInProgress())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("a backup is not in progress"),
+				 errhint("Run START_BACKUP first.")));
+
+	backup_started_in_recovery = RecoveryInProgress();
+	backup_compressor = NULL;
+	incremental_blocks = NULL;
+
+	SetupThrottling(opt->maxrate);
+	StartTarStream(opt);
+
+	foreach(lc, files)
+	{
+		char	   *path = (char *) lfirst(lc);
+		struct stat statbuf;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (!path_is_relative_and_below_cwd(path))
+			ereport(ERROR,
+					(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+					 errmsg("path must be in or below the data directory: \"%s\"",
+							path)));
+
+		if (lstat(path, &statbuf) != 0)
+		{
+			if (errno != ENOENT)
 				ereport(ERROR,
 						(errcode_for_file_access(),
-						 errmsg("unexpected WAL file size \"%s\"", walFiles[i])));
-			}
+						 errmsg("could not stat file \"%s\": %m", path)));
+
+			/* If the file went away since it was listed, it's not an error. */
+			continue;
+		}
+
+		if (!S_ISREG(statbuf.st_mode))
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("\"%s\" is not a regular file", path)));
+
+		sendFile(path, path, &statbuf, true);
+	}
+
+	/*
+	 * The files are only usable if the backup was running all the while we
+	 * read them, and the server was not promoted meanwhile.
+	 */
+	if (!NonExclusiveBackupInProgress())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("backup was stopped while files were being sent")));
+	if (RecoveryInProgress() != backup_started_in_recovery)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("the standby was promoted during online backup"),
+				 errhint("This means that the backup being taken is corrupt "
+						 "and should not be used. "
+						 "Try taking another online backup.")));
+
+	sendCopyDone();
+}
+
+/*
+ * Finish the backup started with START_BACKUP in this session.
+ *
+ * Sends a tar stream with backup_label, pg_control and, if requested, the
+ * WAL needed to make the backup consistent, followed by the end position.
+ */
+static void
+perform_stop_backup(basebackup_options *opt)
+{
+	XLogRecPtr	startptr = session_startptr;
+	XLogRecPtr	endptr;
+	TimeLineID	endtli;
+	struct stat statbuf;
+
+	if (session_labelfile == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("a backup is not in progress in this session"),
+				 errhint("Run START_BACKUP first.")));
+
+	backup_compressor = NULL;
+
+	SetupThrottling(opt->maxrate);
+	StartTarStream(opt);
+
+	sendFileWithContent(BACKUP_LABEL_FILE, session_labelfile->data);
+
+	if (lstat(XLOG_CONTROL_FILE, &statbuf) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat control file \"%s\": %m",
+						XLOG_CONTROL_FILE)));
+	sendFile(XLOG_CONTROL_FILE, XLOG_CONTROL_FILE, &statbuf, false);
+
+	/*
+	 * If stopping the backup fails, it is over all the same, and a retry
+	 * would stop it twice.
+	 */
+	PG_ENSURE_ERROR_CLEANUP(session_backup_cleanup, (Datum) 0);
+	{
+		endptr = do_pg_stop_backup(session_labelfile->data, !opt->nowait,
+								   &endtli);
+	}
+	PG_END_ENSURE_ERROR_CLEANUP(session_backup_cleanup, (Datum) 0);
+
+	/* The backup is over, so there is nothing left to abort */
+	cancel_before_shmem_exit(session_backup_cleanup, (Datum) 0);
+	pfree(session_labelfile->data);
+	pfree(session_labelfile);
+	session_labelfile = NULL;
+	session_startptr = InvalidXLogRecPtr;
+
+	if (opt->includewal)
+		SendWalFiles(startptr, endptr);
+
+	sendCopyDone();
+
+	SendXlogRecPtrResult(endptr, endtli);
+}
 
-			/* send the WAL file itself */
-			_tarWriteHeader(pathbuf, NULL, &statbuf, false);
+/*
+ * Remember an entry found while START_BACKUP lists the files to back up.
+ */
+static void
+AddBackupFileListEntry(const char *name, const char *linktarget,
+					   struct stat *statbuf)
+{
+	backupfileinfo *fi = palloc(sizeof(backupfileinfo));
+
+	if (strncmp(name, "./", 2) == 0)
+		name += 2;
+
+	fi->path = psprintf("%s%s", listing_prefix, name);
+	if (linktarget != NULL)
+		fi->type = 'l';
+	else if (S_ISDIR(statbuf->st_mode))
+		fi->type = 'd';
+	else
+		fi->type = 'f';
+	fi->size = (fi->type == 'f') ? statbuf->st_size : 0;
+	fi->linktarget = linktarget ? pstrdup(linktarget) : NULL;
+
+	backup_file_list = lappend(backup_file_list, fi);
+}
 
-			while ((cnt = fread(buf, 1,
-								Min(sizeof(buf), wal_segment_size - len),
-								fp)) > 0)
-			{
-				CheckXLogRemoved(segno, tli);
-				/* Send the chunk as a CopyData message */
-				if (pq_putmessage('d', buf, cnt))
-					ereport(ERROR,
-							(errmsg("base backup could not send data, aborting backup")));
+/*
+ * Send the list of files to back up collected by START_BACKUP, as a result
+ * set with the path, type, size and symbolic link target of each entry.
+ */
+static void
+SendBackupFileList(List *files)
+{
+	StringInfoData buf;
+	ListCell   *lc;
 
-				len += cnt;
-				throttle(cnt);
+	pq_beginmessage(&buf, 'T'); /* RowDescription */
+	pq_sendint(&buf, 4, 2);		/* 4 fields */
 
-				if (len == wal_segment_size)
-					break;
-			}
+	pq_sendstring(&buf, "path");
+	pq_sendint(&buf, 0, 4);		/* table oid */
+	pq_sendint(&buf, 0, 2);		/* attnum */
+	pq_sendint(&buf, TEXTOID, 4);	/* type oid */
+	pq_sendint(&buf, -1, 2);	/* typlen */
+	pq_sendint(&buf, 0, 4);		/* typmod */
+	pq_sendint(&buf, 0, 2);		/* format code */
 
-			if (len != wal_segment_size)
-			{
-				CheckXLogRemoved(segno, tli);
-				ereport(ERROR,
-						(errcode_for_file_access(),
-						 errmsg("unexpected WAL file size \"%s\"", walFiles[i])));
-			}
+	pq_sendstring(&buf, "type");
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+	pq_sendint(&buf, CHAROID, 4);
+	pq_sendint(&buf, 1, 2);
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
 
-			/* wal_segment_size is a multiple of 512, so no need for padding */
+	pq_sendstring(&buf, "size");
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+	pq_sendint(&buf, INT8OID, 4);
+	pq_sendint(&buf, 8, 2);
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
 
-			FreeFile(fp);
+	pq_sendstring(&buf, "link_target");
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+	pq_sendint(&buf, TEXTOID, 4);
+	pq_sendint(&buf, -1, 2);
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+	pq_endmessage(&buf);
 
-			/*
-			 * Mark file as archived, otherwise files can get archived again
-			 * after promotion of a new node. This is in line with
-			 * walreceiver.c always doing an XLogArchiveForceDone() after a
-			 * complete segment.
-			 */
-			StatusFilePath(pathbuf, walFiles[i], ".done");
-			sendFileWithContent(pathbuf, "");
-		}
+	foreach(lc, files)
+	{
+		backupfileinfo *fi = (backupfileinfo *) lfirst(lc);
+		Size		len;
 
-		/*
-		 * Send timeline history files too. Only the latest timeline history
-		 * file is required for recovery, and even that only if there happens
-		 * to be a timeline switch in the first WAL segment that contains the
-		 * checkpoint record, or if we're taking a base backup from a standby
-		 * server and the target timeline changes while the backup is taken.
-		 * But they are small and highly useful for debugging purposes, so
-		 * better include them all, always.
-		 */
-		foreach(lc, historyFileList)
-		{
-			char	   *fname = lfirst(lc);
+		pq_beginmessage(&buf, 'D');
+		pq_sendint(&buf, 4, 2); /* number of columns */
 
-			snprintf(pathbuf, MAXPGPATH, XLOGDIR "/%s", fname);
+		len = strlen(fi->path);
+		pq_sendint(&buf, len, 4);
+		pq_sendbytes(&buf, fi->path, len);
 
-			if (lstat(pathbuf, &statbuf) != 0)
-				ereport(ERROR,
-						(errcode_for_file_access(),
-						 errmsg("could not stat file \"%s\": %m", pathbuf)));
+		pq_sendint(&buf, 1, 4);
+		pq_sendbyte(&buf, fi->type);
 
-			sendFile(pathbuf, pathbuf, &statbuf, false);
+		send_int8_string(&buf, fi->size);
 
-			/* unconditionally mark file as archived */
-			StatusFilePath(pathbuf, fname, ".done");
-			sendFileWithContent(pathbuf, "");
+		if (fi->linktarget != NULL)
+		{
+			len = strlen(fi->linktarget);
+			pq_sendint(&buf, len, 4);
+			pq_sendbytes(&buf, fi->linktarget, len);
 		}
+		else
+			pq_sendint(&buf, -1, 4);	/* NULL */
 
-		/* Send CopyDone message for the last tar file */
-		pq_putemptymessage('c');
+		pq_endmessage(&buf);
 	}
-	SendXlogRecPtrResult(endptr, endtli);
+
+	/* Send a CommandComplete message */
+	pq_puttextmessage('C', "SELECT");
 }
 
 /*
@@ -577,11 +1085,137 @@ compareWalFileNames(const void *a, const void *b)
 	return strcmp(fna + 8, fnb + 8);
 }
 
+/*
+ * Set up an incremental backup relative to a prior backup that started at
+ * 'prior_lsn': load the summaries of the WAL between there and the start of
+ * this backup, and note in the backup label that the backup is incremental.
+ */
+static void
+PrepareIncrementalBackup(XLogRecPtr prior_lsn, XLogRecPtr startptr,
+						 StringInfo labelfile)
+{
+	List	   *summaries;
+	WalSummaryFile **sorted;
+	XLogRecPtr	covered = prior_lsn;
+	ListCell   *lc;
+	int			nsummaries;
+	int			i;
+
+	if (prior_lsn > startptr)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("incremental backup start location %X/%X is ahead of the start of this backup at %X/%X",
+						(uint32) (prior_lsn >> 32), (uint32) prior_lsn,
+						(uint32) (startptr >> 32), (uint32) startptr)));
+
+	/* The summarizer might not have caught up with our checkpoint yet */
+	WaitForWalSummarization(startptr);
+
+	summaries = GetWalSummaries(prior_lsn, startptr);
+	nsummaries = list_length(summaries);
+	sorted = palloc(Max(nsummaries, 1) * sizeof(WalSummaryFile *));
+	i = 0;
+	foreach(lc, summaries)
+		sorted[i++] = lfirst(lc);
+	qsort(sorted, nsummaries, sizeof(WalSummaryFile *), compareWalSummaries);
+
+	/* Check that the summaries cover the whole range without gaps */
+	for (i = 0; i < nsummaries && covered < startptr; i++)
+	{
+		if (sorted[i]->start_lsn > covered)
+			break;
+		if (sorted[i]->end_lsn > covered)
+			covered = sorted[i]->end_lsn;
+	}
+	if (covered < startptr)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("WAL summaries are required from %X/%X to %X/%X, but the summaries for that range are incomplete",
+						(uint32) (prior_lsn >> 32), (uint32) prior_lsn,
+						(uint32) (startptr >> 32), (uint32) startptr),
+				 errdetail("The first unsummarized location in this range is %X/%X.",
+						   (uint32) (covered >> 32), (uint32) covered)));
+
+	incremental_blocks = CreateBlockRefTable();
+	for (i = 0; i < nsummaries; i++)
+		ReadWalSummary(sorted[i], incremental_blocks);
+
+	appendStringInfo(labelfile, "INCREMENTAL FROM LSN: %X/%X\n",
+					 (uint32) (prior_lsn >> 32), (uint32) prior_lsn);
+}
+
+/*
+ * qsort comparison function, to sort WAL summaries by start location.
+ */
+static int
+compareWalSummaries(const void *a, const void *b)
+{
+	WalSummaryFile *wsa = *((WalSummaryFile **) a);
+	WalSummaryFile *wsb = *((WalSummaryFile **) b);
+
+	if (wsa->start_lsn < wsb->start_lsn)
+		return -1;
+	if (wsa->start_lsn > wsb->start_lsn)
+		return 1;
+	return 0;
+}
+
+/*
+ * Name of the replication command for a kind of BaseBackupCmd.
+ */
+const char *
+BaseBackupCommandName(BaseBackupKind kind)
+{
+	switch (kind)
+	{
+		case BASE_BACKUP_KIND_SINGLE:
+			return "BASE_BACKUP";
+		case BASE_BACKUP_KIND_START:
+			return "START_BACKUP";
+		case BASE_BACKUP_KIND_SEND_FILES:
+			return "SEND_FILES";
+		case BASE_BACKUP_KIND_STOP:
+			return "STOP_BACKUP";
+	}
+	return NULL;				/* keep compiler quiet */
+}
+
+/*
+ * Can the given option be used with the given kind of command?  BASE_BACKUP
+ * accepts all of them; the others only those that affect their part of the
+ * work.
+ */
+static bool
+basebackup_option_allowed(BaseBackupKind kind, const char *name)
+{
+	switch (kind)
+	{
+		case BASE_BACKUP_KIND_SINGLE:
+			return true;
+		case BASE_BACKUP_KIND_START:
+			return strcmp(name, "label") == 0 ||
+				strcmp(name, "progress") == 0 ||
+				strcmp(name, "fast") == 0;
+		case BASE_BACKUP_KIND_SEND_FILES:
+			return strcmp(name, "max_rate") == 0 ||
+				strcmp(name, "compression") == 0 ||
+				strcmp(name, "compression_level") == 0;
+		case BASE_BACKUP_KIND_STOP:
+			return strcmp(name, "wal") == 0 ||
+				strcmp(name, "nowait") == 0 ||
+				strcmp(name, "max_rate") == 0 ||
+				strcmp(name, "compression") == 0 ||
+				strcmp(name, "compression_level") == 0;
+	}
+	return false;
+}
+
 /*
  * Parse the base backup options passed down by the parser
  */
 static void
-parse_basebackup_options(List *options, basebackup_options *opt)
+parse_basebackup_options(BaseBackupKind kind, List *options,
+						 basebackup_options *opt)
 {
 	ListCell   *lopt;
 	bool		o_label = false;
@@ -591,12 +1225,21 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	bool		o_wal = false;
 	bool		o_maxrate = false;
 	bool		o_tablespace_map = false;
+	bool		o_compression = false;
+	bool		o_compression_level = false;
+	bool		o_incremental = false;
 
 	MemSet(opt, 0, sizeof(*opt));
 	foreach(lopt, options)
 	{
 		DefElem    *defel = (DefElem *) lfirst(lopt);
 
+		if (!basebackup_option_allowed(kind, defel->defname))
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("option \"%s\" is not valid for %s",
+							defel->defname, BaseBackupCommandName(kind))));
+
 		if (strcmp(defel->defname, "label") == 0)
 		{
 			if (o_label)
@@ -670,21 +1313,63 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 			opt->sendtblspcmapfile = true;
 			o_tablespace_map = true;
 		}
+		else if (strcmp(defel->defname, "compression") == 0)
+		{
+			if (o_compression)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->compression = ParseCompressionMethod(strVal(defel->arg));
+			o_compression = true;
+		}
+		else if (strcmp(defel->defname, "compression_level") == 0)
+		{
+			if (o_compression_level)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->compression_level = ParseCompressionLevel(intVal(defel->arg));
+			o_compression_level = true;
+		}
+		else if (strcmp(defel->defname, "incremental") == 0)
+		{
+			uint32		hi,
+						lo;
+			char		ch;
+
+			if (o_incremental)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			if (sscanf(strVal(defel->arg), "%X/%X%c", &hi, &lo, &ch) != 2)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid value for option \"%s\": \"%s\"",
+								"INCREMENTAL", strVal(defel->arg))));
+			opt->incremental_lsn = ((uint64) hi) << 32 | lo;
+			o_incremental = true;
+		}
 		else
 			elog(ERROR, "option \"%s\" not recognized",
 				 defel->defname);
 	}
 	if (opt->label == NULL)
 		opt->label = "base backup";
+	if (!o_compression_level)
+		opt->compression_level = WIRE_COMPRESS_DEFAULT_LEVEL;
 }
 
 
 /*
- * SendBaseBackup() - send a complete base backup.
+ * SendBaseBackup() - send a complete base backup, or part of one.
  *
  * The function will put the system into backup mode like pg_start_backup()
  * does, so that the backup is consistent even though we read directly from
  * the filesystem, bypassing the buffer cache.
+ *
+ * Instead of BASE_BACKUP, a client can send START_BACKUP, then fetch the
+ * files with SEND_FILES over any number of connections, and finish with
+ * STOP_BACKUP on the connection that started the backup.
  */
 void
 SendBaseBackup(BaseBackupCmd *cmd)
@@ -692,7 +1377,7 @@ SendBaseBackup(BaseBackupCmd *cmd)
 	DIR		   *dir;
 	basebackup_options opt;
 
-	parse_basebackup_options(cmd->options, &opt);
+	parse_basebackup_options(cmd->kind, cmd->options, &opt);
 
 	WalSndSetState(WALSNDSTATE_BACKUP);
 
@@ -700,18 +1385,37 @@ SendBaseBackup(BaseBackupCmd *cmd)
 	{
 		char		activitymsg[50];
 
-		snprintf(activitymsg, sizeof(activitymsg), "sending backup \"%s\"",
-				 opt.label);
+		if (cmd->kind == BASE_BACKUP_KIND_SEND_FILES)
+			snprintf(activitymsg, sizeof(activitymsg), "sending backup files");
+		else if (cmd->kind == BASE_BACKUP_KIND_STOP)
+			snprintf(activitymsg, sizeof(activitymsg), "stopping backup");
+		else
+			snprintf(activitymsg, sizeof(activitymsg), "sending backup \"%s\"",
+					 opt.label);
 		set_ps_display(activitymsg, false);
 	}
 
+	if (cmd->kind == BASE_BACKUP_KIND_SEND_FILES)
+	{
+		perform_send_files(&opt, cmd->files);
+		return;
+	}
+	if (cmd->kind == BASE_BACKUP_KIND_STOP)
+	{
+		perform_stop_backup(&opt);
+		return;
+	}
+
 	/* Make sure we can open the directory with tablespaces in it */
 	dir = AllocateDir("pg_tblspc");
 	if (!dir)
 		ereport(ERROR,
 				(errmsg("could not open directory \"%s\": %m", "pg_tblspc")));
 
-	perform_base_backup(&opt, dir);
+	if (cmd->kind == BASE_BACKUP_KIND_START)
+		perform_start_backup(&opt, dir);
+	else
+		perform_base_backup(&opt, dir);
 
 	FreeDir(dir);
 }
@@ -886,7 +1590,7 @@ sendFileWithContent(const char *filename, const char *content)
 
 	_tarWriteHeader(filename, NULL, &statbuf, false);
 	/* Send the contents as a CopyData message */
-	pq_putmessage('d', content, len);
+	sendCopyData(content, len);
 
 	/* Pad to 512 byte boundary, per tar format requirements */
 	pad = ((len + 511) & ~511) - len;
@@ -895,7 +1599,7 @@ sendFileWithContent(const char *filename, const char *content)
 		char		buf[512];
 
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		sendCopyData(buf, pad);
 	}
 }
 
@@ -1167,15 +1871,37 @@ sendDir(char *path, int basepathlen, bool sizeonly, List *tablespaces,
 		else if (S_ISREG(statbuf.st_mode))
 		{
 			bool		sent = false;
+			pgoff_t		len = statbuf.st_size;
+			BlockNumber *blocks;
+			int			nblocks;
 
-			if (!sizeonly)
+			/*
+			 * In an incremental backup, send just the modified blocks of
+			 * relation files, if there are few enough of them.
+			 */
+			if (incremental_blocks != NULL &&
+				GetIncrementalBlocks(pathbuf + basepathlen + 1, &statbuf,
+									 &blocks, &nblocks))
+			{
+				len = INCREMENTAL_FILE_SIZE(nblocks);
+				if (!sizeonly)
+					sent = sendIncrementalFile(pathbuf,
+											   pathbuf + basepathlen + 1,
+											   &statbuf, blocks, nblocks);
+				pfree(blocks);
+			}
+			else if (!sizeonly)
 				sent = sendFile(pathbuf, pathbuf + basepathlen + 1, &statbuf,
 								true);
 
+			if (listing_files)
+				AddBackupFileListEntry(pathbuf + basepathlen + 1, NULL,
+									   &statbuf);
+
 			if (sent || sizeonly)
 			{
 				/* Add size, rounded up to 512byte block */
-				size += ((statbuf.st_size + 511) & ~511);
+				size += ((len + 511) & ~511);
 				size += 512;	/* Size of the header of the file */
 			}
 		}
@@ -1227,7 +1953,7 @@ sendFile(char *readfilename, char *tarfilename, struct stat *statbuf,
 	while ((cnt = fread(buf, 1, Min(sizeof(buf), statbuf->st_size - len), fp)) > 0)
 	{
 		/* Send the chunk as a CopyData message */
-		if (pq_putmessage('d', buf, cnt))
+		if (sendCopyData(buf, cnt))
 			ereport(ERROR,
 					(errmsg("base backup could not send data, aborting backup")));
 
@@ -1252,7 +1978,7 @@ sendFile(char *readfilename, char *tarfilename, struct stat *statbuf,
 		while (len < statbuf->st_size)
 		{
 			cnt = Min(sizeof(buf), statbuf->st_size - len);
-			pq_putmessage('d', buf, cnt);
+			sendCopyData(buf, cnt);
 			len += cnt;
 			throttle(cnt);
 		}
@@ -1266,7 +1992,240 @@ sendFile(char *readfilename, char *tarfilename, struct stat *statbuf,
 	if (pad > 0)
 	{
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		sendCopyData(buf, pad);
+	}
+
+	FreeFile(fp);
+
+	return true;
+}
+
+/*
+ * In an incremental backup, decide whether to send a file incrementally.
+ *
+ * Only segments of the main forks of relations can be sent incrementally.
+ * If this one can, and not too many of its blocks were modified since the
+ * prior backup, returns true and sets *blocks to a palloc'd array of the
+ * block numbers within the file to send, and *nblocks to their number.
+ */
+static bool
+GetIncrementalBlocks(const char *tarfilename, struct stat *statbuf,
+					 BlockNumber **blocks, int *nblocks)
+{
+	RelFileNode rnode;
+	const char *fname;
+	size_t		n;
+	unsigned int segno = 0;
+	BlockNumber file_nblocks;
+	BlockNumber segstart;
+	BlockNumber limit;
+	BlockNumber *modified;
+	int			nmodified;
+	BlockNumber *result;
+	int			nresult = 0;
+	int			i;
+
+	/*
+	 * Find the database directory: base/<db>/ or global/ in the data
+	 * directory, <version directory>/<db>/ in a tablespace.
+	 */
+	if (incremental_spcoid == InvalidOid &&
+		strncmp(tarfilename, "global/", 7) == 0)
+	{
+		rnode.spcNode = GLOBALTABLESPACE_OID;
+		rnode.dbNode = InvalidOid;
+		fname = tarfilename + 7;
+	}
+	else
+	{
+		const char *prefix;
+
+		if (incremental_spcoid == InvalidOid)
+		{
+			rnode.spcNode = DEFAULTTABLESPACE_OID;
+			prefix = "base/";
+		}
+		else
+		{
+			rnode.spcNode = incremental_spcoid;
+			prefix = TABLESPACE_VERSION_DIRECTORY "/";
+		}
+
+		if (strncmp(tarfilename, prefix, strlen(prefix)) != 0)
+			return false;
+		fname = tarfilename + strlen(prefix);
+
+		n = strspn(fname, "0123456789");
+		if (n == 0 || n > OIDCHARS || fname[n] != '/')
+			return false;
+		rnode.dbNode = atooid(fname);
+		fname += n + 1;
+	}
+
+	/* The file name must be <relfilenode> or <relfilenode>.<segment> */
+	n = strspn(fname, "0123456789");
+	if (n == 0 || n > OIDCHARS)
+		return false;
+	rnode.relNode = atooid(fname);
+	if (fname[n] == '.')
+	{
+		size_t		m = strspn(fname + n + 1, "0123456789");
+
+		if (m == 0 || m > OIDCHARS || fname[n + 1 + m] != '\0')
+			return false;
+		segno = (unsigned int) strtoul(fname + n + 1, NULL, 10);
+	}
+	else if (fname[n] != '\0')
+		return false;
+
+	/* All files of a database created or dropped since are sent in full */
+	if (BlockRefTableIsDatabaseModified(incremental_blocks, rnode.spcNode,
+										rnode.dbNode))
+		return false;
+
+	if (statbuf->st_size % BLCKSZ != 0)
+		return false;
+	file_nblocks = statbuf->st_size / BLCKSZ;
+	segstart = segno * RELSEG_SIZE;
+
+	limit = BlockRefTableGetBlocks(incremental_blocks, &rnode, &modified,
+								   &nmodified);
+
+	result = palloc(Max(file_nblocks, 1) * sizeof(BlockNumber));
+
+	/* The modified blocks in this segment... */
+	for (i = 0; i < nmodified; i++)
+	{
+		if (modified[i] < segstart)
+			continue;
+		if (modified[i] - segstart >= file_nblocks)
+			break;
+		result[nresult++] = modified[i] - segstart;
+	}
+
+	/* ... and all blocks from the limit block on, which follow them */
+	if (limit != InvalidBlockNumber)
+	{
+		BlockNumber blkno = (limit > segstart) ? limit - segstart : 0;
+
+		for (; blkno < file_nblocks; blkno++)
+			result[nresult++] = blkno;
+	}
+
+	/*
+	 * If most of the file is to be sent anyway, send it whole, which saves
+	 * pg_combinebackup the work of reconstructing it.
+	 */
+	if ((uint64) nresult * 10 >= (uint64) file_nblocks * 9)
+	{
+		pfree(result);
+		return false;
+	}
+
+	*blocks = result;
+	*nblocks = nresult;
+	return true;
+}
+
+/*
+ * Send the given blocks of a relation file as an incremental file, in the
+ * format described in basebackup.h.
+ *
+ * Returns true if the file was successfully sent, false if it did not
+ * exist anymore.
+ */
+static bool
+sendIncrementalFile(char *readfilename, char *tarfilename,
+					struct stat *statbuf, BlockNumber *blocks, int nblocks)
+{
+	FILE	   *fp;
+	char		buf[TAR_SEND_SIZE];
+	char		incname[MAXPGPATH * 2];
+	char	   *fname;
+	struct stat incstatbuf;
+	uint32		hdr[3];
+	size_t		cnt = 0;
+	pgoff_t		len;
+	size_t		pad;
+	int			i;
+
+	fp = AllocateFile(readfilename, "rb");
+	if (fp == NULL)
+	{
+		if (errno == ENOENT)
+			return false;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", readfilename)));
+	}
+
+	/* The incremental file goes next to where the full file would */
+	fname = last_dir_separator(tarfilename);
+	Assert(fname != NULL);
+	snprintf(incname, sizeof(incname), "%.*s/%s%s",
+			 (int) (fname - tarfilename), tarfilename,
+			 INCREMENTAL_PREFIX, fname + 1);
+
+	incstatbuf = *statbuf;
+	incstatbuf.st_size = INCREMENTAL_FILE_SIZE(nblocks);
+	_tarWriteHeader(incname, NULL, &incstatbuf, false);
+
+	hdr[0] = INCREMENTAL_MAGIC;
+	hdr[1] = statbuf->st_size / BLCKSZ;
+	hdr[2] = nblocks;
+	if (sendCopyData((char *) hdr, sizeof(hdr)) ||
+		(nblocks > 0 &&
+		 sendCopyData((char *) blocks, nblocks * sizeof(BlockNumber))))
+		ereport(ERROR,
+				(errmsg("base backup could not send data, aborting backup")));
+	len = INCREMENTAL_HEADER_SIZE(nblocks);
+	throttle(len);
+
+	for (i = 0; i < nblocks; i++)
+	{
+		size_t		nread;
+
+		if (fseeko(fp, (off_t) blocks[i] * BLCKSZ, SEEK_SET) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek in file \"%s\": %m",
+							readfilename)));
+
+		nread = fread(buf + cnt, 1, BLCKSZ, fp);
+		if (nread < BLCKSZ)
+		{
+			if (ferror(fp))
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read file \"%s\": %m",
+								readfilename)));
+
+			/*
+			 * The file was truncated while we were sending it.  Send zeros
+			 * instead, like sendFile() does; WAL replay fixes it up.
+			 */
+			MemSet(buf + cnt + nread, 0, BLCKSZ - nread);
+		}
+		cnt += BLCKSZ;
+
+		if (cnt + BLCKSZ > sizeof(buf) || i == nblocks - 1)
+		{
+			/* Send the chunk as a CopyData message */
+			if (sendCopyData(buf, cnt))
+				ereport(ERROR,
+						(errmsg("base backup could not send data, aborting backup")));
+			len += cnt;
+			throttle(cnt);
+			cnt = 0;
+		}
+	}
+
+	/* Pad to 512 byte boundary, per tar format requirements */
+	pad = ((len + 511) & ~511) - len;
+	if (pad > 0)
+	{
+		MemSet(buf, 0, pad);
+		sendCopyData(buf, pad);
 	}
 
 	FreeFile(fp);
@@ -1282,6 +2241,9 @@ _tarWriteHeader(const char *filename, const char *linktarget,
 	char		h[512];
 	enum tarError rc;
 
+	if (listing_files)
+		AddBackupFileListEntry(filename, linktarget, statbuf);
+
 	if (!sizeonly)
 	{
 		rc = tarCreateHeader(h, filename, linktarget, statbuf->st_size,
@@ -1307,7 +2269,7 @@ _tarWriteHeader(const char *filename, const char *linktarget,
 				elog(ERROR, "unrecognized tar error: %d", rc);
 		}
 
-		pq_putmessage('d', h, sizeof(h));
+		sendCopyData(h, sizeof(h));
 	}
 
 	return sizeof(h);
@@ -1405,3 +2367,46 @@ throttle(size_t increment)
 	 */
 	throttled_last = GetCurrentTimestamp();
 }
+
+/*
+ * Send a chunk of the tar stream as a CopyData message, compressing it
+ * first if the client asked for that.  Returns 0 if OK, EOF if trouble,
+ * like pq_putmessage().
+ */
+static int
+sendCopyData(const char *data, int len)
+{
+	if (backup_compressor != NULL)
+	{
+		char	   *cdata;
+
+		/*
+		 * libpq silently drops empty CopyData messages, so don't turn them
+		 * into non-empty ones.
+		 */
+		if (len == 0)
+			return 0;
+
+		if (!wire_compress(backup_compressor, data, len, &cdata, &len))
+			ereport(ERROR,
+					(errmsg("could not compress base backup data")));
+		data = cdata;
+	}
+
+	return pq_putmessage('d', data, len);
+}
+
+/*
+ * End the current tar stream.
+ */
+static void
+sendCopyDone(void)
+{
+	if (backup_compressor != NULL)
+	{
+		wire_compressor_free(backup_compressor);
+		backup_compressor = NULL;
+	}
+
+	pq_putemptymessage('c');
+}
@@ -45,6 +45,8 @@ struct WalReceiverConn
 	bool		logical;
 	/* Buffer for currently read records */
 	char	   *recvBuf;
+	/* Decompressor for the physical stream, if compression was requested */
+	WireCompressor *decompressor;
 };
 
 /* Prototypes for interface functions */
@@ -53,6 +55,7 @@ static WalReceiverConn *libpqrcv_connect(const char *conninfo,
 				 char **err);
 static void libpqrcv_check_conninfo(const char *conninfo);
 static char *libpqrcv_get_conninfo(WalReceiverConn *conn);
+static int	libpqrcv_server_version(WalReceiverConn *conn);
 static char *libpqrcv_identify_system(WalReceiverConn *conn,
 						 TimeLineID *primary_tli,
 						 int *server_version);
@@ -82,6 +85,7 @@ static WalReceiverFunctionsType PQWalReceiverFunctions = {
 	libpqrcv_connect,
 	libpqrcv_check_conninfo,
 	libpqrcv_get_conninfo,
+	libpqrcv_server_version,
 	libpqrcv_identify_system,
 	libpqrcv_readtimelinehistoryfile,
 	libpqrcv_startstreaming,
@@ -282,6 +286,15 @@ libpqrcv_get_conninfo(WalReceiverConn *conn)
 	return retval;
 }
 
+/*
+ * Return the server version of the connected server.
+ */
+static int
+libpqrcv_server_version(WalReceiverConn *conn)
+{
+	return PQserverVersion(conn->streamConn);
+}
+
 /*
  * Check that primary's system identifier matches ours, and fetch the current
  * timeline ID of the primary.
@@ -392,12 +405,52 @@ libpqrcv_startstreaming(WalReceiverConn *conn,
 		PQfreemem(pubnames_literal);
 		pfree(pubnames_str);
 
+		if (options->proto.logical.streaming)
+			appendStringInfoString(&cmd, ", streaming 'on'");
+
+		if (options->proto.logical.binary)
+			appendStringInfoString(&cmd, ", binary 'true'");
+
 		appendStringInfoChar(&cmd, ')');
 	}
 	else
+	{
+		WireCompressMethod compression = options->proto.physical.compression;
+		int			level = options->proto.physical.compression_level;
+
 		appendStringInfo(&cmd, " TIMELINE %u",
 						 options->proto.physical.startpointTLI);
 
+		/*
+		 * Servers before 11 don't know how to compress the stream, so just
+		 * stream uncompressed from those.
+		 */
+		if (conn->decompressor != NULL)
+		{
+			wire_compressor_free(conn->decompressor);
+			conn->decompressor = NULL;
+		}
+		if (compression != WIRE_COMPRESS_NONE &&
+			PQserverVersion(conn->streamConn) >= 110000)
+		{
+			MemoryContext oldcontext;
+
+			appendStringInfo(&cmd, " COMPRESSION '%s'",
+							 wire_compress_method_name(compression));
+			if (level != WIRE_COMPRESS_DEFAULT_LEVEL)
+				appendStringInfo(&cmd, " COMPRESSION_LEVEL %d", level);
+
+			oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+			conn->decompressor = wire_compressor_create(compression, level,
+														true);
+			MemoryContextSwitchTo(oldcontext);
+			if (conn->decompressor == NULL)
+				ereport(ERROR,
+						(errmsg("could not initialize %s decompression",
+								wire_compress_method_name(compression))));
+		}
+	}
+
 	/* Start streaming. */
 	res = libpqrcv_PQexec(conn->streamConn, cmd.data);
 	pfree(cmd.data);
@@ -639,6 +692,8 @@ libpqrcv_disconnect(WalReceiverConn *conn)
 	PQfinish(conn->streamConn);
 	if (conn->recvBuf != NULL)
 		PQfreemem(conn->recvBuf);
+	if (conn->decompressor != NULL)
+		wire_compressor_free(conn->decompressor);
 	pfree(conn);
 }
 
@@ -735,6 +790,17 @@ libpqrcv_receive(WalReceiverConn *conn, char **buffer,
 				(errmsg("could not receive data from WAL stream: %s",
 						pchomp(PQerrorMessage(conn->streamConn)))));
 
+	/* Decompress the message, if the stream is compressed */
+	if (conn->decompressor != NULL)
+	{
+		if (!wire_decompress(conn->decompressor, conn->recvBuf, rawlen,
+							 buffer, &rawlen))
+			ereport(ERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("could not decompress data from WAL stream")));
+		return rawlen;
+	}
+
 	/* Return received messages to caller */
 	*buffer = conn->recvBuf;
 	return rawlen;
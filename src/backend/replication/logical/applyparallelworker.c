@@ -0,0 +1,1118 @@
+/*-------------------------------------------------------------------------
+ * applyparallelworker.c
+ *	   Apply logical replication transactions in parallel workers.
+ *
+ * Copyright (c) 2016-2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/logical/applyparallelworker.c
+ *
+ * NOTES
+ *	  Normally the apply worker applies each remote transaction itself, one
+ *	  after the other, so a subscriber can apply changes no faster than one
+ *	  backend manages, however many sessions produced them on the publisher.
+ *	  With max_parallel_apply_workers_per_subscription > 0, the apply worker
+ *	  acts as the leader of up to that many parallel apply workers: it
+ *	  collects the messages of each remote transaction until COMMIT, and
+ *	  hands the whole transaction to one of the workers through a shm_mq.
+ *
+ *	  To keep the result the same as applying the transactions one by one,
+ *	  the leader works out which rows each transaction touches, by hashing
+ *	  the replica identity of every changed row, and remembers which
+ *	  transaction last touched each hash.  A transaction that touches the
+ *	  same rows as a transaction that hasn't committed yet goes to the same
+ *	  worker, and the worker waits for that transaction to commit before
+ *	  applying it.  Transactions whose rows can't be known that way are
+ *	  applied once all earlier transactions have committed, and later ones
+ *	  wait for them in turn: those changing relations that have triggers
+ *	  enabled for replicas, or unique or exclusion constraints that rows with
+ *	  a different replica identity may violate, those with unchanged TOASTed
+ *	  key values, and transactions too large to be buffered in memory, which
+ *	  are passed on in chunks as they arrive.
+ *
+ *	  The workers always commit in the order the transactions committed on
+ *	  the publisher, waiting for their predecessor's transaction lock so that
+ *	  the deadlock detector sees any cycle between them.  That keeps the
+ *	  replication origin, which the workers share with the leader, and the
+ *	  positions the leader reports to the publisher, exactly as they would be
+ *	  with serial apply, so nothing changes for crash recovery.
+ *
+ *	  Parallel apply is only used while no table of the subscription is
+ *	  being synchronized; the leader applies streamed transactions itself,
+ *	  and waits for the workers before doing so.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "pgstat.h"
+
+#include "access/transam.h"
+#include "access/xact.h"
+
+#include "libpq/pqsignal.h"
+
+#include "postmaster/bgworker.h"
+
+#include "replication/logicallauncher.h"
+#include "replication/logicalworker.h"
+#include "replication/origin.h"
+#include "replication/worker_internal.h"
+
+#include "storage/condition_variable.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
+
+#include "tcop/tcopprot.h"
+
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+/* Magic number and keys for the parallel apply DSM segment */
+#define PARALLEL_APPLY_MAGIC		0x4c415057
+#define PARALLEL_APPLY_KEY_SHARED	0
+#define PARALLEL_APPLY_KEY_QUEUE	1	/* plus worker number */
+
+/* Size of each worker's queue */
+#define PARALLEL_APPLY_QUEUE_SIZE	(1024 * 1024)
+
+/* Transactions larger than this are passed on as they arrive */
+#define PARALLEL_APPLY_MAX_BUFFERED	(8 * 1024 * 1024)
+
+/* Transactions touching more rows are applied serially */
+#define PARALLEL_APPLY_MAX_TXN_KEYS	8192
+
+/* Forget about rows of committed transactions beyond this many */
+#define PARALLEL_APPLY_MAX_KEYS		65536
+
+/* What a worker is busy with */
+typedef struct ParallelApplyWorkerState
+{
+	uint64		seq;			/* transaction being applied, or 0 */
+	TransactionId xid;			/* its local xid, once assigned */
+} ParallelApplyWorkerState;
+
+/* Shared state, in the DSM segment */
+typedef struct ParallelApplyShared
+{
+	slock_t		mutex;
+	PGPROC	   *leader;
+	bool		failed;			/* has a participant gone away? */
+	int			attaching;		/* number of the worker being launched */
+	uint64		last_committed; /* transactions are committed up to here */
+	XLogRecPtr	remote_end;		/* end of the last committed transaction */
+	XLogRecPtr	local_end;
+	ConditionVariable cv;		/* signaled at each commit */
+	int			nworkers;
+	ParallelApplyWorkerState workers[FLEXIBLE_ARRAY_MEMBER];
+} ParallelApplyShared;
+
+/*
+ * Sent ahead of the messages in each queue message.  Transactions are
+ * numbered in commit order from 1; a message with seq 0 only carries schema
+ * information.
+ */
+typedef struct ParallelApplyHeader
+{
+	uint64		seq;
+	uint64		depends_on;		/* transaction to wait for before applying */
+} ParallelApplyHeader;
+
+/* Transaction that last touched a row, by hash of the row's identity */
+typedef struct ParallelApplyKey
+{
+	uint32		hash;			/* hash key - must be first */
+	uint64		seq;
+	int			worker;
+} ParallelApplyKey;
+
+/* RELATION or TYPE message every new worker needs to see */
+typedef struct ParallelApplySchemaKey
+{
+	char		action;
+	Oid			id;
+} ParallelApplySchemaKey;
+
+typedef struct ParallelApplySchema
+{
+	ParallelApplySchemaKey key; /* hash key - must be first */
+	char	   *data;
+	int			len;
+} ParallelApplySchema;
+
+/* Leader's state */
+typedef struct ParallelApplyLeader
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	ParallelApplyShared *shared;
+	int			nworkers_max;	/* workers we have room for */
+	int			nworkers;		/* workers launched */
+	shm_mq_handle **queues;
+	uint64	   *dispatched;		/* per worker: last transaction sent */
+	uint64		last_seq;		/* last transaction sent */
+	int			last_worker;	/* worker it was sent to */
+	uint64		barrier_seq;	/* last transaction applied serially */
+	int			barrier_worker;
+	HTAB	   *keys;			/* ParallelApplyKey entries */
+	XLogRecPtr	reported_end;	/* remote_end last returned as progress */
+
+	/* The transaction being collected */
+	StringInfoData buf;			/* header, then the messages */
+	int			nchanges;
+	bool		serial;			/* can't be applied concurrently */
+	uint32	   *txkeys;			/* hashes of the rows it touches */
+	int			ntxkeys;
+	int			ntxkeys_max;
+	bool		flushing;		/* large, and already partly sent? */
+} ParallelApplyLeader;
+
+static ParallelApplyLeader *pa = NULL;
+
+/* Schema messages received since the leader connected */
+static HTAB *schema_msgs = NULL;
+
+/* Worker's state */
+static ParallelApplyShared *MyParallelShared = NULL;
+static int	MyParallelWorker = -1;
+static uint64 MyParallelSeq = 0;
+
+/* Flags set by signal handlers */
+static volatile sig_atomic_t got_SIGHUP = false;
+
+static bool parallel_apply_setup(void);
+static void parallel_apply_shutdown(void);
+static int	parallel_apply_launch(void);
+static int	parallel_apply_choose_worker(uint64 last_committed);
+static void parallel_apply_send(int worker, char *data, int len);
+static void parallel_apply_flush(void);
+static void parallel_apply_prune_keys(uint64 last_committed);
+static void parallel_apply_finish_lookup(void);
+static uint64 parallel_apply_last_committed(void);
+static void parallel_apply_check_failed(ParallelApplyShared *shared);
+static void parallel_apply_on_detach(dsm_segment *seg, Datum arg);
+static void parallel_apply_wait_committed(uint64 seq);
+static void parallel_apply_sighup(SIGNAL_ARGS);
+
+
+/*
+ * Create the DSM segment for as many workers as the GUC allows.  Workers
+ * are launched on demand.  Returns false if the segment can't be created.
+ */
+static bool
+parallel_apply_setup(void)
+{
+	int			nworkers = max_parallel_apply_workers_per_subscription;
+	shm_toc_estimator e;
+	Size		sharedsize;
+	Size		segsize;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	ParallelApplyShared *shared;
+	HASHCTL		ctl;
+	int			i;
+
+	Assert(pa == NULL);
+
+	sharedsize = add_size(offsetof(ParallelApplyShared, workers),
+						  mul_size(nworkers, sizeof(ParallelApplyWorkerState)));
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sharedsize);
+	for (i = 0; i < nworkers; i++)
+		shm_toc_estimate_chunk(&e, PARALLEL_APPLY_QUEUE_SIZE);
+	shm_toc_estimate_keys(&e, 1 + nworkers);
+	segsize = shm_toc_estimate(&e);
+
+	seg = dsm_create(segsize, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (seg == NULL)
+		return false;
+	dsm_pin_mapping(seg);
+	toc = shm_toc_create(PARALLEL_APPLY_MAGIC, dsm_segment_address(seg),
+						 segsize);
+
+	shared = shm_toc_allocate(toc, sharedsize);
+	SpinLockInit(&shared->mutex);
+	shared->leader = MyProc;
+	shared->failed = false;
+	shared->attaching = -1;
+	shared->last_committed = 0;
+	shared->remote_end = InvalidXLogRecPtr;
+	shared->local_end = InvalidXLogRecPtr;
+	ConditionVariableInit(&shared->cv);
+	shared->nworkers = nworkers;
+	for (i = 0; i < nworkers; i++)
+	{
+		shared->workers[i].seq = 0;
+		shared->workers[i].xid = InvalidTransactionId;
+	}
+	shm_toc_insert(toc, PARALLEL_APPLY_KEY_SHARED, shared);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(shm_toc_allocate(toc, PARALLEL_APPLY_QUEUE_SIZE),
+						   PARALLEL_APPLY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+		shm_toc_insert(toc, PARALLEL_APPLY_KEY_QUEUE + i, mq);
+	}
+
+	on_dsm_detach(seg, parallel_apply_on_detach, PointerGetDatum(shared));
+
+	pa = MemoryContextAllocZero(ApplyContext, sizeof(ParallelApplyLeader));
+	pa->seg = seg;
+	pa->toc = toc;
+	pa->shared = shared;
+	pa->nworkers_max = nworkers;
+	pa->queues = MemoryContextAllocZero(ApplyContext,
+										nworkers * sizeof(shm_mq_handle *));
+	pa->dispatched = MemoryContextAllocZero(ApplyContext,
+											nworkers * sizeof(uint64));
+	pa->last_worker = -1;
+	pa->barrier_worker = -1;
+
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(uint32);
+	ctl.entrysize = sizeof(ParallelApplyKey);
+	ctl.hcxt = ApplyContext;
+	pa->keys = hash_create("logical replication parallel apply keys",
+						   1024, &ctl,
+						   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	pa->buf.data = MemoryContextAlloc(ApplyContext, BLCKSZ);
+	pa->buf.maxlen = BLCKSZ;
+	pa->ntxkeys_max = 64;
+	pa->txkeys = MemoryContextAlloc(ApplyContext,
+									pa->ntxkeys_max * sizeof(uint32));
+
+	return true;
+}
+
+/*
+ * Detach from the segment, which makes the workers exit.  All transactions
+ * must have been committed.
+ */
+static void
+parallel_apply_shutdown(void)
+{
+	int			i;
+
+	Assert(!parallel_apply_in_progress());
+
+	for (i = 0; i < pa->nworkers; i++)
+		shm_mq_detach(pa->queues[i]);
+	dsm_detach(pa->seg);
+
+	hash_destroy(pa->keys);
+	pfree(pa->buf.data);
+	pfree(pa->txkeys);
+	pfree(pa->queues);
+	pfree(pa->dispatched);
+	pfree(pa);
+	pa = NULL;
+}
+
+/*
+ * Launch another worker, and bring it up to date with the schema.  Returns
+ * the worker's number, or -1 if it couldn't be launched, in which case we
+ * stop trying.
+ */
+static int
+parallel_apply_launch(void)
+{
+	int			worker = pa->nworkers;
+	shm_mq	   *mq;
+	MemoryContext oldctx;
+
+	Assert(worker < pa->nworkers_max);
+
+	pa->shared->attaching = worker;
+
+	if (!logicalrep_worker_launch(MyLogicalRepWorker->dbid,
+								  MySubscription->oid,
+								  MySubscription->name,
+								  MyLogicalRepWorker->userid,
+								  InvalidOid,
+								  dsm_segment_handle(pa->seg)))
+	{
+		pa->nworkers_max = pa->nworkers;
+		return -1;
+	}
+
+	/* The queue handle must survive until we shut down. */
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+	mq = shm_toc_lookup(pa->toc, PARALLEL_APPLY_KEY_QUEUE + worker, false);
+	pa->queues[worker] = shm_mq_attach(mq, pa->seg, NULL);
+	MemoryContextSwitchTo(oldctx);
+	pa->nworkers++;
+
+	if (schema_msgs != NULL)
+	{
+		HASH_SEQ_STATUS status;
+		ParallelApplySchema *schema;
+
+		hash_seq_init(&status, schema_msgs);
+		while ((schema = (ParallelApplySchema *) hash_seq_search(&status)) != NULL)
+			parallel_apply_send(worker, schema->data, schema->len);
+	}
+
+	return worker;
+}
+
+/*
+ * Choose a worker for a transaction that doesn't depend on any other: an
+ * idle one if there is one, a new one if we may launch it, or else the one
+ * with the least work queued.
+ */
+static int
+parallel_apply_choose_worker(uint64 last_committed)
+{
+	int			worker = -1;
+	int			i;
+
+	for (i = 0; i < pa->nworkers; i++)
+	{
+		if (pa->dispatched[i] <= last_committed)
+			return i;
+	}
+
+	if (pa->nworkers < pa->nworkers_max)
+	{
+		worker = parallel_apply_launch();
+		if (worker >= 0)
+			return worker;
+	}
+
+	for (i = 0; i < pa->nworkers; i++)
+	{
+		if (worker < 0 || pa->dispatched[i] < pa->dispatched[worker])
+			worker = i;
+	}
+
+	Assert(worker >= 0);
+	return worker;
+}
+
+/*
+ * Put a message into a worker's queue, waiting for room if necessary.
+ */
+static void
+parallel_apply_send(int worker, char *data, int len)
+{
+	shm_mq_result res;
+
+	parallel_apply_check_failed(pa->shared);
+
+	res = shm_mq_send(pa->queues[worker], len, data, false);
+	if (res != SHM_MQ_SUCCESS)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not send data to logical replication parallel apply worker")));
+}
+
+/*
+ * Is the leader in a position to hand the next remote transaction to a
+ * parallel apply worker?  If so, start collecting its messages.  Otherwise
+ * the caller must wait for the workers with parallel_apply_wait_all() and
+ * apply the transaction itself.
+ */
+bool
+parallel_apply_begin(void)
+{
+	MemoryContext oldctx = CurrentMemoryContext;
+	bool		ready;
+
+	/* Start afresh if the number of workers was changed. */
+	if (pa != NULL &&
+		pa->shared->nworkers != max_parallel_apply_workers_per_subscription)
+	{
+		parallel_apply_wait_all();
+		parallel_apply_shutdown();
+	}
+
+	if (max_parallel_apply_workers_per_subscription == 0)
+		return false;
+
+	/* Tablesync workers rely on seeing the changes in order. */
+	ready = AllTablesyncsReady();
+	MemoryContextSwitchTo(oldctx);
+	if (!ready)
+		return false;
+
+	if (pa == NULL && !parallel_apply_setup())
+		return false;
+
+	/* If no worker could be launched, we're on our own. */
+	if (pa->nworkers_max == 0)
+		return false;
+
+	resetStringInfo(&pa->buf);
+	pa->buf.len = sizeof(ParallelApplyHeader);
+	pa->nchanges = 0;
+	pa->serial = false;
+	pa->ntxkeys = 0;
+	pa->flushing = false;
+
+	return true;
+}
+
+/*
+ * Add a message to the transaction being collected.  The action has been
+ * read from the message already, and is stored along with the rest.
+ */
+void
+parallel_apply_add_message(char action, StringInfo s)
+{
+	int			len = (s->len - s->cursor) + sizeof(char);
+
+	Assert(pa != NULL);
+
+	if (action == 'I' || action == 'U' || action == 'D')
+		pa->nchanges++;
+
+	appendBinaryStringInfo(&pa->buf, (char *) &len, sizeof(len));
+	appendStringInfoChar(&pa->buf, action);
+	appendBinaryStringInfo(&pa->buf, &s->data[s->cursor], len - sizeof(char));
+
+	/* Too large to buffer, so pass on what we have. */
+	if (pa->buf.len > PARALLEL_APPLY_MAX_BUFFERED)
+		parallel_apply_flush();
+}
+
+/*
+ * Remember that the transaction being collected touches rows whose identity
+ * hashes to this value.
+ */
+void
+parallel_apply_add_key(uint32 hash)
+{
+	Assert(pa != NULL);
+
+	if (pa->serial)
+		return;
+
+	if (pa->ntxkeys >= PARALLEL_APPLY_MAX_TXN_KEYS)
+	{
+		parallel_apply_set_serial();
+		return;
+	}
+
+	if (pa->ntxkeys >= pa->ntxkeys_max)
+	{
+		pa->ntxkeys_max *= 2;
+		pa->txkeys = repalloc(pa->txkeys, pa->ntxkeys_max * sizeof(uint32));
+	}
+
+	pa->txkeys[pa->ntxkeys++] = hash;
+}
+
+/*
+ * The transaction being collected must not be applied concurrently with any
+ * other.
+ */
+void
+parallel_apply_set_serial(void)
+{
+	Assert(pa != NULL);
+
+	pa->serial = true;
+	pa->ntxkeys = 0;
+}
+
+/*
+ * Send what we have of a transaction too large to buffer to a worker, which
+ * starts applying it once all earlier transactions have committed.
+ */
+static void
+parallel_apply_flush(void)
+{
+	ParallelApplyHeader *header = (ParallelApplyHeader *) pa->buf.data;
+
+	parallel_apply_finish_lookup();
+
+	if (!pa->flushing)
+	{
+		uint64		last_committed = parallel_apply_last_committed();
+		int			worker;
+
+		parallel_apply_set_serial();
+
+		header->seq = ++pa->last_seq;
+		header->depends_on = header->seq - 1;
+
+		/* The worker that has the previous transaction needn't wait. */
+		if (pa->last_worker >= 0 &&
+			pa->dispatched[pa->last_worker] > last_committed)
+			worker = pa->last_worker;
+		else
+			worker = parallel_apply_choose_worker(last_committed);
+
+		pa->dispatched[worker] = header->seq;
+		pa->last_worker = worker;
+		pa->flushing = true;
+	}
+	else
+		header->depends_on = 0;
+
+	parallel_apply_send(pa->last_worker, pa->buf.data, pa->buf.len);
+
+	pa->buf.len = sizeof(ParallelApplyHeader);
+}
+
+/*
+ * The transaction being collected is complete; send it to a worker.
+ */
+void
+parallel_apply_dispatch(void)
+{
+	ParallelApplyHeader *header = (ParallelApplyHeader *) pa->buf.data;
+	uint64		last_committed;
+	uint64		depends_on = 0;
+	int			worker = -1;
+	int			i;
+
+	Assert(pa != NULL);
+
+	parallel_apply_finish_lookup();
+
+	if (pa->flushing)
+	{
+		header->depends_on = 0;
+		parallel_apply_send(pa->last_worker, pa->buf.data, pa->buf.len);
+
+		pa->barrier_seq = header->seq;
+		pa->barrier_worker = pa->last_worker;
+		pa->flushing = false;
+		return;
+	}
+
+	/* Nothing to apply, so nothing to wait for either. */
+	if (pa->nchanges == 0)
+		return;
+
+	last_committed = parallel_apply_last_committed();
+	header->seq = ++pa->last_seq;
+
+	if (pa->serial)
+	{
+		depends_on = header->seq - 1;
+		if (pa->last_worker >= 0 &&
+			pa->dispatched[pa->last_worker] > last_committed)
+			worker = pa->last_worker;
+	}
+	else
+	{
+		/* Find the latest uncommitted transaction touching the same rows. */
+		for (i = 0; i < pa->ntxkeys; i++)
+		{
+			ParallelApplyKey *key;
+
+			key = hash_search(pa->keys, &pa->txkeys[i], HASH_FIND, NULL);
+			if (key != NULL && key->seq > last_committed &&
+				key->seq > depends_on)
+			{
+				depends_on = key->seq;
+				worker = key->worker;
+			}
+		}
+
+		if (pa->barrier_seq > last_committed &&
+			pa->barrier_seq > depends_on)
+		{
+			depends_on = pa->barrier_seq;
+			worker = pa->barrier_worker;
+		}
+	}
+
+	if (depends_on <= last_committed)
+		depends_on = 0;
+
+	if (worker < 0)
+		worker = parallel_apply_choose_worker(last_committed);
+
+	header->depends_on = depends_on;
+	parallel_apply_send(worker, pa->buf.data, pa->buf.len);
+
+	pa->dispatched[worker] = header->seq;
+	pa->last_worker = worker;
+
+	if (pa->serial)
+	{
+		pa->barrier_seq = header->seq;
+		pa->barrier_worker = worker;
+	}
+	else
+	{
+		for (i = 0; i < pa->ntxkeys; i++)
+		{
+			ParallelApplyKey *key;
+
+			key = hash_search(pa->keys, &pa->txkeys[i], HASH_ENTER, NULL);
+			key->seq = header->seq;
+			key->worker = worker;
+		}
+	}
+
+	if (hash_get_num_entries(pa->keys) > PARALLEL_APPLY_MAX_KEYS)
+		parallel_apply_prune_keys(last_committed);
+}
+
+/*
+ * Forget about rows last touched by committed transactions.
+ */
+static void
+parallel_apply_prune_keys(uint64 last_committed)
+{
+	HASH_SEQ_STATUS status;
+	ParallelApplyKey *key;
+
+	hash_seq_init(&status, pa->keys);
+	while ((key = (ParallelApplyKey *) hash_seq_search(&status)) != NULL)
+	{
+		if (key->seq <= last_committed)
+			hash_search(pa->keys, &key->hash, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Handle a RELATION or TYPE message: the workers need to know about it
+ * before they apply any later changes, and so do workers launched later.
+ */
+void
+parallel_apply_send_schema(char action, Oid id, StringInfo s)
+{
+	ParallelApplySchemaKey key;
+	ParallelApplySchema *schema;
+	ParallelApplyHeader header;
+	int			len = (s->len - s->cursor) + sizeof(char);
+	bool		found;
+	int			i;
+
+	if (schema_msgs == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(ParallelApplySchemaKey);
+		ctl.entrysize = sizeof(ParallelApplySchema);
+		ctl.hcxt = ApplyContext;
+		schema_msgs = hash_create("logical replication parallel apply schema",
+								  128, &ctl,
+								  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	MemSet(&key, 0, sizeof(key));
+	key.action = action;
+	key.id = id;
+
+	schema = hash_search(schema_msgs, &key, HASH_ENTER, &found);
+	if (found)
+		pfree(schema->data);
+
+	header.seq = 0;
+	header.depends_on = 0;
+
+	schema->len = sizeof(header) + sizeof(len) + len;
+	schema->data = MemoryContextAlloc(ApplyContext, schema->len);
+	memcpy(schema->data, &header, sizeof(header));
+	memcpy(schema->data + sizeof(header), &len, sizeof(len));
+	schema->data[sizeof(header) + sizeof(len)] = action;
+	memcpy(schema->data + sizeof(header) + sizeof(len) + sizeof(char),
+		   &s->data[s->cursor], len - sizeof(char));
+
+	if (pa == NULL || pa->nworkers == 0)
+		return;
+
+	/* Don't keep a transaction open while waiting for room in the queue. */
+	parallel_apply_finish_lookup();
+
+	for (i = 0; i < pa->nworkers; i++)
+		parallel_apply_send(i, schema->data, schema->len);
+}
+
+/*
+ * Wait until the workers have committed all transactions sent to them.
+ */
+void
+parallel_apply_wait_all(void)
+{
+	if (pa == NULL)
+		return;
+
+	parallel_apply_wait_committed(pa->last_seq);
+}
+
+/*
+ * Have the workers got transactions they haven't committed yet?
+ */
+bool
+parallel_apply_in_progress(void)
+{
+	if (pa == NULL)
+		return false;
+
+	return parallel_apply_last_committed() < pa->last_seq;
+}
+
+/*
+ * Get the end of the last transaction committed by the workers, in remote
+ * and local WAL.  Returns false if there's nothing new since the last call.
+ */
+bool
+parallel_apply_get_progress(XLogRecPtr *remote_end, XLogRecPtr *local_end)
+{
+	ParallelApplyShared *shared;
+
+	if (pa == NULL)
+		return false;
+
+	shared = pa->shared;
+	parallel_apply_check_failed(shared);
+
+	SpinLockAcquire(&shared->mutex);
+	*remote_end = shared->remote_end;
+	*local_end = shared->local_end;
+	SpinLockRelease(&shared->mutex);
+
+	if (*remote_end <= pa->reported_end)
+		return false;
+
+	pa->reported_end = *remote_end;
+	return true;
+}
+
+/*
+ * Commit the transaction the leader may have started to look up relations,
+ * before waiting for the workers, so as not to hold back others meanwhile.
+ */
+static void
+parallel_apply_finish_lookup(void)
+{
+	if (IsTransactionState())
+	{
+		CommitTransactionCommand();
+		MemoryContextSwitchTo(ApplyMessageContext);
+	}
+}
+
+static uint64
+parallel_apply_last_committed(void)
+{
+	uint64		last_committed;
+
+	SpinLockAcquire(&pa->shared->mutex);
+	last_committed = pa->shared->last_committed;
+	SpinLockRelease(&pa->shared->mutex);
+
+	return last_committed;
+}
+
+static void
+parallel_apply_check_failed(ParallelApplyShared *shared)
+{
+	bool		failed;
+
+	SpinLockAcquire(&shared->mutex);
+	failed = shared->failed;
+	SpinLockRelease(&shared->mutex);
+
+	if (failed && pa != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("logical replication parallel apply worker exited unexpectedly")));
+	else if (failed)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("logical replication apply worker or another parallel apply worker exited")));
+}
+
+/*
+ * Tell the others that we're gone, so that nobody waits for us in vain.
+ */
+static void
+parallel_apply_on_detach(dsm_segment *seg, Datum arg)
+{
+	ParallelApplyShared *shared = (ParallelApplyShared *) DatumGetPointer(arg);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->failed = true;
+	SpinLockRelease(&shared->mutex);
+
+	ConditionVariableBroadcast(&shared->cv);
+	SetLatch(&shared->leader->procLatch);
+}
+
+/*
+ * Wait until all transactions up to the given one have been committed.
+ */
+static void
+parallel_apply_wait_committed(uint64 seq)
+{
+	ParallelApplyShared *shared = pa ? pa->shared : MyParallelShared;
+
+	for (;;)
+	{
+		uint64		last_committed;
+
+		parallel_apply_check_failed(shared);
+
+		SpinLockAcquire(&shared->mutex);
+		last_committed = shared->last_committed;
+		SpinLockRelease(&shared->mutex);
+
+		if (last_committed >= seq)
+			break;
+
+		ConditionVariableSleep(&shared->cv,
+							   WAIT_EVENT_LOGICAL_APPLY_DEPENDENCY);
+	}
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Worker side: the transaction we're applying got its xid, which our
+ * successor waits for.
+ */
+void
+parallel_apply_set_xid(TransactionId xid)
+{
+	ParallelApplyShared *shared = MyParallelShared;
+
+	SpinLockAcquire(&shared->mutex);
+	shared->workers[MyParallelWorker].seq = MyParallelSeq;
+	shared->workers[MyParallelWorker].xid = xid;
+	SpinLockRelease(&shared->mutex);
+
+	ConditionVariableBroadcast(&shared->cv);
+}
+
+/*
+ * Worker side: wait until the transaction before ours has committed.
+ *
+ * We wait on its transaction lock if we know its xid, so that the deadlock
+ * detector notices if it in turn waits for a lock we hold.
+ */
+void
+parallel_apply_wait_for_turn(void)
+{
+	ParallelApplyShared *shared = MyParallelShared;
+	TransactionId waited_xid = InvalidTransactionId;
+
+	Assert(MyParallelSeq > 0);
+
+	for (;;)
+	{
+		TransactionId xid = InvalidTransactionId;
+		bool		ready;
+		int			i;
+
+		parallel_apply_check_failed(shared);
+
+		SpinLockAcquire(&shared->mutex);
+		ready = shared->last_committed >= MyParallelSeq - 1;
+		if (!ready)
+		{
+			for (i = 0; i < shared->nworkers; i++)
+			{
+				if (shared->workers[i].seq == MyParallelSeq - 1)
+				{
+					xid = shared->workers[i].xid;
+					break;
+				}
+			}
+		}
+		SpinLockRelease(&shared->mutex);
+
+		if (ready)
+			break;
+
+		if (TransactionIdIsValid(xid) && xid != waited_xid)
+		{
+			ConditionVariableCancelSleep();
+			pgstat_report_wait_start(WAIT_EVENT_LOGICAL_APPLY_COMMIT_ORDER);
+			XactLockTableWait(xid, NULL, NULL, XLTW_None);
+			pgstat_report_wait_end();
+			waited_xid = xid;
+			continue;
+		}
+
+		ConditionVariableSleep(&shared->cv,
+							   WAIT_EVENT_LOGICAL_APPLY_COMMIT_ORDER);
+	}
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Worker side: our transaction has been committed.
+ */
+void
+parallel_apply_committed(XLogRecPtr remote_end, XLogRecPtr local_end)
+{
+	ParallelApplyShared *shared = MyParallelShared;
+
+	SpinLockAcquire(&shared->mutex);
+	Assert(shared->last_committed == MyParallelSeq - 1);
+	shared->last_committed = MyParallelSeq;
+	shared->remote_end = remote_end;
+	shared->local_end = local_end;
+	shared->workers[MyParallelWorker].seq = 0;
+	shared->workers[MyParallelWorker].xid = InvalidTransactionId;
+	SpinLockRelease(&shared->mutex);
+
+	ConditionVariableBroadcast(&shared->cv);
+	SetLatch(&shared->leader->procLatch);
+
+	MyParallelSeq = 0;
+}
+
+/* SIGHUP: set flag to reload configuration at next convenient time */
+static void
+parallel_apply_sighup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+
+	/* Waken anything waiting on the process latch */
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/* Logical Replication parallel apply worker entry point */
+void
+ParallelApplyWorkerMain(Datum main_arg)
+{
+	int			worker_slot = DatumGetInt32(main_arg);
+	dsm_handle	handle;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	char		originname[NAMEDATALEN];
+	RepOriginId originid;
+
+	/*
+	 * Attach to the leader's segment before our worker slot, so that we've
+	 * learned our number by the time the leader launches the next worker.
+	 */
+	memcpy(&handle, MyBgworkerEntry->bgw_extra, sizeof(dsm_handle));
+	seg = dsm_attach(handle);
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_APPLY_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+
+	MyParallelShared = shm_toc_lookup(toc, PARALLEL_APPLY_KEY_SHARED, false);
+	MyParallelWorker = MyParallelShared->attaching;
+	on_dsm_detach(seg, parallel_apply_on_detach,
+				  PointerGetDatum(MyParallelShared));
+
+	mq = shm_toc_lookup(toc, PARALLEL_APPLY_KEY_QUEUE + MyParallelWorker, false);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* Attach to slot */
+	logicalrep_worker_attach(worker_slot);
+
+	InitializeApplyWorker();
+
+	/* We don't maintain a walsender connection, so reload as we go. */
+	pqsignal(SIGHUP, parallel_apply_sighup);
+
+	/* Share the leader's replication origin. */
+	StartTransactionCommand();
+	snprintf(originname, sizeof(originname), "pg_%u", MySubscription->oid);
+	originid = replorigin_by_name(originname, false);
+	replorigin_session_setup(originid, MyLogicalRepWorker->leader_pid);
+	replorigin_session_origin = originid;
+	CommitTransactionCommand();
+
+	ApplyMessageContext = AllocSetContextCreate(ApplyContext,
+												"ApplyMessageContext",
+												ALLOCSET_DEFAULT_SIZES);
+
+	for (;;)
+	{
+		shm_mq_result res;
+		Size		len;
+		void	   *data;
+		ParallelApplyHeader header;
+		StringInfoData s;
+
+		CHECK_FOR_INTERRUPTS();
+
+		pgstat_report_activity(STATE_IDLE, NULL);
+
+		res = shm_mq_receive(mqh, &len, &data, false);
+
+		/* The leader has gone away; if it meant to, we're done. */
+		if (res != SHM_MQ_SUCCESS)
+		{
+			if (IsTransactionState())
+				ereport(ERROR,
+						(errcode(ERRCODE_CONNECTION_FAILURE),
+						 errmsg("lost connection to the logical replication apply worker")));
+			proc_exit(0);
+		}
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		if (len < sizeof(header))
+			elog(ERROR, "invalid message from logical replication apply worker");
+		memcpy(&header, data, sizeof(header));
+
+		if (header.seq != 0)
+			MyParallelSeq = header.seq;
+
+		/* Wait for transactions touching the same rows. */
+		if (header.depends_on != 0)
+			parallel_apply_wait_committed(header.depends_on);
+
+		s.data = (char *) data + sizeof(header);
+		s.len = len - sizeof(header);
+		s.maxlen = -1;
+		s.cursor = 0;
+
+		while (s.cursor < s.len)
+		{
+			StringInfoData msg;
+			int			msglen;
+
+			CHECK_FOR_INTERRUPTS();
+
+			memcpy(&msglen, &s.data[s.cursor], sizeof(msglen));
+			s.cursor += sizeof(msglen);
+
+			msg.data = &s.data[s.cursor];
+			msg.len = msglen;
+			msg.maxlen = -1;
+			msg.cursor = 0;
+			s.cursor += msglen;
+
+			MemoryContextSwitchTo(ApplyMessageContext);
+			apply_dispatch(&msg);
+			MemoryContextReset(ApplyMessageContext);
+		}
+
+		MemoryContextSwitchTo(TopMemoryContext);
+	}
+}
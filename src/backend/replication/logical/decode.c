@@ -98,6 +98,16 @@ LogicalDecodingProcessRecord(LogicalDecodingContext *ctx, XLogReaderState *recor
 	buf.endptr = ctx->reader->EndRecPtr;
 	buf.record = record;
 
+	/*
+	 * If the record carries the XID of its top-level transaction, tell the
+	 * reorderbuffer about the association right away rather than waiting for
+	 * the commit record. This lets changes of subtransactions be streamed
+	 * together with those of their top-level transaction.
+	 */
+	if (TransactionIdIsValid(XLogRecGetTopXid(record)))
+		ReorderBufferAssignChild(ctx->reorder, XLogRecGetTopXid(record),
+								 XLogRecGetXid(record), buf.origptr);
+
 	/* cast so we get a warning when new rmgrs are added */
 	switch ((RmgrIds) XLogRecGetRmid(record))
 	{
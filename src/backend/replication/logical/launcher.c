@@ -59,6 +59,9 @@
 
 int			max_logical_replication_workers = 4;
 int			max_sync_workers_per_subscription = 2;
+int			max_parallel_apply_workers_per_subscription = 0;
+int			max_parallel_sync_workers_per_table = 0;
+int			min_parallel_table_sync_size;
 
 LogicalRepWorker *MyLogicalRepWorker = NULL;
 
@@ -164,9 +167,9 @@ get_subscription_list(void)
  * Wait for a background worker to start up and attach to the shmem context.
  *
  * This is only needed for cleaning up the shared memory in case the worker
- * fails to attach.
+ * fails to attach.  Returns false if the worker died without attaching.
  */
-static void
+static bool
 WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 							   uint16 generation,
 							   BackgroundWorkerHandle *handle)
@@ -185,8 +188,10 @@ WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 		/* Worker either died or has started; no need to do anything. */
 		if (!worker->in_use || worker->proc)
 		{
+			bool		attached = worker->in_use;
+
 			LWLockRelease(LogicalRepWorkerLock);
-			return;
+			return attached;
 		}
 
 		LWLockRelease(LogicalRepWorkerLock);
@@ -201,7 +206,7 @@ WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 			if (generation == worker->generation)
 				logicalrep_worker_cleanup(worker);
 			LWLockRelease(LogicalRepWorkerLock);
-			return;
+			return false;
 		}
 
 		/*
@@ -222,13 +227,14 @@ WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 			CHECK_FOR_INTERRUPTS();
 		}
 	}
-
-	return;
 }
 
 /*
  * Walks the workers array and searches for one that matches given
  * subscription id and relid.
+ *
+ * Parallel workers are never returned; for an invalid relid, this is the
+ * leader apply worker, otherwise the table's synchronization worker.
  */
 LogicalRepWorker *
 logicalrep_worker_find(Oid subid, Oid relid, bool only_running)
@@ -243,6 +249,9 @@ logicalrep_worker_find(Oid subid, Oid relid, bool only_running)
 	{
 		LogicalRepWorker *w = &LogicalRepCtx->workers[i];
 
+		if (w->leader_pid != InvalidPid)
+			continue;
+
 		if (w->in_use && w->subid == subid && w->relid == relid &&
 			(!only_running || w->proc))
 		{
@@ -280,10 +289,17 @@ logicalrep_workers_find(Oid subid, bool only_running)
 
 /*
  * Start new apply background worker, if possible.
+ *
+ * If subworker_dsm is valid, this is a parallel worker for the calling
+ * worker, which passes it the handle of the segment holding their shared
+ * state: a parallel apply worker if relid is invalid, otherwise a worker
+ * that helps the calling synchronization worker copy the table.
+ *
+ * Returns true if the worker was started and has attached to its slot.
  */
-void
+bool
 logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname, Oid userid,
-						 Oid relid)
+						 Oid relid, dsm_handle subworker_dsm)
 {
 	BackgroundWorker bgw;
 	BackgroundWorkerHandle *bgw_handle;
@@ -293,6 +309,7 @@ logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname, Oid userid,
 	LogicalRepWorker *worker = NULL;
 	int			nsyncworkers;
 	TimestampTz now;
+	bool		is_parallel_worker = (subworker_dsm != DSM_HANDLE_INVALID);
 
 	ereport(DEBUG1,
 			(errmsg("starting logical replication worker for subscription \"%s\"",
@@ -365,12 +382,13 @@ retry:
 	/*
 	 * If we reached the sync worker limit per subscription, just exit
 	 * silently as we might get here because of an otherwise harmless race
-	 * condition.
+	 * condition.  Parallel workers are limited by their leader.
 	 */
-	if (nsyncworkers >= max_sync_workers_per_subscription)
+	if (nsyncworkers >= max_sync_workers_per_subscription &&
+		!is_parallel_worker)
 	{
 		LWLockRelease(LogicalRepWorkerLock);
-		return;
+		return false;
 	}
 
 	/*
@@ -384,7 +402,7 @@ retry:
 				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
 				 errmsg("out of logical replication worker slots"),
 				 errhint("You might need to increase max_logical_replication_workers.")));
-		return;
+		return false;
 	}
 
 	/* Prepare the worker slot. */
@@ -395,6 +413,7 @@ retry:
 	worker->dbid = dbid;
 	worker->userid = userid;
 	worker->subid = subid;
+	worker->leader_pid = is_parallel_worker ? MyProcPid : InvalidPid;
 	worker->relid = relid;
 	worker->relstate = SUBREL_STATE_UNKNOWN;
 	worker->relstate_lsn = InvalidXLogRecPtr;
@@ -415,10 +434,21 @@ retry:
 		BGWORKER_BACKEND_DATABASE_CONNECTION;
 	bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
 	snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
-	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ApplyWorkerMain");
-	if (OidIsValid(relid))
+	if (is_parallel_worker && OidIsValid(relid))
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ParallelTableSyncWorkerMain");
+	else if (is_parallel_worker)
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ParallelApplyWorkerMain");
+	else
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ApplyWorkerMain");
+	if (is_parallel_worker && OidIsValid(relid))
+		snprintf(bgw.bgw_name, BGW_MAXLEN,
+				 "logical replication parallel sync worker %u/%u", subid, relid);
+	else if (OidIsValid(relid))
 		snprintf(bgw.bgw_name, BGW_MAXLEN,
 				 "logical replication worker for subscription %u sync %u", subid, relid);
+	else if (is_parallel_worker)
+		snprintf(bgw.bgw_name, BGW_MAXLEN,
+				 "logical replication worker for subscription %u parallel", subid);
 	else
 		snprintf(bgw.bgw_name, BGW_MAXLEN,
 				 "logical replication worker for subscription %u", subid);
@@ -427,6 +457,9 @@ retry:
 	bgw.bgw_notify_pid = MyProcPid;
 	bgw.bgw_main_arg = Int32GetDatum(slot);
 
+	if (is_parallel_worker)
+		memcpy(bgw.bgw_extra, &subworker_dsm, sizeof(dsm_handle));
+
 	if (!RegisterDynamicBackgroundWorker(&bgw, &bgw_handle))
 	{
 		/* Failed to start worker, so clean up the worker slot. */
@@ -439,11 +472,11 @@ retry:
 				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
 				 errmsg("out of background worker slots"),
 				 errhint("You might need to increase max_worker_processes.")));
-		return;
+		return false;
 	}
 
 	/* Now wait until it attaches. */
-	WaitForReplicationWorkerAttach(worker, generation, bgw_handle);
+	return WaitForReplicationWorkerAttach(worker, generation, bgw_handle);
 }
 
 /*
@@ -667,6 +700,7 @@ logicalrep_worker_cleanup(LogicalRepWorker *worker)
 	worker->dbid = InvalidOid;
 	worker->userid = InvalidOid;
 	worker->subid = InvalidOid;
+	worker->leader_pid = InvalidPid;
 	worker->relid = InvalidOid;
 }
 
@@ -729,7 +763,8 @@ logicalrep_sync_worker_count(Oid subid)
 	{
 		LogicalRepWorker *w = &LogicalRepCtx->workers[i];
 
-		if (w->subid == subid && OidIsValid(w->relid))
+		if (w->subid == subid && OidIsValid(w->relid) &&
+			w->leader_pid == InvalidPid)
 			res++;
 	}
 
@@ -808,6 +843,7 @@ ApplyLauncherShmemInit(void)
 			LogicalRepWorker *worker = &LogicalRepCtx->workers[slot];
 
 			memset(worker, 0, sizeof(LogicalRepWorker));
+			worker->leader_pid = InvalidPid;
 			SpinLockInit(&worker->relmutex);
 		}
 	}
@@ -949,7 +985,8 @@ ApplyLauncherMain(Datum main_arg)
 					wait_time = wal_retrieve_retry_interval;
 
 					logicalrep_worker_launch(sub->dbid, sub->oid, sub->name,
-											 sub->owner, InvalidOid);
+											 sub->owner, InvalidOid,
+											 DSM_HANDLE_INVALID);
 				}
 			}
 
@@ -1060,6 +1097,10 @@ pg_stat_get_subscription(PG_FUNCTION_ARGS)
 		if (!worker.proc || !IsBackendPid(worker.proc->pid))
 			continue;
 
+		/* Parallel workers are reported through their leader. */
+		if (worker.leader_pid != InvalidPid)
+			continue;
+
 		if (OidIsValid(subid) && worker.subid != subid)
 			continue;
 
@@ -19,7 +19,9 @@
 #include "access/heapam.h"
 #include "access/sysattr.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_index.h"
 #include "catalog/pg_subscription_rel.h"
+#include "commands/trigger.h"
 #include "executor/executor.h"
 #include "nodes/makefuncs.h"
 #include "replication/logicalrelation.h"
@@ -37,6 +39,7 @@ static HTAB *LogicalRepTypMap = NULL;
 
 static void logicalrep_typmap_invalidate_cb(Datum arg, int cacheid,
 								uint32 hashvalue);
+static bool logicalrep_rel_parallel_safe(LogicalRepRelMapEntry *entry);
 
 /*
  * Relcache invalidation callback for our relation map cache.
@@ -351,6 +354,8 @@ logicalrep_rel_open(LogicalRepRelId remoteid, LOCKMODE lockmode)
 			}
 		}
 
+		entry->parallel_safe = logicalrep_rel_parallel_safe(entry);
+
 		entry->localreloid = relid;
 	}
 	else
@@ -365,6 +370,85 @@ logicalrep_rel_open(LogicalRepRelId remoteid, LOCKMODE lockmode)
 	return entry;
 }
 
+/*
+ * Can changes to the relation be applied by parallel apply workers, which
+ * only keep changes to rows with the same replica identity in order?
+ *
+ * That's the case if two rows can only conflict locally when their replica
+ * identity is the same, i.e. if all replica identity columns are key columns
+ * of every unique index, and there are no exclusion constraints; and if no
+ * triggers fire during apply, which might touch other rows.
+ */
+static bool
+logicalrep_rel_parallel_safe(LogicalRepRelMapEntry *entry)
+{
+	Relation	rel = entry->localrel;
+	TupleDesc	desc = RelationGetDescr(rel);
+	Bitmapset  *keyattrs = NULL;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		result = true;
+	int			i;
+
+	if (rel->trigdesc != NULL)
+	{
+		for (i = 0; i < rel->trigdesc->numtriggers; i++)
+		{
+			char		tgenabled = rel->trigdesc->triggers[i].tgenabled;
+
+			if (tgenabled == TRIGGER_FIRES_ALWAYS ||
+				tgenabled == TRIGGER_FIRES_ON_REPLICA)
+				return false;
+		}
+	}
+
+	/* Local attributes holding the replica identity. */
+	for (i = 0; i < desc->natts; i++)
+	{
+		if (entry->attrmap[i] >= 0 &&
+			bms_is_member(entry->attrmap[i], entry->remoterel.attkeys))
+			keyattrs = bms_add_member(keyattrs, i + 1);
+	}
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		HeapTuple	tuple;
+		Form_pg_index index;
+		Bitmapset  *indexattrs = NULL;
+
+		tuple = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(lfirst_oid(lc)));
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "cache lookup failed for index %u", lfirst_oid(lc));
+		index = (Form_pg_index) GETSTRUCT(tuple);
+
+		if (index->indisexclusion)
+			result = false;
+		else if (index->indisunique)
+		{
+			for (i = 0; i < index->indnkeyatts; i++)
+			{
+				/* expressions can't be checked, zero is as good as any */
+				indexattrs = bms_add_member(indexattrs,
+											Max(index->indkey.values[i], 0));
+			}
+
+			if (!bms_is_subset(keyattrs, indexattrs))
+				result = false;
+			bms_free(indexattrs);
+		}
+
+		ReleaseSysCache(tuple);
+
+		if (!result)
+			break;
+	}
+	list_free(indexoidlist);
+	bms_free(keyattrs);
+
+	return result;
+}
+
 /*
  * Close the previously opened logical relation.
  */
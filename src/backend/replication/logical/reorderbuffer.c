@@ -36,6 +36,16 @@
  *	  contents of individual (sub-)transactions will be read from disk in
  *	  chunks.
  *
+ *	  The memory used by all decoded changes is tracked, and once it exceeds
+ *	  logical_decoding_work_mem the largest transaction is evicted: if the
+ *	  output plugin supports it, the changes of the largest toplevel
+ *	  transaction are streamed to the plugin before the transaction has
+ *	  committed, otherwise the largest (sub-)transaction is spilled to disk.
+ *	  Only transactions that have not modified the catalog can be streamed
+ *	  while in progress, because the cache invalidations they'd require are
+ *	  only known once the commit record has been read. The output plugin
+ *	  later learns whether a streamed transaction committed or aborted.
+ *
  *	  This module also has to deal with reassembling toast records from the
  *	  individual chunks stored in WAL. When a new (or initial) version of a
  *	  tuple is stored in WAL it will always be preceded by the toast chunks
@@ -62,7 +72,7 @@
 #include "replication/logical.h"
 #include "replication/reorderbuffer.h"
 #include "replication/slot.h"
-#include "replication/snapbuild.h"	/* just for SnapBuildSnapDecRefcount */
+#include "replication/snapbuild.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
 #include "storage/sinval.h"
@@ -137,16 +147,15 @@ typedef struct ReorderBufferDiskChange
 } ReorderBufferDiskChange;
 
 /*
- * Maximum number of changes kept in memory, per transaction. After that,
- * changes are spooled to disk.
- *
- * The current value should be sufficient to decode the entire transaction
- * without hitting disk in OLTP workloads, while starting to spool to disk in
- * other workloads reasonably fast.
- *
- * At some point in the future it probably makes sense to have a more elaborate
- * resource management here, but it's not entirely clear what that would look
- * like.
+ * Maximum amount of memory (in kB) used by decoded changes before the
+ * largest transaction is streamed or spooled to disk.
+ */
+int			logical_decoding_work_mem;
+
+/*
+ * Maximum number of changes restored from disk at once, per transaction.
+ * How much of a transaction is kept in memory while decoding is controlled
+ * by logical_decoding_work_mem instead.
  */
 static const Size max_changes_in_memory = 4096;
 
@@ -190,7 +199,7 @@ static void ReorderBufferExecuteInvalidations(ReorderBuffer *rb, ReorderBufferTX
  * Disk serialization support functions
  * ---------------------------------------
  */
-static void ReorderBufferCheckSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
+static void ReorderBufferCheckMemoryLimit(ReorderBuffer *rb);
 static void ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
 static void ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 							 int fd, ReorderBufferChange *change);
@@ -204,6 +213,24 @@ static void ReorderBufferFreeSnap(ReorderBuffer *rb, Snapshot snap);
 static Snapshot ReorderBufferCopySnap(ReorderBuffer *rb, Snapshot orig_snap,
 					  ReorderBufferTXN *txn, CommandId cid);
 
+/* ---------------------------------------
+ * Streaming support functions
+ * ---------------------------------------
+ */
+static bool ReorderBufferCanStream(ReorderBuffer *rb);
+static bool ReorderBufferTXNIsStreamed(ReorderBufferTXN *txn);
+static void ReorderBufferStreamTXN(ReorderBuffer *rb, ReorderBufferTXN *txn,
+					   XLogRecPtr commit_lsn);
+static void ReorderBufferTruncateTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
+
+/* ---------------------------------------
+ * memory accounting
+ * ---------------------------------------
+ */
+static Size ReorderBufferChangeSize(ReorderBufferChange *change);
+static void ReorderBufferChangeMemoryUpdate(ReorderBuffer *rb,
+								ReorderBufferChange *change, bool addition);
+
 /* ---------------------------------------
  * toast reassembly support
  * ---------------------------------------
@@ -262,6 +289,7 @@ ReorderBufferAllocate(void)
 
 	buffer->outbuf = NULL;
 	buffer->outbufsize = 0;
+	buffer->size = 0;
 
 	buffer->current_restart_decoding_lsn = InvalidXLogRecPtr;
 
@@ -336,6 +364,12 @@ ReorderBufferReturnTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		txn->invalidations = NULL;
 	}
 
+	if (txn->snapshot_now != NULL)
+	{
+		ReorderBufferFreeSnap(rb, txn->snapshot_now);
+		txn->snapshot_now = NULL;
+	}
+
 	pfree(txn);
 }
 
@@ -357,12 +391,21 @@ ReorderBufferGetChange(ReorderBuffer *rb)
 /*
  * Free an ReorderBufferChange.
  *
+ * upd_mem is false if the change has already been removed from the memory
+ * accounting, e.g. because it was moved out of its transaction's list of
+ * changes.
+ *
  * Deallocation might be delayed for efficiency purposes, for details check
  * the comments above max_cached_changes's definition.
  */
 void
-ReorderBufferReturnChange(ReorderBuffer *rb, ReorderBufferChange *change)
+ReorderBufferReturnChange(ReorderBuffer *rb, ReorderBufferChange *change,
+						  bool upd_mem)
 {
+	/* update memory accounting info */
+	if (upd_mem)
+		ReorderBufferChangeMemoryUpdate(rb, change, false);
+
 	/* free contained data */
 	switch (change->action)
 	{
@@ -583,12 +626,17 @@ ReorderBufferQueueChange(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn,
 	txn = ReorderBufferTXNByXid(rb, xid, true, NULL, lsn, true);
 
 	change->lsn = lsn;
+	change->txn = txn;
 	Assert(InvalidXLogRecPtr != lsn);
 	dlist_push_tail(&txn->changes, &change->node);
 	txn->nentries++;
 	txn->nentries_mem++;
 
-	ReorderBufferCheckSerializeTXN(rb, txn);
+	/* update memory accounting information */
+	ReorderBufferChangeMemoryUpdate(rb, change, true);
+
+	/* check the memory limits and evict something if needed */
+	ReorderBufferCheckMemoryLimit(rb);
 }
 
 /*
@@ -695,6 +743,61 @@ ReorderBufferSetRestartPoint(ReorderBuffer *rb, XLogRecPtr ptr)
 	rb->current_restart_decoding_lsn = ptr;
 }
 
+/*
+ * Pass the base snapshot of a subtransaction to its toplevel transaction if
+ * that doesn't have one yet, or if the subtransaction's is older. That can
+ * happen if there are no changes in the toplevel transaction but in one of
+ * the child transactions. This allows the parent to simply use its base
+ * snapshot initially.
+ */
+static void
+ReorderBufferTransferSnapToParent(ReorderBufferTXN *txn,
+								  ReorderBufferTXN *subtxn)
+{
+	if (subtxn->base_snapshot == NULL)
+		return;
+
+	if (txn->base_snapshot == NULL ||
+		txn->base_snapshot_lsn > subtxn->base_snapshot_lsn)
+	{
+		if (txn->base_snapshot != NULL)
+			SnapBuildSnapDecRefcount(txn->base_snapshot);
+
+		txn->base_snapshot = subtxn->base_snapshot;
+		txn->base_snapshot_lsn = subtxn->base_snapshot_lsn;
+	}
+	else
+		SnapBuildSnapDecRefcount(subtxn->base_snapshot);
+
+	subtxn->base_snapshot = NULL;
+	subtxn->base_snapshot_lsn = InvalidXLogRecPtr;
+}
+
+/*
+ * Turn a transaction we had so far believed to be a toplevel transaction into
+ * a subtransaction of txn.
+ */
+static void
+ReorderBufferMakeSubxact(ReorderBufferTXN *txn, ReorderBufferTXN *subtxn)
+{
+	subtxn->is_known_as_subxact = true;
+	subtxn->toptxn = txn;
+	Assert(subtxn->nsubtxns == 0);
+
+	/* remove from lsn order list of top-level transactions */
+	dlist_delete(&subtxn->node);
+
+	/* add to toplevel transaction */
+	dlist_push_tail(&txn->subtxns, &subtxn->node);
+	txn->nsubtxns++;
+
+	/* the toplevel transaction now accounts for the subxact's memory, too */
+	txn->total_size += subtxn->size;
+	subtxn->total_size = 0;
+
+	ReorderBufferTransferSnapToParent(txn, subtxn);
+}
+
 void
 ReorderBufferAssignChild(ReorderBuffer *rb, TransactionId xid,
 						 TransactionId subxid, XLogRecPtr lsn)
@@ -715,20 +818,14 @@ ReorderBufferAssignChild(ReorderBuffer *rb, TransactionId xid,
 		 * that have not yet produced any records. Knowing those aren't top
 		 * level xids allows us to make processing cheaper in some places.
 		 */
+		subtxn->is_known_as_subxact = true;
+		subtxn->toptxn = txn;
 		dlist_push_tail(&txn->subtxns, &subtxn->node);
 		txn->nsubtxns++;
 	}
 	else if (!subtxn->is_known_as_subxact)
 	{
-		subtxn->is_known_as_subxact = true;
-		Assert(subtxn->nsubtxns == 0);
-
-		/* remove from lsn order list of top-level transactions */
-		dlist_delete(&subtxn->node);
-
-		/* add to toplevel transaction */
-		dlist_push_tail(&txn->subtxns, &subtxn->node);
-		txn->nsubtxns++;
+		ReorderBufferMakeSubxact(txn, subtxn);
 	}
 	else if (new_top)
 	{
@@ -762,37 +859,13 @@ ReorderBufferCommitChild(ReorderBuffer *rb, TransactionId xid,
 	if (txn == NULL)
 		elog(ERROR, "subxact logged without previous toplevel record");
 
-	/*
-	 * Pass our base snapshot to the parent transaction if it doesn't have
-	 * one, or ours is older. That can happen if there are no changes in the
-	 * toplevel transaction but in one of the child transactions. This allows
-	 * the parent to simply use its base snapshot initially.
-	 */
-	if (subtxn->base_snapshot != NULL &&
-		(txn->base_snapshot == NULL ||
-		 txn->base_snapshot_lsn > subtxn->base_snapshot_lsn))
-	{
-		txn->base_snapshot = subtxn->base_snapshot;
-		txn->base_snapshot_lsn = subtxn->base_snapshot_lsn;
-		subtxn->base_snapshot = NULL;
-		subtxn->base_snapshot_lsn = InvalidXLogRecPtr;
-	}
-
 	subtxn->final_lsn = commit_lsn;
 	subtxn->end_lsn = end_lsn;
 
 	if (!subtxn->is_known_as_subxact)
-	{
-		subtxn->is_known_as_subxact = true;
-		Assert(subtxn->nsubtxns == 0);
-
-		/* remove from lsn order list of top-level transactions */
-		dlist_delete(&subtxn->node);
-
-		/* add to subtransaction list */
-		dlist_push_tail(&txn->subtxns, &subtxn->node);
-		txn->nsubtxns++;
-	}
+		ReorderBufferMakeSubxact(txn, subtxn);
+	else
+		ReorderBufferTransferSnapToParent(txn, subtxn);
 }
 
 
@@ -971,7 +1044,7 @@ ReorderBufferIterTXNNext(ReorderBuffer *rb, ReorderBufferIterTXNState *state)
 	{
 		change = dlist_container(ReorderBufferChange, node,
 								 dlist_pop_head_node(&state->old_change));
-		ReorderBufferReturnChange(rb, change);
+		ReorderBufferReturnChange(rb, change, true);
 		Assert(dlist_is_empty(&state->old_change));
 	}
 
@@ -1057,7 +1130,7 @@ ReorderBufferIterTXNFinish(ReorderBuffer *rb,
 
 		change = dlist_container(ReorderBufferChange, node,
 								 dlist_pop_head_node(&state->old_change));
-		ReorderBufferReturnChange(rb, change);
+		ReorderBufferReturnChange(rb, change, true);
 		Assert(dlist_is_empty(&state->old_change));
 	}
 
@@ -1100,7 +1173,7 @@ ReorderBufferCleanupTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 
 		change = dlist_container(ReorderBufferChange, node, iter.cur);
 
-		ReorderBufferReturnChange(rb, change);
+		ReorderBufferReturnChange(rb, change, true);
 	}
 
 	/*
@@ -1113,7 +1186,7 @@ ReorderBufferCleanupTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 
 		change = dlist_container(ReorderBufferChange, node, iter.cur);
 		Assert(change->action == REORDER_BUFFER_CHANGE_INTERNAL_TUPLECID);
-		ReorderBufferReturnChange(rb, change);
+		ReorderBufferReturnChange(rb, change, true);
 	}
 
 	if (txn->base_snapshot != NULL)
@@ -1123,6 +1196,14 @@ ReorderBufferCleanupTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		txn->base_snapshot_lsn = InvalidXLogRecPtr;
 	}
 
+	/* discard state kept between blocks of a streamed transaction */
+	if (txn->specinsert != NULL)
+	{
+		ReorderBufferReturnChange(rb, txn->specinsert, false);
+		txn->specinsert = NULL;
+	}
+	ReorderBufferToastReset(rb, txn);
+
 	/*
 	 * Remove TXN from its containing list.
 	 *
@@ -1225,6 +1306,10 @@ ReorderBufferBuildTupleCidHash(ReorderBuffer *rb, ReorderBufferTXN *txn)
  * Copy a provided snapshot so we can modify it privately. This is needed so
  * that catalog modifying transactions can look into intermediate catalog
  * states.
+ *
+ * If txn is NULL, the copy doesn't treat any transaction as our own. That's
+ * what we want while streaming an in-progress transaction, which so far
+ * hasn't modified the catalog.
  */
 static Snapshot
 ReorderBufferCopySnap(ReorderBuffer *rb, Snapshot orig_snap,
@@ -1237,7 +1322,7 @@ ReorderBufferCopySnap(ReorderBuffer *rb, Snapshot orig_snap,
 
 	size = sizeof(SnapshotData) +
 		sizeof(TransactionId) * orig_snap->xcnt +
-		sizeof(TransactionId) * (txn->nsubtxns + 1);
+		(txn ? sizeof(TransactionId) * (txn->nsubtxns + 1) : 0);
 
 	snap = MemoryContextAllocZero(rb->context, size);
 	memcpy(snap, orig_snap, sizeof(SnapshotData));
@@ -1249,12 +1334,20 @@ ReorderBufferCopySnap(ReorderBuffer *rb, Snapshot orig_snap,
 
 	memcpy(snap->xip, orig_snap->xip, sizeof(TransactionId) * snap->xcnt);
 
+	snap->subxip = snap->xip + snap->xcnt;
+	snap->subxcnt = 0;
+
+	/* store the specified current CommandId */
+	snap->curcid = cid;
+
+	if (txn == NULL)
+		return snap;
+
 	/*
 	 * snap->subxip contains all txids that belong to our transaction which we
 	 * need to check via cmin/cmax. That's why we store the toplevel
 	 * transaction in there as well.
 	 */
-	snap->subxip = snap->xip + snap->xcnt;
 	snap->subxip[i++] = txn->xid;
 
 	/*
@@ -1276,9 +1369,6 @@ ReorderBufferCopySnap(ReorderBuffer *rb, Snapshot orig_snap,
 	/* sort so we can bsearch() later */
 	qsort(snap->subxip, snap->subxcnt, sizeof(TransactionId), xidComparator);
 
-	/* store the specified current CommandId */
-	snap->curcid = cid;
-
 	return snap;
 }
 
@@ -1295,60 +1385,66 @@ ReorderBufferFreeSnap(ReorderBuffer *rb, Snapshot snap)
 }
 
 /*
- * Perform the replay of a transaction and it's non-aborted subtransactions.
+ * Helper functions for ReorderBufferProcessTXN, passing a change or message
+ * to the output plugin either as part of a committed transaction or as a
+ * streamed block of an in-progress transaction.
+ */
+static inline void
+ReorderBufferApplyChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
+						 Relation relation, ReorderBufferChange *change,
+						 bool streaming)
+{
+	if (streaming)
+		rb->stream_change(rb, txn, relation, change);
+	else
+		rb->apply_change(rb, txn, relation, change);
+}
+
+static inline void
+ReorderBufferApplyMessage(ReorderBuffer *rb, ReorderBufferTXN *txn,
+						  ReorderBufferChange *change, bool streaming)
+{
+	if (streaming)
+		rb->stream_message(rb, txn, change->lsn, true,
+						   change->data.msg.prefix,
+						   change->data.msg.message_size,
+						   change->data.msg.message);
+	else
+		rb->message(rb, txn, change->lsn, true,
+					change->data.msg.prefix,
+					change->data.msg.message_size,
+					change->data.msg.message);
+}
+
+/*
+ * Replay the changes of a transaction and its non-aborted subtransactions,
+ * starting with snapshot_now and command_id.
  *
- * Subtransactions previously have to be processed by
- * ReorderBufferCommitChild(), even if previously assigned to the toplevel
- * transaction with ReorderBufferAssignChild.
+ * Without streaming, this is only called once the toplevel commit has been
+ * read; the transaction's changes are sent between the begin and commit
+ * callbacks and the transaction is cleaned up afterwards.
  *
- * We currently can only decode a transaction's contents in when their commit
- * record is read because that's currently the only place where we know about
- * cache invalidations. Thus, once a toplevel commit is read, we iterate over
- * the top and subtransactions (using a k-way merge) and replay the changes in
- * lsn order.
+ * With streaming, the changes decoded so far are sent between stream_start
+ * and stream_stop. If commit_lsn is invalid the transaction is still in
+ * progress: the changes are then discarded and the state needed to continue
+ * with the next block is remembered in the transaction.
  */
-void
-ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
-					XLogRecPtr commit_lsn, XLogRecPtr end_lsn,
-					TimestampTz commit_time,
-					RepOriginId origin_id, XLogRecPtr origin_lsn)
+static void
+ReorderBufferProcessTXN(ReorderBuffer *rb, ReorderBufferTXN *txn,
+						XLogRecPtr commit_lsn,
+						volatile Snapshot snapshot_now,
+						volatile CommandId command_id,
+						bool streaming)
 {
-	ReorderBufferTXN *txn;
-	volatile Snapshot snapshot_now;
-	volatile CommandId command_id = FirstCommandId;
 	bool		using_subtxn;
+	bool		in_progress = streaming && commit_lsn == InvalidXLogRecPtr;
+	ReorderBufferTXN *snap_txn = in_progress ? NULL : txn;
 	ReorderBufferIterTXNState *volatile iterstate = NULL;
-
-	txn = ReorderBufferTXNByXid(rb, xid, false, NULL, InvalidXLogRecPtr,
-								false);
-
-	/* unknown transaction, nothing to replay */
-	if (txn == NULL)
-		return;
-
-	txn->final_lsn = commit_lsn;
-	txn->end_lsn = end_lsn;
-	txn->commit_time = commit_time;
-	txn->origin_id = origin_id;
-	txn->origin_lsn = origin_lsn;
-
-	/*
-	 * If this transaction didn't have any real changes in our database, it's
-	 * OK not to have a snapshot. Note that ReorderBufferCommitChild will have
-	 * transferred its snapshot to this transaction if it had one and the
-	 * toplevel tx didn't.
-	 */
-	if (txn->base_snapshot == NULL)
-	{
-		Assert(txn->ninvalidations == 0);
-		ReorderBufferCleanupTXN(rb, txn);
-		return;
-	}
-
-	snapshot_now = txn->base_snapshot;
+	volatile XLogRecPtr prev_lsn = InvalidXLogRecPtr;
 
 	/* build data to be able to lookup the CommandIds of catalog tuples */
-	ReorderBufferBuildTupleCidHash(rb, txn);
+	if (!in_progress)
+		ReorderBufferBuildTupleCidHash(rb, txn);
 
 	/* setup the initial snapshot */
 	SetupHistoricSnapshot(snapshot_now, txn->tuplecid_hash);
@@ -1368,14 +1464,17 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 	PG_TRY();
 	{
 		ReorderBufferChange *change;
-		ReorderBufferChange *specinsert = NULL;
+		ReorderBufferChange *specinsert = txn->specinsert;
+
+		txn->specinsert = NULL;
 
 		if (using_subtxn)
 			BeginInternalSubTransaction("replay");
 		else
 			StartTransactionCommand();
 
-		rb->begin(rb, txn);
+		if (!streaming)
+			rb->begin(rb, txn);
 
 		iterstate = ReorderBufferIterTXNInit(rb, txn);
 		while ((change = ReorderBufferIterTXNNext(rb, iterstate)) != NULL)
@@ -1383,6 +1482,14 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 			Relation	relation = NULL;
 			Oid			reloid;
 
+			/* start a new block of streamed changes with the first change */
+			if (streaming && prev_lsn == InvalidXLogRecPtr)
+			{
+				rb->stream_start(rb, txn, change->lsn);
+				txn->streamed = true;
+			}
+			prev_lsn = change->lsn;
+
 			switch (change->action)
 			{
 				case REORDER_BUFFER_CHANGE_INTERNAL_SPEC_CONFIRM:
@@ -1392,10 +1499,15 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 					 * use as a normal record. It'll be cleaned up at the end
 					 * of INSERT processing.
 					 */
+					if (specinsert == NULL)
+						elog(ERROR, "invalid ordering of speculative insertion changes");
 					Assert(specinsert->data.tp.oldtuple == NULL);
 					change = specinsert;
 					change->action = REORDER_BUFFER_CHANGE_INSERT;
 
+					/* it's accounted for again until it's freed below */
+					ReorderBufferChangeMemoryUpdate(rb, change, true);
+
 					/* intentionally fall through */
 				case REORDER_BUFFER_CHANGE_INSERT:
 				case REORDER_BUFFER_CHANGE_UPDATE:
@@ -1442,7 +1554,8 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 					if (!IsToastRelation(relation))
 					{
 						ReorderBufferToastReplace(rb, txn, relation, change);
-						rb->apply_change(rb, txn, relation, change);
+						ReorderBufferApplyChange(rb, txn, relation, change,
+												 streaming);
 
 						/*
 						 * Only clear reassembled toast chunks if we're sure
@@ -1463,7 +1576,10 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 						 * freed/reused while restoring spooled data from
 						 * disk.
 						 */
+						Assert(change->data.tp.newtuple != NULL);
+
 						dlist_delete(&change->node);
+						ReorderBufferChangeMemoryUpdate(rb, change, false);
 						ReorderBufferToastAppendChunk(rb, txn, relation,
 													  change);
 					}
@@ -1476,7 +1592,8 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 					 */
 					if (specinsert != NULL)
 					{
-						ReorderBufferReturnChange(rb, specinsert);
+						ReorderBufferReturnChange(rb, specinsert,
+												  change == specinsert);
 						specinsert = NULL;
 					}
 
@@ -1505,20 +1622,18 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 					/* clear out a pending (and thus failed) speculation */
 					if (specinsert != NULL)
 					{
-						ReorderBufferReturnChange(rb, specinsert);
+						ReorderBufferReturnChange(rb, specinsert, false);
 						specinsert = NULL;
 					}
 
 					/* and memorize the pending insertion */
 					dlist_delete(&change->node);
+					ReorderBufferChangeMemoryUpdate(rb, change, false);
 					specinsert = change;
 					break;
 
 				case REORDER_BUFFER_CHANGE_MESSAGE:
-					rb->message(rb, txn, change->lsn, true,
-								change->data.msg.prefix,
-								change->data.msg.message_size,
-								change->data.msg.message);
+					ReorderBufferApplyMessage(rb, txn, change, streaming);
 					break;
 
 				case REORDER_BUFFER_CHANGE_INTERNAL_SNAPSHOT:
@@ -1530,7 +1645,7 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 						ReorderBufferFreeSnap(rb, snapshot_now);
 						snapshot_now =
 							ReorderBufferCopySnap(rb, change->data.snapshot,
-												  txn, command_id);
+												  snap_txn, command_id);
 					}
 
 					/*
@@ -1542,7 +1657,7 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 					{
 						snapshot_now =
 							ReorderBufferCopySnap(rb, change->data.snapshot,
-												  txn, command_id);
+												  snap_txn, command_id);
 					}
 					else
 					{
@@ -1565,7 +1680,7 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 						{
 							/* we don't use the global one anymore */
 							snapshot_now = ReorderBufferCopySnap(rb, snapshot_now,
-																 txn, command_id);
+																 snap_txn, command_id);
 						}
 
 						snapshot_now->curcid = command_id;
@@ -1590,13 +1705,16 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		}
 
 		/*
-		 * There's a speculative insertion remaining, just clean in up, it
-		 * can't have been successful, otherwise we'd gotten a confirmation
-		 * record.
+		 * There's a speculative insertion remaining. Unless the transaction
+		 * is still in progress, just clean it up, it can't have been
+		 * successful, otherwise we'd gotten a confirmation record.
 		 */
 		if (specinsert)
 		{
-			ReorderBufferReturnChange(rb, specinsert);
+			if (in_progress)
+				txn->specinsert = specinsert;
+			else
+				ReorderBufferReturnChange(rb, specinsert, false);
 			specinsert = NULL;
 		}
 
@@ -1604,8 +1722,11 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		ReorderBufferIterTXNFinish(rb, iterstate);
 		iterstate = NULL;
 
-		/* call commit callback */
-		rb->commit(rb, txn, commit_lsn);
+		/* call commit callback, or end the block of streamed changes */
+		if (!streaming)
+			rb->commit(rb, txn, commit_lsn);
+		else if (prev_lsn != InvalidXLogRecPtr)
+			rb->stream_stop(rb, txn, prev_lsn);
 
 		/* this is just a sanity check against bad output plugin behaviour */
 		if (GetCurrentTransactionIdIfAny() != InvalidTransactionId)
@@ -1629,11 +1750,35 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		if (using_subtxn)
 			RollbackAndReleaseCurrentSubTransaction();
 
-		if (snapshot_now->copied)
-			ReorderBufferFreeSnap(rb, snapshot_now);
+		if (in_progress)
+		{
+			/*
+			 * Remember where to continue with the next block. A snapshot we
+			 * didn't copy belongs to the snapbuilder or to one of the changes
+			 * about to be discarded, so keep a copy of it.
+			 */
+			if (!snapshot_now->copied)
+				snapshot_now = ReorderBufferCopySnap(rb, snapshot_now, NULL,
+													 command_id);
+			txn->snapshot_now = snapshot_now;
+			txn->command_id = command_id;
+
+			/* discard the changes we've just streamed */
+			ReorderBufferTruncateTXN(rb, txn);
+		}
+		else
+		{
+			if (snapshot_now->copied)
+				ReorderBufferFreeSnap(rb, snapshot_now);
 
-		/* remove potential on-disk data, and deallocate */
-		ReorderBufferCleanupTXN(rb, txn);
+			/*
+			 * Remove potential on-disk data, and deallocate. A streamed
+			 * transaction is cleaned up by our caller once the output plugin
+			 * has been told it committed.
+			 */
+			if (!streaming)
+				ReorderBufferCleanupTXN(rb, txn);
+		}
 	}
 	PG_CATCH();
 	{
@@ -1666,6 +1811,72 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 	PG_END_TRY();
 }
 
+/*
+ * Perform the replay of a transaction and it's non-aborted subtransactions.
+ *
+ * Subtransactions previously have to be processed by
+ * ReorderBufferCommitChild(), even if previously assigned to the toplevel
+ * transaction with ReorderBufferAssignChild.
+ *
+ * We currently can only decode a transaction's contents in when their commit
+ * record is read because that's currently the only place where we know about
+ * cache invalidations. Thus, once a toplevel commit is read, we iterate over
+ * the top and subtransactions (using a k-way merge) and replay the changes in
+ * lsn order.
+ *
+ * If parts of the transaction have already been streamed, the remaining
+ * changes are streamed as well and the output plugin is told that the
+ * transaction committed.
+ */
+void
+ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
+					XLogRecPtr commit_lsn, XLogRecPtr end_lsn,
+					TimestampTz commit_time,
+					RepOriginId origin_id, XLogRecPtr origin_lsn)
+{
+	ReorderBufferTXN *txn;
+
+	txn = ReorderBufferTXNByXid(rb, xid, false, NULL, InvalidXLogRecPtr,
+								false);
+
+	/* unknown transaction, nothing to replay */
+	if (txn == NULL)
+		return;
+
+	txn->final_lsn = commit_lsn;
+	txn->end_lsn = end_lsn;
+	txn->commit_time = commit_time;
+	txn->origin_id = origin_id;
+	txn->origin_lsn = origin_lsn;
+
+	/*
+	 * If this transaction didn't have any real changes in our database, it's
+	 * OK not to have a snapshot. Note that ReorderBufferCommitChild will have
+	 * transferred its snapshot to this transaction if it had one and the
+	 * toplevel tx didn't.
+	 */
+	if (txn->base_snapshot == NULL)
+	{
+		Assert(txn->ninvalidations == 0);
+		ReorderBufferCleanupTXN(rb, txn);
+		return;
+	}
+
+	if (txn->streamed)
+	{
+		/* stream the remaining changes, then tell the plugin about the commit */
+		ReorderBufferStreamTXN(rb, txn, commit_lsn);
+		rb->stream_commit(rb, txn, commit_lsn);
+
+		/* remove potential on-disk data, and deallocate */
+		ReorderBufferCleanupTXN(rb, txn);
+		return;
+	}
+
+	ReorderBufferProcessTXN(rb, txn, commit_lsn, txn->base_snapshot,
+							FirstCommandId, false);
+}
+
 /*
  * Abort a transaction that possibly has previous changes. Needs to be first
  * called for subtransactions and then for the toplevel xid.
@@ -1693,6 +1904,10 @@ ReorderBufferAbort(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn)
 	/* cosmetic... */
 	txn->final_lsn = lsn;
 
+	/* the output plugin has to discard changes it already got streamed */
+	if (ReorderBufferTXNIsStreamed(txn))
+		rb->stream_abort(rb, txn, lsn);
+
 	/* remove potential on-disk data, and deallocate */
 	ReorderBufferCleanupTXN(rb, txn);
 }
@@ -1726,6 +1941,9 @@ ReorderBufferAbortOld(ReorderBuffer *rb, TransactionId oldestRunningXid)
 		{
 			elog(DEBUG2, "aborting old transaction %u", txn->xid);
 
+			if (txn->streamed)
+				rb->stream_abort(rb, txn, txn->final_lsn);
+
 			/* remove potential on-disk data, and deallocate this tx */
 			ReorderBufferCleanupTXN(rb, txn);
 		}
@@ -1762,6 +1980,13 @@ ReorderBufferForget(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn)
 	/* cosmetic... */
 	txn->final_lsn = lsn;
 
+	/*
+	 * We're not interested in the contents after all, so the output plugin
+	 * has to discard what it got streamed already.
+	 */
+	if (ReorderBufferTXNIsStreamed(txn))
+		rb->stream_abort(rb, txn, lsn);
+
 	/*
 	 * Process cache invalidation messages if there are any. Even if we're not
 	 * interested in the transaction's contents, it could have manipulated the
@@ -1860,6 +2085,14 @@ ReorderBufferSetBaseSnapshot(ReorderBuffer *rb, TransactionId xid,
 	bool		is_new;
 
 	txn = ReorderBufferTXNByXid(rb, xid, true, &is_new, lsn, true);
+
+	/*
+	 * Base snapshots of known subtransactions are kept in the toplevel
+	 * transaction, so concurrent catalog changes get distributed to it.
+	 */
+	if (txn->toptxn != NULL)
+		txn = txn->toptxn;
+
 	Assert(txn->base_snapshot == NULL);
 	Assert(snap != NULL);
 
@@ -1905,6 +2138,7 @@ ReorderBufferAddNewTupleCids(ReorderBuffer *rb, TransactionId xid,
 	change->data.tuplecid.cmax = cmax;
 	change->data.tuplecid.combocid = combocid;
 	change->lsn = lsn;
+	change->txn = txn;
 	change->action = REORDER_BUFFER_CHANGE_INTERNAL_TUPLECID;
 
 	dlist_push_tail(&txn->tuplecids, &change->node);
@@ -1997,14 +2231,226 @@ ReorderBufferXidHasBaseSnapshot(ReorderBuffer *rb, TransactionId xid)
 	if (txn == NULL)
 		return false;
 
+	/* the base snapshot of a known subxact is its toplevel's */
+	if (txn->toptxn != NULL)
+		txn = txn->toptxn;
+
+	return txn->base_snapshot != NULL;
+}
+
+
+/*
+ * ---------------------------------------
+ * Streaming support
+ * ---------------------------------------
+ */
+
+/*
+ * Can we stream in-progress transactions right now? The output plugin has
+ * to support it, and we must be past the point where changes are decoded
+ * (rather than skipped).
+ */
+static bool
+ReorderBufferCanStream(ReorderBuffer *rb)
+{
+	LogicalDecodingContext *ctx = rb->private_data;
+	SnapBuild  *builder = ctx->snapshot_builder;
+
+	if (!ctx->streaming)
+		return false;
+
+	return SnapBuildCurrentState(builder) == SNAPBUILD_CONSISTENT &&
+		!SnapBuildXactNeedsSkip(builder, ctx->reader->EndRecPtr);
+}
+
+/*
+ * Have changes of the (sub)transaction's toplevel transaction been streamed?
+ */
+static bool
+ReorderBufferTXNIsStreamed(ReorderBufferTXN *txn)
+{
+	if (txn->toptxn != NULL)
+		txn = txn->toptxn;
+
+	return txn->streamed;
+}
+
+/*
+ * Stream the changes of a toplevel transaction decoded so far. With a valid
+ * commit_lsn, the transaction has committed and the remaining changes are
+ * streamed as the final block.
+ */
+static void
+ReorderBufferStreamTXN(ReorderBuffer *rb, ReorderBufferTXN *txn,
+					   XLogRecPtr commit_lsn)
+{
+	Snapshot	snapshot_now;
+	CommandId	command_id;
+
+	Assert(txn->toptxn == NULL);
+	Assert(txn->base_snapshot != NULL);
+
 	/*
-	 * TODO: It would be a nice improvement if we would check the toplevel
-	 * transaction in subtransactions, but we'd need to keep track of a bit
-	 * more state.
+	 * Continue with the snapshot the previous block ended with, if any. We
+	 * take ownership of it, as ReorderBufferProcessTXN may free it.
 	 */
-	return txn->base_snapshot != NULL;
+	if (txn->snapshot_now != NULL)
+	{
+		snapshot_now = txn->snapshot_now;
+		command_id = txn->command_id;
+		txn->snapshot_now = NULL;
+	}
+	else
+	{
+		snapshot_now = txn->base_snapshot;
+		command_id = FirstCommandId;
+	}
+
+	/*
+	 * Once committed, the transaction may have modified the catalog, so its
+	 * own xids need to be part of the snapshot again.
+	 */
+	if (commit_lsn != InvalidXLogRecPtr)
+	{
+		Snapshot	snap = ReorderBufferCopySnap(rb, snapshot_now, txn,
+												 command_id);
+
+		if (snapshot_now->copied)
+			ReorderBufferFreeSnap(rb, snapshot_now);
+		snapshot_now = snap;
+	}
+
+	ReorderBufferProcessTXN(rb, txn, commit_lsn, snapshot_now, command_id,
+							true);
+}
+
+/*
+ * Discard the changes of a transaction and its subtransactions that have
+ * just been streamed, including data spilled to disk. Everything else about
+ * the transaction is kept, as more changes may follow.
+ */
+static void
+ReorderBufferTruncateTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
+{
+	dlist_mutable_iter iter;
+
+	dlist_foreach_modify(iter, &txn->subtxns)
+	{
+		ReorderBufferTXN *subtxn;
+
+		subtxn = dlist_container(ReorderBufferTXN, node, iter.cur);
+		ReorderBufferTruncateTXN(rb, subtxn);
+	}
+
+	dlist_foreach_modify(iter, &txn->changes)
+	{
+		ReorderBufferChange *change;
+
+		change = dlist_container(ReorderBufferChange, node, iter.cur);
+
+		dlist_delete(&change->node);
+		ReorderBufferReturnChange(rb, change, true);
+	}
+
+	txn->nentries = 0;
+	txn->nentries_mem = 0;
+
+	if (txn->serialized)
+	{
+		ReorderBufferRestoreCleanup(rb, txn);
+		txn->serialized = false;
+	}
+}
+
+/*
+ * ---------------------------------------
+ * Memory accounting
+ * ---------------------------------------
+ */
+
+/*
+ * Size of a change, including the tuples and other data it references.
+ */
+static Size
+ReorderBufferChangeSize(ReorderBufferChange *change)
+{
+	Size		sz = sizeof(ReorderBufferChange);
+
+	switch (change->action)
+	{
+			/* fall through these, they're all similar enough */
+		case REORDER_BUFFER_CHANGE_INSERT:
+		case REORDER_BUFFER_CHANGE_UPDATE:
+		case REORDER_BUFFER_CHANGE_DELETE:
+		case REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT:
+			if (change->data.tp.oldtuple)
+				sz += sizeof(HeapTupleData) +
+					change->data.tp.oldtuple->tuple.t_len;
+			if (change->data.tp.newtuple)
+				sz += sizeof(HeapTupleData) +
+					change->data.tp.newtuple->tuple.t_len;
+			break;
+		case REORDER_BUFFER_CHANGE_MESSAGE:
+			sz += strlen(change->data.msg.prefix) + 1 +
+				change->data.msg.message_size;
+			break;
+		case REORDER_BUFFER_CHANGE_INTERNAL_SNAPSHOT:
+			{
+				Snapshot	snap = change->data.snapshot;
+
+				sz += sizeof(SnapshotData) +
+					sizeof(TransactionId) * snap->xcnt +
+					sizeof(TransactionId) * snap->subxcnt;
+				break;
+			}
+		case REORDER_BUFFER_CHANGE_INTERNAL_SPEC_CONFIRM:
+		case REORDER_BUFFER_CHANGE_INTERNAL_COMMAND_ID:
+		case REORDER_BUFFER_CHANGE_INTERNAL_TUPLECID:
+			/* ReorderBufferChange contains everything important */
+			break;
+	}
+
+	return sz;
 }
 
+/*
+ * Add (or subtract) the size of a change to the memory used by the
+ * reorderbuffer and by the transactions the change belongs to.
+ *
+ * The tuplecids of catalog changing transactions are not counted, as they
+ * can't be spilled to disk or streamed anyway.
+ */
+static void
+ReorderBufferChangeMemoryUpdate(ReorderBuffer *rb,
+								ReorderBufferChange *change, bool addition)
+{
+	ReorderBufferTXN *txn;
+	ReorderBufferTXN *toptxn;
+	Size		sz;
+
+	if (change->action == REORDER_BUFFER_CHANGE_INTERNAL_TUPLECID)
+		return;
+
+	txn = change->txn;
+	Assert(txn != NULL);
+	toptxn = txn->toptxn != NULL ? txn->toptxn : txn;
+
+	sz = ReorderBufferChangeSize(change);
+
+	if (addition)
+	{
+		txn->size += sz;
+		toptxn->total_size += sz;
+		rb->size += sz;
+	}
+	else
+	{
+		Assert(txn->size >= sz && toptxn->total_size >= sz && rb->size >= sz);
+		txn->size -= sz;
+		toptxn->total_size -= sz;
+		rb->size -= sz;
+	}
+}
 
 /*
  * ---------------------------------------
@@ -2031,19 +2477,96 @@ ReorderBufferSerializeReserve(ReorderBuffer *rb, Size sz)
 }
 
 /*
- * Check whether the transaction tx should spill its data to disk.
+ * Find the largest (sub)transaction, by the memory its changes use.
+ */
+static ReorderBufferTXN *
+ReorderBufferLargestTXN(ReorderBuffer *rb)
+{
+	HASH_SEQ_STATUS hash_seq;
+	ReorderBufferTXNByIdEnt *ent;
+	ReorderBufferTXN *largest = NULL;
+
+	hash_seq_init(&hash_seq, rb->by_txn);
+	while ((ent = hash_seq_search(&hash_seq)) != NULL)
+	{
+		ReorderBufferTXN *txn = ent->txn;
+
+		if (largest == NULL || txn->size > largest->size)
+			largest = txn;
+	}
+
+	return largest;
+}
+
+/*
+ * Find the largest toplevel transaction, including its subtransactions, that
+ * can be streamed while in progress: it needs a base snapshot and mustn't
+ * have modified the catalog so far.
+ */
+static ReorderBufferTXN *
+ReorderBufferLargestTopTXN(ReorderBuffer *rb)
+{
+	dlist_iter	iter;
+	ReorderBufferTXN *largest = NULL;
+
+	dlist_foreach(iter, &rb->toplevel_by_lsn)
+	{
+		ReorderBufferTXN *txn;
+		dlist_iter	subtxn_i;
+		bool		catalog_changes;
+
+		txn = dlist_container(ReorderBufferTXN, node, iter.cur);
+
+		if (txn->base_snapshot == NULL || txn->total_size == 0)
+			continue;
+
+		if (largest != NULL && txn->total_size <= largest->total_size)
+			continue;
+
+		catalog_changes = txn->has_catalog_changes;
+		dlist_foreach(subtxn_i, &txn->subtxns)
+		{
+			ReorderBufferTXN *subtxn;
+
+			subtxn = dlist_container(ReorderBufferTXN, node, subtxn_i.cur);
+			catalog_changes |= subtxn->has_catalog_changes;
+		}
+
+		if (!catalog_changes)
+			largest = txn;
+	}
+
+	return largest;
+}
+
+/*
+ * Check whether the decoded changes exceed logical_decoding_work_mem, and
+ * if so, evict transactions until we're below the limit again. If possible
+ * the largest toplevel transaction is streamed to the output plugin,
+ * otherwise the largest (sub)transaction is spilled to disk.
  */
 static void
-ReorderBufferCheckSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
+ReorderBufferCheckMemoryLimit(ReorderBuffer *rb)
 {
-	/*
-	 * TODO: improve accounting so we cheaply can take subtransactions into
-	 * account here.
-	 */
-	if (txn->nentries_mem >= max_changes_in_memory)
+	ReorderBufferTXN *txn;
+
+	while (rb->size >= logical_decoding_work_mem * 1024L)
 	{
-		ReorderBufferSerializeTXN(rb, txn);
-		Assert(txn->nentries_mem == 0);
+		if (ReorderBufferCanStream(rb) &&
+			(txn = ReorderBufferLargestTopTXN(rb)) != NULL)
+		{
+			ReorderBufferStreamTXN(rb, txn, InvalidXLogRecPtr);
+			Assert(txn->total_size == 0);
+		}
+		else
+		{
+			txn = ReorderBufferLargestTXN(rb);
+			Assert(txn != NULL && txn->size > 0);
+
+			ReorderBufferSerializeTXN(rb, txn);
+			Assert(txn->size == 0);
+			Assert(txn->nentries_mem == 0);
+		}
 	}
 }
 
@@ -2115,7 +2638,15 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 
 		ReorderBufferSerializeChange(rb, txn, fd, change);
 		dlist_delete(&change->node);
-		ReorderBufferReturnChange(rb, change);
+
+		/*
+		 * Remember the last spilled change, so we know which files to read
+		 * and remove even if the transaction never finishes.
+		 */
+		if (change->lsn > txn->final_lsn)
+			txn->final_lsn = change->lsn;
+
+		ReorderBufferReturnChange(rb, change, true);
 
 		spilled++;
 	}
@@ -2314,7 +2845,7 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 		dlist_container(ReorderBufferChange, node, cleanup_iter.cur);
 
 		dlist_delete(&cleanup->node);
-		ReorderBufferReturnChange(rb, cleanup);
+		ReorderBufferReturnChange(rb, cleanup, true);
 	}
 	txn->nentries_mem = 0;
 	Assert(dlist_is_empty(&txn->changes));
@@ -2560,6 +3091,13 @@ ReorderBufferRestoreChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	dlist_push_tail(&txn->changes, &change->node);
 	txn->nentries_mem++;
+
+	/*
+	 * Restored changes are accounted for like queued ones, as they're freed
+	 * the same way; but restoring never triggers eviction.
+	 */
+	change->txn = txn;
+	ReorderBufferChangeMemoryUpdate(rb, change, true);
 }
 
 /*
@@ -2905,9 +3443,14 @@ ReorderBufferToastReplace(ReorderBuffer *rb, ReorderBufferTXN *txn,
 	Assert(newtup->tuple.t_len <= MaxHeapTupleSize);
 	Assert(ReorderBufferTupleBufData(newtup) == newtup->tuple.t_data);
 
+	/* the tuple's size changes, so keep the memory accounting in sync */
+	ReorderBufferChangeMemoryUpdate(rb, change, false);
+
 	memcpy(newtup->tuple.t_data, tmphtup->t_data, tmphtup->t_len);
 	newtup->tuple.t_len = tmphtup->t_len;
 
+	ReorderBufferChangeMemoryUpdate(rb, change, true);
+
 	/*
 	 * free resources we won't further need, more persistent stuff will be
 	 * free'd in ReorderBufferToastReset().
@@ -2953,7 +3496,7 @@ ReorderBufferToastReset(ReorderBuffer *rb, ReorderBufferTXN *txn)
 			dlist_container(ReorderBufferChange, node, it.cur);
 
 			dlist_delete(&change->node);
-			ReorderBufferReturnChange(rb, change);
+			ReorderBufferReturnChange(rb, change, false);
 		}
 	}
 
@@ -47,6 +47,15 @@
  *	  So the state progression is always: INIT -> DATASYNC -> SYNCWAIT -> CATCHUP ->
  *	  SYNCDONE -> READY.
  *
+ *	  A large table may be copied in parallel (see plan_parallel_copy()).
+ *	  The sync worker then exports the snapshot of its slot, and it and up
+ *	  to max_parallel_sync_workers_per_table parallel sync workers copy key
+ *	  ranges of the table under that snapshot, each range committed by
+ *	  itself.  Before that, the state is set to PARALLELSYNC in the catalog,
+ *	  so that if anything fails, the next sync worker for the table knows to
+ *	  truncate the partial copy before starting over.  Once all ranges are
+ *	  copied, the sync worker continues as above from SYNCWAIT on.
+ *
  *	  The catalog pg_subscription_rel is used to keep information about
  *	  subscribed tables and their state.  Some transient state during data
  *	  synchronization is kept in shared memory.  The states SYNCWAIT and
@@ -88,28 +97,68 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 
+#include "access/heapam.h"
 #include "access/xact.h"
 
+#include "catalog/heap.h"
 #include "catalog/pg_subscription_rel.h"
 #include "catalog/pg_type.h"
 
 #include "commands/copy.h"
+#include "commands/tablecmds.h"
+
+#include "nodes/makefuncs.h"
 
 #include "parser/parse_relation.h"
 
+#include "postmaster/bgworker.h"
+
 #include "replication/logicallauncher.h"
 #include "replication/logicalrelation.h"
+#include "replication/logicalworker.h"
 #include "replication/walreceiver.h"
 #include "replication/worker_internal.h"
 
 #include "utils/snapmgr.h"
+#include "storage/dsm.h"
 #include "storage/ipc.h"
+#include "storage/proc.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
 
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 
+/* Magic number and keys for the parallel table copy segment */
+#define PARALLEL_SYNC_MAGIC			0x4c525053
+#define PARALLEL_SYNC_KEY_SHARED	0
+#define PARALLEL_SYNC_KEY_COMMANDS	1
+
+/*
+ * Key ranges per participant of a parallel copy, so that those that are
+ * done early can take on ranges that would otherwise be left to others.
+ */
+#define PARALLEL_SYNC_CHUNKS_PER_WORKER	4
+
+/* State of a parallel table copy shared by all participants */
+typedef struct ParallelSyncShared
+{
+	slock_t		mutex;
+	PGPROC	   *leader;			/* the table's sync worker */
+	bool		failed;			/* has a participant given up? */
+	char		snapshot[NAMEDATALEN];	/* exported by the leader */
+	int			nchunks;		/* number of key ranges */
+	int			next_chunk;		/* next range to be copied */
+	int			nchunks_done;	/* ranges copied and committed */
+} ParallelSyncShared;
+
 static bool table_states_valid = false;
+static List *table_states = NIL;
+
+static ParallelSyncShared *MyParallelSync = NULL;
+static bool am_parallel_sync_leader = false;
+static int	MyParallelSyncChunk = -1;
 
 StringInfo	copybuf = NULL;
 
@@ -273,6 +322,49 @@ invalidate_syncing_table_states(Datum arg, int cacheid, uint32 hashvalue)
 	table_states_valid = false;
 }
 
+/*
+ * Refresh the list of tables that are not yet ready, if it was invalidated.
+ *
+ * Starts a transaction for the catalog access if needed, and sets
+ * *started_tx in that case.
+ */
+static void
+fetch_table_states(bool *started_tx)
+{
+	MemoryContext oldctx;
+	List	   *rstates;
+	ListCell   *lc;
+	SubscriptionRelState *rstate;
+
+	if (table_states_valid)
+		return;
+
+	/* Clean the old list. */
+	list_free_deep(table_states);
+	table_states = NIL;
+
+	if (!IsTransactionState())
+	{
+		StartTransactionCommand();
+		*started_tx = true;
+	}
+
+	/* Fetch all non-ready tables. */
+	rstates = GetSubscriptionNotReadyRelations(MySubscription->oid);
+
+	/* Allocate the tracking info in a permanent memory context. */
+	oldctx = MemoryContextSwitchTo(CacheMemoryContext);
+	foreach(lc, rstates)
+	{
+		rstate = palloc(sizeof(SubscriptionRelState));
+		memcpy(rstate, lfirst(lc), sizeof(SubscriptionRelState));
+		table_states = lappend(table_states, rstate);
+	}
+	MemoryContextSwitchTo(oldctx);
+
+	table_states_valid = true;
+}
+
 /*
  * Handle table synchronization cooperation from the synchronization
  * worker.
@@ -340,7 +432,6 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 		Oid			relid;
 		TimestampTz last_start_time;
 	};
-	static List *table_states = NIL;
 	static HTAB *last_start_times = NULL;
 	ListCell   *lc;
 	bool		started_tx = false;
@@ -348,35 +439,7 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 	Assert(!IsTransactionState());
 
 	/* We need up-to-date sync state info for subscription tables here. */
-	if (!table_states_valid)
-	{
-		MemoryContext oldctx;
-		List	   *rstates;
-		ListCell   *lc;
-		SubscriptionRelState *rstate;
-
-		/* Clean the old list. */
-		list_free_deep(table_states);
-		table_states = NIL;
-
-		StartTransactionCommand();
-		started_tx = true;
-
-		/* Fetch all non-ready tables. */
-		rstates = GetSubscriptionNotReadyRelations(MySubscription->oid);
-
-		/* Allocate the tracking info in a permanent memory context. */
-		oldctx = MemoryContextSwitchTo(CacheMemoryContext);
-		foreach(lc, rstates)
-		{
-			rstate = palloc(sizeof(SubscriptionRelState));
-			memcpy(rstate, lfirst(lc), sizeof(SubscriptionRelState));
-			table_states = lappend(table_states, rstate);
-		}
-		MemoryContextSwitchTo(oldctx);
-
-		table_states_valid = true;
-	}
+	fetch_table_states(&started_tx);
 
 	/*
 	 * Prepare a hash table for tracking last start times of workers, to avoid
@@ -522,7 +585,8 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 												 MySubscription->oid,
 												 MySubscription->name,
 												 MyLogicalRepWorker->userid,
-												 rstate->relid);
+												 rstate->relid,
+												 DSM_HANDLE_INVALID);
 						hentry->last_start_time = now;
 					}
 				}
@@ -549,6 +613,26 @@ process_syncing_tables(XLogRecPtr current_lsn)
 		process_syncing_tables_for_apply(current_lsn);
 }
 
+/*
+ * Are all tables of the subscription ready, so that no table is being
+ * synchronized by another worker?
+ */
+bool
+AllTablesyncsReady(void)
+{
+	bool		started_tx = false;
+
+	fetch_table_states(&started_tx);
+
+	if (started_tx)
+	{
+		CommitTransactionCommand();
+		pgstat_report_stat(false);
+	}
+
+	return table_states == NIL;
+}
+
 /*
  * Create list of columns for COPY based on logical relation mapping.
  */
@@ -648,21 +732,69 @@ copy_read_data(void *outbuf, int minread, int maxread)
 }
 
 
+/*
+ * Does the publisher support row filters and column lists?
+ *
+ * The server version doesn't tell, as other servers of the same major
+ * version lack them, so look for the columns in pg_publication_rel.
+ */
+static bool
+publisher_has_row_filters(void)
+{
+	WalRcvExecResult *res;
+	TupleTableSlot *slot;
+	Oid			checkRow[1] = {BOOLOID};
+	bool		isnull;
+	bool		result;
+
+	res = walrcv_exec(wrconn,
+					  "SELECT count(*) = 2"
+					  "  FROM pg_catalog.pg_attribute"
+					  " WHERE attrelid = 'pg_catalog.pg_publication_rel'::pg_catalog.regclass"
+					  "   AND attname IN ('prattrs', 'prqual')"
+					  "   AND NOT attisdropped",
+					  1, checkRow);
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errmsg("could not check for row filter support on publisher: %s",
+						res->err)));
+
+	slot = MakeSingleTupleTableSlot(res->tupledesc);
+	if (!tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+		elog(ERROR, "unexpected empty result from publisher");
+	result = DatumGetBool(slot_getattr(slot, 1, &isnull));
+	Assert(!isnull);
+
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	return result;
+}
+
 /*
  * Get information about remote relation in similar fashion the RELATION
  * message provides during replication.
+ *
+ * Like the RELATION message, the columns are only those published by the
+ * subscribed publications.  If the publications filter the rows of the
+ * table, *qual is set to the combined filter as SQL, otherwise to NULL.
  */
 static void
 fetch_remote_table_info(char *nspname, char *relname,
-						LogicalRepRelation *lrel)
+						LogicalRepRelation *lrel, char **qual)
 {
 	WalRcvExecResult *res;
 	StringInfoData cmd;
 	TupleTableSlot *slot;
 	Oid			tableRow[2] = {OIDOID, CHAROID};
 	Oid			attrRow[4] = {TEXTOID, OIDOID, INT4OID, BOOLOID};
+	Oid			filterRow[2] = {INT2VECTOROID, TEXTOID};
 	bool		isnull;
 	int			natt;
+	Bitmapset  *columns = NULL;
+	bool		all_rows = false;
+	bool		all_columns = false;
+	StringInfoData quals;
 
 	lrel->nspname = nspname;
 	lrel->relname = relname;
@@ -699,6 +831,75 @@ fetch_remote_table_info(char *nspname, char *relname,
 	ExecDropSingleTupleTableSlot(slot);
 	walrcv_clear_result(res);
 
+	/*
+	 * Fetch the row filters and column lists of the publications, if the
+	 * publisher has them.  See pgoutput for how they are combined.
+	 */
+	*qual = NULL;
+	initStringInfo(&quals);
+	if (publisher_has_row_filters())
+	{
+		ListCell   *lc;
+
+		resetStringInfo(&cmd);
+		appendStringInfo(&cmd,
+						 "SELECT pr.prattrs,"
+						 "       pg_catalog.pg_get_expr(pr.prqual, pr.prrelid)"
+						 "  FROM pg_catalog.pg_publication p"
+						 "  LEFT JOIN pg_catalog.pg_publication_rel pr"
+						 "       ON (pr.prpubid = p.oid AND pr.prrelid = %u)"
+						 " WHERE (p.puballtables OR pr.prrelid IS NOT NULL)"
+						 "   AND p.pubname IN (",
+						 lrel->remoteid);
+		foreach(lc, MySubscription->publications)
+		{
+			if (lc != list_head(MySubscription->publications))
+				appendStringInfoString(&cmd, ", ");
+			appendStringInfoString(&cmd,
+								   quote_literal_cstr(strVal(lfirst(lc))));
+		}
+		appendStringInfoChar(&cmd, ')');
+
+		res = walrcv_exec(wrconn, cmd.data, 2, filterRow);
+		if (res->status != WALRCV_OK_TUPLES)
+			ereport(ERROR,
+					(errmsg("could not fetch row filters for table \"%s.%s\" from publisher: %s",
+							nspname, relname, res->err)));
+
+		slot = MakeSingleTupleTableSlot(res->tupledesc);
+		while (tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+		{
+			Datum		d;
+
+			d = slot_getattr(slot, 1, &isnull);
+			if (isnull)
+				all_columns = true;
+			else
+			{
+				int2vector *attrs = (int2vector *) DatumGetPointer(d);
+				int			i;
+
+				for (i = 0; i < attrs->dim1; i++)
+					columns = bms_add_member(columns, attrs->values[i]);
+			}
+
+			d = slot_getattr(slot, 2, &isnull);
+			if (isnull)
+				all_rows = true;
+			else
+				appendStringInfo(&quals, "%s(%s)",
+								 quals.len > 0 ? " OR " : "",
+								 TextDatumGetCString(d));
+
+			ExecClearTuple(slot);
+		}
+		ExecDropSingleTupleTableSlot(slot);
+		walrcv_clear_result(res);
+
+		if (!all_rows && quals.len > 0)
+			*qual = quals.data;
+	}
+
 	/* Now fetch columns. */
 	resetStringInfo(&cmd);
 	appendStringInfo(&cmd,
@@ -711,9 +912,27 @@ fetch_remote_table_info(char *nspname, char *relname,
 					 "       ON (i.indexrelid = pg_get_replica_identity_index(%u))"
 					 " WHERE a.attnum > 0::pg_catalog.int2"
 					 "   AND NOT a.attisdropped"
-					 "   AND a.attrelid = %u"
-					 " ORDER BY a.attnum",
+					 "   AND a.attrelid = %u",
 					 lrel->remoteid, lrel->remoteid);
+
+	/* The replica identity columns are published in any case. */
+	if (!all_columns && columns != NULL &&
+		lrel->replident != REPLICA_IDENTITY_FULL)
+	{
+		int			attnum = -1;
+		bool		first = true;
+
+		appendStringInfoString(&cmd,
+							   "   AND (a.attnum = ANY(i.indkey) OR a.attnum IN (");
+		while ((attnum = bms_next_member(columns, attnum)) >= 0)
+		{
+			appendStringInfo(&cmd, "%s%d", first ? "" : ", ", attnum);
+			first = false;
+		}
+		appendStringInfoString(&cmd, "))");
+	}
+	appendStringInfoString(&cmd, " ORDER BY a.attnum");
+
 	res = walrcv_exec(wrconn, cmd.data, 4, attrRow);
 
 	if (res->status != WALRCV_OK_TUPLES)
@@ -754,42 +973,52 @@ fetch_remote_table_info(char *nspname, char *relname,
 }
 
 /*
- * Copy existing data of a table from publisher.
+ * Return the quoted, comma-separated column names of a publisher relation.
+ */
+static char *
+make_copy_column_list(LogicalRepRelation *lrel)
+{
+	StringInfoData buf;
+	int			i;
+
+	initStringInfo(&buf);
+	for (i = 0; i < lrel->natts; i++)
+	{
+		if (i > 0)
+			appendStringInfoString(&buf, ", ");
+		appendStringInfoString(&buf, quote_identifier(lrel->attnames[i]));
+	}
+
+	return buf.data;
+}
+
+/*
+ * Copy existing data of a table from publisher, using the given COPY
+ * command, whose output columns must be those of the publisher relation.
  *
- * Caller is responsible for locking the local relation.
+ * Caller is responsible for locking the local relation and for putting the
+ * publisher relation into relmap.
  */
 static void
-copy_table(Relation rel)
+copy_table(Relation rel, LogicalRepRelId remoteid, const char *copycmd)
 {
 	LogicalRepRelMapEntry *relmapentry;
-	LogicalRepRelation lrel;
 	WalRcvExecResult *res;
-	StringInfoData cmd;
 	CopyState	cstate;
 	List	   *attnamelist;
 	ParseState *pstate;
 
-	/* Get the publisher relation info. */
-	fetch_remote_table_info(get_namespace_name(RelationGetNamespace(rel)),
-							RelationGetRelationName(rel), &lrel);
-
-	/* Put the relation into relmap. */
-	logicalrep_relmap_update(&lrel);
-
 	/* Map the publisher relation to local one. */
-	relmapentry = logicalrep_rel_open(lrel.remoteid, NoLock);
+	relmapentry = logicalrep_rel_open(remoteid, NoLock);
 	Assert(rel == relmapentry->localrel);
 
 	/* Start copy on the publisher. */
-	initStringInfo(&cmd);
-	appendStringInfo(&cmd, "COPY %s TO STDOUT",
-					 quote_qualified_identifier(lrel.nspname, lrel.relname));
-	res = walrcv_exec(wrconn, cmd.data, 0, NULL);
-	pfree(cmd.data);
+	res = walrcv_exec(wrconn, copycmd, 0, NULL);
 	if (res->status != WALRCV_OK_COPY_OUT)
 		ereport(ERROR,
 				(errmsg("could not start initial contents copy for table \"%s.%s\": %s",
-						lrel.nspname, lrel.relname, res->err)));
+						relmapentry->remoterel.nspname,
+						relmapentry->remoterel.relname, res->err)));
 	walrcv_clear_result(res);
 
 	copybuf = makeStringInfo();
@@ -806,6 +1035,489 @@ copy_table(Relation rel)
 	logicalrep_rel_close(relmapentry, NoLock);
 }
 
+/*
+ * Decide whether to copy the table in parallel, and if so, return the COPY
+ * commands for the key ranges to split it into.  Returns NIL if the table
+ * should be copied by a single COPY.
+ *
+ * The ranges are copied and committed separately, so the local table must
+ * be empty, so that a failed copy can be undone by truncating it, and must
+ * not be referenced by foreign keys, which would prevent that.  The ranges
+ * are those of the single column of the replica identity, split at values
+ * from the column's histogram in the publisher's statistics; without
+ * statistics, we don't know where to split.  The row filter, if any, is
+ * applied to each range.
+ *
+ * The caller must have an active snapshot.
+ */
+static List *
+plan_parallel_copy(Relation rel, LogicalRepRelation *lrel, char *qual)
+{
+	WalRcvExecResult *res;
+	StringInfoData cmd;
+	TupleTableSlot *slot;
+	Oid			sizeRow[1] = {INT8OID};
+	Oid			boundRow[1] = {TEXTOID};
+	HeapScanDesc scan;
+	bool		isempty;
+	bool		isnull;
+	int64		relsize;
+	char	   *keyname;
+	char	   *columns;
+	char	  **bounds;
+	int			nbounds;
+	int			nchunks;
+	int			i;
+	List	   *copycmds = NIL;
+
+	if (max_parallel_sync_workers_per_table == 0)
+		return NIL;
+
+	if (bms_num_members(lrel->attkeys) != 1)
+		return NIL;
+
+	if (heap_truncate_find_FKs(list_make1_oid(RelationGetRelid(rel))) != NIL)
+		return NIL;
+
+	scan = heap_beginscan(rel, GetActiveSnapshot(), 0, NULL);
+	isempty = (heap_getnext(scan, ForwardScanDirection) == NULL);
+	heap_endscan(scan);
+	if (!isempty)
+		return NIL;
+
+	/* Is the table large enough to bother? */
+	initStringInfo(&cmd);
+	appendStringInfo(&cmd, "SELECT pg_catalog.pg_relation_size(%u)",
+					 lrel->remoteid);
+	res = walrcv_exec(wrconn, cmd.data, 1, sizeRow);
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errmsg("could not fetch size of table \"%s.%s\" from publisher: %s",
+						lrel->nspname, lrel->relname, res->err)));
+
+	slot = MakeSingleTupleTableSlot(res->tupledesc);
+	if (!tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+		elog(ERROR, "could not fetch size of table \"%s.%s\" from publisher",
+			 lrel->nspname, lrel->relname);
+	relsize = DatumGetInt64(slot_getattr(slot, 1, &isnull));
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	if (isnull || relsize < (int64) min_parallel_table_sync_size * BLCKSZ)
+		return NIL;
+
+	/*
+	 * Fetch the histogram bounds of the key column.  They are in the order
+	 * of the column's default operator class, which is also what the
+	 * comparisons of the COPY commands below use, so keep them that way.
+	 */
+	keyname = lrel->attnames[bms_next_member(lrel->attkeys, -1)];
+	resetStringInfo(&cmd);
+	appendStringInfo(&cmd,
+					 "SELECT u.b"
+					 "  FROM pg_catalog.pg_stats s,"
+					 "       pg_catalog.unnest(s.histogram_bounds::pg_catalog.text::pg_catalog.text[])"
+					 "       WITH ORDINALITY AS u(b, n)"
+					 " WHERE s.schemaname = %s"
+					 "   AND s.tablename = %s"
+					 "   AND s.attname = %s"
+					 "   AND NOT s.inherited"
+					 " ORDER BY u.n",
+					 quote_literal_cstr(lrel->nspname),
+					 quote_literal_cstr(lrel->relname),
+					 quote_literal_cstr(keyname));
+	res = walrcv_exec(wrconn, cmd.data, 1, boundRow);
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errmsg("could not fetch statistics for table \"%s.%s\" from publisher: %s",
+						lrel->nspname, lrel->relname, res->err)));
+
+	bounds = palloc(tuplestore_tuple_count(res->tuplestore) * sizeof(char *));
+	nbounds = 0;
+	slot = MakeSingleTupleTableSlot(res->tupledesc);
+	while (tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+	{
+		Datum		d = slot_getattr(slot, 1, &isnull);
+
+		if (!isnull)
+			bounds[nbounds++] = TextDatumGetCString(d);
+		ExecClearTuple(slot);
+	}
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	if (nbounds < 2)
+		return NIL;
+
+	/*
+	 * Split the table at evenly spaced bounds, giving the first and last
+	 * ranges everything below and above the histogram.
+	 */
+	nchunks = Min((max_parallel_sync_workers_per_table + 1) *
+				  PARALLEL_SYNC_CHUNKS_PER_WORKER, nbounds);
+
+	columns = make_copy_column_list(lrel);
+	keyname = (char *) quote_identifier(keyname);
+
+	for (i = 0; i < nchunks; i++)
+	{
+		resetStringInfo(&cmd);
+		appendStringInfo(&cmd, "COPY (SELECT %s FROM ONLY %s WHERE ",
+						 columns,
+						 quote_qualified_identifier(lrel->nspname, lrel->relname));
+		if (qual)
+			appendStringInfo(&cmd, "(%s) AND ", qual);
+		if (i > 0)
+			appendStringInfo(&cmd, "%s >= %s", keyname,
+							 quote_literal_cstr(bounds[i * nbounds / nchunks]));
+		if (i > 0 && i < nchunks - 1)
+			appendStringInfoString(&cmd, " AND ");
+		if (i < nchunks - 1)
+			appendStringInfo(&cmd, "%s < %s", keyname,
+							 quote_literal_cstr(bounds[(i + 1) * nbounds / nchunks]));
+		appendStringInfoString(&cmd, ") TO STDOUT");
+
+		copycmds = lappend(copycmds, pstrdup(cmd.data));
+	}
+
+	pfree(cmd.data);
+
+	return copycmds;
+}
+
+/*
+ * Tell the others if we give up before the table has been copied, so that
+ * they don't carry on in vain.
+ */
+static void
+parallel_sync_on_detach(dsm_segment *seg, Datum arg)
+{
+	ParallelSyncShared *shared = (ParallelSyncShared *) DatumGetPointer(arg);
+
+	SpinLockAcquire(&shared->mutex);
+	if (MyParallelSyncChunk >= 0 ||
+		(am_parallel_sync_leader && shared->nchunks_done < shared->nchunks))
+		shared->failed = true;
+	SpinLockRelease(&shared->mutex);
+
+	SetLatch(&shared->leader->procLatch);
+}
+
+static void
+parallel_sync_check_failed(void)
+{
+	bool		failed;
+
+	SpinLockAcquire(&MyParallelSync->mutex);
+	failed = MyParallelSync->failed;
+	SpinLockRelease(&MyParallelSync->mutex);
+
+	if (failed && am_parallel_sync_leader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("logical replication parallel table synchronization worker exited unexpectedly")));
+	else if (failed)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("logical replication table synchronization worker or another parallel table synchronization worker exited")));
+}
+
+/*
+ * Make sure that the leader of the copy is still there.  This must be
+ * checked with the table locked: once the leader has exited, the next sync
+ * worker for the table may truncate it to start over, and it must not miss
+ * anything we copy.
+ */
+static void
+parallel_sync_check_leader(void)
+{
+	LogicalRepWorker *leader;
+	bool		alive;
+
+	LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
+	leader = logicalrep_worker_find(MyLogicalRepWorker->subid,
+									MyLogicalRepWorker->relid, true);
+	alive = (leader != NULL &&
+			 leader->proc->pid == MyLogicalRepWorker->leader_pid);
+	LWLockRelease(LogicalRepWorkerLock);
+
+	if (!alive)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("logical replication table synchronization worker or another parallel table synchronization worker exited")));
+}
+
+/*
+ * Reserve the next key range to copy.  Returns -1 if none are left.
+ */
+static int
+parallel_sync_next_chunk(void)
+{
+	int			chunk;
+
+	parallel_sync_check_failed();
+
+	SpinLockAcquire(&MyParallelSync->mutex);
+	chunk = MyParallelSync->next_chunk;
+	if (chunk < MyParallelSync->nchunks)
+		MyParallelSync->next_chunk++;
+	else
+		chunk = -1;
+	SpinLockRelease(&MyParallelSync->mutex);
+
+	MyParallelSyncChunk = chunk;
+
+	return chunk;
+}
+
+/*
+ * Copy the given key range and then any others left, each in a transaction
+ * of its own.
+ */
+static void
+parallel_sync_copy_chunks(LogicalRepRelId remoteid, char **copycmds, int chunk)
+{
+	while (chunk >= 0)
+	{
+		Relation	rel;
+
+		CHECK_FOR_INTERRUPTS();
+
+		StartTransactionCommand();
+		rel = heap_open(MyLogicalRepWorker->relid, RowExclusiveLock);
+		if (!am_parallel_sync_leader)
+			parallel_sync_check_leader();
+
+		PushActiveSnapshot(GetTransactionSnapshot());
+		copy_table(rel, remoteid, copycmds[chunk]);
+		PopActiveSnapshot();
+
+		heap_close(rel, NoLock);
+		CommitTransactionCommand();
+		pgstat_report_stat(false);
+
+		SpinLockAcquire(&MyParallelSync->mutex);
+		MyParallelSync->nchunks_done++;
+		SpinLockRelease(&MyParallelSync->mutex);
+		MyParallelSyncChunk = -1;
+
+		SetLatch(&MyParallelSync->leader->procLatch);
+
+		chunk = parallel_sync_next_chunk();
+	}
+}
+
+/*
+ * Split the packed COPY commands of the segment into an array.
+ */
+static char **
+parallel_sync_commands(shm_toc *toc)
+{
+	char	   *p = shm_toc_lookup(toc, PARALLEL_SYNC_KEY_COMMANDS, false);
+	char	  **copycmds;
+	int			i;
+
+	copycmds = palloc(MyParallelSync->nchunks * sizeof(char *));
+	for (i = 0; i < MyParallelSync->nchunks; i++)
+	{
+		copycmds[i] = p;
+		p += strlen(p) + 1;
+	}
+
+	return copycmds;
+}
+
+/*
+ * Copy the table using the given COPY commands for its key ranges, together
+ * with up to max_parallel_sync_workers_per_table parallel sync workers.
+ *
+ * Called in the transaction on the publisher that created the slot, and in
+ * a local transaction without the table open, which we commit after setting
+ * the table's state to PARALLELSYNC.  Returns in a new local transaction
+ * once the whole table has been copied.
+ */
+static void
+copy_table_parallel(LogicalRepRelId remoteid, List *copycmds)
+{
+	WalRcvExecResult *res;
+	TupleTableSlot *slot;
+	Oid			snapRow[1] = {TEXTOID};
+	shm_toc_estimator e;
+	Size		cmdsize = 0;
+	Size		segsize;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	ParallelSyncShared *shared;
+	char	   *snapshot;
+	char	   *p;
+	bool		isnull;
+	int			nworkers;
+	int			i;
+	ListCell   *lc;
+
+	foreach(lc, copycmds)
+		cmdsize = add_size(cmdsize, strlen((char *) lfirst(lc)) + 1);
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sizeof(ParallelSyncShared));
+	shm_toc_estimate_chunk(&e, cmdsize);
+	shm_toc_estimate_keys(&e, 2);
+	segsize = shm_toc_estimate(&e);
+
+	/* The segment must survive the local transactions of the copy. */
+	seg = dsm_create(segsize, 0);
+	dsm_pin_mapping(seg);
+	toc = shm_toc_create(PARALLEL_SYNC_MAGIC, dsm_segment_address(seg),
+						 segsize);
+
+	/* Export the snapshot of the slot for the workers. */
+	res = walrcv_exec(wrconn, "SELECT pg_catalog.pg_export_snapshot()",
+					  1, snapRow);
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errmsg("could not export snapshot on publisher: %s",
+						res->err)));
+
+	slot = MakeSingleTupleTableSlot(res->tupledesc);
+	if (!tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+		elog(ERROR, "could not export snapshot on publisher");
+	snapshot = TextDatumGetCString(slot_getattr(slot, 1, &isnull));
+	Assert(!isnull);
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	if (strlen(snapshot) >= NAMEDATALEN)
+		elog(ERROR, "snapshot identifier \"%s\" exported by publisher is too long",
+			 snapshot);
+
+	shared = shm_toc_allocate(toc, sizeof(ParallelSyncShared));
+	SpinLockInit(&shared->mutex);
+	shared->leader = MyProc;
+	shared->failed = false;
+	strlcpy(shared->snapshot, snapshot, NAMEDATALEN);
+	shared->nchunks = list_length(copycmds);
+	shared->next_chunk = 0;
+	shared->nchunks_done = 0;
+	shm_toc_insert(toc, PARALLEL_SYNC_KEY_SHARED, shared);
+
+	p = shm_toc_allocate(toc, cmdsize);
+	shm_toc_insert(toc, PARALLEL_SYNC_KEY_COMMANDS, p);
+	foreach(lc, copycmds)
+	{
+		strcpy(p, (char *) lfirst(lc));
+		p += strlen(p) + 1;
+	}
+
+	MyParallelSync = shared;
+	am_parallel_sync_leader = true;
+	on_dsm_detach(seg, parallel_sync_on_detach, PointerGetDatum(shared));
+
+	/* From now on, a failed copy must be undone before starting over. */
+	SpinLockAcquire(&MyLogicalRepWorker->relmutex);
+	MyLogicalRepWorker->relstate = SUBREL_STATE_PARALLELSYNC;
+	SpinLockRelease(&MyLogicalRepWorker->relmutex);
+
+	SetSubscriptionRelState(MyLogicalRepWorker->subid,
+							MyLogicalRepWorker->relid,
+							MyLogicalRepWorker->relstate,
+							MyLogicalRepWorker->relstate_lsn,
+							true);
+	CommitTransactionCommand();
+	pgstat_report_stat(false);
+
+	/* Launch the workers; we copy one of the ranges ourselves. */
+	nworkers = Min(max_parallel_sync_workers_per_table, shared->nchunks - 1);
+	for (i = 0; i < nworkers; i++)
+	{
+		if (!logicalrep_worker_launch(MyLogicalRepWorker->dbid,
+									  MySubscription->oid,
+									  MySubscription->name,
+									  MyLogicalRepWorker->userid,
+									  MyLogicalRepWorker->relid,
+									  dsm_segment_handle(seg)))
+			break;
+	}
+
+	parallel_sync_copy_chunks(remoteid, parallel_sync_commands(toc),
+							  parallel_sync_next_chunk());
+
+	/* Wait for the workers to finish their ranges. */
+	for (;;)
+	{
+		int			nchunks_done;
+		int			rc;
+
+		CHECK_FOR_INTERRUPTS();
+
+		parallel_sync_check_failed();
+
+		SpinLockAcquire(&shared->mutex);
+		nchunks_done = shared->nchunks_done;
+		SpinLockRelease(&shared->mutex);
+
+		if (nchunks_done == shared->nchunks)
+			break;
+
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+					   1000L, WAIT_EVENT_LOGICAL_SYNC_PARALLEL_COPY);
+
+		/* emergency bailout if postmaster has died */
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+
+		ResetLatch(MyLatch);
+	}
+
+	dsm_detach(seg);
+	MyParallelSync = NULL;
+	am_parallel_sync_leader = false;
+
+	StartTransactionCommand();
+}
+
+/*
+ * Build the name of the temporary slot of the table's sync worker.
+ */
+static char *
+sync_slot_name(void)
+{
+	/*
+	 * To build a slot name for the sync work, we are limited to NAMEDATALEN -
+	 * 1 characters.  We cut the original slot name to NAMEDATALEN - 28 chars
+	 * and append _%u_sync_%u (1 + 10 + 6 + 10 + '\0').  (It's actually the
+	 * NAMEDATALEN on the remote that matters, but this scheme will also work
+	 * reasonably if that is different.)
+	 */
+	StaticAssertStmt(NAMEDATALEN >= 32, "NAMEDATALEN too small");	/* for sanity */
+	return psprintf("%.*s_%u_sync_%u",
+					NAMEDATALEN - 28,
+					MySubscription->slotname,
+					MySubscription->oid,
+					MyLogicalRepWorker->relid);
+}
+
+/*
+ * Truncate what a failed parallel copy of the table left behind.
+ */
+static void
+truncate_partial_copy(void)
+{
+	Oid			relid = MyLogicalRepWorker->relid;
+	TruncateStmt *stmt = makeNode(TruncateStmt);
+	RangeVar   *rv;
+
+	rv = makeRangeVar(get_namespace_name(get_rel_namespace(relid)),
+					  get_rel_name(relid), -1);
+	rv->inh = false;
+
+	stmt->relations = list_make1(rv);
+	stmt->restart_seqs = false;
+	stmt->behavior = DROP_RESTRICT;
+
+	ExecuteTruncate(stmt);
+}
+
 /*
  * Start syncing the table in the sync worker.
  *
@@ -831,19 +1543,7 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 	MyLogicalRepWorker->relstate_lsn = relstate_lsn;
 	SpinLockRelease(&MyLogicalRepWorker->relmutex);
 
-	/*
-	 * To build a slot name for the sync work, we are limited to NAMEDATALEN -
-	 * 1 characters.  We cut the original slot name to NAMEDATALEN - 28 chars
-	 * and append _%u_sync_%u (1 + 10 + 6 + 10 + '\0').  (It's actually the
-	 * NAMEDATALEN on the remote that matters, but this scheme will also work
-	 * reasonably if that is different.)
-	 */
-	StaticAssertStmt(NAMEDATALEN >= 32, "NAMEDATALEN too small");	/* for sanity */
-	slotname = psprintf("%.*s_%u_sync_%u",
-						NAMEDATALEN - 28,
-						MySubscription->slotname,
-						MySubscription->oid,
-						MyLogicalRepWorker->relid);
+	slotname = sync_slot_name();
 
 	/*
 	 * Here we use the slot name instead of the subscription name as the
@@ -859,9 +1559,13 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 	{
 		case SUBREL_STATE_INIT:
 		case SUBREL_STATE_DATASYNC:
+		case SUBREL_STATE_PARALLELSYNC:
 			{
 				Relation	rel;
 				WalRcvExecResult *res;
+				LogicalRepRelation lrel;
+				char	   *qual;
+				List	   *copycmds;
 
 				SpinLockAcquire(&MyLogicalRepWorker->relmutex);
 				MyLogicalRepWorker->relstate = SUBREL_STATE_DATASYNC;
@@ -870,6 +1574,14 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 
 				/* Update the state and make it visible to others. */
 				StartTransactionCommand();
+
+				/*
+				 * A parallel copy commits as it goes, so if it failed, remove
+				 * what it had copied.
+				 */
+				if (relstate == SUBREL_STATE_PARALLELSYNC)
+					truncate_partial_copy();
+
 				SetSubscriptionRelState(MyLogicalRepWorker->subid,
 										MyLogicalRepWorker->relid,
 										MyLogicalRepWorker->relstate,
@@ -879,7 +1591,8 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 				pgstat_report_stat(false);
 
 				/*
-				 * We want to do the table data sync in a single transaction.
+				 * We want to do the table data sync in a single transaction,
+				 * unless we copy it in parallel.
 				 */
 				StartTransactionCommand();
 
@@ -918,9 +1631,43 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 								   CRS_USE_SNAPSHOT, origin_startpos);
 
 				PushActiveSnapshot(GetTransactionSnapshot());
-				copy_table(rel);
+
+				/* Get the publisher relation info and put it into relmap. */
+				fetch_remote_table_info(get_namespace_name(RelationGetNamespace(rel)),
+										RelationGetRelationName(rel), &lrel,
+										&qual);
+				logicalrep_relmap_update(&lrel);
+
+				copycmds = plan_parallel_copy(rel, &lrel, qual);
+				if (copycmds == NIL)
+				{
+					char	   *copycmd;
+
+					/* COPY can only filter rows of a query. */
+					if (qual)
+						copycmd = psprintf("COPY (SELECT %s FROM ONLY %s WHERE %s) TO STDOUT",
+										   make_copy_column_list(&lrel),
+										   quote_qualified_identifier(lrel.nspname,
+																	  lrel.relname),
+										   qual);
+					else
+						copycmd = psprintf("COPY %s (%s) TO STDOUT",
+										   quote_qualified_identifier(lrel.nspname,
+																	  lrel.relname),
+										   make_copy_column_list(&lrel));
+					copy_table(rel, lrel.remoteid, copycmd);
+					pfree(copycmd);
+				}
+
 				PopActiveSnapshot();
 
+				if (copycmds != NIL)
+				{
+					heap_close(rel, NoLock);
+					copy_table_parallel(lrel.remoteid, copycmds);
+					rel = heap_open(MyLogicalRepWorker->relid, RowExclusiveLock);
+				}
+
 				res = walrcv_exec(wrconn, "COMMIT", 0, NULL);
 				if (res->status != WALRCV_OK_COMMAND)
 					ereport(ERROR,
@@ -988,3 +1735,96 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 
 	return slotname;
 }
+
+/* Logical Replication parallel table synchronization worker entry point */
+void
+ParallelTableSyncWorkerMain(Datum main_arg)
+{
+	int			worker_slot = DatumGetInt32(main_arg);
+	dsm_handle	handle;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	char	  **copycmds;
+	char	   *err;
+	int			chunk;
+	WalRcvExecResult *res;
+	LogicalRepRelation lrel;
+	char	   *qual;			/* already part of the COPY commands */
+	StringInfoData cmd;
+
+	memcpy(&handle, MyBgworkerEntry->bgw_extra, sizeof(dsm_handle));
+	seg = dsm_attach(handle);
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_SYNC_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+
+	MyParallelSync = shm_toc_lookup(toc, PARALLEL_SYNC_KEY_SHARED, false);
+	on_dsm_detach(seg, parallel_sync_on_detach,
+				  PointerGetDatum(MyParallelSync));
+
+	/* Attach to slot */
+	logicalrep_worker_attach(worker_slot);
+
+	InitializeApplyWorker();
+
+	copycmds = parallel_sync_commands(toc);
+
+	/*
+	 * Take a range before importing the leader's snapshot, so that the
+	 * leader keeps it around until we're done.
+	 */
+	chunk = parallel_sync_next_chunk();
+	if (chunk < 0)
+		proc_exit(0);
+
+	wrconn = walrcv_connect(MySubscription->conninfo, true, sync_slot_name(),
+							&err);
+	if (wrconn == NULL)
+		ereport(ERROR,
+				(errmsg("could not connect to the publisher: %s", err)));
+
+	res = walrcv_exec(wrconn,
+					  "BEGIN READ ONLY ISOLATION LEVEL REPEATABLE READ",
+					  0, NULL);
+	if (res->status != WALRCV_OK_COMMAND)
+		ereport(ERROR,
+				(errmsg("table copy could not start transaction on publisher"),
+				 errdetail("The error was: %s", res->err)));
+	walrcv_clear_result(res);
+
+	initStringInfo(&cmd);
+	appendStringInfo(&cmd, "SET TRANSACTION SNAPSHOT %s",
+					 quote_literal_cstr(MyParallelSync->snapshot));
+	res = walrcv_exec(wrconn, cmd.data, 0, NULL);
+	if (res->status != WALRCV_OK_COMMAND)
+		ereport(ERROR,
+				(errmsg("table copy could not import snapshot on publisher"),
+				 errdetail("The error was: %s", res->err)));
+	walrcv_clear_result(res);
+	pfree(cmd.data);
+
+	/* Get the publisher relation info as the leader saw it. */
+	StartTransactionCommand();
+	fetch_remote_table_info(get_namespace_name(get_rel_namespace(MyLogicalRepWorker->relid)),
+							get_rel_name(MyLogicalRepWorker->relid), &lrel,
+							&qual);
+	logicalrep_relmap_update(&lrel);
+	CommitTransactionCommand();
+
+	parallel_sync_copy_chunks(lrel.remoteid, copycmds, chunk);
+
+	res = walrcv_exec(wrconn, "COMMIT", 0, NULL);
+	if (res->status != WALRCV_OK_COMMAND)
+		ereport(ERROR,
+				(errmsg("table copy could not finish transaction on publisher"),
+				 errdetail("The error was: %s", res->err)));
+	walrcv_clear_result(res);
+
+	proc_exit(0);
+}
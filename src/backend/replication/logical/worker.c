@@ -18,6 +18,19 @@
  *	  This module includes server facing code and shares libpqwalreceiver
  *	  module with walreceiver for providing the libpq specific functionality.
  *
+ *	  If the subscription streams large in-progress transactions, the
+ *	  changes of such a transaction arrive in blocks delimited by STREAM
+ *	  START and STREAM STOP messages, possibly interleaved with other
+ *	  transactions. We spool them into a temporary file per toplevel
+ *	  transaction and apply the file once STREAM COMMIT arrives; STREAM
+ *	  ABORT discards the file, or for a subtransaction the part of it
+ *	  written since the subtransaction's first change. That way the data is
+ *	  already on the subscriber when the transaction commits upstream.
+ *
+ *	  The apply worker may also hand transactions to parallel apply workers,
+ *	  see applyparallelworker.c.  Those run the same code as the apply
+ *	  worker to apply the messages they are passed.
+ *
  *-------------------------------------------------------------------------
  */
 
@@ -27,6 +40,7 @@
 #include "pgstat.h"
 #include "funcapi.h"
 
+#include "access/hash.h"
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 
@@ -67,6 +81,7 @@
 
 #include "rewrite/rewriteHandler.h"
 
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
@@ -80,12 +95,14 @@
 #include "utils/datum.h"
 #include "utils/fmgroids.h"
 #include "utils/guc.h"
+#include "utils/hashutils.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/timeout.h"
 #include "utils/tqual.h"
 #include "utils/syscache.h"
+#include "utils/typcache.h"
 
 #define NAPTIME_PER_CYCLE 1000	/* max sleep time between cycles (1s) */
 
@@ -104,7 +121,7 @@ typedef struct SlotErrCallbackArg
 	int			attnum;
 } SlotErrCallbackArg;
 
-static MemoryContext ApplyMessageContext = NULL;
+MemoryContext ApplyMessageContext = NULL;
 MemoryContext ApplyContext = NULL;
 
 WalReceiverConn *wrconn = NULL;
@@ -115,12 +132,55 @@ bool		MySubscriptionValid = false;
 bool		in_remote_transaction = false;
 static XLogRecPtr remote_final_lsn = InvalidXLogRecPtr;
 
+/*
+ * Spool of a streamed transaction. Subtransactions are remembered with the
+ * position of their first change, so that they can be cut off again if they
+ * abort.
+ */
+typedef struct StreamSubXact
+{
+	TransactionId xid;			/* xid of the subtransaction */
+	int			fileno;			/* file position of its first change */
+	off_t		offset;
+	int			nchanges;		/* number of changes before it */
+} StreamSubXact;
+
+typedef struct StreamXact
+{
+	TransactionId xid;			/* hash key - must be first */
+	BufFile    *file;			/* spooled changes */
+	int			fileno;			/* end of the valid data in the file */
+	off_t		offset;
+	int			nchanges;		/* number of spooled changes */
+	int			nsubxacts;		/* known subtransactions */
+	int			nsubxacts_max;
+	StreamSubXact *subxacts;
+} StreamXact;
+
+static HTAB *stream_xacts = NULL;
+
+/* are we between STREAM START and STREAM STOP, and for which transaction? */
+static bool in_streamed_transaction = false;
+static StreamXact *stream_xact = NULL;
+
+/* is the leader collecting a transaction for a parallel apply worker? */
+static bool in_parallel_transaction = false;
+
 static void send_feedback(XLogRecPtr recvpos, bool force, bool requestReply);
 
-static void store_flush_position(XLogRecPtr remote_lsn);
+static void store_flush_position(XLogRecPtr remote_lsn, XLogRecPtr local_lsn);
 
 static void maybe_reread_subscription(void);
 
+static void apply_handle_commit_internal(LogicalRepCommitData *commit_data);
+
+static bool handle_streamed_transaction(char action, StringInfo s);
+static void stream_cleanup(StreamXact *sxact);
+
+static bool handle_parallel_transaction(char action, StringInfo s);
+static void parallel_apply_add_tuple_key(LogicalRepRelMapEntry *rel,
+							 LogicalRepTupleData *tuple);
+
 /* Flags set by signal handlers */
 static volatile sig_atomic_t got_SIGHUP = false;
 
@@ -297,13 +357,66 @@ slot_store_error_callback(void *arg)
 }
 
 /*
- * Store data in C string form into slot.
+ * Convert the remote value of a column to a datum of the local column type.
+ *
+ * Values in text format are passed to the input function of the local type.
+ * Values in binary format are only ever sent for built-in types, whose OIDs
+ * are the same on both sides.  If the local column has the same type, the
+ * value is passed to its receive function; otherwise it is decoded with the
+ * receive function of the remote type and converted through its text
+ * representation, just as if it had been sent as text.
+ */
+static Datum
+slot_convert_value(LogicalRepRelMapEntry *rel, Form_pg_attribute att,
+				   LogicalRepTupleData *tupleData, int remoteattnum)
+{
+	char	   *value = tupleData->values[remoteattnum];
+	Oid			remotetypoid;
+	Oid			typinput;
+	Oid			typioparam;
+
+	if (tupleData->binary[remoteattnum])
+	{
+		StringInfoData buf;
+		Oid			typreceive;
+		Datum		datum;
+
+		buf.data = value;
+		buf.len = tupleData->lengths[remoteattnum];
+		buf.maxlen = buf.len + 1;
+		buf.cursor = 0;
+
+		remotetypoid = rel->remoterel.atttyps[remoteattnum];
+		if (remotetypoid == att->atttypid)
+		{
+			getTypeBinaryInputInfo(att->atttypid, &typreceive, &typioparam);
+			return OidReceiveFunctionCall(typreceive, &buf, typioparam,
+										  att->atttypmod);
+		}
+		else
+		{
+			Oid			typoutput;
+			bool		typisvarlena;
+
+			getTypeBinaryInputInfo(remotetypoid, &typreceive, &typioparam);
+			datum = OidReceiveFunctionCall(typreceive, &buf, typioparam, -1);
+			getTypeOutputInfo(remotetypoid, &typoutput, &typisvarlena);
+			value = OidOutputFunctionCall(typoutput, datum);
+		}
+	}
+
+	getTypeInputInfo(att->atttypid, &typinput, &typioparam);
+	return OidInputFunctionCall(typinput, value, typioparam, att->atttypmod);
+}
+
+/*
+ * Store data in C string or binary form into slot.
  * This is similar to BuildTupleFromCStrings but TupleTableSlot fits our
  * use better.
  */
 static void
-slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
-					char **values)
+slot_store_data(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
+				LogicalRepTupleData *tupleData)
 {
 	int			natts = slot->tts_tupleDescriptor->natts;
 	int			i;
@@ -320,25 +433,19 @@ slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
 	errcallback.previous = error_context_stack;
 	error_context_stack = &errcallback;
 
-	/* Call the "in" function for each non-dropped attribute */
+	/* Call the "in" or "recv" function for each non-dropped attribute */
 	for (i = 0; i < natts; i++)
 	{
 		Form_pg_attribute att = TupleDescAttr(slot->tts_tupleDescriptor, i);
 		int			remoteattnum = rel->attrmap[i];
 
 		if (!att->attisdropped && remoteattnum >= 0 &&
-			values[remoteattnum] != NULL)
+			tupleData->values[remoteattnum] != NULL)
 		{
-			Oid			typinput;
-			Oid			typioparam;
-
 			errarg.attnum = remoteattnum;
 
-			getTypeInputInfo(att->atttypid, &typinput, &typioparam);
-			slot->tts_values[i] = OidInputFunctionCall(typinput,
-													   values[remoteattnum],
-													   typioparam,
-													   att->atttypmod);
+			slot->tts_values[i] = slot_convert_value(rel, att, tupleData,
+													 remoteattnum);
 			slot->tts_isnull[i] = false;
 		}
 		else
@@ -360,14 +467,14 @@ slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
 }
 
 /*
- * Modify slot with user data provided as C strings.
+ * Modify slot with user data provided as C strings or binary values.
  * This is somewhat similar to heap_modify_tuple but also calls the type
- * input function on the user data as the input is the text representation
- * of the types.
+ * input or receive function on the user data, as the input is the text or
+ * binary representation of the types.
  */
 static void
-slot_modify_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
-					 char **values, bool *replaces)
+slot_modify_data(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
+				 LogicalRepTupleData *tupleData)
 {
 	int			natts = slot->tts_tupleDescriptor->natts;
 	int			i;
@@ -385,27 +492,22 @@ slot_modify_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
 	errcallback.previous = error_context_stack;
 	error_context_stack = &errcallback;
 
-	/* Call the "in" function for each replaced attribute */
+	/* Call the "in" or "recv" function for each replaced attribute */
 	for (i = 0; i < natts; i++)
 	{
 		Form_pg_attribute att = TupleDescAttr(slot->tts_tupleDescriptor, i);
 		int			remoteattnum = rel->attrmap[i];
 
-		if (remoteattnum >= 0 && !replaces[remoteattnum])
+		/* Leave columns the publisher doesn't send alone. */
+		if (remoteattnum < 0 || !tupleData->changed[remoteattnum])
 			continue;
 
-		if (remoteattnum >= 0 && values[remoteattnum] != NULL)
+		if (tupleData->values[remoteattnum] != NULL)
 		{
-			Oid			typinput;
-			Oid			typioparam;
-
 			errarg.attnum = remoteattnum;
 
-			getTypeInputInfo(att->atttypid, &typinput, &typioparam);
-			slot->tts_values[i] = OidInputFunctionCall(typinput,
-													   values[remoteattnum],
-													   typioparam,
-													   att->atttypmod);
+			slot->tts_values[i] = slot_convert_value(rel, att, tupleData,
+													 remoteattnum);
 			slot->tts_isnull[i] = false;
 		}
 		else
@@ -429,12 +531,32 @@ apply_handle_begin(StringInfo s)
 {
 	LogicalRepBeginData begin_data;
 
+	/*
+	 * Hand the transaction to a parallel apply worker if we can; otherwise
+	 * apply it ourselves, once the workers are done.
+	 */
+	if (am_leader_apply_worker())
+	{
+		in_parallel_transaction = parallel_apply_begin();
+		if (in_parallel_transaction)
+			parallel_apply_add_message('B', s);
+		else
+			parallel_apply_wait_all();
+	}
+
 	logicalrep_read_begin(s, &begin_data);
 
 	remote_final_lsn = begin_data.final_lsn;
 
 	in_remote_transaction = true;
 
+	/* The worker applying the next transaction waits for our xid. */
+	if (am_parallel_apply_worker())
+	{
+		ensure_transaction();
+		parallel_apply_set_xid(GetTopTransactionId());
+	}
+
 	pgstat_report_activity(STATE_RUNNING, NULL);
 }
 
@@ -448,24 +570,54 @@ apply_handle_commit(StringInfo s)
 {
 	LogicalRepCommitData commit_data;
 
+	if (in_parallel_transaction)
+		parallel_apply_add_message('C', s);
+
 	logicalrep_read_commit(s, &commit_data);
 
 	Assert(commit_data.commit_lsn == remote_final_lsn);
 
+	if (in_parallel_transaction)
+	{
+		parallel_apply_dispatch();
+
+		in_parallel_transaction = false;
+		in_remote_transaction = false;
+
+		pgstat_report_activity(STATE_IDLE, NULL);
+		return;
+	}
+
+	apply_handle_commit_internal(&commit_data);
+}
+
+/*
+ * Finish applying a remote transaction, streamed or not.
+ */
+static void
+apply_handle_commit_internal(LogicalRepCommitData *commit_data)
+{
 	/* The synchronization worker runs in single transaction. */
 	if (IsTransactionState() && !am_tablesync_worker())
 	{
+		/* Parallel apply workers commit in the publisher's order. */
+		if (am_parallel_apply_worker())
+			parallel_apply_wait_for_turn();
+
 		/*
 		 * Update origin state so we can restart streaming from correct
 		 * position in case of crash.
 		 */
-		replorigin_session_origin_lsn = commit_data.end_lsn;
-		replorigin_session_origin_timestamp = commit_data.committime;
+		replorigin_session_origin_lsn = commit_data->end_lsn;
+		replorigin_session_origin_timestamp = commit_data->committime;
 
 		CommitTransactionCommand();
 		pgstat_report_stat(false);
 
-		store_flush_position(commit_data.end_lsn);
+		if (am_parallel_apply_worker())
+			parallel_apply_committed(commit_data->end_lsn, XactLastCommitEnd);
+		else
+			store_flush_position(commit_data->end_lsn, XactLastCommitEnd);
 	}
 	else
 	{
@@ -477,7 +629,8 @@ apply_handle_commit(StringInfo s)
 	in_remote_transaction = false;
 
 	/* Process any tables that are being synchronized in parallel. */
-	process_syncing_tables(commit_data.end_lsn);
+	if (!am_parallel_apply_worker())
+		process_syncing_tables(commit_data->end_lsn);
 
 	pgstat_report_activity(STATE_IDLE, NULL);
 }
@@ -492,10 +645,11 @@ apply_handle_origin(StringInfo s)
 {
 	/*
 	 * ORIGIN message can only come inside remote transaction and before any
-	 * actual writes.
+	 * actual writes, or at the start of a streamed block.
 	 */
-	if (!in_remote_transaction ||
-		(IsTransactionState() && !am_tablesync_worker()))
+	if (!in_streamed_transaction &&
+		(!in_remote_transaction ||
+		 (IsTransactionState() && !am_tablesync_worker())))
 		ereport(ERROR,
 				(errcode(ERRCODE_PROTOCOL_VIOLATION),
 				 errmsg("ORIGIN message sent out of order")));
@@ -513,9 +667,20 @@ static void
 apply_handle_relation(StringInfo s)
 {
 	LogicalRepRelation *rel;
+	int			cursor = s->cursor;
+
+	if (handle_streamed_transaction('R', s))
+		return;
 
 	rel = logicalrep_read_rel(s);
 	logicalrep_relmap_update(rel);
+
+	/* Parallel apply workers need to know about it too. */
+	if (am_leader_apply_worker())
+	{
+		s->cursor = cursor;
+		parallel_apply_send_schema('R', rel->remoteid, s);
+	}
 }
 
 /*
@@ -528,9 +693,20 @@ static void
 apply_handle_type(StringInfo s)
 {
 	LogicalRepTyp typ;
+	int			cursor = s->cursor;
+
+	if (handle_streamed_transaction('Y', s))
+		return;
 
 	logicalrep_read_typ(s, &typ);
 	logicalrep_typmap_update(&typ);
+
+	/* Parallel apply workers need to know about it too. */
+	if (am_leader_apply_worker())
+	{
+		s->cursor = cursor;
+		parallel_apply_send_schema('Y', typ.remoteid, s);
+	}
 }
 
 /*
@@ -564,6 +740,10 @@ apply_handle_insert(StringInfo s)
 	TupleTableSlot *remoteslot;
 	MemoryContext oldctx;
 
+	if (handle_streamed_transaction('I', s) ||
+		handle_parallel_transaction('I', s))
+		return;
+
 	ensure_transaction();
 
 	relid = logicalrep_read_insert(s, &newtup);
@@ -585,7 +765,7 @@ apply_handle_insert(StringInfo s)
 
 	/* Process and store remote tuple in the slot */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel, newtup.values);
+	slot_store_data(remoteslot, rel, &newtup);
 	slot_fill_defaults(rel, estate, remoteslot);
 	MemoryContextSwitchTo(oldctx);
 
@@ -664,6 +844,10 @@ apply_handle_update(StringInfo s)
 	bool		found;
 	MemoryContext oldctx;
 
+	if (handle_streamed_transaction('U', s) ||
+		handle_parallel_transaction('U', s))
+		return;
+
 	ensure_transaction();
 
 	relid = logicalrep_read_update(s, &has_oldtup, &oldtup,
@@ -695,8 +879,8 @@ apply_handle_update(StringInfo s)
 
 	/* Build the search tuple. */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel,
-						has_oldtup ? oldtup.values : newtup.values);
+	slot_store_data(remoteslot, rel,
+					has_oldtup ? &oldtup : &newtup);
 	MemoryContextSwitchTo(oldctx);
 
 	/*
@@ -727,7 +911,7 @@ apply_handle_update(StringInfo s)
 		/* Process and store remote tuple in the slot */
 		oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
 		ExecStoreTuple(localslot->tts_tuple, remoteslot, InvalidBuffer, false);
-		slot_modify_cstrings(remoteslot, rel, newtup.values, newtup.changed);
+		slot_modify_data(remoteslot, rel, &newtup);
 		MemoryContextSwitchTo(oldctx);
 
 		EvalPlanQualSetSlot(&epqstate, remoteslot);
@@ -783,6 +967,10 @@ apply_handle_delete(StringInfo s)
 	bool		found;
 	MemoryContext oldctx;
 
+	if (handle_streamed_transaction('D', s) ||
+		handle_parallel_transaction('D', s))
+		return;
+
 	ensure_transaction();
 
 	relid = logicalrep_read_delete(s, &oldtup);
@@ -813,7 +1001,7 @@ apply_handle_delete(StringInfo s)
 
 	/* Find the tuple using the replica identity index. */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel, oldtup.values);
+	slot_store_data(remoteslot, rel, &oldtup);
 	MemoryContextSwitchTo(oldctx);
 
 	/*
@@ -864,11 +1052,449 @@ apply_handle_delete(StringInfo s)
 	CommandCounterIncrement();
 }
 
+/*
+ * Spool a change of a streamed transaction, if we're in the middle of a
+ * streamed block. Returns false if the change should be applied right away.
+ *
+ * Each change is written as its length, the action and the rest of the
+ * message following the xid of the (sub)transaction.
+ */
+static bool
+handle_streamed_transaction(char action, StringInfo s)
+{
+	TransactionId xid;
+	int			len;
+
+	if (!in_streamed_transaction)
+		return false;
+
+	Assert(stream_xact != NULL);
+
+	/* the xid of the (sub)transaction that made the change follows */
+	xid = pq_getmsgint(s, 4);
+
+	/* remember where a subtransaction's changes start */
+	if (xid != stream_xact->xid)
+	{
+		StreamXact *sxact = stream_xact;
+		int			i;
+
+		for (i = sxact->nsubxacts - 1; i >= 0; i--)
+		{
+			if (sxact->subxacts[i].xid == xid)
+				break;
+		}
+
+		if (i < 0)
+		{
+			StreamSubXact *subxact;
+
+			if (sxact->nsubxacts >= sxact->nsubxacts_max)
+			{
+				sxact->nsubxacts_max *= 2;
+				sxact->subxacts = repalloc(sxact->subxacts,
+										   sizeof(StreamSubXact) * sxact->nsubxacts_max);
+			}
+
+			subxact = &sxact->subxacts[sxact->nsubxacts++];
+			subxact->xid = xid;
+			BufFileTell(sxact->file, &subxact->fileno, &subxact->offset);
+			subxact->nchanges = sxact->nchanges;
+		}
+	}
+
+	len = (s->len - s->cursor) + sizeof(char);
+
+	if (BufFileWrite(stream_xact->file, &len, sizeof(len)) != sizeof(len) ||
+		BufFileWrite(stream_xact->file, &action, sizeof(action)) != sizeof(action) ||
+		BufFileWrite(stream_xact->file, &s->data[s->cursor],
+					 len - sizeof(char)) != len - sizeof(char))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to streamed transaction file: %m")));
+
+	stream_xact->nchanges++;
+
+	return true;
+}
 
 /*
- * Logical replication protocol message dispatcher.
+ * Collect a change of a transaction that a parallel apply worker is going to
+ * apply, and note which rows it touches.  Returns false if the change should
+ * be applied right away.
+ */
+static bool
+handle_parallel_transaction(char action, StringInfo s)
+{
+	LogicalRepRelMapEntry *rel;
+	LogicalRepRelId relid;
+	LogicalRepTupleData oldtup;
+	LogicalRepTupleData newtup;
+	bool		has_oldtup = false;
+
+	if (!in_parallel_transaction)
+		return false;
+
+	parallel_apply_add_message(action, s);
+
+	ensure_transaction();
+
+	switch (action)
+	{
+		case 'I':
+			relid = logicalrep_read_insert(s, &newtup);
+			break;
+		case 'U':
+			relid = logicalrep_read_update(s, &has_oldtup, &oldtup, &newtup);
+			break;
+		case 'D':
+			relid = logicalrep_read_delete(s, &oldtup);
+			has_oldtup = true;
+			break;
+		default:
+			elog(ERROR, "unexpected logical replication message type \"%c\"",
+				 action);
+	}
+
+	rel = logicalrep_rel_open(relid, AccessShareLock);
+
+	if (!should_apply_changes_for_rel(rel))
+	{
+		/* the worker will skip it */
+	}
+	else if (!rel->parallel_safe)
+		parallel_apply_set_serial();
+	else
+	{
+		if (has_oldtup)
+			parallel_apply_add_tuple_key(rel, &oldtup);
+		if (action != 'D')
+			parallel_apply_add_tuple_key(rel, &newtup);
+	}
+
+	/* The worker locks the relation when it applies the change. */
+	logicalrep_rel_close(rel, AccessShareLock);
+
+	return true;
+}
+
+/*
+ * Note the row identified by the replica identity columns of the tuple as
+ * touched by the transaction being collected.
+ *
+ * The key values are hashed with the hash function of their type, so that
+ * values that compare equal get the same hash, like for a hash index.
+ */
+static void
+parallel_apply_add_tuple_key(LogicalRepRelMapEntry *rel,
+							 LogicalRepTupleData *tuple)
+{
+	TupleDesc	desc = RelationGetDescr(rel->localrel);
+	uint32		hash;
+	int			i;
+
+	hash = DatumGetUInt32(hash_uint32(rel->localreloid));
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, i);
+		int			remoteattnum = rel->attrmap[i];
+		char	   *value;
+		TypeCacheEntry *typentry;
+		uint32		valuehash;
+
+		if (att->attisdropped || remoteattnum < 0 ||
+			!bms_is_member(remoteattnum, rel->remoterel.attkeys))
+			continue;
+
+		/* We don't know the value of an unchanged TOASTed column. */
+		if (!tuple->changed[remoteattnum])
+		{
+			parallel_apply_set_serial();
+			return;
+		}
+
+		value = tuple->values[remoteattnum];
+		if (value == NULL)
+		{
+			hash = hash_combine(hash, 0);
+			continue;
+		}
+
+		typentry = lookup_type_cache(att->atttypid, TYPECACHE_HASH_PROC_FINFO);
+		if (OidIsValid(typentry->hash_proc))
+		{
+			Datum		datum;
+
+			datum = slot_convert_value(rel, att, tuple, remoteattnum);
+			valuehash = DatumGetUInt32(FunctionCall1Coll(&typentry->hash_proc_finfo,
+														 att->attcollation,
+														 datum));
+		}
+		else
+			valuehash = DatumGetUInt32(hash_any((unsigned char *) value,
+												tuple->lengths[remoteattnum]));
+
+		hash = hash_combine(hash, valuehash);
+	}
+
+	parallel_apply_add_key(hash);
+}
+
+/*
+ * Handle STREAM START message.
+ */
+static void
+apply_handle_stream_start(StringInfo s)
+{
+	TransactionId xid;
+	bool		first_segment;
+	bool		found;
+	StreamXact *sxact;
+
+	if (in_streamed_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("duplicate STREAM START message")));
+
+	xid = logicalrep_read_stream_start(s, &first_segment);
+
+	if (!TransactionIdIsValid(xid))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid transaction ID in streamed replication transaction")));
+
+	if (stream_xacts == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(TransactionId);
+		ctl.entrysize = sizeof(StreamXact);
+		ctl.hcxt = ApplyContext;
+		stream_xacts = hash_create("logical replication streamed transactions",
+								   16, &ctl,
+								   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	sxact = (StreamXact *) hash_search(stream_xacts, &xid,
+									   first_segment ? HASH_ENTER : HASH_FIND,
+									   &found);
+
+	if (first_segment)
+	{
+		MemoryContext oldctx;
+
+		/* data of an earlier attempt to stream this transaction is stale */
+		if (found)
+		{
+			BufFileClose(sxact->file);
+			pfree(sxact->subxacts);
+		}
+
+		/* the file has to survive until the transaction ends upstream */
+		oldctx = MemoryContextSwitchTo(ApplyContext);
+		sxact->file = BufFileCreateTemp(true);
+		sxact->nsubxacts = 0;
+		sxact->nsubxacts_max = 16;
+		sxact->subxacts = palloc(sizeof(StreamSubXact) * sxact->nsubxacts_max);
+		MemoryContextSwitchTo(oldctx);
+
+		sxact->fileno = 0;
+		sxact->offset = 0;
+		sxact->nchanges = 0;
+	}
+	else if (!found)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("no data spooled for streamed transaction %u", xid)));
+
+	/* append to the valid data */
+	if (BufFileSeek(sxact->file, sxact->fileno, sxact->offset, SEEK_SET) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in streamed transaction file: %m")));
+
+	stream_xact = sxact;
+	in_streamed_transaction = true;
+
+	pgstat_report_activity(STATE_RUNNING, NULL);
+}
+
+/*
+ * Handle STREAM STOP message.
  */
 static void
+apply_handle_stream_stop(StringInfo s)
+{
+	if (!in_streamed_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM STOP message without STREAM START")));
+
+	BufFileTell(stream_xact->file, &stream_xact->fileno, &stream_xact->offset);
+
+	stream_xact = NULL;
+	in_streamed_transaction = false;
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+}
+
+/*
+ * Handle STREAM ABORT message.
+ */
+static void
+apply_handle_stream_abort(StringInfo s)
+{
+	TransactionId xid;
+	TransactionId subxid;
+	StreamXact *sxact;
+	int			i;
+
+	if (in_streamed_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM ABORT message within a streamed block")));
+
+	logicalrep_read_stream_abort(s, &xid, &subxid);
+
+	sxact = stream_xacts ?
+		(StreamXact *) hash_search(stream_xacts, &xid, HASH_FIND, NULL) :
+		NULL;
+
+	/* nothing spooled for it, e.g. because we were restarted */
+	if (sxact == NULL)
+		return;
+
+	if (subxid == xid)
+	{
+		stream_cleanup(sxact);
+		return;
+	}
+
+	/*
+	 * Cut off the subtransaction's changes. The changes of subtransactions
+	 * started after it belong to it (or it was released into one of them
+	 * already), so they go as well.
+	 */
+	for (i = 0; i < sxact->nsubxacts; i++)
+	{
+		StreamSubXact *subxact = &sxact->subxacts[i];
+
+		if (subxact->xid != subxid)
+			continue;
+
+		sxact->fileno = subxact->fileno;
+		sxact->offset = subxact->offset;
+		sxact->nchanges = subxact->nchanges;
+		sxact->nsubxacts = i;
+		break;
+	}
+}
+
+/*
+ * Handle STREAM COMMIT message: apply the spooled changes of the transaction.
+ */
+static void
+apply_handle_stream_commit(StringInfo s)
+{
+	TransactionId xid;
+	LogicalRepCommitData commit_data;
+	StreamXact *sxact;
+	StringInfoData s2;
+	int			i;
+
+	if (in_streamed_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM COMMIT message within a streamed block")));
+
+	xid = logicalrep_read_stream_commit(s, &commit_data);
+
+	/* We apply it ourselves, after whatever the parallel workers have. */
+	parallel_apply_wait_all();
+
+	sxact = stream_xacts ?
+		(StreamXact *) hash_search(stream_xacts, &xid, HASH_FIND, NULL) :
+		NULL;
+
+	if (sxact == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("no data spooled for streamed transaction %u", xid)));
+
+	remote_final_lsn = commit_data.commit_lsn;
+	in_remote_transaction = true;
+	pgstat_report_activity(STATE_RUNNING, NULL);
+
+	if (BufFileSeek(sxact->file, 0, 0, SEEK_SET) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in streamed transaction file: %m")));
+
+	/* the buffer is reused for all changes, so keep it out of the way */
+	s2.data = MemoryContextAlloc(ApplyContext, BLCKSZ);
+	s2.maxlen = BLCKSZ;
+
+	for (i = 0; i < sxact->nchanges; i++)
+	{
+		int			len;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (BufFileRead(sxact->file, &len, sizeof(len)) != sizeof(len))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from streamed transaction file: %m")));
+
+		if (len > s2.maxlen)
+		{
+			pfree(s2.data);
+			s2.data = MemoryContextAlloc(ApplyContext, len);
+			s2.maxlen = len;
+		}
+
+		if (BufFileRead(sxact->file, s2.data, len) != len)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from streamed transaction file: %m")));
+
+		s2.len = len;
+		s2.cursor = 0;
+
+		MemoryContextSwitchTo(ApplyMessageContext);
+		apply_dispatch(&s2);
+		MemoryContextReset(ApplyMessageContext);
+	}
+
+	pfree(s2.data);
+
+	elog(DEBUG1, "applied %d changes of streamed transaction %u",
+		 sxact->nchanges, xid);
+
+	stream_cleanup(sxact);
+
+	apply_handle_commit_internal(&commit_data);
+}
+
+/*
+ * Discard the spool of a streamed transaction.
+ */
+static void
+stream_cleanup(StreamXact *sxact)
+{
+	TransactionId xid = sxact->xid;
+
+	BufFileClose(sxact->file);
+	pfree(sxact->subxacts);
+
+	hash_search(stream_xacts, &xid, HASH_REMOVE, NULL);
+}
+
+/*
+ * Logical replication protocol message dispatcher.
+ */
+void
 apply_dispatch(StringInfo s)
 {
 	char		action = pq_getmsgbyte(s);
@@ -907,6 +1533,22 @@ apply_dispatch(StringInfo s)
 		case 'O':
 			apply_handle_origin(s);
 			break;
+			/* STREAM START */
+		case 'S':
+			apply_handle_stream_start(s);
+			break;
+			/* STREAM STOP */
+		case 'E':
+			apply_handle_stream_stop(s);
+			break;
+			/* STREAM ABORT */
+		case 'A':
+			apply_handle_stream_abort(s);
+			break;
+			/* STREAM COMMIT */
+		case 'c':
+			apply_handle_stream_commit(s);
+			break;
 		default:
 			ereport(ERROR,
 					(errcode(ERRCODE_PROTOCOL_VIOLATION),
@@ -972,7 +1614,7 @@ get_flush_position(XLogRecPtr *write, XLogRecPtr *flush,
  * Store current remote/local lsn pair in the tracking list.
  */
 static void
-store_flush_position(XLogRecPtr remote_lsn)
+store_flush_position(XLogRecPtr remote_lsn, XLogRecPtr local_lsn)
 {
 	FlushPosition *flushpos;
 
@@ -981,7 +1623,7 @@ store_flush_position(XLogRecPtr remote_lsn)
 
 	/* Track commit lsn  */
 	flushpos = (FlushPosition *) palloc(sizeof(FlushPosition));
-	flushpos->local_end = XactLastCommitEnd;
+	flushpos->local_end = local_lsn;
 	flushpos->remote_end = remote_lsn;
 
 	dlist_push_tail(&lsn_mapping, &flushpos->node);
@@ -1132,8 +1774,12 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 			AcceptInvalidationMessages();
 			maybe_reread_subscription();
 
-			/* Process any table synchronization changes. */
-			process_syncing_tables(last_received);
+			/*
+			 * Process any table synchronization changes, unless parallel
+			 * apply workers are still behind the position we'd pass.
+			 */
+			if (!parallel_apply_in_progress())
+				process_syncing_tables(last_received);
 		}
 
 		/* Cleanup the memory. */
@@ -1151,12 +1797,12 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 
 		/*
 		 * Wait for more data or latch.  If we have unflushed transactions,
-		 * wake up after WalWriterDelay to see if they've been flushed yet (in
-		 * which case we should send a feedback message).  Otherwise, there's
-		 * no particular urgency about waking up unless we get data or a
-		 * signal.
+		 * or parallel apply workers have uncommitted ones, wake up after
+		 * WalWriterDelay to see if they've been flushed yet (in which case
+		 * we should send a feedback message).  Otherwise, there's no
+		 * particular urgency about waking up unless we get data or a signal.
 		 */
-		if (!dlist_is_empty(&lsn_mapping))
+		if (!dlist_is_empty(&lsn_mapping) || parallel_apply_in_progress())
 			wait_time = WalWriterDelay;
 		else
 			wait_time = NAPTIME_PER_CYCLE;
@@ -1251,9 +1897,15 @@ send_feedback(XLogRecPtr recvpos, bool force, bool requestReply)
 
 	XLogRecPtr	writepos;
 	XLogRecPtr	flushpos;
+	XLogRecPtr	remote_end;
+	XLogRecPtr	local_end;
 	TimestampTz now;
 	bool		have_pending_txes;
 
+	/* Track what the parallel apply workers have committed. */
+	if (parallel_apply_get_progress(&remote_end, &local_end))
+		store_flush_position(remote_end, local_end);
+
 	/*
 	 * If the user doesn't want status to be reported to the publisher, be
 	 * sure to exit before doing anything at all.
@@ -1271,7 +1923,7 @@ send_feedback(XLogRecPtr recvpos, bool force, bool requestReply)
 	 * No outstanding transactions to flush, we can report the latest received
 	 * position. This is important for synchronous replication.
 	 */
-	if (!have_pending_txes)
+	if (!have_pending_txes && !parallel_apply_in_progress())
 		flushpos = writepos = recvpos;
 
 	if (writepos < last_writepos)
@@ -1438,6 +2090,31 @@ maybe_reread_subscription(void)
 		proc_exit(0);
 	}
 
+	/*
+	 * Exit if the streaming option was changed. The launcher will start new
+	 * worker.
+	 */
+	if (newsub->stream != MySubscription->stream)
+	{
+		ereport(LOG,
+				(errmsg("logical replication apply worker for subscription \"%s\" will "
+						"restart because the streaming option was changed",
+						MySubscription->name)));
+
+		proc_exit(0);
+	}
+
+	/* Same for the binary option. */
+	if (newsub->binary != MySubscription->binary)
+	{
+		ereport(LOG,
+				(errmsg("logical replication apply worker for subscription \"%s\" will "
+						"restart because the binary option was changed",
+						MySubscription->name)));
+
+		proc_exit(0);
+	}
+
 	/* Check for other changes that should never happen too. */
 	if (newsub->dbid != MySubscription->dbid)
 	{
@@ -1484,19 +2161,14 @@ logicalrep_worker_sighup(SIGNAL_ARGS)
 	errno = save_errno;
 }
 
-/* Logical Replication Apply worker entry point */
+/*
+ * Common initialization for the apply worker, tablesync workers and parallel
+ * workers, once attached to their slot.
+ */
 void
-ApplyWorkerMain(Datum main_arg)
+InitializeApplyWorker(void)
 {
-	int			worker_slot = DatumGetInt32(main_arg);
 	MemoryContext oldctx;
-	char		originname[NAMEDATALEN];
-	XLogRecPtr	origin_startpos;
-	char	   *myslotname;
-	WalRcvStreamOptions options;
-
-	/* Attach to slot */
-	logicalrep_worker_attach(worker_slot);
 
 	/* Setup signal handling */
 	pqsignal(SIGHUP, logicalrep_worker_sighup);
@@ -1551,16 +2223,41 @@ ApplyWorkerMain(Datum main_arg)
 								  subscription_change_cb,
 								  (Datum) 0);
 
-	if (am_tablesync_worker())
+	if (am_parallel_sync_worker())
+		ereport(LOG,
+				(errmsg("logical replication parallel table synchronization worker for subscription \"%s\", table \"%s\" has started",
+						MySubscription->name, get_rel_name(MyLogicalRepWorker->relid))));
+	else if (am_tablesync_worker())
 		ereport(LOG,
 				(errmsg("logical replication table synchronization worker for subscription \"%s\", table \"%s\" has started",
 						MySubscription->name, get_rel_name(MyLogicalRepWorker->relid))));
+	else if (am_parallel_apply_worker())
+		ereport(LOG,
+				(errmsg("logical replication parallel apply worker for subscription \"%s\" has started",
+						MySubscription->name)));
 	else
 		ereport(LOG,
 				(errmsg("logical replication apply worker for subscription \"%s\" has started",
 						MySubscription->name)));
 
 	CommitTransactionCommand();
+}
+
+/* Logical Replication Apply worker entry point */
+void
+ApplyWorkerMain(Datum main_arg)
+{
+	int			worker_slot = DatumGetInt32(main_arg);
+	MemoryContext oldctx;
+	char		originname[NAMEDATALEN];
+	XLogRecPtr	origin_startpos;
+	char	   *myslotname;
+	WalRcvStreamOptions options;
+
+	/* Attach to slot */
+	logicalrep_worker_attach(worker_slot);
+
+	InitializeApplyWorker();
 
 	/* Connect to the origin and start the replication. */
 	elog(DEBUG1, "connecting to publisher using connection string \"%s\"",
@@ -1605,7 +2302,7 @@ ApplyWorkerMain(Datum main_arg)
 		originid = replorigin_by_name(originname, true);
 		if (!OidIsValid(originid))
 			originid = replorigin_create(originname);
-		replorigin_session_setup(originid);
+		replorigin_session_setup(originid, 0);
 		replorigin_session_origin = originid;
 		origin_startpos = replorigin_session_get_progress(false);
 		CommitTransactionCommand();
@@ -1637,8 +2334,18 @@ ApplyWorkerMain(Datum main_arg)
 	options.logical = true;
 	options.startpoint = origin_startpos;
 	options.slotname = myslotname;
-	options.proto.logical.proto_version = LOGICALREP_PROTO_VERSION_NUM;
 	options.proto.logical.publication_names = MySubscription->publications;
+	options.proto.logical.streaming = MySubscription->stream;
+	options.proto.logical.binary = MySubscription->binary;
+
+	/*
+	 * Only ask for the newer protocol version if streaming needs it, so that
+	 * we can still subscribe to older publishers.
+	 */
+	if (MySubscription->stream)
+		options.proto.logical.proto_version = LOGICALREP_PROTO_STREAM_VERSION_NUM;
+	else
+		options.proto.logical.proto_version = LOGICALREP_PROTO_MIN_VERSION_NUM;
 
 	/* Start normal logical streaming replication. */
 	walrcv_startstreaming(wrconn, &options);
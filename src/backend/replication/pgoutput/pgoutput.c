@@ -12,13 +12,25 @@
  */
 #include "postgres.h"
 
+#include "access/htup_details.h"
+#include "access/sysattr.h"
+
 #include "catalog/pg_publication.h"
+#include "catalog/pg_publication_rel.h"
+
+#include "executor/executor.h"
+
+#include "nodes/makefuncs.h"
+
+#include "optimizer/planner.h"
+#include "optimizer/var.h"
 
 #include "replication/logical.h"
 #include "replication/logicalproto.h"
 #include "replication/origin.h"
 #include "replication/pgoutput.h"
 
+#include "utils/builtins.h"
 #include "utils/inval.h"
 #include "utils/int8.h"
 #include "utils/memutils.h"
@@ -27,6 +39,10 @@
 
 PG_MODULE_MAGIC;
 
+/* xid of the toplevel transaction a (sub)transaction belongs to */
+#define toplevel_xid(txn) \
+	((txn)->toptxn != NULL ? (txn)->toptxn->xid : (txn)->xid)
+
 extern void _PG_output_plugin_init(OutputPluginCallbacks *cb);
 
 static void pgoutput_startup(LogicalDecodingContext *ctx,
@@ -41,30 +57,84 @@ static void pgoutput_change(LogicalDecodingContext *ctx,
 				ReorderBufferChange *change);
 static bool pgoutput_origin_filter(LogicalDecodingContext *ctx,
 					   RepOriginId origin_id);
+static void pgoutput_stream_start(struct LogicalDecodingContext *ctx,
+					  ReorderBufferTXN *txn);
+static void pgoutput_stream_stop(struct LogicalDecodingContext *ctx,
+					 ReorderBufferTXN *txn);
+static void pgoutput_stream_abort(struct LogicalDecodingContext *ctx,
+					  ReorderBufferTXN *txn,
+					  XLogRecPtr abort_lsn);
+static void pgoutput_stream_commit(struct LogicalDecodingContext *ctx,
+					   ReorderBufferTXN *txn,
+					   XLogRecPtr commit_lsn);
 
 static bool publications_valid;
+static bool in_streaming;
 
 static List *LoadPublications(List *pubnames);
 static void publication_invalidation_cb(Datum arg, int cacheid,
 							uint32 hashvalue);
 
-/* Entry in the map used to remember which relation schemas we sent. */
+/*
+ * Entry in the map used to remember which relation schemas we sent.
+ *
+ * A schema sent as part of a streamed transaction only reaches the
+ * subscriber if that transaction commits, so for those we remember the
+ * toplevel xids in streamed_txns instead, and set schema_sent when one of
+ * them commits.
+ *
+ * The entry also caches the row filter and the published columns combined
+ * from all the subscribed publications the relation is in.  The filter is
+ * evaluated in a slot of its own, and everything needed for that lives in
+ * filter_cxt, which is rebuilt together with the publication info.
+ */
 typedef struct RelationSyncEntry
 {
 	Oid			relid;			/* relation oid */
 	bool		schema_sent;	/* did we send the schema? */
+	List	   *streamed_txns;	/* streamed toplevel transactions with this
+								 * schema */
 	bool		replicate_valid;
 	PublicationActions pubactions;
+
+	MemoryContext filter_cxt;	/* holds everything below, or NULL */
+	ExprState  *qual;			/* row filter, or NULL to publish all rows */
+	Bitmapset  *qual_attrs;		/* columns used by the row filter */
+	Bitmapset  *key_attrs;		/* replica identity columns, or NULL for
+								 * REPLICA IDENTITY FULL */
+	Bitmapset  *columns;		/* published columns, or NULL for all */
+	TupleTableSlot *slot;		/* slot to evaluate the row filter in */
+	ExprContext *econtext;
 } RelationSyncEntry;
 
+/* Result of checking a row against a row filter */
+typedef enum RowFilterResult
+{
+	ROW_FILTER_FAIL,			/* row doesn't satisfy the filter */
+	ROW_FILTER_PASS,			/* row satisfies the filter */
+	ROW_FILTER_UNKNOWN			/* filter can't be evaluated on the row */
+} RowFilterResult;
+
 /* Map used to remember which relation schemas we sent. */
 static HTAB *RelationSyncCache = NULL;
 
 static void init_rel_sync_cache(MemoryContext decoding_context);
-static RelationSyncEntry *get_rel_sync_entry(PGOutputData *data, Oid relid);
+static RelationSyncEntry *get_rel_sync_entry(PGOutputData *data,
+				   Relation relation);
+static void build_rel_sync_filter(PGOutputData *data, RelationSyncEntry *entry,
+					  Relation relation, List *pubids);
+static RowFilterResult pgoutput_row_filter(RelationSyncEntry *entry,
+					HeapTuple tuple, bool key_only);
+static bool pgoutput_row_filter_change(RelationSyncEntry *entry,
+						   enum ReorderBufferChangeType *action,
+						   HeapTuple *oldtuple, HeapTuple *newtuple,
+						   TupleDesc desc);
+static HeapTuple fill_unchanged_toast(HeapTuple newtuple, HeapTuple oldtuple,
+					 TupleDesc desc);
 static void rel_sync_cache_relation_cb(Datum arg, Oid relid);
 static void rel_sync_cache_publication_cb(Datum arg, int cacheid,
 							  uint32 hashvalue);
+static void cleanup_rel_sync_cache(TransactionId xid, bool is_commit);
 
 /*
  * Specify output plugin callbacks
@@ -80,15 +150,25 @@ _PG_output_plugin_init(OutputPluginCallbacks *cb)
 	cb->commit_cb = pgoutput_commit_txn;
 	cb->filter_by_origin_cb = pgoutput_origin_filter;
 	cb->shutdown_cb = pgoutput_shutdown;
+
+	/* transaction streaming */
+	cb->stream_start_cb = pgoutput_stream_start;
+	cb->stream_stop_cb = pgoutput_stream_stop;
+	cb->stream_abort_cb = pgoutput_stream_abort;
+	cb->stream_commit_cb = pgoutput_stream_commit;
+	cb->stream_change_cb = pgoutput_change;
 }
 
 static void
 parse_output_parameters(List *options, uint32 *protocol_version,
-						List **publication_names)
+						List **publication_names, bool *enable_streaming,
+						bool *binary)
 {
 	ListCell   *lc;
 	bool		protocol_version_given = false;
 	bool		publication_names_given = false;
+	bool		streaming_given = false;
+	bool		binary_given = false;
 
 	foreach(lc, options)
 	{
@@ -134,6 +214,34 @@ parse_output_parameters(List *options, uint32 *protocol_version,
 						(errcode(ERRCODE_INVALID_NAME),
 						 errmsg("invalid publication_names syntax")));
 		}
+		else if (strcmp(defel->defname, "streaming") == 0)
+		{
+			if (streaming_given)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			streaming_given = true;
+
+			if (!parse_bool(strVal(defel->arg), enable_streaming))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid streaming value \"%s\"",
+								strVal(defel->arg))));
+		}
+		else if (strcmp(defel->defname, "binary") == 0)
+		{
+			if (binary_given)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			binary_given = true;
+
+			if (!parse_bool(strVal(defel->arg), binary))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid binary value \"%s\"",
+								strVal(defel->arg))));
+		}
 		else
 			elog(ERROR, "unrecognized pgoutput option: %s", defel->defname);
 	}
@@ -170,7 +278,9 @@ pgoutput_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt,
 		/* Parse the params and ERROR if we see any we don't recognize */
 		parse_output_parameters(ctx->output_plugin_options,
 								&data->protocol_version,
-								&data->publication_names);
+								&data->publication_names,
+								&data->streaming,
+								&data->binary);
 
 		/* Check if we support requested protocol */
 		if (data->protocol_version > LOGICALREP_PROTO_VERSION_NUM)
@@ -190,6 +300,19 @@ pgoutput_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt,
 					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 					 errmsg("publication_names parameter missing")));
 
+		/*
+		 * Streaming of in-progress transactions needs both the client to
+		 * ask for it and a protocol version that can express it.
+		 */
+		if (data->streaming &&
+			data->protocol_version < LOGICALREP_PROTO_STREAM_VERSION_NUM)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("requested proto_version=%d does not support streaming, need %d or higher",
+							data->protocol_version, LOGICALREP_PROTO_STREAM_VERSION_NUM)));
+
+		ctx->streaming &= data->streaming;
+
 		/* Init publication state. */
 		data->publications = NIL;
 		publications_valid = false;
@@ -200,6 +323,11 @@ pgoutput_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt,
 		/* Initialize relation schema cache. */
 		init_rel_sync_cache(CacheMemoryContext);
 	}
+	else
+	{
+		/* Nothing is streamed while creating the slot. */
+		ctx->streaming = false;
+	}
 }
 
 /*
@@ -262,8 +390,21 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 	PGOutputData *data = (PGOutputData *) ctx->output_plugin_private;
 	MemoryContext old;
 	RelationSyncEntry *relentry;
+	TransactionId xid = InvalidTransactionId;
+	bool		schema_sent;
+	enum ReorderBufferChangeType action = change->action;
+	HeapTuple	oldtuple;
+	HeapTuple	newtuple;
+
+	/*
+	 * Changes of a streamed transaction are tagged with the xid of the
+	 * (sub)transaction that made them, so that the subscriber can discard
+	 * them if the subtransaction aborts.
+	 */
+	if (in_streaming)
+		xid = change->txn->xid;
 
-	relentry = get_rel_sync_entry(data, RelationGetRelid(relation));
+	relentry = get_rel_sync_entry(data, relation);
 
 	/* First check the table filter */
 	switch (change->action)
@@ -287,10 +428,33 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 	/* Avoid leaking memory by using and resetting our own context */
 	old = MemoryContextSwitchTo(data->context);
 
+	oldtuple = change->data.tp.oldtuple ?
+		&change->data.tp.oldtuple->tuple : NULL;
+	newtuple = change->data.tp.newtuple ?
+		&change->data.tp.newtuple->tuple : NULL;
+
+	/* Then the row filter, which may turn an UPDATE into another action */
+	if (relentry->qual != NULL &&
+		!pgoutput_row_filter_change(relentry, &action, &oldtuple, &newtuple,
+									RelationGetDescr(relation)))
+	{
+		MemoryContextSwitchTo(old);
+		MemoryContextReset(data->context);
+		return;
+	}
+
 	/*
 	 * Write the relation schema if the current schema haven't been sent yet.
+	 * Within a streamed transaction that also means it hasn't been sent as
+	 * part of the same transaction.
 	 */
-	if (!relentry->schema_sent)
+	if (in_streaming)
+		schema_sent = relentry->schema_sent ||
+			list_member_int(relentry->streamed_txns, (int) toplevel_xid(txn));
+	else
+		schema_sent = relentry->schema_sent;
+
+	if (!schema_sent)
 	{
 		TupleDesc	desc;
 		int			i;
@@ -308,46 +472,55 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 			if (att->attisdropped)
 				continue;
 
+			if (relentry->columns != NULL &&
+				!bms_is_member(att->attnum, relentry->columns))
+				continue;
+
 			if (att->atttypid < FirstNormalObjectId)
 				continue;
 
 			OutputPluginPrepareWrite(ctx, false);
-			logicalrep_write_typ(ctx->out, att->atttypid);
+			logicalrep_write_typ(ctx->out, xid, att->atttypid);
 			OutputPluginWrite(ctx, false);
 		}
 
 		OutputPluginPrepareWrite(ctx, false);
-		logicalrep_write_rel(ctx->out, relation);
+		logicalrep_write_rel(ctx->out, xid, relation, relentry->columns);
 		OutputPluginWrite(ctx, false);
-		relentry->schema_sent = true;
+
+		if (in_streaming)
+		{
+			MemoryContext oldctx = MemoryContextSwitchTo(CacheMemoryContext);
+
+			relentry->streamed_txns = lappend_int(relentry->streamed_txns,
+												  (int) toplevel_xid(txn));
+			MemoryContextSwitchTo(oldctx);
+		}
+		else
+			relentry->schema_sent = true;
 	}
 
 	/* Send the data */
-	switch (change->action)
+	switch (action)
 	{
 		case REORDER_BUFFER_CHANGE_INSERT:
 			OutputPluginPrepareWrite(ctx, true);
-			logicalrep_write_insert(ctx->out, relation,
-									&change->data.tp.newtuple->tuple);
+			logicalrep_write_insert(ctx->out, xid, relation, newtuple,
+									data->binary, relentry->columns);
 			OutputPluginWrite(ctx, true);
 			break;
 		case REORDER_BUFFER_CHANGE_UPDATE:
-			{
-				HeapTuple	oldtuple = change->data.tp.oldtuple ?
-				&change->data.tp.oldtuple->tuple : NULL;
-
-				OutputPluginPrepareWrite(ctx, true);
-				logicalrep_write_update(ctx->out, relation, oldtuple,
-										&change->data.tp.newtuple->tuple);
-				OutputPluginWrite(ctx, true);
-				break;
-			}
+			OutputPluginPrepareWrite(ctx, true);
+			logicalrep_write_update(ctx->out, xid, relation, oldtuple,
+									newtuple, data->binary, relentry->columns);
+			OutputPluginWrite(ctx, true);
+			break;
 		case REORDER_BUFFER_CHANGE_DELETE:
-			if (change->data.tp.oldtuple)
+			if (oldtuple)
 			{
 				OutputPluginPrepareWrite(ctx, true);
-				logicalrep_write_delete(ctx->out, relation,
-										&change->data.tp.oldtuple->tuple);
+				logicalrep_write_delete(ctx->out, xid, relation, oldtuple,
+										data->binary, relentry->columns);
 				OutputPluginWrite(ctx, true);
 			}
 			else
@@ -372,6 +545,107 @@ pgoutput_origin_filter(LogicalDecodingContext *ctx,
 	return false;
 }
 
+/*
+ * START STREAM callback
+ */
+static void
+pgoutput_stream_start(struct LogicalDecodingContext *ctx,
+					  ReorderBufferTXN *txn)
+{
+	bool		send_replication_origin = txn->origin_id != InvalidRepOriginId;
+
+	/* we can't nest streaming of transactions */
+	Assert(!in_streaming);
+
+	/* the origin is only sent with the first block of the transaction */
+	if (txn->streamed)
+		send_replication_origin = false;
+
+	OutputPluginPrepareWrite(ctx, !send_replication_origin);
+	logicalrep_write_stream_start(ctx->out, txn->xid, !txn->streamed);
+
+	if (send_replication_origin)
+	{
+		char	   *origin;
+
+		/* Message boundary */
+		OutputPluginWrite(ctx, false);
+		OutputPluginPrepareWrite(ctx, true);
+
+		if (replorigin_by_oid(txn->origin_id, true, &origin))
+			logicalrep_write_origin(ctx->out, origin, InvalidXLogRecPtr);
+	}
+
+	OutputPluginWrite(ctx, true);
+
+	in_streaming = true;
+}
+
+/*
+ * STOP STREAM callback
+ */
+static void
+pgoutput_stream_stop(struct LogicalDecodingContext *ctx,
+					 ReorderBufferTXN *txn)
+{
+	/* we should be streaming a transaction */
+	Assert(in_streaming);
+
+	OutputPluginPrepareWrite(ctx, true);
+	logicalrep_write_stream_stop(ctx->out);
+	OutputPluginWrite(ctx, true);
+
+	in_streaming = false;
+}
+
+/*
+ * Notify the subscriber that a streamed (sub)transaction aborted, so that it
+ * throws away the changes it got for it.
+ */
+static void
+pgoutput_stream_abort(struct LogicalDecodingContext *ctx,
+					  ReorderBufferTXN *txn,
+					  XLogRecPtr abort_lsn)
+{
+	TransactionId xid = toplevel_xid(txn);
+
+	/* aborts are sent between streamed blocks, never inside one */
+	Assert(!in_streaming);
+
+	OutputPluginPrepareWrite(ctx, true);
+	logicalrep_write_stream_abort(ctx->out, xid, txn->xid);
+	OutputPluginWrite(ctx, true);
+
+	/*
+	 * The aborted subtransaction may have carried some of the schemas sent
+	 * for this transaction; we don't track which, so simply send them again
+	 * if needed.
+	 */
+	cleanup_rel_sync_cache(xid, false);
+}
+
+/*
+ * Notify the subscriber that a streamed transaction committed, so that it
+ * applies the changes it got for it.
+ */
+static void
+pgoutput_stream_commit(struct LogicalDecodingContext *ctx,
+					   ReorderBufferTXN *txn,
+					   XLogRecPtr commit_lsn)
+{
+	/* the remaining changes have been streamed already */
+	Assert(!in_streaming);
+	Assert(txn->streamed);
+
+	OutputPluginUpdateProgress(ctx);
+
+	OutputPluginPrepareWrite(ctx, true);
+	logicalrep_write_stream_commit(ctx->out, txn, commit_lsn);
+	OutputPluginWrite(ctx, true);
+
+	cleanup_rel_sync_cache(txn->xid, true);
+}
+
 /*
  * Shutdown the output plugin.
  *
@@ -383,6 +657,16 @@ pgoutput_shutdown(LogicalDecodingContext *ctx)
 {
 	if (RelationSyncCache)
 	{
+		HASH_SEQ_STATUS status;
+		RelationSyncEntry *entry;
+
+		hash_seq_init(&status, RelationSyncCache);
+		while ((entry = (RelationSyncEntry *) hash_seq_search(&status)) != NULL)
+		{
+			if (entry->filter_cxt)
+				MemoryContextDelete(entry->filter_cxt);
+		}
+
 		hash_destroy(RelationSyncCache);
 		RelationSyncCache = NULL;
 	}
@@ -463,8 +747,9 @@ init_rel_sync_cache(MemoryContext cachectx)
  * Find or create entry in the relation schema cache.
  */
 static RelationSyncEntry *
-get_rel_sync_entry(PGOutputData *data, Oid relid)
+get_rel_sync_entry(PGOutputData *data, Relation relation)
 {
+	Oid			relid = RelationGetRelid(relation);
 	RelationSyncEntry *entry;
 	bool		found;
 	MemoryContext oldctx;
@@ -479,6 +764,9 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 	MemoryContextSwitchTo(oldctx);
 	Assert(entry != NULL);
 
+	if (!found)
+		entry->filter_cxt = NULL;
+
 	/* Not found means schema wasn't sent */
 	if (!found || !entry->replicate_valid)
 	{
@@ -521,17 +809,354 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 				break;
 		}
 
+		build_rel_sync_filter(data, entry, relation, pubids);
+
 		list_free(pubids);
 
 		entry->replicate_valid = true;
 	}
 
 	if (!found)
+	{
 		entry->schema_sent = false;
+		entry->streamed_txns = NIL;
+	}
 
 	return entry;
 }
 
+/*
+ * Build the row filter and the set of published columns of a relation sync
+ * entry from the subscribed publications.
+ *
+ * Publications are combined like their actions are: a row is published if it
+ * passes the filter of any of them, and so is a column if any of them lists
+ * it, so a publication without a filter or column list (including a FOR ALL
+ * TABLES one) publishes everything.  The replica identity columns are always
+ * published, as the subscriber can't apply an UPDATE or DELETE without them.
+ */
+static void
+build_rel_sync_filter(PGOutputData *data, RelationSyncEntry *entry,
+					  Relation relation, List *pubids)
+{
+	Oid			relid = RelationGetRelid(relation);
+	List	   *quals = NIL;
+	bool		all_rows = false;
+	bool		all_columns = false;
+	Bitmapset  *columns = NULL;
+	ListCell   *lc;
+	MemoryContext oldctx;
+
+	if (entry->filter_cxt)
+		MemoryContextDelete(entry->filter_cxt);
+	entry->filter_cxt = NULL;
+	entry->qual = NULL;
+	entry->qual_attrs = NULL;
+	entry->key_attrs = NULL;
+	entry->columns = NULL;
+	entry->slot = NULL;
+	entry->econtext = NULL;
+
+	foreach(lc, data->publications)
+	{
+		Publication *pub = lfirst(lc);
+		HeapTuple	tup;
+		Datum		datum;
+		bool		isnull;
+
+		if (pub->alltables)
+		{
+			all_rows = all_columns = true;
+			break;
+		}
+
+		if (!list_member_oid(pubids, pub->oid))
+			continue;
+
+		tup = SearchSysCache2(PUBLICATIONRELMAP, ObjectIdGetDatum(relid),
+							  ObjectIdGetDatum(pub->oid));
+		if (!HeapTupleIsValid(tup))
+			elog(ERROR, "cache lookup failed for relation %u in publication %u",
+				 relid, pub->oid);
+
+		datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+								Anum_pg_publication_rel_prqual, &isnull);
+		if (isnull)
+			all_rows = true;
+		else if (!all_rows)
+			quals = lappend(quals, stringToNode(TextDatumGetCString(datum)));
+
+		datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+								Anum_pg_publication_rel_prattrs, &isnull);
+		if (isnull)
+			all_columns = true;
+		else if (!all_columns)
+		{
+			int2vector *attrs = (int2vector *) DatumGetPointer(datum);
+			int			i;
+
+			for (i = 0; i < attrs->dim1; i++)
+				columns = bms_add_member(columns, attrs->values[i]);
+		}
+
+		ReleaseSysCache(tup);
+
+		if (all_rows && all_columns)
+			break;
+	}
+
+	if ((all_rows || quals == NIL) && (all_columns || columns == NULL))
+		return;
+
+	entry->filter_cxt = AllocSetContextCreate(CacheMemoryContext,
+											  "logical replication row filter",
+											  ALLOCSET_SMALL_SIZES);
+	oldctx = MemoryContextSwitchTo(entry->filter_cxt);
+
+	/* Replica identity columns, by attribute number */
+	if (relation->rd_rel->relreplident != REPLICA_IDENTITY_FULL)
+	{
+		Bitmapset  *idattrs;
+		int			attnum = -1;
+
+		idattrs = RelationGetIndexAttrBitmap(relation,
+											 INDEX_ATTR_BITMAP_IDENTITY_KEY);
+		while ((attnum = bms_next_member(idattrs, attnum)) >= 0)
+			entry->key_attrs =
+				bms_add_member(entry->key_attrs,
+							   attnum + FirstLowInvalidHeapAttributeNumber);
+		bms_free(idattrs);
+	}
+
+	if (!all_columns && columns != NULL)
+	{
+		/* REPLICA IDENTITY FULL sends the whole old row as the key. */
+		if (relation->rd_rel->relreplident != REPLICA_IDENTITY_FULL)
+			entry->columns = bms_union(columns, entry->key_attrs);
+	}
+
+	if (!all_rows && quals != NIL)
+	{
+		Expr	   *qual;
+		int			attnum = -1;
+		Bitmapset  *attrs = NULL;
+		TupleDesc	desc;
+
+		if (list_length(quals) == 1)
+			qual = (Expr *) linitial(quals);
+		else
+			qual = makeBoolExpr(OR_EXPR, quals, -1);
+
+		pull_varattnos((Node *) qual, 1, &attrs);
+		while ((attnum = bms_next_member(attrs, attnum)) >= 0)
+			entry->qual_attrs =
+				bms_add_member(entry->qual_attrs,
+							   attnum + FirstLowInvalidHeapAttributeNumber);
+
+		qual = expression_planner(qual);
+		entry->qual = ExecInitQual(list_make1(qual), NULL);
+
+		/* Use a copy of the descriptor to not pin the relcache's one. */
+		desc = CreateTupleDescCopy(RelationGetDescr(relation));
+		entry->slot = MakeSingleTupleTableSlot(desc);
+		entry->econtext = CreateStandaloneExprContext();
+		entry->econtext->ecxt_scantuple = entry->slot;
+	}
+
+	MemoryContextSwitchTo(oldctx);
+}
+
+/*
+ * Check whether a row passes the row filter of a relation sync entry.
+ *
+ * If key_only is true, tuple is an old key, which only has the replica
+ * identity columns unless that is FULL.  The filter can't be evaluated if it
+ * uses columns that the key doesn't have or unchanged TOASTed values, which
+ * decoding doesn't see.
+ */
+static RowFilterResult
+pgoutput_row_filter(RelationSyncEntry *entry, HeapTuple tuple, bool key_only)
+{
+	TupleTableSlot *slot = entry->slot;
+	int			attnum = -1;
+	bool		result;
+
+	if (key_only && entry->key_attrs != NULL &&
+		!bms_is_subset(entry->qual_attrs, entry->key_attrs))
+		return ROW_FILTER_UNKNOWN;
+
+	ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+
+	while ((attnum = bms_next_member(entry->qual_attrs, attnum)) >= 0)
+	{
+		Form_pg_attribute att = TupleDescAttr(slot->tts_tupleDescriptor,
+											  attnum - 1);
+		bool		isnull;
+		Datum		value;
+
+		if (att->attlen != -1)
+			continue;
+
+		value = slot_getattr(slot, attnum, &isnull);
+		if (!isnull && VARATT_IS_EXTERNAL_ONDISK(value))
+		{
+			ExecClearTuple(slot);
+			return ROW_FILTER_UNKNOWN;
+		}
+	}
+
+	result = ExecQual(entry->qual, entry->econtext);
+
+	ResetExprContext(entry->econtext);
+	ExecClearTuple(slot);
+
+	return result ? ROW_FILTER_PASS : ROW_FILTER_FAIL;
+}
+
+/*
+ * Apply the row filter of a relation sync entry to a change.  Returns false
+ * if the change is not to be published.
+ *
+ * An INSERT is published if the new row satisfies the filter, and a DELETE if
+ * the old row does.  An UPDATE is published as such if both the old and the
+ * new row satisfy it, as a DELETE of the old row if only that one does, and
+ * as an INSERT of the new row if only that one does, so that the subscriber
+ * keeps exactly the rows that satisfy the filter.  *action, *oldtuple and
+ * *newtuple are changed accordingly.
+ *
+ * Where the filter can't be evaluated on a row, we assume that it passes:
+ * an UPDATE or DELETE of a row that the subscriber doesn't have is ignored
+ * there, whereas a missing one would leave a row behind.
+ */
+static bool
+pgoutput_row_filter_change(RelationSyncEntry *entry,
+						   enum ReorderBufferChangeType *action,
+						   HeapTuple *oldtuple, HeapTuple *newtuple,
+						   TupleDesc desc)
+{
+	RowFilterResult old_result;
+	RowFilterResult new_result;
+
+	switch (*action)
+	{
+		case REORDER_BUFFER_CHANGE_INSERT:
+			return (pgoutput_row_filter(entry, *newtuple, false) !=
+					ROW_FILTER_FAIL);
+		case REORDER_BUFFER_CHANGE_UPDATE:
+			break;
+		case REORDER_BUFFER_CHANGE_DELETE:
+			if (*oldtuple == NULL)
+				return true;
+			return (pgoutput_row_filter(entry, *oldtuple, true) !=
+					ROW_FILTER_FAIL);
+		default:
+			Assert(false);
+			return true;
+	}
+
+	/*
+	 * With REPLICA IDENTITY FULL, the old row is logged with its TOASTed
+	 * values inline, so we can fill in those the update left unchanged,
+	 * which the new row lacks.  That lets us check the filter on them, and
+	 * send the new row as an INSERT.
+	 */
+	if (*oldtuple != NULL && entry->key_attrs == NULL &&
+		HeapTupleHasExternal(*newtuple))
+		*newtuple = fill_unchanged_toast(*newtuple, *oldtuple, desc);
+
+	new_result = pgoutput_row_filter(entry, *newtuple, false);
+
+	/*
+	 * The old row is only logged if it's FULL or the key changed.  Otherwise
+	 * it has the new row's key, so we know how it fared only if the filter
+	 * just uses key columns.
+	 */
+	if (*oldtuple != NULL)
+		old_result = pgoutput_row_filter(entry, *oldtuple, true);
+	else if (entry->key_attrs != NULL &&
+			 bms_is_subset(entry->qual_attrs, entry->key_attrs))
+		old_result = new_result;
+	else
+		old_result = ROW_FILTER_UNKNOWN;
+
+	if (new_result == ROW_FILTER_FAIL)
+	{
+		if (old_result == ROW_FILTER_FAIL)
+			return false;
+
+		/* The row leaves the filter; the new row still has the old key */
+		*action = REORDER_BUFFER_CHANGE_DELETE;
+		if (*oldtuple == NULL)
+			*oldtuple = *newtuple;
+	}
+	else if (new_result == ROW_FILTER_PASS &&
+			 old_result == ROW_FILTER_FAIL &&
+			 !HeapTupleHasExternal(*newtuple))
+	{
+		/* The row enters the filter */
+		*action = REORDER_BUFFER_CHANGE_INSERT;
+		*oldtuple = NULL;
+	}
+
+	return true;
+}
+
+/*
+ * Form a copy of the new row of an UPDATE with the unchanged TOASTed values
+ * taken from the old row, which must be complete.
+ */
+static HeapTuple
+fill_unchanged_toast(HeapTuple newtuple, HeapTuple oldtuple, TupleDesc desc)
+{
+	Datum	   *values = (Datum *) palloc(desc->natts * sizeof(Datum));
+	bool	   *isnull = (bool *) palloc(desc->natts * sizeof(bool));
+	Datum	   *oldvalues = (Datum *) palloc(desc->natts * sizeof(Datum));
+	bool	   *oldisnull = (bool *) palloc(desc->natts * sizeof(bool));
+	int			i;
+
+	heap_deform_tuple(newtuple, desc, values, isnull);
+	heap_deform_tuple(oldtuple, desc, oldvalues, oldisnull);
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		if (TupleDescAttr(desc, i)->attlen == -1 && !isnull[i] &&
+			VARATT_IS_EXTERNAL_ONDISK(values[i]))
+		{
+			values[i] = oldvalues[i];
+			isnull[i] = oldisnull[i];
+		}
+	}
+
+	return heap_form_tuple(desc, values, isnull);
+}
+
+/*
+ * Forget a streamed toplevel transaction once the subscriber knows whether
+ * it committed. If it did, the schemas sent as part of it are now known to
+ * the subscriber.
+ */
+static void
+cleanup_rel_sync_cache(TransactionId xid, bool is_commit)
+{
+	HASH_SEQ_STATUS hash_seq;
+	RelationSyncEntry *entry;
+
+	Assert(RelationSyncCache != NULL);
+
+	hash_seq_init(&hash_seq, RelationSyncCache);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		if (!list_member_int(entry->streamed_txns, (int) xid))
+			continue;
+
+		if (is_commit)
+			entry->schema_sent = true;
+
+		entry->streamed_txns = list_delete_int(entry->streamed_txns,
+											   (int) xid);
+	}
+}
+
 /*
  * Relcache invalidation callback
  */
@@ -564,10 +1189,16 @@ rel_sync_cache_relation_cb(Datum arg, Oid relid)
 											  HASH_FIND, NULL);
 
 	/*
-	 * Reset schema sent status as the relation definition may have changed.
+	 * Reset schema sent status as the relation definition may have changed,
+	 * and with it the row filter and the published columns.
 	 */
 	if (entry != NULL)
+	{
 		entry->schema_sent = false;
+		entry->replicate_valid = false;
+		list_free(entry->streamed_txns);
+		entry->streamed_txns = NIL;
+	}
 }
 
 /*
@@ -63,6 +63,9 @@ static SQLCmd *make_sqlcmd(void);
 
 /* Keyword tokens. */
 %token K_BASE_BACKUP
+%token K_START_BACKUP
+%token K_SEND_FILES
+%token K_STOP_BACKUP
 %token K_IDENTIFY_SYSTEM
 %token K_SHOW
 %token K_START_REPLICATION
@@ -75,6 +78,9 @@ static SQLCmd *make_sqlcmd(void);
 %token K_WAIT
 %token K_NOWAIT
 %token K_MAX_RATE
+%token K_COMPRESSION
+%token K_COMPRESSION_LEVEL
+%token K_INCREMENTAL
 %token K_WAL
 %token K_TABLESPACE_MAP
 %token K_TIMELINE
@@ -88,11 +94,15 @@ static SQLCmd *make_sqlcmd(void);
 %token K_USE_SNAPSHOT
 
 %type <node>	command
-%type <node>	base_backup start_replication start_logical_replication
+%type <node>	base_backup start_backup send_files stop_backup
+				start_replication start_logical_replication
 				create_replication_slot drop_replication_slot identify_system
 				timeline_history show sql_cmd
 %type <list>	base_backup_opt_list
 %type <defelt>	base_backup_opt
+%type <list>	backup_file_list
+%type <list>	compression_opt_list
+%type <defelt>	compression_opt
 %type <uintval>	opt_timeline
 %type <list>	plugin_options plugin_opt_list
 %type <defelt>	plugin_opt_elem
@@ -117,6 +127,9 @@ opt_semicolon:	';'
 command:
 			identify_system
 			| base_backup
+			| start_backup
+			| send_files
+			| stop_backup
 			| start_replication
 			| start_logical_replication
 			| create_replication_slot
@@ -154,7 +167,8 @@ var_name:	IDENT	{ $$ = $1; }
 
 /*
  * BASE_BACKUP [LABEL '<label>'] [PROGRESS] [FAST] [WAL] [NOWAIT]
- * [MAX_RATE %d] [TABLESPACE_MAP]
+ * [MAX_RATE %d] [TABLESPACE_MAP] [COMPRESSION '<method>']
+ * [COMPRESSION_LEVEL %d] [INCREMENTAL '<lsn>']
  */
 base_backup:
 			K_BASE_BACKUP base_backup_opt_list
@@ -165,6 +179,55 @@ base_backup:
 				}
 			;
 
+/*
+ * START_BACKUP [LABEL '<label>'] [PROGRESS] [FAST]
+ */
+start_backup:
+			K_START_BACKUP base_backup_opt_list
+				{
+					BaseBackupCmd *cmd = makeNode(BaseBackupCmd);
+					cmd->kind = BASE_BACKUP_KIND_START;
+					cmd->options = $2;
+					$$ = (Node *) cmd;
+				}
+			;
+
+/*
+ * SEND_FILES ('<path>' [, ...]) [MAX_RATE %d] [COMPRESSION '<method>']
+ * [COMPRESSION_LEVEL %d]
+ */
+send_files:
+			K_SEND_FILES '(' backup_file_list ')' base_backup_opt_list
+				{
+					BaseBackupCmd *cmd = makeNode(BaseBackupCmd);
+					cmd->kind = BASE_BACKUP_KIND_SEND_FILES;
+					cmd->files = $3;
+					cmd->options = $5;
+					$$ = (Node *) cmd;
+				}
+			;
+
+/*
+ * STOP_BACKUP [WAL] [NOWAIT] [MAX_RATE %d] [COMPRESSION '<method>']
+ * [COMPRESSION_LEVEL %d]
+ */
+stop_backup:
+			K_STOP_BACKUP base_backup_opt_list
+				{
+					BaseBackupCmd *cmd = makeNode(BaseBackupCmd);
+					cmd->kind = BASE_BACKUP_KIND_STOP;
+					cmd->options = $2;
+					$$ = (Node *) cmd;
+				}
+			;
+
+backup_file_list:
+			SCONST
+				{ $$ = list_make1($1); }
+			| backup_file_list ',' SCONST
+				{ $$ = lappend($1, $3); }
+			;
+
 base_backup_opt_list:
 			base_backup_opt_list base_backup_opt
 				{ $$ = lappend($1, $2); }
@@ -208,6 +271,32 @@ base_backup_opt:
 				  $$ = makeDefElem("tablespace_map",
 								   (Node *)makeInteger(TRUE), -1);
 				}
+			| K_INCREMENTAL SCONST
+				{
+				  $$ = makeDefElem("incremental",
+								   (Node *)makeString($2), -1);
+				}
+			| compression_opt
+			;
+
+compression_opt_list:
+			compression_opt_list compression_opt
+				{ $$ = lappend($1, $2); }
+			| /* EMPTY */
+				{ $$ = NIL; }
+			;
+
+compression_opt:
+			K_COMPRESSION SCONST
+				{
+				  $$ = makeDefElem("compression",
+								   (Node *)makeString($2), -1);
+				}
+			| K_COMPRESSION_LEVEL UCONST
+				{
+				  $$ = makeDefElem("compression_level",
+								   (Node *)makeInteger($2), -1);
+				}
 			;
 
 create_replication_slot:
@@ -288,9 +377,11 @@ drop_replication_slot:
 
 /*
  * START_REPLICATION [SLOT slot] [PHYSICAL] %X/%X [TIMELINE %d]
+ * [COMPRESSION '<method>'] [COMPRESSION_LEVEL %d]
  */
 start_replication:
 			K_START_REPLICATION opt_slot opt_physical RECPTR opt_timeline
+			compression_opt_list
 				{
 					StartReplicationCmd *cmd;
 
@@ -299,6 +390,7 @@ start_replication:
 					cmd->slotname = $2;
 					cmd->startpoint = $4;
 					cmd->timeline = $5;
+					cmd->options = $6;
 					$$ = (Node *) cmd;
 				}
 			;
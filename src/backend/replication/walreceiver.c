@@ -73,6 +73,8 @@
 /* GUC variables */
 int			wal_receiver_status_interval;
 int			wal_receiver_timeout;
+int			wal_receiver_compression = WIRE_COMPRESS_NONE;
+int			wal_receiver_compression_level = WIRE_COMPRESS_DEFAULT_LEVEL;
 bool		hot_standby_feedback;
 
 /* libpqwalreceiver connection */
@@ -379,6 +381,9 @@ WalReceiverMain(void)
 		options.startpoint = startpoint;
 		options.slotname = slotname[0] != '\0' ? slotname : NULL;
 		options.proto.physical.startpointTLI = startpointTLI;
+		options.proto.physical.compression = wal_receiver_compression;
+		options.proto.physical.compression_level =
+			wal_receiver_compression_level;
 		ThisTimeLineID = startpointTLI;
 		if (walrcv_startstreaming(wrconn, &options))
 		{
@@ -59,6 +59,7 @@
 #include "catalog/pg_type.h"
 #include "commands/dbcommands.h"
 #include "commands/defrem.h"
+#include "common/wire_compress.h"
 #include "funcapi.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -161,6 +162,9 @@ static StringInfoData output_message;
 static StringInfoData reply_message;
 static StringInfoData tmpbuf;
 
+/* Compressor for the CopyData messages of a physical stream, if requested */
+static WireCompressor *wal_compressor = NULL;
+
 /*
  * Timestamp of the last receipt of the reply from the standby. Set to 0 if
  * wal_sender_timeout doesn't need to be active.
@@ -234,6 +238,7 @@ static void IdentifySystem(void);
 static void CreateReplicationSlot(CreateReplicationSlotCmd *cmd);
 static void DropReplicationSlot(DropReplicationSlotCmd *cmd);
 static void StartReplication(StartReplicationCmd *cmd);
+static void WalSndPutCopyData(const char *data, int len);
 static void StartLogicalReplication(StartReplicationCmd *cmd);
 static void ProcessStandbyMessage(void);
 static void ProcessStandbyReplyMessage(void);
@@ -307,6 +312,9 @@ WalSndErrorCleanup(void)
 
 	replication_active = false;
 
+	/* The compressor went away with the replication command's memory */
+	wal_compressor = NULL;
+
 	if (got_STOPPING || got_SIGUSR2)
 		proc_exit(0);
 
@@ -524,12 +532,43 @@ StartReplication(StartReplicationCmd *cmd)
 {
 	StringInfoData buf;
 	XLogRecPtr	FlushPtr;
+	WireCompressMethod compression = WIRE_COMPRESS_NONE;
+	int			compression_level = WIRE_COMPRESS_DEFAULT_LEVEL;
+	bool		compression_given = false;
+	bool		compression_level_given = false;
+	ListCell   *lc;
 
 	if (ThisTimeLineID == 0)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("IDENTIFY_SYSTEM has not been run before START_REPLICATION")));
 
+	foreach(lc, cmd->options)
+	{
+		DefElem    *defel = (DefElem *) lfirst(lc);
+
+		if (strcmp(defel->defname, "compression") == 0)
+		{
+			if (compression_given)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			compression = ParseCompressionMethod(strVal(defel->arg));
+			compression_given = true;
+		}
+		else if (strcmp(defel->defname, "compression_level") == 0)
+		{
+			if (compression_level_given)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			compression_level = ParseCompressionLevel(intVal(defel->arg));
+			compression_level_given = true;
+		}
+		else
+			elog(ERROR, "unrecognized option: %s", defel->defname);
+	}
+
 	/*
 	 * We assume here that we're logging enough information in the WAL for
 	 * log-shipping, since this is checked in PostmasterMain().
@@ -667,6 +706,10 @@ StartReplication(StartReplicationCmd *cmd)
 		/* Start streaming from the requested point */
 		sentPtr = cmd->startpoint;
 
+		if (compression != WIRE_COMPRESS_NONE)
+			wal_compressor = CreateWireCompressor(compression,
+												  compression_level);
+
 		/* Initialize shared memory status, too */
 		SpinLockAcquire(&MyWalSnd->mutex);
 		MyWalSnd->sentPtr = sentPtr;
@@ -680,6 +723,11 @@ StartReplication(StartReplicationCmd *cmd)
 		WalSndLoop(XLogSendPhysical);
 
 		replication_active = false;
+		if (wal_compressor != NULL)
+		{
+			wire_compressor_free(wal_compressor);
+			wal_compressor = NULL;
+		}
 		if (got_STOPPING)
 			proc_exit(0);
 		WalSndSetState(WALSNDSTATE_STARTUP);
@@ -1503,9 +1551,13 @@ exec_replication_command(const char *cmd_string)
 			break;
 
 		case T_BaseBackupCmd:
-			PreventTransactionChain(true, "BASE_BACKUP");
-			SendBaseBackup((BaseBackupCmd *) cmd_node);
-			break;
+			{
+				BaseBackupCmd *cmd = (BaseBackupCmd *) cmd_node;
+
+				PreventTransactionChain(true, BaseBackupCommandName(cmd->kind));
+				SendBaseBackup(cmd);
+				break;
+			}
 
 		case T_CreateReplicationSlotCmd:
 			CreateReplicationSlot((CreateReplicationSlotCmd *) cmd_node);
@@ -2706,7 +2758,7 @@ XLogSendPhysical(void)
 	memcpy(&output_message.data[1 + sizeof(int64) + sizeof(int64)],
 		   tmpbuf.data, sizeof(int64));
 
-	pq_putmessage_noblock('d', output_message.data, output_message.len);
+	WalSndPutCopyData(output_message.data, output_message.len);
 
 	sentPtr = endptr;
 
@@ -3327,7 +3379,81 @@ WalSndKeepalive(bool requestReply)
 	pq_sendbyte(&output_message, requestReply ? 1 : 0);
 
 	/* ... and send it wrapped in CopyData */
-	pq_putmessage_noblock('d', output_message.data, output_message.len);
+	WalSndPutCopyData(output_message.data, output_message.len);
+}
+
+/*
+ * Send a message of the physical stream wrapped in CopyData, compressing it
+ * first if the standby asked for that.
+ */
+static void
+WalSndPutCopyData(const char *data, int len)
+{
+	if (wal_compressor != NULL)
+	{
+		char	   *cdata;
+
+		if (!wire_compress(wal_compressor, data, len, &cdata, &len))
+			ereport(ERROR,
+					(errmsg("could not compress WAL data")));
+		data = cdata;
+	}
+
+	pq_putmessage_noblock('d', data, len);
+}
+
+/*
+ * Look up a compression method requested by a replication command.
+ */
+WireCompressMethod
+ParseCompressionMethod(const char *name)
+{
+	WireCompressMethod method;
+
+	if (!wire_compress_parse_method(name, &method))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("unrecognized compression method \"%s\"", name)));
+	if (!wire_compress_supported(method))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("compression method \"%s\" is not supported by this build",
+						name)));
+
+	return method;
+}
+
+/*
+ * Check a compression level requested by a replication command.
+ */
+int
+ParseCompressionLevel(long level)
+{
+	if (level < 0 || level > WIRE_COMPRESS_MAX_LEVEL)
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("%d is outside the valid range for parameter \"%s\" (%d .. %d)",
+						(int) level, "COMPRESSION_LEVEL",
+						0, WIRE_COMPRESS_MAX_LEVEL)));
+
+	return (int) level;
+}
+
+/*
+ * Set up compression of a stream of CopyData messages.
+ */
+WireCompressor *
+CreateWireCompressor(WireCompressMethod method, int level)
+{
+	WireCompressor *state;
+
+	state = wire_compressor_create(method, level, false);
+	if (state == NULL)
+		ereport(ERROR,
+				(errmsg("could not initialize %s compression",
+						wire_compress_method_name(method))));
+
+	return state;
 }
 
 /*
@@ -0,0 +1,555 @@
+/*-------------------------------------------------------------------------
+ *
+ * walsummarizer.c
+ *	  Background worker that summarizes the blocks modified by the WAL.
+ *
+ * When summarize_wal is enabled, the WAL summarizer follows the WAL as it
+ * is flushed and records which blocks of which relations each record
+ * modifies.  The summary is written out whenever a checkpoint record is
+ * read, so a summary file normally covers the WAL between two checkpoints.
+ * Incremental base backups use the summaries to find the blocks modified
+ * since the prior backup; see basebackup.c.
+ *
+ * The WAL that has not been summarized yet is kept around like the WAL a
+ * replication slot needs, see KeepLogSeg().  Summaries are removed after
+ * wal_summary_keep_time.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/walsummarizer.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogreader.h"
+#include "access/xlogutils.h"
+#include "catalog/pg_control.h"
+#include "catalog/storage_xlog.h"
+#include "commands/dbcommands_xlog.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "replication/walsummarizer.h"
+#include "replication/walsummary.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+/* How long to sleep when there is no WAL to summarize (ms) */
+#define WALSUMMARIZER_NAPTIME		10000
+
+/*
+ * End a summary early if it holds this many block numbers, to bound the
+ * memory needed to build it.
+ */
+#define WALSUMMARY_MAX_BLOCKS		(16 * 1024 * 1024)
+
+typedef struct WalSummarizerCtlData
+{
+	slock_t		mutex;
+	Latch	   *latch;			/* the summarizer's latch, or NULL */
+	XLogRecPtr	summarized_lsn; /* the WAL before this has been summarized */
+} WalSummarizerCtlData;
+
+static WalSummarizerCtlData *WalSummarizerCtl = NULL;
+
+/* GUC variables */
+bool		summarize_wal = false;
+int			wal_summary_keep_time = 10 * 24 * 60;
+
+static volatile sig_atomic_t got_SIGHUP = false;
+
+static void walsummarizer_sighup(SIGNAL_ARGS);
+static void walsummarizer_onexit(int code, Datum arg);
+static XLogRecPtr GetLatestSummarizedLSN(void);
+static void SetSummarizedLSN(XLogRecPtr lsn);
+static void SummarizeRecord(XLogReaderState *xlogreader, BlockRefTable *brtab);
+
+/*
+ * Register the WAL summarizer background worker, if summarize_wal is
+ * enabled.
+ */
+void
+WalSummarizerRegister(void)
+{
+	BackgroundWorker bgw;
+
+	if (!summarize_wal)
+		return;
+
+	memset(&bgw, 0, sizeof(bgw));
+	bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "WalSummarizerMain");
+	snprintf(bgw.bgw_name, BGW_MAXLEN, "WAL summarizer");
+	bgw.bgw_restart_time = 5;
+	bgw.bgw_notify_pid = 0;
+	bgw.bgw_main_arg = (Datum) 0;
+
+	RegisterBackgroundWorker(&bgw);
+}
+
+Size
+WalSummarizerShmemSize(void)
+{
+	return sizeof(WalSummarizerCtlData);
+}
+
+void
+WalSummarizerShmemInit(void)
+{
+	bool		found;
+
+	WalSummarizerCtl = (WalSummarizerCtlData *)
+		ShmemInitStruct("WAL Summarizer Data", WalSummarizerShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		memset(WalSummarizerCtl, 0, WalSummarizerShmemSize());
+		SpinLockInit(&WalSummarizerCtl->mutex);
+
+		/*
+		 * Protect the WAL the summarizer will continue from, before the
+		 * checkpoint at the end of recovery gets a chance to remove it.
+		 */
+		if (summarize_wal)
+			WalSummarizerCtl->summarized_lsn = GetLatestSummarizedLSN();
+	}
+}
+
+/*
+ * Return the position up to which the WAL has been summarized, or
+ * InvalidXLogRecPtr if there is no summarizer.  The WAL from this position
+ * on must not be removed.
+ */
+XLogRecPtr
+GetOldestUnsummarizedLSN(void)
+{
+	XLogRecPtr	result;
+
+	if (!summarize_wal)
+		return InvalidXLogRecPtr;
+
+	SpinLockAcquire(&WalSummarizerCtl->mutex);
+	result = WalSummarizerCtl->summarized_lsn;
+	SpinLockRelease(&WalSummarizerCtl->mutex);
+
+	return result;
+}
+
+/*
+ * Wait until the WAL up to 'lsn' has been summarized.
+ */
+void
+WaitForWalSummarization(XLogRecPtr lsn)
+{
+	TimestampTz start = GetCurrentTimestamp();
+	bool		warned = false;
+
+	for (;;)
+	{
+		XLogRecPtr	summarized_lsn;
+		Latch	   *latch;
+
+		SpinLockAcquire(&WalSummarizerCtl->mutex);
+		summarized_lsn = WalSummarizerCtl->summarized_lsn;
+		latch = WalSummarizerCtl->latch;
+		SpinLockRelease(&WalSummarizerCtl->mutex);
+
+		if (summarized_lsn != InvalidXLogRecPtr && summarized_lsn >= lsn)
+			break;
+
+		/* Make sure the summarizer isn't sleeping */
+		if (latch != NULL)
+			SetLatch(latch);
+
+		if (!warned &&
+			TimestampDifferenceExceeds(start, GetCurrentTimestamp(), 60000))
+		{
+			ereport(WARNING,
+					(errmsg("still waiting for WAL to be summarized through %X/%X",
+							(uint32) (lsn >> 32), (uint32) lsn),
+					 errdetail("Summarization has reached %X/%X.",
+							   (uint32) (summarized_lsn >> 32),
+							   (uint32) summarized_lsn)));
+			warned = true;
+		}
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+						 100L, WAIT_EVENT_WAL_SUMMARY_READY);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Main entry point of the WAL summarizer.
+ */
+void
+WalSummarizerMain(Datum main_arg)
+{
+	MemoryContext summarizer_context;
+	XLogReaderState *xlogreader;
+	BlockRefTable *brtab;
+	XLogRecPtr	start_lsn;
+	XLogRecPtr	read_lsn;
+	XLogRecPtr	summary_start;
+	XLogSegNo	segno;
+	bool		first = true;
+	bool		skipping = false;
+
+	pqsignal(SIGHUP, walsummarizer_sighup);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	before_shmem_exit(walsummarizer_onexit, (Datum) 0);
+
+	SpinLockAcquire(&WalSummarizerCtl->mutex);
+	WalSummarizerCtl->latch = MyLatch;
+	SpinLockRelease(&WalSummarizerCtl->mutex);
+
+	/* Makes ThisTimeLineID valid, for read_local_xlog_page() */
+	(void) RecoveryInProgress();
+
+	if (mkdir(WALSUMMARY_DIR, S_IRWXU) < 0 && errno != EEXIST)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create directory \"%s\": %m",
+						WALSUMMARY_DIR)));
+
+	summarizer_context = AllocSetContextCreate(TopMemoryContext,
+											   "WAL summarizer",
+											   ALLOCSET_DEFAULT_SIZES);
+	MemoryContextSwitchTo(summarizer_context);
+
+	/*
+	 * Continue where the newest summary ends.  Protect the WAL from there on
+	 * before checking that it is still there, so that it can't be removed
+	 * after we have checked.
+	 */
+	start_lsn = GetLatestSummarizedLSN();
+	if (start_lsn != InvalidXLogRecPtr)
+	{
+		SetSummarizedLSN(start_lsn);
+		XLByteToSeg(start_lsn, segno, wal_segment_size);
+		if (segno <= XLogGetLastRemovedSegno())
+		{
+			ereport(LOG,
+					(errmsg("WAL from %X/%X has been removed before it could be summarized",
+							(uint32) (start_lsn >> 32), (uint32) start_lsn),
+					 errdetail("Incremental backups based on earlier backups are not possible.")));
+			start_lsn = InvalidXLogRecPtr;
+		}
+	}
+	if (start_lsn == InvalidXLogRecPtr)
+	{
+		/* The WAL from the latest redo pointer is guaranteed to be there */
+		start_lsn = GetRedoRecPtr();
+		SetSummarizedLSN(start_lsn);
+	}
+
+	/*
+	 * If the newest summary ended at a page boundary, the first record to
+	 * read is after the page header.
+	 */
+	read_lsn = start_lsn;
+	if (XLogSegmentOffset(read_lsn, wal_segment_size) == 0)
+		read_lsn += SizeOfXLogLongPHD;
+	else if (read_lsn % XLOG_BLCKSZ == 0)
+		read_lsn += SizeOfXLogShortPHD;
+
+	ereport(DEBUG1,
+			(errmsg("WAL summarizer started at %X/%X",
+					(uint32) (start_lsn >> 32), (uint32) start_lsn)));
+
+	xlogreader = XLogReaderAllocate(wal_segment_size, read_local_xlog_page,
+									NULL);
+	if (xlogreader == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	brtab = CreateBlockRefTable();
+	summary_start = start_lsn;
+
+	for (;;)
+	{
+		XLogRecord *record;
+		XLogRecPtr	next_lsn;
+		char	   *errormsg;
+		uint8		info;
+		bool		end_summary = false;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		/* Sleep if we have caught up with the flushed WAL */
+		next_lsn = first ? read_lsn : xlogreader->EndRecPtr;
+		if (GetFlushRecPtr() <= next_lsn)
+		{
+			int			rc;
+
+			rc = WaitLatch(MyLatch,
+						   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+						   WALSUMMARIZER_NAPTIME,
+						   WAIT_EVENT_WAL_SUMMARIZER_MAIN);
+
+			/* emergency bailout if postmaster has died */
+			if (rc & WL_POSTMASTER_DEATH)
+				proc_exit(1);
+
+			ResetLatch(MyLatch);
+			continue;
+		}
+
+		record = XLogReadRecord(xlogreader, first ? read_lsn : InvalidXLogRecPtr,
+								&errormsg);
+		if (record == NULL)
+		{
+			if (errormsg)
+				ereport(ERROR,
+						(errmsg("could not read WAL at %X/%X: %s",
+								(uint32) (next_lsn >> 32), (uint32) next_lsn,
+								errormsg)));
+			else
+				ereport(ERROR,
+						(errmsg("could not read WAL at %X/%X",
+								(uint32) (next_lsn >> 32), (uint32) next_lsn)));
+		}
+		first = false;
+
+		if (!skipping)
+			SummarizeRecord(xlogreader, brtab);
+
+		info = XLogRecGetInfo(xlogreader) & ~XLR_INFO_MASK;
+		if (XLogRecGetRmid(xlogreader) == RM_XLOG_ID)
+		{
+			if (info == XLOG_CHECKPOINT_ONLINE ||
+				info == XLOG_CHECKPOINT_SHUTDOWN)
+				end_summary = true;
+			else if (info == XLOG_PARAMETER_CHANGE)
+			{
+				xl_parameter_change xlrec;
+
+				memcpy(&xlrec, XLogRecGetData(xlogreader),
+					   sizeof(xl_parameter_change));
+
+				/*
+				 * With wal_level=minimal, changes to new relations are not
+				 * WAL-logged, so the WAL doesn't tell which blocks were
+				 * modified.  Don't summarize until wal_level is raised
+				 * again; the gap makes incremental backups across it fail.
+				 */
+				if (xlrec.wal_level < WAL_LEVEL_REPLICA && !skipping)
+				{
+					ereport(LOG,
+							(errmsg("WAL summarization is suspended at %X/%X because wal_level was set to \"minimal\"",
+									(uint32) (xlogreader->ReadRecPtr >> 32),
+									(uint32) xlogreader->ReadRecPtr)));
+					FreeBlockRefTable(brtab);
+					brtab = CreateBlockRefTable();
+					skipping = true;
+				}
+				else if (xlrec.wal_level >= WAL_LEVEL_REPLICA && skipping)
+				{
+					skipping = false;
+					summary_start = xlogreader->EndRecPtr;
+				}
+			}
+		}
+
+		if (skipping)
+		{
+			/* Nothing here will be summarized; let the WAL go */
+			SetSummarizedLSN(xlogreader->EndRecPtr);
+			continue;
+		}
+
+		if (BlockRefTableGetBlockCount(brtab) >= WALSUMMARY_MAX_BLOCKS)
+			end_summary = true;
+
+		if (end_summary)
+		{
+			WriteWalSummary(brtab, ThisTimeLineID, summary_start,
+							xlogreader->EndRecPtr);
+			FreeBlockRefTable(brtab);
+			brtab = CreateBlockRefTable();
+
+			summary_start = xlogreader->EndRecPtr;
+			SetSummarizedLSN(summary_start);
+
+			if (wal_summary_keep_time > 0)
+				RemoveOldWalSummaries(wal_summary_keep_time);
+		}
+	}
+}
+
+/*
+ * Record the blocks modified by one WAL record.
+ */
+static void
+SummarizeRecord(XLogReaderState *xlogreader, BlockRefTable *brtab)
+{
+	uint8		info = XLogRecGetInfo(xlogreader) & ~XLR_INFO_MASK;
+	int			block_id;
+	int			i;
+
+	for (block_id = 0; block_id <= xlogreader->max_block_id; block_id++)
+	{
+		RelFileNode rnode;
+		ForkNumber	forknum;
+		BlockNumber blkno;
+
+		if (!XLogRecGetBlockTag(xlogreader, block_id, &rnode, &forknum, &blkno))
+			continue;
+
+		/* Base backups send the other forks in full */
+		if (forknum == MAIN_FORKNUM)
+			BlockRefTableMarkBlockModified(brtab, &rnode, blkno);
+	}
+
+	/*
+	 * Creating, truncating or dropping a relation changes blocks that the
+	 * record doesn't reference.
+	 */
+	switch (XLogRecGetRmid(xlogreader))
+	{
+		case RM_SMGR_ID:
+			if (info == XLOG_SMGR_CREATE)
+			{
+				xl_smgr_create *xlrec;
+
+				xlrec = (xl_smgr_create *) XLogRecGetData(xlogreader);
+				if (xlrec->forkNum == MAIN_FORKNUM)
+					BlockRefTableSetLimitBlock(brtab, &xlrec->rnode, 0);
+			}
+			else if (info == XLOG_SMGR_TRUNCATE)
+			{
+				xl_smgr_truncate *xlrec;
+
+				xlrec = (xl_smgr_truncate *) XLogRecGetData(xlogreader);
+				if (xlrec->flags & SMGR_TRUNCATE_HEAP)
+					BlockRefTableSetLimitBlock(brtab, &xlrec->rnode,
+											   xlrec->blkno);
+			}
+			break;
+
+		case RM_XACT_ID:
+			if ((info & XLOG_XACT_OPMASK) == XLOG_XACT_COMMIT ||
+				(info & XLOG_XACT_OPMASK) == XLOG_XACT_COMMIT_PREPARED)
+			{
+				xl_xact_parsed_commit parsed;
+
+				ParseCommitRecord(XLogRecGetInfo(xlogreader),
+								  (xl_xact_commit *) XLogRecGetData(xlogreader),
+								  &parsed);
+				for (i = 0; i < parsed.nrels; i++)
+					BlockRefTableSetLimitBlock(brtab, &parsed.xnodes[i], 0);
+			}
+			else if ((info & XLOG_XACT_OPMASK) == XLOG_XACT_ABORT ||
+					 (info & XLOG_XACT_OPMASK) == XLOG_XACT_ABORT_PREPARED)
+			{
+				xl_xact_parsed_abort parsed;
+
+				ParseAbortRecord(XLogRecGetInfo(xlogreader),
+								 (xl_xact_abort *) XLogRecGetData(xlogreader),
+								 &parsed);
+				for (i = 0; i < parsed.nrels; i++)
+					BlockRefTableSetLimitBlock(brtab, &parsed.xnodes[i], 0);
+			}
+			break;
+
+		case RM_DBASE_ID:
+			/* The files of the database are copied or removed wholesale */
+			if (info == XLOG_DBASE_CREATE)
+			{
+				xl_dbase_create_rec *xlrec;
+
+				xlrec = (xl_dbase_create_rec *) XLogRecGetData(xlogreader);
+				BlockRefTableMarkDatabaseModified(brtab, xlrec->tablespace_id,
+												  xlrec->db_id);
+			}
+			else if (info == XLOG_DBASE_DROP)
+			{
+				xl_dbase_drop_rec *xlrec;
+
+				xlrec = (xl_dbase_drop_rec *) XLogRecGetData(xlogreader);
+				BlockRefTableMarkDatabaseModified(brtab, xlrec->tablespace_id,
+												  xlrec->db_id);
+			}
+			break;
+	}
+}
+
+/*
+ * Return the end of the newest summary file, or InvalidXLogRecPtr if there
+ * are none.
+ */
+static XLogRecPtr
+GetLatestSummarizedLSN(void)
+{
+	List	   *summaries;
+	ListCell   *lc;
+	XLogRecPtr	result = InvalidXLogRecPtr;
+
+	summaries = GetWalSummaries(InvalidXLogRecPtr, InvalidXLogRecPtr);
+	foreach(lc, summaries)
+	{
+		WalSummaryFile *ws = lfirst(lc);
+
+		if (ws->end_lsn > result)
+			result = ws->end_lsn;
+	}
+	list_free_deep(summaries);
+
+	return result;
+}
+
+static void
+SetSummarizedLSN(XLogRecPtr lsn)
+{
+	SpinLockAcquire(&WalSummarizerCtl->mutex);
+	WalSummarizerCtl->summarized_lsn = lsn;
+	SpinLockRelease(&WalSummarizerCtl->mutex);
+}
+
+static void
+walsummarizer_onexit(int code, Datum arg)
+{
+	SpinLockAcquire(&WalSummarizerCtl->mutex);
+	WalSummarizerCtl->latch = NULL;
+	SpinLockRelease(&WalSummarizerCtl->mutex);
+}
+
+/* SIGHUP: set flag to reload configuration at next convenient time */
+static void
+walsummarizer_sighup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
@@ -0,0 +1,602 @@
+/*-------------------------------------------------------------------------
+ *
+ * walsummary.c
+ *	  Summaries of the blocks modified by ranges of WAL.
+ *
+ * The WAL summarizer (see walsummarizer.c) reads the WAL and records, for
+ * each range of it, which blocks of which relations were modified.  Those
+ * summaries let an incremental base backup send only the blocks modified
+ * since a previous backup, without having to scan the WAL in between or
+ * read every block of every relation.
+ *
+ * A summary file is named after the timeline and the range of WAL it
+ * covers, and consists of a header, one entry per relation followed by the
+ * block numbers modified in it, and a CRC of all of that.  Only the main
+ * forks of relations are tracked; base backups always send the other forks
+ * in full.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/walsummary.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "access/xlog_internal.h"
+#include "port/pg_crc32c.h"
+#include "replication/walsummary.h"
+#include "storage/fd.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+#define WALSUMMARY_MAGIC	0x5753554d
+
+/* Length of a summary file name: five 8-digit hex numbers and ".summary" */
+#define WALSUMMARY_FNAME_LEN	(5 * 8 + 8)
+
+typedef struct WalSummaryHeader
+{
+	uint32		magic;
+	uint32		nentries;
+} WalSummaryHeader;
+
+typedef struct WalSummaryEntry
+{
+	RelFileNode rnode;
+	BlockNumber limit_block;
+	uint32		nblocks;		/* number of block numbers that follow */
+} WalSummaryEntry;
+
+typedef struct BlockRefTableEntry
+{
+	RelFileNode rnode;			/* hash key; must be first */
+	BlockNumber limit_block;	/* blocks >= this are all modified */
+	int			nblocks;		/* number of entries in blocks[] */
+	int			maxblocks;		/* allocated length of blocks[] */
+	int			nsorted;		/* blocks[0..nsorted-1] are sorted and unique */
+	BlockNumber *blocks;
+} BlockRefTableEntry;
+
+struct BlockRefTable
+{
+	MemoryContext mcxt;
+	HTAB	   *hash;
+	uint64		nblocks;		/* block numbers stored, across all entries */
+};
+
+static BlockRefTableEntry *get_entry(BlockRefTable *brtab,
+		  const RelFileNode *rnode);
+static void compact_entry(BlockRefTable *brtab, BlockRefTableEntry *entry);
+static int	blocknumber_cmp(const void *a, const void *b);
+static void summary_file_path(char *path, TimeLineID tli,
+				  XLogRecPtr start_lsn, XLogRecPtr end_lsn);
+static void write_summary_data(int fd, const char *path, pg_crc32c *crc,
+				   const void *data, size_t len);
+static void read_summary_data(int fd, const char *path, pg_crc32c *crc,
+				  void *data, size_t len);
+
+/*
+ * Create an empty block reference table, in a child of the current memory
+ * context.
+ */
+BlockRefTable *
+CreateBlockRefTable(void)
+{
+	BlockRefTable *brtab;
+	MemoryContext mcxt;
+	HASHCTL		ctl;
+
+	mcxt = AllocSetContextCreate(CurrentMemoryContext,
+								 "BlockRefTable",
+								 ALLOCSET_DEFAULT_SIZES);
+
+	brtab = MemoryContextAlloc(mcxt, sizeof(BlockRefTable));
+	brtab->mcxt = mcxt;
+	brtab->nblocks = 0;
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(RelFileNode);
+	ctl.entrysize = sizeof(BlockRefTableEntry);
+	ctl.hcxt = mcxt;
+	brtab->hash = hash_create("BlockRefTable hash", 1024, &ctl,
+							  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	return brtab;
+}
+
+/*
+ * Record that a block of the main fork of a relation was modified.
+ */
+void
+BlockRefTableMarkBlockModified(BlockRefTable *brtab, const RelFileNode *rnode,
+							   BlockNumber blkno)
+{
+	BlockRefTableEntry *entry = get_entry(brtab, rnode);
+
+	/* Nothing to do if the block is known to be modified already */
+	if (blkno >= entry->limit_block)
+		return;
+
+	if (entry->nblocks >= entry->maxblocks)
+	{
+		/*
+		 * The same blocks tend to be modified over and over, so before
+		 * making room, see if getting rid of the duplicates is enough.
+		 */
+		compact_entry(brtab, entry);
+
+		if (entry->nblocks >= entry->maxblocks / 2)
+		{
+			int			newmax = Max(entry->maxblocks * 2, 16);
+
+			if (entry->blocks == NULL)
+				entry->blocks = MemoryContextAlloc(brtab->mcxt,
+												   newmax * sizeof(BlockNumber));
+			else
+				entry->blocks = repalloc(entry->blocks,
+										 newmax * sizeof(BlockNumber));
+			entry->maxblocks = newmax;
+		}
+	}
+
+	entry->blocks[entry->nblocks++] = blkno;
+	brtab->nblocks++;
+}
+
+/*
+ * Record that all blocks of the main fork of a relation at or above
+ * 'limit_block' must be considered modified.
+ */
+void
+BlockRefTableSetLimitBlock(BlockRefTable *brtab, const RelFileNode *rnode,
+						   BlockNumber limit_block)
+{
+	BlockRefTableEntry *entry = get_entry(brtab, rnode);
+
+	if (limit_block < entry->limit_block)
+	{
+		entry->limit_block = limit_block;
+
+		/* Block numbers at or above the new limit are now redundant */
+		entry->nsorted = 0;
+	}
+}
+
+/*
+ * Record that every relation in a database must be considered modified.
+ */
+void
+BlockRefTableMarkDatabaseModified(BlockRefTable *brtab, Oid spcNode,
+								  Oid dbNode)
+{
+	RelFileNode rnode;
+
+	rnode.spcNode = spcNode;
+	rnode.dbNode = dbNode;
+	rnode.relNode = InvalidOid;
+	BlockRefTableSetLimitBlock(brtab, &rnode, 0);
+}
+
+/*
+ * Has nothing been recorded in the table?
+ */
+bool
+BlockRefTableIsEmpty(BlockRefTable *brtab)
+{
+	return hash_get_num_entries(brtab->hash) == 0;
+}
+
+/*
+ * Return the number of block numbers stored in the table, which bounds its
+ * memory use.  Duplicates may or may not be counted.
+ */
+uint64
+BlockRefTableGetBlockCount(BlockRefTable *brtab)
+{
+	return brtab->nblocks;
+}
+
+/*
+ * Was the directory of a database created or dropped as a whole?
+ */
+bool
+BlockRefTableIsDatabaseModified(BlockRefTable *brtab, Oid spcNode, Oid dbNode)
+{
+	RelFileNode rnode;
+
+	rnode.spcNode = spcNode;
+	rnode.dbNode = dbNode;
+	rnode.relNode = InvalidOid;
+	return hash_search(brtab->hash, &rnode, HASH_FIND, NULL) != NULL;
+}
+
+/*
+ * Look up the modified blocks of the main fork of a relation.
+ *
+ * Returns the limit block of the relation, or InvalidBlockNumber if it has
+ * none.  *blocks is set to the modified blocks below the limit, in
+ * ascending order and without duplicates, and *nblocks to their number.
+ * The array belongs to the table and must not be modified.
+ */
+BlockNumber
+BlockRefTableGetBlocks(BlockRefTable *brtab, const RelFileNode *rnode,
+					   BlockNumber **blocks, int *nblocks)
+{
+	BlockRefTableEntry *entry;
+
+	entry = hash_search(brtab->hash, rnode, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		*blocks = NULL;
+		*nblocks = 0;
+		return InvalidBlockNumber;
+	}
+
+	compact_entry(brtab, entry);
+	*blocks = entry->blocks;
+	*nblocks = entry->nblocks;
+	return entry->limit_block;
+}
+
+/*
+ * Release all memory used by a block reference table.
+ */
+void
+FreeBlockRefTable(BlockRefTable *brtab)
+{
+	MemoryContextDelete(brtab->mcxt);
+}
+
+/*
+ * Find or create the entry for a relation.
+ */
+static BlockRefTableEntry *
+get_entry(BlockRefTable *brtab, const RelFileNode *rnode)
+{
+	BlockRefTableEntry *entry;
+	bool		found;
+
+	entry = hash_search(brtab->hash, rnode, HASH_ENTER, &found);
+	if (!found)
+	{
+		entry->limit_block = InvalidBlockNumber;
+		entry->nblocks = 0;
+		entry->maxblocks = 0;
+		entry->nsorted = 0;
+		entry->blocks = NULL;
+	}
+
+	return entry;
+}
+
+/*
+ * Sort the block numbers of an entry, and remove duplicates and those at or
+ * above the limit block.
+ */
+static void
+compact_entry(BlockRefTable *brtab, BlockRefTableEntry *entry)
+{
+	int			i;
+	int			n = 0;
+
+	if (entry->nsorted == entry->nblocks)
+		return;
+
+	qsort(entry->blocks, entry->nblocks, sizeof(BlockNumber),
+		  blocknumber_cmp);
+	for (i = 0; i < entry->nblocks; i++)
+	{
+		if (entry->blocks[i] >= entry->limit_block)
+			break;
+		if (n == 0 || entry->blocks[i] != entry->blocks[n - 1])
+			entry->blocks[n++] = entry->blocks[i];
+	}
+
+	brtab->nblocks -= entry->nblocks - n;
+	entry->nblocks = n;
+	entry->nsorted = n;
+}
+
+static int
+blocknumber_cmp(const void *a, const void *b)
+{
+	BlockNumber ba = *(const BlockNumber *) a;
+	BlockNumber bb = *(const BlockNumber *) b;
+
+	if (ba < bb)
+		return -1;
+	if (ba > bb)
+		return 1;
+	return 0;
+}
+
+/*
+ * Write the contents of a block reference table as the summary of the WAL
+ * between 'start_lsn' and 'end_lsn' on timeline 'tli'.
+ */
+void
+WriteWalSummary(BlockRefTable *brtab, TimeLineID tli, XLogRecPtr start_lsn,
+				XLogRecPtr end_lsn)
+{
+	char		path[MAXPGPATH];
+	char		tmppath[MAXPGPATH];
+	int			fd;
+	pg_crc32c	crc;
+	WalSummaryHeader hdr;
+	HASH_SEQ_STATUS status;
+	BlockRefTableEntry *entry;
+
+	summary_file_path(path, tli, start_lsn, end_lsn);
+	snprintf(tmppath, MAXPGPATH, "%s.tmp", path);
+
+	fd = OpenTransientFile(tmppath, O_CREAT | O_TRUNC | O_WRONLY | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", tmppath)));
+
+	INIT_CRC32C(crc);
+
+	hdr.magic = WALSUMMARY_MAGIC;
+	hdr.nentries = hash_get_num_entries(brtab->hash);
+	write_summary_data(fd, tmppath, &crc, &hdr, sizeof(hdr));
+
+	hash_seq_init(&status, brtab->hash);
+	while ((entry = (BlockRefTableEntry *) hash_seq_search(&status)) != NULL)
+	{
+		WalSummaryEntry sentry;
+
+		compact_entry(brtab, entry);
+
+		memset(&sentry, 0, sizeof(sentry));
+		sentry.rnode = entry->rnode;
+		sentry.limit_block = entry->limit_block;
+		sentry.nblocks = entry->nblocks;
+		write_summary_data(fd, tmppath, &crc, &sentry, sizeof(sentry));
+		if (entry->nblocks > 0)
+			write_summary_data(fd, tmppath, &crc, entry->blocks,
+							   entry->nblocks * sizeof(BlockNumber));
+	}
+
+	FIN_CRC32C(crc);
+	if (write(fd, &crc, sizeof(crc)) != sizeof(crc))
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m", tmppath)));
+	}
+
+	if (pg_fsync(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", tmppath)));
+
+	if (CloseTransientFile(fd))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", tmppath)));
+
+	durable_rename(tmppath, path, ERROR);
+}
+
+/*
+ * Add the contents of a summary file to a block reference table.
+ */
+void
+ReadWalSummary(WalSummaryFile *ws, BlockRefTable *brtab)
+{
+	char		path[MAXPGPATH];
+	int			fd;
+	pg_crc32c	crc;
+	pg_crc32c	filecrc;
+	WalSummaryHeader hdr;
+	uint32		i;
+	BlockNumber blocks[1024];
+
+	summary_file_path(path, ws->tli, ws->start_lsn, ws->end_lsn);
+
+	fd = OpenTransientFile(path, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+
+	INIT_CRC32C(crc);
+
+	read_summary_data(fd, path, &crc, &hdr, sizeof(hdr));
+	if (hdr.magic != WALSUMMARY_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("WAL summary file \"%s\" has wrong magic number: %u instead of %u",
+						path, hdr.magic, WALSUMMARY_MAGIC)));
+
+	for (i = 0; i < hdr.nentries; i++)
+	{
+		WalSummaryEntry sentry;
+		uint32		done = 0;
+
+		read_summary_data(fd, path, &crc, &sentry, sizeof(sentry));
+		if (sentry.limit_block != InvalidBlockNumber)
+			BlockRefTableSetLimitBlock(brtab, &sentry.rnode,
+									   sentry.limit_block);
+
+		while (done < sentry.nblocks)
+		{
+			uint32		n = Min(sentry.nblocks - done, lengthof(blocks));
+			uint32		j;
+
+			read_summary_data(fd, path, &crc, blocks, n * sizeof(BlockNumber));
+			for (j = 0; j < n; j++)
+				BlockRefTableMarkBlockModified(brtab, &sentry.rnode,
+											   blocks[j]);
+			done += n;
+		}
+	}
+
+	FIN_CRC32C(crc);
+	read_summary_data(fd, path, NULL, &filecrc, sizeof(filecrc));
+	if (!EQ_CRC32C(crc, filecrc))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("WAL summary file \"%s\" has incorrect checksum",
+						path)));
+
+	CloseTransientFile(fd);
+}
+
+/*
+ * Return a list of WalSummaryFile for the summaries that overlap the range
+ * between 'start_lsn' and 'end_lsn', in no particular order.  Either bound
+ * may be InvalidXLogRecPtr, to not limit the range on that side.
+ */
+List *
+GetWalSummaries(XLogRecPtr start_lsn, XLogRecPtr end_lsn)
+{
+	List	   *result = NIL;
+	DIR		   *dir;
+	struct dirent *de;
+
+	dir = AllocateDir(WALSUMMARY_DIR);
+	if (dir == NULL && errno == ENOENT)
+		return NIL;
+
+	while ((de = ReadDir(dir, WALSUMMARY_DIR)) != NULL)
+	{
+		WalSummaryFile *ws;
+		uint32		tli,
+					start_hi,
+					start_lo,
+					end_hi,
+					end_lo;
+
+		if (strlen(de->d_name) != WALSUMMARY_FNAME_LEN ||
+			strspn(de->d_name, "0123456789ABCDEF") != 5 * 8 ||
+			strcmp(de->d_name + 5 * 8, ".summary") != 0)
+			continue;
+
+		if (sscanf(de->d_name, "%08X%08X%08X%08X%08X",
+				   &tli, &start_hi, &start_lo, &end_hi, &end_lo) != 5)
+			continue;
+
+		ws = palloc(sizeof(WalSummaryFile));
+		ws->tli = tli;
+		ws->start_lsn = ((uint64) start_hi) << 32 | start_lo;
+		ws->end_lsn = ((uint64) end_hi) << 32 | end_lo;
+
+		if ((start_lsn != InvalidXLogRecPtr && ws->end_lsn <= start_lsn) ||
+			(end_lsn != InvalidXLogRecPtr && ws->start_lsn >= end_lsn))
+		{
+			pfree(ws);
+			continue;
+		}
+
+		result = lappend(result, ws);
+	}
+	FreeDir(dir);
+
+	return result;
+}
+
+/*
+ * Remove summary files that were written more than 'keep_minutes' ago,
+ * except for the newest one, which tells the summarizer where to continue
+ * after a restart.
+ */
+void
+RemoveOldWalSummaries(int keep_minutes)
+{
+	List	   *summaries;
+	ListCell   *lc;
+	WalSummaryFile *newest = NULL;
+	time_t		cutoff;
+
+	summaries = GetWalSummaries(InvalidXLogRecPtr, InvalidXLogRecPtr);
+	foreach(lc, summaries)
+	{
+		WalSummaryFile *ws = lfirst(lc);
+
+		if (newest == NULL || ws->end_lsn > newest->end_lsn)
+			newest = ws;
+	}
+
+	cutoff = time(NULL) - (time_t) keep_minutes * 60;
+	foreach(lc, summaries)
+	{
+		WalSummaryFile *ws = lfirst(lc);
+		char		path[MAXPGPATH];
+		struct stat statbuf;
+
+		if (ws == newest)
+			continue;
+
+		summary_file_path(path, ws->tli, ws->start_lsn, ws->end_lsn);
+		if (stat(path, &statbuf) != 0 || statbuf.st_mtime >= cutoff)
+			continue;
+
+		elog(DEBUG1, "removing WAL summary file \"%s\"", path);
+		if (unlink(path) != 0 && errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m", path)));
+	}
+
+	list_free_deep(summaries);
+}
+
+static void
+summary_file_path(char *path, TimeLineID tli, XLogRecPtr start_lsn,
+				  XLogRecPtr end_lsn)
+{
+	snprintf(path, MAXPGPATH, WALSUMMARY_DIR "/%08X%08X%08X%08X%08X.summary",
+			 tli,
+			 (uint32) (start_lsn >> 32), (uint32) start_lsn,
+			 (uint32) (end_lsn >> 32), (uint32) end_lsn);
+}
+
+static void
+write_summary_data(int fd, const char *path, pg_crc32c *crc,
+				   const void *data, size_t len)
+{
+	COMP_CRC32C(*crc, data, len);
+
+	errno = 0;
+	if (write(fd, data, len) != len)
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m", path)));
+	}
+}
+
+static void
+read_summary_data(int fd, const char *path, pg_crc32c *crc,
+				  void *data, size_t len)
+{
+	int			nread;
+
+	nread = read(fd, data, len);
+	if (nread < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m", path)));
+	if (nread != len)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("could not read file \"%s\": read %d of %zu",
+						path, nread, len)));
+
+	if (crc != NULL)
+		COMP_CRC32C(*crc, data, len);
+}
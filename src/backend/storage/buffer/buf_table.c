@@ -106,6 +106,38 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 	return result->id;
 }
 
+/*
+ * BufTableLookupUnlocked
+ *		Like BufTableLookup, but without any lock
+ *
+ * Since the table may be changing concurrently, the result is only a hint.
+ * The caller must pin the buffer and then check that it has the expected
+ * tag, and must fall back to BufTableLookup if that fails or -1 is returned.
+ */
+int
+BufTableLookupUnlocked(BufferTag *tagPtr, uint32 hashcode)
+{
+	BufferLookupEnt *result;
+	int			id;
+
+	/* no chain can legitimately be longer than the whole table */
+	result = (BufferLookupEnt *)
+		hash_search_unlocked(SharedBufHash,
+							 (void *) tagPtr,
+							 hashcode,
+							 NBuffers + NUM_BUFFER_PARTITIONS);
+
+	if (!result)
+		return -1;
+
+	/* the entry might be garbage by now, so don't trust it too far */
+	id = *((volatile int *) &result->id);
+	if (id < 0 || id >= NBuffers)
+		return -1;
+
+	return id;
+}
+
 /*
  * BufTableInsert
  *		Insert a hashtable entry for given tag and buffer ID,
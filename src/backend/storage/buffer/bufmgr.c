@@ -44,10 +44,12 @@
 #include "postmaster/bgwriter.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/smgr.h"
 #include "storage/standby.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
 #include "utils/timestamp.h"
@@ -67,6 +69,14 @@
 
 #define DROP_RELS_BSEARCH_THRESHOLD		20
 
+/*
+ * Dropping the buffers of a relation whose size we know can be done by
+ * looking up each of its blocks in the buffer mapping table, rather than by
+ * scanning all of shared_buffers.  Above this many blocks the full scan is
+ * cheaper.
+ */
+#define BUF_DROP_FULL_SCAN_THRESHOLD	(uint64) (NBuffers / 32)
+
 typedef struct PrivateRefCountEntry
 {
 	Buffer		buffer;
@@ -132,6 +142,28 @@ int			target_prefetch_pages = 0;
 static BufferDesc *InProgressBuf = NULL;
 static bool IsForInput;
 
+/*
+ * Local state for asynchronous checkpoint writes (see FlushBufferAsync).
+ * Each in-flight write owns a private, I/O-aligned copy of the page; the
+ * buffer itself stays pinned and in I/O-in-progress state until the write
+ * has completed.  buf is NULL in unused slots.  With double_write, writes
+ * are pending until a batch of them has been double-written.
+ */
+typedef struct AsyncBufferWrite
+{
+	BufferDesc *buf;
+	char	   *page;
+	bool		pending;		/* waiting for StartPendingBufferWrites? */
+	bool		permanent;		/* needs to be double-written? */
+} AsyncBufferWrite;
+
+static AsyncBufferWrite AsyncWrites[AIO_MAX_IN_FLIGHT];
+static int	NumAsyncWrites = 0;
+static int	NumPendingWrites = 0;
+
+/* private copy of the page being written by FlushBuffer, for double_write */
+static char *DoubleWriteCopy = NULL;
+
 /* local state for LockBufferForCleanup */
 static BufferDesc *PinCountWaitBuf = NULL;
 
@@ -451,6 +483,14 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 			BufferAccessStrategy strategy,
 			bool *foundPtr);
 static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
+static bool FlushBufferAsync(BufferDesc *buf);
+static void StartPendingBufferWrites(void);
+static void AsyncBufferWriteComplete(void *arg, int result);
+static void AbortAsyncBufferWrites(void);
+static void FindAndDropRelFileNodeBuffers(RelFileNode rnode,
+							  ForkNumber forkNum,
+							  BlockNumber nForkBlock,
+							  BlockNumber firstDelBlock);
 static void AtProcExit_Buffers(int code, Datum arg);
 static void CheckForBufferLeaks(void);
 static int	rnode_comparator(const void *p1, const void *p2);
@@ -547,42 +587,63 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 		LocalPrefetchBuffer(reln->rd_smgr, forkNum, blockNum);
 	}
 	else
-	{
-		BufferTag	newTag;		/* identity of requested block */
-		uint32		newHash;	/* hash value for newTag */
-		LWLock	   *newPartitionLock;	/* buffer partition lock for it */
-		int			buf_id;
+		(void) PrefetchSharedBuffer(reln->rd_smgr, forkNum, blockNum);
+#endif							/* USE_PREFETCH */
+}
 
-		/* create a tag so we can lookup the buffer */
-		INIT_BUFFERTAG(newTag, reln->rd_smgr->smgr_rnode.node,
-					   forkNum, blockNum);
+/*
+ * PrefetchSharedBuffer -- initiate asynchronous read of a block of a
+ *		relation that uses shared buffers, at the smgr level
+ *
+ * This is the guts of PrefetchBuffer(), for callers that have no relcache
+ * entry, such as recovery.  Returns true if a read was initiated, false if
+ * the block is in shared buffers already (or prefetching isn't supported).
+ */
+bool
+PrefetchSharedBuffer(SMgrRelation smgr_reln, ForkNumber forkNum,
+					 BlockNumber blockNum)
+{
+#ifdef USE_PREFETCH
+	BufferTag	newTag;			/* identity of requested block */
+	uint32		newHash;		/* hash value for newTag */
+	LWLock	   *newPartitionLock;	/* buffer partition lock for it */
+	int			buf_id;
 
-		/* determine its hash code and partition lock ID */
-		newHash = BufTableHashCode(&newTag);
-		newPartitionLock = BufMappingPartitionLock(newHash);
+	Assert(BlockNumberIsValid(blockNum));
 
-		/* see if the block is in the buffer pool already */
-		LWLockAcquire(newPartitionLock, LW_SHARED);
-		buf_id = BufTableLookup(&newTag, newHash);
-		LWLockRelease(newPartitionLock);
+	/* create a tag so we can lookup the buffer */
+	INIT_BUFFERTAG(newTag, smgr_reln->smgr_rnode.node,
+				   forkNum, blockNum);
 
-		/* If not in buffers, initiate prefetch */
-		if (buf_id < 0)
-			smgrprefetch(reln->rd_smgr, forkNum, blockNum);
+	/* determine its hash code and partition lock ID */
+	newHash = BufTableHashCode(&newTag);
+	newPartitionLock = BufMappingPartitionLock(newHash);
 
-		/*
-		 * If the block *is* in buffers, we do nothing.  This is not really
-		 * ideal: the block might be just about to be evicted, which would be
-		 * stupid since we know we are going to need it soon.  But the only
-		 * easy answer is to bump the usage_count, which does not seem like a
-		 * great solution: when the caller does ultimately touch the block,
-		 * usage_count would get bumped again, resulting in too much
-		 * favoritism for blocks that are involved in a prefetch sequence. A
-		 * real fix would involve some additional per-buffer state, and it's
-		 * not clear that there's enough of a problem to justify that.
-		 */
+	/* see if the block is in the buffer pool already */
+	LWLockAcquire(newPartitionLock, LW_SHARED);
+	buf_id = BufTableLookup(&newTag, newHash);
+	LWLockRelease(newPartitionLock);
+
+	/* If not in buffers, initiate prefetch */
+	if (buf_id < 0)
+	{
+		smgrprefetch(smgr_reln, forkNum, blockNum);
+		return true;
 	}
+
+	/*
+	 * If the block *is* in buffers, we do nothing.  This is not really
+	 * ideal: the block might be just about to be evicted, which would be
+	 * stupid since we know we are going to need it soon.  But the only easy
+	 * answer is to bump the usage_count, which does not seem like a great
+	 * solution: when the caller does ultimately touch the block, usage_count
+	 * would get bumped again, resulting in too much favoritism for blocks
+	 * that are involved in a prefetch sequence. A real fix would involve some
+	 * additional per-buffer state, and it's not clear that there's enough of
+	 * a problem to justify that.
+	 */
 #endif							/* USE_PREFETCH */
+	return false;
 }
 
 
@@ -1008,23 +1069,54 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
-	/* see if the block is in the buffer pool already */
-	LWLockAcquire(newPartitionLock, LW_SHARED);
-	buf_id = BufTableLookup(&newTag, newHash);
+	/*
+	 * See if the block is in the buffer pool already.  First try without the
+	 * mapping lock, since taking it even in shared mode makes every backend
+	 * reading a popular block write to the same cache line.  The lookup
+	 * might return the wrong buffer if the table is changing concurrently,
+	 * but once we've pinned a buffer its tag can't change under us, so if it
+	 * still has our tag after pinning, it's just as good as if we'd found it
+	 * with the lock held.  Otherwise, unpin it and do it the hard way.
+	 */
+	buf_id = BufTableLookupUnlocked(&newTag, newHash);
 	if (buf_id >= 0)
 	{
-		/*
-		 * Found it.  Now, pin the buffer so no one can steal it from the
-		 * buffer pool, and check to see if the correct data has been loaded
-		 * into the buffer.
-		 */
 		buf = GetBufferDescriptor(buf_id);
 
 		valid = PinBuffer(buf, strategy);
 
+		if (!BUFFERTAGS_EQUAL(buf->tag, newTag))
+		{
+			UnpinBuffer(buf, true);
+			buf_id = -1;
+		}
+	}
+
+	if (buf_id < 0)
+	{
+		LWLockAcquire(newPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&newTag, newHash);
+		if (buf_id >= 0)
+		{
+			/*
+			 * Found it.  Now, pin the buffer so no one can steal it from the
+			 * buffer pool.
+			 */
+			buf = GetBufferDescriptor(buf_id);
+
+			valid = PinBuffer(buf, strategy);
+		}
+
 		/* Can release the mapping lock as soon as we've pinned it */
 		LWLockRelease(newPartitionLock);
+	}
 
+	if (buf_id >= 0)
+	{
+		/*
+		 * Found it, and pinned it.  Check to see if the correct data has been
+		 * loaded into the buffer.
+		 */
 		*foundPtr = TRUE;
 
 		if (!valid)
@@ -1051,9 +1143,8 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	/*
 	 * Didn't find it in the buffer pool.  We'll have to initialize a new
-	 * buffer.  Remember to unlock the mapping lock while doing the work.
+	 * buffer.
 	 */
-	LWLockRelease(newPartitionLock);
 
 	/* Loop here in case we have to try another victim buffer */
 	for (;;)
@@ -1981,6 +2072,9 @@ BufferSync(int flags)
 		 */
 		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 		{
+			/* asynchronous writes keep their pins, so make room each time */
+			ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
 			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
 			{
 				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
@@ -2014,6 +2108,9 @@ BufferSync(int flags)
 		CheckpointWriteDelay(flags, (double) num_processed / num_to_scan);
 	}
 
+	/* finish asynchronous writes, before mdsync() looks at the files */
+	FlushPendingBufferWrites();
+
 	/* issue all pending flushes */
 	IssuePendingWritebacks(&wb_context);
 
@@ -2351,6 +2448,7 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	int			result = 0;
 	uint32		buf_state;
 	BufferTag	tag;
+	bool		async = false;
 
 	ReservePrivateRefCountEntry();
 
@@ -2387,17 +2485,25 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	/*
 	 * Pin it, share-lock it, write it.  (FlushBuffer will do nothing if the
 	 * buffer is clean by the time we've locked it.)
+	 *
+	 * The checkpointer writes asynchronously if it can, and batches its
+	 * double writes, in which case the pin is released when the write
+	 * completes.
 	 */
 	PinBuffer_Locked(bufHdr);
 	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
 
-	FlushBuffer(bufHdr, NULL);
+	if (AmCheckpointerProcess() && (AioEnabled() || double_write))
+		async = FlushBufferAsync(bufHdr);
+	else
+		FlushBuffer(bufHdr, NULL);
 
 	LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 
 	tag = bufHdr->tag;
 
-	UnpinBuffer(bufHdr, true);
+	if (!async)
+		UnpinBuffer(bufHdr, true);
 
 	ScheduleBufferTagForWriteback(wb_context, &tag);
 
@@ -2671,6 +2777,7 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	Block		bufBlock;
 	char	   *bufToWrite;
 	uint32		buf_state;
+	bool		dblwr;
 
 	/*
 	 * Acquire the buffer's io_in_progress lock.  If StartBufferIO returns
@@ -2739,8 +2846,27 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	 * Update page checksum if desired.  Since we have only shared lock on the
 	 * buffer, other processes might be updating hint bits in it, so we must
 	 * copy the page to private storage if we do checksumming.
+	 *
+	 * With double_write, the page is first written to the double-write
+	 * buffer (unlogged relations don't need that, since they are reset after
+	 * a crash anyway).  The in-place write must then write exactly the same
+	 * data, so we always use a private copy.  Concurrent writers share the
+	 * fsync of the double-write file; see DoubleWriteSync.
 	 */
-	bufToWrite = PageSetChecksumCopy((Page) bufBlock, buf->tag.blockNum);
+	dblwr = (double_write && (buf_state & BM_PERMANENT));
+	if (dblwr)
+	{
+		if (DoubleWriteCopy == NULL)
+			DoubleWriteCopy = MemoryContextAlloc(TopMemoryContext, BLCKSZ);
+		memcpy(DoubleWriteCopy, bufBlock, BLCKSZ);
+		PageSetChecksumInplace((Page) DoubleWriteCopy, buf->tag.blockNum);
+		bufToWrite = DoubleWriteCopy;
+
+		LWLockAcquire(DoubleWriteLock, LW_SHARED);
+		DoubleWritePages(&buf->tag, &bufToWrite, 1);
+	}
+	else
+		bufToWrite = PageSetChecksumCopy((Page) bufBlock, buf->tag.blockNum);
 
 	if (track_io_timing)
 		INSTR_TIME_SET_CURRENT(io_start);
@@ -2754,6 +2880,9 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 			  bufToWrite,
 			  false);
 
+	if (dblwr)
+		LWLockRelease(DoubleWriteLock);
+
 	if (track_io_timing)
 	{
 		INSTR_TIME_SET_CURRENT(io_time);
@@ -2780,6 +2909,289 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	error_context_stack = errcallback.previous;
 }
 
+/*
+ * FlushBufferAsync
+ *		Like FlushBuffer, but only start the write; see aio.c.
+ *
+ * The caller must hold a pin and a share lock on the buffer.  The page is
+ * copied to private memory, so the caller can release the content lock as
+ * soon as we return, but if we return true, the pin now belongs to the
+ * write and is released by AsyncBufferWriteComplete.  Returns false, leaving
+ * the pin alone, if the buffer turned out not to need writing.
+ *
+ * Meanwhile the buffer stays in I/O-in-progress state, so anyone else who
+ * wants to write or replace it waits for us.  The caller must therefore run
+ * AioComplete() regularly, and FlushPendingBufferWrites() before sleeping.
+ * Only the checkpointer uses this so far.
+ *
+ * With double_write, the write isn't even started, but queued until there
+ * is a batch of pages to double-write at once; see StartPendingBufferWrites.
+ * That is also done if asynchronous I/O isn't available, in which case the
+ * queued writes are performed synchronously.
+ */
+static bool
+FlushBufferAsync(BufferDesc *buf)
+{
+	AsyncBufferWrite *aw = NULL;
+	ErrorContextCallback errcallback;
+	SMgrRelation reln;
+	XLogRecPtr	recptr;
+	uint32		buf_state;
+	int			i;
+
+	Assert(InProgressBuf == NULL);
+
+	/* Allocate the page copies on first use */
+	if (AsyncWrites[0].page == NULL)
+	{
+		char	   *pages;
+
+		pages = MemoryContextAlloc(TopMemoryContext,
+								   AIO_MAX_IN_FLIGHT * BLCKSZ + PG_IO_ALIGN_SIZE);
+		pages = (char *) TYPEALIGN(PG_IO_ALIGN_SIZE, pages);
+		for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+			AsyncWrites[i].page = pages + i * BLCKSZ;
+	}
+
+	/*
+	 * Finish any writes that are done.  If there's still no free slot, start
+	 * the queued writes, or wait for one to complete.
+	 */
+	AioComplete(false);
+	while (NumAsyncWrites >= AIO_MAX_IN_FLIGHT)
+	{
+		if (NumPendingWrites > 0)
+			StartPendingBufferWrites();
+		else
+			AioComplete(true);
+	}
+
+	if (!StartBufferIO(buf, false))
+		return false;
+
+	/*
+	 * From here on the I/O is tracked by its slot rather than InProgressBuf,
+	 * so that AbortBufferIO cleans up after it if we fail.
+	 */
+	for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+	{
+		if (AsyncWrites[i].buf == NULL)
+		{
+			aw = &AsyncWrites[i];
+			break;
+		}
+	}
+	Assert(aw != NULL);
+	aw->buf = buf;
+	NumAsyncWrites++;
+	InProgressBuf = NULL;
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = shared_buffer_write_error_callback;
+	errcallback.arg = (void *) buf;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	reln = smgropen(buf->tag.rnode, InvalidBackendId);
+
+	TRACE_POSTGRESQL_BUFFER_FLUSH_START(buf->tag.forkNum,
+										buf->tag.blockNum,
+										reln->smgr_rnode.node.spcNode,
+										reln->smgr_rnode.node.dbNode,
+										reln->smgr_rnode.node.relNode);
+
+	/* As in FlushBuffer */
+	buf_state = LockBufHdr(buf);
+	recptr = BufferGetLSN(buf);
+	buf_state &= ~BM_JUST_DIRTIED;
+	UnlockBufHdr(buf, buf_state);
+
+	if (buf_state & BM_PERMANENT)
+		XLogFlush(recptr);
+
+	/*
+	 * We always write from a copy, both so that the caller can release the
+	 * content lock and so that the checksum stays valid.
+	 */
+	memcpy(aw->page, BufHdrGetBlock(buf), BLCKSZ);
+	PageSetChecksumInplace((Page) aw->page, buf->tag.blockNum);
+
+	if (double_write)
+	{
+		aw->pending = true;
+		aw->permanent = (buf_state & BM_PERMANENT) != 0;
+		NumPendingWrites++;
+	}
+	else
+		smgrstartwrite(reln,
+					   buf->tag.forkNum,
+					   buf->tag.blockNum,
+					   aw->page,
+					   AsyncBufferWriteComplete,
+					   (void *) aw);
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	return true;
+}
+
+/*
+ * StartPendingBufferWrites
+ *		Double-write the pages of the writes queued by FlushBufferAsync, and
+ *		then start writing them in place.
+ *
+ * All the pages go to the double-write buffer in one batch, so they cost
+ * only one fsync.  Unlike other writers, we don't need to hold
+ * DoubleWriteLock until the in-place writes have been issued: only the
+ * checkpointer switches to a new double-write file, and it finishes all its
+ * writes before doing so.
+ */
+static void
+StartPendingBufferWrites(void)
+{
+	BufferTag	tags[AIO_MAX_IN_FLIGHT];
+	char	   *pages[AIO_MAX_IN_FLIGHT];
+	int			npages = 0;
+	int			i;
+
+	for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+	{
+		AsyncBufferWrite *aw = &AsyncWrites[i];
+
+		if (aw->buf != NULL && aw->pending && aw->permanent)
+		{
+			tags[npages] = aw->buf->tag;
+			pages[npages] = aw->page;
+			npages++;
+		}
+	}
+
+	if (npages > 0)
+	{
+		LWLockAcquire(DoubleWriteLock, LW_SHARED);
+		DoubleWritePages(tags, pages, npages);
+		LWLockRelease(DoubleWriteLock);
+	}
+
+	for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+	{
+		AsyncBufferWrite *aw = &AsyncWrites[i];
+		BufferDesc *buf = aw->buf;
+		ErrorContextCallback errcallback;
+		SMgrRelation reln;
+
+		if (buf == NULL || !aw->pending)
+			continue;
+		aw->pending = false;
+		NumPendingWrites--;
+
+		errcallback.callback = shared_buffer_write_error_callback;
+		errcallback.arg = (void *) buf;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		reln = smgropen(buf->tag.rnode, InvalidBackendId);
+
+		/* There's an I/O slot for each of our slots, so no need to wait */
+		if (AioEnabled())
+			smgrstartwrite(reln,
+						   buf->tag.forkNum,
+						   buf->tag.blockNum,
+						   aw->page,
+						   AsyncBufferWriteComplete,
+						   (void *) aw);
+		else
+		{
+			smgrwrite(reln,
+					  buf->tag.forkNum,
+					  buf->tag.blockNum,
+					  aw->page,
+					  false);
+			AsyncBufferWriteComplete((void *) aw, BLCKSZ);
+		}
+
+		error_context_stack = errcallback.previous;
+	}
+
+	Assert(NumPendingWrites == 0);
+}
+
+/*
+ * FlushPendingBufferWrites
+ *		Complete all the writes started or queued by FlushBufferAsync.
+ *
+ * The checkpointer must call this before sleeping, so that it doesn't leave
+ * buffers in I/O-in-progress state meanwhile.
+ */
+void
+FlushPendingBufferWrites(void)
+{
+	if (NumPendingWrites > 0)
+		StartPendingBufferWrites();
+	AioCompleteAll();
+}
+
+/*
+ * AsyncBufferWriteComplete
+ *		Completion callback for writes started by FlushBufferAsync.
+ */
+static void
+AsyncBufferWriteComplete(void *arg, int result)
+{
+	AsyncBufferWrite *aw = (AsyncBufferWrite *) arg;
+	BufferDesc *buf = aw->buf;
+
+	Assert(buf != NULL);
+	Assert(InProgressBuf == NULL);
+
+	if (result != BLCKSZ)
+	{
+		ErrorContextCallback errcallback;
+
+		/* The slot stays in use, for AbortBufferIO to clean up */
+		errcallback.callback = shared_buffer_write_error_callback;
+		errcallback.arg = (void *) buf;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		if (result < 0)
+		{
+			errno = -result;
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write block %u: %m",
+							buf->tag.blockNum)));
+		}
+		ereport(ERROR,
+				(errcode(ERRCODE_DISK_FULL),
+				 errmsg("could not write block %u: wrote only %d of %d bytes",
+						buf->tag.blockNum, result, BLCKSZ),
+				 errhint("Check free disk space.")));
+	}
+
+	pgBufferUsage.shared_blks_written++;
+
+	/*
+	 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set) and
+	 * end the io_in_progress state.
+	 */
+	InProgressBuf = buf;
+	IsForInput = false;
+	TerminateBufferIO(buf, true, 0);
+
+	TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(buf->tag.forkNum,
+									   buf->tag.blockNum,
+									   buf->tag.rnode.spcNode,
+									   buf->tag.rnode.dbNode,
+									   buf->tag.rnode.relNode);
+
+	aw->buf = NULL;
+	NumAsyncWrites--;
+
+	UnpinBuffer(buf, true);
+}
+
 /*
  * RelationGetNumberOfBlocksInFork
  *		Determines the current number of pages in the specified relation fork.
@@ -2873,16 +3285,18 @@ BufferGetLSNAtomic(Buffer buffer)
  *		that no other process could be trying to load more pages of the
  *		relation into buffers.
  *
- *		XXX currently it sequentially searches the buffer pool, should be
- *		changed to more clever ways of searching.  However, this routine
- *		is used only in code paths that aren't very performance-critical,
- *		and we shouldn't slow down the hot paths to make it faster ...
+ *		If the size of the fork is known (see smgrnblocks_cached) and only
+ *		a few blocks are to be dropped, we look each of them up in the
+ *		buffer mapping table.  Otherwise we sequentially search the whole
+ *		buffer pool.
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
+DropRelFileNodeBuffers(SMgrRelation smgr_reln, ForkNumber forkNum,
 					   BlockNumber firstDelBlock)
 {
+	RelFileNodeBackend rnode = smgr_reln->smgr_rnode;
+	BlockNumber nForkBlock;
 	int			i;
 
 	/* If it's a local relation, it's localbuf.c's problem. */
@@ -2893,6 +3307,23 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
 		return;
 	}
 
+	/*
+	 * If we know the size of the fork, there can be no buffers for blocks
+	 * beyond it, so looking up just the blocks being dropped is enough.
+	 */
+	nForkBlock = smgrnblocks_cached(smgr_reln, forkNum);
+	if (BlockNumberIsValid(nForkBlock))
+	{
+		if (nForkBlock <= firstDelBlock)
+			return;				/* nothing to drop */
+		if (nForkBlock - firstDelBlock < BUF_DROP_FULL_SCAN_THRESHOLD)
+		{
+			FindAndDropRelFileNodeBuffers(rnode.node, forkNum, nForkBlock,
+										  firstDelBlock);
+			return;
+		}
+	}
+
 	for (i = 0; i < NBuffers; i++)
 	{
 		BufferDesc *bufHdr = GetBufferDescriptor(i);
@@ -2937,28 +3368,35 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
+DropRelFileNodesAllBuffers(SMgrRelation *smgr_reln, int nnodes)
 {
 	int			i,
+				j,
 				n = 0;
+	SMgrRelation *rels;
+	BlockNumber (*block)[MAX_FORKNUM + 1];
+	uint64		nBlocksToInvalidate = 0;
+	bool		cached = true;
 	RelFileNode *nodes;
 	bool		use_bsearch;
 
 	if (nnodes == 0)
 		return;
 
-	nodes = palloc(sizeof(RelFileNode) * nnodes);	/* non-local relations */
+	rels = palloc(sizeof(SMgrRelation) * nnodes);	/* non-local relations */
 
 	/* If it's a local relation, it's localbuf.c's problem. */
 	for (i = 0; i < nnodes; i++)
 	{
-		if (RelFileNodeBackendIsTemp(rnodes[i]))
+		RelFileNodeBackend rnode = smgr_reln[i]->smgr_rnode;
+
+		if (RelFileNodeBackendIsTemp(rnode))
 		{
-			if (rnodes[i].backend == MyBackendId)
-				DropRelFileNodeAllLocalBuffers(rnodes[i].node);
+			if (rnode.backend == MyBackendId)
+				DropRelFileNodeAllLocalBuffers(rnode.node);
 		}
 		else
-			nodes[n++] = rnodes[i].node;
+			rels[n++] = smgr_reln[i];
 	}
 
 	/*
@@ -2967,10 +3405,60 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	 */
 	if (n == 0)
 	{
-		pfree(nodes);
+		pfree(rels);
+		return;
+	}
+
+	/*
+	 * As in DropRelFileNodeBuffers, we can avoid scanning the whole buffer
+	 * pool if we know the size of every fork of every relation, and their
+	 * total is small.  A fork whose size isn't cached might simply not
+	 * exist, which is fine; but don't bother to ask about the others unless
+	 * the main fork's size is known.
+	 */
+	block = (BlockNumber (*)[MAX_FORKNUM + 1])
+		palloc(sizeof(BlockNumber) * n * (MAX_FORKNUM + 1));
+	for (i = 0; i < n && cached; i++)
+	{
+		for (j = 0; j <= MAX_FORKNUM; j++)
+		{
+			block[i][j] = smgrnblocks_cached(rels[i], j);
+			if (!BlockNumberIsValid(block[i][j]))
+			{
+				if (j != MAIN_FORKNUM && !smgrexists(rels[i], j))
+					continue;
+				cached = false;
+				break;
+			}
+			nBlocksToInvalidate += block[i][j];
+		}
+	}
+
+	if (cached && nBlocksToInvalidate < BUF_DROP_FULL_SCAN_THRESHOLD)
+	{
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j <= MAX_FORKNUM; j++)
+			{
+				/* skip forks that don't exist */
+				if (!BlockNumberIsValid(block[i][j]))
+					continue;
+				FindAndDropRelFileNodeBuffers(rels[i]->smgr_rnode.node, j,
+											  block[i][j], 0);
+			}
+		}
+
+		pfree(block);
+		pfree(rels);
 		return;
 	}
 
+	pfree(block);
+	nodes = palloc(sizeof(RelFileNode) * n);
+	for (i = 0; i < n; i++)
+		nodes[i] = rels[i]->smgr_rnode.node;
+	pfree(rels);
+
 	/*
 	 * For low number of relations to drop just use a simple walk through, to
 	 * save the bsearch overhead. The threshold to use is rather a guess than
@@ -3028,6 +3516,66 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	pfree(nodes);
 }
 
+/* ---------------------------------------------------------------------
+ *		FindAndDropRelFileNodeBuffers
+ *
+ *		Drop the buffers of blocks firstDelBlock .. nForkBlock - 1 of the
+ *		given relation fork, by looking each of them up in the buffer
+ *		mapping table.  The caller must know that the fork has no blocks
+ *		at or beyond nForkBlock, and must make sure no one can be loading
+ *		pages of it, as for DropRelFileNodeBuffers.
+ * --------------------------------------------------------------------
+ */
+static void
+FindAndDropRelFileNodeBuffers(RelFileNode rnode, ForkNumber forkNum,
+							  BlockNumber nForkBlock,
+							  BlockNumber firstDelBlock)
+{
+	BlockNumber curBlock;
+
+	for (curBlock = firstDelBlock; curBlock < nForkBlock; curBlock++)
+	{
+		uint32		bufHash;	/* hash value for tag */
+		BufferTag	bufTag;		/* identity of requested block */
+		LWLock	   *bufPartitionLock;	/* buffer partition lock for it */
+		int			buf_id;
+		BufferDesc *bufHdr;
+		uint32		buf_state;
+
+		/* create a tag so we can lookup the buffer */
+		INIT_BUFFERTAG(bufTag, rnode, forkNum, curBlock);
+
+		/* determine its hash code and partition lock ID */
+		bufHash = BufTableHashCode(&bufTag);
+		bufPartitionLock = BufMappingPartitionLock(bufHash);
+
+		/* Check that it is in the buffer pool.  If not, do nothing. */
+		LWLockAcquire(bufPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&bufTag, bufHash);
+		LWLockRelease(bufPartitionLock);
+
+		if (buf_id < 0)
+			continue;
+
+		bufHdr = GetBufferDescriptor(buf_id);
+
+		/*
+		 * We need to lock the buffer header and recheck if the buffer is
+		 * still associated with the same block because the buffer could be
+		 * evicted by some other backend loading blocks for a different
+		 * relation after we release the partition lock.
+		 */
+		buf_state = LockBufHdr(bufHdr);
+
+		if (RelFileNodeEquals(bufHdr->tag.rnode, rnode) &&
+			bufHdr->tag.forkNum == forkNum &&
+			bufHdr->tag.blockNum >= firstDelBlock)
+			InvalidateBuffer(bufHdr);	/* releases spinlock */
+		else
+			UnlockBufHdr(bufHdr, buf_state);
+	}
+}
+
 /* ---------------------------------------------------------------------
  *		DropDatabaseBuffers
  *
@@ -4018,6 +4566,44 @@ AbortBufferIO(void)
 		}
 		TerminateBufferIO(buf, false, BM_IO_ERROR);
 	}
+
+	if (NumAsyncWrites > 0)
+		AbortAsyncBufferWrites();
+}
+
+/*
+ * Clean up after asynchronous writes that were in flight when we hit an
+ * error, in the same way AbortBufferIO does for synchronous I/O.  The pins
+ * are left for resource owner cleanup to release.
+ */
+static void
+AbortAsyncBufferWrites(void)
+{
+	BufferDesc *bufs[AIO_MAX_IN_FLIGHT];
+	int			nbufs = 0;
+	int			i;
+
+	/* The kernel mustn't write our copies after someone else's */
+	AioAbortAll();
+
+	for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+	{
+		if (AsyncWrites[i].buf != NULL)
+			bufs[nbufs++] = AsyncWrites[i].buf;
+		AsyncWrites[i].buf = NULL;
+		AsyncWrites[i].pending = false;
+	}
+	Assert(nbufs == NumAsyncWrites);
+	NumAsyncWrites = 0;
+	NumPendingWrites = 0;
+
+	/* Treat each of them like a failed synchronous write */
+	for (i = 0; i < nbufs; i++)
+	{
+		InProgressBuf = bufs[i];
+		IsForInput = false;
+		AbortBufferIO();
+	}
 }
 
 /*
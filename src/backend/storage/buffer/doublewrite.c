@@ -0,0 +1,623 @@
+/*-------------------------------------------------------------------------
+ *
+ * doublewrite.c
+ *	  Double-write buffer, an alternative to full-page writes.
+ *
+ * A crash in the middle of writing a data page can leave the page torn,
+ * partly old and partly new.  Normally, the first WAL record touching a
+ * page after each checkpoint carries a full image of the page, so that
+ * redo can replace a torn page wholesale.  With double_write enabled,
+ * full-page images are not logged.  Instead, every write of a permanent
+ * shared buffer first appends a copy of the page to a double-write file in
+ * pg_dblwr/, and fsyncs it, before the page is written in place.  If the
+ * in-place write is torn by a crash, crash recovery finds an intact copy in
+ * the double-write file and puts it back before replaying WAL.  A copy that
+ * was itself torn fails its CRC check and is ignored, but then the in-place
+ * write hadn't started yet.
+ *
+ * The double-write files are numbered by generation.  A checkpoint (or
+ * restartpoint) switches to a new file before it starts writing buffers,
+ * and removes the older files once the buffers are flushed and the data
+ * files fsynced, since the in-place writes they protect are then durable.
+ * Writers hold DoubleWriteLock in shared mode from the double write until
+ * the in-place write has been issued, so taking the lock exclusively to
+ * switch files waits for writes to the old file to be finished.  The space
+ * for each batch of pages is reserved in the file with an atomic counter.
+ * Each buffer is written by only one process at a time, so successive
+ * copies of a page appear in the files in the order they were written,
+ * and the last valid copy of a page is the one recovery needs.
+ *
+ * Writing each page twice, and fsyncing the double-write file for every
+ * write, is more expensive than a plain write.  The checkpointer writes its
+ * pages in batches (see bufmgr.c), though, and other processes write one
+ * page at a time but share fsyncs like WAL group commit: a writer waits for
+ * DoubleWriteSyncLock, and if the process holding it has meanwhile synced
+ * the file, its copy is covered already.  In exchange, WAL volume after a
+ * checkpoint drops sharply for random-update workloads.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/doublewrite.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "port/pg_crc32c.h"
+#include "storage/bufpage.h"
+#include "storage/doublewrite.h"
+#include "storage/fd.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+
+/* GUC variable */
+bool		double_write = false;
+
+/* Header of each entry in a double-write file; the page follows it */
+typedef struct DoubleWriteHeader
+{
+	uint32		magic;			/* DOUBLE_WRITE_MAGIC */
+	pg_crc32c	crc;			/* CRC of the entry, with this field zeroed */
+	RelFileNode rnode;			/* location of the page */
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} DoubleWriteHeader;
+
+#define DOUBLE_WRITE_MAGIC		0x44574231	/* "DWB1" */
+
+#define DoubleWriteHeaderSize	MAXALIGN(sizeof(DoubleWriteHeader))
+#define DoubleWriteEntrySize	(DoubleWriteHeaderSize + BLCKSZ)
+
+/*
+ * Shared state.  The fsyncs of the double-write files are numbered; they
+ * are done one at a time, under DoubleWriteSyncLock, and fsyncs_done is
+ * advanced past each one when it has finished.
+ */
+typedef struct DoubleWriteCtlData
+{
+	uint64		gen;			/* current file; protected by DoubleWriteLock */
+	pg_atomic_uint64 next_entry;	/* next free entry in the current file */
+	pg_atomic_uint64 fsyncs_started;	/* number of fsyncs started */
+	pg_atomic_uint64 fsyncs_done;	/* number of fsyncs finished */
+} DoubleWriteCtlData;
+
+static DoubleWriteCtlData *DoubleWriteCtl = NULL;
+
+/* Latest copy of a page, found by DoubleWriteRecover */
+typedef struct DoubleWriteRecoverEnt
+{
+	BufferTag	tag;			/* hash key */
+	int			file;			/* index of the file in the list */
+	off_t		offset;			/* location of the entry in the file */
+} DoubleWriteRecoverEnt;
+
+/* Buffer for assembling entries, enlarged as needed */
+static char *entryBuffer = NULL;
+static int	entryBufferPages = 0;
+
+static void DoubleWriteFilePath(char *path, uint64 gen);
+static int	DoubleWriteListFiles(uint64 **gens);
+static void DoubleWriteCreateFile(uint64 gen);
+static void DoubleWriteSync(int fd, const char *path);
+static void DoubleWriteScanFile(int fd, const char *path, int file,
+					HTAB *copies, char *entry);
+
+
+/*
+ * Report shared-memory space needed by DoubleWriteShmemInit
+ */
+Size
+DoubleWriteShmemSize(void)
+{
+	return sizeof(DoubleWriteCtlData);
+}
+
+/*
+ * Initialize shared state, and the file for the current generation
+ */
+void
+DoubleWriteShmemInit(void)
+{
+	bool		found;
+
+	DoubleWriteCtl = (DoubleWriteCtlData *)
+		ShmemInitStruct("Double Write Ctl", DoubleWriteShmemSize(), &found);
+
+	if (!found)
+	{
+		uint64	   *gens;
+		int			ngens;
+
+		/* Start after any files left behind, so recovery can read them */
+		ngens = DoubleWriteListFiles(&gens);
+		DoubleWriteCtl->gen = (ngens > 0) ? gens[ngens - 1] + 1 : 1;
+		pg_atomic_init_u64(&DoubleWriteCtl->next_entry, 0);
+		pg_atomic_init_u64(&DoubleWriteCtl->fsyncs_started, 0);
+		pg_atomic_init_u64(&DoubleWriteCtl->fsyncs_done, 0);
+		if (gens)
+			pfree(gens);
+
+		if (double_write)
+			DoubleWriteCreateFile(DoubleWriteCtl->gen);
+	}
+}
+
+/*
+ * Construct the path of the double-write file of the given generation.
+ */
+static void
+DoubleWriteFilePath(char *path, uint64 gen)
+{
+	snprintf(path, MAXPGPATH, DOUBLE_WRITE_DIR "/%08X%08X",
+			 (uint32) (gen >> 32), (uint32) gen);
+}
+
+/*
+ * Return the generations of the existing double-write files in *gens, in
+ * ascending order, and their number as the result.  *gens is palloc'd, or
+ * NULL if there are no files.
+ */
+static int
+DoubleWriteListFiles(uint64 **gens)
+{
+	DIR		   *dir;
+	struct dirent *de;
+	int			ngens = 0;
+	int			maxgens = 0;
+	int			i;
+
+	*gens = NULL;
+
+	dir = AllocateDir(DOUBLE_WRITE_DIR);
+	if (dir == NULL && errno == ENOENT)
+		return 0;
+	while ((de = ReadDir(dir, DOUBLE_WRITE_DIR)) != NULL)
+	{
+		uint32		hi;
+		uint32		lo;
+		uint64		gen;
+
+		if (strlen(de->d_name) != 16 ||
+			strspn(de->d_name, "0123456789ABCDEF") != 16)
+			continue;
+		sscanf(de->d_name, "%08X%08X", &hi, &lo);
+		gen = ((uint64) hi << 32) | lo;
+
+		if (ngens >= maxgens)
+		{
+			maxgens = Max(2 * maxgens, 8);
+			if (*gens == NULL)
+				*gens = palloc(maxgens * sizeof(uint64));
+			else
+				*gens = repalloc(*gens, maxgens * sizeof(uint64));
+		}
+
+		/* Insertion sort; there are only ever a few files */
+		for (i = ngens; i > 0 && (*gens)[i - 1] > gen; i--)
+			(*gens)[i] = (*gens)[i - 1];
+		(*gens)[i] = gen;
+		ngens++;
+	}
+	FreeDir(dir);
+
+	return ngens;
+}
+
+/*
+ * Create the double-write file of the given generation, and make sure it
+ * stays there.
+ */
+static void
+DoubleWriteCreateFile(uint64 gen)
+{
+	char		path[MAXPGPATH];
+	int			fd;
+
+	if (mkdir(DOUBLE_WRITE_DIR, S_IRWXU) < 0 && errno != EEXIST)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create directory \"%s\": %m",
+						DOUBLE_WRITE_DIR)));
+
+	DoubleWriteFilePath(path, gen);
+	fd = BasicOpenFile(path, O_RDWR | O_CREAT | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", path)));
+	if (pg_fsync(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", path)));
+	close(fd);
+
+	fsync_fname(DOUBLE_WRITE_DIR, true);
+}
+
+/*
+ * DoubleWritePages
+ *		Append copies of the given pages to the double-write file, and wait
+ *		for them to reach stable storage.
+ *
+ * tags[i] identifies the page in pages[i].  The caller must hold
+ * DoubleWriteLock in shared mode, and keep holding it until the in-place
+ * writes of the pages have been issued.  The pages mustn't change until
+ * then either, so that the in-place writes match the copies; the caller
+ * should write from private copies of the buffers.
+ */
+void
+DoubleWritePages(const BufferTag *tags, char **pages, int npages)
+{
+	char		path[MAXPGPATH];
+	Size		len = (Size) npages * DoubleWriteEntrySize;
+	off_t		offset;
+	int			fd;
+	int			i;
+
+	Assert(LWLockHeldByMe(DoubleWriteLock));
+	Assert(npages > 0);
+
+	if (npages > entryBufferPages)
+	{
+		/* allocate first, so that an error leaves the old buffer in place */
+		char	   *newBuffer = MemoryContextAlloc(TopMemoryContext, len);
+
+		if (entryBuffer)
+			pfree(entryBuffer);
+		entryBuffer = newBuffer;
+		entryBufferPages = npages;
+	}
+
+	for (i = 0; i < npages; i++)
+	{
+		char	   *entry = entryBuffer + (Size) i * DoubleWriteEntrySize;
+		DoubleWriteHeader *hdr = (DoubleWriteHeader *) entry;
+		pg_crc32c	crc;
+
+		MemSet(entry, 0, DoubleWriteHeaderSize);
+		hdr->magic = DOUBLE_WRITE_MAGIC;
+		hdr->rnode = tags[i].rnode;
+		hdr->forknum = tags[i].forkNum;
+		hdr->blkno = tags[i].blockNum;
+		memcpy(entry + DoubleWriteHeaderSize, pages[i], BLCKSZ);
+
+		INIT_CRC32C(crc);
+		COMP_CRC32C(crc, entry, DoubleWriteEntrySize);
+		FIN_CRC32C(crc);
+		hdr->crc = crc;
+	}
+
+	/*
+	 * The file is opened for each batch rather than kept open, so that
+	 * processes that stop writing don't keep removed files alive.
+	 */
+	DoubleWriteFilePath(path, DoubleWriteCtl->gen);
+	fd = BasicOpenFile(path, O_RDWR | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+
+	offset = (off_t) pg_atomic_fetch_add_u64(&DoubleWriteCtl->next_entry,
+											 npages) * DoubleWriteEntrySize;
+
+	errno = 0;
+	pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_WRITE);
+	if (lseek(fd, offset, SEEK_SET) < 0 ||
+		write(fd, entryBuffer, len) != (ssize_t) len)
+	{
+		int			save_errno = errno;
+
+		pgstat_report_wait_end();
+		close(fd);
+		/* if write didn't set errno, assume problem is no disk space */
+		errno = save_errno ? save_errno : ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m", path)));
+	}
+	pgstat_report_wait_end();
+
+	DoubleWriteSync(fd, path);
+
+	close(fd);
+}
+
+/*
+ * DoubleWriteSync
+ *		Wait for the entries we just wrote to fd to reach stable storage.
+ *
+ * Any fsync of the file that starts after our write has finished covers
+ * it, no matter through which file descriptor it is done.  So if another
+ * process is busy syncing, we wait for it, and then check if a later fsync
+ * has been done for us meanwhile, just as XLogFlush() does for WAL.  The
+ * caller holds DoubleWriteLock, so all the writers involved are writing to
+ * the same file.
+ *
+ * A failed fsync is not retried.  The kernel may have dropped the dirty
+ * pages already, so a retry could report success for copies that never
+ * reached the disk, and the writers waiting for us would trust them.  We
+ * PANIC instead; none of the data pages involved have been written yet, so
+ * crash recovery replays them from WAL as before.
+ */
+static void
+DoubleWriteSync(int fd, const char *path)
+{
+	uint64		needed;
+
+	/* The next fsync to start is the first one that covers our write */
+	pg_memory_barrier();
+	needed = pg_atomic_read_u64(&DoubleWriteCtl->fsyncs_started) + 1;
+
+	for (;;)
+	{
+		uint64		fsyncno;
+
+		if (pg_atomic_read_u64(&DoubleWriteCtl->fsyncs_done) >= needed)
+			break;
+
+		/*
+		 * Wait for the lock, and if someone else held it, recheck whether
+		 * they did the fsync for us.
+		 */
+		if (!LWLockAcquireOrWait(DoubleWriteSyncLock, LW_EXCLUSIVE))
+			continue;
+
+		if (pg_atomic_read_u64(&DoubleWriteCtl->fsyncs_done) >= needed)
+		{
+			LWLockRelease(DoubleWriteSyncLock);
+			break;
+		}
+
+		fsyncno = pg_atomic_add_fetch_u64(&DoubleWriteCtl->fsyncs_started, 1);
+
+		pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_SYNC);
+		if (pg_fdatasync(fd) != 0)
+			ereport(PANIC,
+					(errcode_for_file_access(),
+					 errmsg("could not fdatasync file \"%s\": %m", path)));
+		pgstat_report_wait_end();
+
+		pg_atomic_write_u64(&DoubleWriteCtl->fsyncs_done, fsyncno);
+		LWLockRelease(DoubleWriteSyncLock);
+		break;
+	}
+}
+
+/*
+ * DoubleWriteStartCheckpoint
+ *		Switch to a new double-write file at the start of a checkpoint or
+ *		restartpoint.
+ *
+ * Returns the generation of the files that must be kept after the
+ * checkpoint has flushed all buffers; pass it to DoubleWriteEndCheckpoint.
+ */
+uint64
+DoubleWriteStartCheckpoint(void)
+{
+	uint64		gen;
+
+	/* Wait for writes to the old file to be issued */
+	LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+	if (double_write)
+	{
+		DoubleWriteCreateFile(DoubleWriteCtl->gen + 1);
+		DoubleWriteCtl->gen++;
+		pg_atomic_write_u64(&DoubleWriteCtl->next_entry, 0);
+	}
+	gen = DoubleWriteCtl->gen;
+	LWLockRelease(DoubleWriteLock);
+
+	return gen;
+}
+
+/*
+ * DoubleWriteEndCheckpoint
+ *		Remove the double-write files older than keep_gen, after the data
+ *		files have been fsynced by a checkpoint or restartpoint.
+ *
+ * This also removes files left behind by a crash, once the pages restored
+ * from them are safely on disk.
+ */
+void
+DoubleWriteEndCheckpoint(uint64 keep_gen)
+{
+	uint64	   *gens;
+	int			ngens;
+	int			i;
+
+	ngens = DoubleWriteListFiles(&gens);
+	for (i = 0; i < ngens && gens[i] < keep_gen; i++)
+	{
+		char		path[MAXPGPATH];
+
+		DoubleWriteFilePath(path, gens[i]);
+		elog(DEBUG2, "removing double-write file \"%s\"", path);
+		if (unlink(path) < 0)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m", path)));
+	}
+	if (gens)
+		pfree(gens);
+}
+
+/*
+ * DoubleWriteRecover
+ *		Repair pages torn by a crash, from the copies in the double-write
+ *		files.
+ *
+ * Called at the start of crash or archive recovery, before WAL replay.
+ * Only the latest valid copy of each page matters, since it belongs to the
+ * last write of the page that was started.  We first scan all the files to
+ * find those copies, and then write back the ones that differ from the data
+ * files.  The files are left in place until the next checkpoint or
+ * restartpoint has made the restored pages durable.
+ */
+void
+DoubleWriteRecover(void)
+{
+	uint64	   *gens;
+	int		   *fds;
+	int			ngens;
+	HASHCTL		info;
+	HTAB	   *copies;
+	HASH_SEQ_STATUS status;
+	DoubleWriteRecoverEnt *ent;
+	char	   *entry;
+	char	   *curpage;
+	int			restored = 0;
+	int			i;
+
+	ngens = DoubleWriteListFiles(&gens);
+	if (ngens == 0)
+		return;
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(BufferTag);
+	info.entrysize = sizeof(DoubleWriteRecoverEnt);
+	copies = hash_create("Double Write Recovery", 1024, &info,
+						 HASH_ELEM | HASH_BLOBS);
+
+	fds = palloc(ngens * sizeof(int));
+	entry = palloc(DoubleWriteEntrySize);
+	curpage = palloc(BLCKSZ);
+
+	for (i = 0; i < ngens; i++)
+	{
+		char		path[MAXPGPATH];
+
+		DoubleWriteFilePath(path, gens[i]);
+		fds[i] = BasicOpenFile(path, O_RDONLY | PG_BINARY);
+		if (fds[i] < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", path)));
+		DoubleWriteScanFile(fds[i], path, i, copies, entry);
+	}
+
+	hash_seq_init(&status, copies);
+	while ((ent = (DoubleWriteRecoverEnt *) hash_seq_search(&status)) != NULL)
+	{
+		char	   *page = entry + DoubleWriteHeaderSize;
+		SMgrRelation reln;
+
+		pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_READ);
+		if (lseek(fds[ent->file], ent->offset, SEEK_SET) < 0 ||
+			read(fds[ent->file], entry, DoubleWriteEntrySize) != DoubleWriteEntrySize)
+		{
+			char		path[MAXPGPATH];
+
+			pgstat_report_wait_end();
+			DoubleWriteFilePath(path, gens[ent->file]);
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", path)));
+		}
+		pgstat_report_wait_end();
+
+		/*
+		 * Skip pages that no longer exist; the relation must have been
+		 * dropped or truncated since, and WAL replay will take care of it.
+		 */
+		reln = smgropen(ent->tag.rnode, InvalidBackendId);
+		if (!smgrexists(reln, ent->tag.forkNum) ||
+			ent->tag.blockNum >= smgrnblocks(reln, ent->tag.forkNum))
+			continue;
+
+		/*
+		 * Also skip the page if the write completed, or if the data file has
+		 * a newer version of the page that was written without going through
+		 * the buffer manager.
+		 */
+		smgrread(reln, ent->tag.forkNum, ent->tag.blockNum, curpage);
+		if (memcmp(curpage, page, BLCKSZ) == 0 ||
+			PageGetLSN((Page) curpage) > PageGetLSN((Page) page))
+			continue;
+
+		elog(DEBUG1, "restoring block %u of relation %u/%u/%u fork %d from the double-write buffer",
+			 ent->tag.blockNum, ent->tag.rnode.spcNode,
+			 ent->tag.rnode.dbNode, ent->tag.rnode.relNode,
+			 ent->tag.forkNum);
+		smgrwrite(reln, ent->tag.forkNum, ent->tag.blockNum, page, false);
+		restored++;
+	}
+
+	for (i = 0; i < ngens; i++)
+		close(fds[i]);
+	hash_destroy(copies);
+	pfree(fds);
+	pfree(entry);
+	pfree(curpage);
+	pfree(gens);
+
+	if (restored > 0)
+		ereport(LOG,
+				(errmsg("restored %d pages from the double-write buffer",
+						restored)));
+}
+
+/*
+ * Remember the location of each valid entry in one double-write file in
+ * "copies", replacing those of earlier copies of the same pages.  "entry"
+ * is workspace of DoubleWriteEntrySize bytes.
+ */
+static void
+DoubleWriteScanFile(int fd, const char *path, int file, HTAB *copies,
+					char *entry)
+{
+	DoubleWriteHeader *hdr = (DoubleWriteHeader *) entry;
+	off_t		offset = 0;
+
+	for (;; offset += DoubleWriteEntrySize)
+	{
+		DoubleWriteRecoverEnt *ent;
+		BufferTag	tag;
+		pg_crc32c	expected_crc;
+		pg_crc32c	crc;
+		int			nread;
+
+		pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_READ);
+		nread = read(fd, entry, DoubleWriteEntrySize);
+		pgstat_report_wait_end();
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", path)));
+		/* A partial entry at the end can only be a torn copy */
+		if (nread < DoubleWriteEntrySize)
+			break;
+
+		/* Skip unused and torn entries */
+		if (hdr->magic != DOUBLE_WRITE_MAGIC)
+			continue;
+		expected_crc = hdr->crc;
+		hdr->crc = 0;
+		INIT_CRC32C(crc);
+		COMP_CRC32C(crc, entry, DoubleWriteEntrySize);
+		FIN_CRC32C(crc);
+		if (!EQ_CRC32C(crc, expected_crc))
+			continue;
+		if (hdr->forknum < 0 || hdr->forknum > MAX_FORKNUM)
+			continue;
+
+		INIT_BUFFERTAG(tag, hdr->rnode, hdr->forknum, hdr->blkno);
+		ent = (DoubleWriteRecoverEnt *) hash_search(copies, &tag, HASH_ENTER,
+													NULL);
+		ent->file = file;
+		ent->offset = offset;
+	}
+}
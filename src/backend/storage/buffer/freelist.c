@@ -104,68 +104,98 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
 				BufferDesc *buf);
 
 /*
- * ClockSweepTick - Helper routine for StrategyGetBuffer()
+ * Number of clock sweep positions a backend claims from the shared hand at a
+ * time.  Advancing the hand one buffer at a time makes every backend that is
+ * looking for a victim hit the same cache line, which becomes a bottleneck
+ * when many backends are evicting at once; claiming a few consecutive
+ * buffers per atomic operation cuts that traffic proportionally.
+ */
+#define CLOCK_SWEEP_BATCH	16
+
+/*
+ * This backend's claimed range of clock sweep positions.  Like the shared
+ * hand, these only increase and have to be taken modulo NBuffers.  We may
+ * hold on to part of a batch across StrategyGetBuffer calls, so a few buffers
+ * may get visited out of order, but the sweep has always tolerated that.
+ */
+static uint32 MySweepNext = 0;
+static uint32 MySweepEnd = 0;
+
+/*
+ * ClockSweepClaimBatch - Helper routine for ClockSweepTick()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Move the clock hand ahead by a batch of buffers, which become ours to
+ * consider.
  */
-static inline uint32
-ClockSweepTick(void)
+static void
+ClockSweepClaimBatch(void)
 {
-	uint32		victim;
+	uint32		batch = Min(CLOCK_SWEEP_BATCH, NBuffers);
+	uint32		start;
+	uint64		nextwrap;
 
 	/*
-	 * Atomically move hand ahead one buffer - if there's several processes
-	 * doing this, this can lead to buffers being returned slightly out of
-	 * apparent order.
+	 * Atomically move hand ahead - if there's several processes doing this,
+	 * this can lead to buffers being returned slightly out of apparent order.
 	 */
-	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+	start = pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, batch);
 
-	if (victim >= NBuffers)
+	MySweepNext = start;
+	MySweepEnd = start + batch;
+
+	/*
+	 * If our batch includes the position where the hand completes a pass,
+	 * force completePasses to be incremented while holding the spinlock. We
+	 * need the spinlock so StrategySyncStart() can return a consistent value
+	 * consisting of nextVictimBuffer and completePasses.
+	 */
+	nextwrap = ((uint64) start + NBuffers - 1) / NBuffers * NBuffers;
+	if (nextwrap >= (uint64) NBuffers && nextwrap < (uint64) MySweepEnd)
 	{
-		uint32		originalVictim = victim;
+		uint32		expected;
+		uint32		wrapped;
+		bool		success = false;
 
-		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+		expected = MySweepEnd;
 
-		/*
-		 * If we're the one that just caused a wraparound, force
-		 * completePasses to be incremented while holding the spinlock. We
-		 * need the spinlock so StrategySyncStart() can return a consistent
-		 * value consisting of nextVictimBuffer and completePasses.
-		 */
-		if (victim == 0)
+		while (!success)
 		{
-			uint32		expected;
-			uint32		wrapped;
-			bool		success = false;
+			/*
+			 * Acquire the spinlock while increasing completePasses. That
+			 * allows other readers to read nextVictimBuffer and
+			 * completePasses in a consistent manner which is required for
+			 * StrategySyncStart().  In theory delaying the increment could
+			 * lead to an overflow of nextVictimBuffers, but that's highly
+			 * unlikely and wouldn't be particularly harmful.
+			 */
+			SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
 
-			expected = originalVictim + 1;
+			wrapped = expected % NBuffers;
 
-			while (!success)
-			{
-				/*
-				 * Acquire the spinlock while increasing completePasses. That
-				 * allows other readers to read nextVictimBuffer and
-				 * completePasses in a consistent manner which is required for
-				 * StrategySyncStart().  In theory delaying the increment
-				 * could lead to an overflow of nextVictimBuffers, but that's
-				 * highly unlikely and wouldn't be particularly harmful.
-				 */
-				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-
-				wrapped = expected % NBuffers;
-
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
-														 &expected, wrapped);
-				if (success)
-					StrategyControl->completePasses++;
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
-			}
+			success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+													 &expected, wrapped);
+			if (success)
+				StrategyControl->completePasses++;
+			SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 		}
 	}
-	return victim;
+}
+
+/*
+ * ClockSweepTick - Helper routine for StrategyGetBuffer()
+ *
+ * Move our clock hand one buffer ahead of its current position, claiming a
+ * new batch from the shared hand if needed, and return the id of the buffer
+ * now under the hand.
+ */
+static inline uint32
+ClockSweepTick(void)
+{
+	if (MySweepNext == MySweepEnd)
+		ClockSweepClaimBatch();
+
+	/* always wrap what we look up in BufferDescriptors */
+	return MySweepNext++ % NBuffers;
 }
 
 /*
@@ -0,0 +1,414 @@
+/*-------------------------------------------------------------------------
+ *
+ * aio.c
+ *	  Asynchronous I/O.
+ *
+ * This lets a process start a number of writes, go on with other work, and
+ * deal with the results later.  Only writes are supported so far.  Each
+ * operation is started with a callback, which is run by AioComplete() once
+ * the kernel reports the operation as finished.  Callbacks are never run by
+ * the function that starts an operation, so the caller may still hold
+ * whatever locks it needs to set up the operation.  A callback may throw an
+ * error; the caller's error recovery must then call AioAbortAll() before
+ * releasing any memory or buffers that operations might still be using.
+ *
+ * Currently the only implementation uses Linux's io_uring, set up lazily
+ * in each process that wants it.  Where that isn't available, or the kernel
+ * refuses to set up a ring, AioEnabled() returns false and callers are
+ * expected to do their I/O synchronously as before.
+ *
+ * We talk to the kernel directly rather than through liburing, since we
+ * only need a small fraction of what it offers.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/file/aio.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/aio.h"
+
+/* GUC parameter */
+int			io_method = IO_METHOD_SYNC;
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+/*
+ * State of one asynchronous operation.  The io_uring user_data of each
+ * submission is the index of its AioOp.
+ */
+typedef struct AioOp
+{
+	bool		in_use;			/* submitted, callback not yet run */
+	bool		done;			/* kernel has reported completion */
+	int			result;			/* result reported by the kernel */
+	uint32		wait_event_info;	/* to report while waiting for it */
+	AioCallback callback;
+	void	   *arg;
+	struct iovec iov;			/* must stay valid until completion */
+} AioOp;
+
+static AioOp aio_ops[AIO_MAX_IN_FLIGHT];
+static int	aio_num_in_flight = 0;
+
+/* The io_uring, mapped into our address space */
+static int	ring_fd = -1;
+static bool ring_failed = false;
+
+static volatile unsigned *sq_head;
+static volatile unsigned *sq_tail;
+static unsigned sq_mask;
+static unsigned *sq_array;
+static struct io_uring_sqe *sqes;
+
+static volatile unsigned *cq_head;
+static volatile unsigned *cq_tail;
+static unsigned cq_mask;
+static struct io_uring_cqe *cqes;
+
+static bool aio_setup_ring(void);
+static int	aio_enter(unsigned to_submit, unsigned min_complete);
+static void aio_reap(void);
+
+/*
+ * Create this process's io_uring and map its queues.  Returns false, having
+ * logged the reason, if that can't be done.
+ */
+static bool
+aio_setup_ring(void)
+{
+	struct io_uring_params p;
+	size_t		sq_size;
+	size_t		cq_size;
+	char	   *sq_ptr;
+	char	   *cq_ptr;
+
+	memset(&p, 0, sizeof(p));
+	ring_fd = syscall(__NR_io_uring_setup, AIO_MAX_IN_FLIGHT, &p);
+	if (ring_fd < 0)
+		goto fail;
+
+	sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		sq_size = cq_size = Max(sq_size, cq_size);
+
+	sq_ptr = mmap(NULL, sq_size, PROT_READ | PROT_WRITE,
+				  MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+	if (sq_ptr == MAP_FAILED)
+		goto fail;
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		cq_ptr = sq_ptr;
+	else
+	{
+		cq_ptr = mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+					  MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+		if (cq_ptr == MAP_FAILED)
+			goto fail;
+	}
+
+	sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+				PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				ring_fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+		goto fail;
+
+	sq_head = (unsigned *) (sq_ptr + p.sq_off.head);
+	sq_tail = (unsigned *) (sq_ptr + p.sq_off.tail);
+	sq_mask = *(unsigned *) (sq_ptr + p.sq_off.ring_mask);
+	sq_array = (unsigned *) (sq_ptr + p.sq_off.array);
+
+	cq_head = (unsigned *) (cq_ptr + p.cq_off.head);
+	cq_tail = (unsigned *) (cq_ptr + p.cq_off.tail);
+	cq_mask = *(unsigned *) (cq_ptr + p.cq_off.ring_mask);
+	cqes = (struct io_uring_cqe *) (cq_ptr + p.cq_off.cqes);
+
+	return true;
+
+fail:
+	ereport(LOG,
+			(errcode_for_file_access(),
+			 errmsg("could not set up io_uring, falling back to synchronous I/O: %m")));
+	if (ring_fd >= 0)
+		close(ring_fd);			/* any mappings stay, but we only get here once */
+	ring_fd = -1;
+	ring_failed = true;
+	return false;
+}
+
+/*
+ * Submit queued operations and/or wait for completions.  Returns the number
+ * of operations submitted, or -1 with errno set.
+ */
+static int
+aio_enter(unsigned to_submit, unsigned min_complete)
+{
+	int			rc;
+
+	do
+	{
+		rc = syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+					 min_complete > 0 ? IORING_ENTER_GETEVENTS : 0,
+					 NULL, 0);
+	} while (rc < 0 && errno == EINTR);
+
+	return rc;
+}
+
+/*
+ * Move everything from the completion queue into aio_ops.
+ */
+static void
+aio_reap(void)
+{
+	unsigned	head = *cq_head;
+
+	for (;;)
+	{
+		struct io_uring_cqe *cqe;
+		AioOp	   *op;
+
+		/* Read the tail before the entries it covers */
+		if (head == *cq_tail)
+			break;
+		pg_read_barrier();
+
+		cqe = &cqes[head & cq_mask];
+		Assert(cqe->user_data < AIO_MAX_IN_FLIGHT);
+		op = &aio_ops[cqe->user_data];
+		Assert(op->in_use && !op->done);
+		op->result = cqe->res;
+		op->done = true;
+		head++;
+	}
+
+	/* Let the kernel reuse the entries only after we've read them */
+	pg_memory_barrier();
+	*cq_head = head;
+}
+
+#endif							/* HAVE_LINUX_IO_URING_H */
+
+/*
+ * Can asynchronous I/O be used in this process?
+ */
+bool
+AioEnabled(void)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+	if (io_method != IO_METHOD_IO_URING || ring_failed)
+		return false;
+	if (ring_fd < 0 && !aio_setup_ring())
+		return false;
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ * Start writing "amount" bytes from "buffer" to kernel file descriptor "fd"
+ * at "offset".  The buffer must not be modified or freed until "callback"
+ * has been called.
+ *
+ * Returns 0 if the write was started, otherwise -1 with errno set.  The
+ * caller must make sure that AioEnabled() and that fewer than
+ * AIO_MAX_IN_FLIGHT operations are in flight.
+ */
+int
+AioStartWrite(int fd, char *buffer, int amount, off_t offset,
+			  uint32 wait_event_info, AioCallback callback, void *arg)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+	struct io_uring_sqe *sqe;
+	AioOp	   *op;
+	unsigned	tail;
+	int			rc;
+	int			i;
+
+	Assert(ring_fd >= 0);
+
+	for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+		if (!aio_ops[i].in_use)
+			break;
+	if (i == AIO_MAX_IN_FLIGHT)
+		elog(ERROR, "too many asynchronous I/O operations in flight");
+
+	op = &aio_ops[i];
+	op->done = false;
+	op->result = 0;
+	op->wait_event_info = wait_event_info;
+	op->callback = callback;
+	op->arg = arg;
+	op->iov.iov_base = buffer;
+	op->iov.iov_len = amount;
+
+	/* The submission queue is never full, since we submit right away */
+	tail = *sq_tail;
+	Assert(tail - *sq_head <= sq_mask);
+	sqe = &sqes[tail & sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_WRITEV;
+	sqe->fd = fd;
+	sqe->addr = (uint64) (uintptr_t) &op->iov;
+	sqe->len = 1;
+	sqe->off = offset;
+	sqe->user_data = i;
+	sq_array[tail & sq_mask] = tail & sq_mask;
+
+	/* The kernel must see the entry before the new tail */
+	pg_write_barrier();
+	*sq_tail = tail + 1;
+
+	/*
+	 * Submit it now.  Besides starting the I/O as early as possible, that
+	 * makes the kernel take its own reference to the file, so fd.c is free to
+	 * close "fd" as soon as we return.
+	 */
+	rc = aio_enter(1, 0);
+	if (rc <= 0)
+	{
+		/*
+		 * Nothing was consumed, so take the entry back, lest the next
+		 * aio_enter() submit it for a slot that isn't in use.  (An invalid
+		 * entry would have been consumed, and reported through a completion
+		 * entry instead.)
+		 */
+		*sq_tail = tail;
+		if (rc == 0)
+			errno = EAGAIN;
+		return -1;
+	}
+
+	op->in_use = true;
+	aio_num_in_flight++;
+	return 0;
+#else
+	elog(ERROR, "asynchronous I/O is not supported by this build");
+	return -1;					/* keep compiler quiet */
+#endif
+}
+
+/*
+ * How many operations are in flight, including completed ones whose
+ * callbacks haven't been run?
+ */
+int
+AioInFlight(void)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+	return aio_num_in_flight;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Run the callbacks of operations that have completed.  If "wait" is true
+ * and there are operations in flight, first wait until at least one has.
+ */
+void
+AioComplete(bool wait)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+	bool		any_done = false;
+	int			i;
+
+	if (aio_num_in_flight == 0)
+		return;
+
+	aio_reap();
+	for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+		if (aio_ops[i].in_use && aio_ops[i].done)
+			any_done = true;
+
+	if (wait && !any_done)
+	{
+		uint32		wait_event_info = 0;
+
+		for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+			if (aio_ops[i].in_use)
+				wait_event_info = aio_ops[i].wait_event_info;
+
+		pgstat_report_wait_start(wait_event_info);
+		if (aio_enter(0, 1) < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not wait for asynchronous I/O: %m")));
+		pgstat_report_wait_end();
+		aio_reap();
+	}
+
+	for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+	{
+		AioOp	   *op = &aio_ops[i];
+
+		if (!op->in_use || !op->done)
+			continue;
+
+		/* Forget the operation first, in case the callback throws an error */
+		op->in_use = false;
+		aio_num_in_flight--;
+		op->callback(op->arg, op->result);
+	}
+#endif
+}
+
+/*
+ * Run the callbacks of all operations in flight, waiting as necessary.
+ */
+void
+AioCompleteAll(void)
+{
+	while (AioInFlight() > 0)
+		AioComplete(true);
+}
+
+/*
+ * Wait for the kernel to finish all operations in flight, and forget them
+ * without running their callbacks.  This is for error recovery: once it
+ * returns, the kernel no longer uses any buffer handed to AioStartWrite().
+ */
+void
+AioAbortAll(void)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+	int			i;
+
+	for (;;)
+	{
+		bool		pending = false;
+
+		aio_reap();
+		for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+			if (aio_ops[i].in_use && !aio_ops[i].done)
+				pending = true;
+		if (!pending)
+			break;
+
+		if (aio_enter(0, 1) < 0)
+			ereport(PANIC,
+					(errcode_for_file_access(),
+					 errmsg("could not wait for asynchronous I/O: %m")));
+	}
+
+	for (i = 0; i < AIO_MAX_IN_FLIGHT; i++)
+		aio_ops[i].in_use = false;
+	aio_num_in_flight = 0;
+#endif
+}
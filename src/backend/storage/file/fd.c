@@ -78,10 +78,12 @@
 #include "catalog/pg_tablespace.h"
 #include "pgstat.h"
 #include "portability/mem.h"
+#include "storage/aio.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "utils/guc.h"
 #include "utils/resowner_private.h"
+#include "utils/timestamp.h"
 
 
 /* Define PG_FLUSH_DATA_WORKS if we have an implementation for pg_flush_data */
@@ -130,6 +132,28 @@
  */
 int			max_files_per_process = 1000;
 
+/*
+ * How SyncDataDirectory() makes sure the data directory is on disk before
+ * crash recovery; see RecoveryInitSyncMethod.
+ */
+int			recovery_init_sync_method = RECOVERY_INIT_SYNC_METHOD_FSYNC;
+
+/*
+ * Which kinds of file are opened with O_DIRECT, as a mask of IO_DIRECT_XXX
+ * flags.  This is set from the io_direct GUC; the code that opens the files
+ * in question is expected to honor it.
+ */
+int			io_direct_flags = 0;
+
+/*
+ * SyncDataDirectory() can take a long time on a large cluster, so it reports
+ * its progress this often, in milliseconds.
+ */
+#define SYNC_PROGRESS_INTERVAL	10000
+
+static TimestampTz sync_start_time;
+static TimestampTz sync_last_report_time;
+
 /*
  * Maximum number of file descriptors to open for either VFD entries or
  * AllocateFile/AllocateDir/OpenTransientFile operations.  This is initialized
@@ -326,6 +350,10 @@ static void walkdir(const char *path,
 static void pre_sync_fname(const char *fname, bool isdir, int elevel);
 #endif
 static void datadir_fsync_fname(const char *fname, bool isdir, int elevel);
+static void report_sync_progress(const char *method, const char *fname);
+#ifdef HAVE_SYNCFS
+static void do_syncfs(const char *path);
+#endif
 
 static int	fsync_fname_ext(const char *fname, bool isdir, bool ignore_perm, int elevel);
 static int	fsync_parent_path(const char *fname, int elevel);
@@ -1987,6 +2015,79 @@ FileTruncate(File file, off_t offset, uint32 wait_event_info)
 	return returnCode;
 }
 
+/*
+ * Allocate disk space for the given range of the file, extending the file
+ * if needed, without writing anything.  The new space reads as zeroes.
+ *
+ * Returns 0 on success, or -1 with errno set on failure.  EOPNOTSUPP means
+ * that the platform or the filesystem doesn't support this, in which case
+ * the caller should write zeroes instead.  The seek position is unchanged.
+ */
+int
+FileFallocate(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+	/* we don't keep track of temp file sizes here */
+	Assert(!(VfdCache[file].fdstate & FD_TEMPORARY));
+
+	DO_DB(elog(LOG, "FileFallocate %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = posix_fallocate(VfdCache[file].fd, offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode == 0)
+		return 0;
+
+	/* posix_fallocate() returns an error number rather than setting errno */
+	if (returnCode == EINVAL)
+		returnCode = EOPNOTSUPP;
+	errno = returnCode;
+	return -1;
+#else
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
+/*
+ * Start an asynchronous write of the given range of the file; see aio.c.
+ * "callback" is called once the write has completed.
+ *
+ * Returns 0 if the write was started, or -1 with errno set.  The seek
+ * position is unchanged.
+ */
+int
+FileStartWrite(File file, char *buffer, int amount, off_t offset,
+			   uint32 wait_event_info, AioCallback callback, void *arg)
+{
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+	/* we don't keep track of temp file sizes here */
+	Assert(!(VfdCache[file].fdstate & FD_TEMPORARY));
+
+	DO_DB(elog(LOG, "FileStartWrite: %d (%s) " INT64_FORMAT " %d %p",
+			   file, VfdCache[file].fileName,
+			   (int64) offset, amount, buffer));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	return AioStartWrite(VfdCache[file].fd, buffer, amount, offset,
+						 wait_event_info, callback, arg);
+}
+
 /*
  * Return the pathname associated with an open file.
  *
@@ -2959,6 +3060,11 @@ looks_like_temp_rel_name(const char *name)
  * harmless cases such as read-only files in the data directory, and that's
  * not good either.
  *
+ * With recovery_init_sync_method = syncfs, we instead ask the kernel to sync
+ * each filesystem that holds part of the data directory, which is much
+ * faster when there are many files, but also syncs any unrelated files on
+ * those filesystems, and can't report errors for individual files.
+ *
  * Note we assume we're chdir'd into PGDATA to begin with.
  */
 void
@@ -2993,6 +3099,39 @@ SyncDataDirectory(void)
 		xlog_is_symlink = true;
 #endif
 
+	sync_start_time = sync_last_report_time = GetCurrentTimestamp();
+
+#ifdef HAVE_SYNCFS
+	if (recovery_init_sync_method == RECOVERY_INIT_SYNC_METHOD_SYNCFS)
+	{
+		DIR		   *dir;
+		struct dirent *de;
+
+		/*
+		 * We only expect filesystem boundaries where we follow symlinks,
+		 * namely pg_wal and the tablespaces, so those are all we sync besides
+		 * the data directory itself.
+		 */
+		do_syncfs(".");
+		if (xlog_is_symlink)
+			do_syncfs("pg_wal");
+
+		dir = AllocateDir("pg_tblspc");
+		while ((de = ReadDirExtended(dir, "pg_tblspc", LOG)))
+		{
+			char		path[MAXPGPATH];
+
+			if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+				continue;
+
+			snprintf(path, MAXPGPATH, "pg_tblspc/%s", de->d_name);
+			do_syncfs(path);
+		}
+		FreeDir(dir);
+		return;
+	}
+#endif							/* HAVE_SYNCFS */
+
 	/*
 	 * If possible, hint to the kernel that we're soon going to fsync the data
 	 * directory and its contents.  Errors in this step are even less
@@ -3113,6 +3252,8 @@ pre_sync_fname(const char *fname, bool isdir, int elevel)
 	if (isdir)
 		return;
 
+	report_sync_progress("pre-fsync", fname);
+
 	fd = OpenTransientFile(fname, O_RDONLY | PG_BINARY);
 
 	if (fd < 0)
@@ -3139,6 +3280,8 @@ pre_sync_fname(const char *fname, bool isdir, int elevel)
 static void
 datadir_fsync_fname(const char *fname, bool isdir, int elevel)
 {
+	report_sync_progress("fsync", fname);
+
 	/*
 	 * We want to silently ignoring errors about unreadable files.  Pass that
 	 * desire on to fsync_fname_ext().
@@ -3146,6 +3289,57 @@ datadir_fsync_fname(const char *fname, bool isdir, int elevel)
 	fsync_fname_ext(fname, isdir, true, elevel);
 }
 
+/*
+ * Log how far SyncDataDirectory() has got, if it's been a while since we last
+ * said so.
+ */
+static void
+report_sync_progress(const char *method, const char *fname)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	long		secs;
+	int			usecs;
+
+	if (!TimestampDifferenceExceeds(sync_last_report_time, now,
+									SYNC_PROGRESS_INTERVAL))
+		return;
+	sync_last_report_time = now;
+
+	TimestampDifference(sync_start_time, now, &secs, &usecs);
+	ereport(LOG,
+			(errmsg("syncing data directory (%s), elapsed time: %ld.%02d s, current path: %s",
+					method, secs, usecs / 10000, fname)));
+}
+
+#ifdef HAVE_SYNCFS
+/*
+ * Sync the whole filesystem containing path.  Errors are logged but not
+ * considered fatal, as in SyncDataDirectory().
+ */
+static void
+do_syncfs(const char *path)
+{
+	int			fd;
+
+	report_sync_progress("syncfs", path);
+
+	fd = OpenTransientFile(path, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+		return;
+	}
+	if (syncfs(fd) < 0)
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not synchronize file system for file \"%s\": %m",
+						path)));
+	CloseTransientFile(fd);
+}
+#endif							/* HAVE_SYNCFS */
+
 /*
  * fsync_fname_ext -- Try to fsync a file or directory
  *
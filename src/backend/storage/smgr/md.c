@@ -182,6 +182,8 @@ static CycleCtr mdckpt_cycle_ctr = 0;
 /* local routines */
 static void mdunlinkfork(RelFileNodeBackend rnode, ForkNumber forkNum,
 			 bool isRedo);
+static File mdopenfile(const char *path, int flags);
+static char *mdiobuffer(char *buffer);
 static MdfdVec *mdopen(SMgrRelation reln, ForkNumber forknum, int behavior);
 static void register_dirty_segment(SMgrRelation reln, ForkNumber forknum,
 					   MdfdVec *seg);
@@ -304,7 +306,7 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 
 	path = relpath(reln->smgr_rnode, forkNum);
 
-	fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
+	fd = mdopenfile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
 
 	if (fd < 0)
 	{
@@ -317,7 +319,7 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 		 * already, even if isRedo is not set.  (See also mdopen)
 		 */
 		if (isRedo || IsBootstrapProcessingMode())
-			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY);
+			fd = mdopenfile(path, O_RDWR | PG_BINARY);
 		if (fd < 0)
 		{
 			/* be sure to report the error reported by create, not open */
@@ -498,6 +500,7 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	off_t		seekpos;
 	int			nbytes;
 	MdfdVec    *v;
+	char	   *iobuffer;
 
 	/* This assert is too expensive to have on normally ... */
 #ifdef CHECK_WRITE_VS_EXTEND
@@ -537,7 +540,11 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
-	if ((nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
+	iobuffer = mdiobuffer(buffer);
+	if (iobuffer != buffer)
+		memcpy(iobuffer, buffer, BLCKSZ);
+
+	if ((nbytes = FileWrite(v->mdfd_vfd, iobuffer, BLCKSZ, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
 	{
 		if (nbytes < 0)
 			ereport(ERROR,
@@ -560,6 +567,182 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
 }
 
+/*
+ *	mdzeroextend() -- Add nblocks zeroed blocks to the specified relation,
+ *		starting at blocknum.
+ *
+ *		The space is allocated with posix_fallocate() where that works, so
+ *		that a large extension costs one system call per segment rather than
+ *		one write per block.  Otherwise we fall back to writing zeroes.
+ */
+void
+mdzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			 int nblocks, bool skipFsync)
+{
+	BlockNumber curblocknum = blocknum;
+	int			remblocks = nblocks;
+	char	   *zerobuf = NULL;
+
+	Assert(nblocks > 0);
+
+	/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+	Assert(blocknum >= mdnblocks(reln, forknum));
+#endif
+
+	/* As in mdextend, refuse to create a block numbered InvalidBlockNumber */
+	if ((uint64) blocknum + nblocks >= (uint64) InvalidBlockNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("cannot extend file \"%s\" beyond %u blocks",
+						relpath(reln->smgr_rnode, forknum),
+						InvalidBlockNumber)));
+
+	while (remblocks > 0)
+	{
+		BlockNumber segstartblock = curblocknum % ((BlockNumber) RELSEG_SIZE);
+		off_t		seekpos = (off_t) BLCKSZ * segstartblock;
+		int			numblocks;
+		bool		fallocated;
+		MdfdVec    *v;
+
+		/* Don't cross a segment boundary in one go */
+		if (segstartblock + remblocks > RELSEG_SIZE)
+			numblocks = RELSEG_SIZE - segstartblock;
+		else
+			numblocks = remblocks;
+
+		v = _mdfd_getseg(reln, forknum, curblocknum, skipFsync,
+						 EXTENSION_CREATE);
+
+		/*
+		 * posix_fallocate() isn't worth a try for a single block, and some
+		 * filesystems don't support it at all.
+		 */
+		fallocated = false;
+		if (numblocks > 1)
+		{
+			if (FileFallocate(v->mdfd_vfd, seekpos, (off_t) BLCKSZ * numblocks,
+							  WAIT_EVENT_DATA_FILE_EXTEND) == 0)
+				fallocated = true;
+			else if (errno != EOPNOTSUPP)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not extend file \"%s\": %m",
+								FilePathName(v->mdfd_vfd)),
+						 errhint("Check free disk space.")));
+		}
+
+		if (!fallocated)
+		{
+			int			i;
+
+			/* aligned, in case we're using direct I/O */
+			if (zerobuf == NULL)
+				zerobuf = palloc0(BLCKSZ + PG_IO_ALIGN_SIZE);
+
+			if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not seek to block %u in file \"%s\": %m",
+								curblocknum, FilePathName(v->mdfd_vfd))));
+
+			for (i = 0; i < numblocks; i++)
+			{
+				int			nbytes;
+
+				nbytes = FileWrite(v->mdfd_vfd,
+								   (char *) TYPEALIGN(PG_IO_ALIGN_SIZE, zerobuf),
+								   BLCKSZ, WAIT_EVENT_DATA_FILE_EXTEND);
+				if (nbytes != BLCKSZ)
+				{
+					if (nbytes < 0)
+						ereport(ERROR,
+								(errcode_for_file_access(),
+								 errmsg("could not extend file \"%s\": %m",
+										FilePathName(v->mdfd_vfd)),
+								 errhint("Check free disk space.")));
+					/* short write: complain appropriately */
+					ereport(ERROR,
+							(errcode(ERRCODE_DISK_FULL),
+							 errmsg("could not extend file \"%s\": wrote only %d of %d bytes at block %u",
+									FilePathName(v->mdfd_vfd),
+									nbytes, BLCKSZ, curblocknum + i),
+							 errhint("Check free disk space.")));
+				}
+			}
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
+
+		curblocknum += numblocks;
+		remblocks -= numblocks;
+	}
+
+	if (zerobuf)
+		pfree(zerobuf);
+}
+
+/*
+ * Open a relation segment file, adding O_DIRECT if io_direct includes data.
+ *
+ * Not every file system supports O_DIRECT; Linux reports that as EINVAL from
+ * open(), after creating the file if O_CREAT was given.  Rather than make the
+ * relation inaccessible, fall back to buffered I/O for that file.
+ */
+static File
+mdopenfile(const char *path, int flags)
+{
+	static bool warned = false;
+	File		fd;
+
+	if ((io_direct_flags & IO_DIRECT_DATA) == 0 || PG_O_DIRECT == 0)
+		return PathNameOpenFile(path, flags);
+
+	fd = PathNameOpenFile(path, flags | PG_O_DIRECT);
+	if (fd >= 0 || errno != EINVAL)
+		return fd;
+
+	/* The failed attempt may already have created the file; accept that */
+	fd = PathNameOpenFile(path, flags & ~O_EXCL);
+	if (fd >= 0 && !warned)
+	{
+		ereport(LOG,
+				(errmsg("direct I/O is not supported for file \"%s\", using buffered I/O",
+						path)));
+		warned = true;
+	}
+	return fd;
+}
+
+/*
+ * Return a buffer suitable for reading or writing the block in "buffer".
+ *
+ * Direct I/O requires buffers aligned to PG_IO_ALIGN_SIZE.  Shared and local
+ * buffers always are, but some callers pass pages they palloc'd themselves.
+ * Those are staged through a private aligned block instead; it's up to the
+ * caller to copy the data in or out if the result isn't "buffer".
+ */
+static char *
+mdiobuffer(char *buffer)
+{
+	static char *iobuffer = NULL;
+
+	if ((io_direct_flags & IO_DIRECT_DATA) == 0 ||
+		TYPEALIGN(PG_IO_ALIGN_SIZE, buffer) == (uintptr_t) buffer)
+		return buffer;
+
+	if (iobuffer == NULL)
+		iobuffer = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAlloc(TopMemoryContext,
+										 BLCKSZ + PG_IO_ALIGN_SIZE));
+	return iobuffer;
+}
+
 /*
  *	mdopen() -- Open the specified relation.
  *
@@ -583,7 +766,7 @@ mdopen(SMgrRelation reln, ForkNumber forknum, int behavior)
 
 	path = relpath(reln->smgr_rnode, forknum);
 
-	fd = PathNameOpenFile(path, O_RDWR | PG_BINARY);
+	fd = mdopenfile(path, O_RDWR | PG_BINARY);
 
 	if (fd < 0)
 	{
@@ -594,7 +777,7 @@ mdopen(SMgrRelation reln, ForkNumber forknum, int behavior)
 		 * substitute for mdcreate() in bootstrap mode only. (See mdcreate)
 		 */
 		if (IsBootstrapProcessingMode())
-			fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
+			fd = mdopenfile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
 		if (fd < 0)
 		{
 			if ((behavior & EXTENSION_RETURN_NULL) &&
@@ -734,6 +917,7 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	off_t		seekpos;
 	int			nbytes;
 	MdfdVec    *v;
+	char	   *iobuffer;
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
 										reln->smgr_rnode.node.spcNode,
@@ -754,7 +938,10 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
-	nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ, WAIT_EVENT_DATA_FILE_READ);
+	iobuffer = mdiobuffer(buffer);
+	nbytes = FileRead(v->mdfd_vfd, iobuffer, BLCKSZ, WAIT_EVENT_DATA_FILE_READ);
+	if (iobuffer != buffer && nbytes > 0)
+		memcpy(buffer, iobuffer, nbytes);
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
 									   reln->smgr_rnode.node.spcNode,
@@ -805,6 +992,7 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	off_t		seekpos;
 	int			nbytes;
 	MdfdVec    *v;
+	char	   *iobuffer;
 
 	/* This assert is too expensive to have on normally ... */
 #ifdef CHECK_WRITE_VS_EXTEND
@@ -830,7 +1018,10 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
-	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, WAIT_EVENT_DATA_FILE_WRITE);
+	iobuffer = mdiobuffer(buffer);
+	if (iobuffer != buffer)
+		memcpy(iobuffer, buffer, BLCKSZ);
+	nbytes = FileWrite(v->mdfd_vfd, iobuffer, BLCKSZ, WAIT_EVENT_DATA_FILE_WRITE);
 
 	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
 										reln->smgr_rnode.node.spcNode,
@@ -861,6 +1052,41 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		register_dirty_segment(reln, forknum, v);
 }
 
+/*
+ *	mdstartwrite() -- Start writing the supplied block asynchronously.
+ *
+ *		The fsync request is registered right away; the caller must make sure
+ *		the write completes before the next checkpoint's fsyncs are done.
+ */
+void
+mdstartwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			 char *buffer, AioCallback callback, void *arg)
+{
+	off_t		seekpos;
+	MdfdVec    *v;
+
+	Assert(!SmgrIsTemp(reln));
+	/* there's no bounce buffer for in-flight writes */
+	Assert((io_direct_flags & IO_DIRECT_DATA) == 0 ||
+		   mdiobuffer(buffer) == buffer);
+
+	v = _mdfd_getseg(reln, forknum, blocknum, false,
+					 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+	seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+	if (FileStartWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos,
+					   WAIT_EVENT_DATA_FILE_WRITE, callback, arg) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write block %u in file \"%s\": %m",
+						blocknum, FilePathName(v->mdfd_vfd))));
+
+	register_dirty_segment(reln, forknum, v);
+}
+
 /*
  *	mdnblocks() -- Get the number of blocks stored in a relation.
  *
@@ -1780,7 +2006,7 @@ _mdfd_openseg(SMgrRelation reln, ForkNumber forknum, BlockNumber segno,
 	fullpath = _mdfd_segpath(reln, forknum, segno);
 
 	/* open the file */
-	fd = PathNameOpenFile(fullpath, O_RDWR | PG_BINARY | oflags);
+	fd = mdopenfile(fullpath, O_RDWR | PG_BINARY | oflags);
 
 	pfree(fullpath);
 
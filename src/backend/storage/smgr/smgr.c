@@ -17,6 +17,8 @@
  */
 #include "postgres.h"
 
+#include "access/xlog.h"
+#include "access/xlogparallel.h"
 #include "commands/tablespace.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
@@ -47,12 +49,18 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, int nblocks,
+									bool skipFsync);
 	void		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 							  BlockNumber blocknum, char *buffer);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 							   BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_startwrite) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, char *buffer,
+									AioCallback callback, void *arg);
 	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
 								   BlockNumber blocknum, BlockNumber nblocks);
 	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
@@ -68,8 +76,8 @@ typedef struct f_smgr
 static const f_smgr smgrsw[] = {
 	/* magnetic disk */
 	{mdinit, NULL, mdclose, mdcreate, mdexists, mdunlink, mdextend,
-		mdprefetch, mdread, mdwrite, mdwriteback, mdnblocks, mdtruncate,
-		mdimmedsync, mdpreckpt, mdsync, mdpostckpt
+		mdzeroextend, mdprefetch, mdread, mdwrite, mdstartwrite, mdwriteback,
+		mdnblocks, mdtruncate, mdimmedsync, mdpreckpt, mdsync, mdpostckpt
 	}
 };
 
@@ -172,9 +180,12 @@ smgropen(RelFileNode rnode, BackendId backend)
 		reln->smgr_vm_nblocks = InvalidBlockNumber;
 		reln->smgr_which = 0;	/* we only have md.c at present */
 
-		/* mark it not open */
+		/* mark it not open, and its size unknown */
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		{
 			reln->md_num_open_segs[forknum] = 0;
+			reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+		}
 
 		/* it has no owner yet */
 		add_to_unowned_list(reln);
@@ -396,6 +407,11 @@ smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 							isRedo);
 
 	smgrsw[reln->smgr_which].smgr_create(reln, forknum, isRedo);
+
+	/* Forget any size cached for a previous incarnation of the fork */
+	if (!SmgrIsTemp(reln))
+		smgrsize_update(reln->smgr_rnode.node, forknum, InvalidBlockNumber,
+						InvalidBlockNumber);
 }
 
 /*
@@ -425,7 +441,11 @@ smgrdounlink(SMgrRelation reln, bool isRedo)
 	 * Get rid of any remaining buffers for the relation.  bufmgr will just
 	 * drop them without bothering to write the contents.
 	 */
-	DropRelFileNodesAllBuffers(&rnode, 1);
+	DropRelFileNodesAllBuffers(&reln, 1);
+	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+	if (!RelFileNodeBackendIsTemp(rnode))
+		smgrsize_drop(rnode.node);
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -498,7 +518,14 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 	 * Get rid of any remaining buffers for the relations.  bufmgr will just
 	 * drop them without bothering to write the contents.
 	 */
-	DropRelFileNodesAllBuffers(rnodes, nrels);
+	DropRelFileNodesAllBuffers(rels, nrels);
+	for (i = 0; i < nrels; i++)
+	{
+		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+			rels[i]->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+		if (!RelFileNodeBackendIsTemp(rnodes[i]))
+			smgrsize_drop(rnodes[i].node);
+	}
 
 	/*
 	 * It'd be nice to tell the stats collector to forget them immediately,
@@ -558,7 +585,11 @@ smgrdounlinkfork(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	 * Get rid of any remaining buffers for the fork.  bufmgr will just drop
 	 * them without bothering to write the contents.
 	 */
-	DropRelFileNodeBuffers(rnode, forknum, 0);
+	DropRelFileNodeBuffers(reln, forknum, 0);
+	reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+	if (!RelFileNodeBackendIsTemp(rnode))
+		smgrsize_update(rnode.node, forknum, InvalidBlockNumber,
+						InvalidBlockNumber);
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -602,6 +633,48 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 {
 	smgrsw[reln->smgr_which].smgr_extend(reln, forknum, blocknum,
 											   buffer, skipFsync);
+
+	/*
+	 * Normally this adds one block to a fork whose size we know.  If the
+	 * cached size isn't what we expected, forget it and let the next
+	 * smgrnblocks() ask the kernel.
+	 */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + 1;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+
+	/* Same for the shared cache */
+	if (!SmgrIsTemp(reln))
+		smgrsize_update(reln->smgr_rnode.node, forknum, blocknum,
+						blocknum + 1);
+}
+
+/*
+ *	smgrzeroextend() -- Add nblocks zero-filled blocks to a file.
+ *
+ *		Like smgrextend(), but for many blocks at once, starting at
+ *		blocknum, which must be the current EOF.  This is much cheaper than
+ *		extending one block at a time, since the space can usually be
+ *		allocated without writing anything.  The caller is responsible for
+ *		initializing the new pages in the buffer pool if it needs to.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   int nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_zeroextend(reln, forknum, blocknum,
+											   nblocks, skipFsync);
+
+	/* Keep the cached sizes up to date, as in smgrextend() */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + nblocks;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+
+	if (!SmgrIsTemp(reln))
+		smgrsize_update(reln->smgr_rnode.node, forknum, blocknum,
+						blocknum + nblocks);
 }
 
 /*
@@ -651,6 +724,22 @@ smgrwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 											  buffer, skipFsync);
 }
 
+/*
+ *	smgrstartwrite() -- Start writing the supplied buffer out asynchronously.
+ *
+ *		Like smgrwrite(), except that the write is only started; "callback"
+ *		is called with the result from AioComplete() once it's done.  The
+ *		buffer must stay untouched until then.  The caller must check that
+ *		AioEnabled() first.  Not for temporary relations.
+ */
+void
+smgrstartwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   char *buffer, AioCallback callback, void *arg)
+{
+	smgrsw[reln->smgr_which].smgr_startwrite(reln, forknum, blocknum,
+												   buffer, callback, arg);
+}
+
 
 /*
  *	smgrwriteback() -- Trigger kernel writeback for the supplied range of
@@ -671,7 +760,51 @@ smgrwriteback(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 BlockNumber
 smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 {
-	return smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+	BlockNumber result;
+	uint64		generation = 0;
+
+	result = smgrnblocks_cached(reln, forknum);
+	if (result != InvalidBlockNumber)
+		return result;
+
+	/* Try the shared cache, unless it's a temp relation */
+	if (!SmgrIsTemp(reln))
+	{
+		result = smgrsize_get(reln->smgr_rnode.node, forknum, &generation);
+		if (result != InvalidBlockNumber)
+		{
+			reln->smgr_cached_nblocks[forknum] = result;
+			return result;
+		}
+	}
+
+	result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+
+	if (!SmgrIsTemp(reln))
+		smgrsize_set(reln->smgr_rnode.node, forknum, result, generation);
+	reln->smgr_cached_nblocks[forknum] = result;
+
+	return result;
+}
+
+/*
+ *	smgrnblocks_cached() -- Get the cached number of blocks in the supplied
+ *							relation, or InvalidBlockNumber if not known.
+ *
+ *		The cached value is trusted only during recovery.  The startup
+ *		process is then the only one changing relation sizes, so a value it
+ *		cached cannot go stale; in normal running, other backends could
+ *		extend the relation without our hearing of it.  The same goes for
+ *		parallel redo workers.
+ */
+BlockNumber
+smgrnblocks_cached(SMgrRelation reln, ForkNumber forknum)
+{
+	if (InRecovery && !ParallelRedoActive &&
+		reln->smgr_cached_nblocks[forknum] != InvalidBlockNumber)
+		return reln->smgr_cached_nblocks[forknum];
+
+	return InvalidBlockNumber;
 }
 
 /*
@@ -687,7 +820,7 @@ smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 	 * Get rid of any buffers for the about-to-be-deleted blocks. bufmgr will
 	 * just drop them without bothering to write the contents.
 	 */
-	DropRelFileNodeBuffers(reln->smgr_rnode, forknum, nblocks);
+	DropRelFileNodeBuffers(reln, forknum, nblocks);
 
 	/*
 	 * Send a shared-inval message to force other backends to close any smgr
@@ -705,6 +838,12 @@ smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 	 * Do the truncation.
 	 */
 	smgrsw[reln->smgr_which].smgr_truncate(reln, forknum, nblocks);
+
+	/* We might as well update the cached sizes now that we know it */
+	reln->smgr_cached_nblocks[forknum] = nblocks;
+	if (!SmgrIsTemp(reln))
+		smgrsize_update(reln->smgr_rnode.node, forknum, InvalidBlockNumber,
+						nblocks);
 }
 
 /*
@@ -0,0 +1,326 @@
+/*-------------------------------------------------------------------------
+ *
+ * smgrsize.c
+ *	  Shared-memory cache of relation fork sizes.
+ *
+ * Finding out how many blocks a relation fork has means an lseek() call on
+ * each of its segments, and the planner, executor and buffer manager ask
+ * that question very often.  To avoid it, smgr.c records the sizes it learns
+ * in a hash table in shared memory, keyed by RelFileNode, and keeps them
+ * up to date as relations are extended, truncated and dropped.  Temporary
+ * relations are not cached here, since only their owning backend can see
+ * them.
+ *
+ * A cached size must never be smaller than the file: relation extension
+ * asks smgrnblocks() for the number of the next block, and a stale answer
+ * would overwrite existing data.  Storing a size that was looked up with
+ * lseek() therefore has to be careful about concurrent changes.  Each entry
+ * carries a generation number, taken from a global counter every time the
+ * entry is created or changed by an extension, truncation or invalidation.
+ * smgrsize_get() returns the generation seen when the size was found to be
+ * unknown, and smgrsize_set() stores the kernel's answer only if the entry
+ * still has that generation.  Since extension and truncation update the
+ * entry after changing the file, a size read from the kernel before such a
+ * change can never overwrite the result of it.
+ *
+ * The table has a fixed number of entries (smgr_shared_relations).  Entries
+ * are removed when a relation or its database is dropped; if the table is
+ * full, the sizes of further relations simply aren't cached.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/smgr/smgrsize.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "port/atomics.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "utils/hsearch.h"
+
+
+/* GUC variable */
+int			smgr_shared_relations = 10000;
+
+/* entry for the relation size hashtable */
+typedef struct SMgrSizeEnt
+{
+	RelFileNode rnode;			/* hash key; must be first */
+	uint64		generation;		/* see file header comment */
+	BlockNumber nblocks[MAX_FORKNUM + 1];	/* InvalidBlockNumber if unknown */
+} SMgrSizeEnt;
+
+typedef struct SMgrSizeCtlData
+{
+	pg_atomic_uint32 nentries;	/* number of entries in use */
+	pg_atomic_uint64 generation;	/* last generation number handed out */
+} SMgrSizeCtlData;
+
+static HTAB *SMgrSizeHash = NULL;
+static SMgrSizeCtlData *SMgrSizeCtl = NULL;
+
+#define SMgrSizePartitionLock(hashcode) \
+	(&MainLWLockArray[RELSIZE_LWLOCK_OFFSET + \
+		((hashcode) % NUM_RELSIZE_PARTITIONS)].lock)
+#define SMgrSizePartitionLockByIndex(i) \
+	(&MainLWLockArray[RELSIZE_LWLOCK_OFFSET + (i)].lock)
+
+static uint64
+smgrsize_next_generation(void)
+{
+	return pg_atomic_add_fetch_u64(&SMgrSizeCtl->generation, 1);
+}
+
+/*
+ * Estimate space needed for the relation size cache.
+ */
+Size
+SMgrSizeShmemSize(void)
+{
+	Size		size;
+
+	if (smgr_shared_relations <= 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(SMgrSizeCtlData));
+	size = add_size(size, hash_estimate_size(smgr_shared_relations,
+											 sizeof(SMgrSizeEnt)));
+	return size;
+}
+
+/*
+ * Initialize the relation size cache in shared memory.
+ */
+void
+SMgrSizeShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (smgr_shared_relations <= 0)
+		return;
+
+	SMgrSizeCtl = (SMgrSizeCtlData *)
+		ShmemInitStruct("Relation Size Cache Control",
+						sizeof(SMgrSizeCtlData), &found);
+	if (!found)
+	{
+		pg_atomic_init_u32(&SMgrSizeCtl->nentries, 0);
+		pg_atomic_init_u64(&SMgrSizeCtl->generation, 0);
+	}
+
+	info.keysize = sizeof(RelFileNode);
+	info.entrysize = sizeof(SMgrSizeEnt);
+	info.num_partitions = NUM_RELSIZE_PARTITIONS;
+
+	SMgrSizeHash = ShmemInitHash("Relation Size Cache",
+								 smgr_shared_relations,
+								 smgr_shared_relations,
+								 &info,
+								 HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+}
+
+/*
+ *	smgrsize_get() -- Look up the cached size of a relation fork.
+ *
+ * Returns the size, or InvalidBlockNumber if it isn't known.  In the latter
+ * case *generation is set to the value to pass to smgrsize_set() along with
+ * the size found by asking the kernel, or to zero if the size can't be
+ * cached at all.
+ */
+BlockNumber
+smgrsize_get(RelFileNode rnode, ForkNumber forknum, uint64 *generation)
+{
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	SMgrSizeEnt *entry;
+	BlockNumber result = InvalidBlockNumber;
+	bool		found;
+
+	*generation = 0;
+	if (SMgrSizeHash == NULL)
+		return InvalidBlockNumber;
+
+	hashcode = get_hash_value(SMgrSizeHash, &rnode);
+	partitionLock = SMgrSizePartitionLock(hashcode);
+
+	/* The common case: the size is known */
+	LWLockAcquire(partitionLock, LW_SHARED);
+	entry = (SMgrSizeEnt *)
+		hash_search_with_hash_value(SMgrSizeHash, &rnode, hashcode,
+									HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		result = entry->nblocks[forknum];
+		*generation = entry->generation;
+	}
+	LWLockRelease(partitionLock);
+
+	if (entry != NULL)
+		return result;
+
+	/*
+	 * Make an entry, if there's room, so that the caller can fill it in.
+	 * Someone else may have beaten us to it in the meantime.
+	 */
+	if (pg_atomic_fetch_add_u32(&SMgrSizeCtl->nentries, 1) >=
+		(uint32) smgr_shared_relations)
+	{
+		pg_atomic_fetch_sub_u32(&SMgrSizeCtl->nentries, 1);
+		return InvalidBlockNumber;
+	}
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	entry = (SMgrSizeEnt *)
+		hash_search_with_hash_value(SMgrSizeHash, &rnode, hashcode,
+									HASH_ENTER_NULL, &found);
+	if (entry == NULL || found)
+		pg_atomic_fetch_sub_u32(&SMgrSizeCtl->nentries, 1);
+	if (entry != NULL)
+	{
+		if (!found)
+		{
+			int			i;
+
+			for (i = 0; i <= MAX_FORKNUM; i++)
+				entry->nblocks[i] = InvalidBlockNumber;
+			entry->generation = smgrsize_next_generation();
+		}
+		result = entry->nblocks[forknum];
+		*generation = entry->generation;
+	}
+	LWLockRelease(partitionLock);
+
+	return result;
+}
+
+/*
+ *	smgrsize_set() -- Store the size of a relation fork, as found by asking
+ *		the kernel after smgrsize_get() returned generation.
+ */
+void
+smgrsize_set(RelFileNode rnode, ForkNumber forknum, BlockNumber nblocks,
+			 uint64 generation)
+{
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	SMgrSizeEnt *entry;
+
+	if (SMgrSizeHash == NULL || generation == 0)
+		return;
+
+	hashcode = get_hash_value(SMgrSizeHash, &rnode);
+	partitionLock = SMgrSizePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	entry = (SMgrSizeEnt *)
+		hash_search_with_hash_value(SMgrSizeHash, &rnode, hashcode,
+									HASH_FIND, NULL);
+	if (entry != NULL && entry->generation == generation)
+		entry->nblocks[forknum] = nblocks;
+	LWLockRelease(partitionLock);
+}
+
+/*
+ *	smgrsize_update() -- Record a change in the size of a relation fork.
+ *
+ * Called after the file has been changed.  If oldnblocks is valid, the fork
+ * has changed from oldnblocks blocks to nblocks blocks, and we only keep
+ * the new size if the cached one agreed with oldnblocks; otherwise the fork
+ * is now nblocks long whatever its previous size.  InvalidBlockNumber for
+ * nblocks just forgets the size.
+ */
+void
+smgrsize_update(RelFileNode rnode, ForkNumber forknum,
+				BlockNumber oldnblocks, BlockNumber nblocks)
+{
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	SMgrSizeEnt *entry;
+
+	if (SMgrSizeHash == NULL)
+		return;
+
+	hashcode = get_hash_value(SMgrSizeHash, &rnode);
+	partitionLock = SMgrSizePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	entry = (SMgrSizeEnt *)
+		hash_search_with_hash_value(SMgrSizeHash, &rnode, hashcode,
+									HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		if (BlockNumberIsValid(oldnblocks) &&
+			entry->nblocks[forknum] != oldnblocks)
+			entry->nblocks[forknum] = InvalidBlockNumber;
+		else
+			entry->nblocks[forknum] = nblocks;
+		entry->generation = smgrsize_next_generation();
+	}
+	LWLockRelease(partitionLock);
+}
+
+/*
+ *	smgrsize_drop() -- Forget all forks of a relation that is being dropped.
+ */
+void
+smgrsize_drop(RelFileNode rnode)
+{
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	bool		found;
+
+	if (SMgrSizeHash == NULL)
+		return;
+
+	hashcode = get_hash_value(SMgrSizeHash, &rnode);
+	partitionLock = SMgrSizePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	hash_search_with_hash_value(SMgrSizeHash, &rnode, hashcode,
+								HASH_REMOVE, &found);
+	if (found)
+		pg_atomic_fetch_sub_u32(&SMgrSizeCtl->nentries, 1);
+	LWLockRelease(partitionLock);
+}
+
+/*
+ *	smgrsize_drop_db() -- Forget all relations of a database.
+ *
+ * This is for operations that create or remove a database's files without
+ * going through smgr, such as DROP DATABASE.  It scans the whole table, but
+ * such operations are rare.
+ */
+void
+smgrsize_drop_db(Oid dbid)
+{
+	HASH_SEQ_STATUS status;
+	SMgrSizeEnt *entry;
+	int			i;
+
+	if (SMgrSizeHash == NULL)
+		return;
+
+	/* Lock all partitions, in order, as in GetLockStatusData */
+	for (i = 0; i < NUM_RELSIZE_PARTITIONS; i++)
+		LWLockAcquire(SMgrSizePartitionLockByIndex(i), LW_EXCLUSIVE);
+
+	hash_seq_init(&status, SMgrSizeHash);
+	while ((entry = (SMgrSizeEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->rnode.dbNode != dbid)
+			continue;
+		/* dynahash allows deleting the element just returned */
+		hash_search(SMgrSizeHash, &entry->rnode, HASH_REMOVE, NULL);
+		pg_atomic_fetch_sub_u32(&SMgrSizeCtl->nentries, 1);
+	}
+
+	for (i = NUM_RELSIZE_PARTITIONS; --i >= 0;)
+		LWLockRelease(SMgrSizePartitionLockByIndex(i));
+}
@@ -80,6 +80,9 @@ static const struct am_propname am_propnames[] =
 	},
 	{
 		"can_exclude", AMPROP_CAN_EXCLUDE
+	},
+	{
+		"can_include", AMPROP_CAN_INCLUDE
 	}
 };
 
@@ -133,7 +136,7 @@ test_indoption(Oid relid, int attno, bool guard,
 	rd_index = (Form_pg_index) GETSTRUCT(tuple);
 
 	Assert(relid == rd_index->indexrelid);
-	Assert(attno > 0 && attno <= rd_index->indnatts);
+	Assert(attno > 0 && attno <= rd_index->indnkeyatts);
 
 	datum = SysCacheGetAttr(INDEXRELID, tuple,
 							Anum_pg_index_indoption, &isnull);
@@ -166,6 +169,7 @@ indexam_property(FunctionCallInfo fcinfo,
 	bool		res = false;
 	bool		isnull = false;
 	int			natts = 0;
+	int			nkeyatts = 0;
 	IndexAMProperty prop;
 	IndexAmRoutine *routine;
 
@@ -191,6 +195,16 @@ indexam_property(FunctionCallInfo fcinfo,
 		amoid = rd_rel->relam;
 		natts = rd_rel->relnatts;
 		ReleaseSysCache(tuple);
+
+		/* Column properties also need to know which columns are keys */
+		if (attno > 0)
+		{
+			tuple = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(index_oid));
+			if (!HeapTupleIsValid(tuple))
+				PG_RETURN_NULL();
+			nkeyatts = ((Form_pg_index) GETSTRUCT(tuple))->indnkeyatts;
+			ReleaseSysCache(tuple);
+		}
 	}
 
 	/*
@@ -201,6 +215,14 @@ indexam_property(FunctionCallInfo fcinfo,
 	if (attno < 0 || attno > natts)
 		PG_RETURN_NULL();
 
+	/*
+	 * INCLUDE columns have no ordering or search behavior of their own, so
+	 * the only column property that applies to them is whether they can be
+	 * returned.
+	 */
+	if (attno > nkeyatts && prop != AMPROP_RETURNABLE)
+		PG_RETURN_NULL();
+
 	/*
 	 * Get AM information.  If we don't have a valid AM OID, return NULL.
 	 */
@@ -343,6 +365,9 @@ indexam_property(FunctionCallInfo fcinfo,
 		case AMPROP_CAN_EXCLUDE:
 			PG_RETURN_BOOL(routine->amgettuple ? true : false);
 
+		case AMPROP_CAN_INCLUDE:
+			PG_RETURN_BOOL(routine->amcaninclude);
+
 		default:
 			PG_RETURN_NULL();
 	}
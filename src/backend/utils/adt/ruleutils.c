@@ -1125,7 +1125,10 @@ pg_get_indexdef_string(Oid indexrelid)
 	return pg_get_indexdef_worker(indexrelid, 0, NULL, false, true, 0, false);
 }
 
-/* Internal version that just reports the column definitions */
+/*
+ * Internal version that just reports the column definitions.  Only key
+ * columns are reported, not INCLUDE columns.
+ */
 char *
 pg_get_indexdef_columns(Oid indexrelid, bool pretty)
 {
@@ -1275,10 +1278,18 @@ pg_get_indexdef_worker(Oid indexrelid, int colno,
 	for (keyno = 0; keyno < idxrec->indnatts; keyno++)
 	{
 		AttrNumber	attnum = idxrec->indkey.values[keyno];
-		int16		opt = indoption->values[keyno];
 		Oid			keycoltype;
 		Oid			keycolcollation;
 
+		/* INCLUDE columns follow the key columns, in their own list */
+		if (!colno && keyno == idxrec->indnkeyatts)
+		{
+			if (attrsOnly)
+				break;
+			appendStringInfoString(&buf, ") INCLUDE (");
+			sep = "";
+		}
+
 		if (!colno)
 			appendStringInfoString(&buf, sep);
 		sep = ", ";
@@ -1320,8 +1331,11 @@ pg_get_indexdef_worker(Oid indexrelid, int colno,
 			keycolcollation = exprCollation(indexkey);
 		}
 
-		if (!attrsOnly && (!colno || colno == keyno + 1))
+		/* INCLUDE columns have no collation, opclass or options */
+		if (!attrsOnly && keyno < idxrec->indnkeyatts &&
+			(!colno || colno == keyno + 1))
 		{
+			int16		opt = indoption->values[keyno];
 			Oid			indcoll;
 
 			/* Add collation, if not default for column */
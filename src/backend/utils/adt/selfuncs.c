@@ -216,6 +216,8 @@ static Datum string_to_datum(const char *str, Oid datatype);
 static Const *string_to_const(const char *str, Oid datatype);
 static Const *string_to_bytea_const(const char *str, size_t str_len);
 static List *add_predicate_to_quals(IndexOptInfo *index, List *indexQuals);
+static void btskipcostestimate(PlannerInfo *root, IndexPath *path,
+				   double loop_count, List *qinfos, GenericCosts *costs);
 
 
 /*
@@ -4780,7 +4782,7 @@ examine_variable(PlannerInfo *root, Node *node, int varRelid,
 						 * should match has_unique_index().
 						 */
 						if (index->unique &&
-							index->ncolumns == 1 &&
+							index->nkeycolumns == 1 &&
 							(index->indpred == NIL || index->predOK))
 							vardata->isunique = true;
 
@@ -6802,6 +6804,129 @@ add_predicate_to_quals(IndexOptInfo *index, List *indexQuals)
 }
 
 
+/*
+ * btskipcostestimate
+ *
+ * When a forward btree scan has no '=' qual on the first index column but
+ * does have quals on the second, it can skip over runs of leaf pages in
+ * which no tuple can match the second column's quals: see _bt_skip_setup().
+ * It does so by descending the tree afresh, at most about once per
+ * distinct value of the first column.  If that looks cheaper than the
+ * generic estimate for reading the whole key range, which the caller has
+ * stored in *costs, replace that estimate.
+ */
+static void
+btskipcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
+				   List *qinfos, GenericCosts *costs)
+{
+	IndexOptInfo *index = path->indexinfo;
+	List	   *firstColQuals = NIL;
+	List	   *skipQuals = NIL;
+	bool		found_second = false;
+	RangeTblEntry *rte;
+	Oid			atttype;
+	int32		atttypmod;
+	Oid			attcollation;
+	Var		   *var;
+	double		firstColTuples;
+	double		numGroups;
+	double		descentCost;
+	GenericCosts skipcosts;
+	ListCell   *lc;
+
+	if (!enable_indexskipscan ||
+		ScanDirectionIsBackward(path->indexscandir) ||
+		index->nkeycolumns < 2 ||
+		index->indexkeys[0] == 0 ||
+		index->pages <= 1)
+		return;
+
+	foreach(lc, qinfos)
+	{
+		IndexQualInfo *qinfo = (IndexQualInfo *) lfirst(lc);
+		RestrictInfo *rinfo = qinfo->rinfo;
+		Expr	   *clause = rinfo->clause;
+
+		/* the runtime code doesn't try to cope with array quals */
+		if (IsA(clause, ScalarArrayOpExpr))
+			return;
+
+		if (qinfo->indexcol == 0)
+		{
+			if (IsA(clause, NullTest) &&
+				((NullTest *) clause)->nulltesttype == IS_NULL)
+				return;
+			if (IsA(clause, OpExpr) &&
+				get_op_opfamily_strategy(qinfo->clause_op,
+										 index->opfamily[0]) ==
+				BTEqualStrategyNumber)
+				return;
+			firstColQuals = lappend(firstColQuals, rinfo);
+			skipQuals = lappend(skipQuals, rinfo);
+		}
+		else if (qinfo->indexcol == 1 && IsA(clause, OpExpr))
+		{
+			found_second = true;
+			skipQuals = lappend(skipQuals, rinfo);
+		}
+	}
+	if (!found_second)
+		return;
+
+	/* Estimate the number of distinct first-column values in range */
+	rte = planner_rt_fetch(index->rel->relid, root);
+	get_atttypetypmodcoll(rte->relid, index->indexkeys[0],
+						  &atttype, &atttypmod, &attcollation);
+	var = makeVar(index->rel->relid, index->indexkeys[0],
+				  atttype, atttypmod, attcollation, 0);
+	firstColTuples = clauselist_selectivity(root,
+											add_predicate_to_quals(index,
+																   firstColQuals),
+											index->rel->relid,
+											JOIN_INNER,
+											NULL) * index->rel->tuples;
+	if (firstColTuples < 1.0)
+		return;
+	numGroups = estimate_num_groups(root, list_make1(var), firstColTuples,
+									NULL);
+
+	/*
+	 * The scan only skips when a group spans more than a leaf page, since it
+	 * otherwise has to read each page anyway.
+	 */
+	if (firstColTuples / numGroups <= index->tuples / index->pages)
+		return;
+
+	/*
+	 * Each group costs a descent, which we charge as btcostestimate charges
+	 * the initial one plus a random fetch of the leaf page, and then we read
+	 * about as many tuples as satisfy the first two columns' quals.
+	 */
+	MemSet(&skipcosts, 0, sizeof(skipcosts));
+	skipcosts.numIndexTuples =
+		rint(clauselist_selectivity(root,
+									add_predicate_to_quals(index, skipQuals),
+									index->rel->relid,
+									JOIN_INNER,
+									NULL) * index->rel->tuples);
+	genericcostestimate(root, path, loop_count, qinfos, &skipcosts);
+
+	descentCost = skipcosts.spc_random_page_cost +
+		(index->tree_height + 1) * 50.0 * cpu_operator_cost;
+	if (index->tuples > 1)
+		descentCost += ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
+	skipcosts.indexTotalCost += numGroups * descentCost;
+	skipcosts.numIndexPages += numGroups;
+
+	if (skipcosts.indexTotalCost < costs->indexTotalCost)
+	{
+		costs->indexTotalCost = skipcosts.indexTotalCost;
+		costs->numIndexPages = Min(skipcosts.numIndexPages,
+								   costs->numIndexPages);
+		costs->numIndexTuples = skipcosts.numIndexTuples;
+	}
+}
+
 void
 btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 			   Cost *indexStartupCost, Cost *indexTotalCost,
@@ -6917,7 +7042,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * NullTest invalidates that theory, even though it sets eqQualHere.
 	 */
 	if (index->unique &&
-		indexcol == index->ncolumns - 1 &&
+		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
 		!found_is_null_op)
@@ -6956,6 +7081,9 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 
 	genericcostestimate(root, path, loop_count, qinfos, &costs);
 
+	/* See whether the scan will skip over parts of the index */
+	btskipcostestimate(root, path, loop_count, qinfos, &costs);
+
 	/*
 	 * Add a CPU-cost component to represent the costs of initial btree
 	 * descent.  We don't charge any I/O cost for touching upper btree levels,
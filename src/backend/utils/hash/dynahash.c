@@ -1088,6 +1088,53 @@ hash_search_with_hash_value(HTAB *hashp,
 	return NULL;				/* keep compiler quiet */
 }
 
+/*
+ * hash_search_unlocked -- look up a key in a partitioned table without
+ *		holding the lock on its partition
+ *
+ * This is like hash_search_with_hash_value() with HASH_FIND, for callers that
+ * want to avoid acquiring the partition lock in the common case.  Since the
+ * bucket chains may be changing under us, the result is only a hint: the
+ * entry returned may just have been removed, or be in the middle of being
+ * reused for another key, and an entry that is present may be missed.  The
+ * caller must be able to verify the result by other means, and must repeat
+ * the lookup with the lock held if it can't.
+ *
+ * Partitioned tables never split buckets, so we can't stray outside the
+ * table's elements, but we could in principle be kept walking for a long
+ * time by entries moving about; give up after maxsteps elements.
+ */
+void *
+hash_search_unlocked(HTAB *hashp, const void *keyPtr, uint32 hashvalue,
+					 long maxsteps)
+{
+	HASHHDR    *hctl = hashp->hctl;
+	uint32		bucket;
+	HASHSEGMENT segp;
+	HASHBUCKET	currBucket;
+
+	Assert(IS_PARTITIONED(hctl));
+
+	bucket = calc_bucket(hctl, hashvalue);
+
+	segp = hashp->dir[bucket >> hashp->sshift];
+
+	if (segp == NULL)
+		hash_corrupted(hashp);
+
+	currBucket = ((volatile HASHBUCKET *) segp)[MOD(bucket, hashp->ssize)];
+
+	while (currBucket != NULL && maxsteps-- > 0)
+	{
+		if (currBucket->hashvalue == hashvalue &&
+			hashp->match(ELEMENTKEY(currBucket), keyPtr, hashp->keysize) == 0)
+			return (void *) ELEMENTKEY(currBucket);
+		currBucket = ((volatile HASHELEMENT *) currBucket)->link;
+	}
+
+	return NULL;
+}
+
 /*
  * hash_update_hash_key -- change the hash key of an existing table entry
  *
@@ -33,6 +33,8 @@
 #include "access/twophase.h"
 #include "access/xact.h"
 #include "access/xlog_internal.h"
+#include "access/xlogparallel.h"
+#include "access/xlogprefetch.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_authid.h"
 #include "commands/async.h"
@@ -63,17 +65,21 @@
 #include "postmaster/syslogger.h"
 #include "postmaster/walwriter.h"
 #include "replication/logicallauncher.h"
+#include "replication/reorderbuffer.h"
 #include "replication/slot.h"
 #include "replication/syncrep.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "replication/walsummarizer.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/dsm_impl.h"
 #include "storage/standby.h"
 #include "storage/fd.h"
 #include "storage/pg_shmem.h"
 #include "storage/proc.h"
 #include "storage/predicate.h"
+#include "storage/smgr.h"
 #include "tcop/tcopprot.h"
 #include "tsearch/ts_cache.h"
 #include "utils/builtins.h"
@@ -185,6 +191,8 @@ static bool check_autovacuum_max_workers(int *newval, void **extra, GucSource so
 static bool check_autovacuum_work_mem(int *newval, void **extra, GucSource source);
 static bool check_effective_io_concurrency(int *newval, void **extra, GucSource source);
 static void assign_effective_io_concurrency(int newval, void *extra);
+static bool check_io_direct(char **newval, void **extra, GucSource source);
+static void assign_io_direct(const char *newval, void *extra);
 static void assign_pgstat_temp_directory(const char *newval, void *extra);
 static bool check_application_name(char **newval, void **extra, GucSource source);
 static void assign_application_name(const char *newval, void *extra);
@@ -418,6 +426,35 @@ static const struct config_enum_entry password_encryption_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry io_method_options[] = {
+	{"sync", IO_METHOD_SYNC, false},
+#ifdef HAVE_LINUX_IO_URING_H
+	{"io_uring", IO_METHOD_IO_URING, false},
+#endif
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry recovery_init_sync_method_options[] = {
+	{"fsync", RECOVERY_INIT_SYNC_METHOD_FSYNC, false},
+#ifdef HAVE_SYNCFS
+	{"syncfs", RECOVERY_INIT_SYNC_METHOD_SYNCFS, false},
+#endif
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry wal_receiver_compression_options[] = {
+	{"none", WIRE_COMPRESS_NONE, false},
+#ifdef HAVE_LIBZ
+	{"zlib", WIRE_COMPRESS_ZLIB, false},
+#endif
+	{"pglz", WIRE_COMPRESS_PGLZ, false},
+	{"off", WIRE_COMPRESS_NONE, true},
+	{"false", WIRE_COMPRESS_NONE, true},
+	{"no", WIRE_COMPRESS_NONE, true},
+	{"0", WIRE_COMPRESS_NONE, true},
+	{NULL, 0, false}
+};
+
 /*
  * Options for enum values stored in other modules
  */
@@ -506,6 +543,7 @@ static char *log_timezone_string;
 static char *timezone_abbreviations_string;
 static char *XactIsoLevel_string;
 static char *data_directory;
+static char *io_direct_string;
 static char *session_authorization_string;
 static int	max_function_args;
 static int	max_index_keys;
@@ -830,6 +868,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_indexskipscan", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of index skip scans."),
+			NULL
+		},
+		&enable_indexskipscan,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_bitmapscan", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of bitmap-scan plans."),
@@ -857,6 +904,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_incrementalsort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of incremental sort steps."),
+			NULL
+		},
+		&enable_incrementalsort,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of hashed aggregation plans."),
@@ -951,6 +1007,15 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"summarize_wal", PGC_POSTMASTER, REPLICATION_SENDING,
+			gettext_noop("Starts the WAL summarizer process to enable incremental backups."),
+			NULL
+		},
+		&summarize_wal,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"ssl", PGC_SIGHUP, CONN_AUTH_SECURITY,
 			gettext_noop("Enables SSL connections."),
@@ -1024,6 +1089,35 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"double_write", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Protects against partial page writes with a double-write buffer instead of full-page writes."),
+			gettext_noop("Each data page is written to a separate file and flushed "
+						 "to disk before it is written in place, so that a partially "
+						 "written page can be repaired during recovery.  Full-page "
+						 "images are then only written to WAL during backups.")
+		},
+		&double_write,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"recovery_prefetch", PGC_SIGHUP, WAL_SETTINGS,
+			gettext_noop("Prefetches blocks referenced in the WAL during recovery."),
+			gettext_noop("Looks ahead in the WAL to find blocks that will be "
+						 "needed by upcoming records, and asks the operating "
+						 "system to start reading them.")
+		},
+		&recovery_prefetch,
+#ifdef USE_PREFETCH
+		true,
+#else
+		false,
+#endif
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_log_hints", PGC_POSTMASTER, WAL_SETTINGS,
 			gettext_noop("Writes full pages to WAL when first modified after a checkpoint, even for a non-critical modifications."),
@@ -1824,6 +1918,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"wal_receiver_compression_level", PGC_SIGHUP, REPLICATION_STANDBY,
+			gettext_noop("Sets the level of compression requested for streamed WAL."),
+			gettext_noop("-1 uses the default level of the compression method.")
+		},
+		&wal_receiver_compression_level,
+		WIRE_COMPRESS_DEFAULT_LEVEL, -1, WIRE_COMPRESS_MAX_LEVEL,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_connections", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the maximum number of concurrent connections."),
@@ -1943,6 +2047,18 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"logical_decoding_work_mem", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for logical decoding."),
+			gettext_noop("This much memory can be used by each internal "
+						 "reorder buffer before spilling to disk or streaming."),
+			GUC_UNIT_KB
+		},
+		&logical_decoding_work_mem,
+		65536, 64, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We use the hopefully-safely-small value of 100kB as the compiled-in
 	 * default for max_stack_depth.  InitializeGUCOptions will increase it if
@@ -1959,6 +2075,16 @@ static struct config_int ConfigureNamesInt[] =
 		check_max_stack_depth, assign_max_stack_depth, NULL
 	},
 
+	{
+		{"smgr_shared_relations", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of relations whose sizes are cached in shared memory."),
+			gettext_noop("Zero disables the cache.")
+		},
+		&smgr_shared_relations,
+		10000, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"temp_file_limit", PGC_SUSET, RESOURCES_DISK,
 			gettext_noop("Limits the total size of all temporary files used by each process."),
@@ -2346,6 +2472,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"recovery_prefetch_distance", PGC_SIGHUP, WAL_SETTINGS,
+			gettext_noop("Sets how far ahead of replay to look for blocks to prefetch."),
+			NULL,
+			GUC_UNIT_BYTE
+		},
+		&recovery_prefetch_distance,
+		256 * 1024, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		/* see max_connections */
 		{"max_wal_senders", PGC_POSTMASTER, REPLICATION_SENDING,
@@ -2379,6 +2516,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"wal_summary_keep_time", PGC_SIGHUP, REPLICATION_SENDING,
+			gettext_noop("Time for which WAL summary files should be kept."),
+			gettext_noop("0 keeps them forever."),
+			GUC_UNIT_MIN
+		},
+		&wal_summary_keep_time,
+		10 * 24 * 60, 0, INT_MAX / SECS_PER_MINUTE,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"commit_delay", PGC_SUSET, WAL_SETTINGS,
 			gettext_noop("Sets the delay in microseconds between transaction commit and "
@@ -2533,6 +2681,43 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_parallel_apply_workers_per_subscription",
+			PGC_SIGHUP,
+			REPLICATION_SUBSCRIBERS,
+			gettext_noop("Maximum number of parallel apply workers per subscription."),
+			NULL,
+		},
+		&max_parallel_apply_workers_per_subscription,
+		0, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"max_parallel_sync_workers_per_table",
+			PGC_SIGHUP,
+			REPLICATION_SUBSCRIBERS,
+			gettext_noop("Maximum number of parallel workers helping to copy a table during initial synchronization."),
+			NULL,
+		},
+		&max_parallel_sync_workers_per_table,
+		0, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"min_parallel_table_sync_size",
+			PGC_SIGHUP,
+			REPLICATION_SUBSCRIBERS,
+			gettext_noop("Sets the minimum size of a table for it to be copied in parallel during initial synchronization."),
+			NULL,
+			GUC_UNIT_BLOCKS,
+		},
+		&min_parallel_table_sync_size,
+		(1024 * 1024 * 1024) / BLCKSZ, 0, INT_MAX / 3,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"log_rotation_age", PGC_SIGHUP, LOGGING_WHERE,
 			gettext_noop("Automatic log file rotation will occur after N minutes."),
@@ -2726,6 +2911,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_parallel_redo_workers", PGC_POSTMASTER, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the maximum number of parallel workers used to replay WAL during recovery."),
+			NULL
+		},
+		&max_parallel_redo_workers,
+		0, 0, MAX_PARALLEL_WORKER_LIMIT,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"autovacuum_work_mem", PGC_SIGHUP, RESOURCES_MEM,
 			gettext_noop("Sets the maximum memory to be used by each autovacuum worker process."),
@@ -3649,6 +3844,17 @@ static struct config_string ConfigureNamesString[] =
 		check_wal_consistency_checking, assign_wal_consistency_checking, NULL
 	},
 
+	{
+		{"io_direct", PGC_POSTMASTER, RESOURCES_DISK,
+			gettext_noop("Sets the kinds of file read and written without the kernel's page cache."),
+			gettext_noop("Valid values are combinations of \"data\" and \"wal\"."),
+			GUC_LIST_INPUT
+		},
+		&io_direct_string,
+		"",
+		check_io_direct, assign_io_direct, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, NULL, NULL, NULL, NULL
@@ -3895,6 +4101,36 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"io_method", PGC_SIGHUP, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Selects the method the checkpointer uses to write buffers."),
+			NULL
+		},
+		&io_method,
+		IO_METHOD_SYNC, io_method_options,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"recovery_init_sync_method", PGC_SIGHUP, ERROR_HANDLING_OPTIONS,
+			gettext_noop("Sets the method for synchronizing the data directory before crash recovery."),
+			NULL
+		},
+		&recovery_init_sync_method,
+		RECOVERY_INIT_SYNC_METHOD_FSYNC, recovery_init_sync_method_options,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"wal_receiver_compression", PGC_SIGHUP, REPLICATION_STANDBY,
+			gettext_noop("Sets the method used to compress WAL streamed from the primary."),
+			NULL
+		},
+		&wal_receiver_compression,
+		WIRE_COMPRESS_NONE, wal_receiver_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"force_parallel_mode", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Forces use of parallel query facilities."),
@@ -10427,6 +10663,67 @@ assign_effective_io_concurrency(int newval, void *extra)
 #endif							/* USE_PREFETCH */
 }
 
+static bool
+check_io_direct(char **newval, void **extra, GucSource source)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	int			flags = 0;
+
+	/* Need a modifiable copy of string */
+	rawstring = pstrdup(*newval);
+
+	/* Parse string into list of identifiers */
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		/* syntax error in list */
+		GUC_check_errdetail("List syntax is invalid.");
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	foreach(l, elemlist)
+	{
+		char	   *tok = (char *) lfirst(l);
+
+		if (pg_strcasecmp(tok, "data") == 0)
+			flags |= IO_DIRECT_DATA;
+		else if (pg_strcasecmp(tok, "wal") == 0)
+			flags |= IO_DIRECT_WAL;
+		else
+		{
+			GUC_check_errdetail("Unrecognized key word: \"%s\".", tok);
+			pfree(rawstring);
+			list_free(elemlist);
+			return false;
+		}
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+
+#if PG_O_DIRECT == 0
+	if (flags != 0)
+	{
+		GUC_check_errdetail("Direct I/O is not supported on this platform.");
+		return false;
+	}
+#endif
+
+	*extra = guc_malloc(ERROR, sizeof(int));
+	*((int *) *extra) = flags;
+
+	return true;
+}
+
+static void
+assign_io_direct(const char *newval, void *extra)
+{
+	io_direct_flags = *((int *) extra);
+}
+
 static void
 assign_pgstat_temp_directory(const char *newval, void *extra)
 {
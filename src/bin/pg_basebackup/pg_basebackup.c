@@ -17,6 +17,9 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 #include <signal.h>
 #include <time.h>
 #ifdef HAVE_SYS_SELECT_H
@@ -29,12 +32,14 @@
 #include "access/xlog_internal.h"
 #include "common/file_utils.h"
 #include "common/string.h"
+#include "common/wire_compress.h"
 #include "fe_utils/string_utils.h"
 #include "getopt_long.h"
 #include "libpq-fe.h"
 #include "pqexpbuffer.h"
 #include "pgtar.h"
 #include "pgtime.h"
+#include "portability/mem.h"
 #include "receivelog.h"
 #include "replication/basebackup.h"
 #include "streamutil.h"
@@ -64,6 +69,28 @@ typedef struct TablespaceList
  */
 #define MINIMUM_VERSION_FOR_TEMP_SLOTS 100000
 
+/*
+ * Compression of the transferred data is supported from version 11.
+ */
+#define MINIMUM_VERSION_FOR_TRANSFER_COMPRESSION 110000
+
+/*
+ * Incremental backups are supported from version 11.
+ */
+#define MINIMUM_VERSION_FOR_INCREMENTAL 110000
+
+/*
+ * Transferring the files over several connections, with START_BACKUP,
+ * SEND_FILES and STOP_BACKUP, is supported from version 11.
+ */
+#define MINIMUM_VERSION_FOR_PARALLEL 110000
+
+/*
+ * Number of files a parallel backup worker requests with one SEND_FILES
+ * command.
+ */
+#define FILES_PER_SEND_FILES 1000
+
 /*
  * Different ways to include WAL
  */
@@ -93,6 +120,10 @@ static pg_time_t last_progress_report = 0;
 static int32 maxrate = 0;		/* no limit by default */
 static char *replication_slot = NULL;
 static bool temp_replication_slot = true;
+static WireCompressMethod transfer_compression = WIRE_COMPRESS_NONE;
+static int	transfer_compression_level = WIRE_COMPRESS_DEFAULT_LEVEL;
+static char *incremental_lsn = NULL;
+static int	jobs = 1;
 
 static bool success = false;
 static bool made_new_pgdata = false;
@@ -116,6 +147,13 @@ static int	bgpipe[2] = {-1, -1};
 static pid_t bgchild = -1;
 static bool in_log_streamer = false;
 
+/*
+ * In a parallel backup, true in the worker processes, and the place where
+ * each worker publishes its progress to the main process.
+ */
+static bool in_backup_worker = false;
+static uint64 *worker_progress = NULL;
+
 /* End position for xlog streaming, empty string if unknown yet */
 static XLogRecPtr xlogendptr;
 
@@ -128,6 +166,10 @@ static volatile LONG has_xlogendptr = 0;
 /* Contents of recovery.conf to be generated */
 static PQExpBuffer recoveryconfcontents = NULL;
 
+/* State for receiving a compressed tar stream, see ReceiveCopyData() */
+static WireCompressor *transfer_decompressor = NULL;
+static char *rawcopybuf = NULL;
+
 /* Function headers */
 static void usage(void);
 static void disconnect_and_exit(int code);
@@ -136,6 +178,13 @@ static void progress_report(int tablespacenum, const char *filename, bool force)
 
 static void ReceiveTarFile(PGconn *conn, PGresult *res, int rownum);
 static void ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum);
+static void UnpackTarStream(PGconn *conn, const char *current_path,
+				int rownum);
+static char *GetCompressionClause(void);
+#ifndef WIN32
+static void ReceiveFilesInParallel(PGresult *filelist);
+static void BackupWorkerMain(char **files, int nfiles);
+#endif
 static void GenerateRecoveryConf(PGconn *conn);
 static void WriteRecoveryConf(void);
 static void BaseBackup(void);
@@ -150,7 +199,7 @@ static void tablespace_list_append(const char *arg);
 static void
 cleanup_directories_atexit(void)
 {
-	if (success || in_log_streamer)
+	if (success || in_log_streamer || in_backup_worker)
 		return;
 
 	if (!noclean)
@@ -332,8 +381,13 @@ usage(void)
 	printf(_("\nOptions controlling the output:\n"));
 	printf(_("  -D, --pgdata=DIRECTORY receive base backup into directory\n"));
 	printf(_("  -F, --format=p|t       output format (plain (default), tar)\n"));
+	printf(_("      --incremental=LSN  take an incremental backup relative to the backup\n"
+			 "                         that started at LSN\n"));
 	printf(_("  -r, --max-rate=RATE    maximum transfer rate to transfer data directory\n"
 			 "                         (in kB/s, or use suffix \"k\" or \"M\")\n"));
+	printf(_("      --transfer-compression=METHOD[:LEVEL]\n"
+			 "                         compress the data sent by the server\n"
+			 "                         (zlib or pglz)\n"));
 	printf(_("  -R, --write-recovery-conf\n"
 			 "                         write recovery.conf for replication\n"));
 	printf(_("  -S, --slot=SLOTNAME    replication slot to use\n"));
@@ -348,6 +402,8 @@ usage(void)
 	printf(_("\nGeneral options:\n"));
 	printf(_("  -c, --checkpoint=fast|spread\n"
 			 "                         set fast or spread checkpointing\n"));
+	printf(_("  -j, --jobs=NUM         use this many parallel connections to transfer\n"
+			 "                         files\n"));
 	printf(_("  -l, --label=LABEL      set backup label\n"));
 	printf(_("  -n, --no-clean         do not clean up after errors\n"));
 	printf(_("  -N, --no-sync          do not wait for changes to be written safely to disk\n"));
@@ -493,6 +549,8 @@ LogStreamerMain(logstreamer_param *param)
 	stream.partial_suffix = NULL;
 	stream.replication_slot = replication_slot;
 	stream.temp_slot = param->temp_slot;
+	stream.compression = transfer_compression;
+	stream.compression_level = transfer_compression_level;
 	if (stream.temp_slot && !stream.replication_slot)
 		stream.replication_slot = psprintf("pg_basebackup_%d", (int) PQbackendPID(param->bgconn));
 
@@ -715,6 +773,13 @@ progress_report(int tablespacenum, const char *filename, bool force)
 	if (!showprogress)
 		return;
 
+	/* A parallel backup worker leaves reporting to the main process */
+	if (in_backup_worker)
+	{
+		*worker_progress = totaldone;
+		return;
+	}
+
 	now = time(NULL);
 	if (now == last_progress_report && !force)
 		return;					/* Max once per second */
@@ -882,6 +947,145 @@ parse_max_rate(char *src)
 	return (int32) result;
 }
 
+/*
+ * Parse the argument of --transfer-compression, METHOD[:LEVEL].
+ */
+static void
+parse_transfer_compression(const char *src)
+{
+	char	   *method = pg_strdup(src);
+	char	   *sep;
+
+	sep = strchr(method, ':');
+	if (sep != NULL)
+	{
+		char	   *endptr;
+		long		level;
+
+		*sep = '\0';
+		errno = 0;
+		level = strtol(sep + 1, &endptr, 10);
+		if (errno != 0 || *endptr != '\0' || endptr == sep + 1 ||
+			level < 0 || level > WIRE_COMPRESS_MAX_LEVEL)
+		{
+			fprintf(stderr,
+					_("%s: invalid transfer compression level \"%s\"\n"),
+					progname, sep + 1);
+			exit(1);
+		}
+		transfer_compression_level = (int) level;
+	}
+
+	if (!wire_compress_parse_method(method, &transfer_compression))
+	{
+		fprintf(stderr,
+				_("%s: invalid transfer compression method \"%s\", must be \"zlib\", \"pglz\" or \"none\"\n"),
+				progname, method);
+		exit(1);
+	}
+	if (!wire_compress_supported(transfer_compression))
+	{
+		fprintf(stderr,
+				_("%s: transfer compression method \"%s\" is not supported by this build\n"),
+				progname, method);
+		exit(1);
+	}
+
+	pg_free(method);
+}
+
+/*
+ * Return the options of the replication commands for transfer compression,
+ * or NULL if it is not in use.
+ */
+static char *
+GetCompressionClause(void)
+{
+	if (transfer_compression == WIRE_COMPRESS_NONE)
+		return NULL;
+
+	if (transfer_compression_level != WIRE_COMPRESS_DEFAULT_LEVEL)
+		return psprintf("COMPRESSION '%s' COMPRESSION_LEVEL %d",
+						wire_compress_method_name(transfer_compression),
+						transfer_compression_level);
+	else
+		return psprintf("COMPRESSION '%s'",
+						wire_compress_method_name(transfer_compression));
+}
+
+/*
+ * Receive a CopyData message of a tar stream, decompressing it if transfer
+ * compression is in use.  Returns what PQgetCopyData() would return for the
+ * uncompressed stream; the message in *buffer stays valid until the next
+ * call.
+ */
+static int
+ReceiveCopyData(PGconn *conn, char **buffer)
+{
+	int			r;
+
+	if (rawcopybuf != NULL)
+	{
+		PQfreemem(rawcopybuf);
+		rawcopybuf = NULL;
+	}
+
+	r = PQgetCopyData(conn, &rawcopybuf, 0);
+	if (r <= 0 || transfer_decompressor == NULL)
+	{
+		*buffer = rawcopybuf;
+		return r;
+	}
+
+	if (!wire_decompress(transfer_decompressor, rawcopybuf, r, buffer, &r))
+	{
+		fprintf(stderr, _("%s: could not decompress COPY data\n"),
+				progname);
+		disconnect_and_exit(1);
+	}
+
+	return r;
+}
+
+/*
+ * Set up decompression of a tar stream, if transfer compression is in use.
+ * The server compresses every tar stream independently.
+ */
+static void
+StartTarStream(void)
+{
+	if (transfer_compression == WIRE_COMPRESS_NONE)
+		return;
+
+	transfer_decompressor = wire_compressor_create(transfer_compression,
+												   transfer_compression_level,
+												   true);
+	if (transfer_decompressor == NULL)
+	{
+		fprintf(stderr, _("%s: could not initialize %s decompression\n"),
+				progname, wire_compress_method_name(transfer_compression));
+		disconnect_and_exit(1);
+	}
+}
+
+/*
+ * Clean up after a tar stream has been received.
+ */
+static void
+EndTarStream(void)
+{
+	if (rawcopybuf != NULL)
+	{
+		PQfreemem(rawcopybuf);
+		rawcopybuf = NULL;
+	}
+	if (transfer_decompressor != NULL)
+	{
+		wire_compressor_free(transfer_decompressor);
+		transfer_decompressor = NULL;
+	}
+}
+
 /*
  * Write a piece of tar data
  */
@@ -1065,17 +1269,13 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 		disconnect_and_exit(1);
 	}
 
+	StartTarStream();
+
 	while (1)
 	{
 		int			r;
 
-		if (copybuf != NULL)
-		{
-			PQfreemem(copybuf);
-			copybuf = NULL;
-		}
-
-		r = PQgetCopyData(conn, &copybuf, 0);
+		r = ReceiveCopyData(conn, &copybuf);
 		if (r == -1)
 		{
 			/*
@@ -1267,8 +1467,7 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 	}							/* while (1) */
 	progress_report(rownum, filename, true);
 
-	if (copybuf != NULL)
-		PQfreemem(copybuf);
+	EndTarStream();
 
 	/* sync the resulting tar file, errors are not considered fatal */
 	if (do_sync && strcmp(basedir, "-") != 0)
@@ -1306,13 +1505,7 @@ static void
 ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 {
 	char		current_path[MAXPGPATH];
-	char		filename[MAXPGPATH];
-	const char *mapped_tblspc_path;
-	pgoff_t		current_len_left = 0;
-	int			current_padding = 0;
 	bool		basetablespace;
-	char	   *copybuf = NULL;
-	FILE	   *file = NULL;
 
 	basetablespace = PQgetisnull(res, rownum, 0);
 	if (basetablespace)
@@ -1322,6 +1515,33 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 				get_tablespace_mapping(PQgetvalue(res, rownum, 1)),
 				sizeof(current_path));
 
+	UnpackTarStream(conn, current_path, rownum);
+
+	if (basetablespace && writerecoveryconf)
+		WriteRecoveryConf();
+
+	/*
+	 * No data is synced here, everything is done for all tablespaces at the
+	 * end.
+	 */
+}
+
+/*
+ * Receive a tar format stream from the connection to the server, and unpack
+ * it into current_path.  rownum is the tablespace number to show in progress
+ * reports.
+ */
+static void
+UnpackTarStream(PGconn *conn, const char *current_path, int rownum)
+{
+	PGresult   *res;
+	char		filename[MAXPGPATH];
+	const char *mapped_tblspc_path;
+	pgoff_t		current_len_left = 0;
+	int			current_padding = 0;
+	char	   *copybuf = NULL;
+	FILE	   *file = NULL;
+
 	/*
 	 * Get the COPY data
 	 */
@@ -1332,18 +1552,15 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 				progname, PQerrorMessage(conn));
 		disconnect_and_exit(1);
 	}
+	PQclear(res);
+
+	StartTarStream();
 
 	while (1)
 	{
 		int			r;
 
-		if (copybuf != NULL)
-		{
-			PQfreemem(copybuf);
-			copybuf = NULL;
-		}
-
-		r = PQgetCopyData(conn, &copybuf, 0);
+		r = ReceiveCopyData(conn, &copybuf);
 
 		if (r == -1)
 		{
@@ -1546,18 +1763,319 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 		disconnect_and_exit(1);
 	}
 
-	if (copybuf != NULL)
-		PQfreemem(copybuf);
+	EndTarStream();
+}
 
-	if (basetablespace && writerecoveryconf)
-		WriteRecoveryConf();
+#ifndef WIN32
+/*
+ * A file to back up, from the list returned by START_BACKUP.
+ */
+typedef struct
+{
+	char	   *path;
+	uint64		size;
+	int			worker;			/* parallel backup worker that fetches it */
+} BackupFile;
 
-	/*
-	 * No data is synced here, everything is done for all tablespaces at the
-	 * end.
-	 */
+/*
+ * qsort comparison function, to sort files largest first.
+ */
+static int
+compareBackupFileSize(const void *a, const void *b)
+{
+	const BackupFile *fa = (const BackupFile *) a;
+	const BackupFile *fb = (const BackupFile *) b;
+
+	if (fa->size > fb->size)
+		return -1;
+	if (fa->size < fb->size)
+		return 1;
+	return 0;
 }
 
+/*
+ * Create the directories and symbolic links in the list returned by
+ * START_BACKUP, and fetch the files with "jobs" worker processes, each with
+ * a connection of its own.
+ *
+ * The files are handed out largest first, each to the worker with the least
+ * data so far, so that the workers finish at about the same time.  While
+ * they run, the workers put their progress in shared memory, for us to
+ * report.
+ */
+static void
+ReceiveFilesInParallel(PGresult *filelist)
+{
+	int			nentries = PQntuples(filelist);
+	BackupFile *files;
+	int			nfiles = 0;
+	uint64	   *workersize;
+	uint64	   *progress;
+	pid_t	   *workers;
+	int			nrunning;
+	int			i,
+				j;
+
+	files = pg_malloc(nentries * sizeof(BackupFile));
+	for (i = 0; i < nentries; i++)
+	{
+		char	   *path = PQgetvalue(filelist, i, 0);
+		char		type = PQgetvalue(filelist, i, 1)[0];
+		char		filename[MAXPGPATH];
+
+		snprintf(filename, sizeof(filename), "%s/%s", basedir, path);
+
+		if (type == 'd')
+		{
+			/* pg_wal may exist already, see ReceiveAndUnpackTarFile() */
+			if (mkdir(filename, S_IRWXU) != 0 &&
+				!((pg_str_endswith(filename, "/pg_wal") ||
+				   pg_str_endswith(filename, "/pg_xlog") ||
+				   pg_str_endswith(filename, "/archive_status")) &&
+				  errno == EEXIST))
+			{
+				fprintf(stderr,
+						_("%s: could not create directory \"%s\": %s\n"),
+						progname, filename, strerror(errno));
+				disconnect_and_exit(1);
+			}
+		}
+		else if (type == 'l')
+		{
+			const char *mapped_tblspc_path;
+
+			mapped_tblspc_path =
+				get_tablespace_mapping(PQgetvalue(filelist, i, 3));
+			if (symlink(mapped_tblspc_path, filename) != 0)
+			{
+				fprintf(stderr,
+						_("%s: could not create symbolic link from \"%s\" to \"%s\": %s\n"),
+						progname, filename, mapped_tblspc_path,
+						strerror(errno));
+				disconnect_and_exit(1);
+			}
+		}
+		else if (type == 'f')
+		{
+			files[nfiles].path = path;
+			files[nfiles].size = atol(PQgetvalue(filelist, i, 2));
+			nfiles++;
+		}
+		else
+		{
+			fprintf(stderr,
+					_("%s: unrecognized type \"%c\" of file \"%s\" in list of files to back up\n"),
+					progname, type, path);
+			disconnect_and_exit(1);
+		}
+	}
+
+	qsort(files, nfiles, sizeof(BackupFile), compareBackupFileSize);
+
+	workersize = pg_malloc0(jobs * sizeof(uint64));
+	for (i = 0; i < nfiles; i++)
+	{
+		int			least = 0;
+
+		for (j = 1; j < jobs; j++)
+		{
+			if (workersize[j] < workersize[least])
+				least = j;
+		}
+		files[i].worker = least;
+		workersize[least] += files[i].size;
+	}
+
+	progress = mmap(NULL, jobs * sizeof(uint64), PROT_READ | PROT_WRITE,
+					MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (progress == MAP_FAILED)
+	{
+		fprintf(stderr, _("%s: could not create shared memory: %s\n"),
+				progname, strerror(errno));
+		disconnect_and_exit(1);
+	}
+
+	/* Flush stdio buffers, so that the workers don't write them again */
+	fflush(stdout);
+	fflush(stderr);
+
+	workers = pg_malloc0(jobs * sizeof(pid_t));
+	for (j = 0; j < jobs; j++)
+	{
+		workers[j] = fork();
+		if (workers[j] == 0)
+		{
+			char	  **myfiles = pg_malloc(nfiles * sizeof(char *));
+			int			nmyfiles = 0;
+
+			/*
+			 * The connection and the WAL streaming process belong to the
+			 * main process, and so does cleaning up after a failure.
+			 */
+			in_backup_worker = true;
+			worker_progress = &progress[j];
+			conn = NULL;
+			bgchild = -1;
+
+			for (i = 0; i < nfiles; i++)
+			{
+				if (files[i].worker == j)
+					myfiles[nmyfiles++] = files[i].path;
+			}
+
+			BackupWorkerMain(myfiles, nmyfiles);
+			exit(0);
+		}
+		if (workers[j] < 0)
+		{
+			fprintf(stderr, _("%s: could not create background process: %s\n"),
+					progname, strerror(errno));
+			for (i = 0; i < j; i++)
+				kill(workers[i], SIGTERM);
+			disconnect_and_exit(1);
+		}
+	}
+
+	/* Wait for the workers to finish, reporting their combined progress */
+	nrunning = jobs;
+	while (nrunning > 0)
+	{
+		for (j = 0; j < jobs; j++)
+		{
+			int			status;
+			pid_t		r;
+
+			if (workers[j] == 0)
+				continue;
+
+			r = waitpid(workers[j], &status, WNOHANG);
+			if (r == 0)
+				continue;
+			if (r == -1)
+			{
+				fprintf(stderr, _("%s: could not wait for child process: %s\n"),
+						progname, strerror(errno));
+				status = -1;
+			}
+			workers[j] = 0;
+			nrunning--;
+
+			if (r == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			{
+				if (r != -1)
+					fprintf(stderr,
+							_("%s: parallel backup worker failed: %s\n"),
+							progname, wait_result_to_str(status));
+				for (i = 0; i < jobs; i++)
+				{
+					if (workers[i] > 0)
+						kill(workers[i], SIGTERM);
+				}
+				disconnect_and_exit(1);
+			}
+		}
+
+		if (showprogress)
+		{
+			totaldone = 0;
+			for (j = 0; j < jobs; j++)
+				totaldone += progress[j];
+			progress_report(0, "", false);
+		}
+
+		if (nrunning > 0)
+			pg_usleep(100000L);
+	}
+
+	munmap(progress, jobs * sizeof(uint64));
+	pg_free(workers);
+	pg_free(workersize);
+	pg_free(files);
+}
+
+/*
+ * Main routine of a parallel backup worker: fetch the given files with
+ * SEND_FILES, a batch at a time, and write them into the data directory.
+ * Files in tablespaces are written through the symbolic links in pg_tblspc,
+ * which the main process has created already.
+ */
+static void
+BackupWorkerMain(char **files, int nfiles)
+{
+	PQExpBuffer query;
+	char	   *compression_clause = GetCompressionClause();
+	int32		workerrate = 0;
+	int			i = 0;
+
+	if (nfiles == 0)
+		return;
+
+	conn = GetConnection();
+	if (!conn)
+		/* Error message already written in GetConnection() */
+		exit(1);
+
+	/* The workers share the transfer rate limit */
+	if (maxrate > 0)
+		workerrate = Max(maxrate / jobs, MAX_RATE_LOWER);
+
+	query = createPQExpBuffer();
+	while (i < nfiles)
+	{
+		PGresult   *res;
+		int			n;
+
+		resetPQExpBuffer(query);
+		appendPQExpBufferStr(query, "SEND_FILES (");
+		for (n = 0; n < FILES_PER_SEND_FILES && i < nfiles; n++, i++)
+		{
+			const char *p;
+
+			if (n > 0)
+				appendPQExpBufferStr(query, ", ");
+			appendPQExpBufferChar(query, '\'');
+			for (p = files[i]; *p; p++)
+			{
+				if (*p == '\'')
+					appendPQExpBufferChar(query, '\'');
+				appendPQExpBufferChar(query, *p);
+			}
+			appendPQExpBufferChar(query, '\'');
+		}
+		appendPQExpBufferChar(query, ')');
+		if (workerrate > 0)
+			appendPQExpBuffer(query, " MAX_RATE %u", workerrate);
+		if (compression_clause)
+			appendPQExpBuffer(query, " %s", compression_clause);
+
+		if (PQsendQuery(conn, query->data) == 0)
+		{
+			fprintf(stderr, _("%s: could not send replication command \"%s\": %s"),
+					progname, "SEND_FILES", PQerrorMessage(conn));
+			disconnect_and_exit(1);
+		}
+
+		UnpackTarStream(conn, basedir, 0);
+
+		res = PQgetResult(conn);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		{
+			fprintf(stderr, _("%s: could not receive backup files: %s"),
+					progname, PQerrorMessage(conn));
+			disconnect_and_exit(1);
+		}
+		PQclear(res);
+
+		while ((res = PQgetResult(conn)) != NULL)
+			PQclear(res);
+	}
+
+	destroyPQExpBuffer(query);
+	PQfinish(conn);
+	conn = NULL;
+}
+#endif							/* WIN32 */
+
 /*
  * Escape a string so that it can be used as a value in a key-value pair
  * a configuration file.
@@ -1700,6 +2218,10 @@ BaseBackup(void)
 	char	   *basebkp;
 	char		escaped_label[MAXPGPATH];
 	char	   *maxrate_clause = NULL;
+	char	   *compression_clause = NULL;
+	char	   *incremental_clause = NULL;
+	const char *backupcmd;
+	PGresult   *filelist = NULL;
 	int			i;
 	char		xlogstart[64];
 	char		xlogend[64];
@@ -1741,6 +2263,35 @@ BaseBackup(void)
 		disconnect_and_exit(1);
 	}
 
+	if (transfer_compression != WIRE_COMPRESS_NONE &&
+		serverVersion < MINIMUM_VERSION_FOR_TRANSFER_COMPRESSION)
+	{
+		const char *serverver = PQparameterStatus(conn, "server_version");
+
+		fprintf(stderr, _("%s: transfer compression is not supported by server version %s\n"),
+				progname, serverver ? serverver : "'unknown'");
+		disconnect_and_exit(1);
+	}
+
+	if (incremental_lsn != NULL &&
+		serverVersion < MINIMUM_VERSION_FOR_INCREMENTAL)
+	{
+		const char *serverver = PQparameterStatus(conn, "server_version");
+
+		fprintf(stderr, _("%s: incremental backups are not supported by server version %s\n"),
+				progname, serverver ? serverver : "'unknown'");
+		disconnect_and_exit(1);
+	}
+
+	if (jobs > 1 && serverVersion < MINIMUM_VERSION_FOR_PARALLEL)
+	{
+		const char *serverver = PQparameterStatus(conn, "server_version");
+
+		fprintf(stderr, _("%s: parallel backups are not supported by server version %s\n"),
+				progname, serverver ? serverver : "'unknown'");
+		disconnect_and_exit(1);
+	}
+
 	/*
 	 * Build contents of recovery.conf if requested
 	 */
@@ -1761,6 +2312,11 @@ BaseBackup(void)
 	if (maxrate > 0)
 		maxrate_clause = psprintf("MAX_RATE %u", maxrate);
 
+	compression_clause = GetCompressionClause();
+
+	if (incremental_lsn != NULL)
+		incremental_clause = psprintf("INCREMENTAL '%s'", incremental_lsn);
+
 	if (verbose)
 		fprintf(stderr,
 				_("%s: initiating base backup, waiting for checkpoint to complete\n"),
@@ -1769,20 +2325,39 @@ BaseBackup(void)
 	if (showprogress && !verbose)
 		fprintf(stderr, "waiting for checkpoint\r");
 
-	basebkp =
-		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s",
-				 escaped_label,
-				 showprogress ? "PROGRESS" : "",
-				 includewal == FETCH_WAL ? "WAL" : "",
-				 fastcheckpoint ? "FAST" : "",
-				 includewal == NO_WAL ? "" : "NOWAIT",
-				 maxrate_clause ? maxrate_clause : "",
-				 format == 't' ? "TABLESPACE_MAP" : "");
+	/*
+	 * In a parallel backup, the files are fetched over other connections
+	 * between START_BACKUP and STOP_BACKUP.
+	 */
+	if (jobs > 1)
+	{
+		backupcmd = "START_BACKUP";
+		basebkp =
+			psprintf("START_BACKUP LABEL '%s' %s %s",
+					 escaped_label,
+					 showprogress ? "PROGRESS" : "",
+					 fastcheckpoint ? "FAST" : "");
+	}
+	else
+	{
+		backupcmd = "BASE_BACKUP";
+		basebkp =
+			psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s %s",
+					 escaped_label,
+					 showprogress ? "PROGRESS" : "",
+					 includewal == FETCH_WAL ? "WAL" : "",
+					 fastcheckpoint ? "FAST" : "",
+					 includewal == NO_WAL ? "" : "NOWAIT",
+					 maxrate_clause ? maxrate_clause : "",
+					 format == 't' ? "TABLESPACE_MAP" : "",
+					 compression_clause ? compression_clause : "",
+					 incremental_clause ? incremental_clause : "");
+	}
 
 	if (PQsendQuery(conn, basebkp) == 0)
 	{
 		fprintf(stderr, _("%s: could not send replication command \"%s\": %s"),
-				progname, "BASE_BACKUP", PQerrorMessage(conn));
+				progname, backupcmd, PQerrorMessage(conn));
 		disconnect_and_exit(1);
 	}
 
@@ -1799,8 +2374,8 @@ BaseBackup(void)
 	if (PQntuples(res) != 1)
 	{
 		fprintf(stderr,
-				_("%s: server returned unexpected response to BASE_BACKUP command; got %d rows and %d fields, expected %d rows and %d fields\n"),
-				progname, PQntuples(res), PQnfields(res), 1, 2);
+				_("%s: server returned unexpected response to %s command; got %d rows and %d fields, expected %d rows and %d fields\n"),
+				progname, backupcmd, PQntuples(res), PQnfields(res), 1, 2);
 		disconnect_and_exit(1);
 	}
 
@@ -1874,6 +2449,41 @@ BaseBackup(void)
 		disconnect_and_exit(1);
 	}
 
+	/*
+	 * In a parallel backup, get the list of files to back up, which ends the
+	 * output of START_BACKUP.
+	 */
+	if (jobs > 1)
+	{
+		PGresult   *endres;
+
+		filelist = PQgetResult(conn);
+		if (PQresultStatus(filelist) != PGRES_TUPLES_OK)
+		{
+			fprintf(stderr, _("%s: could not get list of files to back up: %s"),
+					progname, PQerrorMessage(conn));
+			disconnect_and_exit(1);
+		}
+		if (PQnfields(filelist) != 4)
+		{
+			fprintf(stderr,
+					_("%s: server returned unexpected response to %s command; got %d fields, expected %d fields\n"),
+					progname, backupcmd, PQnfields(filelist), 4);
+			disconnect_and_exit(1);
+		}
+
+		endres = PQgetResult(conn);
+		if (PQresultStatus(endres) != PGRES_COMMAND_OK)
+		{
+			fprintf(stderr, _("%s: could not start base backup: %s"),
+					progname, PQerrorMessage(conn));
+			disconnect_and_exit(1);
+		}
+		PQclear(endres);
+		while ((endres = PQgetResult(conn)) != NULL)
+			PQclear(endres);
+	}
+
 	/*
 	 * If we're streaming WAL, start the streaming session before we start
 	 * receiving the actual data chunks.
@@ -1889,13 +2499,43 @@ BaseBackup(void)
 	/*
 	 * Start receiving chunks
 	 */
-	for (i = 0; i < PQntuples(res); i++)
+#ifndef WIN32
+	if (jobs > 1)
 	{
-		if (format == 't')
-			ReceiveTarFile(conn, res, i);
-		else
-			ReceiveAndUnpackTarFile(conn, res, i);
-	}							/* Loop over all tablespaces */
+		char	   *stopcmd;
+
+		ReceiveFilesInParallel(filelist);
+		PQclear(filelist);
+
+		/*
+		 * Finish the backup.  STOP_BACKUP sends backup_label, pg_control and
+		 * any WAL requested, all to go in the main data directory, which is
+		 * the last tablespace in the header.
+		 */
+		stopcmd = psprintf("STOP_BACKUP %s %s %s %s",
+						   includewal == FETCH_WAL ? "WAL" : "",
+						   includewal == NO_WAL ? "" : "NOWAIT",
+						   maxrate_clause ? maxrate_clause : "",
+						   compression_clause ? compression_clause : "");
+		if (PQsendQuery(conn, stopcmd) == 0)
+		{
+			fprintf(stderr, _("%s: could not send replication command \"%s\": %s"),
+					progname, "STOP_BACKUP", PQerrorMessage(conn));
+			disconnect_and_exit(1);
+		}
+		pg_free(stopcmd);
+
+		ReceiveAndUnpackTarFile(conn, res, PQntuples(res) - 1);
+	}
+	else
+#endif
+		for (i = 0; i < PQntuples(res); i++)
+		{
+			if (format == 't')
+				ReceiveTarFile(conn, res, i);
+			else
+				ReceiveAndUnpackTarFile(conn, res, i);
+		}						/* Loop over all tablespaces */
 
 	if (showprogress)
 	{
@@ -2100,6 +2740,9 @@ main(int argc, char **argv)
 		{"progress", no_argument, NULL, 'P'},
 		{"waldir", required_argument, NULL, 1},
 		{"no-slot", no_argument, NULL, 2},
+		{"transfer-compression", required_argument, NULL, 3},
+		{"incremental", required_argument, NULL, 4},
+		{"jobs", required_argument, NULL, 'j'},
 		{NULL, 0, NULL, 0}
 	};
 	int			c;
@@ -2127,7 +2770,7 @@ main(int argc, char **argv)
 
 	atexit(cleanup_directories_atexit);
 
-	while ((c = getopt_long(argc, argv, "D:F:r:RT:X:l:nNzZ:d:c:h:p:U:s:S:wWvP",
+	while ((c = getopt_long(argc, argv, "D:F:r:RT:X:l:nNzZ:d:c:h:j:p:U:s:S:wWvP",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -2151,6 +2794,25 @@ main(int argc, char **argv)
 			case 'r':
 				maxrate = parse_max_rate(optarg);
 				break;
+			case 3:
+				parse_transfer_compression(optarg);
+				break;
+			case 4:
+				{
+					uint32		hi,
+								lo;
+					char		junk;
+
+					if (sscanf(optarg, "%X/%X%c", &hi, &lo, &junk) != 2)
+					{
+						fprintf(stderr,
+								_("%s: could not parse incremental backup start location \"%s\"\n"),
+								progname, optarg);
+						exit(1);
+					}
+					incremental_lsn = psprintf("%X/%X", hi, lo);
+				}
+				break;
 			case 'R':
 				writerecoveryconf = true;
 				break;
@@ -2236,6 +2898,15 @@ main(int argc, char **argv)
 			case 'd':
 				connection_string = pg_strdup(optarg);
 				break;
+			case 'j':
+				jobs = atoi(optarg);
+				if (jobs <= 0)
+				{
+					fprintf(stderr, _("%s: invalid number of parallel jobs \"%s\"\n"),
+							progname, optarg);
+					exit(1);
+				}
+				break;
 			case 'h':
 				dbhost = pg_strdup(optarg);
 				break;
@@ -2324,6 +2995,34 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (jobs > 1)
+	{
+#ifdef WIN32
+		fprintf(stderr,
+				_("%s: parallel backups are not supported on this platform\n"),
+				progname);
+		exit(1);
+#endif
+		if (format != 'p')
+		{
+			fprintf(stderr,
+					_("%s: parallel backups are only supported in plain mode\n"),
+					progname);
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+		if (incremental_lsn != NULL)
+		{
+			fprintf(stderr,
+					_("%s: --incremental cannot be used with parallel backups\n"),
+					progname);
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+	}
+
 	if (replication_slot && includewal != STREAM_WAL)
 	{
 		fprintf(stderr,
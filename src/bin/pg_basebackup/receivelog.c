@@ -37,11 +37,15 @@ static XLogRecPtr lastFlushPosition = InvalidXLogRecPtr;
 
 static bool still_sending = true;	/* feedback still needs to be sent? */
 
+/* Decompressor for the WAL stream, if compression was requested */
+static WireCompressor *decompressor = NULL;
+
 static PGresult *HandleCopyStream(PGconn *conn, StreamCtl *stream,
 				 XLogRecPtr *stoppos);
 static int	CopyStreamPoll(PGconn *conn, long timeout_ms, pgsocket stop_socket);
 static int CopyStreamReceive(PGconn *conn, long timeout, pgsocket stop_socket,
 				  char **buffer);
+static void CopyStreamFreeBuffer(char *buffer);
 static bool ProcessKeepaliveMsg(PGconn *conn, StreamCtl *stream, char *copybuf,
 					int len, XLogRecPtr blockpos, TimestampTz *last_status);
 static bool ProcessXLogDataMsg(PGconn *conn, StreamCtl *stream, char *copybuf, int len,
@@ -446,8 +450,9 @@ CheckServerVersionForStreaming(PGconn *conn)
 bool
 ReceiveXlogStream(PGconn *conn, StreamCtl *stream)
 {
-	char		query[128];
+	char		query[256];
 	char		slotcmd[128];
+	char		compresscmd[64];
 	PGresult   *res;
 	XLogRecPtr	stoppos;
 
@@ -483,6 +488,21 @@ ReceiveXlogStream(PGconn *conn, StreamCtl *stream)
 		slotcmd[0] = 0;
 	}
 
+	/* The caller should've checked that the server supports compression */
+	if (stream->compression != WIRE_COMPRESS_NONE)
+	{
+		if (stream->compression_level != WIRE_COMPRESS_DEFAULT_LEVEL)
+			snprintf(compresscmd, sizeof(compresscmd),
+					 " COMPRESSION '%s' COMPRESSION_LEVEL %d",
+					 wire_compress_method_name(stream->compression),
+					 stream->compression_level);
+		else
+			snprintf(compresscmd, sizeof(compresscmd), " COMPRESSION '%s'",
+					 wire_compress_method_name(stream->compression));
+	}
+	else
+		compresscmd[0] = 0;
+
 	if (stream->sysidentifier != NULL)
 	{
 		/* Validate system identifier hasn't changed */
@@ -594,10 +614,10 @@ ReceiveXlogStream(PGconn *conn, StreamCtl *stream)
 			return true;
 
 		/* Initiate the replication stream at specified location */
-		snprintf(query, sizeof(query), "START_REPLICATION %s%X/%X TIMELINE %u",
+		snprintf(query, sizeof(query), "START_REPLICATION %s%X/%X TIMELINE %u%s",
 				 slotcmd,
 				 (uint32) (stream->startpos >> 32), (uint32) stream->startpos,
-				 stream->timeline);
+				 stream->timeline, compresscmd);
 		res = PQexec(conn, query);
 		if (PQresultStatus(res) != PGRES_COPY_BOTH)
 		{
@@ -781,6 +801,19 @@ HandleCopyStream(PGconn *conn, StreamCtl *stream,
 
 	still_sending = true;
 
+	if (stream->compression != WIRE_COMPRESS_NONE)
+	{
+		decompressor = wire_compressor_create(stream->compression,
+											  stream->compression_level,
+											  true);
+		if (decompressor == NULL)
+		{
+			fprintf(stderr, _("%s: could not initialize %s decompression\n"),
+					progname, wire_compress_method_name(stream->compression));
+			return NULL;
+		}
+	}
+
 	while (1)
 	{
 		int			r;
@@ -848,8 +881,13 @@ HandleCopyStream(PGconn *conn, StreamCtl *stream,
 
 				if (res == NULL)
 					goto error;
-				else
-					return res;
+
+				if (decompressor != NULL)
+				{
+					wire_compressor_free(decompressor);
+					decompressor = NULL;
+				}
+				return res;
 			}
 
 			/* Check the message type. */
@@ -887,8 +925,12 @@ HandleCopyStream(PGconn *conn, StreamCtl *stream,
 	}
 
 error:
-	if (copybuf != NULL)
-		PQfreemem(copybuf);
+	CopyStreamFreeBuffer(copybuf);
+	if (decompressor != NULL)
+	{
+		wire_compressor_free(decompressor);
+		decompressor = NULL;
+	}
 	return NULL;
 }
 
@@ -971,8 +1013,7 @@ CopyStreamReceive(PGconn *conn, long timeout, pgsocket stop_socket,
 	char	   *copybuf = NULL;
 	int			rawlen;
 
-	if (*buffer != NULL)
-		PQfreemem(*buffer);
+	CopyStreamFreeBuffer(*buffer);
 	*buffer = NULL;
 
 	/* Try to receive a CopyData message */
@@ -1013,11 +1054,38 @@ CopyStreamReceive(PGconn *conn, long timeout, pgsocket stop_socket,
 		return -1;
 	}
 
+	/* Decompress the message, if the stream is compressed */
+	if (decompressor != NULL)
+	{
+		bool		ok;
+
+		ok = wire_decompress(decompressor, copybuf, rawlen, buffer, &rawlen);
+		PQfreemem(copybuf);
+		if (!ok)
+		{
+			fprintf(stderr, _("%s: could not decompress data from WAL stream\n"),
+					progname);
+			return -1;
+		}
+		return rawlen;
+	}
+
 	/* Return received messages to caller */
 	*buffer = copybuf;
 	return rawlen;
 }
 
+/*
+ * Release a message returned by CopyStreamReceive.  Decompressed messages
+ * live in the decompressor's buffer, which is reused for the next message.
+ */
+static void
+CopyStreamFreeBuffer(char *buffer)
+{
+	if (buffer != NULL && decompressor == NULL)
+		PQfreemem(buffer);
+}
+
 /*
  * Process the keepalive message.
  */
@@ -1246,8 +1314,7 @@ HandleEndOfCopyStream(PGconn *conn, StreamCtl *stream, char *copybuf,
 		}
 		still_sending = false;
 	}
-	if (copybuf != NULL)
-		PQfreemem(copybuf);
+	CopyStreamFreeBuffer(copybuf);
 	*stoppos = blockpos;
 	return res;
 }
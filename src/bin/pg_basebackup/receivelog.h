@@ -16,6 +16,7 @@
 #include "walmethods.h"
 
 #include "access/xlogdefs.h"
+#include "common/wire_compress.h"
 
 /*
  * Called before trying to read more data or when a segment is
@@ -48,6 +49,8 @@ typedef struct StreamCtl
 	char	   *partial_suffix; /* Suffix appended to partially received files */
 	char	   *replication_slot;	/* Replication slot to use, or NULL */
 	bool		temp_slot;		/* Create temporary replication slot */
+	WireCompressMethod compression; /* Compression to ask the server for */
+	int			compression_level;	/* Compression level, or -1 */
 } StreamCtl;
 
 
@@ -4,7 +4,7 @@ use Cwd;
 use Config;
 use PostgresNode;
 use TestLib;
-use Test::More tests => 72;
+use Test::More tests => 88;
 
 program_help_ok('pg_basebackup');
 program_version_ok('pg_basebackup');
@@ -141,7 +141,7 @@ unlink "$pgdata/$superlongname";
 # skip on Windows.
 SKIP:
 {
-	skip "symlinks not supported on Windows", 11 if ($windows_os);
+	skip "symlinks not supported on Windows", 13 if ($windows_os);
 
 	# Move pg_replslot out of $pgdata and create a symlink to it.
 	$node->stop;
@@ -192,6 +192,13 @@ SKIP:
 	ok( -d "$tempdir/backup1/pg_replslot",
 		'pg_replslot symlink copied as directory');
 
+	$node->command_ok(
+		[   'pg_basebackup', '-D', "$tempdir/backup1par", '-Fp', '-j', '2',
+			"-T$shorter_tempdir/tblspc1=$tempdir/tbackup/tblspc1par" ],
+		'parallel plain format with tablespaces');
+	ok(glob("$tempdir/tbackup/tblspc1par/PG_*/*/*"),
+		'tablespace files copied in parallel');
+
 	mkdir "$tempdir/tbl=spc2";
 	$node->safe_psql('postgres', "DROP TABLE test1;");
 	$node->safe_psql('postgres', "DROP TABLESPACE tblspc1;");
@@ -255,6 +262,99 @@ $node->command_ok(
 		'stream',                '--no-slot' ],
 	'pg_basebackup -X stream runs with --no-slot');
 
+$node->command_ok(
+	[   'pg_basebackup', '-D', "$tempdir/backupxs_comp", '-X',
+		'stream',        '--transfer-compression=pglz' ],
+	'pg_basebackup -X stream runs with transfer compression');
+ok(grep(/^[0-9A-F]{24}$/, slurp_dir("$tempdir/backupxs_comp/pg_wal")),
+	'WAL files copied');
+$node->command_ok(
+	[   'pg_basebackup', '-D', "$tempdir/tarbackup_comp", '-Ft', '-X',
+		'fetch',         '--transfer-compression=pglz:9' ],
+	'pg_basebackup runs in tar mode with transfer compression');
+ok(-f "$tempdir/tarbackup_comp/base.tar", 'backup tar was created');
+$node->command_fails(
+	[   'pg_basebackup', '-D', "$tempdir/backup_comp_fail",
+		'--transfer-compression=foo' ],
+	'pg_basebackup fails with invalid transfer compression method');
+
+$node->command_fails(
+	[   'pg_basebackup', '-D', "$tempdir/backup_incr_fail",
+		'--incremental=0/0' ],
+	'pg_basebackup --incremental fails without summarize_wal');
+
+SKIP:
+{
+	skip "parallel backups not supported on Windows", 4 if ($windows_os);
+
+	$node->command_ok(
+		[ 'pg_basebackup', '-D', "$tempdir/backup_par", '-X', 'stream', '-j', '2' ],
+		'pg_basebackup runs with parallel jobs');
+	ok(-f "$tempdir/backup_par/global/pg_control", 'pg_control was copied');
+	ok(grep(/^[0-9A-F]{24}$/, slurp_dir("$tempdir/backup_par/pg_wal")),
+		'WAL files copied');
+	$node->command_fails(
+		[ 'pg_basebackup', '-D', "$tempdir/backup_par_fail", '-Ft', '-j', '2' ],
+		'pg_basebackup -j fails in tar mode');
+}
+
+# Cancel STOP_BACKUP while it waits for WAL to be archived.  The failed
+# command must end the backup exactly once, also when the session goes
+# away afterwards.
+SKIP:
+{
+	skip "parallel backups not supported on Windows", 4 if ($windows_os);
+
+	my $node_arch = get_new_node('archive_fail');
+	$node_arch->init(allows_streaming => 1);
+	$node_arch->append_conf(
+		'postgresql.conf', qq{
+archive_mode = on
+archive_command = 'false'
+});
+	$node_arch->start;
+
+	my ($stdout, $stderr) = ('', '');
+	my $timer = IPC::Run::timer(180);
+	my $h = IPC::Run::start(
+		[   'pg_basebackup', '-D', "$tempdir/backup_stop_cancel",
+			'-X', 'none', '-j', '2', '-p', $node_arch->port ],
+		'>', \$stdout, '2>', \$stderr, $timer);
+	while ($stderr !~ /waiting for required WAL segments to be archived/
+		&& !$timer->is_expired
+		&& $h->pumpable)
+	{
+		$h->pump_nb;
+		select(undef, undef, undef, 0.1);
+	}
+	like(
+		$stderr,
+		qr/waiting for required WAL segments to be archived/,
+		'STOP_BACKUP waits for WAL archiving');
+
+	$node_arch->safe_psql('postgres',
+		q{SELECT pg_cancel_backend(pid) FROM pg_stat_activity
+		  WHERE backend_type = 'walsender'});
+	ok(!$h->finish, 'pg_basebackup fails when STOP_BACKUP is canceled');
+
+	$node_arch->poll_query_until('postgres',
+		q{SELECT count(*) = 0 FROM pg_stat_activity
+		  WHERE backend_type = 'walsender'})
+	  or die "timed out waiting for the backup connections to go away";
+	unlike(
+		slurp_file($node_arch->logfile),
+		qr/terminated by signal/,
+		'no process crashed after the canceled STOP_BACKUP');
+
+	# A new backup in a session of its own still starts and stops cleanly
+	is( $node_arch->safe_psql(
+			'postgres', q{SELECT pg_start_backup('test', true, false) IS NOT NULL;
+SELECT count(*) FROM pg_stop_backup(false, false);}),
+		"t\n1",
+		'a backup can be taken after the canceled STOP_BACKUP');
+	$node_arch->stop('immediate');
+}
+
 $node->command_fails(
 	[ 'pg_basebackup', '-D', "$tempdir/fail", '-S', 'slot1' ],
 	'pg_basebackup with replication slot fails without -X stream');
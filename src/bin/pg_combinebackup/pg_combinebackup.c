@@ -0,0 +1,915 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_combinebackup.c - reconstruct a full backup from an incremental backup
+ *						and the backups it is based on
+ *
+ * The backups are given oldest first: a full backup, followed by a chain of
+ * incremental backups, each taken relative to the one before it.  The
+ * output directory receives the files of the newest backup.  Where that
+ * backup has an incremental file, the relation file is put together block
+ * by block from the newest backup that has each block.
+ *
+ * Only plain format backups are supported.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * src/bin/pg_combinebackup/pg_combinebackup.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "catalog/pg_control.h"
+#include "common/controldata_utils.h"
+#include "common/file_utils.h"
+#include "getopt_long.h"
+#include "replication/basebackup.h"
+
+
+typedef struct TablespaceListCell
+{
+	struct TablespaceListCell *next;
+	char		old_dir[MAXPGPATH];
+	char		new_dir[MAXPGPATH];
+} TablespaceListCell;
+
+typedef struct TablespaceList
+{
+	TablespaceListCell *head;
+	TablespaceListCell *tail;
+} TablespaceList;
+
+/* One of the input backups */
+typedef struct BackupInfo
+{
+	char	   *dir;
+	uint64		system_identifier;
+	XLogRecPtr	start_lsn;		/* START WAL LOCATION */
+	XLogRecPtr	incremental_from;	/* INCREMENTAL FROM LSN, or invalid */
+} BackupInfo;
+
+/* Where a block of a reconstructed file comes from */
+typedef struct BlockSource
+{
+	int			backup;			/* index into backups[], or -1 for zeros */
+	pgoff_t		offset;			/* offset of the block in that file */
+} BlockSource;
+
+#define COPY_BUF_SIZE	(64 * 1024)
+
+static const char *progname;
+static TablespaceList tablespace_dirs = {NULL, NULL};
+static BackupInfo *backups;
+static int	nbackups;
+static char *output_dir = NULL;
+static bool do_sync = true;
+
+static void usage(void);
+static void tablespace_list_append(const char *arg);
+static void read_backup_info(BackupInfo *backup, const char *dir);
+static void combine_dir(const char *relpath);
+static void combine_tablespace(const char *relpath, const char *name);
+static void copy_file(const char *src, const char *dst);
+static void copy_backup_label(const char *src, const char *dst);
+static void reconstruct_file(const char *relpath, const char *name);
+static bool read_incremental_header(int fd, const char *path,
+						uint32 *file_nblocks, uint32 *nblocks,
+						uint32 **blocks);
+static void read_fully(int fd, const char *path, char *buf, size_t len);
+static void write_fully(int fd, const char *path, const char *buf, size_t len);
+
+
+static void
+usage(void)
+{
+	printf(_("%s reconstructs a full backup from an incremental backup and the backups it is based on.\n\n"),
+		   progname);
+	printf(_("Usage:\n"));
+	printf(_("  %s [OPTION]... DIRECTORY...\n"), progname);
+	printf(_("\nThe backup directories are given oldest first, starting with a full backup.\n"));
+	printf(_("\nOptions:\n"));
+	printf(_("  -N, --no-sync          do not wait for changes to be written safely to disk\n"));
+	printf(_("  -o, --output=DIRECTORY output directory\n"));
+	printf(_("  -T, --tablespace-mapping=OLDDIR=NEWDIR\n"
+			 "                         relocate tablespace in OLDDIR to NEWDIR\n"));
+	printf(_("  -V, --version          output version information, then exit\n"));
+	printf(_("  -?, --help             show this help, then exit\n"));
+	printf(_("\nReport bugs to <pgsql-bugs@postgresql.org>.\n"));
+}
+
+/*
+ * Split argument into old_dir and new_dir and append to tablespace mapping
+ * list.  Same as in pg_basebackup.
+ */
+static void
+tablespace_list_append(const char *arg)
+{
+	TablespaceListCell *cell = (TablespaceListCell *) pg_malloc0(sizeof(TablespaceListCell));
+	char	   *dst;
+	char	   *dst_ptr;
+	const char *arg_ptr;
+
+	dst_ptr = dst = cell->old_dir;
+	for (arg_ptr = arg; *arg_ptr; arg_ptr++)
+	{
+		if (dst_ptr - dst >= MAXPGPATH)
+		{
+			fprintf(stderr, _("%s: directory name too long\n"), progname);
+			exit(1);
+		}
+
+		if (*arg_ptr == '\\' && *(arg_ptr + 1) == '=')
+			;					/* skip backslash escaping = */
+		else if (*arg_ptr == '=' && (arg_ptr == arg || *(arg_ptr - 1) != '\\'))
+		{
+			if (*cell->new_dir)
+			{
+				fprintf(stderr, _("%s: multiple \"=\" signs in tablespace mapping\n"), progname);
+				exit(1);
+			}
+			else
+				dst = dst_ptr = cell->new_dir;
+		}
+		else
+			*dst_ptr++ = *arg_ptr;
+	}
+
+	if (!*cell->old_dir || !*cell->new_dir)
+	{
+		fprintf(stderr,
+				_("%s: invalid tablespace mapping format \"%s\", must be \"OLDDIR=NEWDIR\"\n"),
+				progname, arg);
+		exit(1);
+	}
+
+	if (!is_absolute_path(cell->old_dir))
+	{
+		fprintf(stderr, _("%s: old directory is not an absolute path in tablespace mapping: %s\n"),
+				progname, cell->old_dir);
+		exit(1);
+	}
+
+	if (!is_absolute_path(cell->new_dir))
+	{
+		fprintf(stderr, _("%s: new directory is not an absolute path in tablespace mapping: %s\n"),
+				progname, cell->new_dir);
+		exit(1);
+	}
+
+	canonicalize_path(cell->old_dir);
+	canonicalize_path(cell->new_dir);
+
+	if (tablespace_dirs.tail)
+		tablespace_dirs.tail->next = cell;
+	else
+		tablespace_dirs.head = cell;
+	tablespace_dirs.tail = cell;
+}
+
+/*
+ * Read the backup_label and pg_control of a backup.
+ */
+static void
+read_backup_info(BackupInfo *backup, const char *dir)
+{
+	char		path[MAXPGPATH];
+	char		line[MAXPGPATH];
+	FILE	   *fp;
+	ControlFileData *control;
+	bool		crc_ok;
+	bool		found_start = false;
+	uint32		hi,
+				lo;
+
+	backup->dir = pg_strdup(dir);
+	backup->start_lsn = InvalidXLogRecPtr;
+	backup->incremental_from = InvalidXLogRecPtr;
+
+	snprintf(path, sizeof(path), "%s/backup_label", dir);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+				progname, path, strerror(errno));
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) == 2)
+		{
+			backup->start_lsn = ((uint64) hi) << 32 | lo;
+			found_start = true;
+		}
+		else if (sscanf(line, "INCREMENTAL FROM LSN: %X/%X", &hi, &lo) == 2)
+			backup->incremental_from = ((uint64) hi) << 32 | lo;
+	}
+	if (ferror(fp))
+	{
+		fprintf(stderr, _("%s: could not read file \"%s\": %s\n"),
+				progname, path, strerror(errno));
+		exit(1);
+	}
+	fclose(fp);
+
+	if (!found_start)
+	{
+		fprintf(stderr, _("%s: invalid data in file \"%s\"\n"),
+				progname, path);
+		exit(1);
+	}
+
+	control = get_controlfile(dir, progname, &crc_ok);
+	if (!crc_ok)
+	{
+		fprintf(stderr, _("%s: calculated CRC checksum does not match value stored in file \"%s/global/pg_control\"\n"),
+				progname, dir);
+		exit(1);
+	}
+	backup->system_identifier = control->system_identifier;
+	pg_free(control);
+}
+
+/*
+ * Produce the output for one directory of the newest backup, given by its
+ * path relative to the backup directory.  The corresponding directory in
+ * the output exists already.
+ */
+static void
+combine_dir(const char *relpath)
+{
+	BackupInfo *newest = &backups[nbackups - 1];
+	char		path[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *de;
+
+	snprintf(path, sizeof(path), "%s/%s", newest->dir, relpath);
+	dir = opendir(path);
+	if (dir == NULL)
+	{
+		fprintf(stderr, _("%s: could not open directory \"%s\": %s\n"),
+				progname, path, strerror(errno));
+		exit(1);
+	}
+
+	while (errno = 0, (de = readdir(dir)) != NULL)
+	{
+		char		subpath[MAXPGPATH];
+		char		srcpath[MAXPGPATH];
+		char		dstpath[MAXPGPATH];
+		struct stat st;
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		if (relpath[0] == '\0')
+			strlcpy(subpath, de->d_name, sizeof(subpath));
+		else
+			snprintf(subpath, sizeof(subpath), "%s/%s", relpath, de->d_name);
+		snprintf(srcpath, sizeof(srcpath), "%s/%s", newest->dir, subpath);
+		snprintf(dstpath, sizeof(dstpath), "%s/%s", output_dir, subpath);
+
+		/* Tablespaces are relocated rather than copied into pg_tblspc */
+		if (strcmp(relpath, "pg_tblspc") == 0)
+		{
+			combine_tablespace(subpath, de->d_name);
+			continue;
+		}
+
+		/* Anything else is followed if it is a symlink, such as pg_wal */
+		if (stat(srcpath, &st) < 0)
+		{
+			fprintf(stderr, _("%s: could not stat file \"%s\": %s\n"),
+					progname, srcpath, strerror(errno));
+			exit(1);
+		}
+
+		if (S_ISDIR(st.st_mode))
+		{
+			if (mkdir(dstpath, S_IRWXU) < 0)
+			{
+				fprintf(stderr, _("%s: could not create directory \"%s\": %s\n"),
+						progname, dstpath, strerror(errno));
+				exit(1);
+			}
+			combine_dir(subpath);
+		}
+		else if (S_ISREG(st.st_mode))
+		{
+			if (strncmp(de->d_name, INCREMENTAL_PREFIX,
+						strlen(INCREMENTAL_PREFIX)) == 0)
+				reconstruct_file(relpath,
+								 de->d_name + strlen(INCREMENTAL_PREFIX));
+			else if (strcmp(subpath, "backup_label") == 0)
+				copy_backup_label(srcpath, dstpath);
+			else
+				copy_file(srcpath, dstpath);
+		}
+		else
+			fprintf(stderr, _("%s: skipping special file \"%s\"\n"),
+					progname, srcpath);
+	}
+
+	if (errno)
+	{
+		fprintf(stderr, _("%s: could not read directory \"%s\": %s\n"),
+				progname, path, strerror(errno));
+		exit(1);
+	}
+	closedir(dir);
+}
+
+/*
+ * Produce the output for a tablespace, pg_tblspc/<oid> in the newest
+ * backup.  The tablespace must be relocated with a tablespace mapping, since
+ * its original location holds the newest backup's copy.
+ */
+static void
+combine_tablespace(const char *relpath, const char *name)
+{
+	char		srcpath[MAXPGPATH];
+	char		dstpath[MAXPGPATH];
+	char		target[MAXPGPATH];
+	TablespaceListCell *cell;
+	int			rllen;
+
+	snprintf(srcpath, sizeof(srcpath), "%s/%s", backups[nbackups - 1].dir,
+			 relpath);
+	snprintf(dstpath, sizeof(dstpath), "%s/%s", output_dir, relpath);
+
+	rllen = readlink(srcpath, target, sizeof(target));
+	if (rllen < 0)
+	{
+		fprintf(stderr, _("%s: could not read symbolic link \"%s\": %s\n"),
+				progname, srcpath, strerror(errno));
+		exit(1);
+	}
+	if (rllen >= sizeof(target))
+	{
+		fprintf(stderr, _("%s: symbolic link \"%s\" target is too long\n"),
+				progname, srcpath);
+		exit(1);
+	}
+	target[rllen] = '\0';
+	canonicalize_path(target);
+
+	for (cell = tablespace_dirs.head; cell; cell = cell->next)
+		if (strcmp(target, cell->old_dir) == 0)
+			break;
+	if (cell == NULL)
+	{
+		fprintf(stderr, _("%s: no tablespace mapping given for tablespace %s in \"%s\"\n"),
+				progname, name, target);
+		exit(1);
+	}
+
+	switch (pg_check_dir(cell->new_dir))
+	{
+		case 0:
+			if (pg_mkdir_p(cell->new_dir, S_IRWXU) < 0)
+			{
+				fprintf(stderr, _("%s: could not create directory \"%s\": %s\n"),
+						progname, cell->new_dir, strerror(errno));
+				exit(1);
+			}
+			break;
+		case 1:
+			break;
+		case -1:
+			fprintf(stderr, _("%s: could not access directory \"%s\": %s\n"),
+					progname, cell->new_dir, strerror(errno));
+			exit(1);
+		default:
+			fprintf(stderr, _("%s: directory \"%s\" exists but is not empty\n"),
+					progname, cell->new_dir);
+			exit(1);
+	}
+
+	if (symlink(cell->new_dir, dstpath) < 0)
+	{
+		fprintf(stderr, _("%s: could not create symbolic link \"%s\": %s\n"),
+				progname, dstpath, strerror(errno));
+		exit(1);
+	}
+
+	/* Files in the tablespace are reached through the links from now on */
+	combine_dir(relpath);
+}
+
+/*
+ * Copy a file unchanged.
+ */
+static void
+copy_file(const char *src, const char *dst)
+{
+	char	   *buf = pg_malloc(COPY_BUF_SIZE);
+	int			srcfd;
+	int			dstfd;
+	int			nread;
+
+	srcfd = open(src, O_RDONLY | PG_BINARY, 0);
+	if (srcfd < 0)
+	{
+		fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+				progname, src, strerror(errno));
+		exit(1);
+	}
+	dstfd = open(dst, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY, S_IRUSR | S_IWUSR);
+	if (dstfd < 0)
+	{
+		fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
+				progname, dst, strerror(errno));
+		exit(1);
+	}
+
+	while ((nread = read(srcfd, buf, COPY_BUF_SIZE)) > 0)
+		write_fully(dstfd, dst, buf, nread);
+	if (nread < 0)
+	{
+		fprintf(stderr, _("%s: could not read file \"%s\": %s\n"),
+				progname, src, strerror(errno));
+		exit(1);
+	}
+
+	close(srcfd);
+	if (close(dstfd) != 0)
+	{
+		fprintf(stderr, _("%s: could not close file \"%s\": %s\n"),
+				progname, dst, strerror(errno));
+		exit(1);
+	}
+	pg_free(buf);
+}
+
+/*
+ * Copy the newest backup's backup_label, leaving out the line that marks it
+ * as incremental.
+ */
+static void
+copy_backup_label(const char *src, const char *dst)
+{
+	FILE	   *in;
+	FILE	   *out;
+	char		line[MAXPGPATH];
+
+	in = fopen(src, "r");
+	if (in == NULL)
+	{
+		fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+				progname, src, strerror(errno));
+		exit(1);
+	}
+	out = fopen(dst, "w");
+	if (out == NULL)
+	{
+		fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
+				progname, dst, strerror(errno));
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		if (strncmp(line, "INCREMENTAL FROM LSN:", 21) == 0)
+			continue;
+		if (fputs(line, out) < 0)
+		{
+			fprintf(stderr, _("%s: could not write file \"%s\": %s\n"),
+					progname, dst, strerror(errno));
+			exit(1);
+		}
+	}
+
+	if (ferror(in))
+	{
+		fprintf(stderr, _("%s: could not read file \"%s\": %s\n"),
+				progname, src, strerror(errno));
+		exit(1);
+	}
+	fclose(in);
+	if (fclose(out) != 0)
+	{
+		fprintf(stderr, _("%s: could not write file \"%s\": %s\n"),
+				progname, dst, strerror(errno));
+		exit(1);
+	}
+}
+
+/*
+ * Reconstruct relation file 'name' in directory 'relpath' from the
+ * incremental file in the newest backup and the backups before it.
+ */
+static void
+reconstruct_file(const char *relpath, const char *name)
+{
+	BlockSource *sources;
+	int		   *fds;
+	uint32		file_nblocks = 0;
+	uint32		nunknown;
+	uint32		b;
+	char		path[MAXPGPATH];
+	char		dstpath[MAXPGPATH];
+	char	   *buf;
+	int			dstfd;
+	int			i;
+
+	fds = pg_malloc(nbackups * sizeof(int));
+	for (i = 0; i < nbackups; i++)
+		fds[i] = -1;
+	sources = NULL;
+	nunknown = 0;
+
+	/*
+	 * Work backwards through the backups, taking each block not yet found
+	 * from the next older backup that has it, until a backup with the full
+	 * file is reached.
+	 */
+	for (i = nbackups - 1; i >= 0; i--)
+	{
+		uint32		inc_file_nblocks;
+		uint32		nblocks;
+		uint32	   *blocks;
+		uint32		j;
+
+		snprintf(path, sizeof(path), "%s/%s/%s%s", backups[i].dir, relpath,
+				 INCREMENTAL_PREFIX, name);
+		fds[i] = open(path, O_RDONLY | PG_BINARY, 0);
+		if (fds[i] >= 0)
+		{
+			if (!read_incremental_header(fds[i], path, &inc_file_nblocks,
+										 &nblocks, &blocks))
+			{
+				fprintf(stderr, _("%s: file \"%s\" is not a valid incremental file\n"),
+						progname, path);
+				exit(1);
+			}
+
+			if (sources == NULL)
+			{
+				/* The newest backup determines the length of the result */
+				file_nblocks = inc_file_nblocks;
+				sources = pg_malloc(Max(file_nblocks, 1) * sizeof(BlockSource));
+				for (b = 0; b < file_nblocks; b++)
+					sources[b].backup = -2;
+				nunknown = file_nblocks;
+			}
+
+			for (j = 0; j < nblocks; j++)
+			{
+				if (blocks[j] >= file_nblocks ||
+					sources[blocks[j]].backup != -2)
+					continue;
+				sources[blocks[j]].backup = i;
+				sources[blocks[j]].offset =
+					INCREMENTAL_HEADER_SIZE(nblocks) + (pgoff_t) j * BLCKSZ;
+				nunknown--;
+			}
+
+			/*
+			 * Blocks past the end of the file at this point weren't in this
+			 * backup and were not modified since; they are zeros.
+			 */
+			for (b = inc_file_nblocks; b < file_nblocks; b++)
+			{
+				if (sources[b].backup == -2)
+				{
+					sources[b].backup = -1;
+					nunknown--;
+				}
+			}
+			pg_free(blocks);
+		}
+		else if (errno == ENOENT && sources != NULL)
+		{
+			struct stat st;
+
+			/* Look for the full file instead */
+			snprintf(path, sizeof(path), "%s/%s/%s", backups[i].dir, relpath,
+					 name);
+			fds[i] = open(path, O_RDONLY | PG_BINARY, 0);
+			if (fds[i] < 0 && errno == ENOENT)
+			{
+				fprintf(stderr, _("%s: file \"%s/%s\" is missing from backup \"%s\"\n"),
+						progname, relpath, name, backups[i].dir);
+				exit(1);
+			}
+			if (fds[i] < 0 || fstat(fds[i], &st) < 0)
+			{
+				fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+						progname, path, strerror(errno));
+				exit(1);
+			}
+
+			for (b = 0; b < file_nblocks; b++)
+			{
+				if (sources[b].backup != -2)
+					continue;
+				if ((pgoff_t) (b + 1) * BLCKSZ <= st.st_size)
+				{
+					sources[b].backup = i;
+					sources[b].offset = (pgoff_t) b * BLCKSZ;
+				}
+				else
+					sources[b].backup = -1;
+			}
+			nunknown = 0;
+			break;
+		}
+		else
+		{
+			fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+					progname, path, strerror(errno));
+			exit(1);
+		}
+
+		if (nunknown == 0)
+			break;
+	}
+
+	/* The oldest backup is a full backup, so we must have found the file */
+	if (nunknown > 0)
+	{
+		fprintf(stderr, _("%s: file \"%s/%s\" is incremental in all backups\n"),
+				progname, relpath, name);
+		exit(1);
+	}
+
+	/* Write out the reconstructed file */
+	snprintf(dstpath, sizeof(dstpath), "%s/%s/%s", output_dir, relpath, name);
+	dstfd = open(dstpath, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY,
+				 S_IRUSR | S_IWUSR);
+	if (dstfd < 0)
+	{
+		fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
+				progname, dstpath, strerror(errno));
+		exit(1);
+	}
+
+	buf = pg_malloc(BLCKSZ);
+	for (b = 0; b < file_nblocks; b++)
+	{
+		BlockSource *src = &sources[b];
+
+		if (src->backup < 0)
+			memset(buf, 0, BLCKSZ);
+		else
+		{
+			if (lseek(fds[src->backup], src->offset, SEEK_SET) < 0)
+			{
+				fprintf(stderr, _("%s: could not seek in file \"%s/%s\" of backup \"%s\": %s\n"),
+						progname, relpath, name, backups[src->backup].dir,
+						strerror(errno));
+				exit(1);
+			}
+			read_fully(fds[src->backup], name, buf, BLCKSZ);
+		}
+		write_fully(dstfd, dstpath, buf, BLCKSZ);
+	}
+	pg_free(buf);
+
+	if (close(dstfd) != 0)
+	{
+		fprintf(stderr, _("%s: could not close file \"%s\": %s\n"),
+				progname, dstpath, strerror(errno));
+		exit(1);
+	}
+	for (i = 0; i < nbackups; i++)
+		if (fds[i] >= 0)
+			close(fds[i]);
+	pg_free(fds);
+	if (sources)
+		pg_free(sources);
+}
+
+/*
+ * Read the header of an incremental file.  Returns false if the header is
+ * invalid.
+ */
+static bool
+read_incremental_header(int fd, const char *path, uint32 *file_nblocks,
+						uint32 *nblocks, uint32 **blocks)
+{
+	uint32		hdr[3];
+	uint32		i;
+
+	read_fully(fd, path, (char *) hdr, sizeof(hdr));
+	if (hdr[0] != INCREMENTAL_MAGIC || hdr[2] > hdr[1])
+		return false;
+
+	*file_nblocks = hdr[1];
+	*nblocks = hdr[2];
+	*blocks = pg_malloc(Max(hdr[2], 1) * sizeof(uint32));
+	read_fully(fd, path, (char *) *blocks, hdr[2] * sizeof(uint32));
+
+	/* Block numbers must be ascending and within the file */
+	for (i = 0; i < hdr[2]; i++)
+	{
+		if ((*blocks)[i] >= hdr[1] || (i > 0 && (*blocks)[i] <= (*blocks)[i - 1]))
+			return false;
+	}
+
+	return true;
+}
+
+static void
+read_fully(int fd, const char *path, char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t		nread = read(fd, buf, len);
+
+		if (nread < 0)
+		{
+			fprintf(stderr, _("%s: could not read file \"%s\": %s\n"),
+					progname, path, strerror(errno));
+			exit(1);
+		}
+		if (nread == 0)
+		{
+			fprintf(stderr, _("%s: unexpected end of file \"%s\"\n"),
+					progname, path);
+			exit(1);
+		}
+		buf += nread;
+		len -= nread;
+	}
+}
+
+static void
+write_fully(int fd, const char *path, const char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t		nwritten = write(fd, buf, len);
+
+		if (nwritten <= 0)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (nwritten == 0 || errno == 0)
+				errno = ENOSPC;
+			fprintf(stderr, _("%s: could not write file \"%s\": %s\n"),
+					progname, path, strerror(errno));
+			exit(1);
+		}
+		buf += nwritten;
+		len -= nwritten;
+	}
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	static struct option long_options[] = {
+		{"help", no_argument, NULL, '?'},
+		{"version", no_argument, NULL, 'V'},
+		{"no-sync", no_argument, NULL, 'N'},
+		{"output", required_argument, NULL, 'o'},
+		{"tablespace-mapping", required_argument, NULL, 'T'},
+		{NULL, 0, NULL, 0}
+	};
+	int			c;
+	int			option_index;
+	int			i;
+
+	set_pglocale_pgservice(argv[0], PG_TEXTDOMAIN("pg_combinebackup"));
+
+	progname = get_progname(argv[0]);
+
+	if (argc > 1)
+	{
+		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+		{
+			usage();
+			exit(0);
+		}
+		if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0)
+		{
+			puts("pg_combinebackup (PostgreSQL) " PG_VERSION);
+			exit(0);
+		}
+	}
+
+	while ((c = getopt_long(argc, argv, "No:T:", long_options,
+							&option_index)) != -1)
+	{
+		switch (c)
+		{
+			case 'N':
+				do_sync = false;
+				break;
+			case 'o':
+				output_dir = pg_strdup(optarg);
+				break;
+			case 'T':
+				tablespace_list_append(optarg);
+				break;
+			default:
+				fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+						progname);
+				exit(1);
+		}
+	}
+
+	if (output_dir == NULL)
+	{
+		fprintf(stderr, _("%s: no output directory specified\n"), progname);
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+	if (argc - optind < 2)
+	{
+		fprintf(stderr, _("%s: at least two backup directories must be specified\n"),
+				progname);
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+	/* Check that the backups form a chain */
+	nbackups = argc - optind;
+	backups = pg_malloc(nbackups * sizeof(BackupInfo));
+	for (i = 0; i < nbackups; i++)
+	{
+		char	   *dir = pg_strdup(argv[optind + i]);
+
+		canonicalize_path(dir);
+		read_backup_info(&backups[i], dir);
+
+		if (i == 0)
+		{
+			if (backups[i].incremental_from != InvalidXLogRecPtr)
+			{
+				fprintf(stderr, _("%s: backup \"%s\" is an incremental backup, but the first backup must be a full backup\n"),
+						progname, dir);
+				exit(1);
+			}
+			continue;
+		}
+
+		if (backups[i].system_identifier != backups[0].system_identifier)
+		{
+			fprintf(stderr, _("%s: backup \"%s\" is from a different database system than backup \"%s\"\n"),
+					progname, dir, backups[0].dir);
+			exit(1);
+		}
+		if (backups[i].incremental_from == InvalidXLogRecPtr)
+		{
+			fprintf(stderr, _("%s: backup \"%s\" is a full backup, but only the first backup can be a full backup\n"),
+					progname, dir);
+			exit(1);
+		}
+
+		/*
+		 * The backup must contain all blocks modified since the previous one
+		 * started.
+		 */
+		if (backups[i].incremental_from > backups[i - 1].start_lsn)
+		{
+			fprintf(stderr, _("%s: backup \"%s\" is incremental from %X/%X, but the previous backup \"%s\" starts at %X/%X\n"),
+					progname, dir,
+					(uint32) (backups[i].incremental_from >> 32),
+					(uint32) backups[i].incremental_from,
+					backups[i - 1].dir,
+					(uint32) (backups[i - 1].start_lsn >> 32),
+					(uint32) backups[i - 1].start_lsn);
+			exit(1);
+		}
+	}
+
+	/* Create the output directory, which must be empty */
+	switch (pg_check_dir(output_dir))
+	{
+		case 0:
+			if (pg_mkdir_p(output_dir, S_IRWXU) < 0)
+			{
+				fprintf(stderr, _("%s: could not create directory \"%s\": %s\n"),
+						progname, output_dir, strerror(errno));
+				exit(1);
+			}
+			break;
+		case 1:
+			break;
+		case -1:
+			fprintf(stderr, _("%s: could not access directory \"%s\": %s\n"),
+					progname, output_dir, strerror(errno));
+			exit(1);
+		default:
+			fprintf(stderr, _("%s: directory \"%s\" exists but is not empty\n"),
+					progname, output_dir);
+			exit(1);
+	}
+
+	combine_dir("");
+
+	if (do_sync)
+		fsync_pgdata(output_dir, progname, PG_VERSION_NUM);
+
+	return 0;
+}
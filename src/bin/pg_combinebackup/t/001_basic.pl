@@ -0,0 +1,111 @@
+# Test reconstructing full backups from incremental backups
+use strict;
+use warnings;
+use PostgresNode;
+use RecursiveCopy;
+use TestLib;
+use Test::More tests => 20;
+
+program_help_ok('pg_combinebackup');
+program_version_ok('pg_combinebackup');
+program_options_handling_ok('pg_combinebackup');
+
+my $tempdir = TestLib::tempdir;
+
+my $node = get_new_node('main');
+$node->init(allows_streaming => 1);
+$node->append_conf('postgresql.conf', 'summarize_wal = on');
+$node->start;
+
+# Returns the start location of a backup, from its backup_label
+sub backup_start_lsn
+{
+	my ($dir) = @_;
+	my ($lsn) =
+	  slurp_file("$dir/backup_label") =~ /^START WAL LOCATION: (\S+)/m;
+	return $lsn;
+}
+
+$node->safe_psql('postgres',
+	    'CREATE TABLE t1 AS SELECT g AS a, repeat(\'x\', 100) AS b '
+	  . 'FROM generate_series(1, 10000) g;'
+	  . 'CREATE TABLE t2 (a int);'
+	  . 'CREATE TABLE t3 AS SELECT g AS a FROM generate_series(1, 10000) g;');
+
+$node->command_ok(
+	[ 'pg_basebackup', '-D', "$tempdir/full", '-X', 'stream' ],
+	'full backup');
+
+# Modify a few blocks, extend, truncate and drop relations
+$node->safe_psql('postgres',
+	    'UPDATE t1 SET b = \'y\' WHERE a IN (1, 5000);'
+	  . 'INSERT INTO t2 SELECT generate_series(1, 1000);'
+	  . 'TRUNCATE t3;'
+	  . 'INSERT INTO t3 VALUES (42);'
+	  . 'CREATE TABLE t4 AS SELECT 1 AS a;');
+
+my $full_lsn = backup_start_lsn("$tempdir/full");
+$node->command_ok(
+	[   'pg_basebackup', '-D', "$tempdir/incr1", '-X', 'stream',
+		"--incremental=$full_lsn" ],
+	'first incremental backup');
+like(
+	slurp_file("$tempdir/incr1/backup_label"),
+	qr/^INCREMENTAL FROM LSN: $full_lsn$/m,
+	'backup_label marks the backup as incremental');
+my $t1_path = $node->safe_psql('postgres',
+	q{SELECT pg_relation_filepath('t1')});
+ok(-f "$tempdir/incr1/" . ($t1_path =~ s{([^/]+)$}{INCREMENTAL.$1}r),
+	'modified relation is sent incrementally');
+
+$node->safe_psql('postgres',
+	'UPDATE t1 SET b = \'z\' WHERE a = 9000; DROP TABLE t4;');
+
+my $incr1_lsn = backup_start_lsn("$tempdir/incr1");
+$node->command_ok(
+	[   'pg_basebackup', '-D', "$tempdir/incr2", '-X', 'stream',
+		"--incremental=$incr1_lsn" ],
+	'second incremental backup');
+
+$node->command_fails(
+	[   'pg_combinebackup', '-o', "$tempdir/fail", "$tempdir/incr1",
+		"$tempdir/incr2" ],
+	'pg_combinebackup fails without a full backup');
+$node->command_fails(
+	[   'pg_combinebackup', '-o', "$tempdir/fail", "$tempdir/full",
+		"$tempdir/incr2" ],
+	'pg_combinebackup fails with a backup missing from the chain');
+
+my $combined = $node->backup_dir . '/combined';
+$node->command_ok(
+	[   'pg_combinebackup', '-o', $combined, "$tempdir/full",
+		"$tempdir/incr1", "$tempdir/incr2" ],
+	'pg_combinebackup runs');
+unlike(
+	slurp_file("$combined/backup_label"),
+	qr/^INCREMENTAL/m,
+	'combined backup is not marked as incremental');
+
+my $query =
+    'SELECT count(*), sum(a), string_agg(DISTINCT b, \',\' ORDER BY b) '
+  . 'FROM t1; SELECT count(*) FROM t2; SELECT * FROM t3;';
+my $expected = $node->safe_psql('postgres', $query);
+
+# Start a server on the combined backup and compare the contents
+my $restored = get_new_node('restored');
+$restored->init_from_backup($node, 'combined');
+$restored->start;
+is($restored->safe_psql('postgres', $query),
+	$expected, 'restored data matches');
+is($restored->safe_psql('postgres',
+	q{SELECT count(*) FROM pg_class WHERE relname = 't4'}),
+	'0', 'dropped table is gone');
+
+# An incremental backup can't be started without combining it
+my $incr_node = get_new_node('incremental');
+RecursiveCopy::copypath("$tempdir/incr2", $node->backup_dir . '/incr2');
+$incr_node->init_from_backup($node, 'incr2');
+command_fails(
+	[   'pg_ctl', '-D', $incr_node->data_dir, '-l', $incr_node->logfile,
+		'-w', 'start' ],
+	'server refuses to start from an incremental backup');
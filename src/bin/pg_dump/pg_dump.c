@@ -3619,6 +3619,8 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 	int			i_tableoid;
 	int			i_oid;
 	int			i_pubname;
+	int			i_pubrelcols;
+	int			i_pubrelqual;
 	int			i,
 				j,
 				ntups;
@@ -3651,13 +3653,28 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 		resetPQExpBuffer(query);
 
 		/* Get the publication membership for the table. */
-		appendPQExpBuffer(query,
-						  "SELECT pr.tableoid, pr.oid, p.pubname "
-						  "FROM pg_catalog.pg_publication_rel pr,"
-						  "     pg_catalog.pg_publication p "
-						  "WHERE pr.prrelid = '%u'"
-						  "  AND p.oid = pr.prpubid",
-						  tbinfo->dobj.catId.oid);
+		if (fout->remoteVersion >= 110000)
+			appendPQExpBuffer(query,
+							  "SELECT pr.tableoid, pr.oid, p.pubname, "
+							  "(SELECT pg_catalog.string_agg(pg_catalog.quote_ident(a.attname), ', ' ORDER BY a.attnum) "
+							  " FROM pg_catalog.pg_attribute a "
+							  " WHERE a.attrelid = pr.prrelid "
+							  "   AND a.attnum = ANY(pr.prattrs)) AS pubrelcols, "
+							  "pg_catalog.pg_get_expr(pr.prqual, pr.prrelid) AS pubrelqual "
+							  "FROM pg_catalog.pg_publication_rel pr,"
+							  "     pg_catalog.pg_publication p "
+							  "WHERE pr.prrelid = '%u'"
+							  "  AND p.oid = pr.prpubid",
+							  tbinfo->dobj.catId.oid);
+		else
+			appendPQExpBuffer(query,
+							  "SELECT pr.tableoid, pr.oid, p.pubname, "
+							  "NULL AS pubrelcols, NULL AS pubrelqual "
+							  "FROM pg_catalog.pg_publication_rel pr,"
+							  "     pg_catalog.pg_publication p "
+							  "WHERE pr.prrelid = '%u'"
+							  "  AND p.oid = pr.prpubid",
+							  tbinfo->dobj.catId.oid);
 		res = ExecuteSqlQuery(fout, query->data, PGRES_TUPLES_OK);
 
 		ntups = PQntuples(res);
@@ -3674,6 +3691,8 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 		i_tableoid = PQfnumber(res, "tableoid");
 		i_oid = PQfnumber(res, "oid");
 		i_pubname = PQfnumber(res, "pubname");
+		i_pubrelcols = PQfnumber(res, "pubrelcols");
+		i_pubrelqual = PQfnumber(res, "pubrelqual");
 
 		pubrinfo = pg_malloc(ntups * sizeof(PublicationRelInfo));
 
@@ -3687,6 +3706,16 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 			pubrinfo[j].dobj.namespace = tbinfo->dobj.namespace;
 			pubrinfo[j].dobj.name = tbinfo->dobj.name;
 			pubrinfo[j].pubname = pg_strdup(PQgetvalue(res, j, i_pubname));
+			if (PQgetisnull(res, j, i_pubrelcols))
+				pubrinfo[j].pubrelcols = NULL;
+			else
+				pubrinfo[j].pubrelcols =
+					pg_strdup(PQgetvalue(res, j, i_pubrelcols));
+			if (PQgetisnull(res, j, i_pubrelqual))
+				pubrinfo[j].pubrelqual = NULL;
+			else
+				pubrinfo[j].pubrelqual =
+					pg_strdup(PQgetvalue(res, j, i_pubrelqual));
 			pubrinfo[j].pubtable = tbinfo;
 
 			/* Decide whether we want to dump it */
@@ -3717,8 +3746,13 @@ dumpPublicationTable(Archive *fout, PublicationRelInfo *pubrinfo)
 
 	appendPQExpBuffer(query, "ALTER PUBLICATION %s ADD TABLE ONLY",
 					  fmtId(pubrinfo->pubname));
-	appendPQExpBuffer(query, " %s;",
+	appendPQExpBuffer(query, " %s",
 					  fmtId(tbinfo->dobj.name));
+	if (pubrinfo->pubrelcols)
+		appendPQExpBuffer(query, " (%s)", pubrinfo->pubrelcols);
+	if (pubrinfo->pubrelqual)
+		appendPQExpBuffer(query, " WHERE (%s)", pubrinfo->pubrelqual);
+	appendPQExpBufferStr(query, ";");
 
 	/*
 	 * There is no point in creating drop query as drop query as the drop is
@@ -3773,6 +3807,8 @@ getSubscriptions(Archive *fout)
 	int			i_subconninfo;
 	int			i_subslotname;
 	int			i_subsynccommit;
+	int			i_substream;
+	int			i_subbinary;
 	int			i_subpublications;
 	int			i,
 				ntups;
@@ -3805,11 +3841,19 @@ getSubscriptions(Archive *fout)
 					  "SELECT s.tableoid, s.oid, s.subname,"
 					  "(%s s.subowner) AS rolname, "
 					  " s.subconninfo, s.subslotname, s.subsynccommit, "
-					  " s.subpublications "
-					  "FROM pg_catalog.pg_subscription s "
-					  "WHERE s.subdbid = (SELECT oid FROM pg_catalog.pg_database"
-					  "                   WHERE datname = current_database())",
+					  " s.subpublications, ",
 					  username_subquery);
+
+	if (fout->remoteVersion >= 110000)
+		appendPQExpBufferStr(query, " s.substream, s.subbinary ");
+	else
+		appendPQExpBufferStr(query,
+							 " false AS substream, false AS subbinary ");
+
+	appendPQExpBufferStr(query,
+						 "FROM pg_catalog.pg_subscription s "
+						 "WHERE s.subdbid = (SELECT oid FROM pg_catalog.pg_database"
+						 "                   WHERE datname = current_database())");
 	res = ExecuteSqlQuery(fout, query->data, PGRES_TUPLES_OK);
 
 	ntups = PQntuples(res);
@@ -3822,6 +3866,8 @@ getSubscriptions(Archive *fout)
 	i_subslotname = PQfnumber(res, "subslotname");
 	i_subsynccommit = PQfnumber(res, "subsynccommit");
 	i_subpublications = PQfnumber(res, "subpublications");
+	i_substream = PQfnumber(res, "substream");
+	i_subbinary = PQfnumber(res, "subbinary");
 
 	subinfo = pg_malloc(ntups * sizeof(SubscriptionInfo));
 
@@ -3843,6 +3889,10 @@ getSubscriptions(Archive *fout)
 			pg_strdup(PQgetvalue(res, i, i_subsynccommit));
 		subinfo[i].subpublications =
 			pg_strdup(PQgetvalue(res, i, i_subpublications));
+		subinfo[i].substream =
+			pg_strdup(PQgetvalue(res, i, i_substream));
+		subinfo[i].subbinary =
+			pg_strdup(PQgetvalue(res, i, i_subbinary));
 
 		if (strlen(subinfo[i].rolname) == 0)
 			write_msg(NULL, "WARNING: owner of subscription \"%s\" appears to be invalid\n",
@@ -3914,6 +3964,12 @@ dumpSubscription(Archive *fout, SubscriptionInfo *subinfo)
 	if (strcmp(subinfo->subsynccommit, "off") != 0)
 		appendPQExpBuffer(query, ", synchronous_commit = %s", fmtId(subinfo->subsynccommit));
 
+	if (strcmp(subinfo->substream, "f") != 0)
+		appendPQExpBufferStr(query, ", streaming = on");
+
+	if (strcmp(subinfo->subbinary, "f") != 0)
+		appendPQExpBufferStr(query, ", binary = true");
+
 	appendPQExpBufferStr(query, ");\n");
 
 	appendPQExpBuffer(labelq, "SUBSCRIPTION %s", fmtId(subinfo->dobj.name));
@@ -596,6 +596,8 @@ typedef struct _PublicationRelInfo
 	DumpableObject dobj;
 	TableInfo  *pubtable;
 	char	   *pubname;
+	char	   *pubrelcols;		/* column list, or NULL for all */
+	char	   *pubrelqual;		/* row filter, or NULL */
 } PublicationRelInfo;
 
 /*
@@ -608,6 +610,8 @@ typedef struct _SubscriptionInfo
 	char	   *subconninfo;
 	char	   *subslotname;
 	char	   *subsynccommit;
+	char	   *substream;
+	char	   *subbinary;
 	char	   *subpublications;
 } SubscriptionInfo;
 
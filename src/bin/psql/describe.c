@@ -2530,19 +2530,41 @@ describeOneTableDetails(const char *schemaname,
 		}
 
 		/* print any publications */
-		if (pset.sversion >= 100000)
+		if (pset.sversion >= 110000)
 		{
 			printfPQExpBuffer(&buf,
-							  "SELECT pubname\n"
+							  "SELECT pubname,\n"
+							  "  (SELECT pg_catalog.string_agg(pg_catalog.quote_ident(a.attname), ', ' ORDER BY a.attnum)\n"
+							  "   FROM pg_catalog.pg_attribute a\n"
+							  "   WHERE a.attrelid = pr.prrelid AND a.attnum = ANY(pr.prattrs)),\n"
+							  "  pg_catalog.pg_get_expr(pr.prqual, pr.prrelid)\n"
 							  "FROM pg_catalog.pg_publication p\n"
 							  "JOIN pg_catalog.pg_publication_rel pr ON p.oid = pr.prpubid\n"
 							  "WHERE pr.prrelid = '%s'\n"
 							  "UNION ALL\n"
-							  "SELECT pubname\n"
+							  "SELECT pubname, NULL, NULL\n"
 							  "FROM pg_catalog.pg_publication p\n"
 							  "WHERE p.puballtables AND pg_catalog.pg_relation_is_publishable('%s')\n"
 							  "ORDER BY 1;",
 							  oid, oid);
+		}
+		else if (pset.sversion >= 100000)
+		{
+			printfPQExpBuffer(&buf,
+							  "SELECT pubname, NULL, NULL\n"
+							  "FROM pg_catalog.pg_publication p\n"
+							  "JOIN pg_catalog.pg_publication_rel pr ON p.oid = pr.prpubid\n"
+							  "WHERE pr.prrelid = '%s'\n"
+							  "UNION ALL\n"
+							  "SELECT pubname, NULL, NULL\n"
+							  "FROM pg_catalog.pg_publication p\n"
+							  "WHERE p.puballtables AND pg_catalog.pg_relation_is_publishable('%s')\n"
+							  "ORDER BY 1;",
+							  oid, oid);
+		}
+
+		if (pset.sversion >= 100000)
+		{
 
 			result = PSQLexec(buf.data);
 			if (!result)
@@ -2558,6 +2580,12 @@ describeOneTableDetails(const char *schemaname,
 			{
 				printfPQExpBuffer(&buf, "    \"%s\"",
 								  PQgetvalue(result, i, 0));
+				if (!PQgetisnull(result, i, 1))
+					appendPQExpBuffer(&buf, " (%s)",
+									  PQgetvalue(result, i, 1));
+				if (!PQgetisnull(result, i, 2))
+					appendPQExpBuffer(&buf, " WHERE %s",
+									  PQgetvalue(result, i, 2));
 
 				printTableAddFooter(&cont, buf.data);
 			}
@@ -5232,15 +5260,30 @@ describePublications(const char *pattern)
 
 		if (!puballtables)
 		{
-			printfPQExpBuffer(&buf,
-							  "SELECT n.nspname, c.relname\n"
-							  "FROM pg_catalog.pg_class c,\n"
-							  "     pg_catalog.pg_namespace n,\n"
-							  "     pg_catalog.pg_publication_rel pr\n"
-							  "WHERE c.relnamespace = n.oid\n"
-							  "  AND c.oid = pr.prrelid\n"
-							  "  AND pr.prpubid = '%s'\n"
-							  "ORDER BY 1,2", pubid);
+			if (pset.sversion >= 110000)
+				printfPQExpBuffer(&buf,
+								  "SELECT n.nspname, c.relname,\n"
+								  "  (SELECT pg_catalog.string_agg(pg_catalog.quote_ident(a.attname), ', ' ORDER BY a.attnum)\n"
+								  "   FROM pg_catalog.pg_attribute a\n"
+								  "   WHERE a.attrelid = c.oid AND a.attnum = ANY(pr.prattrs)),\n"
+								  "  pg_catalog.pg_get_expr(pr.prqual, c.oid)\n"
+								  "FROM pg_catalog.pg_class c,\n"
+								  "     pg_catalog.pg_namespace n,\n"
+								  "     pg_catalog.pg_publication_rel pr\n"
+								  "WHERE c.relnamespace = n.oid\n"
+								  "  AND c.oid = pr.prrelid\n"
+								  "  AND pr.prpubid = '%s'\n"
+								  "ORDER BY 1,2", pubid);
+			else
+				printfPQExpBuffer(&buf,
+								  "SELECT n.nspname, c.relname, NULL, NULL\n"
+								  "FROM pg_catalog.pg_class c,\n"
+								  "     pg_catalog.pg_namespace n,\n"
+								  "     pg_catalog.pg_publication_rel pr\n"
+								  "WHERE c.relnamespace = n.oid\n"
+								  "  AND c.oid = pr.prrelid\n"
+								  "  AND pr.prpubid = '%s'\n"
+								  "ORDER BY 1,2", pubid);
 
 			tabres = PSQLexec(buf.data);
 			if (!tabres)
@@ -5262,6 +5305,12 @@ describePublications(const char *pattern)
 				printfPQExpBuffer(&buf, "    \"%s.%s\"",
 								  PQgetvalue(tabres, j, 0),
 								  PQgetvalue(tabres, j, 1));
+				if (!PQgetisnull(tabres, j, 2))
+					appendPQExpBuffer(&buf, " (%s)",
+									  PQgetvalue(tabres, j, 2));
+				if (!PQgetisnull(tabres, j, 3))
+					appendPQExpBuffer(&buf, " WHERE %s",
+									  PQgetvalue(tabres, j, 3));
 
 				printTableAddFooter(&cont, buf.data);
 			}
@@ -5293,7 +5342,7 @@ describeSubscriptions(const char *pattern, bool verbose)
 	PGresult   *res;
 	printQueryOpt myopt = pset.popt;
 	static const bool translate_columns[] = {false, false, false, false,
-	false, false};
+	false, false, false, false};
 
 	if (pset.sversion < 100000)
 	{
@@ -5319,6 +5368,14 @@ describeSubscriptions(const char *pattern, bool verbose)
 
 	if (verbose)
 	{
+		/* Streaming and binary mode are only supported in v11 and higher */
+		if (pset.sversion >= 110000)
+			appendPQExpBuffer(&buf,
+							  ",  substream AS \"%s\"\n"
+							  ",  subbinary AS \"%s\"\n",
+							  gettext_noop("Streaming"),
+							  gettext_noop("Binary"));
+
 		appendPQExpBuffer(&buf,
 						  ",  subsynccommit AS \"%s\"\n"
 						  ",  subconninfo AS \"%s\"\n",
@@ -0,0 +1,384 @@
+/*-------------------------------------------------------------------------
+ *
+ * wire_compress.c
+ *	  Compression of the CopyData messages of the replication protocol.
+ *
+ * Each CopyData message of a compressed WAL stream or base backup stream
+ * is compressed on its own, and decompresses to exactly the payload the
+ * sender would have sent without compression, so the message boundaries
+ * that the receivers rely on are preserved.  With zlib, the stream is one
+ * deflate stream that is flushed at the end of every message, so later
+ * messages benefit from the dictionary built up by earlier ones.  The pglz
+ * fallback has no such state; every message is prefixed with its raw
+ * length, whose high bit is set if the message had to be stored
+ * uncompressed.
+ *
+ * Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/common/wire_compress.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FRONTEND
+#include "postgres.h"
+#else
+#include "postgres_fe.h"
+#endif
+
+/* for htonl */
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include "common/pg_lzcompress.h"
+#include "common/wire_compress.h"
+
+/* Header of a pglz-compressed message */
+#define PGLZ_HDRSZ			4
+#define PGLZ_STORED_FLAG	0x80000000
+
+struct WireCompressor
+{
+	WireCompressMethod method;
+	bool		decompress;		/* is this a decompressor? */
+	char	   *buf;			/* output buffer, reused for every message */
+	int			bufsize;
+#ifdef HAVE_LIBZ
+	z_stream	zs;
+#endif
+};
+
+static void enlarge_buffer(WireCompressor *state, int needed);
+
+
+/*
+ * Look up a compression method by name.  Returns false if the name is not
+ * known; note that the method may still be unsupported by this build.
+ */
+bool
+wire_compress_parse_method(const char *name, WireCompressMethod *method)
+{
+	if (strcmp(name, "none") == 0)
+		*method = WIRE_COMPRESS_NONE;
+	else if (strcmp(name, "zlib") == 0)
+		*method = WIRE_COMPRESS_ZLIB;
+	else if (strcmp(name, "pglz") == 0)
+		*method = WIRE_COMPRESS_PGLZ;
+	else
+		return false;
+
+	return true;
+}
+
+/*
+ * Return the name of a compression method, as accepted by
+ * wire_compress_parse_method().
+ */
+const char *
+wire_compress_method_name(WireCompressMethod method)
+{
+	switch (method)
+	{
+		case WIRE_COMPRESS_NONE:
+			return "none";
+		case WIRE_COMPRESS_ZLIB:
+			return "zlib";
+		case WIRE_COMPRESS_PGLZ:
+			return "pglz";
+	}
+
+	return "???";
+}
+
+/*
+ * Is the compression method available in this build?
+ */
+bool
+wire_compress_supported(WireCompressMethod method)
+{
+#ifndef HAVE_LIBZ
+	if (method == WIRE_COMPRESS_ZLIB)
+		return false;
+#endif
+
+	return true;
+}
+
+#ifdef HAVE_LIBZ
+static voidpf
+wire_zalloc(voidpf opaque, uInt items, uInt size)
+{
+	return palloc((Size) items * size);
+}
+
+static void
+wire_zfree(voidpf opaque, voidpf address)
+{
+	pfree(address);
+}
+#endif
+
+/*
+ * Create the state for compressing, or if 'decompress' is true for
+ * decompressing, one stream of messages.  'level' is between 0 and
+ * WIRE_COMPRESS_MAX_LEVEL, or WIRE_COMPRESS_DEFAULT_LEVEL; it is ignored by
+ * pglz and when decompressing.
+ *
+ * Returns NULL if the method is not supported, or if the compression
+ * library could not be initialized.
+ */
+WireCompressor *
+wire_compressor_create(WireCompressMethod method, int level, bool decompress)
+{
+	WireCompressor *state;
+
+	if (method == WIRE_COMPRESS_NONE || !wire_compress_supported(method))
+		return NULL;
+
+	state = palloc0(sizeof(WireCompressor));
+	state->method = method;
+	state->decompress = decompress;
+
+#ifdef HAVE_LIBZ
+	if (method == WIRE_COMPRESS_ZLIB)
+	{
+		int			rc;
+
+		state->zs.zalloc = wire_zalloc;
+		state->zs.zfree = wire_zfree;
+		state->zs.opaque = Z_NULL;
+
+		if (decompress)
+			rc = inflateInit(&state->zs);
+		else
+		{
+			/*
+			 * The point of compressing the stream is throughput, so default
+			 * to the fastest level rather than zlib's own default.
+			 */
+			if (level == WIRE_COMPRESS_DEFAULT_LEVEL)
+				level = Z_BEST_SPEED;
+			rc = deflateInit(&state->zs, level);
+		}
+
+		if (rc != Z_OK)
+		{
+			pfree(state);
+			return NULL;
+		}
+	}
+#endif
+
+	return state;
+}
+
+/*
+ * Compress one message.  On success, *dst is set to point to the
+ * compressed data, which stays valid until the next call, and *dstlen to
+ * its length.  Returns false on failure.
+ */
+bool
+wire_compress(WireCompressor *state, const char *src, int srclen,
+			  char **dst, int *dstlen)
+{
+	Assert(!state->decompress);
+
+	switch (state->method)
+	{
+		case WIRE_COMPRESS_ZLIB:
+#ifdef HAVE_LIBZ
+			{
+				z_stream   *zs = &state->zs;
+				int			outlen = 0;
+
+				enlarge_buffer(state, deflateBound(zs, srclen) + 64);
+				zs->next_in = (Bytef *) src;
+				zs->avail_in = srclen;
+
+				/* Deflate until the flush has been written out completely */
+				do
+				{
+					if (state->bufsize - outlen < 64)
+						enlarge_buffer(state, state->bufsize * 2);
+					zs->next_out = (Bytef *) state->buf + outlen;
+					zs->avail_out = state->bufsize - outlen;
+
+					if (deflate(zs, Z_SYNC_FLUSH) == Z_STREAM_ERROR)
+						return false;
+					outlen = state->bufsize - zs->avail_out;
+				} while (zs->avail_out == 0);
+
+				Assert(zs->avail_in == 0);
+				*dst = state->buf;
+				*dstlen = outlen;
+				return true;
+			}
+#else
+			return false;
+#endif
+
+		case WIRE_COMPRESS_PGLZ:
+			{
+				int32		len;
+				uint32		hdr;
+
+				enlarge_buffer(state, PGLZ_HDRSZ + PGLZ_MAX_OUTPUT(srclen));
+				len = pglz_compress(src, srclen, state->buf + PGLZ_HDRSZ,
+									PGLZ_strategy_default);
+				if (len < 0)
+				{
+					/* Not compressible, store it as it is */
+					memcpy(state->buf + PGLZ_HDRSZ, src, srclen);
+					len = srclen;
+					hdr = htonl((uint32) srclen | PGLZ_STORED_FLAG);
+				}
+				else
+					hdr = htonl((uint32) srclen);
+				memcpy(state->buf, &hdr, PGLZ_HDRSZ);
+
+				*dst = state->buf;
+				*dstlen = PGLZ_HDRSZ + len;
+				return true;
+			}
+
+		case WIRE_COMPRESS_NONE:
+			break;
+	}
+
+	return false;
+}
+
+/*
+ * Decompress one message.  On success, *dst is set to point to the
+ * decompressed data, which stays valid until the next call, and *dstlen to
+ * its length.  Returns false if the data is corrupt.
+ */
+bool
+wire_decompress(WireCompressor *state, const char *src, int srclen,
+				char **dst, int *dstlen)
+{
+	Assert(state->decompress);
+
+	switch (state->method)
+	{
+		case WIRE_COMPRESS_ZLIB:
+#ifdef HAVE_LIBZ
+			{
+				z_stream   *zs = &state->zs;
+				int			outlen = 0;
+
+				enlarge_buffer(state, Max(srclen * 4, 8192));
+				zs->next_in = (Bytef *) src;
+				zs->avail_in = srclen;
+
+				for (;;)
+				{
+					int			rc;
+
+					if (state->bufsize - outlen < 1024)
+						enlarge_buffer(state, state->bufsize * 2);
+					zs->next_out = (Bytef *) state->buf + outlen;
+					zs->avail_out = state->bufsize - outlen;
+
+					rc = inflate(zs, Z_SYNC_FLUSH);
+					if (rc != Z_OK && rc != Z_BUF_ERROR)
+						return false;
+					outlen = state->bufsize - zs->avail_out;
+
+					/*
+					 * If there's output space left, inflate stopped because
+					 * it ran out of input, and the message is complete.
+					 */
+					if (zs->avail_out > 0)
+					{
+						if (zs->avail_in > 0)
+							return false;
+						break;
+					}
+				}
+
+				*dst = state->buf;
+				*dstlen = outlen;
+				return true;
+			}
+#else
+			return false;
+#endif
+
+		case WIRE_COMPRESS_PGLZ:
+			{
+				uint32		hdr;
+				int32		rawlen;
+
+				if (srclen < PGLZ_HDRSZ)
+					return false;
+				memcpy(&hdr, src, PGLZ_HDRSZ);
+				hdr = ntohl(hdr);
+				rawlen = (int32) (hdr & ~PGLZ_STORED_FLAG);
+
+				enlarge_buffer(state, rawlen);
+				if (hdr & PGLZ_STORED_FLAG)
+				{
+					if (srclen - PGLZ_HDRSZ != rawlen)
+						return false;
+					memcpy(state->buf, src + PGLZ_HDRSZ, rawlen);
+				}
+				else if (pglz_decompress(src + PGLZ_HDRSZ, srclen - PGLZ_HDRSZ,
+										 state->buf, rawlen) != rawlen)
+					return false;
+
+				*dst = state->buf;
+				*dstlen = rawlen;
+				return true;
+			}
+
+		case WIRE_COMPRESS_NONE:
+			break;
+	}
+
+	return false;
+}
+
+/*
+ * Release a compressor or decompressor.
+ */
+void
+wire_compressor_free(WireCompressor *state)
+{
+#ifdef HAVE_LIBZ
+	if (state->method == WIRE_COMPRESS_ZLIB)
+	{
+		if (state->decompress)
+			inflateEnd(&state->zs);
+		else
+			deflateEnd(&state->zs);
+	}
+#endif
+
+	if (state->buf)
+		pfree(state->buf);
+	pfree(state);
+}
+
+/*
+ * Make sure the output buffer can hold at least 'needed' bytes, keeping
+ * its contents.
+ */
+static void
+enlarge_buffer(WireCompressor *state, int needed)
+{
+	if (state->bufsize >= needed)
+		return;
+
+	if (state->buf == NULL)
+		state->buf = palloc(needed);
+	else
+		state->buf = repalloc(state->buf, needed);
+	state->bufsize = needed;
+}
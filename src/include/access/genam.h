@@ -150,6 +150,8 @@ extern void index_rescan(IndexScanDesc scan,
 extern void index_endscan(IndexScanDesc scan);
 extern void index_markpos(IndexScanDesc scan);
 extern void index_restrpos(IndexScanDesc scan);
+extern bool index_skip(IndexScanDesc scan, ScanDirection direction,
+		   int prefix);
 extern Size index_parallelscan_estimate(Relation indexrel, Snapshot snapshot);
 extern void index_parallelscan_initialize(Relation heaprel, Relation indexrel,
 							  Snapshot snapshot, ParallelIndexScanDesc target);
@@ -132,6 +132,74 @@ typedef struct BTMetaPageData
 #define BTREE_DEFAULT_FILLFACTOR	90
 #define BTREE_NONLEAF_FILLFACTOR	70
 
+/*
+ * Posting list tuples.
+ *
+ * On leaf pages of indexes that allow deduplication, a run of tuples with
+ * bitwise-identical keys can be merged into a single "posting list" tuple
+ * that stores the key once, followed by an array of heap TIDs.  Such
+ * a tuple has INDEX_ALT_TID_MASK set in t_info, meaning t_tid does not hold
+ * a heap TID.  Instead, the block number part of t_tid holds the offset of
+ * the posting list from the start of the tuple, and the offset number part
+ * holds the number of heap TIDs plus the BT_IS_POSTING flag bit.  The
+ * posting list begins on a MAXALIGN boundary, right after the key data.
+ *
+ * Posting list tuples never appear as high keys or on internal pages; the
+ * key-only version of the first item on a right sibling is used for the
+ * high key and downlink instead.  See the "Deduplication" section of the
+ * README.
+ */
+#define INDEX_ALT_TID_MASK			INDEX_AM_RESERVED_BIT
+
+#define BT_OFFSET_MASK				0x0FFF
+#define BT_IS_POSTING				0x2000
+
+#define BTreeTupleIsPosting(itup) \
+	(((itup)->t_info & INDEX_ALT_TID_MASK) != 0 && \
+	 (ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & BT_IS_POSTING) != 0)
+#define BTreeTupleGetNPosting(itup) \
+	(ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & BT_OFFSET_MASK)
+#define BTreeTupleGetPostingOffset(itup) \
+	ItemPointerGetBlockNumberNoCheck(&(itup)->t_tid)
+#define BTreeTupleGetPosting(itup) \
+	((ItemPointer) ((char *) (itup) + BTreeTupleGetPostingOffset(itup)))
+#define BTreeTupleGetPostingN(itup, n) \
+	(BTreeTupleGetPosting(itup) + (n))
+#define BTreeTupleSetPosting(itup, nhtids, off) \
+	do { \
+		(itup)->t_info |= INDEX_ALT_TID_MASK; \
+		ItemPointerSetOffsetNumber(&(itup)->t_tid, (nhtids) | BT_IS_POSTING); \
+		ItemPointerSetBlockNumber(&(itup)->t_tid, (off)); \
+	} while(0)
+
+/* Size of the key part of a tuple, i.e. excluding any posting list */
+#define BTreeTupleGetKeySize(itup) \
+	(BTreeTupleIsPosting(itup) ? \
+	 (Size) BTreeTupleGetPostingOffset(itup) : IndexTupleSize(itup))
+
+/* First (lowest) heap TID of a leaf tuple, posting list or not */
+#define BTreeTupleGetHeapTID(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPosting(itup) : &(itup)->t_tid)
+
+/*
+ * Deduplication never builds a posting list tuple larger than half of
+ * BTMaxItemSize, so that a page made up of them can still be split
+ * sensibly.
+ */
+#define BTMaxPostingSize \
+	MAXALIGN_DOWN((BLCKSZ - \
+				   MAXALIGN(SizeOfPageHeaderData + 3*sizeof(ItemIdData)) - \
+				   MAXALIGN(sizeof(BTPageOpaqueData))) / 6)
+
+/*
+ * The maximum number of heap TIDs that a single leaf page can reference,
+ * counting each entry of a posting list separately.  This is what sizes
+ * the per-page item arrays used by index scans.
+ */
+#define MaxTIDsPerBTreePage \
+	(int) ((BLCKSZ - SizeOfPageHeaderData - sizeof(BTPageOpaqueData)) / \
+		   sizeof(ItemPointerData))
+
 /*
  *	Test whether two btree entries are "the same".
  *
@@ -320,12 +388,14 @@ typedef struct BTScanPosData
 	 * array back-to-front, so we start at the last slot and fill downwards.
 	 * Hence we need both a first-valid-entry and a last-valid-entry counter.
 	 * itemIndex is a cursor showing which entry was last returned to caller.
+	 * A posting list tuple contributes one entry per heap TID, all with the
+	 * same indexOffset and (in an index-only scan) the same tupleOffset.
 	 */
 	int			firstItem;		/* first valid index in items[] */
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
 
-	BTScanPosItem items[MaxIndexTuplesPerPage]; /* MUST BE LAST */
+	BTScanPosItem items[MaxTIDsPerBTreePage];	/* MUST BE LAST */
 } BTScanPosData;
 
 typedef BTScanPosData *BTScanPos;
@@ -409,6 +479,26 @@ typedef struct BTScanOpaqueData
 	 */
 	int			markItemIndex;	/* itemIndex, or -1 if not valid */
 
+	/*
+	 * Skip scan support.  If a forward scan has no "=" key on the first index
+	 * column but does have keys on the second one, _bt_readpage() compares
+	 * the last tuple on each page against those keys.  When the tuples we
+	 * need next are known to be beyond the right sibling, it sets skipTarget
+	 * and saves a copy of that last tuple in skipTuple; we then descend the
+	 * tree to the target instead of reading every leaf page in between.
+	 * skipKeys[] are insertion scankeys: [0] is for the first index column
+	 * (its argument is filled in from skipTuple), [1] is the lower bound and
+	 * [2] the upper bound on the second column, if any.
+	 */
+	bool		skipScan;		/* are the fields below valid? */
+	bool		skipHaveLower;	/* skipKeys[1] is valid */
+	bool		skipLowerStrict;	/* skipKeys[1] is a ">" bound */
+	bool		skipHaveUpper;	/* skipKeys[2] is valid */
+	bool		skipUpperStrict;	/* skipKeys[2] is a "<" bound */
+	int			skipTarget;		/* BTSKIP_xxx code, see below */
+	IndexTuple	skipTuple;		/* BLCKSZ workspace for the saved tuple */
+	ScanKeyData skipKeys[3];
+
 	/* keep these last in struct for efficiency */
 	BTScanPosData currPos;		/* current position data */
 	BTScanPosData markPos;		/* marked position, if any */
@@ -416,11 +506,47 @@ typedef struct BTScanOpaqueData
 
 typedef BTScanOpaqueData *BTScanOpaque;
 
+/* Values for BTScanOpaqueData.skipTarget */
+#define BTSKIP_NONE			0	/* just step right to the next page */
+#define BTSKIP_LOWER		1	/* descend to the second column's lower bound */
+#define BTSKIP_NEXTPREFIX	2	/* descend past the first column's value */
+
 /*
  * We use some private sk_flags bits in preprocessed scan keys.  We're allowed
  * to use bits 16-31 (see skey.h).  The uppermost bits are copied from the
  * index's indoption[] array entry for the index attribute.
  */
+/*
+ * Storage type for btree's reloptions.  fillfactor must stay at the same
+ * offset as in StdRdOptions.
+ */
+typedef struct BTOptions
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int			fillfactor;		/* page fill factor in percent (0..100) */
+	bool		deduplicate_items;	/* try to merge duplicates on leaf pages? */
+} BTOptions;
+
+#define BTREE_DEFAULT_DEDUPLICATE_ITEMS	true
+#define BTGetFillFactor(relation) \
+	((relation)->rd_options ? \
+	 ((BTOptions *) (relation)->rd_options)->fillfactor : \
+	 BTREE_DEFAULT_FILLFACTOR)
+#define BTGetTargetPageFreeSpace(relation) \
+	(BLCKSZ * (100 - BTGetFillFactor(relation)) / 100)
+#define BTGetDeduplicateItems(relation) \
+	((relation)->rd_options ? \
+	 ((BTOptions *) (relation)->rd_options)->deduplicate_items : \
+	 BTREE_DEFAULT_DEDUPLICATE_ITEMS)
+
+/*
+ * Deduplication is used on leaf pages of non-unique indexes whose
+ * deduplicate_items option is on.  Unique indexes are left alone, so that
+ * _bt_check_unique() only ever sees plain tuples.
+ */
+#define BTDeduplicationAllowed(relation) \
+	(BTGetDeduplicateItems(relation) && !(relation)->rd_index->indisunique)
+
 #define SK_BT_REQFWD	0x00010000	/* required to continue forward scan */
 #define SK_BT_REQBKWD	0x00020000	/* required to continue backward scan */
 #define SK_BT_INDOPTION_SHIFT  24	/* must clear the above bits */
@@ -448,6 +574,7 @@ extern void btparallelrescan(IndexScanDesc scan);
 extern void btendscan(IndexScanDesc scan);
 extern void btmarkpos(IndexScanDesc scan);
 extern void btrestrpos(IndexScanDesc scan);
+extern bool btskip(IndexScanDesc scan, ScanDirection dir, int prefix);
 extern IndexBulkDeleteResult *btbulkdelete(IndexVacuumInfo *info,
 			 IndexBulkDeleteResult *stats,
 			 IndexBulkDeleteCallback callback,
@@ -464,6 +591,16 @@ extern void _bt_parallel_release(IndexScanDesc scan, BlockNumber scan_page);
 extern void _bt_parallel_done(IndexScanDesc scan);
 extern void _bt_parallel_advance_array_keys(IndexScanDesc scan);
 
+/*
+ * prototypes for functions in nbtdedup.c
+ */
+extern bool _bt_dedup_one_page(Relation rel, Buffer buf);
+extern Page _bt_dedup_page(Page page);
+extern bool _bt_dedup_equal(IndexTuple itup1, IndexTuple itup2);
+extern bool _bt_dedup_fits(IndexTuple base, int nhtids);
+extern IndexTuple _bt_form_posting(IndexTuple base, ItemPointer htids,
+				 int nhtids);
+
 /*
  * prototypes for functions in nbtinsert.c
  */
@@ -490,7 +627,8 @@ extern void _bt_delitems_delete(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems, Relation heapRel);
 extern void _bt_delitems_vacuum(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems,
-					BlockNumber lastBlockVacuumed);
+					OffsetNumber *updatable, IndexTuple *updated,
+					int nupdatable, BlockNumber lastBlockVacuumed);
 extern int	_bt_pagedel(Relation rel, Buffer buf);
 
 /*
@@ -508,6 +646,7 @@ extern int32 _bt_compare(Relation rel, int keysz, ScanKey scankey,
 			Page page, OffsetNumber offnum);
 extern bool _bt_first(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_next(IndexScanDesc scan, ScanDirection dir);
+extern bool _bt_skip(IndexScanDesc scan, ScanDirection dir, int prefix);
 extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
 				 Snapshot snapshot);
 
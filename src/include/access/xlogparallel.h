@@ -0,0 +1,32 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogparallel.h
+ *		Parallel replay of WAL records in redo worker processes.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/xlogparallel.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef XLOGPARALLEL_H
+#define XLOGPARALLEL_H
+
+#include "access/xlogreader.h"
+
+/* GUC variable */
+extern int	max_parallel_redo_workers;
+
+/* True in the startup process and redo workers while workers are in use */
+extern bool ParallelRedoActive;
+
+extern void ParallelRedoStart(bool absorb_fsyncs);
+extern bool ParallelRedoDispatch(XLogReaderState *record);
+extern bool ParallelRedoBusy(void);
+extern void ParallelRedoEnd(void);
+extern void ParallelRedoInvalidateSmgr(void);
+
+extern void ParallelRedoWorkerMain(Datum main_arg);
+
+#endif							/* XLOGPARALLEL_H */
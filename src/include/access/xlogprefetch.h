@@ -0,0 +1,28 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.h
+ *		Prefetching of data blocks referenced by WAL during recovery.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/xlogprefetch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef XLOGPREFETCH_H
+#define XLOGPREFETCH_H
+
+#include "access/xlogdefs.h"
+
+/* GUC variables */
+extern bool recovery_prefetch;
+extern int	recovery_prefetch_distance;
+
+extern Size XLogPrefetchShmemSize(void);
+extern void XLogPrefetchShmemInit(void);
+
+extern void XLogPrefetchReadAhead(XLogRecPtr replaying_lsn, TimeLineID tli);
+extern void XLogPrefetchEnd(void);
+
+#endif							/* XLOGPREFETCH_H */
@@ -17,6 +17,9 @@
 
 extern bool XLogHaveInvalidPages(void);
 extern void XLogCheckInvalidPages(void);
+extern Size EstimateInvalidPagesSpace(void);
+extern void SerializeInvalidPages(Size maxsize, char *start_address);
+extern void RestoreInvalidPages(char *start_address);
 
 extern void XLogDropRelation(RelFileNode rnode, ForkNumber forknum);
 extern void XLogDropDatabase(Oid dbid);
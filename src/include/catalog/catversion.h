@@ -53,6 +53,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	201709191
+#define CATALOG_VERSION_NO	201710195
 
 #endif
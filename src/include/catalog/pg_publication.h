@@ -86,6 +86,14 @@ typedef struct Publication
 	PublicationActions pubactions;
 } Publication;
 
+/* A table to add to a publication, as given by the user */
+typedef struct PublicationRelInfo
+{
+	Relation	relation;
+	List	   *columns;		/* column names (Value strings), or NIL */
+	Node	   *whereClause;	/* untransformed row filter, or NULL */
+} PublicationRelInfo;
+
 extern Publication *GetPublication(Oid pubid);
 extern Publication *GetPublicationByName(const char *pubname, bool missing_ok);
 extern List *GetRelationPublications(Oid relid);
@@ -93,7 +101,8 @@ extern List *GetPublicationRelations(Oid pubid);
 extern List *GetAllTablesPublications(void);
 extern List *GetAllTablesPublicationRelations(void);
 
-extern ObjectAddress publication_add_relation(Oid pubid, Relation targetrel,
+extern ObjectAddress publication_add_relation(Oid pubid,
+						 PublicationRelInfo *targetrel,
 						 bool if_not_exists);
 
 extern Oid	get_publication_oid(const char *pubname, bool missing_ok);
@@ -40,6 +40,11 @@ CATALOG(pg_subscription,6100) BKI_SHARED_RELATION BKI_ROWTYPE_OID(6101) BKI_SCHE
 	bool		subenabled;		/* True if the subscription is enabled (the
 								 * worker should be running) */
 
+	bool		substream;		/* Stream in-progress transactions. */
+
+	bool		subbinary;		/* True if the subscription wants the
+								 * publisher to send data in binary */
+
 #ifdef CATALOG_VARLEN			/* variable-length fields start here */
 	/* Connection string to the publisher */
 	text		subconninfo BKI_FORCE_NOT_NULL;
@@ -61,15 +66,17 @@ typedef FormData_pg_subscription *Form_pg_subscription;
  *		compiler constants for pg_subscription
  * ----------------
  */
-#define Natts_pg_subscription					8
+#define Natts_pg_subscription					10
 #define Anum_pg_subscription_subdbid			1
 #define Anum_pg_subscription_subname			2
 #define Anum_pg_subscription_subowner			3
 #define Anum_pg_subscription_subenabled			4
-#define Anum_pg_subscription_subconninfo		5
-#define Anum_pg_subscription_subslotname		6
-#define Anum_pg_subscription_subsynccommit		7
-#define Anum_pg_subscription_subpublications	8
+#define Anum_pg_subscription_substream			5
+#define Anum_pg_subscription_subbinary			6
+#define Anum_pg_subscription_subconninfo		7
+#define Anum_pg_subscription_subslotname		8
+#define Anum_pg_subscription_subsynccommit		9
+#define Anum_pg_subscription_subpublications	10
 
 
 typedef struct Subscription
@@ -80,6 +87,9 @@ typedef struct Subscription
 	char	   *name;			/* Name of the subscription */
 	Oid			owner;			/* Oid of the subscription owner */
 	bool		enabled;		/* Indicates if the subscription is enabled */
+	bool		stream;			/* Allow streaming in-progress transactions. */
+	bool		binary;			/* Indicates if the subscription wants data in
+								 * binary format */
 	char	   *conninfo;		/* Connection string to the publisher */
 	char	   *slotname;		/* Name of the replication slot */
 	char	   *synccommit;		/* Synchronous commit setting for worker */
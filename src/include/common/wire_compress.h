@@ -0,0 +1,38 @@
+/*
+ * wire_compress.h
+ *	  Compression of the CopyData messages of the replication protocol.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * src/include/common/wire_compress.h
+ */
+#ifndef WIRE_COMPRESS_H
+#define WIRE_COMPRESS_H
+
+typedef enum WireCompressMethod
+{
+	WIRE_COMPRESS_NONE,
+	WIRE_COMPRESS_ZLIB,
+	WIRE_COMPRESS_PGLZ
+} WireCompressMethod;
+
+/* Compression levels; -1 selects the method's default */
+#define WIRE_COMPRESS_DEFAULT_LEVEL		(-1)
+#define WIRE_COMPRESS_MAX_LEVEL			9
+
+typedef struct WireCompressor WireCompressor;
+
+extern bool wire_compress_parse_method(const char *name,
+						   WireCompressMethod *method);
+extern const char *wire_compress_method_name(WireCompressMethod method);
+extern bool wire_compress_supported(WireCompressMethod method);
+
+extern WireCompressor *wire_compressor_create(WireCompressMethod method,
+					   int level, bool decompress);
+extern bool wire_compress(WireCompressor *state, const char *src, int srclen,
+			  char **dst, int *dstlen);
+extern bool wire_decompress(WireCompressor *state, const char *src, int srclen,
+				char **dst, int *dstlen);
+extern void wire_compressor_free(WireCompressor *state);
+
+#endif							/* WIRE_COMPRESS_H */
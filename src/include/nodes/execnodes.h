@@ -104,9 +104,11 @@ typedef struct ExprState
  *		entries for a particular index.  Used for both index_build and
  *		retail creation of index entries.
  *
- *		NumIndexAttrs		number of columns in this index
- *		KeyAttrNumbers		underlying-rel attribute numbers used as keys
- *							(zeroes indicate expressions)
+ *		NumIndexAttrs		total number of columns in this index
+ *		NumIndexKeyAttrs	number of key columns in this index; any
+ *							columns after these are non-key INCLUDE columns
+ *		KeyAttrNumbers		underlying-rel attribute numbers of all index
+ *							columns (zeroes indicate expressions)
  *		Expressions			expr trees for expression entries, or NIL if none
  *		ExpressionsState	exec state for expressions, or NIL if none
  *		Predicate			partial-index predicate, or NIL if none
@@ -131,7 +133,8 @@ typedef struct ExprState
 typedef struct IndexInfo
 {
 	NodeTag		type;
-	int			ii_NumIndexAttrs;
+	int			ii_NumIndexAttrs;	/* total number of columns in index */
+	int			ii_NumIndexKeyAttrs;	/* number of key columns in index */
 	AttrNumber	ii_KeyAttrNumbers[INDEX_MAX_KEYS];
 	List	   *ii_Expressions; /* list of Expr */
 	List	   *ii_ExpressionsState;	/* list of ExprState */
@@ -1223,6 +1226,8 @@ typedef struct IndexScanState
  *		VMBuffer		   buffer in use for visibility map testing, if any
  *		HeapFetches		   number of tuples we were forced to fetch from heap
  *		ioss_PscanLen	   Size of parallel index-only scan descriptor
+ *		SkipPrefixSize	   # of leading index columns to skip on, or 0
+ *		TupleReturned	   true if we've returned a tuple since (re)start
  * ----------------
  */
 typedef struct IndexOnlyScanState
@@ -1242,6 +1247,8 @@ typedef struct IndexOnlyScanState
 	Buffer		ioss_VMBuffer;
 	long		ioss_HeapFetches;
 	Size		ioss_PscanLen;
+	int			ioss_SkipPrefixSize;
+	bool		ioss_TupleReturned;
 } IndexOnlyScanState;
 
 /* ----------------
@@ -1760,6 +1767,36 @@ typedef struct SortState
 	SharedSortInfo *shared_info;	/* one entry per worker */
 } SortState;
 
+/* ----------------
+ *	 IncrementalSortState information
+ *
+ *	Tuples are collected into batches that end on a change of the presorted
+ *	key columns; each batch is sorted on its own.  Once a batch has reached
+ *	the minimum size, group_pivot_slot holds the tuple that got it there,
+ *	and the first later tuple whose presorted columns differ from it ends
+ *	the batch.  That tuple is held in transfer_slot until the current batch
+ *	has been returned.
+ * ----------------
+ */
+typedef struct IncrementalSortState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	bool		bounded;		/* is the result set bounded? */
+	int64		bound;			/* if bounded, how many tuples are needed */
+	bool		sort_Done;		/* current batch sorted and being returned? */
+	bool		input_Done;		/* outer plan exhausted? */
+	int64		bound_Done;		/* tuples already returned */
+	int			nPresortedCols; /* number of presorted key columns */
+	FmgrInfo   *eqfunctions;	/* equality fns for the presorted columns */
+	TupleTableSlot *group_pivot_slot;	/* tuple the batch's presorted
+										 * columns are compared with */
+	TupleTableSlot *transfer_slot;	/* first tuple of the next batch */
+	void	   *tuplesortstate; /* private state of tuplesort.c */
+	int64		groupsCount;	/* number of batches sorted so far */
+	long		maxSpaceUsed;	/* peak space used by a single batch */
+	TuplesortSpaceType maxSpaceType;	/* type of peak space */
+} IncrementalSortState;
+
 /* ---------------------
  *	GroupState information
  * ---------------------
@@ -410,6 +410,11 @@ typedef struct IndexScan
  * with one TLE per index column.  Vars appearing in this list reference
  * the base table, and this is the only field in the plan node that may
  * contain such Vars.
+ *
+ * If indexskipprefix is more than zero, only the first tuple the scan
+ * returns for each distinct value of the first indexskipprefix index
+ * columns is wanted; the scan uses index_skip() to avoid fetching the rest.
+ * It's up to the plan above to discard any that get returned anyway.
  * ----------------
  */
 typedef struct IndexOnlyScan
@@ -420,6 +425,7 @@ typedef struct IndexOnlyScan
 	List	   *indexorderby;	/* list of index ORDER BY exprs */
 	List	   *indextlist;		/* TargetEntry list describing index's cols */
 	ScanDirection indexorderdir;	/* forward or backward or don't care */
+	int			indexskipprefix;	/* # of leading columns to skip on, or 0 */
 } IndexOnlyScan;
 
 /* ----------------
@@ -749,6 +755,19 @@ typedef struct Sort
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 } Sort;
 
+/* ----------------
+ *		incremental sort node
+ *
+ * The input is already sorted on the first nPresortedCols sort columns,
+ * so each group of tuples with equal values there is sorted separately.
+ * ----------------
+ */
+typedef struct IncrementalSort
+{
+	Sort		sort;
+	int			nPresortedCols; /* number of presorted columns */
+} IncrementalSort;
+
 /* ---------------
  *	 group node -
  *		Used for queries with GROUP BY (but no aggregates) specified.
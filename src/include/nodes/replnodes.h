@@ -23,6 +23,14 @@ typedef enum ReplicationKind
 	REPLICATION_KIND_LOGICAL
 } ReplicationKind;
 
+typedef enum BaseBackupKind
+{
+	BASE_BACKUP_KIND_SINGLE,	/* BASE_BACKUP, a whole backup in one command */
+	BASE_BACKUP_KIND_START,		/* START_BACKUP */
+	BASE_BACKUP_KIND_SEND_FILES,	/* SEND_FILES */
+	BASE_BACKUP_KIND_STOP		/* STOP_BACKUP */
+} BaseBackupKind;
+
 
 /* ----------------------
  *		IDENTIFY_SYSTEM command
@@ -35,12 +43,14 @@ typedef struct IdentifySystemCmd
 
 
 /* ----------------------
- *		BASE_BACKUP command
+ *		BASE_BACKUP, START_BACKUP, SEND_FILES and STOP_BACKUP commands
  * ----------------------
  */
 typedef struct BaseBackupCmd
 {
 	NodeTag		type;
+	BaseBackupKind kind;
+	List	   *files;			/* paths to send, for SEND_FILES */
 	List	   *options;
 } BaseBackupCmd;
 
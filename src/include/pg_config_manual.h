@@ -119,6 +119,13 @@
  */
 #define ALIGNOF_BUFFER	32
 
+/*
+ * Alignment required for buffers, file offsets and transfer sizes when
+ * reading or writing with O_DIRECT (see io_direct).  4kB satisfies every
+ * common file system and device; the logical sector size is often smaller.
+ */
+#define PG_IO_ALIGN_SIZE	4096
+
 /*
  * Disable UNIX sockets for certain operating systems.
  */
@@ -34,6 +34,7 @@ extern void CheckpointWriteDelay(int flags, double progress);
 extern bool ForwardFsyncRequest(RelFileNode rnode, ForkNumber forknum,
 					BlockNumber segno);
 extern void AbsorbFsyncRequests(void);
+extern void SetStartupAbsorbsFsyncRequests(bool absorb);
 
 extern Size CheckpointerShmemSize(void);
 extern void CheckpointerShmemInit(void);
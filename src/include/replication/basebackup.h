@@ -20,6 +20,21 @@
 #define MAX_RATE_LOWER	32
 #define MAX_RATE_UPPER	1048576
 
+/*
+ * In an incremental backup, a relation file of which only some blocks are
+ * sent is stored under its name with INCREMENTAL_PREFIX prepended.  It holds,
+ * in native byte order, INCREMENTAL_MAGIC, the length of the relation file
+ * in blocks, the number of blocks included, their block numbers within the
+ * file in ascending order, and finally the contents of those blocks.
+ */
+#define INCREMENTAL_PREFIX		"INCREMENTAL."
+#define INCREMENTAL_MAGIC		0xd3ae1f0d
+
+#define INCREMENTAL_HEADER_SIZE(nblocks) \
+	((3 + (nblocks)) * sizeof(uint32))
+#define INCREMENTAL_FILE_SIZE(nblocks) \
+	(INCREMENTAL_HEADER_SIZE(nblocks) + (pgoff_t) (nblocks) * BLCKSZ)
+
 
 typedef struct
 {
@@ -30,6 +45,7 @@ typedef struct
 } tablespaceinfo;
 
 extern void SendBaseBackup(BaseBackupCmd *cmd);
+extern const char *BaseBackupCommandName(BaseBackupKind kind);
 
 extern int64 sendTablespace(char *path, bool sizeonly);
 
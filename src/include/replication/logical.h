@@ -48,6 +48,13 @@ typedef struct LogicalDecodingContext
 	OutputPluginCallbacks callbacks;
 	OutputPluginOptions options;
 
+	/*
+	 * Does the output plugin support streaming of in-progress transactions,
+	 * and is it enabled?  Initialized from the presence of the stream
+	 * callbacks; the plugin's startup callback may turn it off.
+	 */
+	bool		streaming;
+
 	/*
 	 * User specified options
 	 */
@@ -23,6 +23,8 @@ typedef struct LogicalRepRelMapEntry
 	Relation	localrel;		/* relcache entry */
 	AttrNumber *attrmap;		/* map of local attributes to remote ones */
 	bool		updatable;		/* Can apply updates/deletes? */
+	bool		parallel_safe;	/* Can changes be applied in parallel, ordered
+								 * by replica identity only? */
 
 	/* Sync state. */
 	char		state;
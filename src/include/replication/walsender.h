@@ -14,6 +14,7 @@
 
 #include <signal.h>
 
+#include "common/wire_compress.h"
 #include "fmgr.h"
 
 /*
@@ -48,6 +49,10 @@ extern void WalSndInitStopping(void);
 extern void WalSndWaitStopping(void);
 extern void HandleWalSndInitStopping(void);
 extern void WalSndRqstFileReload(void);
+extern WireCompressMethod ParseCompressionMethod(const char *name);
+extern int	ParseCompressionLevel(long level);
+extern WireCompressor *CreateWireCompressor(WireCompressMethod method,
+					 int level);
 
 /*
  * Remember that we want to wakeup walsenders later
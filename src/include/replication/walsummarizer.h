@@ -0,0 +1,30 @@
+/*-------------------------------------------------------------------------
+ *
+ * walsummarizer.h
+ *	  Exports for the WAL summarizer background worker.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * src/include/replication/walsummarizer.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef WALSUMMARIZER_H
+#define WALSUMMARIZER_H
+
+#include "access/xlogdefs.h"
+
+/* GUCs */
+extern bool summarize_wal;
+extern int	wal_summary_keep_time;
+
+extern void WalSummarizerRegister(void);
+extern void WalSummarizerMain(Datum main_arg);
+
+extern Size WalSummarizerShmemSize(void);
+extern void WalSummarizerShmemInit(void);
+
+extern XLogRecPtr GetOldestUnsummarizedLSN(void);
+extern void WaitForWalSummarization(XLogRecPtr lsn);
+
+#endif							/* WALSUMMARIZER_H */
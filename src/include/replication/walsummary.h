@@ -0,0 +1,62 @@
+/*-------------------------------------------------------------------------
+ *
+ * walsummary.h
+ *	  Summaries of the blocks modified by ranges of WAL.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * src/include/replication/walsummary.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef WALSUMMARY_H
+#define WALSUMMARY_H
+
+#include "access/xlogdefs.h"
+#include "nodes/pg_list.h"
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+
+/* Directory holding the summary files, relative to the data directory */
+#define WALSUMMARY_DIR		XLOGDIR "/summaries"
+
+/* One summary file, as described by its name */
+typedef struct WalSummaryFile
+{
+	TimeLineID	tli;
+	XLogRecPtr	start_lsn;		/* first record summarized */
+	XLogRecPtr	end_lsn;		/* end of the last record summarized */
+} WalSummaryFile;
+
+/*
+ * A set of modified blocks of the main forks of relations.  Each relation
+ * also has a limit block: every block at or above it must be considered
+ * modified, because the relation was created, dropped or truncated.  An
+ * entry whose relNode is InvalidOid stands for every relation in a
+ * database, whose directory was created or dropped as a whole.
+ */
+typedef struct BlockRefTable BlockRefTable;
+
+extern BlockRefTable *CreateBlockRefTable(void);
+extern void BlockRefTableMarkBlockModified(BlockRefTable *brtab,
+							   const RelFileNode *rnode, BlockNumber blkno);
+extern void BlockRefTableSetLimitBlock(BlockRefTable *brtab,
+						   const RelFileNode *rnode, BlockNumber limit_block);
+extern void BlockRefTableMarkDatabaseModified(BlockRefTable *brtab,
+								  Oid spcNode, Oid dbNode);
+extern bool BlockRefTableIsEmpty(BlockRefTable *brtab);
+extern uint64 BlockRefTableGetBlockCount(BlockRefTable *brtab);
+extern bool BlockRefTableIsDatabaseModified(BlockRefTable *brtab,
+								Oid spcNode, Oid dbNode);
+extern BlockNumber BlockRefTableGetBlocks(BlockRefTable *brtab,
+					   const RelFileNode *rnode, BlockNumber **blocks,
+					   int *nblocks);
+extern void FreeBlockRefTable(BlockRefTable *brtab);
+
+extern void WriteWalSummary(BlockRefTable *brtab, TimeLineID tli,
+				XLogRecPtr start_lsn, XLogRecPtr end_lsn);
+extern void ReadWalSummary(WalSummaryFile *ws, BlockRefTable *brtab);
+extern List *GetWalSummaries(XLogRecPtr start_lsn, XLogRecPtr end_lsn);
+extern void RemoveOldWalSummaries(int keep_minutes);
+
+#endif							/* WALSUMMARY_H */
@@ -17,6 +17,9 @@
 #include "access/xlogdefs.h"
 #include "catalog/pg_subscription.h"
 #include "datatype/timestamp.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "storage/dsm.h"
 #include "storage/lock.h"
 
 typedef struct LogicalRepWorker
@@ -42,6 +45,13 @@ typedef struct LogicalRepWorker
 	/* Subscription id for the worker. */
 	Oid			subid;
 
+	/*
+	 * For a parallel apply worker, the PID of its leader apply worker; for a
+	 * parallel table synchronization worker, that of the table's
+	 * synchronization worker.
+	 */
+	pid_t		leader_pid;
+
 	/* Used for initial table synchronization. */
 	Oid			relid;
 	char		relstate;
@@ -59,6 +69,9 @@ typedef struct LogicalRepWorker
 /* Main memory context for apply worker. Permanent during worker lifetime. */
 extern MemoryContext ApplyContext;
 
+/* Memory context reset after each replication protocol message. */
+extern MemoryContext ApplyMessageContext;
+
 /* libpqreceiver connection */
 extern struct WalReceiverConn *wrconn;
 
@@ -72,8 +85,8 @@ extern void logicalrep_worker_attach(int slot);
 extern LogicalRepWorker *logicalrep_worker_find(Oid subid, Oid relid,
 					   bool only_running);
 extern List *logicalrep_workers_find(Oid subid, bool only_running);
-extern void logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname,
-						 Oid userid, Oid relid);
+extern bool logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname,
+						 Oid userid, Oid relid, dsm_handle subworker_dsm);
 extern void logicalrep_worker_stop(Oid subid, Oid relid);
 extern void logicalrep_worker_stop_at_commit(Oid subid, Oid relid);
 extern void logicalrep_worker_wakeup(Oid subid, Oid relid);
@@ -85,6 +98,33 @@ extern char *LogicalRepSyncTableStart(XLogRecPtr *origin_startpos);
 void		process_syncing_tables(XLogRecPtr current_lsn);
 void invalidate_syncing_table_states(Datum arg, int cacheid,
 								uint32 hashvalue);
+extern bool AllTablesyncsReady(void);
+
+extern void InitializeApplyWorker(void);
+extern void apply_dispatch(StringInfo s);
+
+/* Leader side of parallel apply */
+extern bool parallel_apply_begin(void);
+extern void parallel_apply_add_message(char action, StringInfo s);
+extern void parallel_apply_add_key(uint32 hash);
+extern void parallel_apply_set_serial(void);
+extern void parallel_apply_dispatch(void);
+extern void parallel_apply_send_schema(char action, Oid id, StringInfo s);
+extern void parallel_apply_wait_all(void);
+extern bool parallel_apply_in_progress(void);
+extern bool parallel_apply_get_progress(XLogRecPtr *remote_end,
+							XLogRecPtr *local_end);
+
+/* Parallel apply worker side */
+extern void parallel_apply_set_xid(TransactionId xid);
+extern void parallel_apply_wait_for_turn(void);
+extern void parallel_apply_committed(XLogRecPtr remote_end,
+						 XLogRecPtr local_end);
+
+#define isParallelApplyWorker(worker) \
+	((worker)->leader_pid != InvalidPid && !OidIsValid((worker)->relid))
+#define isParallelSyncWorker(worker) \
+	((worker)->leader_pid != InvalidPid && OidIsValid((worker)->relid))
 
 static inline bool
 am_tablesync_worker(void)
@@ -92,4 +132,22 @@ am_tablesync_worker(void)
 	return OidIsValid(MyLogicalRepWorker->relid);
 }
 
+static inline bool
+am_parallel_apply_worker(void)
+{
+	return isParallelApplyWorker(MyLogicalRepWorker);
+}
+
+static inline bool
+am_parallel_sync_worker(void)
+{
+	return isParallelSyncWorker(MyLogicalRepWorker);
+}
+
+static inline bool
+am_leader_apply_worker(void)
+{
+	return !am_tablesync_worker() && !am_parallel_apply_worker();
+}
+
 #endif							/* WORKER_INTERNAL_H */
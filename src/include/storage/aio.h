@@ -0,0 +1,44 @@
+/*-------------------------------------------------------------------------
+ *
+ * aio.h
+ *	  Asynchronous I/O definitions.
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/aio.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef AIO_H
+#define AIO_H
+
+/* Possible values for io_method */
+typedef enum IoMethod
+{
+	IO_METHOD_SYNC,				/* plain blocking system calls */
+	IO_METHOD_IO_URING			/* Linux io_uring */
+} IoMethod;
+
+/* Maximum number of asynchronous operations a process can have in flight */
+#define AIO_MAX_IN_FLIGHT		32
+
+/*
+ * Called when an asynchronous operation completes, with the number of bytes
+ * transferred, or minus the errno value on failure.
+ */
+typedef void (*AioCallback) (void *arg, int result);
+
+/* GUC parameter */
+extern int	io_method;
+
+extern bool AioEnabled(void);
+extern int	AioStartWrite(int fd, char *buffer, int amount, off_t offset,
+			  uint32 wait_event_info, AioCallback callback, void *arg);
+extern int	AioInFlight(void);
+extern void AioComplete(bool wait);
+extern void AioCompleteAll(void);
+extern void AioAbortAll(void);
+
+#endif							/* AIO_H */
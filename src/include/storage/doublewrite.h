@@ -0,0 +1,34 @@
+/*-------------------------------------------------------------------------
+ *
+ * doublewrite.h
+ *	  Double-write buffer, an alternative to full-page writes.
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/doublewrite.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef DOUBLEWRITE_H
+#define DOUBLEWRITE_H
+
+#include "storage/buf_internals.h"
+
+/* Directory holding the double-write files, relative to the data directory */
+#define DOUBLE_WRITE_DIR		"pg_dblwr"
+
+/* GUC parameter */
+extern bool double_write;
+
+extern Size DoubleWriteShmemSize(void);
+extern void DoubleWriteShmemInit(void);
+
+extern void DoubleWritePages(const BufferTag *tags, char **pages, int npages);
+
+extern uint64 DoubleWriteStartCheckpoint(void);
+extern void DoubleWriteEndCheckpoint(uint64 keep_gen);
+extern void DoubleWriteRecover(void);
+
+#endif							/* DOUBLEWRITE_H */
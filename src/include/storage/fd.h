@@ -41,6 +41,8 @@
 
 #include <dirent.h>
 
+#include "storage/aio.h"
+
 
 /*
  * FileSeek uses the standard UNIX lseek(2) flags.
@@ -48,9 +50,22 @@
 
 typedef int File;
 
+/* Possible values for recovery_init_sync_method */
+typedef enum RecoveryInitSyncMethod
+{
+	RECOVERY_INIT_SYNC_METHOD_FSYNC,	/* fsync every file */
+	RECOVERY_INIT_SYNC_METHOD_SYNCFS	/* syncfs() each filesystem */
+} RecoveryInitSyncMethod;
+
+
+/* Flags for io_direct_flags */
+#define IO_DIRECT_DATA			0x01	/* relation data files */
+#define IO_DIRECT_WAL			0x02	/* WAL segments */
 
-/* GUC parameter */
+/* GUC parameters */
 extern int	max_files_per_process;
+extern int	recovery_init_sync_method;
+extern int	io_direct_flags;
 
 /*
  * This is private to fd.c, but exported for save/restore_backend_variables()
@@ -73,6 +88,9 @@ extern int	FileWrite(File file, char *buffer, int amount, uint32 wait_event_info
 extern int	FileSync(File file, uint32 wait_event_info);
 extern off_t FileSeek(File file, off_t offset, int whence);
 extern int	FileTruncate(File file, off_t offset, uint32 wait_event_info);
+extern int	FileFallocate(File file, off_t offset, off_t amount, uint32 wait_event_info);
+extern int	FileStartWrite(File file, char *buffer, int amount, off_t offset,
+			   uint32 wait_event_info, AioCallback callback, void *arg);
 extern void FileWriteback(File file, off_t offset, off_t nbytes, uint32 wait_event_info);
 extern char *FilePathName(File file);
 extern int	FileGetRawDesc(File file);
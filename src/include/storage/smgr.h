@@ -15,6 +15,7 @@
 #define SMGR_H
 
 #include "fmgr.h"
+#include "storage/aio.h"
 #include "storage/block.h"
 #include "storage/relfilenode.h"
 
@@ -56,6 +57,13 @@ typedef struct SMgrRelationData
 	BlockNumber smgr_fsm_nblocks;	/* last known size of fsm fork */
 	BlockNumber smgr_vm_nblocks;	/* last known size of vm fork */
 
+	/*
+	 * Last known size of each fork, maintained by smgr.c itself.  This is
+	 * only trusted where nobody else can change the size behind our back;
+	 * see smgrnblocks_cached().  InvalidBlockNumber means "unknown".
+	 */
+	BlockNumber smgr_cached_nblocks[MAX_FORKNUM + 1];
+
 	/* additional public fields may someday exist here */
 
 	/*
@@ -94,15 +102,21 @@ extern void smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo);
 extern void smgrdounlinkfork(SMgrRelation reln, ForkNumber forknum, bool isRedo);
 extern void smgrextend(SMgrRelation reln, ForkNumber forknum,
 		   BlockNumber blocknum, char *buffer, bool skipFsync);
+extern void smgrzeroextend(SMgrRelation reln, ForkNumber forknum,
+			   BlockNumber blocknum, int nblocks, bool skipFsync);
 extern void smgrprefetch(SMgrRelation reln, ForkNumber forknum,
 			 BlockNumber blocknum);
 extern void smgrread(SMgrRelation reln, ForkNumber forknum,
 		 BlockNumber blocknum, char *buffer);
 extern void smgrwrite(SMgrRelation reln, ForkNumber forknum,
 		  BlockNumber blocknum, char *buffer, bool skipFsync);
+extern void smgrstartwrite(SMgrRelation reln, ForkNumber forknum,
+			   BlockNumber blocknum, char *buffer,
+			   AioCallback callback, void *arg);
 extern void smgrwriteback(SMgrRelation reln, ForkNumber forknum,
 			  BlockNumber blocknum, BlockNumber nblocks);
 extern BlockNumber smgrnblocks(SMgrRelation reln, ForkNumber forknum);
+extern BlockNumber smgrnblocks_cached(SMgrRelation reln, ForkNumber forknum);
 extern void smgrtruncate(SMgrRelation reln, ForkNumber forknum,
 			 BlockNumber nblocks);
 extern void smgrimmedsync(SMgrRelation reln, ForkNumber forknum);
@@ -122,12 +136,17 @@ extern bool mdexists(SMgrRelation reln, ForkNumber forknum);
 extern void mdunlink(RelFileNodeBackend rnode, ForkNumber forknum, bool isRedo);
 extern void mdextend(SMgrRelation reln, ForkNumber forknum,
 		 BlockNumber blocknum, char *buffer, bool skipFsync);
+extern void mdzeroextend(SMgrRelation reln, ForkNumber forknum,
+			 BlockNumber blocknum, int nblocks, bool skipFsync);
 extern void mdprefetch(SMgrRelation reln, ForkNumber forknum,
 		   BlockNumber blocknum);
 extern void mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	   char *buffer);
 extern void mdwrite(SMgrRelation reln, ForkNumber forknum,
 		BlockNumber blocknum, char *buffer, bool skipFsync);
+extern void mdstartwrite(SMgrRelation reln, ForkNumber forknum,
+			 BlockNumber blocknum, char *buffer,
+			 AioCallback callback, void *arg);
 extern void mdwriteback(SMgrRelation reln, ForkNumber forknum,
 			BlockNumber blocknum, BlockNumber nblocks);
 extern BlockNumber mdnblocks(SMgrRelation reln, ForkNumber forknum);
@@ -144,4 +163,18 @@ extern void RememberFsyncRequest(RelFileNode rnode, ForkNumber forknum,
 extern void ForgetRelationFsyncRequests(RelFileNode rnode, ForkNumber forknum);
 extern void ForgetDatabaseFsyncRequests(Oid dbid);
 
+/* in smgrsize.c */
+extern int	smgr_shared_relations;
+
+extern Size SMgrSizeShmemSize(void);
+extern void SMgrSizeShmemInit(void);
+extern BlockNumber smgrsize_get(RelFileNode rnode, ForkNumber forknum,
+			 uint64 *generation);
+extern void smgrsize_set(RelFileNode rnode, ForkNumber forknum,
+			 BlockNumber nblocks, uint64 generation);
+extern void smgrsize_update(RelFileNode rnode, ForkNumber forknum,
+				BlockNumber oldnblocks, BlockNumber nblocks);
+extern void smgrsize_drop(RelFileNode rnode);
+extern void smgrsize_drop_db(Oid dbid);
+
 #endif							/* SMGR_H */
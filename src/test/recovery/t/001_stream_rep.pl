@@ -29,10 +29,12 @@ $node_master->stop;
 $node_standby_1->backup('my_backup_2');
 $node_master->start;
 
-# Create second standby node linking to standby 1
+# Create second standby node linking to standby 1, streaming compressed WAL
 my $node_standby_2 = get_new_node('standby_2');
 $node_standby_2->init_from_backup($node_standby_1, $backup_name,
 	has_streaming => 1);
+$node_standby_2->append_conf('postgresql.conf',
+	"wal_receiver_compression = pglz");
 $node_standby_2->start;
 
 # Create some content on master and check its presence in standby 1
@@ -0,0 +1,66 @@
+#
+# Test that crash recovery repairs torn pages from the double-write buffer.
+#
+# With double_write on and full_page_writes off, WAL has no page images to
+# restore a page that was only partly written at the time of the crash.
+# We simulate such a torn write by zeroing the second half of a page that
+# was written since the last checkpoint, and check that recovery puts back
+# the copy from the double-write buffer.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 3;
+
+my $node = get_new_node('master');
+$node->init;
+
+# Use small shared_buffers, so that backends have to write out the pages
+# they dirty, and make sure that no checkpoint intervenes.
+$node->append_conf(
+	'postgresql.conf', qq{
+double_write = on
+full_page_writes = off
+shared_buffers = 1MB
+checkpoint_timeout = 1h
+max_wal_size = 1GB
+autovacuum = off
+});
+$node->start;
+
+$node->safe_psql(
+	'postgres', q{
+CREATE TABLE dw (a int, b text) WITH (fillfactor = 50);
+INSERT INTO dw SELECT i, repeat('x', 100) FROM generate_series(1, 20000) i;
+CHECKPOINT;
+UPDATE dw SET a = a + 1;
+UPDATE dw SET a = a + 1 WHERE a % 2 = 0;
+});
+
+my $expected =
+  $node->safe_psql('postgres', 'SELECT count(*), sum(a) FROM dw');
+is($expected, '20000|200040000', 'table contents before crash');
+
+my $relpath = $node->safe_psql('postgres', "SELECT pg_relation_filepath('dw')");
+
+$node->stop('immediate');
+
+# Tear the first page of the table, which was written during the updates.
+my $file = $node->data_dir . '/' . $relpath;
+open my $fh, '+<', $file or die "could not open \"$file\": $!";
+binmode $fh;
+sysseek($fh, 4096, 0) or die "could not seek in \"$file\": $!";
+syswrite($fh, "\0" x 4096) or die "could not write to \"$file\": $!";
+close $fh;
+
+$node->start;
+
+my $result = $node->safe_psql('postgres', 'SELECT count(*), sum(a) FROM dw');
+is($result, $expected, 'table contents after crash recovery');
+
+like(
+	slurp_file($node->logfile),
+	qr/restored \d+ pages from the double-write buffer/,
+	'torn page was restored from the double-write buffer');
+
+$node->stop;
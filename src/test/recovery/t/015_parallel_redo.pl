@@ -0,0 +1,94 @@
+#
+# Test WAL replay with parallel redo workers.
+#
+# Runs an OLTP-style workload on a master with max_parallel_redo_workers
+# set, and checks that both a streaming hot standby and crash recovery of
+# the master end up with the same contents as the master had.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+# Query comparing the contents of the pgbench tables, including a pass
+# over the primary key index of the accounts table.
+my $check_query = q{
+SELECT count(*), sum(abalance) FROM pgbench_accounts;
+SELECT count(*), sum(bbalance) FROM pgbench_branches;
+SELECT count(*), sum(tbalance) FROM pgbench_tellers;
+SELECT count(*), sum(delta) FROM pgbench_history;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(abalance) FROM pgbench_accounts WHERE aid > 0;
+SELECT count(*), sum(a) FROM pr_extra;
+};
+
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->append_conf(
+	'postgresql.conf', qq{
+max_parallel_redo_workers = 2
+checkpoint_timeout = 1h
+max_wal_size = 1GB
+autovacuum = off
+});
+$node_master->start;
+my $backup_name = 'my_backup';
+$node_master->backup($backup_name);
+
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_standby->start;
+
+# Build and run the workload.  Besides the pgbench transactions, mix in
+# records that the workers have to wait for, such as truncations, drops
+# and vacuum.
+$node_master->command_ok([ 'pgbench', '-i', '-s', '2', 'postgres' ],
+	'pgbench initialization');
+$node_master->safe_psql(
+	'postgres', q{
+CREATE TABLE pr_extra (a int);
+INSERT INTO pr_extra SELECT generate_series(1, 10000);
+CREATE TABLE pr_dropped AS SELECT generate_series(1, 1000) AS a;
+});
+$node_master->command_ok(
+	[ 'pgbench', '-n', '-c', '4', '-j', '2', '-t', '500', 'postgres' ],
+	'pgbench run');
+$node_master->safe_psql(
+	'postgres', q{
+DELETE FROM pr_extra WHERE a % 3 = 0;
+VACUUM pr_extra;
+UPDATE pr_extra SET a = a + 1 WHERE a % 5 = 0;
+DROP TABLE pr_dropped;
+DELETE FROM pgbench_history WHERE tid % 2 = 0;
+VACUUM pgbench_history;
+});
+
+my $expected = $node_master->safe_psql('postgres', $check_query);
+
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+
+my $result = $node_standby->safe_psql('postgres', $check_query);
+is($result, $expected, 'standby matches master after parallel replay');
+like(
+	slurp_file($node_standby->logfile),
+	qr/using \d+ parallel redo workers/,
+	'standby replayed with parallel redo workers');
+
+# Crash the master, and check that crash recovery restores the same
+# contents.  No checkpoint has been taken since the backup, so all of
+# the workload is replayed.
+$node_master->stop('immediate');
+$node_master->start;
+
+$result = $node_master->safe_psql('postgres', $check_query);
+is($result, $expected, 'master matches after parallel crash recovery');
+like(
+	slurp_file($node_master->logfile),
+	qr/using \d+ parallel redo workers/,
+	'crash recovery used parallel redo workers');
+
+$node_standby->stop;
+$node_master->stop;
@@ -92,3 +92,73 @@ vacuum btree_tall_tbl;
 -- need to insert some rows to cause the fast root page to split.
 insert into btree_tall_tbl (id, t)
   select g, repeat('x', 100) from generate_series(1, 500) g;
+
+--
+-- Test B-tree deduplication of duplicate keys into posting list tuples
+--
+create table btree_dedup_tbl (a int4, g int4);
+insert into btree_dedup_tbl
+  select g % 10, g from generate_series(1, 20000) g;
+create index btree_dedup_idx on btree_dedup_tbl (a);
+create index btree_nodedup_idx on btree_dedup_tbl (a)
+  with (deduplicate_items = off);
+select pg_relation_size('btree_dedup_idx') <
+       pg_relation_size('btree_nodedup_idx') / 2 as smaller;
+
+-- Insertions into existing pages deduplicate too
+insert into btree_dedup_tbl
+  select g % 10, g from generate_series(20001, 40000) g;
+select pg_relation_size('btree_dedup_idx') <
+       pg_relation_size('btree_nodedup_idx') / 2 as smaller;
+
+drop index btree_nodedup_idx;
+vacuum analyze btree_dedup_tbl;
+
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+select count(*) from btree_dedup_tbl where a = 3;
+select count(*) from btree_dedup_tbl where a between 2 and 4;
+explain (costs off)
+select a from btree_dedup_tbl where a >= 8 order by a desc;
+select a, count(*) from
+  (select a from btree_dedup_tbl where a >= 8 order by a desc) s
+  group by a order by a;
+set enable_indexscan to false;
+set enable_bitmapscan to true;
+select count(*) from btree_dedup_tbl where a = 3;
+
+-- Remove all of the TIDs in some posting lists, and only some in others
+delete from btree_dedup_tbl where a = 5 or g % 3 = 0;
+vacuum btree_dedup_tbl;
+set enable_indexscan to true;
+set enable_bitmapscan to false;
+select a, count(*) from btree_dedup_tbl where a >= 0 group by a order by a;
+select count(*) from btree_dedup_tbl where a = 5;
+reset enable_seqscan;
+reset enable_indexscan;
+reset enable_bitmapscan;
+
+alter index btree_dedup_idx set (deduplicate_items = off);
+insert into btree_dedup_tbl values (5, 0);
+select count(*) from btree_dedup_tbl where a = 5;
+drop table btree_dedup_tbl;
+
+--
+-- Test the fastpath for insertions into the rightmost leaf page.  The tree
+-- has to be at least two levels deep before the fastpath is used.
+--
+create table btree_fastpath_tbl (a int4, b int4);
+create unique index btree_fastpath_idx on btree_fastpath_tbl (a);
+insert into btree_fastpath_tbl select g, g from generate_series(1, 100000) g;
+-- uniqueness must still be checked when going straight to the cached page
+insert into btree_fastpath_tbl values (100000, 0);
+-- a key that belongs on an earlier page must not use the cached page
+insert into btree_fastpath_tbl values (0, 0);
+insert into btree_fastpath_tbl values (100001, 0);
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+select count(*), min(a), max(a) from btree_fastpath_tbl where a >= 0;
+select * from btree_fastpath_tbl where a in (0, 100000, 100001) order by a;
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table btree_fastpath_tbl;
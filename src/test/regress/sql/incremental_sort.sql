@@ -0,0 +1,32 @@
+--
+-- INCREMENTAL SORT
+--
+
+-- input already sorted on the leading sort column by an index
+explain (costs off)
+select hundred, unique1 from tenk1 order by hundred, unique1 limit 5;
+select hundred, unique1 from tenk1 order by hundred, unique1 limit 5;
+
+create table incsort_t (a int, b int);
+create index on incsort_t (a);
+insert into incsort_t select i / 50, (i * 37) % 101 from generate_series(1, 1000) i;
+analyze incsort_t;
+set enable_seqscan = off;
+
+-- the requested rows straddle the boundary between two sorted batches
+explain (costs off)
+select a, b from incsort_t order by a, b limit 3 offset 48;
+select a, b from incsort_t order by a, b limit 3 offset 48;
+
+-- rescans must start again from the first batch
+select * from (values (48), (49)) v(o),
+  lateral (select a, b from incsort_t order by a, b limit 1 offset v.o) s;
+
+-- disabling the node type falls back to a full sort
+set enable_incrementalsort = off;
+explain (costs off)
+select a, b from incsort_t order by a, b limit 3 offset 48;
+reset enable_incrementalsort;
+
+reset enable_seqscan;
+drop table incsort_t;
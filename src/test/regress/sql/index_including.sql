@@ -0,0 +1,78 @@
+--
+-- Test INCLUDE clause of CREATE INDEX
+--
+
+CREATE TABLE tbl (c1 int, c2 int, c3 int, c4 box);
+INSERT INTO tbl SELECT x, 2*x, 3*x, box('4,4,4,4') FROM generate_series(1,10) AS x;
+
+-- Creation, and the catalog and deparsed forms
+CREATE UNIQUE INDEX tbl_idx_unique ON tbl USING btree (c1, c2) INCLUDE (c3, c4);
+SELECT indnatts, indnkeyatts, indkey, indclass, indoption
+FROM pg_index WHERE indexrelid = 'tbl_idx_unique'::regclass;
+SELECT pg_get_indexdef('tbl_idx_unique'::regclass);
+SELECT pg_get_indexdef('tbl_idx_unique'::regclass, 3, true);
+\d tbl_idx_unique
+
+-- Uniqueness is checked on the key columns only
+INSERT INTO tbl SELECT 1, 2, 7, NULL;
+INSERT INTO tbl SELECT 1, 3, 3, NULL;
+
+-- Column properties
+SELECT a.attnum, pg_index_column_has_property('tbl_idx_unique'::regclass, a.attnum, p) AS value, p
+FROM generate_series(1, 4) AS a(attnum),
+     unnest(array['asc', 'orderable', 'returnable', 'search_nulls']) AS p
+ORDER BY a.attnum, p;
+SELECT amname, pg_indexam_has_property(oid, 'can_include')
+FROM pg_am
+WHERE amname IN ('btree', 'hash', 'gist', 'spgist', 'gin', 'brin')
+ORDER BY amname;
+
+-- Included columns can be returned by index-only scans, but not searched
+-- or sorted on
+CREATE INDEX tbl_idx ON tbl (c1) INCLUDE (c3);
+VACUUM ANALYZE tbl;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+EXPLAIN (COSTS OFF) SELECT c1, c3 FROM tbl WHERE c1 < 5;
+SELECT c1, c3 FROM tbl WHERE c1 < 5;
+EXPLAIN (COSTS OFF) SELECT c1 FROM tbl WHERE c3 = 6;
+EXPLAIN (COSTS OFF) SELECT c1, c3 FROM tbl ORDER BY c1, c3;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP INDEX tbl_idx;
+
+-- Multilevel index with included columns
+CREATE TABLE tbl_big (c1 int, c2 int, c3 text);
+INSERT INTO tbl_big SELECT x, x % 100, repeat('x', 50) || x
+FROM generate_series(1, 20000) AS x;
+CREATE UNIQUE INDEX tbl_big_idx ON tbl_big (c1) INCLUDE (c2, c3);
+INSERT INTO tbl_big SELECT x, 0, 'more' FROM generate_series(20001, 25000) AS x;
+INSERT INTO tbl_big VALUES (10000, 0, 'dup');
+SET enable_seqscan = off;
+SELECT c1, c2, c3 FROM tbl_big WHERE c1 BETWEEN 9999 AND 10001 ORDER BY c1;
+SELECT count(*) FROM tbl_big WHERE c1 > 19990;
+RESET enable_seqscan;
+DROP TABLE tbl_big;
+
+-- Unsupported uses
+CREATE INDEX ON tbl USING hash (c1) INCLUDE (c2);
+CREATE INDEX ON tbl USING gist (c4) INCLUDE (c1);
+CREATE INDEX ON tbl (c1) INCLUDE (c2 DESC);
+CREATE INDEX ON tbl (c1) INCLUDE (c2 int4_ops);
+CREATE INDEX ON tbl (c1) INCLUDE ((c2 + 1));
+ALTER TABLE tbl ADD CONSTRAINT tbl_pkey PRIMARY KEY USING INDEX tbl_idx_unique;
+
+-- Index rebuilt by ALTER TABLE keeps its included columns
+ALTER TABLE tbl ALTER c3 TYPE bigint;
+SELECT pg_get_indexdef('tbl_idx_unique'::regclass);
+
+-- CREATE TABLE LIKE copies them too
+CREATE TABLE tbl_like (LIKE tbl INCLUDING INDEXES);
+SELECT pg_get_indexdef(indexrelid) FROM pg_index WHERE indrelid = 'tbl_like'::regclass;
+DROP TABLE tbl_like;
+
+-- A key column can also appear as an included column
+CREATE INDEX tbl_idx_dup ON tbl (c1) INCLUDE (c1);
+SELECT pg_get_indexdef('tbl_idx_dup'::regclass);
+
+DROP TABLE tbl;
@@ -60,6 +60,39 @@ CREATE PUBLICATION testpub4 FOR TABLE ONLY testpub_tbl3;
 DROP TABLE testpub_tbl3, testpub_tbl3a;
 DROP PUBLICATION testpub3, testpub4;
 
+-- row filters and column lists
+CREATE TABLE testpub_rf_tbl1 (a int primary key, b text, c int);
+CREATE TABLE testpub_rf_tbl2 (x int, y text);
+CREATE FUNCTION testpub_rf_func(int) RETURNS int LANGUAGE sql IMMUTABLE AS 'SELECT $1';
+CREATE PUBLICATION testpub5 FOR TABLE testpub_rf_tbl1 (b) WHERE (c > 10), testpub_rf_tbl2 WHERE (y IS NOT NULL);
+\dRp+ testpub5
+\d testpub_rf_tbl1
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 (c, a);
+\dRp+ testpub5
+ALTER PUBLICATION testpub5 ADD TABLE testpub_rf_tbl2 (x) WHERE (x < 5);
+\dRp+ testpub5
+-- fail - columns used by the publication
+ALTER TABLE testpub_rf_tbl1 DROP COLUMN c;
+ALTER TABLE testpub_rf_tbl2 ALTER COLUMN x TYPE bigint;
+-- fail - bad column lists
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 (a, a);
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 (xmin);
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 (d);
+-- fail - bad row filters
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 WHERE (d > 1);
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 WHERE (a + 1);
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 WHERE (random() > 0.5);
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 WHERE (testpub_rf_func(a) > 1);
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 WHERE (a > (SELECT 1));
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 WHERE (sum(a) > 1);
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 WHERE (generate_series(1, a) > 1);
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 WHERE (ctid IS NOT NULL);
+ALTER PUBLICATION testpub5 SET TABLE testpub_rf_tbl1 WHERE (testpub_rf_tbl1 IS NOT NULL);
+DROP PUBLICATION testpub5;
+ALTER TABLE testpub_rf_tbl1 DROP COLUMN c;
+DROP TABLE testpub_rf_tbl1, testpub_rf_tbl2;
+DROP FUNCTION testpub_rf_func(int);
+
 -- fail - view
 CREATE PUBLICATION testpub_fortbl FOR TABLE testpub_view;
 CREATE PUBLICATION testpub_fortbl FOR TABLE testpub_tbl1, pub_test.testpub_nopk;
@@ -45,6 +45,60 @@ SELECT count(*) FROM
 SELECT count(*) FROM
   (SELECT DISTINCT two, four, two FROM tenk1) ss;
 
+--
+-- Loose index scans: DISTINCT over a leading index column, and btree
+-- skipping over leading-column groups to reach the second column
+--
+CREATE TABLE distinct_skip (a int, b int, c text);
+INSERT INTO distinct_skip
+  SELECT i % 10, i, 'x' || i FROM generate_series(1, 10000) i;
+INSERT INTO distinct_skip VALUES (NULL, 0, 'null');
+CREATE INDEX distinct_skip_ab ON distinct_skip (a, b);
+VACUUM ANALYZE distinct_skip;
+
+SET enable_hashagg = off;
+SET enable_sort = off;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+
+EXPLAIN (COSTS OFF)
+SELECT DISTINCT a FROM distinct_skip;
+SELECT DISTINCT a FROM distinct_skip;
+SELECT DISTINCT a FROM distinct_skip ORDER BY a DESC;
+SELECT DISTINCT a FROM distinct_skip WHERE a BETWEEN 3 AND 6;
+SELECT DISTINCT ON (a) a, b FROM distinct_skip ORDER BY a, b;
+SELECT DISTINCT ON (a) a, b FROM distinct_skip ORDER BY a DESC, b DESC;
+
+-- a scroll cursor must be able to move backwards over skipped groups
+BEGIN;
+DECLARE c SCROLL CURSOR FOR SELECT DISTINCT a FROM distinct_skip;
+FETCH 4 FROM c;
+FETCH BACKWARD 2 FROM c;
+FETCH ALL FROM c;
+FETCH BACKWARD ALL FROM c;
+COMMIT;
+
+-- quals on the second column let the scan hop between leading groups
+SELECT a, b FROM distinct_skip WHERE b = 4242;
+SELECT count(*) FROM distinct_skip WHERE b > 9990;
+SELECT count(*) FROM distinct_skip WHERE b >= 100 AND b < 200;
+SELECT count(*), sum(b) FROM distinct_skip WHERE a > 4 AND b < 50;
+DELETE FROM distinct_skip WHERE a = 3;
+SELECT DISTINCT a FROM distinct_skip;
+SELECT count(*) FROM distinct_skip WHERE b > 9990;
+
+SET enable_indexskipscan = off;
+EXPLAIN (COSTS OFF)
+SELECT DISTINCT a FROM distinct_skip;
+SELECT DISTINCT a FROM distinct_skip;
+
+RESET enable_indexskipscan;
+RESET enable_hashagg;
+RESET enable_sort;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE distinct_skip;
+
 --
 -- Also, some tests of IS DISTINCT FROM, which doesn't quite deserve its
 -- very own regression file.
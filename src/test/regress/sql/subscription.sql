@@ -91,8 +91,18 @@ ALTER SUBSCRIPTION testsub RENAME TO testsub_foo;
 ALTER SUBSCRIPTION testsub_foo SET (synchronous_commit = local);
 ALTER SUBSCRIPTION testsub_foo SET (synchronous_commit = foobar);
 
+-- streaming of in-progress transactions
+ALTER SUBSCRIPTION testsub_foo SET (streaming = on);
+ALTER SUBSCRIPTION testsub_foo SET (streaming = foo);
+
+-- binary transfer of column values
+ALTER SUBSCRIPTION testsub_foo SET (binary = true);
+ALTER SUBSCRIPTION testsub_foo SET (binary = foo);
+
 \dRs+
 
+ALTER SUBSCRIPTION testsub_foo SET (streaming = false, binary = false);
+
 -- rename back to keep the rest simple
 ALTER SUBSCRIPTION testsub_foo RENAME TO testsub;
 
@@ -0,0 +1,125 @@
+# Test applying transactions in parallel apply workers
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 4;
+
+sub wait_for_caught_up
+{
+	my ($node, $appname) = @_;
+
+	$node->poll_query_until('postgres',
+"SELECT pg_current_wal_lsn() <= replay_lsn FROM pg_stat_replication WHERE application_name = '$appname';"
+	) or die "Timed out while waiting for subscriber to catch up";
+}
+
+# Create publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->append_conf('postgresql.conf',
+	'max_parallel_apply_workers_per_subscription = 3');
+$node_subscriber->start;
+
+# Create some preexisting content on publisher
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE test_acc (a int primary key, b int)");
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO test_acc SELECT i, 0 FROM generate_series(1, 100) s(i)");
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE test_hist (id serial primary key, a int, delta int)");
+
+# Setup structure on subscriber
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE test_acc (a int primary key, b int)");
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE test_hist (id serial primary key, a int, delta int)");
+
+# Setup logical replication
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE test_acc, test_hist");
+
+my $appname = 'tap_sub';
+$node_subscriber->safe_psql('postgres',
+"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr application_name=$appname' PUBLICATION tap_pub"
+);
+
+wait_for_caught_up($node_publisher, $appname);
+
+# Also wait for initial table sync to finish
+my $synced_query =
+"SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('r', 's');";
+$node_subscriber->poll_query_until('postgres', $synced_query)
+  or die "Timed out while waiting for subscriber to synchronize data";
+
+# Many small transactions, some touching the same rows
+for my $i (1 .. 200)
+{
+	my $a = $i % 10 + 1;
+	my $b = $i % 7 + 20;
+	$node_publisher->safe_psql('postgres', qq{
+BEGIN;
+UPDATE test_acc SET b = b + $i WHERE a = $a;
+UPDATE test_acc SET b = b - $i WHERE a = $b;
+INSERT INTO test_hist (a, delta) VALUES ($a, $i);
+COMMIT;
+});
+}
+
+wait_for_caught_up($node_publisher, $appname);
+
+my $query =
+  "SELECT sum(b), string_agg(a || ':' || b, ',' ORDER BY a) FROM test_acc";
+my $expected = $node_publisher->safe_psql('postgres', $query);
+my $result = $node_subscriber->safe_psql('postgres', $query);
+is($result, $expected, 'check dependent transactions were applied in order');
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), sum(delta) FROM test_hist");
+is($result, qq(200|20100), 'check all transactions were applied');
+
+# A transaction changing a table with a replica trigger is applied serially
+$node_subscriber->safe_psql('postgres', q{
+CREATE TABLE test_log (a int);
+CREATE FUNCTION test_log_func() RETURNS trigger LANGUAGE plpgsql AS $$
+BEGIN
+  INSERT INTO test_log VALUES (NEW.a);
+  RETURN NULL;
+END $$;
+CREATE TRIGGER test_hist_trig AFTER INSERT ON test_hist
+  FOR EACH ROW EXECUTE PROCEDURE test_log_func();
+ALTER TABLE test_hist ENABLE ALWAYS TRIGGER test_hist_trig;
+});
+
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO test_hist (a, delta) SELECT i % 100, 1 FROM generate_series(1, 1000) s(i)");
+$node_publisher->safe_psql('postgres',
+	"UPDATE test_acc SET b = 0");
+
+wait_for_caught_up($node_publisher, $appname);
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT (SELECT count(*) FROM test_log), (SELECT sum(b) FROM test_acc)");
+is($result, qq(1000|0), 'check serially applied transactions');
+
+# A transaction too large to be buffered is passed on in chunks
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO test_hist (a, delta) SELECT i % 100, 1 FROM generate_series(1, 200000) s(i)");
+
+wait_for_caught_up($node_publisher, $appname);
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT count(*) FROM test_hist");
+is($result, qq(201200), 'check large transaction was applied');
+
+$node_subscriber->stop;
+$node_publisher->stop;
@@ -0,0 +1,98 @@
+# Test binary transfer mode of logical replication
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 4;
+
+sub wait_for_caught_up
+{
+	my ($node, $appname) = @_;
+
+	$node->poll_query_until('postgres',
+"SELECT pg_current_wal_lsn() <= replay_lsn FROM pg_stat_replication WHERE application_name = '$appname';"
+	) or die "Timed out while waiting for subscriber to catch up";
+}
+
+# Create publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->start;
+
+# A user-defined type is always sent as text, and a column of a different
+# type on the subscriber is converted
+my $ddl = qq(
+CREATE TYPE test_mood AS ENUM ('sad', 'ok', 'happy');
+CREATE TABLE test_tab (a numeric primary key, b timestamptz, c bytea,
+  d int[], e test_mood, f int);
+);
+$node_publisher->safe_psql('postgres', $ddl);
+$ddl =~ s/f int\)/f bigint)/;
+$node_subscriber->safe_psql('postgres', $ddl);
+
+$node_publisher->safe_psql('postgres', qq(
+INSERT INTO test_tab VALUES (1.5, '2017-10-01 12:00+00', '\\x0102', '{1,2}', 'ok', 1);
+));
+
+# Setup logical replication
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE test_tab");
+
+my $appname = 'tap_sub';
+$node_subscriber->safe_psql('postgres',
+"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr application_name=$appname' PUBLICATION tap_pub WITH (binary = true)"
+);
+
+wait_for_caught_up($node_publisher, $appname);
+
+# Also wait for initial table sync to finish
+my $synced_query =
+"SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('r', 's');";
+$node_subscriber->poll_query_until('postgres', $synced_query)
+  or die "Timed out while waiting for subscriber to synchronize data";
+
+$node_publisher->safe_psql('postgres', qq(
+INSERT INTO test_tab SELECT i / 3.0, '2017-10-01 12:00+00'::timestamptz + i * interval '1 minute',
+  decode(md5(i::text), 'hex'), ARRAY[i, -i], (ARRAY['sad', 'ok', 'happy'])[i % 3 + 1]::test_mood, i
+  FROM generate_series(10, 1000) s(i);
+UPDATE test_tab SET b = b + interval '1 day', f = -f WHERE a < 100;
+DELETE FROM test_tab WHERE a > 300;
+));
+
+wait_for_caught_up($node_publisher, $appname);
+
+my $query =
+  "SELECT count(*), md5(string_agg(test_tab::text, ',' ORDER BY a)) FROM test_tab";
+my $expected = $node_publisher->safe_psql('postgres', $query);
+my $result = $node_subscriber->safe_psql('postgres', $query);
+is($result, $expected, 'check changes were replicated in binary mode');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT subbinary FROM pg_subscription WHERE subname = 'tap_sub'");
+is($result, qq(t), 'check binary option is set');
+
+# Switching the option off restarts the apply worker in text mode
+$node_subscriber->safe_psql('postgres',
+	"ALTER SUBSCRIPTION tap_sub SET (binary = false)");
+
+$node_publisher->safe_psql('postgres',
+	"UPDATE test_tab SET c = c || '\\xff'::bytea WHERE a < 10");
+
+wait_for_caught_up($node_publisher, $appname);
+
+$expected = $node_publisher->safe_psql('postgres', $query);
+$result = $node_subscriber->safe_psql('postgres', $query);
+is($result, $expected, 'check changes were replicated in text mode');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*) FROM test_tab WHERE length(c) = 17");
+is($result, qq(20), 'check updated bytea values');
+
+$node_subscriber->stop;
+$node_publisher->stop;
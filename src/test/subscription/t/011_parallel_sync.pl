@@ -0,0 +1,74 @@
+# Test copying the initial data of tables in parallel
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 4;
+
+# Create publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->append_conf('postgresql.conf', qq(
+max_parallel_sync_workers_per_table = 2
+min_parallel_table_sync_size = 0
+));
+$node_subscriber->start;
+
+# Create some preexisting content on publisher; test_small has no
+# statistics, and test_ref is referenced by a foreign key on the subscriber,
+# so both are copied serially
+$node_publisher->safe_psql('postgres', q{
+CREATE TABLE test_int (a int primary key, b text);
+INSERT INTO test_int SELECT i, md5(i::text) FROM generate_series(1, 100000) s(i);
+CREATE TABLE test_text (a text primary key, b int);
+INSERT INTO test_text SELECT md5(i::text), i FROM generate_series(1, 20000) s(i);
+CREATE TABLE test_small (a int primary key);
+INSERT INTO test_small SELECT generate_series(1, 10);
+CREATE TABLE test_ref (a int primary key);
+INSERT INTO test_ref SELECT generate_series(1, 1000);
+ANALYZE test_int;
+ANALYZE test_text;
+ANALYZE test_ref;
+});
+
+# Setup structure on subscriber
+$node_subscriber->safe_psql('postgres', q{
+CREATE TABLE test_int (a int primary key, b text);
+CREATE TABLE test_text (a text primary key, b int);
+CREATE TABLE test_small (a int primary key);
+CREATE TABLE test_ref (a int primary key);
+CREATE TABLE test_fk (a int references test_ref);
+});
+
+# Setup logical replication
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE test_int, test_text, test_small, test_ref");
+
+my $appname = 'tap_sub';
+$node_subscriber->safe_psql('postgres',
+"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr application_name=$appname' PUBLICATION tap_pub"
+);
+
+# Wait for initial table sync to finish
+my $synced_query =
+"SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('r', 's');";
+$node_subscriber->poll_query_until('postgres', $synced_query)
+  or die "Timed out while waiting for subscriber to synchronize data";
+
+foreach my $tab ('test_int', 'test_text', 'test_small', 'test_ref')
+{
+	my $query =
+	  "SELECT count(*), md5(string_agg($tab::text, ',' ORDER BY a)) FROM $tab";
+	my $expected = $node_publisher->safe_psql('postgres', $query);
+	my $result = $node_subscriber->safe_psql('postgres', $query);
+	is($result, $expected, "check initial data of $tab was copied");
+}
+
+$node_subscriber->stop;
+$node_publisher->stop;
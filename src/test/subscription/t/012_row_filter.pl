@@ -0,0 +1,159 @@
+# Test row filters and column lists of publications
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 10;
+
+sub wait_for_caught_up
+{
+	my ($node, $appname) = @_;
+
+	$node->poll_query_until('postgres',
+"SELECT pg_current_wal_lsn() <= replay_lsn FROM pg_stat_replication WHERE application_name = '$appname';"
+	) or die "Timed out while waiting for subscriber to catch up";
+}
+
+# Create publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->start;
+
+# Create some preexisting content on publisher
+$node_publisher->safe_psql('postgres', q{
+CREATE TABLE test_rf (a int primary key, b text, c int);
+INSERT INTO test_rf SELECT i, 'b' || i, i % 10 FROM generate_series(1, 100) s(i);
+CREATE TABLE test_cols (a int primary key, b text, c text, d int);
+INSERT INTO test_cols SELECT i, 'b' || i, 'c' || i, i FROM generate_series(1, 10) s(i);
+CREATE TABLE test_multi (a int primary key, b text);
+INSERT INTO test_multi SELECT i, 'b' || i FROM generate_series(1, 20) s(i);
+CREATE TABLE test_rf_full (a int primary key, b text, c int);
+ALTER TABLE test_rf_full REPLICA IDENTITY FULL;
+INSERT INTO test_rf_full SELECT i, 'b' || i, i FROM generate_series(1, 10) s(i);
+});
+
+# Setup structure on subscriber; columns that are not published get their
+# defaults
+$node_subscriber->safe_psql('postgres', q{
+CREATE TABLE test_rf (a int primary key, b text, c int);
+CREATE TABLE test_cols (a int primary key, b text, c text DEFAULT 'none', d int);
+CREATE TABLE test_multi (a int primary key, b text);
+CREATE TABLE test_rf_full (a int primary key, b text, c int);
+});
+
+# Setup logical replication; test_multi is in both publications, so rows
+# satisfying either filter are published
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_publisher->safe_psql('postgres', q{
+CREATE PUBLICATION tap_pub FOR TABLE test_rf WHERE (c < 3),
+  test_cols (b, d), test_multi WHERE (a <= 5), test_rf_full WHERE (c < 5);
+CREATE PUBLICATION tap_pub2 FOR TABLE test_multi WHERE (a > 15);
+});
+
+my $appname = 'tap_sub';
+$node_subscriber->safe_psql('postgres',
+"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr application_name=$appname' PUBLICATION tap_pub, tap_pub2"
+);
+
+wait_for_caught_up($node_publisher, $appname);
+
+# Also wait for initial table sync to finish
+my $synced_query =
+"SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('r', 's');";
+$node_subscriber->poll_query_until('postgres', $synced_query)
+  or die "Timed out while waiting for subscriber to synchronize data";
+
+my $result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), max(c) FROM test_rf");
+is($result, qq(30|2), 'check initial data was filtered');
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), count(b), min(c), max(c), sum(d) FROM test_cols");
+is($result, qq(10|10|none|none|55), 'check initial data of published columns');
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT string_agg(a::text, ',' ORDER BY a) FROM test_multi");
+is($result, qq(1,2,3,4,5,16,17,18,19,20), 'check initial data was filtered by both publications');
+
+$node_publisher->safe_psql('postgres', q{
+INSERT INTO test_rf VALUES (101, 'new', 1), (102, 'new', 5);
+UPDATE test_rf SET b = 'upd' WHERE a IN (1, 2, 3);
+DELETE FROM test_rf WHERE a IN (10, 11, 12);
+INSERT INTO test_cols VALUES (11, 'b11', 'c11', 11);
+UPDATE test_cols SET b = 'upd', c = 'upd' WHERE a = 1;
+INSERT INTO test_multi VALUES (0, 'zero'), (21, 'big');
+UPDATE test_multi SET b = 'upd' WHERE a IN (5, 10);
+});
+
+wait_for_caught_up($node_publisher, $appname);
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), string_agg(a || ':' || b, ',' ORDER BY a) FILTER (WHERE b IN ('new', 'upd')) FROM test_rf");
+is($result, qq(28|1:upd,2:upd,101:new), 'check changes were filtered');
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT a, b, c, d FROM test_cols WHERE a IN (1, 11) ORDER BY a");
+is($result, qq(1|upd|none|1
+11|b11|none|11), 'check changes of published columns');
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT string_agg(a::text, ',' ORDER BY a) FROM test_multi WHERE a NOT BETWEEN 1 AND 20 OR b = 'upd'");
+is($result, qq(0,5,21), 'check changes were filtered by both publications');
+
+# An update that makes a row stop satisfying the filter is published as a
+# delete, and one that makes a row start satisfying it as an insert.  The
+# latter needs the old row, so the filter must only use replica identity
+# columns, as for test_multi, or the replica identity must be full.
+$node_publisher->safe_psql('postgres', q{
+UPDATE test_rf SET c = 5 WHERE a = 21;
+UPDATE test_rf_full SET c = 7 WHERE a = 2;
+UPDATE test_rf_full SET c = 1 WHERE a = 8;
+UPDATE test_rf_full SET b = 'upd' WHERE a IN (3, 9);
+UPDATE test_multi SET a = -1 WHERE a = 12;
+UPDATE test_multi SET a = 12 WHERE a = 4;
+});
+
+wait_for_caught_up($node_publisher, $appname);
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), count(*) FILTER (WHERE a = 21) FROM test_rf");
+is($result, qq(27|0), 'check update out of the filter was published as delete');
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT string_agg(a || ':' || c || ':' || b, ',' ORDER BY a) FROM test_rf_full");
+is($result, qq(1:1:b1,3:3:upd,4:4:b4,8:1:b8), 'check updates into and out of the filter');
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT string_agg(a::text, ',' ORDER BY a) FROM test_multi");
+is($result, qq(-1,0,1,2,3,5,16,17,18,19,20,21), 'check key updates into and out of the filter');
+
+# Changing the row filter takes effect for subsequent changes
+$node_publisher->safe_psql('postgres', q{
+ALTER PUBLICATION tap_pub SET TABLE test_rf WHERE (c >= 8), test_cols (b, d),
+  test_multi WHERE (a <= 5);
+INSERT INTO test_rf VALUES (103, 'new', 1), (104, 'new', 9);
+});
+
+wait_for_caught_up($node_publisher, $appname);
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT string_agg(a::text, ',' ORDER BY a) FROM test_rf WHERE a > 100");
+is($result, qq(101,104), 'check changed row filter');
+
+$node_subscriber->stop;
+$node_publisher->stop;
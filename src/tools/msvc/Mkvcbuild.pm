@@ -112,7 +112,7 @@ sub mkvcbuild
 	  base64.c config_info.c controldata_utils.c exec.c ip.c keywords.c
 	  md5.c pg_lzcompress.c pgfnames.c psprintf.c relpath.c rmtree.c
 	  saslprep.c scram-common.c string.c unicode_norm.c username.c
-	  wait_error.c);
+	  wait_error.c wire_compress.c);
 
 	if ($solution->{options}->{openssl})
 	{